@@ -119,6 +119,7 @@ SyncElemVector(vPtr)
     vPtr->valueArr = Blt_VecData(vPtr->vecPtr);
     vPtr->min = Blt_VecMin(vPtr->vecPtr);
     vPtr->max = Blt_VecMax(vPtr->vecPtr);
+    vPtr->version++;
 }
 
 /*
@@ -228,6 +229,7 @@ FreeDataVector(vPtr)
     }
     vPtr->valueArr = NULL;
     vPtr->nValues = 0;
+    vPtr->version++;
 }
 
 /*
@@ -259,6 +261,7 @@ VectorChangedProc(interp, clientData, notify)
 	vPtr->clientId = NULL;
 	vPtr->valueArr = NULL;
 	vPtr->nValues = 0;
+	vPtr->version++;
 	break;
 
     case BLT_VECTOR_NOTIFY_UPDATE:
@@ -196,6 +196,10 @@ typedef struct {
 
     Element *elemPtr;		/* Element associated with vector. */
 
+    unsigned int version;	/* Incremented each time the values
+				 * change.  Lets elements cache data
+				 * derived from the vector. */
+
 } ElemVector;
 
 
@@ -86,6 +86,31 @@ typedef struct {
 
 } MapInfo;
 
+/*
+ * The interpolated points of a smoothed line are kept in axis
+ * coordinates (the data values with any logarithmic scaling already
+ * applied).  From there a single linear transform produces the screen
+ * coordinates, so the curve is only regenerated when the data, the
+ * smoothing, or the scale of the view changes.
+ */
+typedef struct {
+    unsigned int xVersion;	/* Versions of the X and Y data vectors */
+    unsigned int yVersion;	/* the curve was generated from. */
+
+    Smoothing smooth;		/* Requested smoothing. */
+
+    int inverted;		/* Orientation of the graph. */
+
+    int hLog, vLog;		/* Log scaling of the horizontal and
+				 * vertical axes. */
+
+    Extents2D exts;		/* Region, in axis coordinates, where
+				 * points were interpolated. */
+
+    double hStep, vStep;	/* Size of a pixel in axis coordinates. */
+
+} CurveKey;
+
 /*
  * Symbol types for line elements
  */
@@ -327,6 +352,17 @@ typedef struct {
 
     Smoothing smooth;		/* Smoothing function used. */
 
+    CurveKey curveKey;		/* Describes what the cached curve
+				 * was generated for. */
+
+    Smoothing curveSmooth;	/* Smoothing actually applied to the
+				 * cached curve.  Falls back to linear
+				 * if the interpolation failed. */
+
+    MapInfo curve;		/* Cached smoothed curve in axis
+				 * coordinates.  If there are no points,
+				 * the data points are used as is. */
+
     double rTolerance;		/* Tolerance to reduce the number of
 				 * points displayed. */
     /*
@@ -1876,20 +1912,21 @@ GenerateSteps(mapPtr)
  *	None.
  *
  * Side Effects:
- *	The temporary arrays for screen coordinates and data indices
- *	are updated based upon spline.
+ *	The temporary arrays for coordinates and data indices are
+ *	updated based upon spline.
  *
  * FIXME:  Can't interpolate knots along the Y-axis.   Need to break
  *	   up point array into interchangable X and Y vectors earlier.
- *	   Pass extents (left/right or top/bottom) as parameters.
  *
  *----------------------------------------------------------------------
  */
 static void
-GenerateSpline(graphPtr, linePtr, mapPtr)
-    Graph *graphPtr;
+GenerateSpline(linePtr, mapPtr, extsPtr, step)
     Line *linePtr;
     MapInfo *mapPtr;
+    Extents2D *extsPtr;		/* Region where to interpolate points. */
+    double step;		/* Distance between interpolated
+				 * points along the abscissa. */
 {
     int extra;
     register int i, j, count;
@@ -1897,7 +1934,7 @@ GenerateSpline(graphPtr, linePtr, mapPtr)
     int *indices;
     int nIntpPts, nOrigPts;
     int result;
-    int x;
+    double x, k;
 
     nOrigPts = mapPtr->nScreenPts;
     origPts = mapPtr->screenPts;
@@ -1907,16 +1944,15 @@ GenerateSpline(graphPtr, linePtr, mapPtr)
 	    return;		/* Points are not monotonically increasing */
 	}
     }
-    if (((origPts[0].x > (double)graphPtr->right)) ||
-	((origPts[mapPtr->nScreenPts - 1].x < (double)graphPtr->left))) {
+    if (((origPts[0].x > extsPtr->right)) ||
+	((origPts[mapPtr->nScreenPts - 1].x < extsPtr->left))) {
 	return;			/* All points are clipped */
     }
     /*
-     * The spline is computed in screen coordinates instead of data
-     * points so that we can select the abscissas of the interpolated
-     * points from each pixel horizontally across the plotting area.
+     * The abscissas of the interpolated points are picked at fixed
+     * steps (normally a pixel) horizontally across the region.
      */
-    extra = (graphPtr->right - graphPtr->left) + 1;
+    extra = (int)((extsPtr->right - extsPtr->left) / step) + 1;
     if (extra < 1) {
 	return;
     }
@@ -1928,8 +1964,8 @@ GenerateSpline(graphPtr, linePtr, mapPtr)
     assert(indices);
 
     /* Populate the x2 array with both the original X-coordinates and
-     * extra X-coordinates for each horizontal pixel that the line
-     * segment contains. */
+     * extra X-coordinates for each step that the line segment
+     * contains. */
     count = 0;
     for (i = 0, j = 1; j < nOrigPts; i++, j++) {
 
@@ -1940,18 +1976,15 @@ GenerateSpline(graphPtr, linePtr, mapPtr)
 	indices[count] = mapPtr->indices[i];
 	count++;
 
-	/* Is any part of the interval (line segment) in the plotting
-	 * area?  */
-	if ((origPts[j].x >= (double)graphPtr->left) || 
-	    (origPts[i].x <= (double)graphPtr->right)) {
-	    int last;
-
-	    x = (int)(origPts[i].x + 1.0);
+	/* Is any part of the interval (line segment) in the region?  */
+	if ((origPts[j].x >= extsPtr->left) && 
+	    (origPts[i].x <= extsPtr->right)) {
+	    double last;
 
 	    /*
 	     * Since the line segment may be partially clipped on the
 	     * left or right side, the points to interpolate are
-	     * always interior to the plotting area.
+	     * always interior to the region.
 	     *
 	     *           left			    right
 	     *      x1----|--------------------------|---x2
@@ -1960,14 +1993,13 @@ GenerateSpline(graphPtr, linePtr, mapPtr)
 	     * left edge and the min of the last X-coordinate and
 	     * the right edge.
 	     */
-	    x = MAX(x, graphPtr->left);
-	    last = (int)MIN(origPts[j].x, graphPtr->right);
+	    x = MAX(origPts[i].x, extsPtr->left);
+	    last = MIN(origPts[j].x, extsPtr->right);
 
 	    /* Add the extra x-coordinates to the interval. */
-	    while (x < last) {
+	    for (k = floor(x / step) + 1.0; (x = k * step) < last; k++) {
 		indices[count] = mapPtr->indices[i];
-		intpPts[count++].x = (double)x;
-		x++;
+		intpPts[count++].x = x;
 	    }
 	}
     }
@@ -2007,22 +2039,22 @@ GenerateSpline(graphPtr, linePtr, mapPtr)
  *	None.
  *
  * Side Effects:
- *	The temporary arrays for screen coordinates and data indices
- *	are updated based upon spline.
+ *	The temporary arrays for coordinates and data indices are
+ *	updated based upon spline.
  *
  * FIXME:  Can't interpolate knots along the Y-axis.   Need to break
  *	   up point array into interchangable X and Y vectors earlier.
- *	   Pass extents (left/right or top/bottom) as parameters.
  *
  *----------------------------------------------------------------------
  */
 static void
-GenerateParametricSpline(graphPtr, linePtr, mapPtr)
-    Graph *graphPtr;
+GenerateParametricSpline(linePtr, mapPtr, extsPtr, hStep, vStep)
     Line *linePtr;
     MapInfo *mapPtr;
+    Extents2D *extsPtr;		/* Region where to interpolate points. */
+    double hStep, vStep;	/* Size of a pixel horizontally and
+				 * vertically. */
 {
-    Extents2D exts;
     Point2D *origPts, *intpPts;
     Point2D p, q;
     double dist;
@@ -2035,11 +2067,9 @@ GenerateParametricSpline(graphPtr, linePtr, mapPtr)
     origPts = mapPtr->screenPts;
     assert(mapPtr->nScreenPts > 0);
 
-    Blt_GraphExtents(graphPtr, &exts);
-
     /* 
      * Populate the x2 array with both the original X-coordinates and
-     * extra X-coordinates for each horizontal pixel that the line
+     * extra X-coordinates for every other pixel that the line
      * segment contains. 
      */
     count = 1;
@@ -2047,8 +2077,9 @@ GenerateParametricSpline(graphPtr, linePtr, mapPtr)
         p = origPts[i];
         q = origPts[j];
 	count++;
-        if (Blt_LineRectClip(&exts, &p, &q)) {
-	    count += (int)(hypot(q.x - p.x, q.y - p.y) * 0.5);
+        if (Blt_LineRectClip(extsPtr, &p, &q)) {
+	    count += (int)(hypot((q.x - p.x) / hStep, (q.y - p.y) / vStep)
+			   * 0.5);
 	}
     }
     nIntpPts = count;
@@ -2073,7 +2104,7 @@ GenerateParametricSpline(graphPtr, linePtr, mapPtr)
         p = origPts[i];
         q = origPts[j];
 
-        dist = hypot(q.x - p.x, q.y - p.y);
+        dist = hypot((q.x - p.x) / hStep, (q.y - p.y) / vStep);
         /* Add the original x-coordinate */
         intpPts[count].x = (double)i;
         intpPts[count].y = 0.0;
@@ -2082,14 +2113,15 @@ GenerateParametricSpline(graphPtr, linePtr, mapPtr)
         indices[count] = mapPtr->indices[i];
         count++;
 
-        /* Is any part of the interval (line segment) in the plotting
-         * area?  */
+        /* Is any part of the interval (line segment) in the region?  */
 
-        if (Blt_LineRectClip(&exts, &p, &q)) {
+        if (Blt_LineRectClip(extsPtr, &p, &q)) {
             double distP, distQ;
 
-            distP = hypot(p.x - origPts[i].x, p.y - origPts[i].y);
-            distQ = hypot(q.x - origPts[i].x, q.y - origPts[i].y);
+            distP = hypot((p.x - origPts[i].x) / hStep, 
+			  (p.y - origPts[i].y) / vStep);
+            distQ = hypot((q.x - origPts[i].x) / hStep, 
+			  (q.y - origPts[i].y) / vStep);
             distP += 2.0;
             while(distP <= distQ) {
                 /* Point is indicated by its interval and parameter t. */
@@ -2108,8 +2140,8 @@ GenerateParametricSpline(graphPtr, linePtr, mapPtr)
     nIntpPts = count;
     result = FALSE;
     if (linePtr->smooth == PEN_SMOOTH_NATURAL) {
-        result = Blt_NaturalParametricSpline(origPts, nOrigPts, &exts, FALSE,
-                            intpPts, nIntpPts);
+        result = Blt_NaturalParametricSpline(origPts, nOrigPts, extsPtr, 
+		FALSE, intpPts, nIntpPts);
     } else if (linePtr->smooth == PEN_SMOOTH_CATROM) {
         result = Blt_CatromParametricSpline(origPts, nOrigPts, intpPts,
                                             nIntpPts);
@@ -2130,6 +2162,306 @@ GenerateParametricSpline(graphPtr, linePtr, mapPtr)
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * AxisCoordinate --
+ *
+ *	Converts a data value into the linear coordinate system of
+ *	the axis.  This is the value Blt_HMap and Blt_VMap scale into
+ *	the plotting area.
+ *
+ *----------------------------------------------------------------------
+ */
+static INLINE double
+AxisCoordinate(axisPtr, value)
+    Axis *axisPtr;
+    double value;
+{
+    if ((axisPtr->logScale) && (value != 0.0)) {
+	value = log10(FABS(value));
+    }
+    return value;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetAxisTransform --
+ *
+ *	Computes the linear transform from axis coordinates to screen
+ *	coordinates.  This is the same mapping performed by Blt_HMap
+ *	and Blt_VMap, without the logarithm.
+ *
+ * Results:
+ *	The scale and offset of the transform are returned via
+ *	scalePtr and offsetPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+GetAxisTransform(graphPtr, axisPtr, horizontal, scalePtr, offsetPtr)
+    Graph *graphPtr;
+    Axis *axisPtr;
+    int horizontal;
+    double *scalePtr, *offsetPtr;
+{
+    double scale, min;
+
+    min = axisPtr->axisRange.min;
+    if (horizontal) {
+	scale = axisPtr->axisRange.scale * graphPtr->hRange;
+	if (axisPtr->descending) {
+	    *scalePtr = -scale;
+	    *offsetPtr = graphPtr->hOffset + graphPtr->hRange + min * scale;
+	} else {
+	    *scalePtr = scale;
+	    *offsetPtr = graphPtr->hOffset - min * scale;
+	}
+    } else {
+	scale = axisPtr->axisRange.scale * graphPtr->vRange;
+	if (axisPtr->descending) {
+	    *scalePtr = scale;
+	    *offsetPtr = graphPtr->vOffset - min * scale;
+	} else {
+	    *scalePtr = -scale;
+	    *offsetPtr = graphPtr->vOffset + graphPtr->vRange + min * scale;
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CurveIsCurrent --
+ *
+ *	Indicates if the cached curve can be reused for the current
+ *	view.  The data and smoothing must be unchanged.  Splines
+ *	must also cover the visible region at about the resolution
+ *	of a pixel: zooming in more than twice or out more than four
+ *	times regenerates the curve.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+CurveIsCurrent(linePtr, keyPtr)
+    Line *linePtr;
+    CurveKey *keyPtr;		/* Describes the current view. */
+{
+    CurveKey *cachePtr = &linePtr->curveKey;
+
+    if ((cachePtr->xVersion != keyPtr->xVersion) ||
+	(cachePtr->yVersion != keyPtr->yVersion) ||
+	(cachePtr->smooth != keyPtr->smooth) ||
+	(cachePtr->inverted != keyPtr->inverted) ||
+	(cachePtr->hLog != keyPtr->hLog) || 
+	(cachePtr->vLog != keyPtr->vLog)) {
+	return FALSE;
+    }
+    if (keyPtr->smooth == PEN_SMOOTH_STEP) {
+	return TRUE;		/* Steps don't depend upon the view. */
+    }
+    if ((keyPtr->exts.left < cachePtr->exts.left) ||
+	(keyPtr->exts.right > cachePtr->exts.right) ||
+	(cachePtr->hStep > (keyPtr->hStep * 2.0)) ||
+	(cachePtr->hStep < (keyPtr->hStep * 0.25))) {
+	return FALSE;
+    }
+    if (keyPtr->smooth == PEN_SMOOTH_CATROM) {
+	if ((keyPtr->exts.top < cachePtr->exts.top) ||
+	    (keyPtr->exts.bottom > cachePtr->exts.bottom) ||
+	    (cachePtr->vStep > (keyPtr->vStep * 2.0)) ||
+	    (cachePtr->vStep < (keyPtr->vStep * 0.25))) {
+	    return FALSE;
+	}
+    }
+    return TRUE;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GenerateCurve --
+ *
+ *	Regenerates the cached curve of the line element.  The data
+ *	points are converted to axis coordinates and then
+ *	interpolated with the requested smoothing.  Points are
+ *	interpolated over the visible region, widened by its size on
+ *	each side so that scrolling doesn't immediately invalidate the
+ *	curve.
+ *
+ * Results:
+ *	None.
+ *
+ * Side Effects:
+ *	The previous curve is freed.  The new curve and its key are
+ *	saved in the line element.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+GenerateCurve(linePtr, hAxisPtr, vAxisPtr, keyPtr)
+    Line *linePtr;
+    Axis *hAxisPtr, *vAxisPtr;	/* Horizontal and vertical axes. */
+    CurveKey *keyPtr;		/* Describes the current view. */
+{
+    MapInfo curve;
+    Point2D *origPts;
+    double *h, *v;
+    double width, height;
+    register int i, n, count;
+
+    if (linePtr->curve.screenPts != NULL) {
+	Blt_Free(linePtr->curve.screenPts);
+	Blt_Free(linePtr->curve.indices);
+	linePtr->curve.screenPts = NULL;
+	linePtr->curve.indices = NULL;
+    }
+    linePtr->curve.nScreenPts = 0;
+    linePtr->curveKey = *keyPtr;
+
+    width = keyPtr->exts.right - keyPtr->exts.left;
+    height = keyPtr->exts.bottom - keyPtr->exts.top;
+    linePtr->curveKey.exts.left -= width;
+    linePtr->curveKey.exts.right += width;
+    linePtr->curveKey.exts.top -= height;
+    linePtr->curveKey.exts.bottom += height;
+
+    n = NumberOfPoints(linePtr);
+    if (keyPtr->inverted) {
+	h = linePtr->y.valueArr, v = linePtr->x.valueArr;
+    } else {
+	h = linePtr->x.valueArr, v = linePtr->y.valueArr;
+    }
+    origPts = Blt_Malloc(sizeof(Point2D) * n);
+    assert(origPts);
+    curve.indices = Blt_Malloc(sizeof(int) * n);
+    assert(curve.indices);
+    count = 0;
+    for (i = 0; i < n; i++) {
+	if ((FINITE(h[i])) && (FINITE(v[i]))) {
+	    origPts[count].x = AxisCoordinate(hAxisPtr, h[i]);
+	    origPts[count].y = AxisCoordinate(vAxisPtr, v[i]);
+	    curve.indices[count] = i;
+	    count++;
+	}
+    }
+    curve.screenPts = origPts;
+    curve.nScreenPts = count;
+    curve.dataToStyle = NULL;
+
+    linePtr->smooth = keyPtr->smooth;
+    switch (keyPtr->smooth) {
+    case PEN_SMOOTH_STEP:
+	GenerateSteps(&curve);
+	break;
+
+    case PEN_SMOOTH_NATURAL:
+    case PEN_SMOOTH_QUADRATIC:
+	GenerateSpline(linePtr, &curve, &linePtr->curveKey.exts, 
+		keyPtr->hStep);
+	break;
+
+    case PEN_SMOOTH_CATROM:
+	GenerateParametricSpline(linePtr, &curve, &linePtr->curveKey.exts, 
+		keyPtr->hStep, keyPtr->vStep);
+	break;
+
+    default:
+	break;
+    }
+    linePtr->curveSmooth = linePtr->smooth;
+    if (curve.screenPts == origPts) {
+	/* Nothing was interpolated. */
+	Blt_Free(curve.screenPts);
+	Blt_Free(curve.indices);
+    } else {
+	linePtr->curve = curve;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MapCurve --
+ *
+ *	Replaces the screen coordinates of the data points with those
+ *	of the smoothed curve.  The curve is generated only if the
+ *	cached one is out of date.  Otherwise its points are simply
+ *	transformed to screen coordinates.
+ *
+ * Results:
+ *	None.
+ *
+ * Side Effects:
+ *	The temporary arrays for screen coordinates and data indices
+ *	are updated.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+MapCurve(graphPtr, linePtr, mapPtr)
+    Graph *graphPtr;
+    Line *linePtr;
+    MapInfo *mapPtr;
+{
+    CurveKey key;
+    Axis *hAxisPtr, *vAxisPtr;
+    double hScale, hOffset, vScale, vOffset;
+    double x1, x2, y1, y2;
+    Point2D *screenPts, *curvePts;
+    register int i;
+
+    if (graphPtr->inverted) {
+	hAxisPtr = linePtr->axes.y, vAxisPtr = linePtr->axes.x;
+    } else {
+	hAxisPtr = linePtr->axes.x, vAxisPtr = linePtr->axes.y;
+    }
+    GetAxisTransform(graphPtr, hAxisPtr, TRUE, &hScale, &hOffset);
+    GetAxisTransform(graphPtr, vAxisPtr, FALSE, &vScale, &vOffset);
+    if ((hScale == 0.0) || (vScale == 0.0)) {
+	return;			/* Plotting area or axis range is empty. */
+    }
+    key.xVersion = linePtr->x.version;
+    key.yVersion = linePtr->y.version;
+    key.smooth = linePtr->smooth;
+    key.inverted = graphPtr->inverted;
+    key.hLog = hAxisPtr->logScale;
+    key.vLog = vAxisPtr->logScale;
+    key.hStep = 1.0 / FABS(hScale);
+    key.vStep = 1.0 / FABS(vScale);
+
+    /* Convert the plotting area into axis coordinates. */
+    x1 = (graphPtr->left - hOffset) / hScale;
+    x2 = (graphPtr->right - hOffset) / hScale;
+    y1 = (graphPtr->top - vOffset) / vScale;
+    y2 = (graphPtr->bottom - vOffset) / vScale;
+    key.exts.left = MIN(x1, x2), key.exts.right = MAX(x1, x2);
+    key.exts.top = MIN(y1, y2), key.exts.bottom = MAX(y1, y2);
+
+    if (!CurveIsCurrent(linePtr, &key)) {
+	GenerateCurve(linePtr, hAxisPtr, vAxisPtr, &key);
+    }
+    linePtr->smooth = linePtr->curveSmooth;
+    if (linePtr->curve.nScreenPts == 0) {
+	return;			/* Use the data points as is. */
+    }
+    screenPts = Blt_Malloc(sizeof(Point2D) * linePtr->curve.nScreenPts);
+    assert(screenPts);
+    curvePts = linePtr->curve.screenPts;
+    for (i = 0; i < linePtr->curve.nScreenPts; i++) {
+	screenPts[i].x = curvePts[i].x * hScale + hOffset;
+	screenPts[i].y = curvePts[i].y * vScale + vOffset;
+    }
+    Blt_Free(mapPtr->screenPts);
+    Blt_Free(mapPtr->indices);
+    mapPtr->screenPts = screenPts;
+    mapPtr->indices = Blt_Malloc(sizeof(int) * linePtr->curve.nScreenPts);
+    assert(mapPtr->indices);
+    memcpy(mapPtr->indices, linePtr->curve.indices, 
+	   sizeof(int) * linePtr->curve.nScreenPts);
+    mapPtr->nScreenPts = linePtr->curve.nScreenPts;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -2872,25 +3204,19 @@ MapLine(graphPtr, elemPtr)
 
 	switch (linePtr->smooth) {
 	case PEN_SMOOTH_STEP:
-	    GenerateSteps(&mapInfo);
+	    if (mapInfo.nScreenPts > 1) {
+		MapCurve(graphPtr, linePtr, &mapInfo);
+	    }
 	    break;
 
 	case PEN_SMOOTH_NATURAL:
 	case PEN_SMOOTH_QUADRATIC:
-	    if (mapInfo.nScreenPts < 3) {
-		/* Can't interpolate with less than three points. */
-		linePtr->smooth = PEN_SMOOTH_NONE;
-	    } else {
-		GenerateSpline(graphPtr, linePtr, &mapInfo);
-	    }
-	    break;
-
 	case PEN_SMOOTH_CATROM:
 	    if (mapInfo.nScreenPts < 3) {
 		/* Can't interpolate with less than three points. */
 		linePtr->smooth = PEN_SMOOTH_NONE;
 	    } else {
-		GenerateParametricSpline(graphPtr, linePtr, &mapInfo);
+		MapCurve(graphPtr, linePtr, &mapInfo);
 	    }
 	    break;
 
@@ -5151,6 +5477,10 @@ DestroyLine(graphPtr, elemPtr)
     FreeVector(linePtr->yError);
 
     ResetLine(linePtr);
+    if (linePtr->curve.screenPts != NULL) {
+	Blt_Free(linePtr->curve.screenPts);
+	Blt_Free(linePtr->curve.indices);
+    }
     if (linePtr->palette != NULL) {
 	Blt_FreePalette(graphPtr, linePtr->palette);
 	Blt_ChainDestroy(linePtr->palette);
@@ -43,6 +43,7 @@
 #define DEF_MARKER_BITMAP	(char *)NULL
 #define DEF_MARKER_CAP_STYLE	"butt"
 #define DEF_MARKER_COORDS	(char *)NULL
+#define DEF_MARKER_CULL		"no"
 #define DEF_MARKER_DASHES	(char *)NULL
 #define DEF_MARKER_DASH_OFFSET	"0"
 #define DEF_MARKER_ELEMENT	(char *)NULL
@@ -182,6 +183,13 @@ struct MarkerStruct {
     MarkerClass *classPtr;
 
     int state;
+
+    Extents2D extents;		/* Screen bounding box of the marker.
+				 * Set when the marker is mapped. */
+
+    int cull;			/* If non-zero, the marker isn't drawn
+				 * if it overlaps another culled marker
+				 * displayed above it. */
 };
 
 /*
@@ -221,6 +229,9 @@ typedef struct {
     MarkerClass *classPtr;
 
     int state;
+    Extents2D extents;		/* Screen bounding box of marker. */
+    int cull;			/* If non-zero, drop the marker when it
+				 * overlaps other culled markers. */
     /*
      * Text specific fields and attributes
      */
@@ -264,6 +275,9 @@ static Tk_ConfigSpec textConfigSpecs[] =
     {TK_CONFIG_CUSTOM, "-coords", "coords", "Coords",
 	DEF_MARKER_COORDS, Tk_Offset(Marker, worldPts),
 	TK_CONFIG_NULL_OK, &coordsOption},
+    {TK_CONFIG_BOOLEAN, "-cull", "cull", "Cull",
+	DEF_MARKER_CULL, Tk_Offset(Marker, cull),
+	TK_CONFIG_DONT_SET_DEFAULT},
     {TK_CONFIG_STRING, "-element", "element", "Element",
 	DEF_MARKER_ELEMENT, Tk_Offset(Marker, elemName), TK_CONFIG_NULL_OK},
     {TK_CONFIG_SYNONYM, "-fg", "foreground", "Foreground",
@@ -362,6 +376,9 @@ typedef struct {
     MarkerClass *classPtr;
 
     int state;
+    Extents2D extents;		/* Screen bounding box of marker. */
+    int cull;			/* If non-zero, drop the marker when it
+				 * overlaps other culled markers. */
 
     /*
      * Window specific attributes
@@ -468,6 +485,9 @@ typedef struct {
     MarkerClass *classPtr;
 
     int state;
+    Extents2D extents;		/* Screen bounding box of marker. */
+    int cull;			/* If non-zero, drop the marker when it
+				 * overlaps other culled markers. */
 
     /* Bitmap specific attributes */
     Pixmap srcBitmap;		/* Original bitmap. May be further
@@ -517,6 +537,9 @@ static Tk_ConfigSpec bitmapConfigSpecs[] =
     {TK_CONFIG_CUSTOM, "-coords", "coords", "Coords",
 	DEF_MARKER_COORDS, Tk_Offset(Marker, worldPts),
 	TK_CONFIG_NULL_OK, &coordsOption},
+    {TK_CONFIG_BOOLEAN, "-cull", "cull", "Cull",
+	DEF_MARKER_CULL, Tk_Offset(Marker, cull),
+	TK_CONFIG_DONT_SET_DEFAULT},
     {TK_CONFIG_STRING, "-element", "element", "Element",
 	DEF_MARKER_ELEMENT, Tk_Offset(Marker, elemName), TK_CONFIG_NULL_OK},
     {TK_CONFIG_SYNONYM, "-fg", "foreground", (char *)NULL,
@@ -600,6 +623,9 @@ typedef struct {
     MarkerClass *classPtr;
 
     int state;
+    Extents2D extents;		/* Screen bounding box of marker. */
+    int cull;			/* If non-zero, drop the marker when it
+				 * overlaps other culled markers. */
 
     /* Image specific attributes */
     char *imageName;		/* Name of image to be displayed. */
@@ -626,6 +652,9 @@ static Tk_ConfigSpec imageConfigSpecs[] =
     {TK_CONFIG_CUSTOM, "-coords", "coords", "Coords",
 	DEF_MARKER_COORDS, Tk_Offset(Marker, worldPts),
 	TK_CONFIG_NULL_OK, &coordsOption},
+    {TK_CONFIG_BOOLEAN, "-cull", "cull", "Cull",
+	DEF_MARKER_CULL, Tk_Offset(Marker, cull),
+	TK_CONFIG_DONT_SET_DEFAULT},
     {TK_CONFIG_STRING, "-element", "element", "Element",
 	DEF_MARKER_ELEMENT, Tk_Offset(Marker, elemName), TK_CONFIG_NULL_OK},
     {TK_CONFIG_BOOLEAN, "-hide", "hide", "Hide",
@@ -691,6 +720,9 @@ typedef struct {
     MarkerClass *classPtr;
 
     int state;
+    Extents2D extents;		/* Screen bounding box of marker. */
+    int cull;			/* If non-zero, drop the marker when it
+				 * overlaps other culled markers. */
 
     /* Line specific attributes */
     XColor *fillColor;
@@ -812,6 +844,9 @@ typedef struct {
     MarkerClass *classPtr;
 
     int state;
+    Extents2D extents;		/* Screen bounding box of marker. */
+    int cull;			/* If non-zero, drop the marker when it
+				 * overlaps other culled markers. */
 
     /* Polygon specific attributes and fields */
 
@@ -1088,6 +1123,397 @@ BoxesDontOverlap(graphPtr, extsPtr)
 	    (extsPtr->bottom < (double)graphPtr->top));
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * GrowExtents --
+ *
+ *	Enlarges the bounding box to include the given point.
+ *
+ * ----------------------------------------------------------------------
+ */
+static void
+GrowExtents(extsPtr, pointPtr)
+    Extents2D *extsPtr;
+    Point2D *pointPtr;
+{
+    if (pointPtr->x < extsPtr->left) {
+	extsPtr->left = pointPtr->x;
+    } 
+    if (pointPtr->x > extsPtr->right) {
+	extsPtr->right = pointPtr->x;
+    }
+    if (pointPtr->y < extsPtr->top) {
+	extsPtr->top = pointPtr->y;
+    } 
+    if (pointPtr->y > extsPtr->bottom) {
+	extsPtr->bottom = pointPtr->y;
+    }
+}
+
+/*
+ * -------------------------------------------------------------------
+ *
+ * MarkerIndex --
+ *
+ *	Spatial index of the markers in the display list.  The graph
+ *	window is divided into a grid of square cells.  Each cell
+ *	lists, in display order, the markers whose screen bounding
+ *	box overlaps it.  Picking a marker or searching a region then
+ *	only has to look at the markers of a few cells, rather than
+ *	every marker.
+ *
+ *	The index is rebuilt lazily, the next time it's needed after
+ *	markers have been remapped, created, deleted, configured, or
+ *	restacked.
+ *
+ * -------------------------------------------------------------------
+ */
+#define CELL_SIZE	32	/* Width and height of a cell, in pixels. */
+
+struct MarkerIndexStruct {
+    int dirty;			/* Indicates the index must be rebuilt
+				 * before it's used. */
+
+    Marker **markers;		/* Indexed markers, in display order
+				 * (bottom to top). */
+    int nMarkers;
+
+    int nColumns, nRows;	/* Dimensions of the grid. */
+
+    int *cells;			/* Offsets into the entries array.
+				 * The entries of cell i are found
+				 * from cells[i] to cells[i + 1] - 1. */
+    int *entries;		/* Indices of markers overlapping
+				 * each cell, in display order. */
+
+    int *outside;		/* Indices of markers not completely
+				 * contained by the grid, in display
+				 * order. */
+    int nOutside;
+};
+
+#define MARKER_CULLED	(1<<8)	/* Marker overlaps another culled
+				 * marker above it, so it's not
+				 * displayed. */
+
+#define EMPTY_EXTENTS(e) \
+	((e)->left = (e)->top = DBL_MAX, (e)->right = (e)->bottom = -DBL_MAX)
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * GetCellRange --
+ *
+ *	Computes the range of grid cells overlapped by the given
+ *	bounding box.
+ *
+ * Results:
+ *	Returns 1 if the box overlaps the grid, 0 otherwise.  The
+ *	first and last columns and rows are returned via regionPtr.
+ *
+ * ----------------------------------------------------------------------
+ */
+static int
+GetCellRange(indexPtr, extsPtr, regionPtr)
+    MarkerIndex *indexPtr;
+    Extents2D *extsPtr;
+    Region2D *regionPtr;
+{
+    double maxX, maxY;
+
+    maxX = (double)(indexPtr->nColumns * CELL_SIZE);
+    maxY = (double)(indexPtr->nRows * CELL_SIZE);
+    if ((extsPtr->left > extsPtr->right) || (extsPtr->top > extsPtr->bottom) ||
+	(extsPtr->right < 0.0) || (extsPtr->bottom < 0.0) ||
+	(extsPtr->left >= maxX) || (extsPtr->top >= maxY)) {
+	return FALSE;
+    }
+    regionPtr->left = (extsPtr->left < 0.0) ? 0 :
+	(int)extsPtr->left / CELL_SIZE;
+    regionPtr->top = (extsPtr->top < 0.0) ? 0 :
+	(int)extsPtr->top / CELL_SIZE;
+    regionPtr->right = (extsPtr->right >= maxX) ? indexPtr->nColumns - 1 :
+	(int)extsPtr->right / CELL_SIZE;
+    regionPtr->bottom = (extsPtr->bottom >= maxY) ? indexPtr->nRows - 1 :
+	(int)extsPtr->bottom / CELL_SIZE;
+    return TRUE;
+}
+
+static int
+ExtentsInsideGrid(indexPtr, extsPtr)
+    MarkerIndex *indexPtr;
+    Extents2D *extsPtr;
+{
+    return ((extsPtr->left <= extsPtr->right) && 
+	    (extsPtr->top <= extsPtr->bottom) &&
+	    (extsPtr->left >= 0.0) && (extsPtr->top >= 0.0) &&
+	    (extsPtr->right < (double)(indexPtr->nColumns * CELL_SIZE)) &&
+	    (extsPtr->bottom < (double)(indexPtr->nRows * CELL_SIZE)));
+}
+
+static int
+ExtentsOverlap(e1Ptr, e2Ptr)
+    Extents2D *e1Ptr, *e2Ptr;
+{
+    return ((e1Ptr->left <= e2Ptr->right) && (e2Ptr->left <= e1Ptr->right) &&
+	    (e1Ptr->top <= e2Ptr->bottom) && (e2Ptr->top <= e1Ptr->bottom));
+}
+
+static void
+FreeMarkerIndexArrays(indexPtr)
+    MarkerIndex *indexPtr;
+{
+    if (indexPtr->markers != NULL) {
+	Blt_Free(indexPtr->markers);
+	indexPtr->markers = NULL;
+    }
+    if (indexPtr->cells != NULL) {
+	Blt_Free(indexPtr->cells);
+	indexPtr->cells = NULL;
+    }
+    if (indexPtr->entries != NULL) {
+	Blt_Free(indexPtr->entries);
+	indexPtr->entries = NULL;
+    }
+    if (indexPtr->outside != NULL) {
+	Blt_Free(indexPtr->outside);
+	indexPtr->outside = NULL;
+    }
+    indexPtr->nMarkers = indexPtr->nOutside = 0;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * CullMarkers --
+ *
+ *	Decides which markers with the -cull option set are displayed.
+ *	The markers are visited from the top of the display list down.
+ *	A marker is culled if its bounding box overlaps the box of a
+ *	culled marker already accepted above it and drawn at the same
+ *	level (see -under).  Markers that aren't drawn anyway, because
+ *	their element is hidden, take no part.  The accepted boxes are
+ *	kept in a temporary grid of linked lists, so only markers in
+ *	nearby cells are compared.
+ *
+ *	Hiding or showing an element remaps all markers, which
+ *	rebuilds the index, so the result stays current.
+ *
+ * Side effects:
+ *	The MARKER_CULLED flag is set for each rejected marker.
+ *
+ * ----------------------------------------------------------------------
+ */
+static int ElementIsHidden _ANSI_ARGS_((Graph *graphPtr, 
+	Marker *markerPtr));
+
+static void
+CullMarkers(graphPtr, indexPtr)
+    Graph *graphPtr;
+    MarkerIndex *indexPtr;
+{
+    Marker *markerPtr;
+    Region2D region;
+    int *heads, *next, *owner;
+    int nCells, nNodes, nAlloc;
+    int overlap;
+    register int i, row, col, node;
+
+    nCells = indexPtr->nColumns * indexPtr->nRows;
+    heads = NULL;
+    next = owner = NULL;
+    nNodes = nAlloc = 0;
+    for (i = indexPtr->nMarkers - 1; i >= 0; i--) {
+	markerPtr = indexPtr->markers[i];
+	if ((!markerPtr->cull) || (markerPtr->clipped) || 
+	    (markerPtr->flags & MAP_ITEM) || 
+	    (ElementIsHidden(graphPtr, markerPtr))) {
+	    continue;
+	}
+	if (!GetCellRange(indexPtr, &markerPtr->extents, &region)) {
+	    continue;
+	}
+	if (heads == NULL) {
+	    heads = Blt_Malloc(sizeof(int) * nCells);
+	    assert(heads);
+	    for (node = 0; node < nCells; node++) {
+		heads[node] = -1;
+	    }
+	}
+	overlap = FALSE;
+	for (row = region.top; (row <= region.bottom) && (!overlap); row++) {
+	    for (col = region.left; col <= region.right; col++) {
+		for (node = heads[row * indexPtr->nColumns + col]; node >= 0;
+		     node = next[node]) {
+		    Marker *abovePtr = indexPtr->markers[owner[node]];
+
+		    if ((abovePtr->drawUnder == markerPtr->drawUnder) &&
+			(ExtentsOverlap(&markerPtr->extents, 
+				&abovePtr->extents))) {
+			overlap = TRUE;
+			break;
+		    }
+		}
+		if (overlap) {
+		    break;
+		}
+	    }
+	}
+	if (overlap) {
+	    markerPtr->flags |= MARKER_CULLED;
+	    continue;
+	}
+	for (row = region.top; row <= region.bottom; row++) {
+	    for (col = region.left; col <= region.right; col++) {
+		int cell;
+
+		if (nNodes >= nAlloc) {
+		    nAlloc = (nAlloc == 0) ? 64 : nAlloc * 2;
+		    next = Blt_Realloc(next, sizeof(int) * nAlloc);
+		    owner = Blt_Realloc(owner, sizeof(int) * nAlloc);
+		    assert(next && owner);
+		}
+		cell = row * indexPtr->nColumns + col;
+		owner[nNodes] = i;
+		next[nNodes] = heads[cell];
+		heads[cell] = nNodes;
+		nNodes++;
+	    }
+	}
+    }
+    if (heads != NULL) {
+	Blt_Free(heads);
+    }
+    if (next != NULL) {
+	Blt_Free(next);
+	Blt_Free(owner);
+    }
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * BuildMarkerIndex --
+ *
+ *	Rebuilds the spatial index from the current display list and
+ *	the screen bounding boxes of the markers.  Hidden markers and
+ *	markers without coordinates aren't indexed.
+ *
+ * ----------------------------------------------------------------------
+ */
+static void
+BuildMarkerIndex(graphPtr, indexPtr)
+    Graph *graphPtr;
+    MarkerIndex *indexPtr;
+{
+    Blt_ChainLink *linkPtr;
+    Marker *markerPtr;
+    Region2D region;
+    int *fill;
+    int nCells, nMarkers;
+    register int i, row, col, cell;
+
+    FreeMarkerIndexArrays(indexPtr);
+    indexPtr->nColumns = graphPtr->width / CELL_SIZE + 1;
+    indexPtr->nRows = graphPtr->height / CELL_SIZE + 1;
+    nCells = indexPtr->nColumns * indexPtr->nRows;
+    indexPtr->cells = Blt_Calloc(nCells + 1, sizeof(int));
+    assert(indexPtr->cells);
+
+    nMarkers = Blt_ChainGetLength(graphPtr->markers.displayList);
+    if (nMarkers > 0) {
+	indexPtr->markers = Blt_Malloc(sizeof(Marker *) * nMarkers);
+	indexPtr->outside = Blt_Malloc(sizeof(int) * nMarkers);
+	assert(indexPtr->markers && indexPtr->outside);
+    }
+    /* Collect the markers and count the entries of each cell. */
+    for (linkPtr = Blt_ChainFirstLink(graphPtr->markers.displayList);
+	linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
+	markerPtr = Blt_ChainGetValue(linkPtr);
+	markerPtr->flags &= ~MARKER_CULLED;
+	if ((markerPtr->nWorldPts == 0) || (markerPtr->hidden)) {
+	    continue;
+	}
+	i = indexPtr->nMarkers++;
+	indexPtr->markers[i] = markerPtr;
+	if (!ExtentsInsideGrid(indexPtr, &markerPtr->extents)) {
+	    indexPtr->outside[indexPtr->nOutside++] = i;
+	}
+	if (GetCellRange(indexPtr, &markerPtr->extents, &region)) {
+	    for (row = region.top; row <= region.bottom; row++) {
+		for (col = region.left; col <= region.right; col++) {
+		    indexPtr->cells[row * indexPtr->nColumns + col + 1]++;
+		}
+	    }
+	}
+    }
+    for (cell = 0; cell < nCells; cell++) {
+	indexPtr->cells[cell + 1] += indexPtr->cells[cell];
+    }
+    if (indexPtr->cells[nCells] > 0) {
+	indexPtr->entries = Blt_Malloc(sizeof(int) * indexPtr->cells[nCells]);
+	fill = Blt_Malloc(sizeof(int) * nCells);
+	assert(indexPtr->entries && fill);
+	memcpy(fill, indexPtr->cells, sizeof(int) * nCells);
+
+	/* Markers are added in display order, so each cell is sorted. */
+	for (i = 0; i < indexPtr->nMarkers; i++) {
+	    markerPtr = indexPtr->markers[i];
+	    if (GetCellRange(indexPtr, &markerPtr->extents, &region)) {
+		for (row = region.top; row <= region.bottom; row++) {
+		    for (col = region.left; col <= region.right; col++) {
+			cell = row * indexPtr->nColumns + col;
+			indexPtr->entries[fill[cell]++] = i;
+		    }
+		}
+	    }
+	}
+	Blt_Free(fill);
+    }
+    CullMarkers(graphPtr, indexPtr);
+    indexPtr->dirty = FALSE;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * GetMarkerIndex --
+ *
+ *	Returns the spatial index of the graph's markers, creating or
+ *	rebuilding it as necessary.
+ *
+ * ----------------------------------------------------------------------
+ */
+static MarkerIndex *
+GetMarkerIndex(graphPtr)
+    Graph *graphPtr;
+{
+    MarkerIndex *indexPtr;
+
+    indexPtr = graphPtr->markerIndex;
+    if (indexPtr == NULL) {
+	indexPtr = Blt_Calloc(1, sizeof(MarkerIndex));
+	assert(indexPtr);
+	indexPtr->dirty = TRUE;
+	graphPtr->markerIndex = indexPtr;
+    }
+    if (indexPtr->dirty) {
+	BuildMarkerIndex(graphPtr, indexPtr);
+    }
+    return indexPtr;
+}
+
+static void
+InvalidateMarkerIndex(graphPtr)
+    Graph *graphPtr;
+{
+    if (graphPtr->markerIndex != NULL) {
+	graphPtr->markerIndex->dirty = TRUE;
+    }
+}
+
+
 
 /*
  * ----------------------------------------------------------------------
@@ -1505,6 +1931,7 @@ CreateMarker(graphPtr, name, classUid)
     markerPtr->graphPtr = graphPtr;
     markerPtr->hidden = markerPtr->drawUnder = FALSE;
     markerPtr->flags |= MAP_ITEM;
+    EMPTY_EXTENTS(&markerPtr->extents);
     markerPtr->name = Blt_Strdup(name);
     markerPtr->classUid = classUid;
     return markerPtr;
@@ -1519,6 +1946,7 @@ DestroyMarker(markerPtr)
     if (markerPtr->drawUnder) {
 	graphPtr->flags |= REDRAW_BACKING_STORE;
     }
+    InvalidateMarkerIndex(graphPtr);
     /* Free the resources allocated for the particular type of marker */
     (*markerPtr->classPtr->freeProc) (graphPtr, markerPtr);
     if (markerPtr->worldPts != NULL) {
@@ -1716,6 +2144,8 @@ MapBitmapMarker(markerPtr)
     exts.right = anchorPos.x + destWidth - 1;
     exts.bottom = anchorPos.y + destHeight - 1;
 
+    bmPtr->extents = exts;
+
     bmPtr->clipped = BoxesDontOverlap(graphPtr, &exts);
     if (bmPtr->clipped) {
 	return;			/* Bitmap is offscreen. Don't generate
@@ -2226,6 +2656,7 @@ MapImageMarker(markerPtr)
 	exts.top = imPtr->anchorPos.y;
 	exts.right = exts.left + srcWidth - 1;
 	exts.bottom = exts.top + srcHeight - 1;
+	imPtr->extents = exts;
 	imPtr->clipped = BoxesDontOverlap(graphPtr, &exts);
 	return;
     }
@@ -2269,6 +2700,8 @@ MapImageMarker(markerPtr)
     exts.right = anchorPos.x + scaledWidth - 1;
     exts.bottom = anchorPos.y + scaledHeight - 1;
 
+    imPtr->extents = exts;
+
     imPtr->clipped = BoxesDontOverlap(graphPtr, &exts);
     if (imPtr->clipped) {
 	return;			/* Image is offscreen. Don't generate
@@ -2665,6 +3098,7 @@ MapTextMarker(markerPtr)
     exts.top = anchorPos.y;
     exts.right = anchorPos.x + tmPtr->width - 1;
     exts.bottom = anchorPos.y + tmPtr->height - 1;
+    tmPtr->extents = exts;
     tmPtr->clipped = BoxesDontOverlap(graphPtr, &exts);
     tmPtr->anchorPos = anchorPos;
 
@@ -3032,6 +3466,7 @@ MapWindowMarker(markerPtr)
     exts.top = wmPtr->anchorPos.y;
     exts.right = wmPtr->anchorPos.x + wmPtr->width - 1;
     exts.bottom = wmPtr->anchorPos.y + wmPtr->height - 1;
+    wmPtr->extents = exts;
     wmPtr->clipped = BoxesDontOverlap(graphPtr, &exts);
 }
 
@@ -3343,12 +3778,15 @@ MapLineMarker(markerPtr)
     p.x += lmPtr->xOffset;
     p.y += lmPtr->yOffset;
 
+    lmPtr->extents.left = lmPtr->extents.right = p.x;
+    lmPtr->extents.top = lmPtr->extents.bottom = p.y;
     segPtr = segments;
     for (srcPtr++, endPtr = lmPtr->worldPts + lmPtr->nWorldPts; 
 	 srcPtr < endPtr; srcPtr++) {
 	next = MapPoint(graphPtr, srcPtr, &lmPtr->axes);
 	next.x += lmPtr->xOffset;
 	next.y += lmPtr->yOffset;
+	GrowExtents(&lmPtr->extents, &next);
 	q = next;
 	if (Blt_LineRectClip(&exts, &p, &q)) {
 	    segPtr->p = p;
@@ -3360,6 +3798,12 @@ MapLineMarker(markerPtr)
     lmPtr->nSegments = segPtr - segments;
     lmPtr->segments = segments;
     lmPtr->clipped = (lmPtr->nSegments == 0);
+
+    /* Picking is done within the halo around the line segments. */
+    lmPtr->extents.left -= graphPtr->halo;
+    lmPtr->extents.right += graphPtr->halo;
+    lmPtr->extents.top -= graphPtr->halo;
+    lmPtr->extents.bottom += graphPtr->halo;
 }
 
 static int
@@ -3700,10 +4144,13 @@ MapPolygonMarker(markerPtr)
     screenPts = Blt_Malloc((nScreenPts + 1) * sizeof(Point2D));
     endPtr = pmPtr->worldPts + pmPtr->nWorldPts;
     destPtr = screenPts;
+    pmPtr->extents.left = pmPtr->extents.top = DBL_MAX;
+    pmPtr->extents.right = pmPtr->extents.bottom = -DBL_MAX;
     for (srcPtr = pmPtr->worldPts; srcPtr < endPtr; srcPtr++) {
 	*destPtr = MapPoint(graphPtr, srcPtr, &pmPtr->axes);
 	destPtr->x += pmPtr->xOffset;
 	destPtr->y += pmPtr->yOffset;
+	GrowExtents(&pmPtr->extents, destPtr);
 	destPtr++;
     }
     *destPtr = screenPts[0];
@@ -4331,6 +4778,7 @@ ConfigureOp(graphPtr, interp, argc, argv)
 	if (markerPtr->drawUnder != under) {
 	    graphPtr->flags |= REDRAW_BACKING_STORE;
 	}
+	InvalidateMarkerIndex(graphPtr);
     }
     return TCL_OK;
 }
@@ -4577,6 +5025,7 @@ RelinkOp(graphPtr, interp, argc, argv)
     } else {
 	Blt_ChainLinkBefore(graphPtr->markers.displayList, linkPtr, placePtr);
     }
+    InvalidateMarkerIndex(graphPtr);
     if (markerPtr->drawUnder) {
 	graphPtr->flags |= REDRAW_BACKING_STORE;
     }
@@ -4585,6 +5034,54 @@ RelinkOp(graphPtr, interp, argc, argv)
 }
 
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * ElementIsHidden --
+ *
+ *	Indicates if the element the marker is attached to (via the
+ *	-element option) is currently hidden.
+ *
+ * ----------------------------------------------------------------------
+ */
+static int
+ElementIsHidden(graphPtr, markerPtr)
+    Graph *graphPtr;
+    Marker *markerPtr;
+{
+    Blt_HashEntry *hPtr;
+    Element *elemPtr;
+
+    if (markerPtr->elemName == NULL) {
+	return FALSE;
+    }
+    hPtr = Blt_FindHashEntry(&graphPtr->elements.table, markerPtr->elemName);
+    if (hPtr == NULL) {
+	return FALSE;
+    }
+    elemPtr = (Element *)Blt_GetHashValue(hPtr);
+    return elemPtr->hidden;
+}
+
+static int
+FindMarkerInRegion(graphPtr, indexPtr, i, extsPtr)
+    Graph *graphPtr;
+    MarkerIndex *indexPtr;
+    int i;			/* Index of marker in the display order. */
+    Extents2D *extsPtr;
+{
+    Marker *markerPtr;
+
+    markerPtr = indexPtr->markers[i];
+    if (markerPtr->flags & MARKER_CULLED) {
+	return FALSE;
+    }
+    if (ElementIsHidden(graphPtr, markerPtr)) {
+	return FALSE;
+    }
+    return (*markerPtr->classPtr->regionProc)(markerPtr, extsPtr, FALSE);
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -4645,25 +5142,62 @@ FindOp(graphPtr, interp, argc, argv)
 	exts.bottom = (double)top;
     }
     enclosed = (mode == FIND_ENCLOSED);
+    if (!enclosed) {
+	MarkerIndex *indexPtr;
+	Region2D region;
+	int best, row, col;
+	register int i;
+
+	/* 
+	 * Only markers in the grid cells overlapping the region (or
+	 * extending outside of the grid) need to be tested.  Pick
+	 * the lowest marker in the display list, as a linear search
+	 * would.
+	 */
+	indexPtr = GetMarkerIndex(graphPtr);
+	best = indexPtr->nMarkers;
+	for (i = 0; i < indexPtr->nOutside; i++) {
+	    if (FindMarkerInRegion(graphPtr, indexPtr, indexPtr->outside[i], 
+		&exts)) {
+		best = indexPtr->outside[i];
+		break;
+	    }
+	}
+	if (GetCellRange(indexPtr, &exts, &region)) {
+	    for (row = region.top; row <= region.bottom; row++) {
+		for (col = region.left; col <= region.right; col++) {
+		    int cell;
+
+		    cell = row * indexPtr->nColumns + col;
+		    for (i = indexPtr->cells[cell]; 
+			 i < indexPtr->cells[cell + 1]; i++) {
+			if (indexPtr->entries[i] >= best) {
+			    break;
+			}
+			if (FindMarkerInRegion(graphPtr, indexPtr, 
+				indexPtr->entries[i], &exts)) {
+			    best = indexPtr->entries[i];
+			    break;
+			}
+		    }
+		}
+	    }
+	}
+	if (best < indexPtr->nMarkers) {
+	    Tcl_SetResult(interp, indexPtr->markers[best]->name, TCL_VOLATILE);
+	    return TCL_OK;
+	}
+	Tcl_SetResult(interp, "", TCL_VOLATILE);
+	return TCL_OK;
+    }
     for (linkPtr = Blt_ChainFirstLink(graphPtr->markers.displayList);
 	 linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
 	markerPtr = Blt_ChainGetValue(linkPtr);
-	if (markerPtr->hidden) {
+	if ((markerPtr->hidden) || (markerPtr->flags & MARKER_CULLED)) {
 	    continue;
 	}
-	if (markerPtr->elemName != NULL) {
-	    Blt_HashEntry *hPtr;
-	    
-	    hPtr = Blt_FindHashEntry(&graphPtr->elements.table, 
-				     markerPtr->elemName);
-	    if (hPtr != NULL) {
-		Element *elemPtr;
-		
-		elemPtr = (Element *)Blt_GetHashValue(hPtr);
-		if (elemPtr->hidden) {
-		    continue;
-		}
-	    }
+	if (ElementIsHidden(graphPtr, markerPtr)) {
+	    continue;
 	}
 	if ((*markerPtr->classPtr->regionProc)(markerPtr, &exts, enclosed)) {
 	    Tcl_SetResult(interp, markerPtr->name, TCL_VOLATILE);
@@ -4816,22 +5350,11 @@ Blt_MarkersToPostScript(graphPtr, psToken, under)
 	if (markerPtr->drawUnder != under) {
 	    continue;
 	}
-	if (markerPtr->hidden) {
+	if ((markerPtr->hidden) || (markerPtr->flags & MARKER_CULLED)) {
 	    continue;
 	}
-	if (markerPtr->elemName != NULL) {
-	    Blt_HashEntry *hPtr;
-
-	    hPtr = Blt_FindHashEntry(&graphPtr->elements.table, 
-			     markerPtr->elemName);
-	    if (hPtr != NULL) {
-		Element *elemPtr;
-
-		elemPtr = (Element *)Blt_GetHashValue(hPtr);
-		if (elemPtr->hidden) {
-		    continue;
-		}
-	    }
+	if (ElementIsHidden(graphPtr, markerPtr)) {
+	    continue;
 	}
 	Blt_AppendToPostScript(psToken, "\n% Marker \"", markerPtr->name,
 	    "\" is a ", markerPtr->classUid, " marker\n", (char *)NULL);
@@ -4839,6 +5362,149 @@ Blt_MarkersToPostScript(graphPtr, psToken, under)
     }
 }
 
+/*
+ * -------------------------------------------------------------------------
+ *
+ * MarkerIsDrawable --
+ *
+ *	Indicates if the marker should be drawn at the current level
+ *	(above or below the elements).  See Blt_DrawMarkers.
+ *
+ * -------------------------------------------------------------------------
+ */
+static int
+MarkerIsDrawable(graphPtr, markerPtr, under)
+    Graph *graphPtr;
+    Marker *markerPtr;
+    int under;
+{
+    if ((markerPtr->nWorldPts == 0) || 
+	(markerPtr->drawUnder != under) ||
+	(markerPtr->hidden) || 
+	(markerPtr->clipped) ||
+	(markerPtr->flags & MARKER_CULLED)) {
+	return FALSE;
+    }
+    return !ElementIsHidden(graphPtr, markerPtr);
+}
+
+static int
+MarkerIsPickable(markerPtr, pointPtr, under)
+    Marker *markerPtr;
+    Point2D *pointPtr;
+    int under;
+{
+    /* 
+     * Don't consider markers that are pending to be mapped. Even
+     * if the marker has already been mapped, the coordinates
+     * could be invalid now.  Better to pick no marker than the
+     * wrong marker.
+     */
+    if ((markerPtr->drawUnder == under) && (markerPtr->nWorldPts > 0) && 
+	((markerPtr->flags & (MAP_ITEM | MARKER_CULLED)) == 0) && 
+	(!markerPtr->hidden) && (markerPtr->state == STATE_NORMAL)) {
+	return (*markerPtr->classPtr->pointProc) (markerPtr, pointPtr);
+    }
+    return FALSE;
+}
+
+/*
+ * -------------------------------------------------------------------------
+ *
+ * DrawTextMarkerRun --
+ *
+ *	Draws a run of consecutive culled text markers, starting at
+ *	the given position in the display order.  Culled markers
+ *	don't overlap each other, so the backgrounds of the whole
+ *	run can be filled first, with a single XFillRectangles call
+ *	for each background GC, and then the text drawn.
+ *
+ *	Only the backgrounds of text markers are batched.  Their text,
+ *	and markers of other types, are still drawn one at a time by
+ *	their draw procedures.
+ *
+ * Results:
+ *	Returns the index of the last marker of the run.
+ *
+ * -------------------------------------------------------------------------
+ */
+static int
+DrawTextMarkerRun(graphPtr, drawable, indexPtr, first, under)
+    Graph *graphPtr;
+    Drawable drawable;
+    MarkerIndex *indexPtr;
+    int first;			/* Index of the first marker of the run. */
+    int under;
+{
+    TextMarker *tmPtr;
+    XRectangle *rectArr;
+    GC gc;
+    int nRects, last;
+    register int i, j;
+
+    /* Find the end of the run. Markers not drawn don't break it. */
+    last = first;
+    for (i = first + 1; i < indexPtr->nMarkers; i++) {
+	Marker *markerPtr = indexPtr->markers[i];
+
+	if (!MarkerIsDrawable(graphPtr, markerPtr, under)) {
+	    continue;
+	}
+	if ((!markerPtr->cull) || (markerPtr->classUid != bltTextMarkerUid)) {
+	    break;
+	}
+	last = i;
+    }
+    rectArr = Blt_Malloc(sizeof(XRectangle) * (last - first + 1));
+    assert(rectArr);
+    gc = NULL;
+    nRects = 0;
+    for (i = first; i <= last; i++) {
+	tmPtr = (TextMarker *)indexPtr->markers[i];
+	if ((tmPtr->string == NULL) || (tmPtr->fillGC == NULL) ||
+	    (!MarkerIsDrawable(graphPtr, (Marker *)tmPtr, under))) {
+	    continue;
+	}
+	if (tmPtr->style.theta != 0.0) {
+	    XPoint pointArr[4];
+
+	    for (j = 0; j < 4; j++) {
+		pointArr[j].x = (short int)
+		    (tmPtr->outline[j].x + tmPtr->anchorPos.x);
+		pointArr[j].y = (short int)
+		    (tmPtr->outline[j].y + tmPtr->anchorPos.y);
+	    }
+	    XFillPolygon(graphPtr->display, drawable, tmPtr->fillGC, 
+		pointArr, 4, Convex, CoordModeOrigin);
+	    continue;
+	}
+	if ((tmPtr->fillGC != gc) && (nRects > 0)) {
+	    XFillRectangles(graphPtr->display, drawable, gc, rectArr, nRects);
+	    nRects = 0;
+	}
+	gc = tmPtr->fillGC;
+	rectArr[nRects].x = (short int)tmPtr->anchorPos.x;
+	rectArr[nRects].y = (short int)tmPtr->anchorPos.y;
+	rectArr[nRects].width = (unsigned short int)tmPtr->width;
+	rectArr[nRects].height = (unsigned short int)tmPtr->height;
+	nRects++;
+    }
+    if (nRects > 0) {
+	XFillRectangles(graphPtr->display, drawable, gc, rectArr, nRects);
+    }
+    Blt_Free(rectArr);
+    for (i = first; i <= last; i++) {
+	tmPtr = (TextMarker *)indexPtr->markers[i];
+	if ((tmPtr->string == NULL) || (tmPtr->style.color == NULL) ||
+	    (!MarkerIsDrawable(graphPtr, (Marker *)tmPtr, under))) {
+	    continue;
+	}
+	Blt_DrawTextLayout(graphPtr->tkwin, drawable, tmPtr->textPtr,
+	    &tmPtr->style, (int)tmPtr->anchorPos.x, (int)tmPtr->anchorPos.y);
+    }
+    return last;
+}
+
 /*
  * -------------------------------------------------------------------------
  *
@@ -4877,35 +5543,21 @@ Blt_DrawMarkers(graphPtr, drawable, under)
     Drawable drawable;		/* Pixmap or window to draw into */
     int under;
 {
-    Blt_ChainLink *linkPtr;
+    MarkerIndex *indexPtr;
     Marker *markerPtr;
+    register int i;
 
-    for (linkPtr = Blt_ChainFirstLink(graphPtr->markers.displayList);
-	linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
-	markerPtr = Blt_ChainGetValue(linkPtr);
-
-	if ((markerPtr->nWorldPts == 0) || 
-	    (markerPtr->drawUnder != under) ||
-	    (markerPtr->hidden) || 
-	    (markerPtr->clipped)) {
+    indexPtr = GetMarkerIndex(graphPtr);
+    for (i = 0; i < indexPtr->nMarkers; i++) {
+	markerPtr = indexPtr->markers[i];
+	if (!MarkerIsDrawable(graphPtr, markerPtr, under)) {
 	    continue;
 	}
-	if (markerPtr->elemName != NULL) {
-	    Blt_HashEntry *hPtr;
-
-	    /* Look up the named element and see if it's hidden */
-	    hPtr = Blt_FindHashEntry(&graphPtr->elements.table, 
-				     markerPtr->elemName);
-	    if (hPtr != NULL) {
-		Element *elemPtr;
-
-		elemPtr = (Element *)Blt_GetHashValue(hPtr);
-		if (elemPtr->hidden) {
-		    continue;
-		}
-	    }
+	if ((markerPtr->cull) && (markerPtr->classUid == bltTextMarkerUid)) {
+	    /* Draw the run of culled text markers starting here. */
+	    i = DrawTextMarkerRun(graphPtr, drawable, indexPtr, i, under);
+	    continue;
 	}
-
 	(*markerPtr->classPtr->drawProc) (markerPtr, drawable);
     }
 }
@@ -4924,8 +5576,10 @@ Blt_MapMarkers(graphPtr)
 	    continue;
 	}
 	if ((graphPtr->flags & MAP_ALL) || (markerPtr->flags & MAP_ITEM)) {
+	    EMPTY_EXTENTS(&markerPtr->extents);
 	    (*markerPtr->classPtr->mapProc) (markerPtr);
 	    markerPtr->flags &= ~MAP_ITEM;
+	    InvalidateMarkerIndex(graphPtr);
 	}
     }
 }
@@ -4952,6 +5606,11 @@ Blt_DestroyMarkers(graphPtr)
     Blt_DeleteHashTable(&graphPtr->markers.table);
     Blt_DeleteHashTable(&graphPtr->markers.tagTable);
     Blt_ChainDestroy(graphPtr->markers.displayList);
+    if (graphPtr->markerIndex != NULL) {
+	FreeMarkerIndexArrays(graphPtr->markerIndex);
+	Blt_Free(graphPtr->markerIndex);
+	graphPtr->markerIndex = NULL;
+    }
 }
 
 Marker *
@@ -4960,28 +5619,50 @@ Blt_NearestMarker(graphPtr, x, y, under)
     int x, y;			/* Screen coordinates */
     int under;
 {
-    Blt_ChainLink *linkPtr;
+    MarkerIndex *indexPtr;
     Marker *markerPtr;
     Point2D point;
+    int best, cell;
+    register int i;
 
     point.x = (double)x;
     point.y = (double)y;
-    for (linkPtr = Blt_ChainLastLink(graphPtr->markers.displayList);
-	linkPtr != NULL; linkPtr = Blt_ChainPrevLink(linkPtr)) {
-	markerPtr = Blt_ChainGetValue(linkPtr);
-	/* 
-	 * Don't consider markers that are pending to be mapped. Even
-	 * if the marker has already been mapped, the coordinates
-	 * could be invalid now.  Better to pick no marker than the
-	 * wrong marker.
-	 */
-	if ((markerPtr->drawUnder == under) && (markerPtr->nWorldPts > 0) && 
-	    ((markerPtr->flags & MAP_ITEM) == 0) && 
-	    (!markerPtr->hidden) && (markerPtr->state == STATE_NORMAL)) {
-	    if ((*markerPtr->classPtr->pointProc) (markerPtr, &point)) {
-		return markerPtr;
+    indexPtr = GetMarkerIndex(graphPtr);
+    best = -1;
+    if ((x >= 0) && (y >= 0) && (x < indexPtr->nColumns * CELL_SIZE) &&
+	(y < indexPtr->nRows * CELL_SIZE)) {
+	/* Search the markers of the cell from the top down. */
+	cell = (y / CELL_SIZE) * indexPtr->nColumns + (x / CELL_SIZE);
+	for (i = indexPtr->cells[cell + 1] - 1; i >= indexPtr->cells[cell]; 
+	     i--) {
+	    if (MarkerIsPickable(indexPtr->markers[indexPtr->entries[i]], 
+				 &point, under)) {
+		best = indexPtr->entries[i];
+		break;
 	    }
 	}
+	/* Markers not completely inside of the grid may lie above it. */
+	for (i = indexPtr->nOutside - 1; i >= 0; i--) {
+	    if (indexPtr->outside[i] <= best) {
+		break;
+	    }
+	    if (MarkerIsPickable(indexPtr->markers[indexPtr->outside[i]], 
+				 &point, under)) {
+		best = indexPtr->outside[i];
+		break;
+	    }
+	}
+    } else {
+	for (i = indexPtr->nMarkers - 1; i >= 0; i--) {
+	    if (MarkerIsPickable(indexPtr->markers[i], &point, under)) {
+		best = i;
+		break;
+	    }
+	}
+    }
+    if (best < 0) {
+	return NULL;
     }
-    return NULL;
+    markerPtr = indexPtr->markers[best];
+    return markerPtr;
 }
@@ -159,6 +159,7 @@ typedef enum BarModes {
 
 typedef struct PenStruct Pen;
 typedef struct MarkerStruct Marker;
+typedef struct MarkerIndexStruct MarkerIndex;
 
 typedef Pen *(PenCreateProc) _ANSI_ARGS_((void));
 typedef int (PenConfigureProc) _ANSI_ARGS_((Graph *graphPtr, Pen *penPtr));
@@ -383,6 +384,8 @@ struct GraphStruct {
 
     Blt_BindTable bindTable;
     int nextMarkerId;		/* Tracks next marker identifier available */
+    MarkerIndex *markerIndex;	/* Spatial index of markers: see
+				 * bltGrMarker.c */
     
     Blt_Chain *axisChain[4];	/* Chain of axes for each of the
 				 * margins.  They're separate from the
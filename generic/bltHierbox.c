@@ -46,6 +46,7 @@
 #include "bltChain.h"
 #include "bltList.h"
 #include "bltTile.h"
+#include "bltTree.h"
 #include <X11/Xutil.h>
 #include <X11/Xatom.h>
 
@@ -99,6 +100,11 @@
 
 #define GETFONT(h, f)		(((f) == NULL) ? (h)->defFont : (f))
 #define GETCOLOR(h, c)		(((c) == NULL) ? (h)->defColor : (c))
+#define GETLABEL(e)		(((e)->labelText == NULL) ? \
+	Blt_TreeNodeLabel((e)->treePtr->node) : (e)->labelText)
+#define NODENAME(t)		Blt_TreeNodeLabel((t)->node)
+#define LEVEL(t)		\
+	Blt_TreeNodeDepth((t)->entryPtr->hboxPtr->tree, (t)->node)
 
 /*
  * ----------------------------------------------------------------------------
@@ -173,6 +179,10 @@
  *	ENTRY_MAPPED		Indicates that the entry is mapped (i.e.
  *				can be viewed by opening or scrolling.
  *
+ *	ENTRY_DIRTY		The entry was configured or its node
+ *				relabeled.  Its GCs and dimensions are
+ *				recomputed at the next layout.
+ *
  *	BUTTON_AUTO
  *	BUTTON_SHOW
  *	BUTTON_MASK
@@ -182,6 +192,7 @@
 #define ENTRY_BUTTON	(1<<0)
 #define ENTRY_OPEN	(1<<2)
 #define ENTRY_MAPPED	(1<<3)
+#define ENTRY_DIRTY	(1<<4)
 #define BUTTON_AUTO	(1<<8)
 #define BUTTON_SHOW	(1<<9)
 #define BUTTON_MASK	(BUTTON_AUTO | BUTTON_SHOW)
@@ -274,6 +285,7 @@
 #define DEF_HIERBOX_TEXT_COLOR		STD_NORMAL_FOREGROUND
 #define DEF_HIERBOX_TEXT_MONO		STD_NORMAL_FG_MONO
 #define DEF_HIERBOX_TILE		(char *)NULL
+#define DEF_HIERBOX_TREE		(char *)NULL
 #define DEF_HIERBOX_TRIMLEFT		""
 #define DEF_HIERBOX_WIDTH		"200"
 
@@ -300,6 +312,10 @@ static Tk_OptionParseProc StringToScrollMode;
 static Tk_OptionPrintProc ScrollModeToString;
 static Tk_OptionParseProc StringToSeparator;
 static Tk_OptionPrintProc SeparatorToString;
+static Tk_OptionParseProc StringToTree;
+static Tk_OptionPrintProc TreeToString;
+static Tk_OptionParseProc StringToLabel;
+static Tk_OptionPrintProc LabelToString;
 /*
  * Contains a pointer to the widget that's currently being configured.
  * This is used in the custom configuration parse routine for images.
@@ -322,6 +338,14 @@ static Tk_CustomOption separatorOption =
 {
     StringToSeparator, SeparatorToString, (ClientData)0,
 };
+static Tk_CustomOption treeOption = 
+{
+    StringToTree, TreeToString, (ClientData)0,
+};
+static Tk_CustomOption labelOption = 
+{
+    StringToLabel, LabelToString, (ClientData)0,
+};
 /*
  * CachedImage --
  *
@@ -354,29 +378,21 @@ typedef struct CachedImageStruct {
 /*
  * Tree --
  *
- *	Structure representing a general order tree.
+ *	Structure representing a node of the hierarchy.  The hierarchy
+ *	itself (node names, parents and children) is kept in a tree
+ *	object, possibly shared with other widgets or Tcl code.  A Tree
+ *	record and its entry are only created the first time the node
+ *	is visited by the widget, so that nodes of closed branches
+ *	don't take up any space.
  *
  */
 struct TreeStruct {
-    Blt_Uid nameId;		/* String identifying the node within this
-				 * hierarchy.  Does not necessarily have to
-				 * be unique. */
+    Blt_TreeNode node;		/* Node of the tree object. */
 
     Entry *entryPtr;		/* Points to the entry structure at this
 				 * node. */
 
-    Tree *parentPtr;		/* Pointer to the parent node.
-				 * If NULL, this is the root node. */
-
-    Blt_Chain *chainPtr;	/* Pointer to list of child nodes. The list
-				 * isn't allocated until the child nodes are
-				 * to be inserted. */
-
-    Blt_ChainLink *linkPtr;	/* List link containing this node in parent.
-				 * This is used to remove the node from
-				 * its parent when destroying the node. */
-
-    short int level;		/* The level of this node in the tree. */
+    Blt_HashEntry *hashPtr;	/* Entry of the record in the node table. */
 };
 
 /*
@@ -409,9 +425,7 @@ struct EntryStruct {
 				 * because in the typical case most
 				 * entries will have the same
 				 * bintags. */
-    Blt_HashEntry *hashPtr;	/* Points the hash entry containing this
-				 * entry.  This is how the node index is
-				 * stored--as the key of the hash entry. */
+    Tree *treePtr;		/* Node record holding this entry. */
     Hierbox *hboxPtr;
 
     Blt_Uid openCmd, closeCmd;	/* Tcl commands to invoke when entries
@@ -452,7 +466,8 @@ struct EntryStruct {
      * Label information:
      */
     short int labelWidth, labelHeight;
-    char *labelText;		/* Text displayed right of the icon. */
+    char *labelText;		/* Text displayed right of the icon.  If
+				 * NULL, the label of the node is used. */
 
 
     Tk_Font labelFont;		/* Font of label. Overrides global font
@@ -507,8 +522,9 @@ static Tk_ConfigSpec entryConfigSpecs[] =
     {TK_CONFIG_CUSTOM, "-images", "images", "Images",
 	DEF_ENTRY_IMAGES, Tk_Offset(Entry, images),
 	TK_CONFIG_NULL_OK, &imagesOption},
-    {TK_CONFIG_STRING, "-label", "label", "Label",
-	DEF_ENTRY_LABEL, Tk_Offset(Entry, labelText), 0},
+    {TK_CONFIG_CUSTOM, "-label", "label", "Label",
+	DEF_ENTRY_LABEL, Tk_Offset(Entry, labelText), 
+	TK_CONFIG_NULL_OK, &labelOption},
     {TK_CONFIG_COLOR, "-labelcolor", "labelColor", "LabelColor",
 	DEF_ENTRY_FOREGROUND, Tk_Offset(Entry, labelColor),
 	TK_CONFIG_NULL_OK | TK_CONFIG_COLOR_ONLY},
@@ -809,7 +825,12 @@ struct HierboxStruct {
 				 * started. */
 
 
-    Blt_HashTable nodeTable;	/* Table of node identifiers */
+    Blt_Tree tree;		/* Tree object holding the hierarchy.
+				 * Unless one is named with the -tree
+				 * option, the widget creates its own. */
+    Blt_HashTable nodeTable;	/* Table of node records, keyed by
+				 * tree node.  Records are only made
+				 * for nodes visited by the widget. */
     Blt_HashTable imageTable;	/* Table of Tk images */
     Tree *rootPtr;		/* Root of hierarchy */
     int depth;			/* Maximum depth of the hierarchy. */
@@ -817,8 +838,6 @@ struct HierboxStruct {
     Tree **visibleArr;		/* Array of visible entries */
     int nVisible;		/* Number of entries in the above array */
 
-    int nextSerial;
-
     char *openCmd, *closeCmd;	/* Tcl commands to invoke when entries
 				 * are opened or closed. */
 
@@ -1020,6 +1039,9 @@ static Tk_ConfigSpec configSpecs[] =
     {TK_CONFIG_CUSTOM, "-tile", "tile", "Tile",
 	(char *)NULL, Tk_Offset(Hierbox, tile), TK_CONFIG_NULL_OK,
 	&bltTileOption},
+    {TK_CONFIG_CUSTOM, "-tree", "tree", "Tree",
+	DEF_HIERBOX_TREE, Tk_Offset(Hierbox, tree), TK_CONFIG_NULL_OK,
+	&treeOption},
     {TK_CONFIG_STRING, "-trimleft", "trimLeft", "Trim",
 	DEF_HIERBOX_TRIMLEFT, Tk_Offset(Hierbox, trimLeft), TK_CONFIG_NULL_OK},
     {TK_CONFIG_CUSTOM, "-width", "width", "Width",
@@ -1090,6 +1112,8 @@ static int ComputeVisibleEntries _ANSI_ARGS_((Hierbox *hboxPtr));
 static int ConfigureEntry _ANSI_ARGS_((Hierbox *hboxPtr, Entry * entryPtr,
 	int argc, CONST char **argv, int flags));
 static void ComputeLayout _ANSI_ARGS_((Hierbox *hboxPtr));
+static int AttachTree _ANSI_ARGS_((Hierbox *hboxPtr, Blt_Tree tree));
+static Blt_TreeNotifyEventProc TreeEventProc;
 
 static CompareProc ExactCompare, GlobCompare, RegexpCompare;
 static ApplyProc SelectNode, GetSelectedLabels, CloseNode, SizeOfNode, 
@@ -1097,7 +1121,7 @@ static ApplyProc SelectNode, GetSelectedLabels, CloseNode, SizeOfNode,
     SortNode, OpenNode;
 static IterProc NextNode, LastNode;
 static Tk_ImageChangedProc ImageChangedProc;
-static Blt_ChainCompareProc CompareNodesByTclCmd, CompareNodesByName;
+static Blt_TreeCompareNodesProc CompareNodesByTclCmd, CompareNodesByName;
 static Blt_BindPickProc PickButton, PickEntry;
 static Blt_BindTagProc GetTags;
 static Tk_SelectionProc SelectionProc;
@@ -1506,6 +1530,232 @@ SeparatorToString(clientData, tkwin, widgRec, offset, freeProcPtr)
     return separator;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * StringToTree --
+ *
+ *	Attaches the widget to the named tree object.  An empty
+ *	string creates a new tree object private to the widget.
+ *
+ * Results:
+ *	If the tree was attached, TCL_OK is returned.  Otherwise,
+ *	TCL_ERROR is returned and an error message is left in
+ *	interpreter's result field.
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static int
+StringToTree(clientData, interp, tkwin, string, widgRec, offset)
+    ClientData clientData;	/* Not used. */
+    Tcl_Interp *interp;		/* Interpreter to send results back to */
+    Tk_Window tkwin;		/* Not used. */
+    char *string;		/* String representing new value */
+    char *widgRec;		/* Widget record */
+    int offset;			/* Not used. */
+{
+    Hierbox *hboxPtr = (Hierbox *)widgRec;
+    Blt_Tree tree;
+
+    tree = NULL;
+    if ((string != NULL) && (*string != '\0') &&
+	(Blt_TreeGetToken(interp, string, &tree) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    return AttachTree(hboxPtr, tree);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TreeToString --
+ *
+ * Results:
+ *	The name of the tree object is returned.
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static char *
+TreeToString(clientData, tkwin, widgRec, offset, freeProcPtr)
+    ClientData clientData;	/* Not used. */
+    Tk_Window tkwin;		/* Not used. */
+    char *widgRec;		/* Widget record */
+    int offset;			/* offset of tree field in record */
+    Tcl_FreeProc **freeProcPtr;	/* Memory deallocation scheme to use */
+{
+    Blt_Tree tree = *(Blt_Tree *)(widgRec + offset);
+
+    if (tree == NULL) {
+	return "";
+    }
+    return (char *)Blt_TreeName(tree);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StringToLabel --
+ *
+ *	Sets the text displayed for the entry.  The text overrides the
+ *	label of the entry's tree node.
+ *
+ * Results:
+ *	Always returns TCL_OK.
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static int
+StringToLabel(clientData, interp, tkwin, string, widgRec, offset)
+    ClientData clientData;	/* Not used. */
+    Tcl_Interp *interp;		/* Not used. */
+    Tk_Window tkwin;		/* Not used. */
+    char *string;		/* String representing new value */
+    char *widgRec;		/* Entry record */
+    int offset;			/* Offset of label field in record */
+{
+    char **labelPtr = (char **)(widgRec + offset);
+
+    if (*labelPtr != NULL) {
+	Blt_Free(*labelPtr);
+    }
+    *labelPtr = (string == NULL) ? NULL : Blt_Strdup(string);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LabelToString --
+ *
+ * Results:
+ *	The text displayed for the entry is returned.  This is the
+ *	label of the tree node, unless one was set for the entry.
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static char *
+LabelToString(clientData, tkwin, widgRec, offset, freeProcPtr)
+    ClientData clientData;	/* Not used. */
+    Tk_Window tkwin;		/* Not used. */
+    char *widgRec;		/* Entry record */
+    int offset;			/* Not used. */
+    Tcl_FreeProc **freeProcPtr;	/* Not used. */
+{
+    Entry *entryPtr = (Entry *)widgRec;
+
+    return GETLABEL(entryPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NodeToTree --
+ *
+ *	Returns the record of the given tree node, creating it (and
+ *	its entry, set to the default options) the first time the
+ *	node is visited.
+ *
+ * Results:
+ *	Returns a pointer to the node record, or NULL if node is NULL.
+ *
+ *----------------------------------------------------------------------
+ */
+static Tree *
+NodeToTree(hboxPtr, node)
+    Hierbox *hboxPtr;
+    Blt_TreeNode node;
+{
+    Blt_HashEntry *hPtr;
+    Entry *entryPtr;
+    Tree *treePtr;
+    int isNew;
+
+    if (node == NULL) {
+	return NULL;
+    }
+    hPtr = Blt_CreateHashEntry(&(hboxPtr->nodeTable), (char *)node, &isNew);
+    if (!isNew) {
+	return (Tree *)Blt_GetHashValue(hPtr);
+    }
+    entryPtr = Blt_Calloc(1, sizeof(Entry));
+    assert(entryPtr);
+    entryPtr->flags = (BUTTON_AUTO | ENTRY_MAPPED | ENTRY_DIRTY);
+    entryPtr->hboxPtr = hboxPtr;
+
+    treePtr = Blt_Calloc(1, sizeof(Tree));
+    assert(treePtr);
+    treePtr->node = node;
+    treePtr->entryPtr = entryPtr;
+    treePtr->hashPtr = hPtr;
+    entryPtr->treePtr = treePtr;
+    Blt_SetHashValue(hPtr, treePtr);
+
+    /* 
+     * Only the defaults are set here.  The GCs and dimensions of the
+     * entry are computed when it's first laid out.
+     */
+    hierBox = hboxPtr;
+    Blt_ConfigureWidget(hboxPtr->interp, hboxPtr->tkwin, entryConfigSpecs, 0,
+	(CONST char **)NULL, (char *)entryPtr, 0);
+    return treePtr;
+}
+
+static Tree *
+ParentOf(treePtr)
+    Tree *treePtr;
+{
+    Hierbox *hboxPtr = treePtr->entryPtr->hboxPtr;
+
+    if (treePtr->node == Blt_TreeRootNode(hboxPtr->tree)) {
+	return NULL;
+    }
+    return NodeToTree(hboxPtr, Blt_TreeNodeParent(treePtr->node));
+}
+
+static Tree *
+FirstChildOf(treePtr)
+    Tree *treePtr;
+{
+    return NodeToTree(treePtr->entryPtr->hboxPtr, 
+	Blt_TreeFirstChild(treePtr->node));
+}
+
+static Tree *
+LastChildOf(treePtr)
+    Tree *treePtr;
+{
+    return NodeToTree(treePtr->entryPtr->hboxPtr, 
+	Blt_TreeLastChild(treePtr->node));
+}
+
+static Tree *
+NextSiblingOf(treePtr)
+    Tree *treePtr;
+{
+    Hierbox *hboxPtr = treePtr->entryPtr->hboxPtr;
+
+    if (treePtr->node == Blt_TreeRootNode(hboxPtr->tree)) {
+	return NULL;
+    }
+    return NodeToTree(hboxPtr, Blt_TreeNextSibling(treePtr->node));
+}
+
+static Tree *
+PrevSiblingOf(treePtr)
+    Tree *treePtr;
+{
+    Hierbox *hboxPtr = treePtr->entryPtr->hboxPtr;
+
+    if (treePtr->node == Blt_TreeRootNode(hboxPtr->tree)) {
+	return NULL;
+    }
+    return NodeToTree(hboxPtr, Blt_TreePrevSibling(treePtr->node));
+}
+
 static int
 ApplyToTree(hboxPtr, rootPtr, proc, flags)
     Hierbox *hboxPtr;
@@ -1521,16 +1771,15 @@ ApplyToTree(hboxPtr, rootPtr, proc, flags)
     if (flags & APPLY_RECURSE) {
 	if (!(flags & APPLY_OPEN_ONLY) ||
 	    (rootPtr->entryPtr->flags & ENTRY_OPEN)) {
-	    Blt_ChainLink *linkPtr, *nextPtr;
+	    Blt_TreeNode node, next;
 	    Tree *treePtr;
 
-	    for (linkPtr = Blt_ChainFirstLink(rootPtr->chainPtr); 
-		linkPtr != NULL;  linkPtr = nextPtr) {
-		/* Get the next link in the chain before calling
-		 * ApplyToTree.  This is because ApplyToTree may
-		 * delete the node and its link.  */
-		nextPtr = Blt_ChainNextLink(linkPtr);
-		treePtr = Blt_ChainGetValue(linkPtr);
+	    for (node = Blt_TreeFirstChild(rootPtr->node); node != NULL;
+		 node = next) {
+		/* Get the next node before calling ApplyToTree.  This
+		 * is because ApplyToTree may delete the node. */
+		next = Blt_TreeNextSibling(node);
+		treePtr = NodeToTree(hboxPtr, node);
 		if (ApplyToTree(hboxPtr, treePtr, proc, flags) != TCL_OK) {
 		    return TCL_ERROR;
 		}
@@ -1607,15 +1856,15 @@ DestroyEntry(entryPtr)
     register CachedImage *imagePtr;
 
     Tk_FreeOptions(entryConfigSpecs, (char *)entryPtr, hboxPtr->display, 0);
+    if (entryPtr->labelText != NULL) {
+	Blt_Free(entryPtr->labelText);
+    }
     if (entryPtr->labelGC != NULL) {
 	Tk_FreeGC(hboxPtr->display, entryPtr->labelGC);
     }
     if (entryPtr->dataGC != NULL) {
 	Tk_FreeGC(hboxPtr->display, entryPtr->dataGC);
     }
-    if (entryPtr->hashPtr != NULL) {
-	Blt_DeleteHashEntry(&(hboxPtr->nodeTable), entryPtr->hashPtr);
-    }
     if (entryPtr->dataShadow.color != NULL) {
 	Tk_FreeColor(entryPtr->dataShadow.color);
     }
@@ -1667,27 +1916,27 @@ LastNode(treePtr, mask)
     register Tree *treePtr;
     unsigned int mask;
 {
-    Blt_ChainLink *linkPtr;
+    Tree *prevPtr;
 
-    if (treePtr->parentPtr == NULL) {
+    if (ParentOf(treePtr) == NULL) {
 	return NULL;		/* The root is the first node. */
     }
-    linkPtr = Blt_ChainPrevLink(treePtr->linkPtr);
-    if (linkPtr == NULL) {
+    prevPtr = PrevSiblingOf(treePtr);
+    if (prevPtr == NULL) {
 	/* There are no siblings previous to this one, so pick the parent. */
-	return treePtr->parentPtr;
+	return ParentOf(treePtr);
     }
     /*
      * Traverse down the right-most thread, in order to select the
      * next entry.  Stop if we find a "closed" entry or reach a leaf.
      */
-    treePtr = Blt_ChainGetValue(linkPtr);
+    treePtr = prevPtr;
     while ((treePtr->entryPtr->flags & mask) == mask) {
-	linkPtr = Blt_ChainLastLink(treePtr->chainPtr);
-	if (linkPtr == NULL) {
+	prevPtr = LastChildOf(treePtr);
+	if (prevPtr == NULL) {
 	    break;		/* Found a leaf. */
 	}
-	treePtr = Blt_ChainGetValue(linkPtr);
+	treePtr = prevPtr;
     }
     return treePtr;
 }
@@ -1698,25 +1947,25 @@ NextNode(treePtr, mask)
     Tree *treePtr;
     unsigned int mask;
 {
-    Blt_ChainLink *linkPtr;
+    Tree *nextPtr;
 
     if ((treePtr->entryPtr->flags & mask) == mask) {
 	/* Pick the first sub-node. */
-	linkPtr = Blt_ChainFirstLink(treePtr->chainPtr);
-	if (linkPtr != NULL) {
-	    return Blt_ChainGetValue(linkPtr);
+	nextPtr = FirstChildOf(treePtr);
+	if (nextPtr != NULL) {
+	    return nextPtr;
 	}
     }
     /*
      * Back up until we can find a level where we can pick a "next" entry.
      * For the last entry we'll thread our way back to the root.
      */
-    while (treePtr->parentPtr != NULL) {
-	linkPtr = Blt_ChainNextLink(treePtr->linkPtr);
-	if (linkPtr != NULL) {
-	    return Blt_ChainGetValue(linkPtr);
+    while (ParentOf(treePtr) != NULL) {
+	nextPtr = NextSiblingOf(treePtr);
+	if (nextPtr != NULL) {
+	    return nextPtr;
 	}
-	treePtr = treePtr->parentPtr;
+	treePtr = ParentOf(treePtr);
     }
     return NULL;		/* At root, no next node. */
 }
@@ -1727,15 +1976,15 @@ EndNode(treePtr, mask)
     Tree *treePtr;
     unsigned int mask;
 {
-    Blt_ChainLink *linkPtr;
+    Tree *lastPtr;
 
-    linkPtr = Blt_ChainLastLink(treePtr->chainPtr);
-    while (linkPtr != NULL) {
-	treePtr = Blt_ChainGetValue(linkPtr);
+    lastPtr = LastChildOf(treePtr);
+    while (lastPtr != NULL) {
+	treePtr = lastPtr;
 	if ((treePtr->entryPtr->flags & mask) != mask) {
 	    break;
 	}
-	linkPtr = Blt_ChainLastLink(treePtr->chainPtr);
+	lastPtr = LastChildOf(treePtr);
     }
     return treePtr;
 }
@@ -1744,10 +1993,10 @@ static void
 ExposeAncestors(treePtr)
     register Tree *treePtr;
 {
-    treePtr = treePtr->parentPtr;
+    treePtr = ParentOf(treePtr);
     while (treePtr != NULL) {
 	treePtr->entryPtr->flags |= (ENTRY_OPEN | ENTRY_MAPPED);
-	treePtr = treePtr->parentPtr;
+	treePtr = ParentOf(treePtr);
     }
 }
 
@@ -1755,75 +2004,17 @@ static int
 IsBefore(t1Ptr, t2Ptr)
     register Tree *t1Ptr, *t2Ptr;
 {
-    int depth;
-    register int i;
-    Blt_ChainLink *linkPtr;
-    Tree *treePtr;
-
-    depth = MIN(t1Ptr->level, t2Ptr->level);
-
-    if (depth == 0) {		/* One of the nodes is root. */
-	if (t1Ptr->parentPtr == NULL) {
-	    return 1;
-	}
-	return 0;
-    }
-    /*
-     * Traverse back from the deepest node, until the both nodes are at the
-     * same depth.  Check if the ancestor node found is the other node.
-     */
-    for (i = t1Ptr->level; i > depth; i--) {
-	t1Ptr = t1Ptr->parentPtr;
-    }
-    if (t1Ptr == t2Ptr) {
-	return 0;
-    }
-    for (i = t2Ptr->level; i > depth; i--) {
-	t2Ptr = t2Ptr->parentPtr;
-    }
-    if (t2Ptr == t1Ptr) {
-	return 1;
-    }
-    /*
-     * First find the mutual ancestor of both nodes.  Look at each
-     * preceding ancestor level-by-level for both nodes.  Eventually
-     * we'll find a node that's the parent of both ancestors.  Then
-     * find the first ancestor in the parent's list of subnodes.
-     */
-    for (i = depth; i > 0; i--) {
-	if (t1Ptr->parentPtr == t2Ptr->parentPtr) {
-	    break;
-	}
-	t1Ptr = t1Ptr->parentPtr;
-	t2Ptr = t2Ptr->parentPtr;
-    }
-    for (linkPtr = Blt_ChainFirstLink(t1Ptr->parentPtr->chainPtr); linkPtr != NULL;
-	linkPtr = Blt_ChainNextLink(linkPtr)) {
-	treePtr = Blt_ChainGetValue(linkPtr);
-	if (treePtr == t1Ptr) {
-	    return 1;
-	} else if (treePtr == t2Ptr) {
-	    return 0;
-	}
-    }
-    assert(linkPtr != NULL);
-    return 0;
+    return Blt_TreeIsBefore(t1Ptr->node, t2Ptr->node);
 }
 
 static int
 IsAncestor(rootPtr, treePtr)
     Tree *rootPtr, *treePtr;
 {
-    if (treePtr != NULL) {
-	treePtr = treePtr->parentPtr;
-	while (treePtr != NULL) {
-	    if (treePtr == rootPtr) {
-		return 1;
-	    }
-	    treePtr = treePtr->parentPtr;
-	}
+    if (treePtr == NULL) {
+	return 0;
     }
-    return 0;
+    return Blt_TreeIsAncestor(rootPtr->node, treePtr->node);
 }
 
 static int
@@ -1836,13 +2027,13 @@ IsHidden(treePtr)
 	if (!(treePtr->entryPtr->flags & ENTRY_MAPPED)) {
 	    return TRUE;
 	}
-	treePtr = treePtr->parentPtr;
+	treePtr = ParentOf(treePtr);
 	mask = (ENTRY_OPEN | ENTRY_MAPPED);
 	while (treePtr != NULL) {
 	    if ((treePtr->entryPtr->flags & mask) != mask) {
 		return TRUE;
 	    }
-	    treePtr = treePtr->parentPtr;
+	    treePtr = ParentOf(treePtr);
 	}
     }
     return FALSE;
@@ -1944,15 +2135,23 @@ GetFullPath(treePtr, separator, resultPtr)
     char **nameArr;		/* Used the stack the component names. */
     register int i;
     int level;
+    Blt_TreeNode node;
 
-    level = treePtr->level;
+    level = LEVEL(treePtr);
     nameArr = Blt_Malloc((level + 1) * sizeof(char *));
     assert(nameArr);
-    for (i = level; i >= 0; i--) {
+    node = treePtr->node;
+    for (i = level; i > 0; i--) {
 	/* Save the name of each ancestor in the name array. */
-	nameArr[i] = treePtr->nameId;
-	treePtr = treePtr->parentPtr;
+	nameArr[i] = Blt_TreeNodeLabel(node);
+	node = Blt_TreeNodeParent(node);
     }
+    /* 
+     * The root is always named by the separator, whatever the label
+     * of the root node of the tree is.
+     */
+    nameArr[0] = ((separator == SEPARATOR_LIST) || 
+		  (separator == SEPARATOR_NONE)) ? "" : separator;
     Tcl_DStringInit(resultPtr);
     if ((separator == SEPARATOR_LIST) || (separator == SEPARATOR_NONE)) {
 	for (i = 0; i <= level; i++) {
@@ -1974,50 +2173,12 @@ GetFullPath(treePtr, separator, resultPtr)
     Blt_Free(nameArr);
 }
 
-static void
-InsertNode(parentPtr, position, nodePtr)
-    Tree *parentPtr;		/* Parent node where the new node will
-				 * be added. */
-    int position;		/* Position in the parent of the new node. */
-    Tree *nodePtr;		/* The node to be inserted. */
-{
-    Blt_ChainLink *linkPtr;
-
-    /*
-     * Create lists to contain subnodes as needed.  We don't want to
-     * unnecessarily allocate storage for leaves (of which there may
-     * be many).
-     */
-    if (parentPtr->chainPtr == NULL) {
-	parentPtr->chainPtr = Blt_ChainCreate();
-    }
-    linkPtr = Blt_ChainNewLink();
-    if (position == APPEND) {
-	Blt_ChainAppendLink(parentPtr->chainPtr, linkPtr);
-    } else {
-	Blt_ChainLink *beforePtr;
-
-	beforePtr = Blt_ChainGetNthLink(parentPtr->chainPtr, position);
-	Blt_ChainLinkBefore(parentPtr->chainPtr, linkPtr, beforePtr);
-    }
-    nodePtr->level = parentPtr->level + 1;
-    nodePtr->parentPtr = parentPtr;
-    nodePtr->linkPtr = linkPtr;
-    Blt_ChainSetValue(linkPtr, nodePtr);
-}
-
 static void
 DestroyNode(data)
     DestroyData data;
 {
     Tree *treePtr = (Tree *)data;
 
-    if (treePtr->nameId != NULL) {
-	Blt_FreeUid(treePtr->nameId);
-    }
-    if (treePtr->chainPtr != NULL) {
-	Blt_ChainDestroy(treePtr->chainPtr);
-    }
     if (treePtr->entryPtr != NULL) {
 	DestroyEntry(treePtr->entryPtr);
     }
@@ -2035,8 +2196,8 @@ DestroyNode(data)
  *
  * Results:
  *	Returns a pointer to the newly created node.  If an error
- *	occurred, such as the entry could not be configured, NULL
- *	is returned.
+ *	occurred, such as the tree object is read-only, NULL is
+ *	returned.
  *
  *----------------------------------------------------------------------
  */
@@ -2047,46 +2208,18 @@ CreateNode(hboxPtr, parentPtr, position, name)
     int position;		/* Position in node list to insert node. */
     char *name;			/* Name identifier for the new node. */
 {
-    Entry *entryPtr;
-    Tree *treePtr;
-    Blt_HashEntry *hPtr;
-    int isNew;
-    int serial;
-
-    /* Create the entry structure */
-    entryPtr = Blt_Calloc(1, sizeof(Entry));
-    assert(entryPtr);
-    entryPtr->flags |= (BUTTON_AUTO | ENTRY_MAPPED);
-    entryPtr->hboxPtr = hboxPtr;
+    Blt_TreeNode node;
 
     if (name == NULL) {
 	name = "";
     }
-    entryPtr->labelText = Blt_Strdup(name);
-
-    if (ConfigureEntry(hboxPtr, entryPtr, 0, (CONST char **)NULL, 0) != TCL_OK) {
-	DestroyEntry(entryPtr);
+    node = Blt_TreeCreateNode(hboxPtr->tree, parentPtr->node, name, position);
+    if (node == NULL) {
+	Tcl_AppendResult(hboxPtr->interp, "can't create node \"", name,
+	    "\" in tree \"", Blt_TreeName(hboxPtr->tree), "\"", (char *)NULL);
 	return NULL;
     }
-    /* Create the container structure too */
-    treePtr = Blt_Calloc(1, sizeof(Tree));
-    assert(treePtr);
-    treePtr->nameId = Blt_GetUid(name);
-    treePtr->entryPtr = entryPtr;
-
-    /* Generate a unique node serial number. */
-    do {
-	serial = hboxPtr->nextSerial++;
-	hPtr = Blt_CreateHashEntry(&(hboxPtr->nodeTable), (char *)(intptr_t)serial,
-	    &isNew);
-    } while (!isNew);
-    Blt_SetHashValue(hPtr, treePtr);
-    entryPtr->hashPtr = hPtr;
-
-    if (parentPtr != NULL) {
-	InsertNode(parentPtr, position, treePtr);
-    }
-    return treePtr;
+    return NodeToTree(hboxPtr, node);
 }
 
 /*
@@ -2107,23 +2240,13 @@ FindComponent(parentPtr, name)
     Tree *parentPtr;
     char *name;
 {
-    Blt_Uid nameId;
+    Blt_TreeNode node;
 
-    nameId = Blt_FindUid(name);
-    if (nameId != NULL) {
-	register Tree *treePtr;
-	Blt_ChainLink *linkPtr;
-
-	/* The component identifier must already exist if the node exists. */
-	for (linkPtr = Blt_ChainFirstLink(parentPtr->chainPtr); linkPtr != NULL;
-	    linkPtr = Blt_ChainNextLink(linkPtr)) {
-	    treePtr = Blt_ChainGetValue(linkPtr);
-	    if (nameId == treePtr->nameId) {
-		return treePtr;
-	    }
-	}
+    node = Blt_TreeFindChild(parentPtr->node, name);
+    if (node == NULL) {
+	return NULL;
     }
-    return NULL;
+    return NodeToTree(parentPtr->entryPtr->hboxPtr, node);
 }
 
 /*
@@ -2369,13 +2492,8 @@ GetNodeByIndex(hboxPtr, string)
     if (isdigit(UCHAR(string[0]))) {
 	int serial;
 
-	if (Tcl_GetInt(NULL, string, &serial) == TCL_OK) {
-	    Blt_HashEntry *hPtr;
-
-	    hPtr = Blt_FindHashEntry(&(hboxPtr->nodeTable), (char *)(intptr_t)serial);
-	    if (hPtr != NULL) {
-		return (Tree *) Blt_GetHashValue(hPtr);
-	    }
+	if ((Tcl_GetInt(NULL, string, &serial) == TCL_OK) && (serial >= 0)) {
+	    return NodeToTree(hboxPtr, Blt_TreeGetNode(hboxPtr->tree, serial));
 	}
     }
     return NULL;
@@ -2403,12 +2521,9 @@ NodeToString(hboxPtr, nodePtr)
     Tree *nodePtr;
 {
     static char string[200];
-    int serial;
 
-    /* Node table keys are integers.  Convert them to strings. */
-    serial = (intptr_t)Blt_GetHashKey(&(hboxPtr->nodeTable),
-	nodePtr->entryPtr->hashPtr);
-    sprintf(string, "%d", serial);
+    /* Node identifiers are the inodes of the tree nodes. */
+    sprintf(string, "%u", Blt_TreeNodeId(nodePtr->node));
 
     return string;
 }
@@ -2479,8 +2594,8 @@ GetNode(hboxPtr, string, treePtrPtr)
 	nodePtr = hboxPtr->rootPtr;
     } else if ((c == 'p') && (strcmp(string, "parent") == 0)) {
 	nodePtr = fromPtr;
-	if (nodePtr->parentPtr != NULL) {
-	    nodePtr = nodePtr->parentPtr;
+	if (ParentOf(nodePtr) != NULL) {
+	    nodePtr = ParentOf(nodePtr);
 	}
     } else if ((c == 'c') && (strcmp(string, "current") == 0)) {
 	/* Can't trust picked item, if entries have been added or deleted. */
@@ -2525,23 +2640,9 @@ GetNode(hboxPtr, string, treePtrPtr)
 	    }
 	}
     } else if ((c == 'n') && (strcmp(string, "nextsibling") == 0)) {
-	if (fromPtr->linkPtr != NULL) {
-	    Blt_ChainLink *linkPtr;
-
-	    linkPtr = Blt_ChainNextLink(fromPtr->linkPtr);
-	    if (linkPtr != NULL) {
-		nodePtr = Blt_ChainGetValue(linkPtr);
-	    }
-	}
+	nodePtr = NextSiblingOf(fromPtr);
     } else if ((c == 'p') && (strcmp(string, "prevsibling") == 0)) {
-	if (fromPtr->linkPtr != NULL) {
-	    Blt_ChainLink *linkPtr;
-
-	    linkPtr = Blt_ChainPrevLink(fromPtr->linkPtr);
-	    if (linkPtr != NULL) {
-		nodePtr = Blt_ChainGetValue(linkPtr);
-	    }
-	}
+	nodePtr = PrevSiblingOf(fromPtr);
     } else if ((c == 'v') && (strcmp(string, "view.top") == 0)) {
 	if (hboxPtr->nVisible > 0) {
 	    nodePtr = hboxPtr->visibleArr[0];
@@ -2658,7 +2759,7 @@ PercentSubst(hboxPtr, treePtr, command, resultPtr)
 		string = Tcl_DStringValue(&dString);
 		break;
 	    case 'p':		/* Name of the node */
-		string = treePtr->nameId;
+		string = NODENAME(treePtr);
 		break;
 	    case 'n':		/* Node identifier */
 		string = NodeToString(hboxPtr, treePtr);
@@ -2906,7 +3007,7 @@ GetSelectedLabels(hboxPtr, treePtr)
 	Tcl_DString *resultPtr = (Tcl_DString *) hboxPtr->clientData;
 	Entry *entryPtr = treePtr->entryPtr;
 
-	Tcl_DStringAppend(resultPtr, entryPtr->labelText, -1);
+	Tcl_DStringAppend(resultPtr, GETLABEL(entryPtr), -1);
 	Tcl_DStringAppend(resultPtr, "\n", -1);
     }
     return TCL_OK;
@@ -2932,7 +3033,7 @@ SizeOfNode(hboxPtr, treePtr)
 {
     int *sumPtr = (int *)&(hboxPtr->clientData);
 
-    *sumPtr += Blt_ChainGetLength(treePtr->chainPtr);
+    *sumPtr += Blt_TreeNodeDegree(treePtr->node);
     return TCL_OK;
 }
 
@@ -2941,8 +3042,9 @@ SizeOfNode(hboxPtr, treePtr)
  *
  * CompareNodesByName --
  *
- *	Comparison routine (used by qsort) to sort a chain of subnodes.
- *	A simple string comparison is performed on each node name.
+ *	Comparison routine (used by qsort) to sort the children of
+ *	a node.  A simple string comparison is performed on each node
+ *	name.
  *
  * Results:
  *	1 is the first is greater, -1 is the second is greater, 0
@@ -2951,14 +3053,10 @@ SizeOfNode(hboxPtr, treePtr)
  *----------------------------------------------------------------------
  */
 static int
-CompareNodesByName(link1PtrPtr, link2PtrPtr)
-    Blt_ChainLink **link1PtrPtr, **link2PtrPtr;
+CompareNodesByName(n1Ptr, n2Ptr)
+    Blt_TreeNode *n1Ptr, *n2Ptr;
 {
-    Tree *t1Ptr, *t2Ptr;
-
-    t1Ptr = Blt_ChainGetValue(*link1PtrPtr);
-    t2Ptr = Blt_ChainGetValue(*link2PtrPtr);
-    return strcmp(t1Ptr->nameId, t2Ptr->nameId);
+    return strcmp(Blt_TreeNodeLabel(*n1Ptr), Blt_TreeNodeLabel(*n2Ptr));
 }
 
 /*
@@ -2966,8 +3064,8 @@ CompareNodesByName(link1PtrPtr, link2PtrPtr)
  *
  * CompareNodesByTclCmd --
  *
- *	Comparison routine (used by qsort) to sort a list of subnodes.
- *	A specified Tcl proc is invoked to compare the nodes.
+ *	Comparison routine (used by qsort) to sort the children of
+ *	a node.  A specified Tcl proc is invoked to compare the nodes.
  *
  * Results:
  *	1 is the first is greater, -1 is the second is greater, 0
@@ -2976,22 +3074,22 @@ CompareNodesByName(link1PtrPtr, link2PtrPtr)
  *----------------------------------------------------------------------
  */
 static int
-CompareNodesByTclCmd(link1PtrPtr, link2PtrPtr)
-    Blt_ChainLink **link1PtrPtr, **link2PtrPtr;
+CompareNodesByTclCmd(n1Ptr, n2Ptr)
+    Blt_TreeNode *n1Ptr, *n2Ptr;
 {
     int result;
-    Tree *t1Ptr, *t2Ptr;
     Hierbox *hboxPtr = hierBox;
     Tcl_Interp *interp = hboxPtr->interp;
+    char string1[200], string2[200];
 
-    t1Ptr = Blt_ChainGetValue(*link1PtrPtr);
-    t2Ptr = Blt_ChainGetValue(*link2PtrPtr);
+    sprintf(string1, "%u", Blt_TreeNodeId(*n1Ptr));
+    sprintf(string2, "%u", Blt_TreeNodeId(*n2Ptr));
     result = 0;			/* Hopefully this will be Ok even if the
 				 * Tcl command fails to return the correct
 				 * result. */
     if ((Tcl_VarEval(interp, hboxPtr->sortCmd, " ",
-	Tk_PathName(hboxPtr->tkwin), " ", NodeToString(hboxPtr, t1Ptr), " ",
-	NodeToString(hboxPtr, t2Ptr)) != TCL_OK) ||
+	Tk_PathName(hboxPtr->tkwin), " ", string1, " ", string2, 
+	(char *)NULL) != TCL_OK) ||
 	(Tcl_GetInt(interp, Tcl_GetStringResult(interp), &result) != TCL_OK)) {
 	Tcl_BackgroundError(interp);
     }
@@ -3016,13 +3114,11 @@ SortNode(hboxPtr, treePtr)
     Hierbox *hboxPtr;
     Tree *treePtr;
 {
-    if (treePtr->chainPtr != NULL) {
-	if (hboxPtr->sortCmd != NULL) {
-	    hierBox = hboxPtr;
-	    Blt_ChainSort(treePtr->chainPtr, CompareNodesByTclCmd);
-	} else {
-	    Blt_ChainSort(treePtr->chainPtr, CompareNodesByName);
-	}
+    if (hboxPtr->sortCmd != NULL) {
+	hierBox = hboxPtr;
+	Blt_TreeSortNode(hboxPtr->tree, treePtr->node, CompareNodesByTclCmd);
+    } else {
+	Blt_TreeSortNode(hboxPtr->tree, treePtr->node, CompareNodesByName);
     }
     return TCL_OK;
 }
@@ -3075,13 +3171,13 @@ MapAncestors(hboxPtr, treePtr)
     /*
      * Make sure that all the ancestors of this node are mapped too.
      */
-    treePtr = treePtr->parentPtr;
+    treePtr = ParentOf(treePtr);
     while (treePtr != NULL) {
 	if (treePtr->entryPtr->flags & ENTRY_MAPPED) {
 	    break;		/* Assume ancestors are also mapped. */
 	}
 	treePtr->entryPtr->flags |= ENTRY_MAPPED;
-	treePtr = treePtr->parentPtr;
+	treePtr = ParentOf(treePtr);
     }
     return TCL_OK;
 }
@@ -3117,7 +3213,7 @@ FixUnmappedSelections(hboxPtr, treePtr)
 	DeselectEntry(hboxPtr, treePtr);
 	PruneSelection(hboxPtr, treePtr);
 	if (IsAncestor(treePtr, hboxPtr->focusPtr)) {
-	    hboxPtr->focusPtr = treePtr->parentPtr;
+	    hboxPtr->focusPtr = ParentOf(treePtr);
 	    if (hboxPtr->focusPtr == NULL) {
 		hboxPtr->focusPtr = hboxPtr->rootPtr;
 	    }
@@ -3128,54 +3224,97 @@ FixUnmappedSelections(hboxPtr, treePtr)
 }
 
 static int
-DeleteNode(hboxPtr, treePtr)
-    Hierbox *hboxPtr;		
+InSubtree(node, treePtr)
+    Blt_TreeNode node;
     Tree *treePtr;
 {
+    if ((treePtr == NULL) || (treePtr->node == NULL)) {
+	return FALSE;
+    }
+    return ((treePtr->node == node) || 
+	    (Blt_TreeIsAncestor(node, treePtr->node)));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeleteNode --
+ *
+ *	Called when a node of the tree is deleted.  Frees the record
+ *	of the node, if one was ever made.
+ *
+ *	The tree notifies the deletion of a node before those of its
+ *	descendants.  So the focus, active and anchor entries are
+ *	moved out of the whole subtree now, while it's still intact.
+ *
+ * Results:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+DeleteNode(hboxPtr, node)
+    Hierbox *hboxPtr;		
+    Blt_TreeNode node;
+{
+    Blt_HashEntry *hPtr;
+    Tree *treePtr;
+
+    if (node == Blt_TreeRootNode(hboxPtr->tree)) {
+	return;			/* The root stays. */
+    }
     /*
      * Indicate that the screen layout of the hierarchy may have changed
      * because the node was deleted.  We don't want to access the
      * hboxPtr->visibleArr array if one of the nodes is bogus.
      */
-    hboxPtr->flags |= HIERBOX_DIRTY;
-    if (treePtr == hboxPtr->activePtr) {
-	hboxPtr->activePtr = treePtr->parentPtr;
+    hboxPtr->flags |= (HIERBOX_DIRTY | HIERBOX_LAYOUT | HIERBOX_SCROLL);
+    EventuallyRedraw(hboxPtr);
+    if (InSubtree(node, hboxPtr->activePtr)) {
+	hboxPtr->activePtr = NodeToTree(hboxPtr, Blt_TreeNodeParent(node));
     }
-    if (treePtr == hboxPtr->activeButtonPtr) {
+    if (InSubtree(node, hboxPtr->activeButtonPtr)) {
 	hboxPtr->activeButtonPtr = NULL;
     }
-    if (treePtr == hboxPtr->focusPtr) {
-	hboxPtr->focusPtr = treePtr->parentPtr;
+    if (InSubtree(node, hboxPtr->focusPtr)) {
+	hboxPtr->focusPtr = NodeToTree(hboxPtr, Blt_TreeNodeParent(node));
 	Blt_SetFocusItem(hboxPtr->bindTable, hboxPtr->focusPtr, NULL);
     }
-    if (treePtr == hboxPtr->selAnchorPtr) {
+    if (InSubtree(node, hboxPtr->selAnchorPtr)) {
 	hboxPtr->selAnchorPtr = NULL;
     }
-    DeselectEntry(hboxPtr, treePtr);
-    PruneSelection(hboxPtr, treePtr);
-    if (treePtr->linkPtr != NULL) { /* Remove from parent's list */
-	Blt_ChainDeleteLink(treePtr->parentPtr->chainPtr, treePtr->linkPtr);
-	treePtr->linkPtr = NULL;
+    hPtr = Blt_FindHashEntry(&(hboxPtr->nodeTable), (char *)node);
+    if (hPtr == NULL) {
+	return;			/* The node was never visited. */
+    }
+    treePtr = (Tree *)Blt_GetHashValue(hPtr);
+    Blt_DeleteHashEntry(&(hboxPtr->nodeTable), hPtr);
+    if (IsSelected(hboxPtr, treePtr)) {
+	DeselectEntry(hboxPtr, treePtr);
+	EventuallyRedraw(hboxPtr);
+	if (hboxPtr->selectCmd != NULL) {
+	    EventuallyInvokeSelectCmd(hboxPtr);
+	}
     }
-    /* 
-     * Node may still be in use, so we can't free it right now.  We'll
-     * mark the parent as NULL and remove it from the parent's list of
-     * children. 
-     */
-    treePtr->parentPtr = NULL;	
     Blt_DeleteBindings(hboxPtr->bindTable, treePtr);
     Blt_DeleteBindings(hboxPtr->buttonBindTable, treePtr);
+    /* 
+     * The record may still be in use, so we can't free it right
+     * now.  Only the node is forgotten.
+     */
+    treePtr->node = NULL;
+    treePtr->hashPtr = NULL;
     Tcl_EventuallyFree(treePtr, DestroyNode);
-    return TCL_OK;
 }
 
-
 /*
  *----------------------------------------------------------------------
  *
  * DestroyTree --
  *
- *	Recursively deletes the given node and all its subnodes.
+ *	Deletes the given node and all its subnodes from the tree.
+ *	The records of the nodes are freed as the tree notifies the
+ *	deletions.
  *
  * Results:
  *	If successful, returns TCL_OK.  Otherwise TCL_ERROR is
@@ -3188,7 +3327,174 @@ DestroyTree(hboxPtr, treePtr)
     Hierbox *hboxPtr;
     Tree *treePtr;
 {
-    return ApplyToTree(hboxPtr, treePtr, DeleteNode, APPLY_RECURSE);
+    return Blt_TreeDeleteNode(hboxPtr->tree, treePtr->node);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TreeEventProc --
+ *
+ *	Called for changes made to the tree object, either by the
+ *	widget itself or by other clients of the tree.  Records of
+ *	new nodes are made when the nodes are first viewed.
+ *
+ * Results:
+ *	Always returns TCL_OK.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+TreeEventProc(clientData, eventPtr)
+    ClientData clientData;
+    Blt_TreeNotifyEvent *eventPtr;
+{
+    Hierbox *hboxPtr = clientData;
+    Blt_TreeNode node;
+    Blt_HashEntry *hPtr;
+
+    node = Blt_TreeGetNode(eventPtr->tree, eventPtr->inode);
+    switch (eventPtr->type) {
+    case TREE_NOTIFY_DELETE:
+	if (node != NULL) {
+	    DeleteNode(hboxPtr, node);
+	}
+	return TCL_OK;
+
+    case TREE_NOTIFY_RELABEL:
+	/* Remeasure the entry if it shows the label of the node. */
+	if (node != NULL) {
+	    hPtr = Blt_FindHashEntry(&(hboxPtr->nodeTable), (char *)node);
+	    if (hPtr != NULL) {
+		Tree *treePtr = Blt_GetHashValue(hPtr);
+
+		treePtr->entryPtr->flags |= ENTRY_DIRTY;
+	    }
+	}
+	break;
+
+    case TREE_NOTIFY_BATCH:
+	/* The children of the node were relabeled, moved or sorted. */
+	if (node != NULL) {
+	    Blt_TreeNode child;
+
+	    for (child = Blt_TreeFirstChild(node); child != NULL;
+		 child = Blt_TreeNextSibling(child)) {
+		hPtr = Blt_FindHashEntry(&(hboxPtr->nodeTable), (char *)child);
+		if (hPtr != NULL) {
+		    Tree *treePtr = Blt_GetHashValue(hPtr);
+
+		    treePtr->entryPtr->flags |= ENTRY_DIRTY;
+		}
+	    }
+	}
+	break;
+
+    case TREE_NOTIFY_CREATE:
+    case TREE_NOTIFY_MOVE:
+    case TREE_NOTIFY_SORT:
+	break;
+
+    default:
+	return TCL_OK;
+    }
+    hboxPtr->flags |= (HIERBOX_DIRTY | HIERBOX_LAYOUT | HIERBOX_SCROLL);
+    EventuallyRedraw(hboxPtr);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DetachTree --
+ *
+ *	Releases the tree object used by the widget, freeing the
+ *	records of its nodes.  The nodes themselves are left alone:
+ *	the tree may be used by others.
+ *
+ * Results:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+DetachTree(hboxPtr)
+    Hierbox *hboxPtr;
+{
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
+    Tree *treePtr;
+
+    if (hboxPtr->tree == NULL) {
+	return;
+    }
+    Blt_TreeDeleteEventHandler(hboxPtr->tree, 
+	TREE_NOTIFY_ALL | TREE_NOTIFY_BATCH, TreeEventProc, hboxPtr);
+    for (hPtr = Blt_FirstHashEntry(&(hboxPtr->nodeTable), &cursor);
+	 hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	treePtr = Blt_GetHashValue(hPtr);
+	Blt_DeleteBindings(hboxPtr->bindTable, treePtr);
+	Blt_DeleteBindings(hboxPtr->buttonBindTable, treePtr);
+	treePtr->node = NULL;
+	treePtr->hashPtr = NULL;
+	Tcl_EventuallyFree(treePtr, DestroyNode);
+    }
+    Blt_DeleteHashTable(&(hboxPtr->nodeTable));
+    Blt_InitHashTable(&(hboxPtr->nodeTable), BLT_ONE_WORD_KEYS);
+    Blt_DeleteHashTable(&(hboxPtr->selectTable));
+    Blt_InitHashTable(&(hboxPtr->selectTable), BLT_ONE_WORD_KEYS);
+    Blt_ChainReset(&(hboxPtr->selectChain));
+    hboxPtr->rootPtr = hboxPtr->focusPtr = hboxPtr->activePtr = NULL;
+    hboxPtr->activeButtonPtr = hboxPtr->selAnchorPtr = NULL;
+    hboxPtr->nVisible = 0;
+    Blt_TreeReleaseToken(hboxPtr->tree);
+    hboxPtr->tree = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AttachTree --
+ *
+ *	Displays the given tree object in the widget, releasing the
+ *	one previously used.  If no tree is given, a new one is
+ *	created, whose root is named like the widget's root has
+ *	always been: by the separator.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+AttachTree(hboxPtr, tree)
+    Hierbox *hboxPtr;
+    Blt_Tree tree;
+{
+    Tree *rootPtr;
+
+    if (tree == NULL) {
+	char *name;
+
+	if (Blt_TreeCreate(hboxPtr->interp, (char *)NULL, &tree) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	name = hboxPtr->separator;
+	if ((name == SEPARATOR_LIST) || (name == SEPARATOR_NONE)) {
+	    name = "";
+	}
+	Blt_TreeRelabelNode(tree, Blt_TreeRootNode(tree), name);
+    }
+    DetachTree(hboxPtr);
+    hboxPtr->tree = tree;
+    Blt_TreeCreateEventHandler(tree, TREE_NOTIFY_ALL | TREE_NOTIFY_BATCH, 
+	TreeEventProc, hboxPtr);
+    rootPtr = NodeToTree(hboxPtr, Blt_TreeRootNode(tree));
+    hboxPtr->rootPtr = hboxPtr->focusPtr = rootPtr;
+    Blt_SetFocusItem(hboxPtr->bindTable, hboxPtr->focusPtr, NULL);
+    hboxPtr->flags |= (HIERBOX_DIRTY | HIERBOX_LAYOUT | HIERBOX_SCROLL);
+    EventuallyRedraw(hboxPtr);
+    return TCL_OK;
 }
 
 /*ARGSUSED*/
@@ -3311,6 +3617,40 @@ ConfigureEntry(hboxPtr, entryPtr, argc, argv, flags)
     int argc;
     CONST char **argv;
     int flags;
+{
+    hierBox = hboxPtr;
+    if (Blt_ConfigureWidget(hboxPtr->interp, hboxPtr->tkwin, entryConfigSpecs,
+	    argc, argv, (char *)entryPtr, flags) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    /* 
+     * The GCs and the size of the entry are recomputed by the next
+     * layout, only if the entry is laid out at all.
+     */
+    entryPtr->flags |= ENTRY_DIRTY;
+    hboxPtr->flags |= HIERBOX_LAYOUT;
+    EventuallyRedraw(hboxPtr);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetEntryExtents --
+ *
+ *	Computes the GCs and the dimensions of an entry that was
+ *	configured, or whose node was relabeled, since it was last
+ *	laid out.
+ *
+ * Results:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+GetEntryExtents(hboxPtr, entryPtr)
+    Hierbox *hboxPtr;
+    Entry *entryPtr;
 {
     GC newGC;
     XGCValues gcValues;
@@ -3319,12 +3659,8 @@ ConfigureEntry(hboxPtr, entryPtr, argc, argv, flags)
     int width, height;
     Tk_Font font;
     XColor *colorPtr;
+    char *label;
 
-    hierBox = hboxPtr;
-    if (Blt_ConfigureWidget(hboxPtr->interp, hboxPtr->tkwin, entryConfigSpecs,
-	    argc, argv, (char *)entryPtr, flags) != TCL_OK) {
-	return TCL_ERROR;
-    }
     entryPtr->iconWidth = entryPtr->iconHeight = 0;
     if (entryPtr->icons != NULL) {
 	register int i;
@@ -3371,7 +3707,8 @@ ConfigureEntry(hboxPtr, entryPtr, argc, argv, flags)
     }
     entryPtr->labelGC = newGC;
 
-    if (*entryPtr->labelText == '\0') {
+    label = GETLABEL(entryPtr);
+    if (*label == '\0') {
 	Tk_FontMetrics fontMetrics;
 
 	Tk_GetFontMetrics(font, &fontMetrics);
@@ -3382,7 +3719,7 @@ ConfigureEntry(hboxPtr, entryPtr, argc, argv, flags)
 	Blt_InitTextStyle(&ts);
 	ts.shadow.offset = entryPtr->labelShadow.offset;
 	ts.font = font;
-	Blt_GetTextExtents(&ts, entryPtr->labelText, &width, &height);
+	Blt_GetTextExtents(&ts, label, &width, &height);
     }
     width += 2 * (FOCUS_WIDTH + LABEL_PADX + hboxPtr->selBorderWidth);
     height += 2 * (FOCUS_WIDTH + LABEL_PADY + hboxPtr->selBorderWidth);
@@ -3440,9 +3777,7 @@ ConfigureEntry(hboxPtr, entryPtr, argc, argv, flags)
     if (entryPtr->height & 0x01) {
 	entryPtr->height++;
     }
-    hboxPtr->flags |= HIERBOX_LAYOUT;
-    EventuallyRedraw(hboxPtr);
-    return TCL_OK;
+    entryPtr->flags &= ~ENTRY_DIRTY;
 }
 
 /*
@@ -3660,7 +3995,7 @@ DestroyHierbox(dataPtr)
     if (buttonPtr->lineGC != NULL) {
 	Tk_FreeGC(hboxPtr->display, buttonPtr->lineGC);
     }
-    DestroyTree(hboxPtr, hboxPtr->rootPtr);
+    DetachTree(hboxPtr);
     Blt_DeleteHashTable(&(hboxPtr->nodeTable));
     Blt_ChainReset(&(hboxPtr->selectChain));
     Blt_DeleteHashTable(&(hboxPtr->selectTable));
@@ -3792,7 +4127,7 @@ SelectionProc(clientData, offset, buffer, maxBytes)
 	for (linkPtr = Blt_ChainFirstLink(&(hboxPtr->selectChain)); 
 	     linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
 	    treePtr = Blt_ChainGetValue(linkPtr);
-	    Tcl_DStringAppend(&dString, treePtr->entryPtr->labelText, -1);
+	    Tcl_DStringAppend(&dString, GETLABEL(treePtr->entryPtr), -1);
 	    Tcl_DStringAppend(&dString, "\n", -1);
 	}
     }
@@ -3939,6 +4274,9 @@ ConfigureHierbox(interp, hboxPtr, argc, argv, flags)
 	    (char *)hboxPtr, flags) != TCL_OK) {
 	return TCL_ERROR;
     }
+    if ((hboxPtr->tree == NULL) && (AttachTree(hboxPtr, NULL) != TCL_OK)) {
+	return TCL_ERROR;
+    }
     if (Blt_ConfigModified(configSpecs, interp, "-font", "-linespacing", "-width",
 	    "-height", "-hideroot", (char *)NULL)) {
 	/*
@@ -3947,6 +4285,19 @@ ConfigureHierbox(interp, hboxPtr, argc, argv, flags)
 	 */
 	hboxPtr->flags |= (HIERBOX_LAYOUT | HIERBOX_SCROLL);
     }
+    if (Blt_ConfigModified(configSpecs, interp, "-font", "-foreground",
+	    "-linespacing", "-selectborderwidth", (char *)NULL)) {
+	Blt_HashEntry *hPtr;
+	Blt_HashSearch cursor;
+	Tree *treePtr;
+
+	/* Entries inherit these, so they must all be measured again. */
+	for (hPtr = Blt_FirstHashEntry(&(hboxPtr->nodeTable), &cursor);
+	     hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	    treePtr = Blt_GetHashValue(hPtr);
+	    treePtr->entryPtr->flags |= ENTRY_DIRTY;
+	}
+    }
     if ((hboxPtr->reqHeight != Tk_ReqHeight(hboxPtr->tkwin)) ||
 	(hboxPtr->reqWidth != Tk_ReqWidth(hboxPtr->tkwin))) {
 	Tk_GeometryRequest(hboxPtr->tkwin, hboxPtr->reqWidth,
@@ -4064,12 +4415,14 @@ ResetCoordinates(hboxPtr, treePtr, infoPtr)
     if (!(entryPtr->flags & ENTRY_MAPPED)) {
 	return;
     }
-    treePtr->level = infoPtr->level;
+    if (entryPtr->flags & ENTRY_DIRTY) {
+	GetEntryExtents(hboxPtr, entryPtr);
+    }
     if (infoPtr->depth < infoPtr->level) {
 	infoPtr->depth = infoPtr->level;
     }
     if ((entryPtr->flags & BUTTON_SHOW) || ((entryPtr->flags & BUTTON_AUTO) &&
-	    (Blt_ChainGetLength(treePtr->chainPtr) > 0))) {
+	    (Blt_TreeNodeDegree(treePtr->node) > 0))) {
 	entryPtr->flags |= ENTRY_BUTTON;
     } else {
 	entryPtr->flags &= ~ENTRY_BUTTON;
@@ -4093,7 +4446,7 @@ ResetCoordinates(hboxPtr, treePtr, infoPtr)
     entryPtr->lineHeight = -(infoPtr->y);
     infoPtr->y += entryPtr->height;
     if (entryPtr->flags & ENTRY_OPEN) {
-	Blt_ChainLink *linkPtr;
+	Tree *childPtr;
 	int labelOffset;
 	Tree *bottomPtr;
 
@@ -4101,12 +4454,11 @@ ResetCoordinates(hboxPtr, treePtr, infoPtr)
 	labelOffset = infoPtr->labelOffset;
 	infoPtr->labelOffset = 0;
 	bottomPtr = treePtr;
-	for (linkPtr = Blt_ChainFirstLink(treePtr->chainPtr); linkPtr != NULL;
-	    linkPtr = Blt_ChainNextLink(linkPtr)) {
-	    treePtr = Blt_ChainGetValue(linkPtr);
-	    if (treePtr->entryPtr->flags & ENTRY_MAPPED) {
-		ResetCoordinates(hboxPtr, treePtr, infoPtr);
-		bottomPtr = treePtr;
+	for (childPtr = FirstChildOf(treePtr); childPtr != NULL;
+	    childPtr = NextSiblingOf(childPtr)) {
+	    if (childPtr->entryPtr->flags & ENTRY_MAPPED) {
+		ResetCoordinates(hboxPtr, childPtr, infoPtr);
+		bottomPtr = childPtr;
 	    }
 	}
 	infoPtr->level--;
@@ -4144,17 +4496,16 @@ ComputeWidths(hboxPtr, treePtr)
     if (!(entryPtr->flags & ENTRY_MAPPED)) {
 	return;
     }
-    if (entryPtr->iconWidth > LEVELWIDTH(treePtr->level + 1)) {
-	LEVELWIDTH(treePtr->level + 1) = entryPtr->iconWidth;
+    if (entryPtr->iconWidth > LEVELWIDTH(LEVEL(treePtr) + 1)) {
+	LEVELWIDTH(LEVEL(treePtr) + 1) = entryPtr->iconWidth;
     }
     if (entryPtr->flags & ENTRY_OPEN) {
-	Blt_ChainLink *linkPtr;
+	Tree *childPtr;
 
-	for (linkPtr = Blt_ChainFirstLink(treePtr->chainPtr); linkPtr != NULL;
-	    linkPtr = Blt_ChainNextLink(linkPtr)) {
-	    treePtr = Blt_ChainGetValue(linkPtr);
-	    if (treePtr->entryPtr->flags & ENTRY_MAPPED) {
-		ComputeWidths(hboxPtr, treePtr);
+	for (childPtr = FirstChildOf(treePtr); childPtr != NULL;
+	    childPtr = NextSiblingOf(childPtr)) {
+	    if (childPtr->entryPtr->flags & ENTRY_MAPPED) {
+		ComputeWidths(hboxPtr, childPtr);
 	    }
 	}
     }
@@ -4262,7 +4613,7 @@ ComputeVisibleEntries(hboxPtr)
 {
     Entry *entryPtr;
     int height;
-    Blt_ChainLink *linkPtr;
+    Tree *childPtr;
     register Tree *treePtr;
     int x, maxX;
     int nSlots;
@@ -4288,13 +4639,12 @@ ComputeVisibleEntries(hboxPtr)
     treePtr = hboxPtr->rootPtr;
     entryPtr = treePtr->entryPtr;
     while ((entryPtr->worldY + entryPtr->height) <= hboxPtr->yOffset) {
-	for (linkPtr = Blt_ChainLastLink(treePtr->chainPtr); linkPtr != NULL;
-	    linkPtr = Blt_ChainPrevLink(linkPtr)) {
-	    treePtr = Blt_ChainGetValue(linkPtr);
-	    if (IsHidden(treePtr)) {
+	for (childPtr = LastChildOf(treePtr); childPtr != NULL;
+	    childPtr = PrevSiblingOf(childPtr)) {
+	    if (IsHidden(childPtr)) {
 		continue;	/* Ignore hidden entries.  */
 	    }
-	    entryPtr = treePtr->entryPtr;
+	    entryPtr = childPtr->entryPtr;
 	    if (entryPtr->worldY <= hboxPtr->yOffset) {
 		break;
 	    }
@@ -4305,13 +4655,16 @@ ComputeVisibleEntries(hboxPtr)
 	 * scrolled down, but some nodes were deleted.  Reset the view
          * back to the top and try again.
          */
-	if (linkPtr == NULL) {
+	if (childPtr == NULL) {
 	    if (hboxPtr->yOffset == 0) {
 		return TCL_OK;	/* All entries are hidden. */
 	    }
 	    hboxPtr->yOffset = 0;
+	    treePtr = hboxPtr->rootPtr;
+	    entryPtr = treePtr->entryPtr;
 	    continue;
 	}
+	treePtr = childPtr;
     }
 
     height += hboxPtr->yOffset;
@@ -4323,9 +4676,9 @@ ComputeVisibleEntries(hboxPtr)
 	     * Compute and save the entry's X-coordinate now that we know
 	     * what the maximum level offset for the entire Hierbox is.
 	     */
-	    entryPtr->worldX = LEVELX(treePtr->level);
-	    x = entryPtr->worldX + LEVELWIDTH(treePtr->level) +
-		LEVELWIDTH(treePtr->level + 1) + entryPtr->width;
+	    entryPtr->worldX = LEVELX(LEVEL(treePtr));
+	    x = entryPtr->worldX + LEVELWIDTH(LEVEL(treePtr)) +
+		LEVELWIDTH(LEVEL(treePtr) + 1) + entryPtr->width;
 	    if (x > maxX) {
 		maxX = x;
 	    }
@@ -4389,7 +4742,7 @@ GetCursorLocation(hboxPtr, treePtr)
     ts.font = font;
     ts.justify = TK_JUSTIFY_LEFT;
     ts.shadow.offset = entryPtr->labelShadow.offset;
-    textPtr = Blt_GetTextLayout(entryPtr->labelText, &ts);
+    textPtr = Blt_GetTextLayout(GETLABEL(entryPtr), &ts);
 
     Tk_GetFontMetrics(font, &fontMetrics);
     maxLines = (textPtr->height / fontMetrics.linespace) - 1;
@@ -4447,8 +4800,8 @@ DrawVerticals(hboxPtr, treePtr, drawable)
     int height;
     int x, y;
 
-    while (treePtr->parentPtr != NULL) {
-	treePtr = treePtr->parentPtr;
+    while (ParentOf(treePtr) != NULL) {
+	treePtr = ParentOf(treePtr);
 	entryPtr = treePtr->entryPtr;
 
 	/*
@@ -4456,13 +4809,13 @@ DrawVerticals(hboxPtr, treePtr, drawable)
 	 * the current view port.  So for each of the off-screen ancestor
 	 * nodes we must compute it here too.
 	 */
-	entryPtr->worldX = LEVELX(treePtr->level);
+	entryPtr->worldX = LEVELX(LEVEL(treePtr));
 	x = SCREENX(hboxPtr, entryPtr->worldX);
 	y = SCREENY(hboxPtr, entryPtr->worldY);
 	height = MAX(entryPtr->iconHeight, hboxPtr->button.height);
 	y += (height - hboxPtr->button.height) / 2;
-	x1 = x2 = x + LEVELWIDTH(treePtr->level) +
-	    LEVELWIDTH(treePtr->level + 1) / 2;
+	x1 = x2 = x + LEVELWIDTH(LEVEL(treePtr)) +
+	    LEVELWIDTH(LEVEL(treePtr) + 1) / 2;
 	y1i = y + hboxPtr->button.height / 2;
 	y2 = y1i + entryPtr->lineHeight;
 	if ((treePtr == hboxPtr->rootPtr) && (hboxPtr->hideRoot)) {
@@ -4542,7 +4895,7 @@ DrawButton(hboxPtr, treePtr, drawable)
 
     entryPtr = treePtr->entryPtr;
 
-    width = LEVELWIDTH(treePtr->level);
+    width = LEVELWIDTH(LEVEL(treePtr));
     height = MAX(entryPtr->iconHeight, buttonPtr->height);
     entryPtr->buttonX = (width - buttonPtr->width) / 2;
     entryPtr->buttonY = (height - buttonPtr->height) / 2;
@@ -4655,7 +5008,7 @@ DisplayIcon(hboxPtr, treePtr, x, y, drawable)
 
 	height = ImageHeight(image);
 	width = ImageWidth(image);
-	x += (LEVELWIDTH(treePtr->level + 1) - width) / 2;
+	x += (LEVELWIDTH(LEVEL(treePtr) + 1) - width) / 2;
 	y += (entryHeight - height) / 2;
 	inset = hboxPtr->inset - INSET_PAD;
 	maxY = Tk_Height(hboxPtr->tkwin) - inset;
@@ -4670,7 +5023,7 @@ DisplayIcon(hboxPtr, treePtr, x, y, drawable)
 	}
 	Tk_RedrawImage(ImageBits(image), 0, top, width, height, drawable, x, y);
     } else {
-	x += (LEVELWIDTH(treePtr->level + 1) - DEF_ICON_WIDTH) / 2;
+	x += (LEVELWIDTH(LEVEL(treePtr) + 1) - DEF_ICON_WIDTH) / 2;
 	y += (entryHeight - DEF_ICON_HEIGHT) / 2;
 	XSetClipOrigin(hboxPtr->display, entryPtr->iconGC, x, y);
 	XCopyPlane(hboxPtr->display, hboxPtr->iconBitmap, drawable,
@@ -4776,7 +5129,7 @@ DrawLabel(hboxPtr, treePtr, x, y, drawable)
     x += LABEL_PADX + hboxPtr->selBorderWidth;
     y += LABEL_PADY + hboxPtr->selBorderWidth;
 
-    if (*entryPtr->labelText != '\0') {
+    if (*GETLABEL(entryPtr) != '\0') {
 	XColor *normalColor;
 
 	normalColor = GETCOLOR(hboxPtr, entryPtr->labelColor);
@@ -4784,7 +5137,7 @@ DrawLabel(hboxPtr, treePtr, x, y, drawable)
 	    hboxPtr->selFgColor, entryPtr->labelShadow.color, 0.0, TK_ANCHOR_NW,
 	    TK_JUSTIFY_LEFT, 0, entryPtr->labelShadow.offset);
 	ts.state = (isSelected) ? STATE_ACTIVE : 0;
-	Blt_DrawText(hboxPtr->tkwin, drawable, entryPtr->labelText, &ts,
+	Blt_DrawText(hboxPtr->tkwin, drawable, GETLABEL(entryPtr), &ts,
 	    x, y);
     }
     if ((isFocused) && (hboxPtr->focusEdit) && (editPtr->cursorOn)) {
@@ -4866,7 +5219,7 @@ DrawEntry(hboxPtr, treePtr, drawable)
     x = SCREENX(hboxPtr, entryPtr->worldX);
     y = SCREENY(hboxPtr, entryPtr->worldY);
 
-    width = LEVELWIDTH(treePtr->level);
+    width = LEVELWIDTH(LEVEL(treePtr));
     height = MAX(entryPtr->iconHeight, buttonPtr->height);
 
     entryPtr->buttonX = (width - buttonPtr->width) / 2;
@@ -4876,9 +5229,9 @@ DrawEntry(hboxPtr, treePtr, drawable)
 
     x1 = x + (width / 2);
     y1i = y2 = buttonY + (buttonPtr->height / 2);
-    x2 = x1 + (LEVELWIDTH(treePtr->level) + LEVELWIDTH(treePtr->level + 1)) / 2;
+    x2 = x1 + (LEVELWIDTH(LEVEL(treePtr)) + LEVELWIDTH(LEVEL(treePtr) + 1)) / 2;
 
-    if ((treePtr->parentPtr != NULL) && (hboxPtr->lineWidth > 0)) {
+    if ((ParentOf(treePtr) != NULL) && (hboxPtr->lineWidth > 0)) {
 	/*
 	 * For every node except root, draw a horizontal line from
 	 * the vertical bar to the middle of the icon.
@@ -4895,7 +5248,7 @@ DrawEntry(hboxPtr, treePtr, drawable)
 	}
 	XDrawLine(hboxPtr->display, drawable, hboxPtr->lineGC, x2, y1i, x2, y2);
     }
-    if ((entryPtr->flags & ENTRY_BUTTON) && (treePtr->parentPtr != NULL)) {
+    if ((entryPtr->flags & ENTRY_BUTTON) && (ParentOf(treePtr) != NULL)) {
 	/*
 	 * Except for root, draw a button for every entry that needs
 	 * one.  The displayed button can be either a Tk image or a
@@ -4903,15 +5256,15 @@ DrawEntry(hboxPtr, treePtr, drawable)
 	 */
 	DrawButton(hboxPtr, treePtr, drawable);
     }
-    x += LEVELWIDTH(treePtr->level);
+    x += LEVELWIDTH(LEVEL(treePtr));
     DisplayIcon(hboxPtr, treePtr, x, y, drawable);
 
-    x += LEVELWIDTH(treePtr->level + 1) + 4;
+    x += LEVELWIDTH(LEVEL(treePtr) + 1) + 4;
 
     /* Entry label. */
     entryHeight = DrawLabel(hboxPtr, treePtr, x, y, drawable);
-    if (treePtr->parentPtr != NULL) {
-	x += treePtr->parentPtr->entryPtr->levelX + LABEL_PADX;
+    if (ParentOf(treePtr) != NULL) {
+	x += ParentOf(treePtr)->entryPtr->levelX + LABEL_PADX;
     } else {
 	x += width + entryPtr->labelWidth + LABEL_PADX;
     }
@@ -5160,16 +5513,10 @@ HierboxCmd(clientData, interp, argc, argv)
 	    buttonConfigSpecs, 0, (char **)NULL, (char *)hboxPtr, 0) != TCL_OK) {
 	goto error;
     }
+    /* The root entry is created when the tree is attached. */
     if (ConfigureHierbox(interp, hboxPtr, argc - 2, argv + 2, 0) != TCL_OK) {
 	goto error;
     }
-    treePtr = CreateNode(hboxPtr, (Tree *) NULL, APPEND, hboxPtr->separator);
-    if (treePtr == NULL) {
-	goto error;
-    }
-    hboxPtr->rootPtr = hboxPtr->focusPtr = treePtr;
-    hboxPtr->selAnchorPtr = NULL;
-    Blt_SetFocusItem(hboxPtr->bindTable, hboxPtr->focusPtr, NULL);
 
     Tk_CreateSelHandler(tkwin, XA_PRIMARY, XA_STRING, SelectionProc, hboxPtr, 
 	XA_STRING);
@@ -5206,7 +5553,9 @@ HierboxCmd(clientData, interp, argc, argv)
 	!= TCL_OK) {
 	goto error;
     }
-    treePtr->entryPtr->flags = (ENTRY_MAPPED);
+    treePtr = hboxPtr->rootPtr;
+    treePtr->entryPtr->flags &= ENTRY_DIRTY;
+    treePtr->entryPtr->flags |= ENTRY_MAPPED;
     if (OpenNode(hboxPtr, treePtr) != TCL_OK) {
 	goto error;
     }
@@ -5247,7 +5596,7 @@ FocusOp(hboxPtr, interp, argc, argv)
 	    }
 	    hboxPtr->flags |= (HIERBOX_LAYOUT | HIERBOX_SCROLL);
 	    hboxPtr->focusPtr = treePtr;
-	    hboxPtr->labelEdit.insertPos = strlen(treePtr->entryPtr->labelText);
+	    hboxPtr->labelEdit.insertPos = strlen(GETLABEL(treePtr->entryPtr));
 	}
 	EventuallyRedraw(hboxPtr);
     }
@@ -5329,9 +5678,9 @@ BboxOp(hboxPtr, interp, argc, argv)
 	    top = entryPtr->worldY;
 	}
 	if (right <
-	    (entryPtr->worldX + entryPtr->width + LEVELWIDTH(treePtr->level))) {
+	    (entryPtr->worldX + entryPtr->width + LEVELWIDTH(LEVEL(treePtr)))) {
 	    right = (entryPtr->worldX + entryPtr->width +
-		LEVELWIDTH(treePtr->level));
+		LEVELWIDTH(LEVEL(treePtr)));
 	}
 	if (left > entryPtr->worldX) {
 	    left = entryPtr->worldX;
@@ -5930,7 +6279,7 @@ ScreenToIndex(hboxPtr, x, y)
     treePtr = hboxPtr->focusPtr;
     entryPtr = treePtr->entryPtr;
 
-    if (*entryPtr->labelText == '\0') {
+    if (*GETLABEL(entryPtr) == '\0') {
 	return 0;
     }
     /*
@@ -5941,14 +6290,14 @@ ScreenToIndex(hboxPtr, x, y)
 	hboxPtr->selBorderWidth;
     y -= SCREENY(hboxPtr, entryPtr->worldY) + LABEL_PADY +
 	hboxPtr->selBorderWidth;
-    x -= LEVELWIDTH(treePtr->level) + LEVELWIDTH(treePtr->level + 1) + 4;
+    x -= LEVELWIDTH(LEVEL(treePtr)) + LEVELWIDTH(LEVEL(treePtr) + 1) + 4;
 
     font = GETFONT(hboxPtr, entryPtr->labelFont);
     memset(&ts, 0, sizeof(TextStyle));
     ts.font = font;
     ts.justify = TK_JUSTIFY_LEFT;
     ts.shadow.offset = entryPtr->labelShadow.offset;
-    textPtr = Blt_GetTextLayout(entryPtr->labelText, &ts);
+    textPtr = Blt_GetTextLayout(GETLABEL(entryPtr), &ts);
 
     if (y < 0) {
 	y = 0;
@@ -6033,7 +6382,7 @@ GetLabelIndex(hboxPtr, entryPtr, string, indexPtr)
     if ((c == 'a') && (strcmp(string, "anchor") == 0)) {
 	*indexPtr = editPtr->selAnchor;
     } else if ((c == 'e') && (strcmp(string, "end") == 0)) {
-	*indexPtr = strlen(entryPtr->labelText);
+	*indexPtr = strlen(GETLABEL(entryPtr));
     } else if ((c == 'i') && (strcmp(string, "insert") == 0)) {
 	*indexPtr = editPtr->insertPos;
     } else if ((c == 's') && (strcmp(string, "sel.first") == 0)) {
@@ -6063,14 +6412,14 @@ GetLabelIndex(hboxPtr, entryPtr, string, indexPtr)
 	    return TCL_ERROR;
 	}
 	/* Don't allow the index to point outside the label. */
-	maxChars = Tcl_NumUtfChars(entryPtr->labelText, -1);
+	maxChars = Tcl_NumUtfChars(GETLABEL(entryPtr), -1);
 	if (number < 0) {
 	    *indexPtr = 0;
 	} else if (number > maxChars) {
-	    *indexPtr = strlen(entryPtr->labelText);
+	    *indexPtr = strlen(GETLABEL(entryPtr));
 	} else {
-	    *indexPtr = Tcl_UtfAtIndex(entryPtr->labelText, number) -
-		entryPtr->labelText;
+	    *indexPtr = Tcl_UtfAtIndex(GETLABEL(entryPtr), number) -
+		GETLABEL(entryPtr);
 	}
     } else {
 	Tcl_AppendResult(interp, "bad label index \"", string, "\"",
@@ -6118,7 +6467,7 @@ IndexOpOp(hboxPtr, interp, argc, argv)
     if (GetLabelIndex(hboxPtr, entryPtr, argv[3], &nBytes) != TCL_OK) {
 	return TCL_ERROR;
     }
-    nChars = Tcl_NumUtfChars(entryPtr->labelText, nBytes);
+    nChars = Tcl_NumUtfChars(GETLABEL(entryPtr), nBytes);
     Tcl_SetResult(interp, Blt_Itoa(nChars), TCL_VOLATILE);
     return TCL_OK;
 }
@@ -6167,7 +6516,7 @@ InsertOpOp(hboxPtr, interp, argc, argv)
     entryPtr = treePtr->entryPtr;
     if (hboxPtr->focusPtr != treePtr) {
 	hboxPtr->focusPtr = treePtr;
-	editPtr->insertPos = strlen(entryPtr->labelText);
+	editPtr->insertPos = strlen(GETLABEL(entryPtr));
 	editPtr->selAnchor = editPtr->selFirst = editPtr->selLast = -1;
     }
     if (GetLabelIndex(hboxPtr, entryPtr, argv[4], &insertPos) != TCL_OK) {
@@ -6180,21 +6529,21 @@ InsertOpOp(hboxPtr, interp, argc, argv)
 	EventuallyRedraw(hboxPtr);
 	return TCL_OK;
     }
-    oldSize = strlen(entryPtr->labelText);
+    oldSize = strlen(GETLABEL(entryPtr));
     newSize = oldSize + extra;
     string = Blt_Malloc(sizeof(char) * (newSize + 1));
 
     if (insertPos == oldSize) {	/* Append */
-	strcpy(string, entryPtr->labelText);
+	strcpy(string, GETLABEL(entryPtr));
 	strcat(string, argv[5]);
     } else if (insertPos == 0) {/* Prepend */
 	strcpy(string, argv[5]);
-	strcat(string, entryPtr->labelText);
+	strcat(string, GETLABEL(entryPtr));
     } else {			/* Insert into existing. */
 	char *left, *right;
 	char *p;
 
-	left = entryPtr->labelText;
+	left = GETLABEL(entryPtr);
 	right = left + insertPos;
 	p = string;
 	strncpy(p, left, insertPos);
@@ -6217,8 +6566,11 @@ InsertOpOp(hboxPtr, interp, argc, argv)
     if ((editPtr->selAnchor > insertPos) || (editPtr->selFirst >= insertPos)) {
 	editPtr->selAnchor += extra;
     }
-    Blt_Free(entryPtr->labelText);
+    if (entryPtr->labelText != NULL) {
+	Blt_Free(entryPtr->labelText);
+    }
     entryPtr->labelText = string;
+    entryPtr->flags |= ENTRY_DIRTY;
 
     editPtr->insertPos = insertPos + extra;
     GetCursorLocation(hboxPtr, treePtr);
@@ -6272,7 +6624,7 @@ DeleteOpOp(hboxPtr, interp, argc, argv)
     entryPtr = treePtr->entryPtr;
     if (hboxPtr->focusPtr != treePtr) {
 	hboxPtr->focusPtr = treePtr;
-	editPtr->insertPos = strlen(entryPtr->labelText);
+	editPtr->insertPos = strlen(GETLABEL(entryPtr));
 	editPtr->selAnchor = editPtr->selFirst = editPtr->selLast = -1;
     }
     if ((GetLabelIndex(hboxPtr, entryPtr, argv[4], &first) != TCL_OK) ||
@@ -6285,15 +6637,18 @@ DeleteOpOp(hboxPtr, interp, argc, argv)
     if ((!hboxPtr->focusEdit) || (entryPtr == NULL)) {
 	return TCL_OK;		/* Not in edit mode. */
     }
-    oldSize = strlen(entryPtr->labelText);
+    oldSize = strlen(GETLABEL(entryPtr));
     newSize = oldSize - (last - first);
     p = string = Blt_Malloc(sizeof(char) * (newSize + 1));
-    strncpy(p, entryPtr->labelText, first);
+    strncpy(p, GETLABEL(entryPtr), first);
     p += first;
-    strcpy(p, entryPtr->labelText + last);
+    strcpy(p, GETLABEL(entryPtr) + last);
 
-    Blt_Free(entryPtr->labelText);
+    if (entryPtr->labelText != NULL) {
+	Blt_Free(entryPtr->labelText);
+    }
     entryPtr->labelText = string;
+    entryPtr->flags |= ENTRY_DIRTY;
     nDeleted = last - first + 1;
 
     /*
@@ -6377,21 +6732,25 @@ ChildrenOpOp(hboxPtr, interp, argc, argv)
     int argc;
     char **argv;
 {
-    Tree *parentPtr, *nodePtr;
+    Tree *parentPtr;
+    Blt_TreeNode node;
+    char string[200];
 
     if (StringToNode(hboxPtr, argv[3], &parentPtr) != TCL_OK) {
 	return TCL_ERROR;
     }
+    /* 
+     * The children are listed straight from the tree, so no records
+     * are created for nodes that have never been displayed.
+     */
     if (argc == 4) {
-	Blt_ChainLink *linkPtr;
-
-	for (linkPtr = Blt_ChainFirstLink(parentPtr->chainPtr); linkPtr != NULL;
-	    linkPtr = Blt_ChainNextLink(linkPtr)) {
-	    nodePtr = Blt_ChainGetValue(linkPtr);
-	    Tcl_AppendElement(interp, NodeToString(hboxPtr, nodePtr));
+	for (node = Blt_TreeFirstChild(parentPtr->node); node != NULL;
+	    node = Blt_TreeNextSibling(node)) {
+	    sprintf(string, "%u", Blt_TreeNodeId(node));
+	    Tcl_AppendElement(interp, string);
 	}
     } else if (argc == 6) {
-	Blt_ChainLink *firstPtr, *lastPtr;
+	Blt_TreeNode firstNode, lastNode;
 	int first, last;
 	int nNodes;
 
@@ -6399,7 +6758,7 @@ ChildrenOpOp(hboxPtr, interp, argc, argv)
 	    (Blt_GetPosition(interp, argv[5], &last) != TCL_OK)) {
 	    return TCL_ERROR;
 	}
-	nNodes = Blt_ChainGetLength(parentPtr->chainPtr);
+	nNodes = Blt_TreeNodeDegree(parentPtr->node);
 	if (nNodes == 0) {
 	    return TCL_OK;
 	}
@@ -6409,23 +6768,23 @@ ChildrenOpOp(hboxPtr, interp, argc, argv)
 	if ((first == -1) || (first >= nNodes)) {
 	    first = nNodes - 1;
 	} 
-	firstPtr = Blt_ChainGetNthLink(parentPtr->chainPtr, first);
-	lastPtr = Blt_ChainGetNthLink(parentPtr->chainPtr, last);
+	firstNode = Blt_TreeNthChild(parentPtr->node, first);
+	lastNode = Blt_TreeNthChild(parentPtr->node, last);
 	if (first > last) {
-	    for ( /*empty*/ ; lastPtr != NULL;
-		lastPtr = Blt_ChainPrevLink(lastPtr)) {
-		nodePtr = Blt_ChainGetValue(lastPtr);
-		Tcl_AppendElement(interp, NodeToString(hboxPtr, nodePtr));
-		if (lastPtr == firstPtr) {
+	    for (node = lastNode; node != NULL; 
+		node = Blt_TreePrevSibling(node)) {
+		sprintf(string, "%u", Blt_TreeNodeId(node));
+		Tcl_AppendElement(interp, string);
+		if (node == firstNode) {
 		    break;
 		}
 	    }
 	} else {
-	    for ( /*empty*/ ; firstPtr != NULL;
-		firstPtr = Blt_ChainNextLink(firstPtr)) {
-		nodePtr = Blt_ChainGetValue(firstPtr);
-		Tcl_AppendElement(interp, NodeToString(hboxPtr, nodePtr));
-		if (firstPtr == lastPtr) {
+	    for (node = firstNode; node != NULL; 
+		node = Blt_TreeNextSibling(node)) {
+		sprintf(string, "%u", Blt_TreeNodeId(node));
+		Tcl_AppendElement(interp, string);
+		if (node == lastNode) {
 		    break;
 		}
 	    }
@@ -6738,7 +7097,7 @@ FindOp(hboxPtr, interp, argc, argv)
     for (treePtr = firstPtr; treePtr != NULL;
 	treePtr = (*nextProc) (treePtr, 0)) {
 	if (namePattern != NULL) {
-	    result = (*compareProc) (interp, treePtr->nameId, namePattern);
+	    result = (*compareProc) (interp, NODENAME(treePtr), namePattern);
 	    if (result == invertMatch) {
 		goto nextNode;	/* Failed to match */
 	    }
@@ -6858,7 +7217,7 @@ GetOp(hboxPtr, interp, argc, argv)
 	    GetFullPath(treePtr, hboxPtr->separator, &pathString);
 	    Tcl_DStringAppendElement(&dString, Tcl_DStringValue(&pathString));
 	} else {
-	    Tcl_DStringAppendElement(&dString, treePtr->nameId);
+	    Tcl_DStringAppendElement(&dString, NODENAME(treePtr));
 	}
     }
     Tcl_DStringFree(&pathString);
@@ -6984,7 +7343,7 @@ SearchAndApplyToTree(hboxPtr, interp, argc, argv, proc, nonMatchPtr)
 	    treePtr = NextNode(treePtr, 0)) {
 
 	    if (namePattern != NULL) {
-		result = (*compareProc) (interp, treePtr->nameId, namePattern);
+		result = (*compareProc) (interp, NODENAME(treePtr), namePattern);
 		if (result == invertMatch) {
 		    continue;	/* Failed to match */
 		}
@@ -7290,7 +7649,7 @@ InsertOp(hboxPtr, interp, argc, argv)
 	    }
 	    if (ConfigureEntry(hboxPtr, nodePtr->entryPtr, nOpts, options,
 		    TK_CONFIG_ARGV_ONLY) != TCL_OK) {
-		DeleteNode(hboxPtr, nodePtr);
+		DestroyTree(hboxPtr, nodePtr);
 		goto error;
 	    }
 	    Tcl_DStringAppendElement(&dString, NodeToString(hboxPtr, nodePtr));
@@ -7336,8 +7695,8 @@ DeleteOp(hboxPtr, interp, argc, argv)
     char **argv;
 {
     Tree *treePtr;
-    Blt_ChainLink *linkPtr;
-    Blt_ChainLink *firstPtr, *lastPtr, *nextPtr;
+    Blt_TreeNode node, nextNode;
+    Blt_TreeNode firstNode, lastNode;
 
     if (argc == 2) {
 	return TCL_OK;
@@ -7345,7 +7704,7 @@ DeleteOp(hboxPtr, interp, argc, argv)
     if (StringToNode(hboxPtr, argv[2], &treePtr) != TCL_OK) {
 	return TCL_ERROR;	/* Node or path doesn't already exist */
     }
-    firstPtr = lastPtr = NULL;
+    firstNode = lastNode = NULL;
     switch (argc) {
     case 3:
 	/*
@@ -7356,8 +7715,8 @@ DeleteOp(hboxPtr, interp, argc, argv)
 	    DestroyTree(hboxPtr, treePtr);	/* Don't delete root */
 	    goto done;
 	}
-	firstPtr = Blt_ChainFirstLink(treePtr->chainPtr);
-	lastPtr = Blt_ChainLastLink(treePtr->chainPtr);
+	firstNode = Blt_TreeFirstChild(treePtr->node);
+	lastNode = Blt_TreeLastChild(treePtr->node);
 	break;
 
     case 4:
@@ -7371,15 +7730,15 @@ DeleteOp(hboxPtr, interp, argc, argv)
 	    if (Blt_GetPosition(interp, argv[3], &position) != TCL_OK) {
 		return TCL_ERROR;
 	    }
-	    if (position >= Blt_ChainGetLength(treePtr->chainPtr)) {
+	    if (position >= (int)Blt_TreeNodeDegree(treePtr->node)) {
 		return TCL_OK;	/* Bad first index */
 	    }
 	    if (position == APPEND) {
-		linkPtr = Blt_ChainLastLink(treePtr->chainPtr);
+		node = Blt_TreeLastChild(treePtr->node);
 	    } else {
-		linkPtr = Blt_ChainGetNthLink(treePtr->chainPtr, position);
+		node = Blt_TreeNthChild(treePtr->node, position);
 	    }
-	    firstPtr = lastPtr = linkPtr;
+	    firstNode = lastNode = node;
 	}
 	break;
 
@@ -7396,7 +7755,7 @@ DeleteOp(hboxPtr, interp, argc, argv)
 		(Blt_GetPosition(interp, argv[4], &last) != TCL_OK)) {
 		return TCL_ERROR;
 	    }
-	    nEntries = Blt_ChainGetLength(treePtr->chainPtr);
+	    nEntries = Blt_TreeNodeDegree(treePtr->node);
 	    if (nEntries == 0) {
 		return TCL_OK;
 	    }
@@ -7416,16 +7775,15 @@ DeleteOp(hboxPtr, interp, argc, argv)
 		    " > ", argv[4], "\"", (char *)NULL);
 		return TCL_ERROR;
 	    }
-	    firstPtr = Blt_ChainGetNthLink(treePtr->chainPtr, first);
-	    lastPtr = Blt_ChainGetNthLink(treePtr->chainPtr, last);
+	    firstNode = Blt_TreeNthChild(treePtr->node, first);
+	    lastNode = Blt_TreeNthChild(treePtr->node, last);
 	}
 	break;
     }
-    for (linkPtr = firstPtr; linkPtr != NULL; linkPtr = nextPtr) {
-	nextPtr = Blt_ChainNextLink(linkPtr);
-	treePtr = Blt_ChainGetValue(linkPtr);
-	DestroyTree(hboxPtr, treePtr);
-	if (linkPtr == lastPtr) {
+    for (node = firstNode; node != NULL; node = nextNode) {
+	nextNode = Blt_TreeNextSibling(node);
+	Blt_TreeDeleteNode(hboxPtr->tree, node);
+	if (node == lastNode) {
 	    break;
 	}
     }
@@ -7454,6 +7812,7 @@ MoveOp(hboxPtr, interp, argc, argv)
     char **argv;
 {
     Tree *srcPtr, *destPtr, *parentPtr;
+    Blt_TreeNode before;
     char c;
     int action;
 
@@ -7478,38 +7837,45 @@ MoveOp(hboxPtr, interp, argc, argv)
     if (StringToNode(hboxPtr, argv[4], &destPtr) != TCL_OK) {
 	return TCL_ERROR;
     }
+    if (srcPtr == hboxPtr->rootPtr) {
+	Tcl_AppendResult(interp, "can't move root node", (char *)NULL);
+	return TCL_ERROR;
+    }
     /* Verify they aren't ancestors. */
-    if (IsAncestor(srcPtr, destPtr)) {
+    if ((srcPtr == destPtr) || (IsAncestor(srcPtr, destPtr))) {
 	Tcl_AppendResult(interp, "can't move node: \"", argv[2],
 	    "\" is an ancestor of \"", argv[4], "\"", (char *)NULL);
 	return TCL_ERROR;
     }
-    parentPtr = destPtr->parentPtr;
+    parentPtr = ParentOf(destPtr);
     if (parentPtr == NULL) {
 	action = MOVE_INTO;
     }
-    Blt_ChainUnlinkLink(srcPtr->parentPtr->chainPtr, srcPtr->linkPtr);
     switch (action) {
     case MOVE_INTO:
-	Blt_ChainLinkBefore(destPtr->chainPtr, srcPtr->linkPtr,
-	    (Blt_ChainLink *) NULL);
 	parentPtr = destPtr;
+	before = NULL;
 	break;
 
     case MOVE_BEFORE:
-	Blt_ChainLinkBefore(parentPtr->chainPtr, srcPtr->linkPtr,
-	    destPtr->linkPtr);
+	before = destPtr->node;
 	break;
 
     case MOVE_AFTER:
-	Blt_ChainLinkAfter(parentPtr->chainPtr, srcPtr->linkPtr,
-	    destPtr->linkPtr);
+    default:
+	before = Blt_TreeNextSibling(destPtr->node);
 	break;
     }
-    srcPtr->parentPtr = parentPtr;
-    srcPtr->level = parentPtr->level + 1;
-    hboxPtr->flags |= (HIERBOX_LAYOUT | HIERBOX_SCROLL | HIERBOX_DIRTY);
-    EventuallyRedraw(hboxPtr);
+    if (before == srcPtr->node) {
+	return TCL_OK;		/* Already in place. */
+    }
+    /* The tree's move notification marks the layout as dirty. */
+    if (Blt_TreeMoveNode(hboxPtr->tree, srcPtr->node, parentPtr->node, 
+		before) != TCL_OK) {
+	Tcl_AppendResult(interp, "can't move node \"", argv[2], "\"", 
+		(char *)NULL);
+	return TCL_ERROR;
+    }
     return TCL_OK;
 }
 
@@ -7555,9 +7921,9 @@ NearestOp(hboxPtr, interp, argc, argv)
 		where = "gadget";
 	    }
 	}
-	labelX = entryPtr->worldX + LEVELWIDTH(treePtr->level);
+	labelX = entryPtr->worldX + LEVELWIDTH(LEVEL(treePtr));
 	if ((x >= labelX) &&
-	    (x < (labelX + LEVELWIDTH(treePtr->level + 1) + entryPtr->width))) {
+	    (x < (labelX + LEVELWIDTH(LEVEL(treePtr) + 1) + entryPtr->width))) {
 	    where = "select";
 	}
 	if (Tcl_SetVar(interp, argv[4], where, TCL_LEAVE_ERR_MSG) == NULL) {
@@ -7824,7 +8190,7 @@ SeeOp(hboxPtr, interp, argc, argv)
     case TK_ANCHOR_E:
     case TK_ANCHOR_NE:
     case TK_ANCHOR_SE:
-	x = entryPtr->worldX + entryPtr->width + LEVELWIDTH(treePtr->level) -
+	x = entryPtr->worldX + entryPtr->width + LEVELWIDTH(LEVEL(treePtr)) -
 	    width;
 	break;
     default:
@@ -63,6 +63,7 @@ static Tcl_IdleProc NotifyIdleProc;
 #define TREE_THREAD_KEY		"BLT Tree Data"
 #define TREE_MAGIC		((unsigned int) 0x46170277)
 #define TREE_DESTROYED		(1<<0)
+#define TREE_SNAPSHOT		(1<<1)	/* Read-only copy of another tree. */
 
 typedef struct Blt_TreeNodeStruct Node;
 typedef struct Blt_TreeClientStruct TreeClient;
@@ -107,6 +108,17 @@ static Value *TreeFirstValue _ANSI_ARGS_((Blt_TreeNode,
 
 static Value *TreeNextValue _ANSI_ARGS_((Blt_TreeKeySearch *srchPtr));
 
+static Tcl_Obj **TreeFindValueObj _ANSI_ARGS_((Blt_TreeNode node,
+	Blt_TreeKey key, Value **valuePtrPtr));
+static Tcl_Obj **TreeCreateValueObj _ANSI_ARGS_((Blt_TreeNode node,
+	Blt_TreeKey key, Value **valuePtrPtr, int *newPtr));
+static void TreeDeleteValueObj _ANSI_ARGS_((Blt_TreeNode node,
+	Blt_TreeKey key, Tcl_Obj **objPtrPtr, Value *valuePtr));
+static int SchemaSlot _ANSI_ARGS_((Blt_TreeObject treeObj, Blt_TreeKey key));
+static void GrowSlots _ANSI_ARGS_((Blt_TreeNode node));
+
+static void FreeTagNodes _ANSI_ARGS_((Blt_TreeTagEntry *tPtr));
+
 /*
  * When there are this many entries per bucket, on average, rebuild
  * the hash table to make it larger.
@@ -184,8 +196,82 @@ typedef struct {
     Blt_TreeTraceProc *proc;
     TreeClient *clientPtr;
     Blt_ChainLink *linkPtr;
+    unsigned int serial;	/* Order the trace was created. */
+    int deleted;		/* Indicates the trace has been deleted,
+				 * but is still in use by CallTraces. */
+    Blt_HashTable *bucketTablePtr; /* Index table holding the trace,
+				 * or NULL if it's in the others list. */
+    Blt_HashEntry *bucketPtr;	/* Entry of the index table. */
+    Blt_ChainLink *bucketLinkPtr; /* Link in the entry's (or others) 
+				 * chain of traces. */
 } TraceHandler;
 
+/*
+ * TraceIndex --
+ *
+ *	Indexes the traces of all clients of a tree object, so that
+ *	CallTraces only looks at traces that could match.  Each trace
+ *	is filed once, under the most selective of its criteria:
+ *	exact key, then node, then tag.  Traces with only a glob key
+ *	pattern (or no criteria) are kept in the others list.
+ */
+struct Blt_TreeTraceIndexStruct {
+    int nTraces;		/* # of traces installed. */
+    unsigned int nextSerial;
+    Blt_HashTable keyTable;	/* Exact key -> chain of traces. */
+    Blt_HashTable nodeTable;	/* Node -> chain of traces. */
+    Blt_HashTable tagTable;	/* Tag name -> chain of traces. */
+    Blt_Chain *others;		/* Remaining traces. */
+};
+
+typedef struct Blt_TreeTraceIndexStruct TraceIndex;
+
+static void DestroyTraceIndex _ANSI_ARGS_((TraceIndex *indexPtr));
+
+/*
+ * TreeBatch --
+ *
+ *	Changes made by a client between Blt_TreeBeginBatch and
+ *	Blt_TreeEndBatch.  Move, sort, relabel and insert notifications
+ *	and write/unset traces are held back, merged per node (or per
+ *	node and key), and delivered when the outermost batch ends.
+ */
+#define TREE_NOTIFY_DEFERRED \
+    (TREE_NOTIFY_MOVE | TREE_NOTIFY_MOVEPOST | TREE_NOTIFY_INSERT | \
+	TREE_NOTIFY_RELABEL | TREE_NOTIFY_RELABELPOST | TREE_NOTIFY_SORT)
+
+typedef struct {
+    unsigned int inode;		/* Node that received the events. */
+    unsigned int mask;		/* Events held back. */
+} BatchEvent;
+
+typedef struct {
+    Blt_TreeKey key;
+    unsigned long inode;
+} BatchTraceKey;
+
+typedef struct {
+    BatchTraceKey key;
+    unsigned int flags;		/* Merged trace flags. */
+} BatchTrace;
+
+struct Blt_TreeBatchStruct {
+    TreeClient *clientPtr;	/* Client that started the batch. */
+    int level;			/* Nesting level. */
+    Blt_HashTable eventTable;	/* Inode -> BatchEvent. */
+    Blt_Chain *events;		/* Held back events, in order. */
+    Blt_HashTable parentTable;	/* Inodes of the nodes whose children
+				 * changed. */
+    Blt_Chain *parents;		/* Same, in order. */
+    Blt_HashTable traceTable;	/* Node and key -> BatchTrace. */
+    Blt_Chain *traces;		/* Held back traces, in order. */
+};
+
+typedef struct Blt_TreeBatchStruct TreeBatch;
+
+static void FreeBatch _ANSI_ARGS_((TreeBatch *batchPtr));
+static void DestroyKeyIndexes _ANSI_ARGS_((TreeObject *treeObjPtr));
+
 /*
  * --------------------------------------------------------------
  *
@@ -256,6 +342,8 @@ NewNode(TreeObject *treeObjPtr, CONST char *name, int inode)
     nodePtr->values = NULL;     
     nodePtr->logSize = 0;
     nodePtr->nValues = 0;
+    nodePtr->slots = NULL;
+    nodePtr->nSlots = nodePtr->nSlotValues = 0;
     nodePtr->label = NULL;
     if (name != NULL) {
 	nodePtr->label = Blt_TreeKeyGet(NULL, treeObjPtr, name);
@@ -284,7 +372,7 @@ ReleaseTagTable(Blt_TreeTagTable *tablePtr)
 	    Blt_TreeTagEntry *tPtr;
 
 	    tPtr = Blt_GetHashValue(hPtr);
-	    Blt_DeleteHashTable(&tPtr->nodeTable);
+	    FreeTagNodes(tPtr);
 	    Blt_TreeTagRefDecr(tPtr);
 	}
 	Blt_DeleteHashTable(&tablePtr->tagTable);
@@ -317,6 +405,437 @@ ResetDepths(
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Inode table --
+ *
+ *	Maps node serial numbers (inodes) to nodes.  Inodes are
+ *	mostly handed out in sequence from nextInode, so they're kept
+ *	in a paged array indexed directly by the inode.  A page is
+ *	allocated when its first node is created and freed when its
+ *	last node is deleted.  Inodes far beyond nextInode (requested
+ *	by Blt_TreeCreateNodeWithId) are stored in the nodeTable hash
+ *	table instead, until the array grows to cover them.
+ *
+ *----------------------------------------------------------------------
+ */
+#define INODE_PAGE_BITS		10
+#define INODE_PAGE_SIZE		(1 << INODE_PAGE_BITS)
+#define INODE_PAGE_MASK		(INODE_PAGE_SIZE - 1)
+
+static Node *
+LookupNode(TreeObject *treeObjPtr, unsigned int inode)
+{
+    unsigned int page;
+
+    page = inode >> INODE_PAGE_BITS;
+    if (page < treeObjPtr->nPages) {
+	if (treeObjPtr->nodePages[page] == NULL) {
+	    return NULL;
+	}
+	return treeObjPtr->nodePages[page][inode & INODE_PAGE_MASK];
+    }
+    if (treeObjPtr->nodeTable.numEntries > 0) {
+	Blt_HashEntry *hPtr;
+
+	hPtr = Blt_FindHashEntry(&treeObjPtr->nodeTable, (char *)(intptr_t)inode);
+	if (hPtr != NULL) {
+	    return Blt_GetHashValue(hPtr);
+	}
+    }
+    return NULL;
+}
+
+static void
+GrowNodePages(TreeObject *treeObjPtr, unsigned int nPages)
+{
+    Blt_HashEntry *hPtr, *nextPtr;
+    Blt_HashSearch cursor;
+    unsigned int i;
+
+    treeObjPtr->nodePages = Blt_Realloc(treeObjPtr->nodePages, 
+	nPages * sizeof(Node **));
+    treeObjPtr->pageCounts = Blt_Realloc(treeObjPtr->pageCounts,
+	nPages * sizeof(unsigned short));
+    assert(treeObjPtr->nodePages && treeObjPtr->pageCounts);
+    for (i = treeObjPtr->nPages; i < nPages; i++) {
+	treeObjPtr->nodePages[i] = NULL;
+	treeObjPtr->pageCounts[i] = 0;
+    }
+    treeObjPtr->nPages = nPages;
+
+    /* Move any nodes with sparse inodes now covered by the pages. */
+    for (hPtr = Blt_FirstHashEntry(&treeObjPtr->nodeTable, &cursor);
+	 hPtr != NULL; hPtr = nextPtr) {
+	unsigned int inode;
+	Node *nodePtr;
+
+	nextPtr = Blt_NextHashEntry(&cursor);
+	inode = (unsigned int)(intptr_t)
+	    Blt_GetHashKey(&treeObjPtr->nodeTable, hPtr);
+	if ((inode >> INODE_PAGE_BITS) >= nPages) {
+	    continue;
+	}
+	nodePtr = Blt_GetHashValue(hPtr);
+	Blt_DeleteHashEntry(&treeObjPtr->nodeTable, hPtr);
+	i = inode >> INODE_PAGE_BITS;
+	if (treeObjPtr->nodePages[i] == NULL) {
+	    treeObjPtr->nodePages[i] = Blt_Calloc(INODE_PAGE_SIZE, 
+		sizeof(Node *));
+	    assert(treeObjPtr->nodePages[i]);
+	}
+	treeObjPtr->nodePages[i][inode & INODE_PAGE_MASK] = nodePtr;
+	treeObjPtr->pageCounts[i]++;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddNode --
+ *
+ *	Records the node under its inode.
+ *
+ * Results:
+ *	Returns 1 if successful, 0 if a node with the same inode
+ *	already exists.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+AddNode(TreeObject *treeObjPtr, unsigned int inode, Node *nodePtr)
+{
+    unsigned int page;
+    Node **slotPtr;
+
+    page = inode >> INODE_PAGE_BITS;
+    if ((page >= treeObjPtr->nPages) && 
+	(page <= (treeObjPtr->nextInode >> INODE_PAGE_BITS) + 1)) {
+	unsigned int nPages;
+
+	/* The inode is near the others. Extend the pages to cover it. */
+	nPages = (treeObjPtr->nPages == 0) ? 16 : treeObjPtr->nPages;
+	while (nPages <= page) {
+	    nPages += nPages;
+	}
+	GrowNodePages(treeObjPtr, nPages);
+    }
+    if (page >= treeObjPtr->nPages) {
+	Blt_HashEntry *hPtr;
+	int isNew;
+
+	hPtr = Blt_CreateHashEntry(&treeObjPtr->nodeTable, 
+		(char *)(intptr_t)inode, &isNew);
+	if (!isNew) {
+	    return FALSE;
+	}
+	Blt_SetHashValue(hPtr, nodePtr);
+	return TRUE;
+    }
+    if (treeObjPtr->nodePages[page] == NULL) {
+	treeObjPtr->nodePages[page] = Blt_Calloc(INODE_PAGE_SIZE, 
+		sizeof(Node *));
+	assert(treeObjPtr->nodePages[page]);
+    }
+    slotPtr = treeObjPtr->nodePages[page] + (inode & INODE_PAGE_MASK);
+    if (*slotPtr != NULL) {
+	return FALSE;
+    }
+    *slotPtr = nodePtr;
+    treeObjPtr->pageCounts[page]++;
+    return TRUE;
+}
+
+static void
+RemoveNode(TreeObject *treeObjPtr, unsigned int inode)
+{
+    unsigned int page;
+
+    page = inode >> INODE_PAGE_BITS;
+    if (page < treeObjPtr->nPages) {
+	assert(treeObjPtr->nodePages[page] != NULL);
+	treeObjPtr->nodePages[page][inode & INODE_PAGE_MASK] = NULL;
+	treeObjPtr->pageCounts[page]--;
+	if (treeObjPtr->pageCounts[page] == 0) {
+	    Blt_Free(treeObjPtr->nodePages[page]);
+	    treeObjPtr->nodePages[page] = NULL;
+	}
+    } else {
+	Blt_HashEntry *hPtr;
+
+	hPtr = Blt_FindHashEntry(&treeObjPtr->nodeTable, 
+		(char *)(intptr_t)inode);
+	assert(hPtr);
+	Blt_DeleteHashEntry(&treeObjPtr->nodeTable, hPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tag bitsets --
+ *
+ *	Besides its hash table of nodes, each tag keeps a bitset of
+ *	the tagged nodes indexed by inode, so that testing a node is a
+ *	bit test and tag queries are bitwise operations on words.  The
+ *	bitset only grows as far as the highest tagged inode within
+ *	the inode pages.  Tagged nodes with sparse inodes beyond the
+ *	bitset are counted in nOutside and looked up in the hash
+ *	table.
+ *
+ *	The hash table is still exported by Blt_TreeTagHashTable.  If
+ *	its count no longer matches the bitset, it was changed
+ *	directly and the bitset is rebuilt.
+ *
+ *----------------------------------------------------------------------
+ */
+#define TAG_WORD(i)		((i) >> 5)
+#define TAG_BIT(i)		(1U << ((i) & 0x1F))
+#define TAG_WORDS_PER_PAGE	(INODE_PAGE_SIZE >> 5)
+
+static void
+SetTagBit(Blt_TreeTagEntry *tPtr, Node *nodePtr)
+{
+    TreeObject *treeObjPtr = nodePtr->treeObject;
+    unsigned int inode, word, nWords;
+
+    inode = nodePtr->inode;
+    word = TAG_WORD(inode);
+    if (word >= tPtr->nWords) {
+	if ((inode >> INODE_PAGE_BITS) >= treeObjPtr->nPages) {
+	    tPtr->nOutside++;
+	    return;
+	}
+	nWords = (tPtr->nWords == 0) ? TAG_WORDS_PER_PAGE : tPtr->nWords;
+	while (nWords <= word) {
+	    nWords += nWords;
+	}
+	if (nWords > treeObjPtr->nPages * TAG_WORDS_PER_PAGE) {
+	    nWords = treeObjPtr->nPages * TAG_WORDS_PER_PAGE;
+	}
+	tPtr->bits = Blt_Realloc(tPtr->bits, nWords * sizeof(unsigned int));
+	assert(tPtr->bits);
+	memset(tPtr->bits + tPtr->nWords, 0, 
+	       (nWords - tPtr->nWords) * sizeof(unsigned int));
+	tPtr->nWords = nWords;
+	if (tPtr->nOutside > 0) {
+	    Blt_HashEntry *hPtr;
+	    Blt_HashSearch cursor;
+	    Node *outPtr;
+
+	    /* Move sparse nodes now covered by the bitset. */
+	    for (hPtr = Blt_FirstHashEntry(&tPtr->nodeTable, &cursor); 
+		 hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+		outPtr = (Node *)Blt_GetHashKey(&tPtr->nodeTable, hPtr);
+		if ((outPtr != nodePtr) && 
+		    (TAG_WORD(outPtr->inode) < nWords) &&
+		    ((tPtr->bits[TAG_WORD(outPtr->inode)] & 
+		      TAG_BIT(outPtr->inode)) == 0)) {
+		    tPtr->bits[TAG_WORD(outPtr->inode)] |= 
+			TAG_BIT(outPtr->inode);
+		    tPtr->nBits++;
+		    tPtr->nOutside--;
+		}
+	    }
+	}
+    }
+    tPtr->bits[word] |= TAG_BIT(inode);
+    tPtr->nBits++;
+}
+
+static void
+ClearTagBit(Blt_TreeTagEntry *tPtr, Node *nodePtr)
+{
+    unsigned int word;
+
+    word = TAG_WORD(nodePtr->inode);
+    if ((word < tPtr->nWords) && 
+	(tPtr->bits[word] & TAG_BIT(nodePtr->inode))) {
+	tPtr->bits[word] &= ~TAG_BIT(nodePtr->inode);
+	tPtr->nBits--;
+    } else if (tPtr->nOutside > 0) {
+	tPtr->nOutside--;
+    }
+}
+
+/* Rebuilds the bitset if the tag's hash table was changed directly. */
+static void
+CheckTagBits(Blt_TreeTagEntry *tPtr)
+{
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
+
+    if ((tPtr->hashPtr == NULL) || 
+	(tPtr->nBits + tPtr->nOutside == (unsigned int)
+	 tPtr->nodeTable.numEntries)) {
+	return;
+    }
+    if (tPtr->bits != NULL) {
+	memset(tPtr->bits, 0, tPtr->nWords * sizeof(unsigned int));
+    }
+    tPtr->nBits = tPtr->nOutside = 0;
+    for (hPtr = Blt_FirstHashEntry(&tPtr->nodeTable, &cursor); hPtr != NULL;
+	 hPtr = Blt_NextHashEntry(&cursor)) {
+	SetTagBit(tPtr, (Node *)Blt_GetHashKey(&tPtr->nodeTable, hPtr));
+    }
+}
+
+/* 
+ * Frees the nodes of a tag that's being removed.  The entry itself
+ * may still be held by a search.
+ */
+static void
+FreeTagNodes(Blt_TreeTagEntry *tPtr)
+{
+    Blt_DeleteHashTable(&tPtr->nodeTable);
+    if (tPtr->bits != NULL) {
+	Blt_Free(tPtr->bits);
+	tPtr->bits = NULL;
+    }
+    tPtr->nWords = tPtr->nBits = tPtr->nOutside = 0;
+    tPtr->hashPtr = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeTagEntryHasNode --
+ *
+ *	Indicates if the node has the tag.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeTagEntryHasNode(Blt_TreeTagEntry *tPtr, Node *nodePtr)
+{
+    unsigned int word;
+
+    if (tPtr->hashPtr == NULL) {
+	return FALSE;		/* Tag was forgotten. */
+    }
+    CheckTagBits(tPtr);
+    word = TAG_WORD(nodePtr->inode);
+    if (word < tPtr->nWords) {
+	return ((tPtr->bits[word] & TAG_BIT(nodePtr->inode)) != 0);
+    }
+    return ((tPtr->nOutside > 0) && 
+	(Blt_FindHashEntry(&tPtr->nodeTable, (char *)nodePtr) != NULL));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Child label index --
+ *
+ *	Nodes with many children keep a hash table of their children's
+ *	labels, so that Blt_TreeFindChild doesn't have to walk the list
+ *	of siblings.  The table is built once the number of children
+ *	reaches CHILD_INDEX_THRESHOLD and removed once it drops below
+ *	half that.  The tables are held in the tree object's
+ *	childTable, keyed by the parent node.
+ *
+ *	Labels don't have to be unique.  Each entry holds the only
+ *	child with that label, or NULL if more than one child has
+ *	the label.  In the latter case, the siblings are searched as
+ *	before.  Every child's label always has an entry.
+ *
+ *	The index also holds an array of the children in order, so
+ *	that the nth child can be found directly.  The array is
+ *	valid along with the children's cached positions (see
+ *	RenumberChildren).
+ *
+ *----------------------------------------------------------------------
+ */
+#define CHILD_INDEX_THRESHOLD	64
+
+typedef struct {
+    Blt_HashTable labelTable;	/* Children hashed by their labels. */
+    Node **children;		/* Children in order. */
+    unsigned int nAlloc;	/* # of slots allocated for children. */
+} ChildIndex;
+
+static ChildIndex *
+GetChildIndex(Node *parentPtr)
+{
+    Blt_HashEntry *hPtr;
+
+    if ((parentPtr->flags & TREE_NODE_CHILD_INDEX) == 0) {
+	return NULL;
+    }
+    hPtr = Blt_FindHashEntry(&parentPtr->treeObject->childTable, 
+	(char *)parentPtr);
+    assert(hPtr);
+    return Blt_GetHashValue(hPtr);
+}
+
+static void
+IndexChild(ChildIndex *indexPtr, Node *nodePtr)
+{
+    Blt_HashEntry *hPtr;
+    int isNew;
+
+    hPtr = Blt_CreateHashEntry(&indexPtr->labelTable, nodePtr->label, &isNew);
+    Blt_SetHashValue(hPtr, (isNew) ? nodePtr : NULL);
+}
+
+static void
+UnindexChild(ChildIndex *indexPtr, Node *nodePtr)
+{
+    Blt_HashEntry *hPtr;
+
+    hPtr = Blt_FindHashEntry(&indexPtr->labelTable, nodePtr->label);
+    if ((hPtr != NULL) && (Blt_GetHashValue(hPtr) == nodePtr)) {
+	Blt_DeleteHashEntry(&indexPtr->labelTable, hPtr);
+    }
+}
+
+static void
+BuildChildIndex(Node *parentPtr)
+{
+    Blt_HashEntry *hPtr;
+    ChildIndex *indexPtr;
+    Node *childPtr;
+    int isNew;
+
+    indexPtr = Blt_Calloc(1, sizeof(ChildIndex));
+    assert(indexPtr);
+    Blt_InitHashTable(&indexPtr->labelTable, BLT_ONE_WORD_KEYS);
+    for (childPtr = parentPtr->first; childPtr != NULL; 
+	 childPtr = childPtr->next) {
+	IndexChild(indexPtr, childPtr);
+    }
+    hPtr = Blt_CreateHashEntry(&parentPtr->treeObject->childTable, 
+	(char *)parentPtr, &isNew);
+    Blt_SetHashValue(hPtr, indexPtr);
+    parentPtr->flags |= TREE_NODE_CHILD_INDEX;
+    /* The array of children is filled the next time it's needed. */
+    parentPtr->flags &= ~TREE_NODE_POSITIONS;
+}
+
+static void
+DestroyChildIndex(ChildIndex *indexPtr)
+{
+    Blt_DeleteHashTable(&indexPtr->labelTable);
+    if (indexPtr->children != NULL) {
+	Blt_Free(indexPtr->children);
+    }
+    Blt_Free(indexPtr);
+}
+
+static void
+FreeChildIndex(Node *parentPtr)
+{
+    Blt_HashEntry *hPtr;
+
+    hPtr = Blt_FindHashEntry(&parentPtr->treeObject->childTable, 
+	(char *)parentPtr);
+    assert(hPtr);
+    DestroyChildIndex(Blt_GetHashValue(hPtr));
+    Blt_DeleteHashEntry(&parentPtr->treeObject->childTable, hPtr);
+    parentPtr->flags &= ~TREE_NODE_CHILD_INDEX;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -354,6 +873,31 @@ LinkBefore(
     }
     parentPtr->nChildren++;
     nodePtr->parent = parentPtr;
+    if (parentPtr->flags & TREE_NODE_POSITIONS) {
+	if (parentPtr->last == nodePtr) {
+	    /* Appending a node doesn't change the other positions. */
+	    nodePtr->position = parentPtr->nChildren - 1;
+	} else {
+	    parentPtr->flags &= ~TREE_NODE_POSITIONS;
+	}
+    }
+    if (parentPtr->flags & TREE_NODE_CHILD_INDEX) {
+	ChildIndex *indexPtr;
+
+	indexPtr = GetChildIndex(parentPtr);
+	IndexChild(indexPtr, nodePtr);
+	if (parentPtr->flags & TREE_NODE_POSITIONS) {
+	    if (parentPtr->nChildren > indexPtr->nAlloc) {
+		indexPtr->nAlloc = parentPtr->nChildren * 2;
+		indexPtr->children = Blt_Realloc(indexPtr->children, 
+			indexPtr->nAlloc * sizeof(Node *));
+		assert(indexPtr->children);
+	    }
+	    indexPtr->children[nodePtr->position] = nodePtr;
+	}
+    } else if (parentPtr->nChildren >= CHILD_INDEX_THRESHOLD) {
+	BuildChildIndex(parentPtr);
+    }
 }
 
 
@@ -377,6 +921,10 @@ UnlinkNode(Node *nodePtr)
     int unlinked;		/* Indicates if the link is actually
 				 * removed from the chain. */
     parentPtr = nodePtr->parent;
+    if ((parentPtr->flags & TREE_NODE_POSITIONS) && (nodePtr->next != NULL)) {
+	/* Only removing the last node keeps the other positions. */
+	parentPtr->flags &= ~TREE_NODE_POSITIONS;
+    }
     unlinked = FALSE;
     if (parentPtr->first == nodePtr) {
 	parentPtr->first = nodePtr->next;
@@ -397,6 +945,13 @@ UnlinkNode(Node *nodePtr)
     if (unlinked) {
 	parentPtr->nChildren--;
     }
+    if (parentPtr->flags & TREE_NODE_CHILD_INDEX) {
+	if (parentPtr->nChildren < (CHILD_INDEX_THRESHOLD / 2)) {
+	    FreeChildIndex(parentPtr);
+	} else {
+	    UnindexChild(GetChildIndex(parentPtr), nodePtr);
+	}
+    }
     nodePtr->prev = nodePtr->next = nodePtr->parent = NULL;
 }
 
@@ -416,17 +971,16 @@ UnlinkNode(Node *nodePtr)
 static void
 FreeNode(TreeObject *treeObjPtr, Node *nodePtr)
 {
-    Blt_HashEntry *hPtr;
-
     /*
      * Destroy any data fields associated with this node.
      */
     TreeDestroyValues(nodePtr);
     UnlinkNode(nodePtr);
+    if (nodePtr->flags & TREE_NODE_CHILD_INDEX) {
+	FreeChildIndex(nodePtr);
+    }
     treeObjPtr->nNodes--;
-    hPtr = Blt_FindHashEntry(&treeObjPtr->nodeTable, (char *)(intptr_t)nodePtr->inode);
-    assert(hPtr);
-    Blt_DeleteHashEntry(&treeObjPtr->nodeTable, hPtr);
+    RemoveNode(treeObjPtr, nodePtr->inode);
     nodePtr->inode = -1;
     nodePtr->flags = 0;
     Blt_PoolFreeItem(treeObjPtr->nodePool, (char *)nodePtr);
@@ -451,7 +1005,6 @@ NewTreeObject(TreeInterpData *dataPtr, Tcl_Interp *interp, CONST char *treeName)
 {
     TreeObject *treeObjPtr;
     int isNew;
-    Blt_HashEntry *hPtr;
 
     treeObjPtr = Blt_Calloc(1, sizeof(TreeObject));
     if (treeObjPtr == NULL) {
@@ -477,10 +1030,12 @@ NewTreeObject(TreeInterpData *dataPtr, Tcl_Interp *interp, CONST char *treeName)
     treeObjPtr->notifyFlags = 0;
     Blt_InitHashTable(&treeObjPtr->keyTable, BLT_STRING_KEYS);
     Blt_InitHashTableWithPool(&treeObjPtr->nodeTable, BLT_ONE_WORD_KEYS);
+    Blt_InitHashTable(&treeObjPtr->childTable, BLT_ONE_WORD_KEYS);
+    Blt_InitHashTable(&treeObjPtr->keyIndexTable, BLT_ONE_WORD_KEYS);
+    Blt_InitHashTable(&treeObjPtr->schemaTable, BLT_ONE_WORD_KEYS);
 
-    hPtr = Blt_CreateHashEntry(&treeObjPtr->nodeTable, (char *)0, &isNew);
     treeObjPtr->root = NewNode(treeObjPtr, treeName, 0);
-    Blt_SetHashValue(hPtr, treeObjPtr->root);
+    AddNode(treeObjPtr, 0, treeObjPtr->root);
 
     treeObjPtr->tablePtr = &dataPtr->treeTable;
     treeObjPtr->hashPtr = Blt_CreateHashEntry(treeObjPtr->tablePtr, treeName, 
@@ -580,7 +1135,7 @@ TeardownTree(TreeObject *treeObjPtr, Node *nodePtr)
 	    TeardownTree(treeObjPtr, childPtr);
 	}
     }
-    if (nodePtr->values != NULL) {
+    if ((nodePtr->values != NULL) || (nodePtr->slots != NULL)) {
 	TreeDestroyValues(nodePtr);
     }
     Blt_PoolFreeItem(treeObjPtr->nodePool, (char *)nodePtr);
@@ -590,6 +1145,8 @@ static void
 DestroyTreeObject(char *treeObj)
 {
     Blt_ChainLink *linkPtr;
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
     TreeClient *clientPtr;
     TreeObject *treeObjPtr = (TreeObject*)treeObj;
     
@@ -607,10 +1164,40 @@ DestroyTreeObject(char *treeObj)
     }
     Blt_ChainDestroy(treeObjPtr->clients);
 
+    DestroyKeyIndexes(treeObjPtr);
     TeardownTree(treeObjPtr, treeObjPtr->root);
+    Blt_DeleteHashTable(&treeObjPtr->keyIndexTable);
+    Blt_DeleteHashTable(&treeObjPtr->schemaTable);
+    if (treeObjPtr->schemaKeys != NULL) {
+	Blt_Free(treeObjPtr->schemaKeys);
+    }
+    for (hPtr = Blt_FirstHashEntry(&treeObjPtr->childTable, &cursor);
+	 hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	DestroyChildIndex(Blt_GetHashValue(hPtr));
+    }
+    Blt_DeleteHashTable(&treeObjPtr->childTable);
+    if (treeObjPtr->traceIndex != NULL) {
+	DestroyTraceIndex(treeObjPtr->traceIndex);
+	treeObjPtr->traceIndex = NULL;
+    }
+    if (treeObjPtr->batchPtr != NULL) {
+	FreeBatch(treeObjPtr->batchPtr);
+	treeObjPtr->batchPtr = NULL;
+    }
     Blt_PoolDestroy(treeObjPtr->nodePool);
     Blt_PoolDestroy(treeObjPtr->valuePool);
     Blt_DeleteHashTable(&treeObjPtr->nodeTable);
+    if (treeObjPtr->nodePages != NULL) {
+	unsigned int i;
+
+	for (i = 0; i < treeObjPtr->nPages; i++) {
+	    if (treeObjPtr->nodePages[i] != NULL) {
+		Blt_Free(treeObjPtr->nodePages[i]);
+	    }
+	}
+	Blt_Free(treeObjPtr->nodePages);
+	Blt_Free(treeObjPtr->pageCounts);
+    }
     Blt_DeleteHashTable(&treeObjPtr->keyTable);
 
     if (treeObjPtr->hashPtr != NULL) {
@@ -731,7 +1318,9 @@ CheckEventHandlers(
     TreeClient *clientPtr,
     int isSource,		/* Indicates if the client is the source
 				 * of the event. */
-    Blt_TreeNotifyEvent *eventPtr)
+    Blt_TreeNotifyEvent *eventPtr,
+    unsigned int skipMask)	/* Handlers with any of these bits
+				 * set are skipped. */
 {
     Blt_ChainLink *linkPtr, *nextPtr;
     EventHandler *notifyPtr;
@@ -746,6 +1335,9 @@ CheckEventHandlers(
 	    continue;		/* Ignore callbacks that are generated
 				 * inside of a notify handler routine. */
 	}
+	if (notifyPtr->mask & skipMask) {
+	    continue;
+	}
 	if ((isSource) && (notifyPtr->mask & TREE_NOTIFY_FOREIGN_ONLY)) {
 	    continue;		/* Don't notify yourself. */
 	}
@@ -775,43 +1367,174 @@ CheckEventHandlers(
 /*
  *----------------------------------------------------------------------
  *
- * NotifyClients --
+ * FreeBatch --
  *
- *	Traverses the list of clients for a particular tree and
- *	notifies each client that an event occurred.  Clients 
- *	indicate interest in a particular event through a bit
- *	flag.  
+ *	Releases the memory used by a batch, discarding any changes
+ *	still held back.
  *
- *---------------------------------------------------------------------- 
+ *----------------------------------------------------------------------
  */
-static int
-NotifyClients(
-    TreeClient *sourcePtr,
-    TreeObject *treeObjPtr,
-    Node *nodePtr,
-    int eventFlag)
+static void
+FreeBatch(TreeBatch *batchPtr)
 {
     Blt_ChainLink *linkPtr;
-    Blt_TreeNotifyEvent event;
-    TreeClient *clientPtr;
-    int isSource, result;
 
-    if (Tcl_InterpDeleted(treeObjPtr->interp) ||
-            Tcl_InterpDeleted(sourcePtr->root->treeObject->interp)) {
-        return TCL_OK;
+    for (linkPtr = Blt_ChainFirstLink(batchPtr->events); linkPtr != NULL;
+	 linkPtr = Blt_ChainNextLink(linkPtr)) {
+	Blt_Free(Blt_ChainGetValue(linkPtr));
     }
-    event.type = eventFlag;
-    event.inode = nodePtr->inode;
+    for (linkPtr = Blt_ChainFirstLink(batchPtr->traces); linkPtr != NULL;
+	 linkPtr = Blt_ChainNextLink(linkPtr)) {
+	Blt_Free(Blt_ChainGetValue(linkPtr));
+    }
+    Blt_ChainDestroy(batchPtr->events);
+    Blt_ChainDestroy(batchPtr->parents);
+    Blt_ChainDestroy(batchPtr->traces);
+    Blt_DeleteHashTable(&batchPtr->eventTable);
+    Blt_DeleteHashTable(&batchPtr->parentTable);
+    Blt_DeleteHashTable(&batchPtr->traceTable);
+    Blt_Free(batchPtr);
+}
 
-    /* 
-     * Issue callbacks to each client indicating that a new node has
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeferEvent --
+ *
+ *	Holds back a notification until the batch ends.  Events for
+ *	the same node are merged.  The parent of the node (the node
+ *	itself for sorts) is remembered for handlers that take
+ *	TREE_NOTIFY_BATCH events.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+DeferEvent(TreeBatch *batchPtr, Node *nodePtr, unsigned int eventFlag)
+{
+    Blt_HashEntry *hPtr;
+    BatchEvent *eventPtr;
+    Node *parentPtr;
+    int isNew;
+
+    hPtr = Blt_CreateHashEntry(&batchPtr->eventTable, 
+	(char *)(unsigned long)nodePtr->inode, &isNew);
+    if (isNew) {
+	eventPtr = Blt_Malloc(sizeof(BatchEvent));
+	assert(eventPtr);
+	eventPtr->inode = nodePtr->inode;
+	eventPtr->mask = 0;
+	Blt_SetHashValue(hPtr, eventPtr);
+	Blt_ChainAppend(batchPtr->events, eventPtr);
+    } else {
+	eventPtr = Blt_GetHashValue(hPtr);
+    }
+    eventPtr->mask |= eventFlag;
+
+    parentPtr = nodePtr->parent;
+    if ((eventFlag == TREE_NOTIFY_SORT) || (parentPtr == NULL)) {
+	parentPtr = nodePtr;
+    }
+    hPtr = Blt_CreateHashEntry(&batchPtr->parentTable, 
+	(char *)(unsigned long)parentPtr->inode, &isNew);
+    if (isNew) {
+	Blt_ChainAppend(batchPtr->parents, 
+		(ClientData)(unsigned long)parentPtr->inode);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeferTrace --
+ *
+ *	Holds back a write or unset trace until the batch ends.  The
+ *	flags of repeated changes to the same value are merged, so that
+ *	the value's traces fire once, reporting its final state.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+DeferTrace(
+    TreeBatch *batchPtr,
+    Node *nodePtr,
+    Blt_TreeKey key,
+    unsigned int flags)
+{
+    Blt_HashEntry *hPtr;
+    BatchTrace *tracePtr;
+    BatchTraceKey traceKey;
+    int isNew;
+
+    memset(&traceKey, 0, sizeof(traceKey));
+    traceKey.key = key;
+    traceKey.inode = nodePtr->inode;
+    hPtr = Blt_CreateHashEntry(&batchPtr->traceTable, (char *)&traceKey, 
+	&isNew);
+    if (isNew) {
+	tracePtr = Blt_Malloc(sizeof(BatchTrace));
+	assert(tracePtr);
+	tracePtr->key = traceKey;
+	tracePtr->flags = flags;
+	Blt_SetHashValue(hPtr, tracePtr);
+	Blt_ChainAppend(batchPtr->traces, tracePtr);
+	return;
+    }
+    tracePtr = Blt_GetHashValue(hPtr);
+    if ((flags & TREE_TRACE_UNSET) == 0) {
+	/* Keep the create bit of an earlier write. */
+	if ((tracePtr->flags & TREE_TRACE_UNSET) == 0) {
+	    flags |= (tracePtr->flags & TREE_TRACE_CREATE);
+	}
+    }
+    tracePtr->flags = flags;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NotifyClients --
+ *
+ *	Traverses the list of clients for a particular tree and
+ *	notifies each client that an event occurred.  Clients 
+ *	indicate interest in a particular event through a bit
+ *	flag.  
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+NotifyClients(
+    TreeClient *sourcePtr,
+    TreeObject *treeObjPtr,
+    Node *nodePtr,
+    int eventFlag)
+{
+    Blt_ChainLink *linkPtr;
+    Blt_TreeNotifyEvent event;
+    TreeClient *clientPtr;
+    int isSource, result;
+
+    if (Tcl_InterpDeleted(treeObjPtr->interp) ||
+            Tcl_InterpDeleted(sourcePtr->root->treeObject->interp)) {
+        return TCL_OK;
+    }
+    if ((treeObjPtr->batchPtr != NULL) && 
+	(treeObjPtr->batchPtr->clientPtr == sourcePtr) &&
+	(eventFlag & TREE_NOTIFY_DEFERRED)) {
+	DeferEvent(treeObjPtr->batchPtr, nodePtr, eventFlag);
+	return TCL_OK;
+    }
+    event.type = eventFlag;
+    event.inode = nodePtr->inode;
+
+    /* 
+     * Issue callbacks to each client indicating that a new node has
      * been created.
      */
     for (linkPtr = Blt_ChainFirstLink(treeObjPtr->clients);
 	linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
 	clientPtr = Blt_ChainGetValue(linkPtr);
 	isSource = (clientPtr == sourcePtr);
-	result = CheckEventHandlers(clientPtr, isSource, &event);
+	result = CheckEventHandlers(clientPtr, isSource, &event, 0);
 	if (result != TCL_OK) {
 	    return TCL_ERROR;
 	}
@@ -822,9 +1545,387 @@ NotifyClients(
     return TCL_OK;
 }
 
+/*
+ * KeyIndex --
+ *
+ *	Secondary index of the values of a key, shared by all clients
+ *	of the tree object.  It maps each value to the nodes holding
+ *	it and is kept up to date as values are set and unset.  Values
+ *	are hashed as strings, or as decimal integers or doubles for
+ *	typed indexes (values that aren't numbers are then hashed as
+ *	strings).  Ordered indexes also keep the distinct values in
+ *	sorted order for range lookups.  The order is rebuilt the
+ *	first time it's needed after new values were added.
+ */
+typedef struct KeyIndexStruct KeyIndex;
+typedef struct IndexSlotStruct IndexSlot;
+
+typedef struct {
+    Blt_HashTable *tablePtr;	/* Table holding the bucket. */
+    Blt_HashEntry *hPtr;
+    int typed;			/* Value is a number of the index type. */
+    union {
+	Tcl_WideInt i;
+	double d;
+    } number;
+    CONST char *string;		/* Value of string buckets. */
+    IndexSlot **slots;		/* Nodes holding the value. */
+    int nSlots, nAlloc;
+} KeyIndexBucket;
+
+struct IndexSlotStruct {
+    Node *nodePtr;
+    KeyIndexBucket *bucketPtr;
+    int position;		/* Index of the slot in the bucket. */
+};
+
+struct KeyIndexStruct {
+    Blt_TreeKey key;
+    int type;			/* TREE_INDEX_STRING, _INTEGER or _REAL. */
+    int flags;			/* TREE_INDEX_ORDERED */
+    Blt_HashTable valueTable;	/* Value -> bucket. */
+    Blt_HashTable stringTable;	/* Non-numeric values of typed indexes. */
+    Blt_HashTable nodeTable;	/* Node -> slot. */
+    Blt_Pool slotPool;
+    KeyIndexBucket **order;	/* Buckets of the value table, sorted. */
+    int nOrder;
+    int orderDirty;
+};
+
+/*
+ * Parses a decimal integer.  Unlike Tcl_GetWideInt, octal and hex
+ * forms aren't numbers here, so that equal integers have equal 
+ * strings.
+ */
+static int
+ParseIndexInteger(CONST char *string, Tcl_WideInt *valuePtr)
+{
+    CONST char *p;
+    Tcl_WideUInt value, limit;
+    int negative;
+
+    p = string;
+    negative = (*p == '-');
+    if ((*p == '-') || (*p == '+')) {
+	p++;
+    }
+    if (!isdigit(UCHAR(*p))) {
+	return TCL_ERROR;
+    }
+    limit = (negative) ? ((Tcl_WideUInt)1 << 63) : 
+	(((Tcl_WideUInt)1 << 63) - 1);
+    value = 0;
+    for (/*empty*/; isdigit(UCHAR(*p)); p++) {
+	if (value > (limit - (*p - '0')) / 10) {
+	    return TCL_ERROR;		/* Overflow */
+	}
+	value = value * 10 + (*p - '0');
+    }
+    if (*p != '\0') {
+	return TCL_ERROR;
+    }
+    *valuePtr = (negative) ? -(Tcl_WideInt)(value - 1) - 1 : 
+	(Tcl_WideInt)value;
+    return TCL_OK;
+}
+
+/*
+ * Converts a value string into the key of its bucket.  Returns the
+ * table the bucket belongs in.
+ */
+static Blt_HashTable *
+KeyIndexValueKey(
+    KeyIndex *indexPtr,
+    CONST char *string,
+    KeyIndexBucket *numberPtr,	/* Gets the converted number. */
+    CONST char **keyPtr)
+{
+    if (indexPtr->type == TREE_INDEX_INTEGER) {
+	if (ParseIndexInteger(string, &numberPtr->number.i) == TCL_OK) {
+	    *keyPtr = (CONST char *)&numberPtr->number.i;
+	    return &indexPtr->valueTable;
+	}
+    } else if (indexPtr->type == TREE_INDEX_REAL) {
+	double d;
+
+	if (Tcl_GetDouble((Tcl_Interp *)NULL, string, &d) == TCL_OK) {
+	    memset(&numberPtr->number, 0, sizeof(numberPtr->number));
+	    numberPtr->number.d = (d == 0.0) ? 0.0 : d; /* Fold -0.0 */
+	    *keyPtr = (CONST char *)&numberPtr->number.d;
+	    return &indexPtr->valueTable;
+	}
+    } else {
+	*keyPtr = string;
+	return &indexPtr->valueTable;
+    }
+    *keyPtr = string;
+    return &indexPtr->stringTable;
+}
+
+static KeyIndexBucket *
+FindKeyIndexBucket(KeyIndex *indexPtr, CONST char *string)
+{
+    KeyIndexBucket number;
+    Blt_HashTable *tablePtr;
+    Blt_HashEntry *hPtr;
+    CONST char *key;
+
+    tablePtr = KeyIndexValueKey(indexPtr, string, &number, &key);
+    hPtr = Blt_FindHashEntry(tablePtr, key);
+    return (hPtr == NULL) ? NULL : Blt_GetHashValue(hPtr);
+}
+
+static KeyIndexBucket *
+CreateKeyIndexBucket(KeyIndex *indexPtr, CONST char *string)
+{
+    KeyIndexBucket number, *bucketPtr;
+    Blt_HashTable *tablePtr;
+    Blt_HashEntry *hPtr;
+    CONST char *key;
+    int isNew;
+
+    tablePtr = KeyIndexValueKey(indexPtr, string, &number, &key);
+    hPtr = Blt_CreateHashEntry(tablePtr, key, &isNew);
+    if (!isNew) {
+	return Blt_GetHashValue(hPtr);
+    }
+    bucketPtr = Blt_Calloc(1, sizeof(KeyIndexBucket));
+    assert(bucketPtr);
+    bucketPtr->tablePtr = tablePtr;
+    bucketPtr->hPtr = hPtr;
+    bucketPtr->typed = ((tablePtr == &indexPtr->valueTable) &&
+			(indexPtr->type != TREE_INDEX_STRING));
+    bucketPtr->number = number.number;
+    bucketPtr->string = Blt_GetHashKey(tablePtr, hPtr);
+    Blt_SetHashValue(hPtr, bucketPtr);
+    if (tablePtr == &indexPtr->valueTable) {
+	indexPtr->orderDirty = TRUE;
+    }
+    return bucketPtr;
+}
+
+/*
+ * Removes the node from the index, if it's there.
+ */
+static void
+UnindexNodeValue(KeyIndex *indexPtr, Node *nodePtr)
+{
+    Blt_HashEntry *hPtr;
+    KeyIndexBucket *bucketPtr;
+    IndexSlot *slotPtr;
+
+    hPtr = Blt_FindHashEntry(&indexPtr->nodeTable, (char *)nodePtr);
+    if (hPtr == NULL) {
+	return;
+    }
+    slotPtr = Blt_GetHashValue(hPtr);
+    Blt_DeleteHashEntry(&indexPtr->nodeTable, hPtr);
+    bucketPtr = slotPtr->bucketPtr;
+    bucketPtr->nSlots--;
+    if (slotPtr->position < bucketPtr->nSlots) {
+	/* Move the last slot into the hole. */
+	IndexSlot *lastPtr;
+
+	lastPtr = bucketPtr->slots[bucketPtr->nSlots];
+	lastPtr->position = slotPtr->position;
+	bucketPtr->slots[slotPtr->position] = lastPtr;
+    }
+    Blt_PoolFreeItem(indexPtr->slotPool, (char *)slotPtr);
+    if (bucketPtr->nSlots == 0) {
+	if (bucketPtr->tablePtr == &indexPtr->valueTable) {
+	    indexPtr->orderDirty = TRUE;
+	}
+	Blt_DeleteHashEntry(bucketPtr->tablePtr, bucketPtr->hPtr);
+	Blt_Free(bucketPtr->slots);
+	Blt_Free(bucketPtr);
+    }
+}
+
+/*
+ * Files the node under its current value of the key.
+ */
+static void
+IndexNodeValue(KeyIndex *indexPtr, Node *nodePtr, Tcl_Obj *objPtr)
+{
+    Blt_HashEntry *hPtr;
+    KeyIndexBucket *bucketPtr;
+    IndexSlot *slotPtr;
+    int isNew;
+
+    UnindexNodeValue(indexPtr, nodePtr);
+    if (objPtr == NULL) {
+	return;
+    }
+    bucketPtr = CreateKeyIndexBucket(indexPtr, Tcl_GetString(objPtr));
+    if (bucketPtr->nSlots == bucketPtr->nAlloc) {
+	bucketPtr->nAlloc = (bucketPtr->nAlloc == 0) ? 1 : 
+	    bucketPtr->nAlloc * 2;
+	bucketPtr->slots = Blt_Realloc(bucketPtr->slots, 
+		bucketPtr->nAlloc * sizeof(IndexSlot *));
+	assert(bucketPtr->slots);
+    }
+    slotPtr = Blt_PoolAllocItem(indexPtr->slotPool, sizeof(IndexSlot));
+    slotPtr->nodePtr = nodePtr;
+    slotPtr->bucketPtr = bucketPtr;
+    slotPtr->position = bucketPtr->nSlots;
+    bucketPtr->slots[bucketPtr->nSlots++] = slotPtr;
+    hPtr = Blt_CreateHashEntry(&indexPtr->nodeTable, (char *)nodePtr, &isNew);
+    Blt_SetHashValue(hPtr, slotPtr);
+}
+
+/*
+ * Hooks called when a value is changed or freed.
+ */
+static void
+IndexValue(Node *nodePtr, Blt_TreeKey key, Tcl_Obj *objPtr)
+{
+    TreeObject *treeObjPtr = nodePtr->treeObject;
+    Blt_HashEntry *hPtr;
+
+    if (treeObjPtr->keyIndexTable.numEntries == 0) {
+	return;
+    }
+    hPtr = Blt_FindHashEntry(&treeObjPtr->keyIndexTable, key);
+    if (hPtr != NULL) {
+	IndexNodeValue(Blt_GetHashValue(hPtr), nodePtr, objPtr);
+    }
+}
+
+static void
+UnindexValue(Node *nodePtr, Blt_TreeKey key)
+{
+    TreeObject *treeObjPtr = nodePtr->treeObject;
+    Blt_HashEntry *hPtr;
+
+    if (treeObjPtr->keyIndexTable.numEntries == 0) {
+	return;
+    }
+    hPtr = Blt_FindHashEntry(&treeObjPtr->keyIndexTable, key);
+    if (hPtr != NULL) {
+	UnindexNodeValue(Blt_GetHashValue(hPtr), nodePtr);
+    }
+}
+
+static void
+DestroyKeyIndex(KeyIndex *indexPtr)
+{
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
+    KeyIndexBucket *bucketPtr;
+    Blt_HashTable *tablePtr;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+	tablePtr = (i == 0) ? &indexPtr->valueTable : &indexPtr->stringTable;
+	for (hPtr = Blt_FirstHashEntry(tablePtr, &cursor); hPtr != NULL; 
+	     hPtr = Blt_NextHashEntry(&cursor)) {
+	    bucketPtr = Blt_GetHashValue(hPtr);
+	    Blt_Free(bucketPtr->slots);
+	    Blt_Free(bucketPtr);
+	}
+	Blt_DeleteHashTable(tablePtr);
+    }
+    Blt_DeleteHashTable(&indexPtr->nodeTable);
+    Blt_PoolDestroy(indexPtr->slotPool);
+    if (indexPtr->order != NULL) {
+	Blt_Free(indexPtr->order);
+    }
+    Blt_Free(indexPtr);
+}
+
+static void
+DestroyKeyIndexes(TreeObject *treeObjPtr)
+{
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
+
+    /* 
+     * Empty the table first, so that the values freed when tearing
+     * down the tree aren't looked up in the indexes. 
+     */
+    for (hPtr = Blt_FirstHashEntry(&treeObjPtr->keyIndexTable, &cursor); 
+	 hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	DestroyKeyIndex(Blt_GetHashValue(hPtr));
+	Blt_DeleteHashEntry(&treeObjPtr->keyIndexTable, hPtr);
+    }
+}
+
+static int keyIndexType;	/* Type of the index being sorted. */
+
+static int
+CompareKeyIndexBuckets(const void *a, const void *b)
+{
+    KeyIndexBucket *b1Ptr = *(KeyIndexBucket **)a;
+    KeyIndexBucket *b2Ptr = *(KeyIndexBucket **)b;
+
+    switch (keyIndexType) {
+    case TREE_INDEX_INTEGER:
+	return (b1Ptr->number.i < b2Ptr->number.i) ? -1 : 
+	    (b1Ptr->number.i > b2Ptr->number.i);
+    case TREE_INDEX_REAL:
+	return (b1Ptr->number.d < b2Ptr->number.d) ? -1 : 
+	    (b1Ptr->number.d > b2Ptr->number.d);
+    default:
+	return strcmp(b1Ptr->string, b2Ptr->string);
+    }
+}
+
+static void
+SortKeyIndex(KeyIndex *indexPtr)
+{
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
+    int n;
+
+    if (!indexPtr->orderDirty) {
+	return;
+    }
+    if (indexPtr->order != NULL) {
+	Blt_Free(indexPtr->order);
+    }
+    indexPtr->order = Blt_Malloc(sizeof(KeyIndexBucket *) * 
+	(indexPtr->valueTable.numEntries + 1));
+    assert(indexPtr->order);
+    n = 0;
+    for (hPtr = Blt_FirstHashEntry(&indexPtr->valueTable, &cursor); 
+	 hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	indexPtr->order[n++] = Blt_GetHashValue(hPtr);
+    }
+    keyIndexType = indexPtr->type;
+    qsort(indexPtr->order, n, sizeof(KeyIndexBucket *), 
+	CompareKeyIndexBuckets);
+    indexPtr->nOrder = n;
+    indexPtr->orderDirty = FALSE;
+}
+
+/*
+ * Appends the nodes of a bucket to a growable array.
+ */
+static void
+AppendBucketNodes(
+    KeyIndexBucket *bucketPtr, 
+    Node ***nodesPtr, 
+    int *nNodesPtr, 
+    int *nAllocPtr)
+{
+    int i;
+
+    if (*nNodesPtr + bucketPtr->nSlots > *nAllocPtr) {
+	while (*nNodesPtr + bucketPtr->nSlots > *nAllocPtr) {
+	    *nAllocPtr = (*nAllocPtr == 0) ? 16 : *nAllocPtr * 2;
+	}
+	*nodesPtr = Blt_Realloc(*nodesPtr, *nAllocPtr * sizeof(Node *));
+	assert(*nodesPtr);
+    }
+    for (i = 0; i < bucketPtr->nSlots; i++) {
+	(*nodesPtr)[(*nNodesPtr)++] = bucketPtr->slots[i]->nodePtr;
+    }
+}
+
 static void
 FreeValue(Node *nodePtr, Value *valuePtr)
 {
+    UnindexValue(nodePtr, valuePtr->key);
     if (valuePtr->objPtr != NULL) {
 	Tcl_DecrRefCount(valuePtr->objPtr);
     }
@@ -900,6 +2001,20 @@ static void SetModified(Node *nodePtr)
     nodePtr->treeObject->flags &= ~TREE_UNMODIFIED;
 }
 
+/* Snapshots can't be changed, except for their tags. */
+static int 
+CheckWritable(Tcl_Interp *interp, TreeObject *treeObjPtr)
+{
+    if (treeObjPtr->flags & TREE_SNAPSHOT) {
+	if (interp != NULL) {
+	    Tcl_AppendResult(interp, "tree \"", treeObjPtr->name, 
+		"\" is a read-only snapshot", (char *)NULL);
+	}
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -922,32 +2037,27 @@ Blt_TreeCreateNode(
     int pos)			/* Position in the parent's list of children
 				 * where to insert the new node. */
 {
-    Blt_HashEntry *hPtr;
     Node *beforePtr;
     Node *nodePtr;	/* Node to be inserted. */
     TreeObject *treeObjPtr;
     int inode;
-    int isNew;
 
     treeObjPtr = parentPtr->treeObject;
+    if (CheckWritable(NULL, treeObjPtr) != TCL_OK) {
+	return NULL;
+    }
 
     /* Generate an unique serial number for this node.  */
     do {
 	inode = treeObjPtr->nextInode++;
-	hPtr = Blt_CreateHashEntry(&treeObjPtr->nodeTable,(char *)(intptr_t)inode, 
-		   &isNew);
-    } while (!isNew);
+    } while (LookupNode(treeObjPtr, inode) != NULL);
     nodePtr = NewNode(treeObjPtr, name, inode);
-    Blt_SetHashValue(hPtr, nodePtr);
+    AddNode(treeObjPtr, inode, nodePtr);
 
     if ((pos == -1) || (pos >= (int)parentPtr->nChildren)) {
 	beforePtr = NULL;
     } else {
-	beforePtr = parentPtr->first;
-	while ((pos > 0) && (beforePtr != NULL)) {
-	    pos--;
-	    beforePtr = beforePtr->next;
-	}
+	beforePtr = Blt_TreeNthChild(parentPtr, MAX(pos, 0));
     }
     LinkBefore(parentPtr, nodePtr, beforePtr);
     nodePtr->depth = parentPtr->depth + 1;
@@ -996,7 +2106,9 @@ Blt_TreeNotifyGet(
 				 * the initiating client also. */
     Node *nodePtr)		    /*  node */
 {
-    if (nodePtr->nValues != 0) return TCL_OK;
+    if ((nodePtr->nValues != 0) || (nodePtr->nSlotValues != 0)) {
+	return TCL_OK;
+    }
     return NotifyClients(clientPtr, nodePtr->treeObject, nodePtr, TREE_NOTIFY_GET);
 }
 
@@ -1023,28 +2135,23 @@ Blt_TreeCreateNodeWithId(
     int position)		/* Position in the parent's list of children
 				 * where to insert the new node. */
 {
-    Blt_HashEntry *hPtr;
     Node *beforePtr;
     Node *nodePtr;	/* Node to be inserted. */
     TreeObject *treeObjPtr;
-    int isNew, result;
+    int result;
 
     treeObjPtr = parentPtr->treeObject;
-    hPtr = Blt_CreateHashEntry(&treeObjPtr->nodeTable,(char *)(intptr_t)inode, &isNew);
-    if (!isNew) {
+    if ((CheckWritable(NULL, treeObjPtr) != TCL_OK) || 
+	(LookupNode(treeObjPtr, inode) != NULL)) {
 	return NULL;
     }
     nodePtr = NewNode(treeObjPtr, name, inode);
-    Blt_SetHashValue(hPtr, nodePtr);
+    AddNode(treeObjPtr, inode, nodePtr);
 
     if ((position == -1) || (position >= (int)parentPtr->nChildren)) {
 	beforePtr = NULL;
     } else {
-	beforePtr = parentPtr->first;
-	while ((position > 0) && (beforePtr != NULL)) {
-	    position--;
-	    beforePtr = beforePtr->next;
-	}
+	beforePtr = Blt_TreeNthChild(parentPtr, MAX(position, 0));
     }
     LinkBefore(parentPtr, nodePtr, beforePtr);
     nodePtr->depth = parentPtr->depth + 1;
@@ -1084,6 +2191,9 @@ Blt_TreeMoveNode(
     TreeObject *treeObjPtr = nodePtr->treeObject;
     int newDepth, result;
 
+    if (CheckWritable(NULL, treeObjPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
     if (nodePtr == beforePtr) {
 	return TCL_ERROR;
     }
@@ -1140,6 +2250,9 @@ Blt_TreeDeleteNode(TreeClient *clientPtr, Node *nodePtr)
     if (Blt_TreeNodeDeleted(nodePtr)) {
         return TCL_OK;
     }
+    if (CheckWritable(NULL, treeObjPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
     if ((nodePtr->flags & TREE_NODE_INSERT_FAIL) == 0 &&
         (result=NotifyClients(clientPtr, treeObjPtr, nodePtr, TREE_NOTIFY_DELETE)) != TCL_OK) {
         return result;
@@ -1154,7 +2267,7 @@ Blt_TreeDeleteNode(TreeClient *clientPtr, Node *nodePtr)
 
     /* Now remove the actual node. */
     FreeNode(treeObjPtr, nodePtr);
-    if (treeObjPtr->nodeTable.numEntries <= 1) {
+    if (treeObjPtr->nNodes <= 1) {
         treeObjPtr->nextInode = 1;
     }
     return TCL_OK;
@@ -1163,29 +2276,157 @@ Blt_TreeDeleteNode(TreeClient *clientPtr, Node *nodePtr)
 Blt_TreeNode
 Blt_TreeGetNode(TreeClient *clientPtr, unsigned int inode)
 {
-    TreeObject *treeObjPtr = clientPtr->treeObject;
-    Blt_HashEntry *hPtr;
-
-    hPtr = Blt_FindHashEntry(&treeObjPtr->nodeTable, (char *)(intptr_t)inode);
-    if (hPtr != NULL) {
-	return (Blt_TreeNode)Blt_GetHashValue(hPtr);
-    }
-    return NULL;
+    return LookupNode(clientPtr->treeObject, inode);
 }
 
 /*
 static Node*
 GetNode(TreeObject *treeObjPtr, unsigned int inode)
 {
+    return LookupNode(treeObjPtr, inode);
+}
+*/
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IndexTrace --
+ *
+ *	Files the trace in the tree object's trace index.  Key
+ *	patterns without glob characters are indexed by the key
+ *	itself.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+IndexTrace(TreeObject *treeObjPtr, TraceHandler *tracePtr)
+{
+    TraceIndex *indexPtr;
+    Blt_HashTable *tablePtr;
+    Blt_Chain *chainPtr;
+    CONST char *key;
+
+    indexPtr = treeObjPtr->traceIndex;
+    if (indexPtr == NULL) {
+	indexPtr = Blt_Calloc(1, sizeof(TraceIndex));
+	assert(indexPtr);
+	Blt_InitHashTable(&indexPtr->keyTable, BLT_STRING_KEYS);
+	Blt_InitHashTable(&indexPtr->nodeTable, BLT_ONE_WORD_KEYS);
+	Blt_InitHashTable(&indexPtr->tagTable, BLT_STRING_KEYS);
+	indexPtr->others = Blt_ChainCreate();
+	treeObjPtr->traceIndex = indexPtr;
+    }
+    tracePtr->serial = indexPtr->nextSerial++;
+    indexPtr->nTraces++;
+
+    tablePtr = NULL;
+    key = NULL;
+    if ((tracePtr->keyPattern != NULL) &&
+	(strpbrk(tracePtr->keyPattern, "*?[\\") == NULL)) {
+	tablePtr = &indexPtr->keyTable;
+	key = tracePtr->keyPattern;
+    } else if (tracePtr->nodePtr != NULL) {
+	tablePtr = &indexPtr->nodeTable;
+	key = (char *)tracePtr->nodePtr;
+    } else if (tracePtr->withTag != NULL) {
+	tablePtr = &indexPtr->tagTable;
+	key = tracePtr->withTag;
+    }
+    tracePtr->bucketTablePtr = tablePtr;
+    if (tablePtr == NULL) {
+	tracePtr->bucketPtr = NULL;
+	chainPtr = indexPtr->others;
+    } else {
+	int isNew;
+
+	tracePtr->bucketPtr = Blt_CreateHashEntry(tablePtr, key, &isNew);
+	if (isNew) {
+	    Blt_SetHashValue(tracePtr->bucketPtr, Blt_ChainCreate());
+	}
+	chainPtr = Blt_GetHashValue(tracePtr->bucketPtr);
+    }
+    tracePtr->bucketLinkPtr = Blt_ChainAppend(chainPtr, tracePtr);
+}
+
+static void
+UnindexTrace(TreeObject *treeObjPtr, TraceHandler *tracePtr)
+{
+    TraceIndex *indexPtr;
+
+    indexPtr = treeObjPtr->traceIndex;
+    if (tracePtr->bucketPtr == NULL) {
+	Blt_ChainDeleteLink(indexPtr->others, tracePtr->bucketLinkPtr);
+    } else {
+	Blt_Chain *chainPtr;
+
+	chainPtr = Blt_GetHashValue(tracePtr->bucketPtr);
+	Blt_ChainDeleteLink(chainPtr, tracePtr->bucketLinkPtr);
+	if (Blt_ChainGetLength(chainPtr) == 0) {
+	    Blt_ChainDestroy(chainPtr);
+	    Blt_DeleteHashEntry(tracePtr->bucketTablePtr, tracePtr->bucketPtr);
+	}
+    }
+    indexPtr->nTraces--;
+}
+
+static void
+DestroyTraceIndex(TraceIndex *indexPtr)
+{
+    Blt_HashTable *tables[3];
     Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
+    int i;
+
+    tables[0] = &indexPtr->keyTable;
+    tables[1] = &indexPtr->nodeTable;
+    tables[2] = &indexPtr->tagTable;
+    for (i = 0; i < 3; i++) {
+	for (hPtr = Blt_FirstHashEntry(tables[i], &cursor); hPtr != NULL; 
+	     hPtr = Blt_NextHashEntry(&cursor)) {
+	    Blt_ChainDestroy((Blt_Chain *)Blt_GetHashValue(hPtr));
+	}
+	Blt_DeleteHashTable(tables[i]);
+    }
+    Blt_ChainDestroy(indexPtr->others);
+    Blt_Free(indexPtr);
+}
 
-    hPtr = Blt_FindHashEntry(&treeObjPtr->nodeTable, (char *)(intptr_t)inode);
-    if (hPtr != NULL) {
-	return (Node*)Blt_GetHashValue(hPtr);
+static void
+FreeTrace(DestroyData data)
+{
+    TraceHandler *tracePtr = (TraceHandler *)data;
+
+    if (tracePtr->keyPattern != NULL) {
+	Blt_Free(tracePtr->keyPattern);
     }
-    return NULL;
+    if (tracePtr->withTag != NULL) {
+	Blt_Free(tracePtr->withTag);
+    }
+    Blt_Free(tracePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RemoveTrace --
+ *
+ *	Removes the trace from its client and the trace index.  The
+ *	trace is freed once CallTraces is no longer using it.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+RemoveTrace(TraceHandler *tracePtr)
+{
+    TreeObject *treeObjPtr;
+
+    treeObjPtr = tracePtr->clientPtr->treeObject;
+    if ((treeObjPtr != NULL) && (treeObjPtr->traceIndex != NULL)) {
+	UnindexTrace(treeObjPtr, tracePtr);
+    }
+    tracePtr->deleted = TRUE;
+    Tcl_EventuallyFree(tracePtr, FreeTrace);
 }
-*/
 
 Blt_TreeTrace
 Blt_TreeCreateTrace(
@@ -1213,6 +2454,7 @@ Blt_TreeCreateTrace(
     tracePtr->clientData = clientData;
     tracePtr->mask = mask;
     tracePtr->nodePtr = nodePtr;
+    IndexTrace(clientPtr->treeObject, tracePtr);
     return (Blt_TreeTrace)tracePtr;
 }
 
@@ -1222,24 +2464,50 @@ Blt_TreeDeleteTrace(Blt_TreeTrace trace)
     TraceHandler *tracePtr = (TraceHandler *)trace;
 
     Blt_ChainDeleteLink(tracePtr->clientPtr->traces, tracePtr->linkPtr);
-    if (tracePtr->keyPattern != NULL) {
-	Blt_Free(tracePtr->keyPattern);
+    RemoveTrace(tracePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RelabelNode --
+ *
+ *	Changes the label of the node, updating the label index of
+ *	its parent.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+RelabelNode(Node *nodePtr, Blt_TreeKey label)
+{
+    ChildIndex *indexPtr;
+
+    indexPtr = NULL;
+    if (nodePtr->parent != NULL) {
+	indexPtr = GetChildIndex(nodePtr->parent);
     }
-    if (tracePtr->withTag != NULL) {
-	Blt_Free(tracePtr->withTag);
+    if (indexPtr != NULL) {
+	UnindexChild(indexPtr, nodePtr);
+    }
+    nodePtr->label = label;
+    if (indexPtr != NULL) {
+	IndexChild(indexPtr, nodePtr);
     }
-    Blt_Free(tracePtr);
 }
 
 int
 Blt_TreeRelabelNode(TreeClient *clientPtr, Node *nodePtr, CONST char *string)
 {
     int result;
+
+    if (CheckWritable(NULL, nodePtr->treeObject) != TCL_OK) {
+	return TCL_ERROR;
+    }
     if ((result=NotifyClients(clientPtr, clientPtr->treeObject, nodePtr, 
 		  TREE_NOTIFY_RELABEL)) != TCL_OK) {
 	return result;
     }
-    nodePtr->label = Blt_TreeKeyGet(NULL, clientPtr->treeObject,string);
+    RelabelNode(nodePtr, Blt_TreeKeyGet(NULL, clientPtr->treeObject,string));
     /* 
      * Issue callbacks to each client indicating that a new node has
      * been created.
@@ -1262,7 +2530,10 @@ Blt_TreeNotifyAttach(TreeClient *clientPtr)
 int
 Blt_TreeRelabelNode2(Node *nodePtr, CONST char *string)
 {
-    nodePtr->label = Blt_TreeKeyGet(NULL, nodePtr->treeObject,string);
+    if (CheckWritable(NULL, nodePtr->treeObject) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    RelabelNode(nodePtr, Blt_TreeKeyGet(NULL, nodePtr->treeObject,string));
     SetModified(nodePtr);
     return TCL_OK;
 }
@@ -1273,6 +2544,8 @@ Blt_TreeRelabelNode2(Node *nodePtr, CONST char *string)
  * Blt_TreeFindChild --
  *
  *	Searches for the named node in a parent's chain of siblings.  
+ *	Nodes with many children use the hash table of their
+ *	children's labels instead.
  *
  *
  * Results:
@@ -1287,6 +2560,19 @@ Blt_TreeFindChild(Node *parentPtr, CONST char *string)
     register Node *nodePtr;
     
     label = Blt_TreeKeyGet(NULL, parentPtr->treeObject,string);
+    if (parentPtr->flags & TREE_NODE_CHILD_INDEX) {
+	Blt_HashEntry *hPtr;
+
+	hPtr = Blt_FindHashEntry(&GetChildIndex(parentPtr)->labelTable, label);
+	if (hPtr == NULL) {
+	    return NULL;
+	}
+	nodePtr = Blt_GetHashValue(hPtr);
+	if (nodePtr != NULL) {
+	    return nodePtr;
+	}
+	/* Several children have the label. Find the first one. */
+    }
     for (nodePtr = parentPtr->first; nodePtr != NULL; nodePtr = nodePtr->next) {
 	if (label == nodePtr->label) {
 	    return nodePtr;
@@ -1311,6 +2597,18 @@ Blt_TreeFindChildRev(Node *parentPtr, CONST char *string, int firstN)
         return Blt_TreeFindChild(parentPtr, string);
     }
     label = Blt_TreeKeyGet(NULL, parentPtr->treeObject,string);
+    if (parentPtr->flags & TREE_NODE_CHILD_INDEX) {
+	Blt_HashEntry *hPtr;
+
+	hPtr = Blt_FindHashEntry(&GetChildIndex(parentPtr)->labelTable, label);
+	if (hPtr == NULL) {
+	    return NULL;
+	}
+	nodePtr = Blt_GetHashValue(hPtr);
+	if (nodePtr != NULL) {
+	    return nodePtr;
+	}
+    }
     for (nodePtr = parentPtr->first, n = 0;
         nodePtr != NULL && n < firstN;
         nodePtr = nodePtr->next, n++) {
@@ -1331,6 +2629,46 @@ Blt_TreeFindChildRev(Node *parentPtr, CONST char *string, int firstN)
     return NULL;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * RenumberChildren --
+ *
+ *	Records the position of each child of the node.  The positions
+ *	stay valid (TREE_NODE_POSITIONS is set) until a child is
+ *	inserted or removed anywhere but at the end of the list.  
+ *	Repeated position queries are therefore amortized O(1).
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+RenumberChildren(Node *parentPtr)
+{
+    ChildIndex *indexPtr;
+    Node *childPtr;
+    unsigned int count;
+
+    indexPtr = GetChildIndex(parentPtr);
+    if ((indexPtr != NULL) && (indexPtr->nAlloc < parentPtr->nChildren)) {
+	indexPtr->nAlloc = parentPtr->nChildren + (parentPtr->nChildren / 2);
+	if (indexPtr->children != NULL) {
+	    Blt_Free(indexPtr->children);
+	}
+	indexPtr->children = Blt_Malloc(indexPtr->nAlloc * sizeof(Node *));
+	assert(indexPtr->children);
+    }
+    count = 0;
+    for (childPtr = parentPtr->first; childPtr != NULL; 
+	 childPtr = childPtr->next) {
+	childPtr->position = count;
+	if (indexPtr != NULL) {
+	    indexPtr->children[count] = childPtr;
+	}
+	count++;
+    }
+    parentPtr->flags |= TREE_NODE_POSITIONS;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1345,25 +2683,61 @@ int
 Blt_TreeNodePosition(Node *nodePtr)
 {
     Node *parentPtr;
-    int count;
 
-    count = 0;
     parentPtr = nodePtr->parent;
-    if (parentPtr != NULL) {
-	Node *childPtr;
+    if (parentPtr == NULL) {
+	return 0;
+    }
+    if ((parentPtr->flags & TREE_NODE_POSITIONS) == 0) {
+	RenumberChildren(parentPtr);
+    }
+    return nodePtr->position;
+}
 
-	for (childPtr = parentPtr->first; childPtr != NULL; 
-	     childPtr = childPtr->next) {
-	    if (nodePtr == childPtr) {
-		break;
-	    }
-	    count++;
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeNthChild --
+ *
+ *	Returns the child at the given position in the parent's list
+ *	of children.  Nodes with many children look up the position
+ *	in the array of children held by their label index.
+ *
+ * Results:
+ *	The child node, or NULL if the position is out of range.
+ *
+ *----------------------------------------------------------------------
+ */
+Blt_TreeNode
+Blt_TreeNthChild(Node *parentPtr, int position)
+{
+    Node *nodePtr;
+    int count;
+
+    if ((position < 0) || (position >= (int)parentPtr->nChildren)) {
+	return NULL;
+    }
+    if (parentPtr->flags & TREE_NODE_CHILD_INDEX) {
+	if ((parentPtr->flags & TREE_NODE_POSITIONS) == 0) {
+	    RenumberChildren(parentPtr);
+	}
+	return GetChildIndex(parentPtr)->children[position];
+    }
+    /* Walk from whichever end of the list is closer. */
+    if (position < (int)(parentPtr->nChildren / 2)) {
+	nodePtr = parentPtr->first;
+	for (count = 0; count < position; count++) {
+	    nodePtr = nodePtr->next;
+	}
+    } else {
+	nodePtr = parentPtr->last;
+	for (count = parentPtr->nChildren - 1; count > position; count--) {
+	    nodePtr = nodePtr->prev;
 	}
     }
-    return count;
+    return nodePtr;
 }
 
-
 /*
  *----------------------------------------------------------------------
  *
@@ -1449,7 +2823,6 @@ Blt_TreeIsBefore(Node *n1Ptr, Node *n2Ptr)
 {
     int depth;
     register int i;
-    Node *nodePtr;
 
     if (n1Ptr == n2Ptr) {
 	return FALSE;
@@ -1489,17 +2862,123 @@ Blt_TreeIsBefore(Node *n1Ptr, Node *n2Ptr)
 	n1Ptr = n1Ptr->parent;
 	n2Ptr = n2Ptr->parent;
     }
-    for (nodePtr = n1Ptr->parent->first; nodePtr != NULL; 
-	 nodePtr = nodePtr->next) {
-	if (nodePtr == n1Ptr) {
-	    return TRUE;
-	} else if (nodePtr == n2Ptr) {
-	    return FALSE;
+    return (Blt_TreeNodePosition(n1Ptr) < Blt_TreeNodePosition(n2Ptr));
+}
+
+#define TRACE_STATIC_SIZE	32
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MatchTrace --
+ *
+ *	Tests the trace against the event, except for its tag.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+MatchTrace(
+    TraceHandler *tracePtr,
+    TreeClient *sourcePtr,
+    Node *nodePtr,
+    Blt_TreeKey key,
+    unsigned int flags)
+{
+    if ((tracePtr->mask & flags) == 0) {
+	return FALSE;		/* Flags don't match. */
+    }
+    if ((tracePtr->clientPtr == sourcePtr) && 
+	(tracePtr->mask & TREE_TRACE_FOREIGN_ONLY)) {
+	return FALSE;		/* This client initiated the trace. */
+    }
+    if ((tracePtr->nodePtr != NULL) && (tracePtr->nodePtr != nodePtr)) {
+	return FALSE;		/* Nodes don't match. */
+    }
+    if ((tracePtr->keyPattern != NULL) && 
+	(!Tcl_StringMatch(key, tracePtr->keyPattern))) {
+	return FALSE;		/* Key pattern doesn't match. */
+    }
+    return TRUE;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CollectTraces --
+ *
+ *	Adds the traces of the chain that match the event to the
+ *	array of candidates.  The tag test is made last.  For a
+ *	chain of traces with the same tag, it's made only once for
+ *	each client's tag table.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+CollectTraces(
+    Blt_Chain *chainPtr,
+    int sameTag,		/* Indicates all the traces of the
+				 * chain have the same tag. */
+    TreeClient *sourcePtr,
+    Node *nodePtr,
+    Blt_TreeKey key,
+    unsigned int flags,
+    TraceHandler ***arrayPtrPtr, /* (in/out) Array of candidates. */
+    int *nAllocPtr,
+    int *nTracesPtr)
+{
+    Blt_ChainLink *linkPtr;
+    TraceHandler *tracePtr;
+    Blt_TreeTagTable *lastTablePtr;
+    int hasTag;
+
+    lastTablePtr = NULL;
+    hasTag = FALSE;
+    for (linkPtr = Blt_ChainFirstLink(chainPtr); linkPtr != NULL; 
+	 linkPtr = Blt_ChainNextLink(linkPtr)) {
+	tracePtr = Blt_ChainGetValue(linkPtr);
+	if (!MatchTrace(tracePtr, sourcePtr, nodePtr, key, flags)) {
+	    continue;
+	}
+	if (tracePtr->withTag != NULL) {
+	    if ((!sameTag) || (lastTablePtr == NULL) || 
+		(tracePtr->clientPtr->tagTablePtr != lastTablePtr)) {
+		hasTag = Blt_TreeHasTag(tracePtr->clientPtr, nodePtr, 
+			tracePtr->withTag);
+		lastTablePtr = tracePtr->clientPtr->tagTablePtr;
+	    }
+	    if (!hasTag) {
+		continue;	/* Doesn't have the tag. */
+	    }
+	}
+	if (*nTracesPtr >= *nAllocPtr) {
+	    TraceHandler **newArr;
+
+	    newArr = Blt_Malloc(sizeof(TraceHandler *) * *nAllocPtr * 2);
+	    assert(newArr);
+	    memcpy(newArr, *arrayPtrPtr, sizeof(TraceHandler *) * *nTracesPtr);
+	    if (*nAllocPtr > TRACE_STATIC_SIZE) {
+		Blt_Free(*arrayPtrPtr);
+	    }
+	    *arrayPtrPtr = newArr;
+	    *nAllocPtr *= 2;
 	}
+	(*arrayPtrPtr)[(*nTracesPtr)++] = tracePtr;
     }
-    return FALSE;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * CallTraces --
+ *
+ *	Invokes the traces matching the event.  Only the traces filed
+ *	under the key, the node, the tags and the others list of the 
+ *	trace index are examined.  The matching traces are called in
+ *	the order of their clients, and then in the order they were
+ *	created, as if each client's chain of traces had been walked.
+ *
+ *----------------------------------------------------------------------
+ */
 static int
 CallTraces(
     Tcl_Interp *interp,
@@ -1513,101 +2992,161 @@ CallTraces(
     unsigned int flags,
     int *cnt)
 {
-    Blt_ChainLink *l1Ptr, *l2Ptr;
-    TreeClient *clientPtr;
+    TraceIndex *indexPtr;
+    TraceHandler *staticArr[TRACE_STATIC_SIZE];
+    TraceHandler **traceArr;
     TraceHandler *tracePtr;
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
     unsigned int inode = nodePtr->inode;
-    int result;
+    int nTraces, nAlloc, result;
+    register int i, j;
 
-    for(l1Ptr = Blt_ChainFirstLink(treeObjPtr->clients); 
-	l1Ptr != NULL; l1Ptr = Blt_ChainNextLink(l1Ptr)) {
-	clientPtr = Blt_ChainGetValue(l1Ptr);
-	for(l2Ptr = Blt_ChainFirstLink(clientPtr->traces); 
-	    l2Ptr != NULL; l2Ptr = Blt_ChainNextLink(l2Ptr)) {
-	    tracePtr = Blt_ChainGetValue(l2Ptr);
-	    if ((tracePtr->mask & flags) == 0) {
-		continue;	/* Flags don't match. */
-	    }
-	    if ((clientPtr == sourcePtr) && 
-		(tracePtr->mask & TREE_TRACE_FOREIGN_ONLY)) {
-		continue;	/* This client initiated the trace. */
-	    }
-	    if ((tracePtr->nodePtr != NULL) && (tracePtr->nodePtr != nodePtr)) {
-		continue;	/* Nodes don't match. */
-	    }
-	    if ((tracePtr->keyPattern != NULL) && 
-		(!Tcl_StringMatch(key, tracePtr->keyPattern))) {
-		continue;	/* Key pattern doesn't match. */
-	    }
-	    if ((tracePtr->withTag != NULL) && 
-		(!Blt_TreeHasTag(clientPtr, nodePtr, tracePtr->withTag))) {
-		continue;	/* Doesn't have the tag. */
+    indexPtr = treeObjPtr->traceIndex;
+    if ((indexPtr == NULL) || (indexPtr->nTraces == 0)) {
+	return TCL_OK;
+    }
+    if ((treeObjPtr->batchPtr != NULL) &&
+	(treeObjPtr->batchPtr->clientPtr == sourcePtr) &&
+	((flags & ~(TREE_TRACE_WRITE | TREE_TRACE_UNSET | TREE_TRACE_CREATE))
+	 == 0)) {
+	DeferTrace(treeObjPtr->batchPtr, nodePtr, key, flags);
+	return TCL_OK;
+    }
+    traceArr = staticArr;
+    nAlloc = TRACE_STATIC_SIZE;
+    nTraces = 0;
+    hPtr = Blt_FindHashEntry(&indexPtr->keyTable, key);
+    if (hPtr != NULL) {
+	CollectTraces(Blt_GetHashValue(hPtr), FALSE, sourcePtr, nodePtr, key,
+		flags, &traceArr, &nAlloc, &nTraces);
+    }
+    if (indexPtr->nodeTable.numEntries > 0) {
+	hPtr = Blt_FindHashEntry(&indexPtr->nodeTable, (char *)nodePtr);
+	if (hPtr != NULL) {
+	    CollectTraces(Blt_GetHashValue(hPtr), FALSE, sourcePtr, nodePtr, 
+		key, flags, &traceArr, &nAlloc, &nTraces);
+	}
+    }
+    for (hPtr = Blt_FirstHashEntry(&indexPtr->tagTable, &cursor); 
+	 hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	CollectTraces(Blt_GetHashValue(hPtr), TRUE, sourcePtr, nodePtr, key,
+		flags, &traceArr, &nAlloc, &nTraces);
+    }
+    CollectTraces(indexPtr->others, FALSE, sourcePtr, nodePtr, key, flags,
+	&traceArr, &nAlloc, &nTraces);
+    if (nTraces == 0) {
+	return TCL_OK;
+    }
+
+    /* 
+     * Put the traces in order: by client (the order of the clients
+     * in the tree object's chain), then by creation.
+     */
+    if (nTraces > 1) {
+	Blt_ChainLink *linkPtr;
+	TreeClient *clientPtr;
+	int n;
+
+	n = 0;
+	for (linkPtr = Blt_ChainFirstLink(treeObjPtr->clients); 
+	     (linkPtr != NULL) && (n < nTraces); 
+	     linkPtr = Blt_ChainNextLink(linkPtr)) {
+	    clientPtr = Blt_ChainGetValue(linkPtr);
+	    /* Move this client's traces forward, sorted by serial. */
+	    for (i = n; i < nTraces; i++) {
+		tracePtr = traceArr[i];
+		if (tracePtr->clientPtr != clientPtr) {
+		    continue;
+		}
+		traceArr[i] = traceArr[n];
+		for (j = n; (j > 0) && (traceArr[j - 1]->clientPtr == clientPtr)
+			 && (traceArr[j - 1]->serial > tracePtr->serial); j--) {
+		    traceArr[j] = traceArr[j - 1];
+		}
+		traceArr[j] = tracePtr;
+		n++;
 	    }
-	    nodePtr->flags |= TREE_TRACE_ACTIVE;
-	    *cnt += 1;
-	    
-	    Tcl_Preserve(treeObjPtr);
-	    result = (*tracePtr->proc) (tracePtr->clientData, treeObjPtr->interp, 
+	}
+    }
+    for (i = 0; i < nTraces; i++) {
+	Tcl_Preserve(traceArr[i]);
+    }
+    result = TCL_OK;
+    Tcl_Preserve(treeObjPtr);
+    for (i = 0; i < nTraces; i++) {
+	tracePtr = traceArr[i];
+	if (tracePtr->deleted) {
+	    continue;		/* Deleted by an earlier trace. */
+	}
+	nodePtr->flags |= TREE_TRACE_ACTIVE;
+	*cnt += 1;
+	result = (*tracePtr->proc) (tracePtr->clientData, treeObjPtr->interp, 
 		nodePtr, key, flags);
-            if (result != TCL_OK) {
-	        Tcl_Release(treeObjPtr);
-                if ((tracePtr->mask & TREE_TRACE_BGERROR) && interp != NULL) {
-                    Tcl_BackgroundError(interp);
-                } else {
-                    nodePtr->flags &= ~TREE_TRACE_ACTIVE;
-                    return TCL_ERROR;
-                }
+	if (result != TCL_OK) {
+	    if ((tracePtr->mask & TREE_TRACE_BGERROR) && interp != NULL) {
+		Tcl_BackgroundError(interp);
+		result = TCL_OK;
+	    } else {
+		nodePtr->flags &= ~TREE_TRACE_ACTIVE;
+		result = TCL_ERROR;
+		break;
 	    }
-             nodePtr->flags &= ~TREE_TRACE_ACTIVE;
-             if (Blt_TreeNodeDeleted(nodePtr) || nodePtr->inode != inode) {
-                 Tcl_Release(treeObjPtr);
-                 return TCL_ERROR;
+	}
+	nodePtr->flags &= ~TREE_TRACE_ACTIVE;
+	if (Blt_TreeNodeDeleted(nodePtr) || nodePtr->inode != inode) {
+	    result = TCL_ERROR;
+	    break;
+	}
+	if (treeObjPtr->delete) {
+	    if (interp != NULL) {
+		Tcl_AppendResult(interp, "tree deleted", 0);
 	    }
-	    if (treeObjPtr->delete) {
-                 Tcl_Release(treeObjPtr);
-                 if (interp != NULL) {
-                     Tcl_AppendResult(interp, "tree deleted", 0);
-                 }
-                 return TCL_ERROR;
-            }
-            Tcl_Release(treeObjPtr);
-	    /* nodePtr = GetNode(treeObjPtr, inode);
-            if (nodePtr == NULL) {
-                if (interp != NULL) {
-                    Tcl_AppendResult(interp, "node deleted", 0);
-                }
-                return TCL_ERROR;
-            }*/
+	    result = TCL_ERROR;
+	    break;
 	}
     }
-    return TCL_OK;
+    Tcl_Release(treeObjPtr);
+    for (i = 0; i < nTraces; i++) {
+	Tcl_Release(traceArr[i]);
+    }
+    if (traceArr != staticArr) {
+	Blt_Free(traceArr);
+    }
+    return result;
 }
 
-static Value *
+/*
+ * Returns where the value of the key is kept in the node, or NULL if
+ * the node has no such value or it's private to another client.
+ */
+static Tcl_Obj **
 GetTreeValue(
     Tcl_Interp *interp,
     TreeClient *clientPtr,
     Node *nodePtr,
     Blt_TreeKey key)
 {
-    register Value *valuePtr;
+    Tcl_Obj **objPtrPtr;
+    Value *valuePtr;
 
-    valuePtr = TreeFindValue(nodePtr, key); 
-    if (valuePtr == NULL) {
+    objPtrPtr = TreeFindValueObj(nodePtr, key, &valuePtr); 
+    if (objPtrPtr == NULL) {
 	if (interp != NULL) {
 	    Tcl_AppendResult(interp, "can't find field \"", key, "\"", 
 			     (char *)NULL);
 	}
 	return NULL;
     }	
-    if ((valuePtr->owner != NULL) && (valuePtr->owner != clientPtr)) {
+    if ((valuePtr != NULL) && (valuePtr->owner != NULL) && 
+	(valuePtr->owner != clientPtr)) {
 	if (interp != NULL) {
 	    Tcl_AppendResult(interp, "can't access private field \"", 
 			     key, "\"", (char *)NULL);
 	}
 	return NULL;
     }
-    return valuePtr;
+    return objPtrPtr;
 }
 
 int
@@ -1617,16 +3156,31 @@ Blt_TreePrivateValue(
     Node *nodePtr,
     Blt_TreeKey key)
 {
+    Tcl_Obj **objPtrPtr;
     Value *valuePtr;
+    int isNew;
 
-    valuePtr = TreeFindValue(nodePtr, key); 
-    if (valuePtr == NULL) {
+    if (CheckWritable(interp, nodePtr->treeObject) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    objPtrPtr = TreeFindValueObj(nodePtr, key, &valuePtr); 
+    if (objPtrPtr == NULL) {
 	if (interp != NULL) {
 	    Tcl_AppendResult(interp, "can't find field \"", key, "\"", 
 			     (char *)NULL);
 	}
 	return TCL_ERROR;
     }
+    if (valuePtr == NULL) {
+	Tcl_Obj *objPtr;
+
+	/* Slots are public: move the value into a record of its own. */
+	objPtr = *objPtrPtr;
+	*objPtrPtr = NULL;
+	nodePtr->nSlotValues--;
+	valuePtr = TreeCreateValue(nodePtr, key, &isNew);
+	valuePtr->objPtr = objPtr;
+    }
     valuePtr->owner = clientPtr;
     return TCL_OK;
 }
@@ -1640,15 +3194,17 @@ Blt_TreePublicValue(
 {
     Value *valuePtr;
 
-    valuePtr = TreeFindValue(nodePtr, key); 
-    if (valuePtr == NULL) {
+    if (CheckWritable(interp, nodePtr->treeObject) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (TreeFindValueObj(nodePtr, key, &valuePtr) == NULL) {
 	if (interp != NULL) {
 	    Tcl_AppendResult(interp, "can't find field \"", key, "\"", 
 			     (char *)NULL);
 	}
 	return TCL_ERROR;
     }
-    if (valuePtr->owner != clientPtr) {
+    if ((valuePtr == NULL) || (valuePtr->owner != clientPtr)) {
 	if (interp != NULL) {
 	    Tcl_AppendResult(interp, "not the owner of \"", key, "\"", 
 		     (char *)NULL);
@@ -1665,21 +3221,21 @@ Blt_TreeValueExistsByKey(clientPtr, nodePtr, key)
     Node *nodePtr;
     Blt_TreeKey key;
 {
-    register Value *valuePtr;
+    Tcl_Obj **objPtrPtr;
     int cnt;
     TreeObject *treeObjPtr = nodePtr->treeObject;
     Tcl_Interp *interp = treeObjPtr->interp;
 
-    valuePtr = GetTreeValue((Tcl_Interp *)NULL, clientPtr, nodePtr, key);
-    if (valuePtr == NULL && (!(nodePtr->flags & TREE_TRACE_ACTIVE))) {
+    objPtrPtr = GetTreeValue((Tcl_Interp *)NULL, clientPtr, nodePtr, key);
+    if (objPtrPtr == NULL && (!(nodePtr->flags & TREE_TRACE_ACTIVE))) {
         if (CallTraces(interp, clientPtr, treeObjPtr, nodePtr, key, 
             TREE_TRACE_EXISTS, &cnt) != TCL_OK) {
             Tcl_ResetResult(interp);
         } else {
-            valuePtr = GetTreeValue((Tcl_Interp *)NULL, clientPtr, nodePtr, key);
+            objPtrPtr = GetTreeValue((Tcl_Interp *)NULL, clientPtr, nodePtr, key);
         }
     }
-    if (valuePtr == NULL) {
+    if (objPtrPtr == NULL) {
 	return FALSE;
     }
     return TRUE;
@@ -1693,7 +3249,7 @@ Blt_TreeGetValueByKey(
     Blt_TreeKey key,
     Tcl_Obj **objPtrPtr)
 {
-    register Value *valuePtr;
+    Tcl_Obj **valueObjPtrPtr;
     TreeObject *treeObjPtr = nodePtr->treeObject;
     int cnt = 0;
 
@@ -1703,11 +3259,11 @@ Blt_TreeGetValueByKey(
 	    return TCL_ERROR;
         }
     }
-    valuePtr = GetTreeValue(interp, clientPtr, nodePtr, key);
-    if (valuePtr == NULL) {
+    valueObjPtrPtr = GetTreeValue(interp, clientPtr, nodePtr, key);
+    if (valueObjPtrPtr == NULL) {
         return TCL_ERROR;
     }
-    *objPtrPtr = valuePtr->objPtr;
+    *objPtrPtr = *valueObjPtrPtr;
     return TCL_OK;
 }
 
@@ -1717,9 +3273,9 @@ bltTreeGetValueByKey(
     TreeClient *clientPtr,
     Node *nodePtr,
     Blt_TreeKey key,
-    Value** valuePtrPtr)
+    Tcl_Obj ***objPtrPtrPtr)	/* (out) Where the value is kept. */
 {
-    register Value *valuePtr;
+    Tcl_Obj **objPtrPtr;
     TreeObject *treeObjPtr = nodePtr->treeObject;
     int cnt = 0;
 
@@ -1729,11 +3285,11 @@ bltTreeGetValueByKey(
 	    return TCL_ERROR;
         }
     }
-    valuePtr = GetTreeValue(interp, clientPtr, nodePtr, key);
-    if (valuePtr == NULL) {
+    objPtrPtr = GetTreeValue(interp, clientPtr, nodePtr, key);
+    if (objPtrPtr == NULL) {
         return TCL_ERROR;
     }
-    *valuePtrPtr = valuePtr;
+    *objPtrPtrPtr = objPtrPtr;
     return TCL_OK;
 }
 
@@ -1775,6 +3331,7 @@ Blt_TreeSetValueByKey(
     Tcl_Obj *objPtr)		/* New value of field. */
 {
     TreeObject *treeObjPtr;
+    Tcl_Obj **objPtrPtr;
     Value *valuePtr;
     unsigned int flags;
     int isNew = 0, cnt = 0;
@@ -1784,9 +3341,12 @@ Blt_TreeSetValueByKey(
     }
     treeObjPtr = nodePtr->treeObject;
     assert(objPtr != NULL);
+    if (CheckWritable(interp, treeObjPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
     if (nodePtr->flags & TREE_NODE_FIXED_FIELDS) {
-        valuePtr = TreeFindValue(nodePtr, key); 
-        if (valuePtr == NULL) {
+        objPtrPtr = TreeFindValueObj(nodePtr, key, &valuePtr); 
+        if (objPtrPtr == NULL) {
             if (interp != NULL) {
                 Tcl_AppendResult(interp, "fixed field \"", key, "\"", 
                     (char *)NULL);
@@ -1794,9 +3354,10 @@ Blt_TreeSetValueByKey(
             return TCL_ERROR;
         }
     } else {
-        valuePtr = TreeCreateValue(nodePtr, key, &isNew);
+        objPtrPtr = TreeCreateValueObj(nodePtr, key, &valuePtr, &isNew);
     }
-    if ((valuePtr->owner != NULL) && (valuePtr->owner != clientPtr)) {
+    if ((valuePtr != NULL) && (valuePtr->owner != NULL) && 
+	(valuePtr->owner != clientPtr)) {
 	if (interp != NULL) {
 	    Tcl_AppendResult(interp, "can't set private field \"", 
 			     key, "\"", (char *)NULL);
@@ -1805,22 +3366,23 @@ Blt_TreeSetValueByKey(
     }
     SetModified(nodePtr);
     if (!(nodePtr->flags & TREE_TRACE_ACTIVE)) {
-        UpdateOldValue(clientPtr, valuePtr->objPtr);
-        valuePtr->objPtr = NULL;
+        UpdateOldValue(clientPtr, *objPtrPtr);
+        *objPtrPtr = NULL;
     }
-    if (objPtr != valuePtr->objPtr) {
+    if (objPtr != *objPtrPtr) {
 	Tcl_IncrRefCount(objPtr);
-	if (valuePtr->objPtr != NULL) {
-	    Tcl_DecrRefCount(valuePtr->objPtr);
+	if (*objPtrPtr != NULL) {
+	    Tcl_DecrRefCount(*objPtrPtr);
 	}
-	valuePtr->objPtr = objPtr;
+	*objPtrPtr = objPtr;
     }
+    IndexValue(nodePtr, key, objPtr);
     flags = TREE_TRACE_WRITE;
     if (isNew) {
 	flags |= TREE_TRACE_CREATE;
     }
     if (!(nodePtr->flags & TREE_TRACE_ACTIVE)) {
-	return CallTraces(interp, clientPtr, treeObjPtr, nodePtr, valuePtr->key, 
+	return CallTraces(interp, clientPtr, treeObjPtr, nodePtr, key, 
 		flags, &cnt);
     }
     return TCL_OK;
@@ -1834,21 +3396,26 @@ Blt_TreeUnsetValueByKey(
     Blt_TreeKey key)		/* Name of field in node. */
 {
     TreeObject *treeObjPtr = nodePtr->treeObject;
+    Tcl_Obj **objPtrPtr;
     Value *valuePtr;
     int cnt = 0;
 
+    if (CheckWritable(interp, treeObjPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
     if (nodePtr->flags & TREE_NODE_FIXED_FIELDS) {
         if (interp != NULL) {
             Tcl_AppendResult(interp, "fixed field", 0);
         }
         return TCL_ERROR;
     }
-    valuePtr = TreeFindValue(nodePtr, key);
-    if (valuePtr == NULL) {
+    objPtrPtr = TreeFindValueObj(nodePtr, key, &valuePtr);
+    if (objPtrPtr == NULL) {
 	return TCL_OK;		/* It's okay to unset values that don't
 				 * exist in the node. */
     }
-    if ((valuePtr->owner != NULL) && (valuePtr->owner != clientPtr)) {
+    if ((valuePtr != NULL) && (valuePtr->owner != NULL) && 
+	(valuePtr->owner != clientPtr)) {
 	if (interp != NULL) {
 	    Tcl_AppendResult(interp, "can't unset private field \"", 
 			     key, "\"", (char *)NULL);
@@ -1857,10 +3424,10 @@ Blt_TreeUnsetValueByKey(
     }
     SetModified(nodePtr);
     if (!(nodePtr->flags & TREE_TRACE_ACTIVE)) {
-        UpdateOldValue(clientPtr, valuePtr->objPtr);
-        valuePtr->objPtr = NULL;
+        UpdateOldValue(clientPtr, *objPtrPtr);
+        *objPtrPtr = NULL;
     }
-    TreeDeleteValue(nodePtr, valuePtr);
+    TreeDeleteValueObj(nodePtr, key, objPtrPtr, valuePtr);
     return CallTraces(interp, clientPtr, treeObjPtr, nodePtr, key, TREE_TRACE_UNSET, &cnt);
 }
 
@@ -2037,101 +3604,657 @@ Blt_TreeUnsetValue(
 	result = Blt_TreeUnsetValueByKey(interp, clientPtr, nodePtr, 
 		Blt_TreeKeyGet(NULL, clientPtr->treeObject,string));
     }
-    return result;
+    return result;
+}
+
+int
+Blt_TreeValueExists(TreeClient *clientPtr, Node *nodePtr, CONST char *string)
+{
+    char *left, *right;
+    int result;
+
+    if (ParseParentheses((Tcl_Interp *)NULL, string, &left, &right) != TCL_OK) {
+	return FALSE;
+    }
+    if (left != NULL) {
+        Tcl_DString kStr, iStr;
+        Tcl_DStringInit(&kStr);
+        Tcl_DStringInit(&iStr);
+        Tcl_DStringAppend(&kStr, left+1, right-left-1);
+        Tcl_DStringAppend(&iStr, string, left-string);
+        result = Blt_TreeArrayValueExists(clientPtr, nodePtr,
+	   Tcl_DStringValue(&iStr), Tcl_DStringValue(&kStr));
+	Tcl_DStringFree(&kStr);
+	Tcl_DStringFree(&iStr);
+    } else {
+	result = Blt_TreeValueExistsByKey(clientPtr, nodePtr, 
+		Blt_TreeKeyGet(NULL, clientPtr->treeObject,string));
+    }
+    return result;
+}
+
+/* 
+ * Keys are enumerated in the order of the slots of the schema first,
+ * then the other values of the node.  SLOTS_DONE marks the latter.
+ */
+#define SLOTS_DONE	(USHRT_MAX + 1)
+
+Blt_TreeKey
+Blt_TreeFirstKey(
+    TreeClient *clientPtr, 
+    Node *nodePtr, 
+    Blt_TreeKeySearch *iterPtr)
+{
+    iterPtr->node = nodePtr;
+    iterPtr->nextSlot = 0;
+    return Blt_TreeNextKey(clientPtr, iterPtr);
+}
+
+Blt_TreeKey
+Blt_TreeNextKey(TreeClient *clientPtr, Blt_TreeKeySearch *iterPtr)
+{
+    Value *valuePtr;
+
+    if (iterPtr->nextSlot < SLOTS_DONE) {
+	Node *nodePtr = iterPtr->node;
+
+	while (iterPtr->nextSlot < nodePtr->nSlots) {
+	    unsigned int slot;
+
+	    slot = iterPtr->nextSlot++;
+	    if (nodePtr->slots[slot] != NULL) {
+		return nodePtr->treeObject->schemaKeys[slot];
+	    }
+	}
+	iterPtr->nextSlot = SLOTS_DONE;
+	valuePtr = TreeFirstValue(nodePtr, iterPtr);
+    } else {
+	valuePtr = TreeNextValue(iterPtr);
+    }
+    if (valuePtr == NULL) {
+	return NULL;
+    }
+    while ((valuePtr->owner != NULL) && (valuePtr->owner != clientPtr)) {
+	valuePtr = TreeNextValue(iterPtr);
+	if (valuePtr == NULL) {
+	    return NULL;
+	}
+    }
+    return valuePtr->key;
+}
+
+/*
+ * Returns whether the node has a value for the key visible to the
+ * client.  Unlike Blt_TreeValueExistsByKey, no traces are called.
+ */
+int
+Blt_TreeHasKey(TreeClient *clientPtr, Node *nodePtr, Blt_TreeKey key)
+{
+    return (GetTreeValue((Tcl_Interp *)NULL, clientPtr, nodePtr, key) != NULL);
+}
+
+int Blt_TreeCountKeys(TreeClient *clientPtr, Node *nodePtr) {
+    int cnt = 0;
+    Blt_TreeKey key;
+    Blt_TreeKeySearch cursor;
+    
+         
+    for (key = Blt_TreeFirstKey(clientPtr, nodePtr, &cursor); key != NULL;
+        key = Blt_TreeNextKey(clientPtr, &cursor)) {
+        cnt++;
+    }
+    return cnt;
+}
+
+
+int
+Blt_TreeIsAncestor(Node *n1Ptr, Node *n2Ptr)
+{
+    if (n2Ptr != NULL) {
+	n2Ptr = n2Ptr->parent;
+	while (n2Ptr != NULL) {
+	    if (n2Ptr == n1Ptr) {
+		return TRUE;
+	    }
+	    n2Ptr = n2Ptr->parent;
+	}
+    }
+    return FALSE;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeBeginBatch --
+ *
+ *	Starts a batch of changes by the client.  Until the matching
+ *	Blt_TreeEndBatch, notifications of moves, sorts, relabels and
+ *	inserts made by the client, and the write and unset traces
+ *	they trigger, are held back.  Creates, deletes and gets are
+ *	still reported immediately.  Batches may be nested.
+ *
+ * Results:
+ *	A standard Tcl result.  It's an error to start a batch while
+ *	another client's batch is in progress.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeBeginBatch(Tcl_Interp *interp, TreeClient *clientPtr)
+{
+    TreeObject *treeObjPtr = clientPtr->treeObject;
+    TreeBatch *batchPtr;
+
+    batchPtr = treeObjPtr->batchPtr;
+    if (batchPtr != NULL) {
+	if (batchPtr->clientPtr != clientPtr) {
+	    if (interp != NULL) {
+		Tcl_AppendResult(interp, "tree \"", treeObjPtr->name, 
+			"\" is in a batch of another client", (char *)NULL);
+	    }
+	    return TCL_ERROR;
+	}
+	batchPtr->level++;
+	return TCL_OK;
+    }
+    batchPtr = Blt_Calloc(1, sizeof(TreeBatch));
+    assert(batchPtr);
+    batchPtr->clientPtr = clientPtr;
+    batchPtr->level = 1;
+    Blt_InitHashTable(&batchPtr->eventTable, BLT_ONE_WORD_KEYS);
+    Blt_InitHashTable(&batchPtr->parentTable, BLT_ONE_WORD_KEYS);
+    Blt_InitHashTable(&batchPtr->traceTable, 
+	sizeof(BatchTraceKey) / sizeof(int));
+    batchPtr->events = Blt_ChainCreate();
+    batchPtr->parents = Blt_ChainCreate();
+    batchPtr->traces = Blt_ChainCreate();
+    treeObjPtr->batchPtr = batchPtr;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushBatch --
+ *
+ *	Delivers the changes held back by a batch.  Handlers that
+ *	asked for TREE_NOTIFY_BATCH get one such event for each node
+ *	whose children changed.  Other handlers get the merged events
+ *	of each node that changed.  Then the value traces are called,
+ *	once per node and key.  Nodes deleted since are skipped.
+ *
+ * Results:
+ *	A standard Tcl result.  Delivery stops at the first error.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+FlushBatch(Tcl_Interp *interp, TreeObject *treeObjPtr, TreeBatch *batchPtr)
+{
+    static unsigned int eventOrder[] = {
+	TREE_NOTIFY_MOVE, TREE_NOTIFY_MOVEPOST, TREE_NOTIFY_INSERT, 
+	TREE_NOTIFY_RELABEL, TREE_NOTIFY_RELABELPOST, TREE_NOTIFY_SORT, 0
+    };
+    Blt_ChainLink *linkPtr, *clientLinkPtr;
+    Blt_TreeNotifyEvent event;
+    TreeClient *clientPtr;
+    BatchEvent *eventPtr;
+    BatchTrace *tracePtr;
+    Node *nodePtr;
+    int result, cnt;
+    register int i;
+
+    result = TCL_OK;
+    if (Tcl_InterpDeleted(treeObjPtr->interp)) {
+	return TCL_OK;
+    }
+    Tcl_Preserve(treeObjPtr);
+    for (linkPtr = Blt_ChainFirstLink(batchPtr->parents); linkPtr != NULL;
+	 linkPtr = Blt_ChainNextLink(linkPtr)) {
+	event.type = TREE_NOTIFY_BATCH;
+	event.inode = (unsigned int)(unsigned long)Blt_ChainGetValue(linkPtr);
+	for (clientLinkPtr = Blt_ChainFirstLink(treeObjPtr->clients);
+	     clientLinkPtr != NULL; 
+	     clientLinkPtr = Blt_ChainNextLink(clientLinkPtr)) {
+	    if (LookupNode(treeObjPtr, event.inode) == NULL) {
+		break;
+	    }
+	    clientPtr = Blt_ChainGetValue(clientLinkPtr);
+	    result = CheckEventHandlers(clientPtr, 
+		(clientPtr == batchPtr->clientPtr), &event, 0);
+	    if ((result != TCL_OK) || (treeObjPtr->delete)) {
+		goto done;
+	    }
+	}
+    }
+    for (linkPtr = Blt_ChainFirstLink(batchPtr->events); linkPtr != NULL;
+	 linkPtr = Blt_ChainNextLink(linkPtr)) {
+	eventPtr = Blt_ChainGetValue(linkPtr);
+	for (i = 0; eventOrder[i] != 0; i++) {
+	    if ((eventPtr->mask & eventOrder[i]) == 0) {
+		continue;
+	    }
+	    event.type = eventOrder[i];
+	    event.inode = eventPtr->inode;
+	    for (clientLinkPtr = Blt_ChainFirstLink(treeObjPtr->clients);
+		 clientLinkPtr != NULL; 
+		 clientLinkPtr = Blt_ChainNextLink(clientLinkPtr)) {
+		if (LookupNode(treeObjPtr, event.inode) == NULL) {
+		    break;
+		}
+		clientPtr = Blt_ChainGetValue(clientLinkPtr);
+		result = CheckEventHandlers(clientPtr, 
+			(clientPtr == batchPtr->clientPtr), &event, 
+			TREE_NOTIFY_BATCH);
+		if ((result != TCL_OK) || (treeObjPtr->delete)) {
+		    goto done;
+		}
+	    }
+	}
+    }
+    for (linkPtr = Blt_ChainFirstLink(batchPtr->traces); linkPtr != NULL;
+	 linkPtr = Blt_ChainNextLink(linkPtr)) {
+	tracePtr = Blt_ChainGetValue(linkPtr);
+	nodePtr = LookupNode(treeObjPtr, (unsigned int)tracePtr->key.inode);
+	if ((nodePtr == NULL) || (nodePtr->flags & TREE_TRACE_ACTIVE)) {
+	    continue;
+	}
+	cnt = 0;
+	result = CallTraces(interp, batchPtr->clientPtr, treeObjPtr, nodePtr, 
+		tracePtr->key.key, tracePtr->flags, &cnt);
+	if ((result != TCL_OK) || (treeObjPtr->delete)) {
+	    break;
+	}
+    }
+ done:
+    Tcl_Release(treeObjPtr);
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeEndBatch --
+ *
+ *	Ends a batch started by Blt_TreeBeginBatch.  When the outermost
+ *	batch ends, the changes held back are delivered.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeEndBatch(Tcl_Interp *interp, TreeClient *clientPtr)
+{
+    TreeObject *treeObjPtr = clientPtr->treeObject;
+    TreeBatch *batchPtr;
+    int result;
+
+    batchPtr = treeObjPtr->batchPtr;
+    if ((batchPtr == NULL) || (batchPtr->clientPtr != clientPtr)) {
+	return TCL_OK;
+    }
+    batchPtr->level--;
+    if (batchPtr->level > 0) {
+	return TCL_OK;
+    }
+    /* Detach the batch first, so that handlers and traces changing
+     * the tree are reported as usual. */
+    treeObjPtr->batchPtr = NULL;
+    result = FlushBatch(interp, treeObjPtr, batchPtr);
+    FreeBatch(batchPtr);
+    return result;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeCreateKeyIndex --
+ *
+ *	Creates an index of the values of the key, filling it from
+ *	the nodes currently in the tree.  An existing index for the key
+ *	is replaced.  The index is kept up to date as values are set and
+ *	unset, until deleted or the tree is destroyed.
+ *
+ * Results:
+ *	Always returns TCL_OK.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeCreateKeyIndex(
+    Tcl_Interp *interp,
+    TreeClient *clientPtr,
+    Blt_TreeKey key,
+    int type,			/* TREE_INDEX_STRING, _INTEGER or _REAL. */
+    int flags)			/* TREE_INDEX_ORDERED */
+{
+    TreeObject *treeObjPtr = clientPtr->treeObject;
+    Blt_HashEntry *hPtr;
+    KeyIndex *indexPtr;
+    Node *nodePtr;
+    Tcl_Obj **objPtrPtr;
+    Value *valuePtr;
+    int isNew;
+
+    hPtr = Blt_CreateHashEntry(&treeObjPtr->keyIndexTable, key, &isNew);
+    if (!isNew) {
+	DestroyKeyIndex(Blt_GetHashValue(hPtr));
+    }
+    indexPtr = Blt_Calloc(1, sizeof(KeyIndex));
+    assert(indexPtr);
+    indexPtr->key = key;
+    indexPtr->type = type;
+    indexPtr->flags = flags;
+    switch (type) {
+    case TREE_INDEX_INTEGER:
+	Blt_InitHashTable(&indexPtr->valueTable, 
+		sizeof(Tcl_WideInt) / sizeof(int));
+	break;
+    case TREE_INDEX_REAL:
+	Blt_InitHashTable(&indexPtr->valueTable, sizeof(double) / sizeof(int));
+	break;
+    default:
+	Blt_InitHashTable(&indexPtr->valueTable, BLT_STRING_KEYS);
+	break;
+    }
+    Blt_InitHashTable(&indexPtr->stringTable, BLT_STRING_KEYS);
+    Blt_InitHashTable(&indexPtr->nodeTable, BLT_ONE_WORD_KEYS);
+    indexPtr->slotPool = Blt_PoolCreate(BLT_FIXED_SIZE_ITEMS);
+    Blt_SetHashValue(hPtr, indexPtr);
+
+    for (nodePtr = treeObjPtr->root; nodePtr != NULL; 
+	 nodePtr = Blt_TreeNextNode(treeObjPtr->root, nodePtr)) {
+	objPtrPtr = TreeFindValueObj(nodePtr, key, &valuePtr);
+	if ((objPtrPtr != NULL) && (*objPtrPtr != NULL)) {
+	    IndexNodeValue(indexPtr, nodePtr, *objPtrPtr);
+	}
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeDeleteKeyIndex --
+ *
+ *	Removes the index of the key.
+ *
+ * Results:
+ *	Returns TCL_ERROR if the key wasn't indexed.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeDeleteKeyIndex(TreeClient *clientPtr, Blt_TreeKey key)
+{
+    TreeObject *treeObjPtr = clientPtr->treeObject;
+    Blt_HashEntry *hPtr;
+
+    hPtr = Blt_FindHashEntry(&treeObjPtr->keyIndexTable, key);
+    if (hPtr == NULL) {
+	return TCL_ERROR;
+    }
+    DestroyKeyIndex(Blt_GetHashValue(hPtr));
+    Blt_DeleteHashEntry(&treeObjPtr->keyIndexTable, hPtr);
+    return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeKeyIndexInfo --
+ *
+ *	Reports the type and flags of the index of the key.
+ *
+ * Results:
+ *	Returns TCL_ERROR if the key isn't indexed.
+ *
+ *----------------------------------------------------------------------
+ */
 int
-Blt_TreeValueExists(TreeClient *clientPtr, Node *nodePtr, CONST char *string)
+Blt_TreeKeyIndexInfo(
+    TreeClient *clientPtr,
+    Blt_TreeKey key,
+    int *typePtr,
+    int *flagsPtr)
 {
-    char *left, *right;
-    int result;
+    Blt_HashEntry *hPtr;
+    KeyIndex *indexPtr;
 
-    if (ParseParentheses((Tcl_Interp *)NULL, string, &left, &right) != TCL_OK) {
-	return FALSE;
-    }
-    if (left != NULL) {
-        Tcl_DString kStr, iStr;
-        Tcl_DStringInit(&kStr);
-        Tcl_DStringInit(&iStr);
-        Tcl_DStringAppend(&kStr, left+1, right-left-1);
-        Tcl_DStringAppend(&iStr, string, left-string);
-        result = Blt_TreeArrayValueExists(clientPtr, nodePtr,
-	   Tcl_DStringValue(&iStr), Tcl_DStringValue(&kStr));
-	Tcl_DStringFree(&kStr);
-	Tcl_DStringFree(&iStr);
-    } else {
-	result = Blt_TreeValueExistsByKey(clientPtr, nodePtr, 
-		Blt_TreeKeyGet(NULL, clientPtr->treeObject,string));
+    hPtr = Blt_FindHashEntry(&clientPtr->treeObject->keyIndexTable, key);
+    if (hPtr == NULL) {
+	return TCL_ERROR;
     }
-    return result;
+    indexPtr = Blt_GetHashValue(hPtr);
+    *typePtr = indexPtr->type;
+    *flagsPtr = indexPtr->flags;
+    return TCL_OK;
 }
 
-Blt_TreeKey
-Blt_TreeFirstKey(
-    TreeClient *clientPtr, 
-    Node *nodePtr, 
-    Blt_TreeKeySearch *iterPtr)
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeKeyIndexNames --
+ *
+ *	Appends the indexed keys matching the pattern to the list.
+ *	If pattern is NULL, all indexed keys are appended.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Blt_TreeKeyIndexNames(
+    TreeClient *clientPtr,
+    CONST char *pattern,
+    Tcl_Obj *listObjPtr)
 {
-    Value *valuePtr;
-    
-    valuePtr = TreeFirstValue(nodePtr, iterPtr);
-    if (valuePtr == NULL) {
-	return NULL;
-    }
-    while ((valuePtr->owner != NULL) && (valuePtr->owner != clientPtr)) {
-	valuePtr = TreeNextValue(iterPtr);
-	if (valuePtr == NULL) {
-	    return NULL;
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
+    KeyIndex *indexPtr;
+
+    for (hPtr = Blt_FirstHashEntry(&clientPtr->treeObject->keyIndexTable, 
+	&cursor); hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	indexPtr = Blt_GetHashValue(hPtr);
+	if ((pattern == NULL) || (Tcl_StringMatch(indexPtr->key, pattern))) {
+	    Tcl_ListObjAppendElement((Tcl_Interp *)NULL, listObjPtr, 
+		Tcl_NewStringObj(indexPtr->key, -1));
 	}
     }
-    return valuePtr->key;
 }
 
-Blt_TreeKey
-Blt_TreeNextKey(TreeClient *clientPtr, Blt_TreeKeySearch *iterPtr)
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeKeyIndexFind --
+ *
+ *	Looks up the nodes whose value of the key is the given string.
+ *	For typed indexes, numeric values are matched by number, so
+ *	"1.0" finds "1.00" in a real index.  The nodes are in no
+ *	particular order.
+ *
+ * Results:
+ *	Returns the number of nodes found, or -1 if the key isn't
+ *	indexed.  The array of nodes is left in nodesPtr and must be
+ *	freed with Blt_Free.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeKeyIndexFind(
+    TreeClient *clientPtr,
+    Blt_TreeKey key,
+    CONST char *string,
+    Blt_TreeNode **nodesPtr)
 {
-    Value *valuePtr;
+    Blt_HashEntry *hPtr;
+    KeyIndexBucket *bucketPtr;
+    int nNodes, nAlloc;
 
-    valuePtr = TreeNextValue(iterPtr);
-    if (valuePtr == NULL) {
-	return NULL;
+    *nodesPtr = NULL;
+    hPtr = Blt_FindHashEntry(&clientPtr->treeObject->keyIndexTable, key);
+    if (hPtr == NULL) {
+	return -1;
     }
-    while ((valuePtr->owner != NULL) && (valuePtr->owner != clientPtr)) {
-	valuePtr = TreeNextValue(iterPtr);
-	if (valuePtr == NULL) {
-	    return NULL;
-	}
+    nNodes = nAlloc = 0;
+    bucketPtr = FindKeyIndexBucket(Blt_GetHashValue(hPtr), string);
+    if (bucketPtr != NULL) {
+	AppendBucketNodes(bucketPtr, (Node ***)nodesPtr, &nNodes, &nAlloc);
     }
-    return valuePtr->key;
+    return nNodes;
 }
 
-int Blt_TreeCountKeys(TreeClient *clientPtr, Node *nodePtr) {
-    int cnt = 0;
-    Blt_TreeKey key;
-    Blt_TreeKeySearch cursor;
-    
-         
-    for (key = Blt_TreeFirstKey(clientPtr, nodePtr, &cursor); key != NULL;
-        key = Blt_TreeNextKey(clientPtr, &cursor)) {
-        cnt++;
+/*
+ * Returns the position of the first bucket in the order not less
+ * than the bound (or greater than it, if after is set).
+ */
+static int
+SearchKeyIndexOrder(KeyIndex *indexPtr, KeyIndexBucket *boundPtr, int after)
+{
+    int low, high, mid, result;
+
+    keyIndexType = indexPtr->type;
+    low = 0, high = indexPtr->nOrder;
+    while (low < high) {
+	mid = (low + high) / 2;
+	result = CompareKeyIndexBuckets(&indexPtr->order[mid], &boundPtr);
+	if ((result < 0) || ((after) && (result == 0))) {
+	    low = mid + 1;
+	} else {
+	    high = mid;
+	}
     }
-    return cnt;
+    return low;
 }
 
-
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeKeyIndexRange --
+ *
+ *	Looks up the nodes whose value of the key lies between low
+ *	and high, inclusive, using an ordered index.  Either bound may
+ *	be NULL for no limit.  Values of typed indexes that aren't
+ *	numbers are never in range.  The nodes are ordered by value.
+ *
+ * Results:
+ *	Returns the number of nodes found, or -1 if the key doesn't
+ *	have an ordered index or a bound isn't a number of the
+ *	index's type.  The array of nodes is left in nodesPtr and must
+ *	be freed with Blt_Free.
+ *
+ *----------------------------------------------------------------------
+ */
 int
-Blt_TreeIsAncestor(Node *n1Ptr, Node *n2Ptr)
+Blt_TreeKeyIndexRange(
+    Tcl_Interp *interp,
+    TreeClient *clientPtr,
+    Blt_TreeKey key,
+    CONST char *low,
+    CONST char *high,
+    Blt_TreeNode **nodesPtr)
 {
-    if (n2Ptr != NULL) {
-	n2Ptr = n2Ptr->parent;
-	while (n2Ptr != NULL) {
-	    if (n2Ptr == n1Ptr) {
-		return TRUE;
+    Blt_HashEntry *hPtr;
+    KeyIndex *indexPtr;
+    KeyIndexBucket bounds[2];
+    CONST char *strings[2];
+    int first, last, i;
+    int nNodes, nAlloc;
+
+    *nodesPtr = NULL;
+    hPtr = Blt_FindHashEntry(&clientPtr->treeObject->keyIndexTable, key);
+    indexPtr = (hPtr == NULL) ? NULL : Blt_GetHashValue(hPtr);
+    if ((indexPtr == NULL) || ((indexPtr->flags & TREE_INDEX_ORDERED) == 0)) {
+	if (interp != NULL) {
+	    Tcl_AppendResult(interp, "key \"", key, 
+		"\" has no ordered index", (char *)NULL);
+	}
+	return -1;
+    }
+    strings[0] = low, strings[1] = high;
+    for (i = 0; i < 2; i++) {
+	CONST char *string;
+
+	if (strings[i] == NULL) {
+	    continue;
+	}
+	if (KeyIndexValueKey(indexPtr, strings[i], bounds + i, &string) 
+	    != &indexPtr->valueTable) {
+	    if (interp != NULL) {
+		Tcl_AppendResult(interp, "bad bound \"", strings[i], 
+			"\": should be ", (indexPtr->type == TREE_INDEX_INTEGER)
+			? "an integer" : "a number", (char *)NULL);
 	    }
-	    n2Ptr = n2Ptr->parent;
+	    return -1;
+	}
+	bounds[i].string = strings[i];
+    }
+    SortKeyIndex(indexPtr);
+    first = (low == NULL) ? 0 : SearchKeyIndexOrder(indexPtr, bounds, FALSE);
+    last = (high == NULL) ? indexPtr->nOrder : 
+	SearchKeyIndexOrder(indexPtr, bounds + 1, TRUE);
+    nNodes = nAlloc = 0;
+    for (i = first; i < last; i++) {
+	AppendBucketNodes(indexPtr->order[i], (Node ***)nodesPtr, &nNodes, 
+		&nAlloc);
+    }
+    return nNodes;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RelinkChildren --
+ *
+ *	Relinks the children of a node in the order of the array
+ *	given.  The set of children doesn't change, so the labels in
+ *	the child index are still good.  Only the positions and the
+ *	array of children are reset.
+ *
+ * Results:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+RelinkChildren(
+    Node *parentPtr,
+    Node **nodeArr)		/* Children in their new order. */
+{
+    ChildIndex *indexPtr;
+    Node *prevPtr;
+    unsigned int i, nChildren;
+
+    nChildren = parentPtr->nChildren;
+    indexPtr = GetChildIndex(parentPtr);
+    if ((indexPtr != NULL) && (indexPtr->nAlloc < nChildren)) {
+	indexPtr->nAlloc = nChildren + (nChildren / 2);
+	if (indexPtr->children != NULL) {
+	    Blt_Free(indexPtr->children);
 	}
+	indexPtr->children = Blt_Malloc(indexPtr->nAlloc * sizeof(Node *));
+	assert(indexPtr->children);
     }
-    return FALSE;
+    prevPtr = NULL;
+    for (i = 0; i < nChildren; i++) {
+	Node *childPtr;
+
+	childPtr = nodeArr[i];
+	childPtr->prev = prevPtr;
+	childPtr->position = i;
+	if (prevPtr != NULL) {
+	    prevPtr->next = childPtr;
+	}
+	if (indexPtr != NULL) {
+	    indexPtr->children[i] = childPtr;
+	}
+	prevPtr = childPtr;
+    }
+    prevPtr->next = NULL;
+    parentPtr->first = nodeArr[0];
+    parentPtr->last = prevPtr;
+    parentPtr->flags |= TREE_NODE_POSITIONS;
 }
 
 /*
@@ -2157,6 +4280,9 @@ Blt_TreeSortNode(
     int nNodes;
     register Node **p;
 
+    if (CheckWritable(NULL, nodePtr->treeObject) != TCL_OK) {
+	return TCL_ERROR;
+    }
     nNodes = nodePtr->nChildren;
     if (nNodes < 2) {
 	return TCL_OK;
@@ -2172,14 +4298,42 @@ Blt_TreeSortNode(
     *p = NULL;
 
     qsort((char *)nodeArr, nNodes, sizeof(Node *), (QSortCompareProc *)proc);
-    for (p = nodeArr; *p != NULL; p++) {
-	UnlinkNode(*p);
-	LinkBefore(nodePtr, *p, (Blt_TreeNode)NULL);
-    }
+    RelinkChildren(nodePtr, nodeArr);
     Blt_Free(nodeArr);
     return NotifyClients(clientPtr, nodePtr->treeObject, nodePtr, TREE_NOTIFY_SORT);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeReorderNode --
+ *
+ *	Rearranges the subnodes at a given node into the order given.
+ *	The array must hold each child of the node exactly once.  
+ *	This lets callers sort the children by their own means and
+ *	then relink them in a single pass.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeReorderNode(
+    TreeClient *clientPtr,
+    Node *nodePtr,
+    Node **nodeArr)		/* Children in their new order. */
+{
+    if (CheckWritable(NULL, nodePtr->treeObject) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (nodePtr->nChildren < 2) {
+	return TCL_OK;
+    }
+    RelinkChildren(nodePtr, nodeArr);
+    return NotifyClients(clientPtr, nodePtr->treeObject, nodePtr, TREE_NOTIFY_SORT);
+}
+
 #define TEST_RESULT(result) \
 	switch (result) { \
 	case TCL_CONTINUE: \
@@ -2415,6 +4569,170 @@ Blt_TreeCreate(
     return TCL_OK;
 }
 
+/*
+ * Copies the label, flags and public values of a node into a node of
+ * a snapshot.  Values share their Tcl_Objs with the original.  The
+ * snapshot has the same schema, so slots are copied as they are.
+ */
+static void
+CopySnapshotNode(TreeObject *destObjPtr, Node *srcPtr, Node *destPtr)
+{
+    Blt_TreeKeySearch cursor;
+    Value *srcValuePtr, *valuePtr;
+    int isNew;
+
+    destPtr->label = Blt_TreeKeyGet(NULL, destObjPtr, srcPtr->label);
+    destPtr->flags = srcPtr->flags & 
+	(TREE_NODE_FIXED_FIELDS | TREE_NODE_UNMODIFIED);
+    if (srcPtr->nSlotValues > 0) {
+	unsigned int i;
+
+	destPtr->slots = Blt_Malloc(srcPtr->nSlots * sizeof(Tcl_Obj *));
+	assert(destPtr->slots);
+	for (i = 0; i < srcPtr->nSlots; i++) {
+	    destPtr->slots[i] = srcPtr->slots[i];
+	    if (destPtr->slots[i] != NULL) {
+		Tcl_IncrRefCount(destPtr->slots[i]);
+	    }
+	}
+	destPtr->nSlots = srcPtr->nSlots;
+	destPtr->nSlotValues = srcPtr->nSlotValues;
+    }
+    for (srcValuePtr = TreeFirstValue(srcPtr, &cursor); srcValuePtr != NULL;
+	 srcValuePtr = TreeNextValue(&cursor)) {
+	if ((srcValuePtr->owner != NULL) || (srcValuePtr->objPtr == NULL)) {
+	    continue;		/* Private values aren't copied. */
+	}
+	valuePtr = TreeCreateValue(destPtr, 
+		Blt_TreeKeyGet(NULL, destObjPtr, srcValuePtr->key), &isNew);
+	valuePtr->objPtr = srcValuePtr->objPtr;
+	Tcl_IncrRefCount(valuePtr->objPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeSnapshot --
+ *
+ *	Creates a read-only tree holding the current contents of the
+ *	tree: the nodes with their ids, labels and public values, and
+ *	the tags of the client.  Values aren't duplicated, the snapshot
+ *	shares the Tcl_Objs of the tree.  Later changes to the tree
+ *	don't show in the snapshot.
+ *
+ * Results:
+ *	A standard Tcl result.  The token of the snapshot is returned
+ *	in clientPtrPtr, as by Blt_TreeCreate.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeSnapshot(
+    Tcl_Interp *interp,
+    TreeClient *srcClientPtr,	/* Tree to copy. */
+    CONST char *name,		/* Name of the snapshot.  If NULL, a
+				 * name is generated. */
+    TreeClient **clientPtrPtr)	/* (out) Token of the snapshot. */
+{
+    TreeObject *srcObjPtr, *destObjPtr;
+    TreeClient *clientPtr;
+    Node *srcPtr, *destPtr, *parentPtr;
+    Blt_HashEntry *hPtr, *h2Ptr;
+    Blt_HashSearch cursor, cursor2;
+    Blt_HashTable *tablePtr;
+
+    if (Blt_TreeCreate(interp, name, &clientPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    srcObjPtr = srcClientPtr->treeObject;
+    destObjPtr = clientPtr->treeObject;
+    destObjPtr->flags |= (srcObjPtr->flags & 
+	(TREE_FIXED_KEYS | TREE_DICT_KEYS | TREE_UNMODIFIED));
+    destObjPtr->maxKeyList = srcObjPtr->maxKeyList;
+    if (srcObjPtr->nSchemaKeys > 0) {
+	Blt_TreeKey *keys;
+	unsigned int i;
+
+	keys = Blt_Malloc(srcObjPtr->nSchemaKeys * sizeof(Blt_TreeKey));
+	assert(keys);
+	for (i = 0; i < srcObjPtr->nSchemaKeys; i++) {
+	    keys[i] = Blt_TreeKeyGet(NULL, destObjPtr, 
+		srcObjPtr->schemaKeys[i]);
+	}
+	Blt_TreeSetSchema(interp, clientPtr, srcObjPtr->nSchemaKeys, keys);
+	Blt_Free(keys);
+    }
+
+    /* Copy the nodes in preorder, so that each parent comes first. */
+    CopySnapshotNode(destObjPtr, srcObjPtr->root, destObjPtr->root);
+    for (srcPtr = Blt_TreeNextNode(srcObjPtr->root, srcObjPtr->root); 
+	 srcPtr != NULL; srcPtr = Blt_TreeNextNode(srcObjPtr->root, srcPtr)) {
+	parentPtr = LookupNode(destObjPtr, srcPtr->parent->inode);
+	destPtr = NewNode(destObjPtr, NULL, srcPtr->inode);
+	AddNode(destObjPtr, srcPtr->inode, destPtr);
+	LinkBefore(parentPtr, destPtr, (Node *)NULL);
+	destPtr->depth = parentPtr->depth + 1;
+	CopySnapshotNode(destObjPtr, srcPtr, destPtr);
+    }
+    destObjPtr->nextInode = srcObjPtr->nextInode;
+    if (destObjPtr->depth < srcObjPtr->depth) {
+	destObjPtr->depth = srcObjPtr->depth;
+    }
+
+    /* Copy the client's tags, without calling tag traces. */
+    tablePtr = &clientPtr->tagTablePtr->tagTable;
+    for (hPtr = Blt_FirstHashEntry(&srcClientPtr->tagTablePtr->tagTable, 
+	&cursor); hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	Blt_TreeTagEntry *srcTagPtr, *tPtr;
+	Blt_HashEntry *newPtr;
+	int isNew;
+
+	srcTagPtr = Blt_GetHashValue(hPtr);
+	newPtr = Blt_CreateHashEntry(tablePtr, srcTagPtr->tagName, &isNew);
+	tPtr = Blt_Calloc(sizeof(Blt_TreeTagEntry), 1);
+	assert(tPtr);
+	Blt_InitHashTable(&tPtr->nodeTable, BLT_ONE_WORD_KEYS);
+	Blt_SetHashValue(newPtr, tPtr);
+	tPtr->hashPtr = newPtr;
+	tPtr->tagName = Blt_GetHashKey(tablePtr, newPtr);
+	Blt_TreeTagRefIncr(tPtr);
+	for (h2Ptr = Blt_FirstHashEntry(&srcTagPtr->nodeTable, &cursor2); 
+	     h2Ptr != NULL; h2Ptr = Blt_NextHashEntry(&cursor2)) {
+	    srcPtr = Blt_GetHashValue(h2Ptr);
+	    destPtr = LookupNode(destObjPtr, srcPtr->inode);
+	    if (destPtr != NULL) {
+		newPtr = Blt_CreateHashEntry(&tPtr->nodeTable, (char *)destPtr,
+			&isNew);
+		Blt_SetHashValue(newPtr, destPtr);
+		SetTagBit(tPtr, destPtr);
+	    }
+	}
+    }
+    destObjPtr->flags |= TREE_SNAPSHOT;
+    if (clientPtrPtr != NULL) {
+	*clientPtrPtr = clientPtr;
+    } else {
+	Blt_TreeReleaseToken(clientPtr);
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeIsSnapshot --
+ *
+ *	Indicates if the tree is a read-only snapshot.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeIsSnapshot(TreeClient *clientPtr)
+{
+    return ((clientPtr->treeObject->flags & TREE_SNAPSHOT) != 0);
+}
+
 int
 Blt_TreeGetToken(
     Tcl_Interp *interp,		/* Interpreter to report errors back to. */
@@ -2486,10 +4804,7 @@ Blt_TreeReleaseToken(TreeClient *clientPtr)
     for (linkPtr = Blt_ChainFirstLink(clientPtr->traces); linkPtr != NULL;
 	 linkPtr = Blt_ChainNextLink(linkPtr)) {
 	tracePtr = Blt_ChainGetValue(linkPtr);
-	if (tracePtr->keyPattern != NULL) {
-	    Blt_Free(tracePtr->keyPattern);
-	}
-	Blt_Free(tracePtr);
+	RemoveTrace(tracePtr);
     }
     Blt_ChainDestroy(clientPtr->traces);
     /* And any event handlers. */
@@ -2506,6 +4821,12 @@ Blt_TreeReleaseToken(TreeClient *clientPtr)
     }
     Blt_ChainDestroy(clientPtr->events);
     treeObjPtr = clientPtr->treeObject;
+    if ((treeObjPtr != NULL) && (treeObjPtr->batchPtr != NULL) &&
+	(treeObjPtr->batchPtr->clientPtr == clientPtr)) {
+	/* Discard the changes held back by the client's batch. */
+	FreeBatch(treeObjPtr->batchPtr);
+	treeObjPtr->batchPtr = NULL;
+    }
     if (treeObjPtr != NULL) {
 	/* Remove the client from the server's list */
 	Blt_ChainDeleteLink(treeObjPtr->clients, clientPtr->linkPtr);
@@ -2709,33 +5030,33 @@ Blt_TreeArrayValueExists(
     Blt_TreeKey key;
     Blt_HashEntry *hPtr;
     Blt_HashTable *tablePtr;
-    register Value *valuePtr;
+    Tcl_Obj **objPtrPtr;
     int cnt;
     TreeObject *treeObjPtr = nodePtr->treeObject;
     Tcl_Interp *interp = treeObjPtr->interp;
 
     key = Blt_TreeKeyGet(NULL, clientPtr->treeObject,arrayName);
     
-    valuePtr = GetTreeValue((Tcl_Interp *)NULL, clientPtr, nodePtr, key);
-    if (valuePtr == NULL && (!(nodePtr->flags & TREE_TRACE_ACTIVE))) {
+    objPtrPtr = GetTreeValue((Tcl_Interp *)NULL, clientPtr, nodePtr, key);
+    if (objPtrPtr == NULL && (!(nodePtr->flags & TREE_TRACE_ACTIVE))) {
         if (CallTraces(interp, clientPtr, treeObjPtr, nodePtr, key, 
             TREE_TRACE_EXISTS, &cnt) != TCL_OK) {
                 Tcl_ResetResult(interp);
             } else {
-                valuePtr = GetTreeValue((Tcl_Interp *)NULL, clientPtr, nodePtr, key);
+                objPtrPtr = GetTreeValue((Tcl_Interp *)NULL, clientPtr, nodePtr, key);
             }
     }
-    if (valuePtr == NULL) {
+    if (objPtrPtr == NULL) {
 	return FALSE;
     }
-    if (IsTclDict(interp, valuePtr->objPtr)) {
+    if (IsTclDict(interp, *objPtrPtr)) {
         /* Preserve type if this was a dict */
         int result;
         Tcl_Obj *keyPtr, *valueObjPtr = NULL;
         
         keyPtr = Tcl_NewStringObj(elemName, -1);
         Tcl_IncrRefCount(keyPtr);
-        result = Tcl_DictObjGet(interp, valuePtr->objPtr, keyPtr, &valueObjPtr);
+        result = Tcl_DictObjGet(interp, *objPtrPtr, keyPtr, &valueObjPtr);
         Tcl_DecrRefCount(keyPtr);
         if (result != TCL_OK) {
             return FALSE;
@@ -2746,12 +5067,12 @@ Blt_TreeArrayValueExists(
         return TRUE;
     }
 
-    if (Blt_IsArrayObj(valuePtr->objPtr) == 0 && Tcl_IsShared(valuePtr->objPtr)) {
-	Tcl_DecrRefCount(valuePtr->objPtr);
-	valuePtr->objPtr = Tcl_DuplicateObj(valuePtr->objPtr);
-	Tcl_IncrRefCount(valuePtr->objPtr);
+    if (Blt_IsArrayObj(*objPtrPtr) == 0 && Tcl_IsShared(*objPtrPtr)) {
+	Tcl_DecrRefCount(*objPtrPtr);
+	*objPtrPtr = Tcl_DuplicateObj(*objPtrPtr);
+	Tcl_IncrRefCount(*objPtrPtr);
     }
-    if (Blt_GetArrayFromObj((Tcl_Interp *)NULL, valuePtr->objPtr, &tablePtr) 
+    if (Blt_GetArrayFromObj((Tcl_Interp *)NULL, *objPtrPtr, &tablePtr) 
 	!= TCL_OK) {
 	return FALSE;
     }
@@ -2771,7 +5092,7 @@ Blt_TreeGetArrayValue(
     Blt_TreeKey key;
     Blt_HashEntry *hPtr;
     Blt_HashTable *tablePtr;
-    register Value *valuePtr;
+    Tcl_Obj **objPtrPtr;
     int cnt = 0;
 
     key = Blt_TreeKeyGet(interp, clientPtr->treeObject,arrayName);
@@ -2783,17 +5104,17 @@ Blt_TreeGetArrayValue(
                 return TCL_ERROR;
         }
     }
-    valuePtr = GetTreeValue(interp, clientPtr, nodePtr, key);
-    if (valuePtr == NULL) {
+    objPtrPtr = GetTreeValue(interp, clientPtr, nodePtr, key);
+    if (objPtrPtr == NULL) {
 	return TCL_ERROR;
     }
-    if (IsTclDict(interp, valuePtr->objPtr)) {
+    if (IsTclDict(interp, *objPtrPtr)) {
         /* Preserve type if this was a dict */
         int result;
         Tcl_Obj *keyPtr;
         keyPtr = Tcl_NewStringObj(elemName, -1);
         Tcl_IncrRefCount(keyPtr);
-        result = Tcl_DictObjGet(interp, valuePtr->objPtr, keyPtr, valueObjPtrPtr);
+        result = Tcl_DictObjGet(interp, *objPtrPtr, keyPtr, valueObjPtrPtr);
         Tcl_DecrRefCount(keyPtr);
         if (result != TCL_OK) {
             return result;
@@ -2807,12 +5128,12 @@ Blt_TreeGetArrayValue(
         }            
         return TCL_OK;
     }
-    if (Blt_IsArrayObj(valuePtr->objPtr) == 0 && Tcl_IsShared(valuePtr->objPtr)) {
-	Tcl_DecrRefCount(valuePtr->objPtr);
-	valuePtr->objPtr = Tcl_DuplicateObj(valuePtr->objPtr);
-	Tcl_IncrRefCount(valuePtr->objPtr);
-    }
-    if (Blt_GetArrayFromObj(interp, valuePtr->objPtr, &tablePtr) != TCL_OK) {
+    if (Blt_IsArrayObj(*objPtrPtr) == 0 && Tcl_IsShared(*objPtrPtr)) {
+	Tcl_DecrRefCount(*objPtrPtr);
+	*objPtrPtr = Tcl_DuplicateObj(*objPtrPtr);
+	Tcl_IncrRefCount(*objPtrPtr);
+    }
+    if (Blt_GetArrayFromObj(interp, *objPtrPtr, &tablePtr) != TCL_OK) {
 	return TCL_ERROR;
     }
     hPtr = Blt_FindHashEntry(tablePtr, elemName);
@@ -2841,31 +5162,37 @@ TreeSetArrayValue(
     Blt_TreeKey key;
     Blt_HashEntry *hPtr;
     Blt_HashTable *tablePtr;
-    register Value *valuePtr;
+    Tcl_Obj **objPtrPtr;
+    Value *valuePtr;
     unsigned int flags;
     int isNew, cnt = 0;
 
     assert(valueObjPtr != NULL);
+    if (CheckWritable(interp, nodePtr->treeObject) != TCL_OK) {
+	return TCL_ERROR;
+    }
 
     /* 
      * Search for the array in the list of data fields.  If one
      * doesn't exist, create it.
      */
     key = Blt_TreeKeyGet(interp, clientPtr->treeObject,arrayName);
-    valuePtr = GetTreeValue((Tcl_Interp *)NULL, clientPtr, nodePtr, key);
-    if (valuePtr == NULL && create == 0) {
+    objPtrPtr = GetTreeValue((Tcl_Interp *)NULL, clientPtr, nodePtr, key);
+    if (objPtrPtr == NULL && create == 0) {
         return TCL_ERROR;
     }
-    if (valuePtr == NULL) {
+    if (objPtrPtr == NULL) {
         if ((nodePtr->flags & TREE_NODE_FIXED_FIELDS)) {
             return TCL_ERROR;
         }
-        valuePtr = TreeCreateValue(nodePtr, key, &isNew);
+        objPtrPtr = TreeCreateValueObj(nodePtr, key, &valuePtr, &isNew);
         isNew = 1;
     } else {
+        valuePtr = NULL;
         isNew = 0;
     }
-    if ((valuePtr->owner != NULL) && (valuePtr->owner != clientPtr)) {
+    if ((valuePtr != NULL) && (valuePtr->owner != NULL) && 
+	(valuePtr->owner != clientPtr)) {
 	if (interp != NULL) {
 	    Tcl_AppendResult(interp, "can't set private field \"", 
 			     key, "\"", (char *)NULL);
@@ -2874,25 +5201,25 @@ TreeSetArrayValue(
     }
     flags = TREE_TRACE_WRITE;
     if (isNew) {
-	valuePtr->objPtr = Blt_NewArrayObj(0, (Tcl_Obj **)NULL);
-	Tcl_IncrRefCount(valuePtr->objPtr);
+	*objPtrPtr = Blt_NewArrayObj(0, (Tcl_Obj **)NULL);
+	Tcl_IncrRefCount(*objPtrPtr);
 	flags |= TREE_TRACE_CREATE;
 	
-     } else if (Tcl_IsShared(valuePtr->objPtr)) {
-	Tcl_DecrRefCount(valuePtr->objPtr);
-	valuePtr->objPtr = Tcl_DuplicateObj(valuePtr->objPtr);
-	Tcl_IncrRefCount(valuePtr->objPtr);
+     } else if (Tcl_IsShared(*objPtrPtr)) {
+	Tcl_DecrRefCount(*objPtrPtr);
+	*objPtrPtr = Tcl_DuplicateObj(*objPtrPtr);
+	Tcl_IncrRefCount(*objPtrPtr);
     }
     
     if ((clientPtr->treeObject->flags & TREE_DICT_KEYS) &&
-        IsTclDict(interp, valuePtr->objPtr)) {
+        IsTclDict(interp, *objPtrPtr)) {
         int dSiz;
         
-        if (Tcl_DictObjSize(interp, valuePtr->objPtr, &dSiz) != TCL_OK) {
+        if (Tcl_DictObjSize(interp, *objPtrPtr, &dSiz) != TCL_OK) {
             return TCL_ERROR;
         }
     }
-    if (IsTclDict(interp, valuePtr->objPtr)) {
+    if (IsTclDict(interp, *objPtrPtr)) {
         /* Preserve type if this was a dict */
         int result;
         Tcl_Obj *keyPtr, *valObjPtr;
@@ -2900,14 +5227,14 @@ TreeSetArrayValue(
         keyPtr = Tcl_NewStringObj(elemName, -1);
         Tcl_IncrRefCount(keyPtr);
         if (!create) {
-            result = Tcl_DictObjGet(interp, valuePtr->objPtr, keyPtr, &valObjPtr);
+            result = Tcl_DictObjGet(interp, *objPtrPtr, keyPtr, &valObjPtr);
             if (result != TCL_OK || valObjPtr == NULL) {
                 Tcl_AppendResult(interp, "can't find field: ", elemName, 0);
                 Tcl_DecrRefCount(keyPtr);
                 return TCL_ERROR;
             }
         }
-        result = Tcl_DictObjPut(interp, valuePtr->objPtr, keyPtr, valueObjPtr);
+        result = Tcl_DictObjPut(interp, *objPtrPtr, keyPtr, valueObjPtr);
         Tcl_DecrRefCount(keyPtr);
         if (result != TCL_OK) {
             return result;
@@ -2916,10 +5243,10 @@ TreeSetArrayValue(
     }
 
 
-    if (Blt_GetArrayFromObj(interp, valuePtr->objPtr, &tablePtr) != TCL_OK) {
+    if (Blt_GetArrayFromObj(interp, *objPtrPtr, &tablePtr) != TCL_OK) {
 	return TCL_ERROR;
     }
-    Tcl_InvalidateStringRep(valuePtr->objPtr);
+    Tcl_InvalidateStringRep(*objPtrPtr);
     if (create) {
         hPtr = Blt_CreateHashEntry(tablePtr, elemName, &isNew);
         assert(hPtr);
@@ -2958,13 +5285,14 @@ TreeSetArrayValue(
     Blt_SetHashValue(hPtr, valueObjPtr);
 
 finishset:
+    IndexValue(nodePtr, key, *objPtrPtr);
     /*
      * We don't handle traces on a per array element basis.  Setting
      * any element can fire traces for the value.
      */
     if (!(nodePtr->flags & TREE_TRACE_ACTIVE)) {
 	return CallTraces(interp, clientPtr, nodePtr->treeObject, nodePtr, 
-		valuePtr->key, flags, &cnt);
+		key, flags, &cnt);
     }
     return TCL_OK;
 }
@@ -3005,15 +5333,20 @@ Blt_TreeUnsetArrayValue(
     Blt_HashEntry *hPtr;
     Blt_HashTable *tablePtr;
     Tcl_Obj *valueObjPtr;
+    Tcl_Obj **objPtrPtr;
     Value *valuePtr;
     int cnt = 0;
 
+    if (CheckWritable(interp, nodePtr->treeObject) != TCL_OK) {
+	return TCL_ERROR;
+    }
     key = Blt_TreeKeyGet(interp, clientPtr->treeObject,arrayName);
-    valuePtr = TreeFindValue(nodePtr, key);
-    if (valuePtr == NULL) {
+    objPtrPtr = TreeFindValueObj(nodePtr, key, &valuePtr);
+    if (objPtrPtr == NULL) {
 	return TCL_OK;
     }
-    if ((valuePtr->owner != NULL) && (valuePtr->owner != clientPtr)) {
+    if ((valuePtr != NULL) && (valuePtr->owner != NULL) && 
+	(valuePtr->owner != clientPtr)) {
 	if (interp != NULL) {
 	    Tcl_AppendResult(interp, "can't unset private field \"", 
 			     key, "\"", (char *)NULL);
@@ -3021,19 +5354,19 @@ Blt_TreeUnsetArrayValue(
 	return TCL_ERROR;
     }
         
-    if (Tcl_IsShared(valuePtr->objPtr)) {
-	Tcl_DecrRefCount(valuePtr->objPtr);
-	valuePtr->objPtr = Tcl_DuplicateObj(valuePtr->objPtr);
-	Tcl_IncrRefCount(valuePtr->objPtr);
+    if (Tcl_IsShared(*objPtrPtr)) {
+	Tcl_DecrRefCount(*objPtrPtr);
+	*objPtrPtr = Tcl_DuplicateObj(*objPtrPtr);
+	Tcl_IncrRefCount(*objPtrPtr);
     }
     
-    if (IsTclDict(interp, valuePtr->objPtr)) {
+    if (IsTclDict(interp, *objPtrPtr)) {
         /* Preserve type if this was a dict */
         int result;
         Tcl_Obj *keyPtr;
         keyPtr = Tcl_NewStringObj(elemName, -1);
         Tcl_IncrRefCount(keyPtr);
-        result = Tcl_DictObjRemove(interp, valuePtr->objPtr, keyPtr);
+        result = Tcl_DictObjRemove(interp, *objPtrPtr, keyPtr);
         Tcl_DecrRefCount(keyPtr);
         if (result != TCL_OK) {
             return result;
@@ -3041,7 +5374,7 @@ Blt_TreeUnsetArrayValue(
         goto finishrm;
     }
 
-    if (Blt_GetArrayFromObj(interp, valuePtr->objPtr, &tablePtr) != TCL_OK) {
+    if (Blt_GetArrayFromObj(interp, *objPtrPtr, &tablePtr) != TCL_OK) {
 	return TCL_ERROR;
     }
     hPtr = Blt_FindHashEntry(tablePtr, elemName);
@@ -3056,16 +5389,17 @@ Blt_TreeUnsetArrayValue(
         Tcl_DecrRefCount(valueObjPtr);
     }
     Blt_DeleteHashEntry(tablePtr, hPtr);
-    Tcl_InvalidateStringRep(valuePtr->objPtr);
+    Tcl_InvalidateStringRep(*objPtrPtr);
 
 finishrm:
+    IndexValue(nodePtr, key, *objPtrPtr);
     /*
      * Un-setting any element in the array can cause the trace on the value
      * to fire.
      */
     if (!(nodePtr->flags & TREE_TRACE_ACTIVE)) {
 	return CallTraces(interp, clientPtr, nodePtr->treeObject, nodePtr, 
-		valuePtr->key, TREE_TRACE_WRITE, &cnt);
+		key, TREE_TRACE_WRITE, &cnt);
     }
     return TCL_OK;
 }
@@ -3083,22 +5417,22 @@ Blt_TreeArrayNames(
     Blt_HashSearch cursor;
     Blt_HashTable *tablePtr;
     Tcl_Obj *objPtr;
-    Value *valuePtr;
+    Tcl_Obj **objPtrPtr;
     char *key;
 
     key = Blt_TreeKeyGet(interp, clientPtr->treeObject,arrayName);
-    valuePtr = GetTreeValue(interp, clientPtr, nodePtr, key);
-    if (valuePtr == NULL) {
+    objPtrPtr = GetTreeValue(interp, clientPtr, nodePtr, key);
+    if (objPtrPtr == NULL) {
 	return TCL_ERROR;
     }
-    if (IsTclDict(interp, valuePtr->objPtr)) {
+    if (IsTclDict(interp, *objPtrPtr)) {
         /* Preserve type if this was a dict */
 
         Tcl_DictSearch search;
         Tcl_Obj *keyPtr;
         int done;
         
-        Tcl_DictObjFirst(NULL, valuePtr->objPtr, &search, &keyPtr, NULL, &done);
+        Tcl_DictObjFirst(NULL, *objPtrPtr, &search, &keyPtr, NULL, &done);
         for (; !done ; Tcl_DictObjNext(&search, &keyPtr, NULL, &done)) {
             if (!pattern || Tcl_StringMatch(Tcl_GetString(keyPtr), pattern)) {
                 Tcl_ListObjAppendElement(NULL, listObjPtr, keyPtr);
@@ -3108,15 +5442,15 @@ Blt_TreeArrayNames(
         return TCL_OK;
     }
 
-    if (Blt_IsArrayObj(valuePtr->objPtr) == 0 && Tcl_IsShared(valuePtr->objPtr)) {
-	Tcl_DecrRefCount(valuePtr->objPtr);
-	valuePtr->objPtr = Tcl_DuplicateObj(valuePtr->objPtr);
-	Tcl_IncrRefCount(valuePtr->objPtr);
+    if (Blt_IsArrayObj(*objPtrPtr) == 0 && Tcl_IsShared(*objPtrPtr)) {
+	Tcl_DecrRefCount(*objPtrPtr);
+	*objPtrPtr = Tcl_DuplicateObj(*objPtrPtr);
+	Tcl_IncrRefCount(*objPtrPtr);
     }
-    if (Blt_GetArrayFromObj(interp, valuePtr->objPtr, &tablePtr) != TCL_OK) {
+    if (Blt_GetArrayFromObj(interp, *objPtrPtr, &tablePtr) != TCL_OK) {
 	return TCL_ERROR;
     }
-    /*tablePtr = (Blt_HashTable *)valuePtr->objPtr; */
+    /*tablePtr = (Blt_HashTable *)*objPtrPtr; */
     for (hPtr = Blt_FirstHashEntry(tablePtr, &cursor); hPtr != NULL; 
 	 hPtr = Blt_NextHashEntry(&cursor)) {
 	 char *str;
@@ -3143,14 +5477,14 @@ Blt_TreeArrayValues(
     Blt_HashSearch cursor;
     Blt_HashTable *tablePtr;
     Tcl_Obj *objPtr;
-    Value *valuePtr;
+    Tcl_Obj **objPtrPtr;
     char *key;
 
     key = Blt_TreeKeyGet(interp, clientPtr->treeObject,arrayName);
-    if ( bltTreeGetValueByKey(interp, clientPtr, nodePtr, key, &valuePtr) != TCL_OK) {
+    if ( bltTreeGetValueByKey(interp, clientPtr, nodePtr, key, &objPtrPtr) != TCL_OK) {
 	return TCL_ERROR;
     }
-    if (IsTclDict(interp, valuePtr->objPtr)) {
+    if (IsTclDict(interp, *objPtrPtr)) {
         /* Preserve type if this was a dict */
 
         Tcl_DictSearch search;
@@ -3158,7 +5492,7 @@ Blt_TreeArrayValues(
         int done;
         int result;
         
-        Tcl_DictObjFirst(NULL, valuePtr->objPtr, &search, &keyPtr, NULL, &done);
+        Tcl_DictObjFirst(NULL, *objPtrPtr, &search, &keyPtr, NULL, &done);
         for (; !done ; Tcl_DictObjNext(&search, &keyPtr, NULL, &done)) {
             Tcl_Obj *valueObjPtr;
             if (names) {
@@ -3166,7 +5500,7 @@ Blt_TreeArrayValues(
             }
                 
             valueObjPtr = NULL;
-            result = Tcl_DictObjGet(interp, valuePtr->objPtr, keyPtr, &valueObjPtr);
+            result = Tcl_DictObjGet(interp, *objPtrPtr, keyPtr, &valueObjPtr);
             if (result != TCL_OK) {
                 continue;
             }
@@ -3178,15 +5512,15 @@ Blt_TreeArrayValues(
         Tcl_DictObjDone(&search);
         return TCL_OK;
     }
-    if (Blt_IsArrayObj(valuePtr->objPtr) == 0 && Tcl_IsShared(valuePtr->objPtr)) {
-	Tcl_DecrRefCount(valuePtr->objPtr);
-	valuePtr->objPtr = Tcl_DuplicateObj(valuePtr->objPtr);
-	Tcl_IncrRefCount(valuePtr->objPtr);
+    if (Blt_IsArrayObj(*objPtrPtr) == 0 && Tcl_IsShared(*objPtrPtr)) {
+	Tcl_DecrRefCount(*objPtrPtr);
+	*objPtrPtr = Tcl_DuplicateObj(*objPtrPtr);
+	Tcl_IncrRefCount(*objPtrPtr);
     }
-    if (Blt_GetArrayFromObj(interp, valuePtr->objPtr, &tablePtr) != TCL_OK) {
+    if (Blt_GetArrayFromObj(interp, *objPtrPtr, &tablePtr) != TCL_OK) {
 	return TCL_ERROR;
     }
-    /*tablePtr = (Blt_HashTable *)valuePtr->objPtr; */
+    /*tablePtr = (Blt_HashTable *)*objPtrPtr; */
     for (hPtr = Blt_FirstHashEntry(tablePtr, &cursor); hPtr != NULL; 
 	 hPtr = Blt_NextHashEntry(&cursor)) {
 	if (names) {
@@ -3241,6 +5575,7 @@ Blt_TreeClearTags(TreeClient *clientPtr, Blt_TreeNode node)
 	if (h2Ptr != NULL) {
              SetModified(node);
              Blt_DeleteHashEntry(&tPtr->nodeTable, h2Ptr);
+             ClearTagBit(tPtr, node);
 	}
     }
 }
@@ -3272,11 +5607,7 @@ Blt_TreeHasTag(
 	return FALSE;
     }
     tPtr = Blt_GetHashValue(hPtr);
-    hPtr = Blt_FindHashEntry(&tPtr->nodeTable, (char *)node);
-    if (hPtr == NULL) {
-	return FALSE;
-    }
-    return TRUE;
+    return Blt_TreeTagEntryHasNode(tPtr, node);
 }
 
 int
@@ -3333,10 +5664,47 @@ Blt_TreeAddTag(
     if (isNew) {
         SetModified(node);
         Blt_SetHashValue(hPtr, node);
+        SetTagBit(tPtr, node);
     }
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeRemoveTag --
+ *
+ *	Removes the tag from the node.  Unlike Blt_TreeAddTag, no
+ *	traces are called; see Blt_TreeTagDelTrace.
+ *
+ * Results:
+ *	Returns 1 if the node had the tag, 0 otherwise.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeRemoveTag(
+    TreeClient *clientPtr,
+    Blt_TreeNode node,
+    CONST char *tagName)
+{
+    Blt_HashEntry *hPtr;
+    Blt_TreeTagEntry *tPtr;
+
+    hPtr = Blt_FindHashEntry(&clientPtr->tagTablePtr->tagTable, tagName);
+    if (hPtr == NULL) {
+	return FALSE;
+    }
+    tPtr = Blt_GetHashValue(hPtr);
+    hPtr = Blt_FindHashEntry(&tPtr->nodeTable, (char *)node);
+    if (hPtr == NULL) {
+	return FALSE;
+    }
+    Blt_DeleteHashEntry(&tPtr->nodeTable, hPtr);
+    ClearTagBit(tPtr, node);
+    return TRUE;
+}
+
 /* Trigger tag delete traces. */
 int
 Blt_TreeTagDelTrace(
@@ -3351,77 +5719,583 @@ Blt_TreeTagDelTrace(
         return CallTraces(interp, clientPtr, node->treeObject, node, (Blt_TreeKey)tagName, 
             (TREE_TRACE_TAGDELETE), &cnt);
     }
-    return TCL_OK;
+    return TCL_OK;
+}
+
+int
+Blt_TreeForgetTag(TreeClient *clientPtr, CONST char *tagName)
+{
+    Blt_HashEntry *hPtr;
+    if ((strcmp(tagName, "all") == 0) || (strcmp(tagName, "root") == 0)
+       || (strcmp(tagName, "nonroot") == 0)
+       || (strcmp(tagName, "rootchildren") == 0)) {
+       return TCL_OK;
+    }
+	
+    hPtr = Blt_FindHashEntry(&clientPtr->tagTablePtr->tagTable, tagName);
+    if (hPtr != NULL) {
+        Blt_TreeTagEntry *tPtr;
+        Blt_TreeNode node;
+        Blt_HashSearch cursor;
+	    
+        Blt_DeleteHashEntry(&clientPtr->tagTablePtr->tagTable, hPtr);
+        tPtr = Blt_GetHashValue(hPtr);
+        for (hPtr = Blt_FirstHashEntry(&tPtr->nodeTable, &cursor);
+            hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+                 
+            node = Blt_GetHashKey(&tPtr->nodeTable, hPtr);
+            if (Blt_TreeTagDelTrace(clientPtr, node, tagName) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            SetModified(node);
+        }
+        FreeTagNodes(tPtr);
+        Blt_TreeTagRefDecr(tPtr);
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeTagHashTable --
+ *
+ *---------------------------------------------------------------------- 
+ */
+Blt_HashTable *
+Blt_TreeTagHashTable(TreeClient *clientPtr, CONST char *tagName)
+{
+    Blt_HashEntry *hPtr;
+   
+    hPtr = Blt_FindHashEntry(&clientPtr->tagTablePtr->tagTable, tagName);
+    if (hPtr != NULL) {
+	Blt_TreeTagEntry *tPtr;
+	
+	tPtr = Blt_GetHashValue(hPtr);
+	return &tPtr->nodeTable;
+    }
+    return NULL;
+}
+
+Blt_TreeTagEntry *
+Blt_TreeTagHashEntry(TreeClient *clientPtr, CONST char *tagName)
+{
+    Blt_HashEntry *hPtr;
+   
+    hPtr = Blt_FindHashEntry(&clientPtr->tagTablePtr->tagTable, tagName);
+    if (hPtr != NULL) {
+	Blt_TreeTagEntry *tPtr;
+	
+	tPtr = Blt_GetHashValue(hPtr);
+	return tPtr;
+    }
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tag queries --
+ *
+ *	A tag query is an expression of tags joined by the operators
+ *	&&, ^ and || (from highest to lowest precedence) and negated
+ *	by !, with parentheses for grouping, as in the tag expressions
+ *	of the Tk canvas.  Tags containing blanks or operators can be
+ *	given in double quotes.  The reserved tag "all" matches every
+ *	node, "root" the root of the client, "nonroot" every other
+ *	node, and "rootchildren" the children of the root.  Unknown
+ *	tags match no nodes.
+ *
+ *	The query is compiled into postfix form with the tags looked
+ *	up once.  The nodes matching a query are found by combining
+ *	whole words of the tags' bitsets, 32 nodes at a time.
+ *
+ *----------------------------------------------------------------------
+ */
+#define TAG_QUERY_TAG		0	/* Nodes having a tag. */
+#define TAG_QUERY_ALL		1	/* All nodes. */
+#define TAG_QUERY_NODE		2	/* A single node. */
+#define TAG_QUERY_CHILDREN	3	/* The children of a node. */
+#define TAG_QUERY_NOT		4
+#define TAG_QUERY_AND		5
+#define TAG_QUERY_OR		6
+#define TAG_QUERY_XOR		7
+
+typedef struct {
+    int op;
+    Blt_TreeTagEntry *tPtr;	/* Tag of TAG_QUERY_TAG, or NULL if
+				 * there is no such tag. */
+    Node *nodePtr;		/* Node of TAG_QUERY_NODE and
+				 * TAG_QUERY_CHILDREN. */
+} TagQueryOp;
+
+struct Blt_TreeTagQueryStruct {
+    TreeClient *clientPtr;
+    TagQueryOp *ops;		/* Operations in postfix order. */
+    int nOps, nAlloc;
+    unsigned int *stack;	/* Evaluation stack, nOps deep. */
+};
+
+/* Tokens of tag queries. */
+#define TAG_TOKEN_END		0
+#define TAG_TOKEN_TAG		1
+#define TAG_TOKEN_NOT		2
+#define TAG_TOKEN_AND		3
+#define TAG_TOKEN_OR		4
+#define TAG_TOKEN_XOR		5
+#define TAG_TOKEN_OPEN		6
+#define TAG_TOKEN_CLOSE		7
+
+typedef struct {
+    Tcl_Interp *interp;
+    Blt_TreeTagQuery *queryPtr;
+    CONST char *expr;		/* Expression being parsed. */
+    CONST char *next;		/* Start of the next token. */
+    int token;			/* Current token. */
+    Tcl_DString tag;		/* Name of the current TAG_TOKEN_TAG. */
+} TagQueryParser;
+
+static int ParseTagQueryOr _ANSI_ARGS_((TagQueryParser *parserPtr));
+
+static int
+NextTagToken(TagQueryParser *parserPtr)
+{
+    CONST char *p;
+
+    for (p = parserPtr->next; isspace(UCHAR(*p)); p++) {
+	/* Skip blanks. */
+    }
+    switch (*p) {
+    case '\0':
+	parserPtr->token = TAG_TOKEN_END;
+	break;
+    case '!':
+	parserPtr->token = TAG_TOKEN_NOT, p++;
+	break;
+    case '^':
+	parserPtr->token = TAG_TOKEN_XOR, p++;
+	break;
+    case '(':
+	parserPtr->token = TAG_TOKEN_OPEN, p++;
+	break;
+    case ')':
+	parserPtr->token = TAG_TOKEN_CLOSE, p++;
+	break;
+    case '&':
+    case '|':
+	if (p[1] != p[0]) {
+	    Tcl_AppendResult(parserPtr->interp, "bad operator \"", 
+		(*p == '&') ? "&" : "|", "\" in tag expression \"", 
+		parserPtr->expr, "\": should be && or ||", (char *)NULL);
+	    return TCL_ERROR;
+	}
+	parserPtr->token = (*p == '&') ? TAG_TOKEN_AND : TAG_TOKEN_OR;
+	p += 2;
+	break;
+    case '"':
+	{
+	    CONST char *start;
+
+	    for (start = ++p; (*p != '"') && (*p != '\0'); p++) {
+		/* Find the closing quote. */
+	    }
+	    if (*p == '\0') {
+		Tcl_AppendResult(parserPtr->interp, "missing close-quote",
+		    " in tag expression \"", parserPtr->expr, "\"", 
+		    (char *)NULL);
+		return TCL_ERROR;
+	    }
+	    Tcl_DStringSetLength(&parserPtr->tag, 0);
+	    Tcl_DStringAppend(&parserPtr->tag, start, p - start);
+	    parserPtr->token = TAG_TOKEN_TAG, p++;
+	}
+	break;
+    default:
+	{
+	    CONST char *start;
+
+	    for (start = p; (*p != '\0') && (!isspace(UCHAR(*p))) && 
+		     (strchr("!^()&|\"", *p) == NULL); p++) {
+		/* Find the end of the tag. */
+	    }
+	    Tcl_DStringSetLength(&parserPtr->tag, 0);
+	    Tcl_DStringAppend(&parserPtr->tag, start, p - start);
+	    parserPtr->token = TAG_TOKEN_TAG;
+	}
+	break;
+    }
+    parserPtr->next = p;
+    return TCL_OK;
+}
+
+static void
+AddTagQueryOp(
+    Blt_TreeTagQuery *queryPtr, 
+    int op, 
+    Blt_TreeTagEntry *tPtr, 
+    Node *nodePtr)
+{
+    TagQueryOp *opPtr;
+
+    if (queryPtr->nOps >= queryPtr->nAlloc) {
+	queryPtr->nAlloc = (queryPtr->nAlloc == 0) ? 8 : queryPtr->nAlloc * 2;
+	queryPtr->ops = Blt_Realloc(queryPtr->ops, 
+		queryPtr->nAlloc * sizeof(TagQueryOp));
+	assert(queryPtr->ops);
+    }
+    opPtr = queryPtr->ops + queryPtr->nOps++;
+    opPtr->op = op;
+    opPtr->tPtr = tPtr;
+    opPtr->nodePtr = nodePtr;
+    if (tPtr != NULL) {
+	Blt_TreeTagRefIncr(tPtr);
+    }
+}
+
+static int
+ParseTagQueryTerm(TagQueryParser *parserPtr)
+{
+    Blt_TreeTagQuery *queryPtr = parserPtr->queryPtr;
+    TreeClient *clientPtr = queryPtr->clientPtr;
+    CONST char *tagName;
+
+    switch (parserPtr->token) {
+    case TAG_TOKEN_NOT:
+	if ((NextTagToken(parserPtr) != TCL_OK) || 
+	    (ParseTagQueryTerm(parserPtr) != TCL_OK)) {
+	    return TCL_ERROR;
+	}
+	AddTagQueryOp(queryPtr, TAG_QUERY_NOT, NULL, NULL);
+	return TCL_OK;
+
+    case TAG_TOKEN_OPEN:
+	if ((NextTagToken(parserPtr) != TCL_OK) || 
+	    (ParseTagQueryOr(parserPtr) != TCL_OK)) {
+	    return TCL_ERROR;
+	}
+	if (parserPtr->token != TAG_TOKEN_CLOSE) {
+	    Tcl_AppendResult(parserPtr->interp, "missing \")\" in ",
+		"tag expression \"", parserPtr->expr, "\"", (char *)NULL);
+	    return TCL_ERROR;
+	}
+	return NextTagToken(parserPtr);
+
+    case TAG_TOKEN_TAG:
+	tagName = Tcl_DStringValue(&parserPtr->tag);
+	if (strcmp(tagName, "all") == 0) {
+	    AddTagQueryOp(queryPtr, TAG_QUERY_ALL, NULL, NULL);
+	} else if (strcmp(tagName, "root") == 0) {
+	    AddTagQueryOp(queryPtr, TAG_QUERY_NODE, NULL, clientPtr->root);
+	} else if (strcmp(tagName, "nonroot") == 0) {
+	    AddTagQueryOp(queryPtr, TAG_QUERY_NODE, NULL, clientPtr->root);
+	    AddTagQueryOp(queryPtr, TAG_QUERY_NOT, NULL, NULL);
+	} else if (strcmp(tagName, "rootchildren") == 0) {
+	    AddTagQueryOp(queryPtr, TAG_QUERY_CHILDREN, NULL, 
+		clientPtr->root);
+	} else {
+	    AddTagQueryOp(queryPtr, TAG_QUERY_TAG, 
+		Blt_TreeTagHashEntry(clientPtr, tagName), NULL);
+	}
+	return NextTagToken(parserPtr);
+    }
+    Tcl_AppendResult(parserPtr->interp, "missing tag in tag expression \"",
+	parserPtr->expr, "\"", (char *)NULL);
+    return TCL_ERROR;
+}
+
+static int
+ParseTagQueryAnd(TagQueryParser *parserPtr)
+{
+    if (ParseTagQueryTerm(parserPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    while (parserPtr->token == TAG_TOKEN_AND) {
+	if ((NextTagToken(parserPtr) != TCL_OK) || 
+	    (ParseTagQueryTerm(parserPtr) != TCL_OK)) {
+	    return TCL_ERROR;
+	}
+	AddTagQueryOp(parserPtr->queryPtr, TAG_QUERY_AND, NULL, NULL);
+    }
+    return TCL_OK;
+}
+
+static int
+ParseTagQueryXor(TagQueryParser *parserPtr)
+{
+    if (ParseTagQueryAnd(parserPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    while (parserPtr->token == TAG_TOKEN_XOR) {
+	if ((NextTagToken(parserPtr) != TCL_OK) || 
+	    (ParseTagQueryAnd(parserPtr) != TCL_OK)) {
+	    return TCL_ERROR;
+	}
+	AddTagQueryOp(parserPtr->queryPtr, TAG_QUERY_XOR, NULL, NULL);
+    }
+    return TCL_OK;
+}
+
+static int
+ParseTagQueryOr(TagQueryParser *parserPtr)
+{
+    if (ParseTagQueryXor(parserPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    while (parserPtr->token == TAG_TOKEN_OR) {
+	if ((NextTagToken(parserPtr) != TCL_OK) || 
+	    (ParseTagQueryXor(parserPtr) != TCL_OK)) {
+	    return TCL_ERROR;
+	}
+	AddTagQueryOp(parserPtr->queryPtr, TAG_QUERY_OR, NULL, NULL);
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeCreateTagQuery --
+ *
+ *	Compiles a tag expression.  The tags are those of the client.
+ *
+ * Results:
+ *	Returns the compiled query, to be freed with
+ *	Blt_TreeFreeTagQuery, or NULL if the expression is invalid.
+ *
+ *----------------------------------------------------------------------
+ */
+Blt_TreeTagQuery *
+Blt_TreeCreateTagQuery(
+    Tcl_Interp *interp,
+    TreeClient *clientPtr,
+    CONST char *expr)
+{
+    TagQueryParser parser;
+    Blt_TreeTagQuery *queryPtr;
+    int result;
+
+    queryPtr = Blt_Calloc(1, sizeof(Blt_TreeTagQuery));
+    assert(queryPtr);
+    queryPtr->clientPtr = clientPtr;
+    parser.interp = interp;
+    parser.queryPtr = queryPtr;
+    parser.expr = parser.next = expr;
+    Tcl_DStringInit(&parser.tag);
+    result = NextTagToken(&parser);
+    if (result == TCL_OK) {
+	result = ParseTagQueryOr(&parser);
+    }
+    if ((result == TCL_OK) && (parser.token != TAG_TOKEN_END)) {
+	Tcl_AppendResult(interp, "unexpected \"", 
+	    (parser.token == TAG_TOKEN_CLOSE) ? ")" : 
+	    Tcl_DStringValue(&parser.tag), "\" in tag expression \"", 
+	    expr, "\"", (char *)NULL);
+	result = TCL_ERROR;
+    }
+    Tcl_DStringFree(&parser.tag);
+    if (result != TCL_OK) {
+	Blt_TreeFreeTagQuery(queryPtr);
+	return NULL;
+    }
+    queryPtr->stack = Blt_Malloc(queryPtr->nOps * sizeof(unsigned int));
+    assert(queryPtr->stack);
+    return queryPtr;
+}
+
+void
+Blt_TreeFreeTagQuery(Blt_TreeTagQuery *queryPtr)
+{
+    int i;
+
+    for (i = 0; i < queryPtr->nOps; i++) {
+	if (queryPtr->ops[i].tPtr != NULL) {
+	    Blt_TreeTagRefDecr(queryPtr->ops[i].tPtr);
+	}
+    }
+    if (queryPtr->ops != NULL) {
+	Blt_Free(queryPtr->ops);
+    }
+    if (queryPtr->stack != NULL) {
+	Blt_Free(queryPtr->stack);
+    }
+    Blt_Free(queryPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeTagQueryMatch --
+ *
+ *	Indicates if the node matches the tag query.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeTagQueryMatch(Blt_TreeTagQuery *queryPtr, Node *nodePtr)
+{
+    TagQueryOp *opPtr, *endPtr;
+    unsigned int *sp;
+
+    sp = queryPtr->stack;
+    endPtr = queryPtr->ops + queryPtr->nOps;
+    for (opPtr = queryPtr->ops; opPtr < endPtr; opPtr++) {
+	switch (opPtr->op) {
+	case TAG_QUERY_TAG:
+	    *sp++ = ((opPtr->tPtr != NULL) && 
+		     (Blt_TreeTagEntryHasNode(opPtr->tPtr, nodePtr)));
+	    break;
+	case TAG_QUERY_ALL:
+	    *sp++ = TRUE;
+	    break;
+	case TAG_QUERY_NODE:
+	    *sp++ = (nodePtr == opPtr->nodePtr);
+	    break;
+	case TAG_QUERY_CHILDREN:
+	    *sp++ = (nodePtr->parent == opPtr->nodePtr);
+	    break;
+	case TAG_QUERY_NOT:
+	    sp[-1] = !sp[-1];
+	    break;
+	case TAG_QUERY_AND:
+	    sp--, sp[-1] &= *sp;
+	    break;
+	case TAG_QUERY_OR:
+	    sp--, sp[-1] |= *sp;
+	    break;
+	case TAG_QUERY_XOR:
+	    sp--, sp[-1] ^= *sp;
+	    break;
+	}
+    }
+    return sp[-1];
 }
 
-int
-Blt_TreeForgetTag(TreeClient *clientPtr, CONST char *tagName)
+/* 
+ * Evaluates the query for the 32 inodes of a word of the bitsets.
+ * Bits may be set for inodes that have no node.
+ */
+static unsigned int
+EvalTagQueryWord(Blt_TreeTagQuery *queryPtr, Node **pagePtr, 
+		 unsigned int word)
 {
-    Blt_HashEntry *hPtr;
-    if ((strcmp(tagName, "all") == 0) || (strcmp(tagName, "root") == 0)
-       || (strcmp(tagName, "nonroot") == 0)
-       || (strcmp(tagName, "rootchildren") == 0)) {
-       return TCL_OK;
-    }
-	
-    hPtr = Blt_FindHashEntry(&clientPtr->tagTablePtr->tagTable, tagName);
-    if (hPtr != NULL) {
-        Blt_TreeTagEntry *tPtr;
-        Blt_TreeNode node;
-        Blt_HashSearch cursor;
-	    
-        Blt_DeleteHashEntry(&clientPtr->tagTablePtr->tagTable, hPtr);
-        tPtr = Blt_GetHashValue(hPtr);
-        for (hPtr = Blt_FirstHashEntry(&tPtr->nodeTable, &cursor);
-            hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
-                 
-            node = Blt_GetHashKey(&tPtr->nodeTable, hPtr);
-            if (Blt_TreeTagDelTrace(clientPtr, node, tagName) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            SetModified(node);
-        }
-        Blt_DeleteHashTable(&tPtr->nodeTable);
-        Blt_TreeTagRefDecr(tPtr);
+    TagQueryOp *opPtr, *endPtr;
+    Node **nodeArr;
+    unsigned int *sp, bits;
+    int i;
+
+    sp = queryPtr->stack;
+    endPtr = queryPtr->ops + queryPtr->nOps;
+    for (opPtr = queryPtr->ops; opPtr < endPtr; opPtr++) {
+	switch (opPtr->op) {
+	case TAG_QUERY_TAG:
+	    *sp++ = ((opPtr->tPtr != NULL) && (word < opPtr->tPtr->nWords))
+		? opPtr->tPtr->bits[word] : 0;
+	    break;
+	case TAG_QUERY_ALL:
+	    *sp++ = ~0U;
+	    break;
+	case TAG_QUERY_NODE:
+	    *sp++ = (TAG_WORD(opPtr->nodePtr->inode) == word) ? 
+		TAG_BIT(opPtr->nodePtr->inode) : 0;
+	    break;
+	case TAG_QUERY_CHILDREN:
+	    nodeArr = pagePtr + ((word % TAG_WORDS_PER_PAGE) << 5);
+	    for (bits = 0, i = 0; i < 32; i++) {
+		if ((nodeArr[i] != NULL) && 
+		    (nodeArr[i]->parent == opPtr->nodePtr)) {
+		    bits |= (1U << i);
+		}
+	    }
+	    *sp++ = bits;
+	    break;
+	case TAG_QUERY_NOT:
+	    sp[-1] = ~sp[-1];
+	    break;
+	case TAG_QUERY_AND:
+	    sp--, sp[-1] &= *sp;
+	    break;
+	case TAG_QUERY_OR:
+	    sp--, sp[-1] |= *sp;
+	    break;
+	case TAG_QUERY_XOR:
+	    sp--, sp[-1] ^= *sp;
+	    break;
+	}
     }
-    return TCL_OK;
+    return sp[-1];
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * Blt_TreeTagHashTable --
+ * Blt_TreeTagQueryNodes --
  *
- *---------------------------------------------------------------------- 
+ *	Finds the nodes of the tree matching the tag query, in order
+ *	of their inodes.
+ *
+ * Results:
+ *	Returns the number of nodes found.  The array of nodes is left
+ *	in nodesPtr and must be freed with Blt_Free.
+ *
+ *----------------------------------------------------------------------
  */
-Blt_HashTable *
-Blt_TreeTagHashTable(TreeClient *clientPtr, CONST char *tagName)
+int
+Blt_TreeTagQueryNodes(Blt_TreeTagQuery *queryPtr, Blt_TreeNode **nodesPtr)
 {
+    TreeObject *treeObjPtr = queryPtr->clientPtr->treeObject;
     Blt_HashEntry *hPtr;
-   
-    hPtr = Blt_FindHashEntry(&clientPtr->tagTablePtr->tagTable, tagName);
-    if (hPtr != NULL) {
-	Blt_TreeTagEntry *tPtr;
-	
-	tPtr = Blt_GetHashValue(hPtr);
-	return &tPtr->nodeTable;
-    }
-    return NULL;
-}
+    Blt_HashSearch cursor;
+    Node **nodeArr, **pagePtr, *nodePtr;
+    unsigned int page, word, bits;
+    int i, j, nNodes, nAlloc;
 
-Blt_TreeTagEntry *
-Blt_TreeTagHashEntry(TreeClient *clientPtr, CONST char *tagName)
-{
-    Blt_HashEntry *hPtr;
-   
-    hPtr = Blt_FindHashEntry(&clientPtr->tagTablePtr->tagTable, tagName);
-    if (hPtr != NULL) {
-	Blt_TreeTagEntry *tPtr;
-	
-	tPtr = Blt_GetHashValue(hPtr);
-	return tPtr;
+    for (i = 0; i < queryPtr->nOps; i++) {
+	if (queryPtr->ops[i].tPtr != NULL) {
+	    CheckTagBits(queryPtr->ops[i].tPtr);
+	}
     }
-    return NULL;
+    nodeArr = NULL;
+    nNodes = nAlloc = 0;
+    for (page = 0; page < treeObjPtr->nPages; page++) {
+	pagePtr = treeObjPtr->nodePages[page];
+	if (pagePtr == NULL) {
+	    continue;
+	}
+	for (i = 0; i < TAG_WORDS_PER_PAGE; i++) {
+	    word = page * TAG_WORDS_PER_PAGE + i;
+	    bits = EvalTagQueryWord(queryPtr, pagePtr, word);
+	    for (j = 0; bits != 0; j++, bits >>= 1) {
+		if ((bits & 1) == 0) {
+		    continue;
+		}
+		nodePtr = pagePtr[(i << 5) + j];
+		if (nodePtr == NULL) {
+		    continue;
+		}
+		if (nNodes >= nAlloc) {
+		    nAlloc = (nAlloc == 0) ? 64 : nAlloc * 2;
+		    nodeArr = Blt_Realloc(nodeArr, nAlloc * sizeof(Node *));
+		    assert(nodeArr);
+		}
+		nodeArr[nNodes++] = nodePtr;
+	    }
+	}
+    }
+    /* Nodes with sparse inodes beyond the pages are tested singly. */
+    for (hPtr = Blt_FirstHashEntry(&treeObjPtr->nodeTable, &cursor); 
+	 hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	nodePtr = Blt_GetHashValue(hPtr);
+	if (Blt_TreeTagQueryMatch(queryPtr, nodePtr)) {
+	    if (nNodes >= nAlloc) {
+		nAlloc = (nAlloc == 0) ? 64 : nAlloc * 2;
+		nodeArr = Blt_Realloc(nodeArr, nAlloc * sizeof(Node *));
+		assert(nodeArr);
+	    }
+	    nodeArr[nNodes++] = nodePtr;
+	}
+    }
+    *nodesPtr = nodeArr;
+    return nNodes;
 }
 
 Blt_HashEntry *
@@ -3676,6 +6550,20 @@ TreeDestroyValues(Node *nodePtr)
     register Value *valuePtr;
     Value *nextPtr;
 
+    if (nodePtr->slots != NULL) {
+	TreeObject *treeObjPtr = nodePtr->treeObject;
+	unsigned int i;
+
+	for (i = 0; i < nodePtr->nSlots; i++) {
+	    if (nodePtr->slots[i] != NULL) {
+		UnindexValue(nodePtr, treeObjPtr->schemaKeys[i]);
+		Tcl_DecrRefCount(nodePtr->slots[i]);
+	    }
+	}
+	Blt_Free(nodePtr->slots);
+	nodePtr->slots = NULL;
+	nodePtr->nSlots = nodePtr->nSlotValues = 0;
+    }
     /*
      * Free up all the entries in the table.
      */
@@ -3951,6 +6839,331 @@ TreeCreateValue(
     return valuePtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * SchemaSlot --
+ *
+ *	Returns the slot of the key in the schema of the tree, or -1
+ *	if the key isn't part of the schema.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+SchemaSlot(TreeObject *treeObjPtr, Blt_TreeKey key)
+{
+    Blt_HashEntry *hPtr;
+
+    if (treeObjPtr->nSchemaKeys == 0) {
+	return -1;
+    }
+    hPtr = Blt_FindHashEntry(&treeObjPtr->schemaTable, key);
+    if (hPtr == NULL) {
+	return -1;
+    }
+    return (int)(long)Blt_GetHashValue(hPtr);
+}
+
+/*
+ * Enlarges the slots of the node to hold every key of the schema.
+ */
+static void
+GrowSlots(Node *nodePtr)
+{
+    TreeObject *treeObjPtr = nodePtr->treeObject;
+    size_t size;
+    unsigned int i;
+
+    size = treeObjPtr->nSchemaKeys * sizeof(Tcl_Obj *);
+    if (nodePtr->slots == NULL) {
+	nodePtr->slots = Blt_Malloc(size);
+    } else {
+	nodePtr->slots = Blt_Realloc(nodePtr->slots, size);
+    }
+    assert(nodePtr->slots);
+    for (i = nodePtr->nSlots; i < treeObjPtr->nSchemaKeys; i++) {
+	nodePtr->slots[i] = NULL;
+    }
+    nodePtr->nSlots = treeObjPtr->nSchemaKeys;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TreeFindValueObj --
+ *
+ *	Finds where the value of the key is kept in the node: in its
+ *	slot if the key belongs to the schema of the tree, otherwise
+ *	in the value record of the key.
+ *
+ * Results:
+ *	Returns a pointer to the Tcl_Obj of the value, or NULL if the
+ *	node has no value for the key.  The value record is returned
+ *	in valuePtrPtr, or NULL for slots.  Slot values are always 
+ *	public.
+ *
+ *----------------------------------------------------------------------
+ */
+static Tcl_Obj **
+TreeFindValueObj(
+    Node *nodePtr,
+    Blt_TreeKey key,
+    Value **valuePtrPtr)
+{
+    Value *valuePtr;
+
+    *valuePtrPtr = NULL;
+    if (nodePtr->nSlotValues > 0) {
+	int slot;
+
+	slot = SchemaSlot(nodePtr->treeObject, key);
+	if ((slot >= 0) && (slot < nodePtr->nSlots) && 
+	    (nodePtr->slots[slot] != NULL)) {
+	    return nodePtr->slots + slot;
+	}
+    }
+    if (nodePtr->nValues == 0) {
+	return NULL;
+    }
+    valuePtr = TreeFindValue(nodePtr, key);
+    if (valuePtr == NULL) {
+	return NULL;
+    }
+    *valuePtrPtr = valuePtr;
+    return &valuePtr->objPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TreeCreateValueObj --
+ *
+ *	Like TreeFindValueObj, but adds the value to the node if it
+ *	doesn't have one.  Keys of the schema are given their slot,
+ *	unless the node already keeps a record for the key (e.g. 
+ *	because it's private).
+ *
+ * Results:
+ *	Returns a pointer to the Tcl_Obj of the value, which is NULL
+ *	for new values.  *newPtr is set if the value was created.
+ *
+ *----------------------------------------------------------------------
+ */
+static Tcl_Obj **
+TreeCreateValueObj(
+    Node *nodePtr,
+    Blt_TreeKey key,
+    Value **valuePtrPtr,
+    int *newPtr)
+{
+    Value *valuePtr;
+    int slot;
+
+    *valuePtrPtr = NULL;
+    slot = SchemaSlot(nodePtr->treeObject, key);
+    if (slot >= 0) {
+	if ((slot < nodePtr->nSlots) && (nodePtr->slots[slot] != NULL)) {
+	    *newPtr = FALSE;
+	    return nodePtr->slots + slot;
+	}
+	if ((nodePtr->nValues == 0) || (TreeFindValue(nodePtr, key) == NULL)) {
+	    if (slot >= nodePtr->nSlots) {
+		GrowSlots(nodePtr);
+	    }
+	    nodePtr->nSlotValues++;
+	    *newPtr = TRUE;
+	    return nodePtr->slots + slot;
+	}
+    }
+    valuePtr = TreeCreateValue(nodePtr, key, newPtr);
+    *valuePtrPtr = valuePtr;
+    return &valuePtr->objPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TreeDeleteValueObj --
+ *
+ *	Removes the value found by TreeFindValueObj from the node.
+ *	The slots of the node are freed with its last slot value.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+TreeDeleteValueObj(
+    Node *nodePtr,
+    Blt_TreeKey key,
+    Tcl_Obj **objPtrPtr,
+    Value *valuePtr)		/* Value record, or NULL for slots. */
+{
+    if (valuePtr != NULL) {
+	TreeDeleteValue(nodePtr, valuePtr);
+	return;
+    }
+    UnindexValue(nodePtr, key);
+    if (*objPtrPtr != NULL) {
+	Tcl_DecrRefCount(*objPtrPtr);
+	*objPtrPtr = NULL;
+    }
+    nodePtr->nSlotValues--;
+    if (nodePtr->nSlotValues == 0) {
+	Blt_Free(nodePtr->slots);
+	nodePtr->slots = NULL;
+	nodePtr->nSlots = 0;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeSetSchema --
+ *
+ *	Adds keys to the schema of the tree.  Each key of the schema
+ *	is given a slot shared by all the nodes of the tree, and nodes
+ *	keep the public values of these keys in an array indexed by
+ *	slot rather than in a record per value.  Keys already in the
+ *	schema are ignored: slots never change once given.  Values of
+ *	the new keys that nodes already hold are moved into slots.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeSetSchema(
+    Tcl_Interp *interp,
+    TreeClient *clientPtr,
+    int nKeys,
+    Blt_TreeKey *keys)
+{
+    TreeObject *treeObjPtr = clientPtr->treeObject;
+    Blt_HashEntry *hPtr;
+    Node *nodePtr;
+    Value *valuePtr;
+    unsigned int first, slot;
+    int i, isNew;
+
+    if (CheckWritable(interp, treeObjPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    first = treeObjPtr->nSchemaKeys;
+    if ((first + nKeys) > USHRT_MAX) {
+	if (interp != NULL) {
+	    Tcl_AppendResult(interp, "too many keys in schema", (char *)NULL);
+	}
+	return TCL_ERROR;
+    }
+    if (nKeys == 0) {
+	return TCL_OK;
+    }
+    if (treeObjPtr->schemaKeys == NULL) {
+	treeObjPtr->schemaKeys = Blt_Malloc(nKeys * sizeof(Blt_TreeKey));
+    } else {
+	treeObjPtr->schemaKeys = Blt_Realloc(treeObjPtr->schemaKeys, 
+		(first + nKeys) * sizeof(Blt_TreeKey));
+    }
+    assert(treeObjPtr->schemaKeys);
+    slot = first;
+    for (i = 0; i < nKeys; i++) {
+	hPtr = Blt_CreateHashEntry(&treeObjPtr->schemaTable, keys[i], &isNew);
+	if (isNew) {
+	    Blt_SetHashValue(hPtr, (ClientData)(long)slot);
+	    treeObjPtr->schemaKeys[slot] = keys[i];
+	    slot++;
+	}
+    }
+    treeObjPtr->nSchemaKeys = slot;
+
+    /* Move the public values of the new keys into their slots. */
+    for (nodePtr = treeObjPtr->root; nodePtr != NULL; 
+	 nodePtr = Blt_TreeNextNode(treeObjPtr->root, nodePtr)) {
+	for (slot = first; (nodePtr->nValues > 0) && 
+		 (slot < treeObjPtr->nSchemaKeys); slot++) {
+	    Blt_TreeKey key;
+	    Tcl_Obj *objPtr;
+
+	    key = treeObjPtr->schemaKeys[slot];
+	    valuePtr = TreeFindValue(nodePtr, key);
+	    if ((valuePtr == NULL) || (valuePtr->owner != NULL) || 
+		(valuePtr->objPtr == NULL)) {
+		continue;
+	    }
+	    if (nodePtr->nSlots < treeObjPtr->nSchemaKeys) {
+		GrowSlots(nodePtr);
+	    }
+	    objPtr = valuePtr->objPtr;
+	    valuePtr->objPtr = NULL;
+	    TreeDeleteValue(nodePtr, valuePtr);
+	    nodePtr->slots[slot] = objPtr;
+	    nodePtr->nSlotValues++;
+	    IndexValue(nodePtr, key, objPtr);
+	}
+    }
+    return TCL_OK;
+}
+
+/*
+ * Returns the keys of the schema of the tree, in the order of their
+ * slots, and their number.
+ */
+int
+Blt_TreeGetSchema(TreeClient *clientPtr, Blt_TreeKey **keysPtr)
+{
+    *keysPtr = clientPtr->treeObject->schemaKeys;
+    return clientPtr->treeObject->nSchemaKeys;
+}
+
+/*
+ * Returns the slot of the key in the schema of the tree, or -1 if
+ * the key isn't part of the schema.
+ */
+int
+Blt_TreeSchemaSlot(TreeClient *clientPtr, Blt_TreeKey key)
+{
+    return SchemaSlot(clientPtr->treeObject, key);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeGetSlotValue --
+ *
+ *	Gets the value of the node for the key in the given slot of
+ *	the schema.  The value is read directly from the slot unless
+ *	traces have to be called or the value isn't kept there.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeGetSlotValue(
+    Tcl_Interp *interp,
+    TreeClient *clientPtr,
+    Node *nodePtr,
+    int slot,
+    Tcl_Obj **objPtrPtr)
+{
+    TreeObject *treeObjPtr = nodePtr->treeObject;
+
+    if ((slot < 0) || ((unsigned int)slot >= treeObjPtr->nSchemaKeys)) {
+	if (interp != NULL) {
+	    Tcl_AppendResult(interp, "bad schema slot", (char *)NULL);
+	}
+	return TCL_ERROR;
+    }
+    if ((slot < nodePtr->nSlots) && (nodePtr->slots[slot] != NULL) &&
+	((treeObjPtr->traceIndex == NULL) || 
+	 (treeObjPtr->traceIndex->nTraces == 0))) {
+	*objPtrPtr = nodePtr->slots[slot];
+	return TCL_OK;
+    }
+    return Blt_TreeGetValueByKey(interp, clientPtr, nodePtr, 
+	treeObjPtr->schemaKeys[slot], objPtrPtr);
+}
 
 Blt_TreeNode Blt_TreeEndNode (Blt_TreeNode node,
     unsigned int nodeFlags) {
@@ -39,6 +39,7 @@ typedef struct Blt_TreeTraceStruct *Blt_TreeTrace;
 typedef struct Blt_TreeValueStruct *Blt_TreeValue;
 typedef struct Blt_TreeTagEntryStruct Blt_TreeTagEntry;
 typedef struct Blt_TreeTagTableStruct Blt_TreeTagTable;
+typedef struct Blt_TreeTagQueryStruct Blt_TreeTagQuery;
 
 typedef char *Blt_TreeKey;
 
@@ -49,6 +50,7 @@ typedef char *Blt_TreeKey;
 #define TREE_BREADTHFIRST	(1<<3)
 
 /* Flags set in node->flags (a short)  */
+#define TREE_NODE_POSITIONS	(1<<2)
 #define TREE_TRACE_UNSET	(1<<3)
 #define TREE_TRACE_WRITE	(1<<4)
 #define TREE_TRACE_READ		(1<<5)
@@ -60,6 +62,7 @@ typedef char *Blt_TreeKey;
 #define TREE_TRACE_ALL		\
     (TREE_TRACE_UNSET | TREE_TRACE_WRITE | TREE_TRACE_READ | TREE_TRACE_CREATE |TREE_TRACE_TAGMULTIPLE|TREE_TRACE_TAGADD|TREE_TRACE_TAGDELETE|TREE_TRACE_EXISTS)
 #define TREE_TRACE_MASK		(TREE_TRACE_ALL)
+#define TREE_NODE_CHILD_INDEX	(1<<0x0B)
 #define TREE_TRACE_ACTIVE	(1<<0x0C)
 #define TREE_NODE_UNMODIFIED	(1<<0x0D)
 #define TREE_NODE_INSERT_FAIL	(1<<0x0E)
@@ -82,6 +85,9 @@ typedef char *Blt_TreeKey;
 #define TREE_NOTIFY_RELABELPOST	(1<<6)
 #define TREE_NOTIFY_INSERT	(1<<7)
 #define TREE_NOTIFY_GET	(1<<8)
+#define TREE_NOTIFY_BATCH	(1<<9)	/* Children of the node changed
+					 * during a batch.  Only sent to
+					 * handlers asking for it. */
 #define TREE_NOTIFY_ALL		\
     (TREE_NOTIFY_CREATE | TREE_NOTIFY_DELETE | TREE_NOTIFY_MOVE | \
 	TREE_NOTIFY_MOVEPOST | TREE_NOTIFY_SORT | TREE_NOTIFY_RELABEL | \
@@ -93,6 +99,13 @@ typedef char *Blt_TreeKey;
 #define TREE_NOTIFY_BGERROR	 (1<<0x13)
 #define TREE_NOTIFY_TRACEACTIVE	 (1<<0x14)
 
+/* Types and flags of key indexes. */
+#define TREE_INDEX_STRING	0
+#define TREE_INDEX_INTEGER	1
+#define TREE_INDEX_REAL		2
+#define TREE_INDEX_ORDERED	(1<<4)	/* Keep the values sorted for
+					 * range lookups. */
+
 typedef struct {
     int type;
     Blt_Tree tree;
@@ -107,6 +120,8 @@ typedef struct {
     Blt_TreeValue nextValue;	/* Next entry to be enumerated in the
 				 * the current bucket. */
     int cnt;
+    unsigned int nextSlot;	/* Next slot to be enumerated, once
+				 * the other values are done. */
 } Blt_TreeKeySearch;
 
 /*
@@ -155,8 +170,12 @@ struct Blt_TreeObjectStruct {
     Blt_Pool nodePool;
     Blt_Pool valuePool;
 
-    Blt_HashTable nodeTable;	/* Table of node identifiers. Used to
-				 * search for a node pointer given an inode.*/
+    Blt_TreeNode **nodePages;	/* Pages of nodes indexed by inode. Used
+				 * to find a node pointer given an inode.*/
+    unsigned short *pageCounts;	/* # of nodes in each page. */
+    unsigned int nPages;	/* # of page slots allocated. */
+    Blt_HashTable nodeTable;	/* Table of nodes whose inodes lie
+				 * beyond the pages. */
     unsigned int nextInode;
 
     unsigned int nNodes;	/* Always counts root node. */
@@ -171,6 +190,23 @@ struct Blt_TreeObjectStruct {
     Blt_HashTable *interpKeyPtr; /* The local or interp-wide key table. */
     int delete;
     int maxKeyList;            /* Max key list length before hash (default 20). */
+    struct Blt_TreeTraceIndexStruct *traceIndex; /* Traces of all
+				 * clients, indexed by key, node and
+				 * tag.  NULL if no traces were ever
+				 * created. */
+    Blt_HashTable childTable;	/* Per-node tables hashing the labels
+				 * of its children.  Only nodes with
+				 * many children (flagged with
+				 * TREE_NODE_CHILD_INDEX) have one. */
+    struct Blt_TreeBatchStruct *batchPtr; /* Changes held back by the
+				 * batch in progress.  NULL if no
+				 * batch is active. */
+    Blt_HashTable keyIndexTable; /* Secondary indexes of the values
+				 * of keys, hashed by key. */
+    Blt_HashTable schemaTable;	/* Slot indices of the keys of the
+				 * schema, hashed by key. */
+    Blt_TreeKey *schemaKeys;	/* Keys of the schema, by slot. */
+    unsigned int nSchemaKeys;	/* # of keys in the schema. */
 };
 
 /*
@@ -216,10 +252,23 @@ struct Blt_TreeNodeStruct {
 
     unsigned int nChildren;	/* # of children for this node. */
     unsigned int inode;		/* Serial number of the node. */
+    unsigned int position;	/* Position among its siblings.  Only
+				 * valid if the parent node is flagged
+				 * with TREE_NODE_POSITIONS. */
 
     unsigned short depth;	/* The depth of this node in the tree. */
 
     unsigned short flags;
+
+    unsigned short nSlots;	/* # of slots allocated. */
+    unsigned short nSlotValues;	/* # of slots holding a value. */
+
+    Tcl_Obj **slots;		/* Values of the keys of the schema of
+				 * the tree, indexed by slot.  Values
+				 * of other keys, and private values,
+				 * are kept in the values above. NULL
+				 * if the node never had a value of
+				 * the schema. */
 };
 
 struct Blt_TreeTagEntryStruct {
@@ -227,6 +276,12 @@ struct Blt_TreeTagEntryStruct {
     Blt_HashEntry *hashPtr;
     Blt_HashTable nodeTable;
     int refCount; /* Used to delay deletion while iterating. */
+    unsigned int *bits;		/* Bitset of the tagged nodes, indexed
+				 * by inode. */
+    unsigned int nWords;	/* # of words in the bitset. */
+    unsigned int nBits;		/* # of bits set. */
+    unsigned int nOutside;	/* # of tagged nodes whose inodes are
+				 * beyond the bitset. */
 };
 
 #define Blt_TreeTagRefDecr(tPtr) if (--(tPtr)->refCount > 0) ; else Blt_Free(tPtr)
@@ -303,6 +358,8 @@ struct Blt_TreeKeySearchStruct {
     Blt_TreeValue nextValue;	/* Next entry to be enumerated in the
 				 * the current bucket. */
     int cnt;
+    unsigned int nextSlot;	/* Next slot to be enumerated, once
+				 * the other values are done. */
 };
 
 #ifndef USE_BLT_STUBS
@@ -426,6 +483,8 @@ EXTERN Blt_TreeKey Blt_TreeNextKey _ANSI_ARGS_((Blt_Tree tree,
 	Blt_TreeKeySearch *cursorPtr));
 
 EXTERN int Blt_TreeCountKeys _ANSI_ARGS_((Blt_Tree tree, Blt_TreeNode node));
+EXTERN int Blt_TreeHasKey _ANSI_ARGS_((Blt_Tree tree, Blt_TreeNode node,
+	Blt_TreeKey key));
 
 EXTERN int Blt_TreeApply _ANSI_ARGS_((Blt_TreeNode root, 
 	Blt_TreeApplyProc *proc, ClientData clientData));
@@ -439,9 +498,17 @@ EXTERN int Blt_TreeApplyBFS _ANSI_ARGS_((Blt_TreeNode root,
 EXTERN int Blt_TreeSortNode _ANSI_ARGS_((Blt_Tree tree, Blt_TreeNode node, 
 	Blt_TreeCompareNodesProc *proc));
 
+EXTERN int Blt_TreeReorderNode _ANSI_ARGS_((Blt_Tree tree, Blt_TreeNode node,
+	Blt_TreeNode *nodeArr));
+
 EXTERN int Blt_TreeCreate _ANSI_ARGS_((Tcl_Interp *interp, CONST char *name,
 	Blt_Tree *treePtr));
 
+EXTERN int Blt_TreeSnapshot _ANSI_ARGS_((Tcl_Interp *interp, Blt_Tree tree,
+	CONST char *name, Blt_Tree *treePtr));
+
+EXTERN int Blt_TreeIsSnapshot _ANSI_ARGS_((Blt_Tree tree));
+
 EXTERN int Blt_TreeExists _ANSI_ARGS_((Tcl_Interp *interp, CONST char *name));
 
 EXTERN int Blt_TreeGetToken _ANSI_ARGS_((Tcl_Interp *interp, CONST char *name, 
@@ -476,6 +543,31 @@ EXTERN char *Blt_TreeNodePath _ANSI_ARGS_((Blt_TreeNode node,
 EXTERN char *Blt_TreeNodePathStr _ANSI_ARGS_((Blt_TreeNode node, 
 	Tcl_DString *resultPtr, char *prefix, char *delim));	
 EXTERN int Blt_TreeNodePosition _ANSI_ARGS_((Blt_TreeNode node));
+EXTERN Blt_TreeNode Blt_TreeNthChild _ANSI_ARGS_((Blt_TreeNode parent, 
+	int position));
+EXTERN int Blt_TreeBeginBatch _ANSI_ARGS_((Tcl_Interp *interp, 
+	Blt_Tree tree));
+EXTERN int Blt_TreeEndBatch _ANSI_ARGS_((Tcl_Interp *interp, Blt_Tree tree));
+EXTERN int Blt_TreeCreateKeyIndex _ANSI_ARGS_((Tcl_Interp *interp, 
+	Blt_Tree tree, Blt_TreeKey key, int type, int flags));
+EXTERN int Blt_TreeDeleteKeyIndex _ANSI_ARGS_((Blt_Tree tree, 
+	Blt_TreeKey key));
+EXTERN int Blt_TreeKeyIndexInfo _ANSI_ARGS_((Blt_Tree tree, Blt_TreeKey key,
+	int *typePtr, int *flagsPtr));
+EXTERN void Blt_TreeKeyIndexNames _ANSI_ARGS_((Blt_Tree tree, 
+	CONST char *pattern, Tcl_Obj *listObjPtr));
+EXTERN int Blt_TreeKeyIndexFind _ANSI_ARGS_((Blt_Tree tree, Blt_TreeKey key,
+	CONST char *value, Blt_TreeNode **nodesPtr));
+EXTERN int Blt_TreeSetSchema _ANSI_ARGS_((Tcl_Interp *interp, 
+	Blt_Tree tree, int nKeys, Blt_TreeKey *keys));
+EXTERN int Blt_TreeGetSchema _ANSI_ARGS_((Blt_Tree tree, 
+	Blt_TreeKey **keysPtr));
+EXTERN int Blt_TreeSchemaSlot _ANSI_ARGS_((Blt_Tree tree, Blt_TreeKey key));
+EXTERN int Blt_TreeGetSlotValue _ANSI_ARGS_((Tcl_Interp *interp, 
+	Blt_Tree tree, Blt_TreeNode node, int slot, Tcl_Obj **objPtrPtr));
+EXTERN int Blt_TreeKeyIndexRange _ANSI_ARGS_((Tcl_Interp *interp, 
+	Blt_Tree tree, Blt_TreeKey key, CONST char *low, CONST char *high,
+	Blt_TreeNode **nodesPtr));
 
 EXTERN void Blt_TreeClearTags _ANSI_ARGS_((Blt_Tree tree, Blt_TreeNode node));
 EXTERN int Blt_TreeHasTag _ANSI_ARGS_((Blt_Tree tree, Blt_TreeNode node, 
@@ -489,6 +581,17 @@ EXTERN Blt_HashTable *Blt_TreeTagHashTable _ANSI_ARGS_((Blt_Tree tree,
 	CONST char *tagName));
 EXTERN Blt_TreeTagEntry *Blt_TreeTagHashEntry _ANSI_ARGS_((Blt_Tree tree, 
 	CONST char *tagName));
+EXTERN int Blt_TreeRemoveTag _ANSI_ARGS_((Blt_Tree tree, Blt_TreeNode node, 
+	CONST char *tagName));
+EXTERN int Blt_TreeTagEntryHasNode _ANSI_ARGS_((Blt_TreeTagEntry *tPtr, 
+	Blt_TreeNode node));
+EXTERN Blt_TreeTagQuery *Blt_TreeCreateTagQuery _ANSI_ARGS_((
+	Tcl_Interp *interp, Blt_Tree tree, CONST char *expr));
+EXTERN int Blt_TreeTagQueryMatch _ANSI_ARGS_((Blt_TreeTagQuery *queryPtr, 
+	Blt_TreeNode node));
+EXTERN int Blt_TreeTagQueryNodes _ANSI_ARGS_((Blt_TreeTagQuery *queryPtr, 
+	Blt_TreeNode **nodesPtr));
+EXTERN void Blt_TreeFreeTagQuery _ANSI_ARGS_((Blt_TreeTagQuery *queryPtr));
 EXTERN int Blt_TreeTagTableIsShared _ANSI_ARGS_((Blt_Tree tree));
 EXTERN int Blt_TreeShareTagTable _ANSI_ARGS_((Blt_Tree src, Blt_Tree target));
 EXTERN Blt_HashEntry *Blt_TreeFirstTag _ANSI_ARGS_((Blt_Tree tree, 
@@ -297,6 +297,17 @@ static Blt_SwitchSpec insertSwitches[] =
 #define MATCH_STRICT		(1<<16)
 #define MATCH_ISNULL		(1<<17)
 
+/* 
+ * Tag of -withtag or -withouttag, looked up once.  The special tags
+ * match the same nodes as in Blt_TreeHasTag.
+ */
+typedef struct {
+    int compiled;		/* If zero, use Blt_TreeHasTag. */
+    int always;			/* all, nonroot or rootchildren. */
+    int root;			/* root */
+    Blt_TreeTagEntry *tPtr;	/* The tag, or NULL. */
+} FindTag;
+
 typedef struct {
     TreeCmd *cmdPtr;		/* Tree to examine. */
     Tcl_Obj *listObjPtr;	/* List to accumulate the indices of 
@@ -331,6 +342,7 @@ typedef struct {
     Blt_List keyList;		/* List of key name patterns. */
     Tcl_Obj *withTag;
     Tcl_Obj *withoutTag;
+    Tcl_Obj *tagExpr;
     char *retKey;
     Blt_TreeNode startNode;
     Tcl_Obj *name;
@@ -338,6 +350,15 @@ typedef struct {
     Tcl_RegExp *regPtr;
     Tcl_Obj *execVar, *execObj, *nodesObj;
     int keyCount, iskey;
+
+    /* Compiled from the switches by CompileFind. */
+    Blt_TreeKey columnKey;	/* Interned -column key, or NULL. */
+    Blt_TreeKey findKey;	/* Interned -key name, if the last
+				 * -key is exact.  Otherwise NULL. */
+    Tcl_RegExp regexp;		/* Compiled -regexp pattern, or NULL. */
+    Blt_HashTable *inlistTablePtr; /* Values of -inlist, or NULL. */
+    FindTag withTagInfo, withoutTagInfo;
+    Blt_TreeTagQuery *tagQuery;	/* Compiled -tagexpr, or NULL. */
 } FindData;
 
 static Blt_SwitchParseProc StringToOrder;
@@ -432,6 +453,7 @@ static Blt_SwitchSpec findSwitches[] =
     {BLT_SWITCH_STRING, "-return", Blt_Offset(FindData, retKey), 0},
     {BLT_SWITCH_FLAG, "-strict", Blt_Offset(FindData, flags), 0, 0, 
         MATCH_STRICT},
+    {BLT_SWITCH_OBJ, "-tagexpr", Blt_Offset(FindData, tagExpr), 0},
     {BLT_SWITCH_CUSTOM, "-top", Blt_Offset(FindData, startNode), 0, &fNodeSwitch},
     {BLT_SWITCH_FLAG, "-usepath", Blt_Offset(FindData, flags), 0, 0, 
 	MATCH_PATHNAME},
@@ -561,9 +583,12 @@ typedef struct {
 #define RESTORE_NO_TAGS		(1<<0)
 #define RESTORE_OVERWRITE	(1<<1)
 #define RESTORE_NO_PATH		(1<<2)
+#define RESTORE_BINARY		(1<<3)
 
 static Blt_SwitchSpec restoreSwitches[] = 
 {
+    {BLT_SWITCH_FLAG, "-binary", Blt_Offset(RestoreData, flags), 0, 0, 
+	RESTORE_BINARY},
     {BLT_SWITCH_FLAG, "-notags", Blt_Offset(RestoreData, flags), 0, 0, 
 	RESTORE_NO_TAGS},
     {BLT_SWITCH_FLAG, "-overwrite", Blt_Offset(RestoreData, flags), 0, 0, 
@@ -581,6 +606,8 @@ static Blt_SwitchSpec restoreSwitches[] =
 
 static Blt_SwitchSpec dumpSwitches[] = 
 {
+    {BLT_SWITCH_FLAG, "-binary", Blt_Offset(RestoreData, flags), 0, 0, 
+	RESTORE_BINARY},
     {BLT_SWITCH_FLAG, "-notags", Blt_Offset(RestoreData, flags), 0, 0, 
 	RESTORE_NO_TAGS},
     {BLT_SWITCH_FLAG, "-nopath", Blt_Offset(RestoreData, flags), 0, 0, 
@@ -630,13 +657,85 @@ static Blt_SwitchSpec positionSwitches[] =
     {BLT_SWITCH_END, NULL, 0, 0}
 };
 
+static Blt_SwitchParseProc StringToIndexType;
+static Blt_SwitchCustom indexTypeSwitch =
+{
+    StringToIndexType, (Blt_SwitchFreeProc *)NULL, (ClientData)0,
+};
+
+typedef struct {
+    int type;			/* TREE_INDEX_STRING, _INTEGER or _REAL. */
+    int flags;			/* TREE_INDEX_ORDERED */
+} IndexData;
+
+static Blt_SwitchSpec indexSwitches[] = 
+{
+    {BLT_SWITCH_FLAG, "-ordered", Blt_Offset(IndexData, flags), 0, 0,
+	TREE_INDEX_ORDERED},
+    {BLT_SWITCH_CUSTOM, "-type", Blt_Offset(IndexData, type), 0, 
+	&indexTypeSwitch},
+    {BLT_SWITCH_END, NULL, 0, 0}
+};
+
+static Blt_SwitchParseProc StringToLoadFormat;
+static Blt_SwitchCustom loadFormatSwitch =
+{
+    StringToLoadFormat, (Blt_SwitchFreeProc *)NULL, (ClientData)0,
+};
+
+enum LoadFormats { LOAD_CSV, LOAD_TSV };
+
+typedef struct {
+    int format;			/* LOAD_CSV or LOAD_TSV. */
+    unsigned int flags;
+    int max;			/* If > 0, the most rows to load. */
+    int insertPos;		/* Position of the first row under the
+				 * parent, or -1 to append. */
+    char *file, *chan;
+    Tcl_Obj *data;
+    Tcl_Obj *parent;
+    char *key;			/* If non-NULL, key holding all the
+				 * values of a row. */
+    char *labelCol, *tagCol, *pathCol;
+    char *nullStr;		/* If non-NULL, value of empty fields. */
+    Tcl_Obj *keys;		/* Names of the columns.  By default, 
+				 * they're read from the first row. */
+    Tcl_Obj *skipCols, *treeCols, *addTags;
+} LoadData;
+
+#define LOAD_FIXED		(1<<0)
+
+static Blt_SwitchSpec loadSwitches[] = 
+{
+    {BLT_SWITCH_OBJ, "-addtags", Blt_Offset(LoadData, addTags), 0},
+    {BLT_SWITCH_STRING, "-channel", Blt_Offset(LoadData, chan), 0},
+    {BLT_SWITCH_OBJ, "-data", Blt_Offset(LoadData, data), 0},
+    {BLT_SWITCH_STRING, "-file", Blt_Offset(LoadData, file), 0},
+    {BLT_SWITCH_FLAG, "-fixed", Blt_Offset(LoadData, flags), 0, 0, 
+	LOAD_FIXED},
+    {BLT_SWITCH_CUSTOM, "-format", Blt_Offset(LoadData, format), 0, 
+	&loadFormatSwitch},
+    {BLT_SWITCH_STRING, "-key", Blt_Offset(LoadData, key), 0},
+    {BLT_SWITCH_OBJ, "-keys", Blt_Offset(LoadData, keys), 0},
+    {BLT_SWITCH_STRING, "-labelcol", Blt_Offset(LoadData, labelCol), 0},
+    {BLT_SWITCH_INT_NONNEGATIVE, "-max", Blt_Offset(LoadData, max), 0},
+    {BLT_SWITCH_STRING, "-nullvalue", Blt_Offset(LoadData, nullStr), 0},
+    {BLT_SWITCH_OBJ, "-parent", Blt_Offset(LoadData, parent), 0},
+    {BLT_SWITCH_STRING, "-pathcol", Blt_Offset(LoadData, pathCol), 0},
+    {BLT_SWITCH_INT, "-pos", Blt_Offset(LoadData, insertPos), 0},
+    {BLT_SWITCH_OBJ, "-skipcols", Blt_Offset(LoadData, skipCols), 0},
+    {BLT_SWITCH_STRING, "-tagcol", Blt_Offset(LoadData, tagCol), 0},
+    {BLT_SWITCH_OBJ, "-treecols", Blt_Offset(LoadData, treeCols), 0},
+    {BLT_SWITCH_END, NULL, 0, 0}
+};
+
+extern int bltTreeUseLocalKeys;
 
 static Tcl_InterpDeleteProc TreeInterpDeleteProc;
 static Blt_TreeApplyProc MatchNodeProc, SortApplyProc;
 static Blt_TreeApplyProc ApplyNodeProc;
 static Blt_TreeTraceProc TreeTraceProc;
 static Tcl_CmdDeleteProc TreeInstDeleteProc;
-static Blt_TreeCompareNodesProc CompareNodes;
 
 static Tcl_ObjCmdProc TreeObjCmd;
 static Tcl_ObjCmdProc CompareDictionaryCmd;
@@ -647,6 +746,10 @@ static Blt_TreeNotifyEventProc TreeEventProc;
 
 static int GetNode _ANSI_ARGS_((TreeCmd *cmdPtr, Tcl_Obj *objPtr, 
 	Blt_TreeNode *nodePtr));
+static CONST char *GetTreeCmdName _ANSI_ARGS_((Tcl_Interp *interp, 
+	CONST char *treeName, Tcl_DString *resultPtr));
+static TreeCmd *NewTreeCmd _ANSI_ARGS_((TreeCmdInterpData *dataPtr, 
+	Tcl_Interp *interp, CONST char *treeName, Blt_Tree token));
 
 static int nLines;
 
@@ -860,6 +963,82 @@ FreePatterns(char *object)
 }
 
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * StringToIndexType --
+ *
+ *	Convert a string representing the type of the values of a key
+ *	index.
+ *
+ * Results:
+ *	The return value is a standard Tcl result.
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static int
+StringToIndexType(
+    ClientData clientData,	/* Not used. */
+    Tcl_Interp *interp,		/* Interpreter to send results back to */
+    char *switchName,		/* Not used. */
+    char *string,		/* String representation */
+    char *record,		/* Structure record */
+    int offset)			/* Offset to field in structure */
+{
+    int *typePtr = (int *)(record + offset);
+
+    if (strcmp(string, "string") == 0) {
+	*typePtr = TREE_INDEX_STRING;
+    } else if (strcmp(string, "integer") == 0) {
+	*typePtr = TREE_INDEX_INTEGER;
+    } else if (strcmp(string, "real") == 0) {
+	*typePtr = TREE_INDEX_REAL;
+    } else {
+	Tcl_AppendResult(interp, "bad index type \"", string, 
+		"\": should be string, integer, or real", (char *)NULL);
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StringToLoadFormat --
+ *
+ *	Convert a string representing the format of the data read by
+ *	the "load" operation.
+ *
+ * Results:
+ *	The return value is a standard Tcl result.
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static int
+StringToLoadFormat(
+    ClientData clientData,	/* Not used. */
+    Tcl_Interp *interp,		/* Interpreter to send results back to */
+    char *switchName,		/* Not used. */
+    char *string,		/* String representation */
+    char *record,		/* Structure record */
+    int offset)			/* Offset to field in structure */
+{
+    int *formatPtr = (int *)(record + offset);
+
+    if (strcmp(string, "csv") == 0) {
+	*formatPtr = LOAD_CSV;
+    } else if (strcmp(string, "tsv") == 0) {
+	*formatPtr = LOAD_TSV;
+    } else {
+	Tcl_AppendResult(interp, "bad format \"", string, 
+		"\": should be csv or tsv", (char *)NULL);
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1152,6 +1331,28 @@ GetForeignNode(
     return TCL_ERROR;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * CheckWritable --
+ *
+ *	Reports an error if the tree is a read-only snapshot.  Used by
+ *	operations that add, remove or rearrange nodes, and by those
+ *	that change values in place before storing them.
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int 
+CheckWritable(Tcl_Interp *interp, Blt_Tree tree)
+{
+    if (Blt_TreeIsSnapshot(tree)) {
+	Tcl_AppendResult(interp, "tree \"", Blt_TreeName(tree), 
+		"\" is a read-only snapshot", (char *)NULL);
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2258,14 +2459,24 @@ ComparePattern(FindData *findData, char *string)
                 string = Blt_Strdup(string);
                 strtolower(string);
             }
-            obj = Tcl_NewStringObj(string, -1);
-	    result = (Tcl_RegExpMatchObj((Tcl_Interp *)NULL, obj, findData->name) == 1); 
-	    Tcl_DecrRefCount(obj);
+            if (findData->regexp != NULL) {
+                result = (Tcl_RegExpExec((Tcl_Interp *)NULL, 
+			findData->regexp, string, string) == 1);
+            } else {
+                obj = Tcl_NewStringObj(string, -1);
+                result = (Tcl_RegExpMatchObj((Tcl_Interp *)NULL, obj, 
+			findData->name) == 1); 
+                Tcl_DecrRefCount(obj);
+            }
             if (nocase) {
 	       Blt_Free(string);
             }
 	    break;
 	case PATTERN_INLIST:
+            if (findData->inlistTablePtr != NULL) {
+                return (Blt_FindHashEntry(findData->inlistTablePtr, string) 
+			!= NULL);
+            }
             if (Tcl_ListObjGetElements(NULL, findData->name, &objc, &objv) != TCL_OK) {
                 return 1;
             }
@@ -2433,6 +2644,143 @@ PercentSubst(
 }
 
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompileFind --
+ *
+ *	Looks up once what MatchNodeProc would otherwise look up for
+ *	each node: the keys of -column and -key, the values of -inlist,
+ *	the tables of -withtag and -withouttag and the -regexp pattern.
+ *	Tags and the regular expression are only cached when no
+ *	-command or -exec can change them during the search.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+CompileFindTag(TreeCmd *cmdPtr, Tcl_Obj *objPtr, FindTag *tagPtr)
+{
+    char *tagName;
+
+    tagName = Tcl_GetString(objPtr);
+    tagPtr->compiled = TRUE;
+    tagPtr->always = ((strcmp(tagName, "all") == 0) || 
+	(strcmp(tagName, "nonroot") == 0) || 
+	(strcmp(tagName, "rootchildren") == 0));
+    tagPtr->root = (strcmp(tagName, "root") == 0);
+    tagPtr->tPtr = Blt_TreeTagHashEntry(cmdPtr->tree, tagName);
+}
+
+static void
+CompileFind(TreeCmd *cmdPtr, FindData *dataPtr)
+{
+    Blt_TreeObject treeObjPtr = cmdPtr->tree->treeObject;
+    int readOnly;
+
+    readOnly = ((dataPtr->eval == NULL) && (dataPtr->command == NULL));
+    if ((dataPtr->subKey != NULL) && (strchr(dataPtr->subKey, '(') == NULL)) {
+	dataPtr->columnKey = Blt_TreeKeyGet(NULL, treeObjPtr, dataPtr->subKey);
+    }
+    /* 
+     * Keys of node values are compared by pointer, unless values may
+     * have been set with keys of a different table (the key tables
+     * were switched after the tree was created).
+     */
+    if ((dataPtr->keyList != NULL) && 
+	((treeObjPtr->interpKeyPtr != NULL) || (!bltTreeUseLocalKeys))) {
+	Blt_ListNode listNode;
+	char *keyName;
+	int type;
+
+	/* As in ComparePatternList, the last pattern decides. */
+	listNode = Blt_ListLastNode(dataPtr->keyList);
+	type = (intptr_t)Blt_ListGetValue(listNode);
+	keyName = (char *)Blt_ListGetKey(listNode);
+	if (((type == 0) || (type == PATTERN_EXACT)) && 
+	    (strchr(keyName, '(') == NULL)) {
+	    dataPtr->findKey = Blt_TreeKeyGet(NULL, treeObjPtr, keyName);
+	}
+    }
+    if (((dataPtr->flags & PATTERN_MASK) == PATTERN_INLIST) && 
+	((dataPtr->flags & MATCH_NOCASE) == 0)) {
+	Tcl_Obj **objv;
+	int objc, i, isNew;
+
+	if (Tcl_ListObjGetElements(NULL, dataPtr->name, &objc, &objv) 
+	    == TCL_OK) {
+	    dataPtr->inlistTablePtr = Blt_Malloc(sizeof(Blt_HashTable));
+	    assert(dataPtr->inlistTablePtr);
+	    Blt_InitHashTable(dataPtr->inlistTablePtr, BLT_STRING_KEYS);
+	    for (i = 0; i < objc; i++) {
+		Blt_CreateHashEntry(dataPtr->inlistTablePtr, 
+			Tcl_GetString(objv[i]), &isNew);
+	    }
+	}
+    }
+    if (!readOnly) {
+	return;
+    }
+    if ((dataPtr->flags & PATTERN_MASK) == PATTERN_REGEXP) {
+	/* Same flags as Tcl_RegExpMatchObj. */
+	dataPtr->regexp = Tcl_GetRegExpFromObj((Tcl_Interp *)NULL, 
+		dataPtr->name, TCL_REG_ADVANCED | TCL_REG_NOSUB);
+    }
+    if (dataPtr->withTag != NULL) {
+	CompileFindTag(cmdPtr, dataPtr->withTag, &dataPtr->withTagInfo);
+    }
+    if (dataPtr->withoutTag != NULL) {
+	CompileFindTag(cmdPtr, dataPtr->withoutTag, &dataPtr->withoutTagInfo);
+    }
+}
+
+static void
+FreeCompiledFind(FindData *dataPtr)
+{
+    if (dataPtr->inlistTablePtr != NULL) {
+	Blt_DeleteHashTable(dataPtr->inlistTablePtr);
+	Blt_Free(dataPtr->inlistTablePtr);
+    }
+    if (dataPtr->tagQuery != NULL) {
+	Blt_TreeFreeTagQuery(dataPtr->tagQuery);
+    }
+}
+
+static int
+FindHasTag(
+    TreeCmd *cmdPtr, 
+    Blt_TreeNode node, 
+    Tcl_Obj *tagObjPtr, 
+    FindTag *tagPtr)
+{
+    if (!tagPtr->compiled) {
+	return Blt_TreeHasTag(cmdPtr->tree, node, Tcl_GetString(tagObjPtr));
+    }
+    if ((tagPtr->always) || 
+	((tagPtr->root) && (node == Blt_TreeRootNode(cmdPtr->tree)))) {
+	return TRUE;
+    }
+    return ((tagPtr->tPtr != NULL) && 
+	    (Blt_TreeTagEntryHasNode(tagPtr->tPtr, node)));
+}
+
+static int
+GetFindKeyValue(
+    FindData *dataPtr, 
+    Blt_TreeNode node, 
+    Blt_TreeKey key, 
+    Tcl_Obj **objPtrPtr)
+{
+    TreeCmd *cmdPtr = dataPtr->cmdPtr;
+
+    if (dataPtr->findKey != NULL) {
+	/* Compiled keys are plain keys, never array elements. */
+	return Blt_TreeGetValueByKey(cmdPtr->interp, cmdPtr->tree, node, key, 
+		objPtrPtr);
+    }
+    return Blt_TreeGetValue(cmdPtr->interp, cmdPtr->tree, node, key, 
+	objPtrPtr);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2492,11 +2840,16 @@ MatchNodeProc(Blt_TreeNode node, ClientData clientData, int order)
 	return TCL_OK;
     }
     if ((dataPtr->withTag != NULL) &&
-        !Blt_TreeHasTag(cmdPtr->tree, node, Tcl_GetString(dataPtr->withTag))) {
+        !FindHasTag(cmdPtr, node, dataPtr->withTag, &dataPtr->withTagInfo)) {
         return TCL_OK;
     }
     if ((dataPtr->withoutTag != NULL) &&
-        Blt_TreeHasTag(cmdPtr->tree, node, Tcl_GetString(dataPtr->withoutTag))) {
+        FindHasTag(cmdPtr, node, dataPtr->withoutTag, 
+		&dataPtr->withoutTagInfo)) {
+        return TCL_OK;
+    }
+    if ((dataPtr->tagQuery != NULL) &&
+	!Blt_TreeTagQueryMatch(dataPtr->tagQuery, node)) {
         return TCL_OK;
     }
     if ((dataPtr->keyCount >= 0) &&
@@ -2510,8 +2863,13 @@ MatchNodeProc(Blt_TreeNode node, ClientData clientData, int order)
     if (dataPtr->subKey != NULL) {
         int empty;
         
-        empty = (Blt_TreeGetValue(interp, cmdPtr->tree, node, dataPtr->subKey, &curObj)
-            == TCL_OK);
+        if (dataPtr->columnKey != NULL) {
+            empty = (Blt_TreeGetValueByKey(interp, cmdPtr->tree, node, 
+		dataPtr->columnKey, &curObj) == TCL_OK);
+        } else {
+            empty = (Blt_TreeGetValue(interp, cmdPtr->tree, node, 
+		dataPtr->subKey, &curObj) == TCL_OK);
+        }
         if (empty == isnull) {
             Tcl_DStringFree(&dString);
             return TCL_OK;
@@ -2525,11 +2883,22 @@ MatchNodeProc(Blt_TreeNode node, ClientData clientData, int order)
 	Blt_TreeKeySearch cursor;
 
 	result = FALSE;		/* It's false if no keys match. */
-	for (key = Blt_TreeFirstKey(cmdPtr->tree, node, &cursor);
-	    key != NULL; key = Blt_TreeNextKey(cmdPtr->tree, &cursor)) {
+	if (dataPtr->findKey != NULL) {
+	    /* Only one key can match: look it up instead of scanning. */
+	    key = (Blt_TreeHasKey(cmdPtr->tree, node, dataPtr->findKey)) ?
+		dataPtr->findKey : NULL;
+	} else {
+	    key = Blt_TreeFirstKey(cmdPtr->tree, node, &cursor);
+	}
+	for (/*empty*/; key != NULL; key = (dataPtr->findKey != NULL) ? NULL :
+		 Blt_TreeNextKey(cmdPtr->tree, &cursor)) {
              
             curObj = NULL;
-	    result = ComparePatternList(dataPtr->keyList, key, 0);
+	    if (dataPtr->findKey != NULL) {
+		result = TRUE;
+	    } else {
+		result = ComparePatternList(dataPtr->keyList, key, 0);
+	    }
 	    if (!result) {
 		continue;
 	    }
@@ -2538,8 +2907,7 @@ MatchNodeProc(Blt_TreeNode node, ClientData clientData, int order)
                 int res;
                 
                 res = TCL_ERROR;
-                if (Blt_TreeGetValue(interp, cmdPtr->tree, node, key, &curObj)
-                    == TCL_OK) {
+                if (GetFindKeyValue(dataPtr, node, key, &curObj) == TCL_OK) {
                     res = Blt_GetArrayFromObj(NULL, curObj, &tablePtr);
                 }
                 if (Blt_TreeNodeDeleted(node) || node->inode != inode) {
@@ -2553,7 +2921,7 @@ MatchNodeProc(Blt_TreeNode node, ClientData clientData, int order)
             }
 	    if (dataPtr->name != NULL) {
 
-		if (Blt_TreeGetValue(interp, cmdPtr->tree, node, key, &curObj) != TCL_OK) {
+		if (GetFindKeyValue(dataPtr, node, key, &curObj) != TCL_OK) {
                     Tcl_DStringFree(&dString);
                     return TCL_ERROR;
                 }
@@ -3226,6 +3594,53 @@ AttachOp(
 }
 #endif
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * BatchOp --
+ *
+ *	Evaluates a script as a batch of changes.  Notifications of
+ *	moves, sorts, relabels and inserts, and write and unset traces
+ *	are held back until the script is done, and then delivered
+ *	once per changed node (or node and key).
+ *
+ *	t0 batch script
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+BatchOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,			/* Not used. */
+    Tcl_Obj *CONST *objv)
+{
+    Blt_Tree tree = cmdPtr->tree;
+    Tcl_Obj *resultObjPtr;
+    int result;
+
+    if (Blt_TreeBeginBatch(interp, tree) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    result = Tcl_EvalObjEx(interp, objv[2], 0);
+    if ((cmdPtr->delete) || (cmdPtr->tree != tree)) {
+	return result;		/* Batch was discarded with the tree. */
+    }
+    /* 
+     * Deliver what was changed, but report the script's result or
+     * error, not one left by the traces fired.
+     */
+    resultObjPtr = Tcl_GetObjResult(interp);
+    Tcl_IncrRefCount(resultObjPtr);
+    if ((Blt_TreeEndBatch(interp, tree) != TCL_OK) && (result != TCL_ERROR)) {
+	Tcl_DecrRefCount(resultObjPtr);
+	return TCL_ERROR;
+    }
+    Tcl_SetObjResult(interp, resultObjPtr);
+    Tcl_DecrRefCount(resultObjPtr);
+    return result;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -3270,25 +3685,20 @@ ChildrenOp(
 	Tcl_SetObjResult(interp, listObjPtr);
     } else if (objc == 4) {
 	int childPos;
-	int inode, count;
+	int inode;
 	
 	/* Get the node at  */
 	if (Tcl_GetIntFromObj(interp, objv[3], &childPos) != TCL_OK) {
 		return TCL_ERROR;
 	}
-	count = 0;
 	inode = -1;
-	for (node = Blt_TreeFirstChild(node); node != NULL;
-	     node = Blt_TreeNextSibling(node)) {
-	    if (count == childPos) {
-	       if (labels) {
-                    Tcl_SetObjResult(interp, Tcl_NewStringObj(node->label, -1));
-                    return TCL_OK;
-                }
-		inode = Blt_TreeNodeId(node);
-		break;
+	node = Blt_TreeNthChild(node, childPos);
+	if (node != NULL) {
+	    if (labels) {
+		Tcl_SetObjResult(interp, Tcl_NewStringObj(node->label, -1));
+		return TCL_OK;
 	    }
-	    count++;
+	    inode = Blt_TreeNodeId(node);
 	}
 	Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
 	return TCL_OK;
@@ -3309,19 +3719,20 @@ ChildrenOp(
 	    return TCL_ERROR;
 	}
 
-	count = 0;
+	if (firstPos < 0) {
+	    firstPos = 0;
+	}
 	listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
-	for (node = Blt_TreeFirstChild(node); node != NULL;
-	     node = Blt_TreeNextSibling(node)) {
-	    if ((count >= firstPos) && (count <= lastPos)) {
-	       if (labels) {
-                    objPtr = Tcl_NewStringObj(node->label, -1);
-                } else {
-                    objPtr = Tcl_NewIntObj(Blt_TreeNodeId(node));
-                }
-		Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
+	/* Start directly at the first child in the range. */
+	for (count = firstPos, node = Blt_TreeNthChild(node, firstPos); 
+	     (node != NULL) && (count <= lastPos);
+	     node = Blt_TreeNextSibling(node), count++) {
+	    if (labels) {
+		objPtr = Tcl_NewStringObj(node->label, -1);
+	    } else {
+		objPtr = Tcl_NewIntObj(Blt_TreeNodeId(node));
 	    }
-	    count++;
+	    Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
 	}
 	Tcl_SetObjResult(interp, listObjPtr);
     }
@@ -3507,6 +3918,9 @@ CopyOp(
         data.srcPtr = srcPtr;
         data.srcTree = srcTree;
     }
+    if (CheckWritable(interp, data.destTree) != TCL_OK) {
+	goto error;
+    }
 
     if ((srcTree == destTree) && (data.flags & COPY_RECURSE) &&
 	(Blt_TreeIsAncestor(srcNode, destNode))) {    
@@ -3591,6 +4005,9 @@ DeleteOp(
     int i, len;
     char *string;
     
+    if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+	return TCL_ERROR;
+    }
     for (i = 2; i < objc; i++) {
 	string = Tcl_GetStringFromObj(objv[i], &len);
 	if (len == 0) continue;
@@ -3771,1799 +4188,3216 @@ FreeTagTable(
 }
 
 /*
- *----------------------------------------------------------------------
- *
- * DumpOp --
- *
- *---------------------------------------------------------------------- 
+ * Binary dump format --
+ *
+ *	The binary format written by "dump -binary" starts with the
+ *	magic string "BLTREE", a varint format version and a varint of
+ *	flags.  Records follow, each starting with a type byte:
+ *
+ *	  'N'	A node: its depth below the dumped node, its id, its
+ *		label, the # of values followed by the key, type and
+ *		data of each value, and the # of tags followed by each
+ *		tag name.  Nodes appear in pre-order, so the parent of
+ *		a node is the last node read at the depth above.
+ *	  'E'	End of the dump.
+ *
+ *	Integers are varints: 7 bits per byte, low-order bits first,
+ *	the high bit set on all but the last byte.  Signed integers
+ *	are zig-zag encoded.  Keys, labels and tags are interned in
+ *	separate string tables.  A string reference is 0 followed by a
+ *	new string (given the next id in the table), 1 followed by a
+ *	string that isn't interned, or the id of the string plus 2.
+ *	A string is its length in bytes followed by the bytes.  A
+ *	value is a type byte (BINVAL_*) followed by a string, an
+ *	integer, or 8 bytes of a double (low-order byte first).
+ */
+#define BINDUMP_MAGIC		"BLTREE"
+#define BINDUMP_MAGIC_LEN	6
+#define BINDUMP_VERSION		1
+#define BINDUMP_TAGS		(1<<0)	/* Dump includes node tags. */
+#define BINDUMP_CHUNK		65536	/* Bytes read or written at once. */
+#define BINDUMP_MAX_LABELS	65536	/* Labels after this many distinct
+					 * ones are written inline. */
+#define BINVAL_STRING		0
+#define BINVAL_WIDE		1
+#define BINVAL_DOUBLE		2
+
+typedef struct {
+    Tcl_Channel channel;	/* Channel to write to.  If NULL, the
+				 * dump is collected in the buffer. */
+    Tcl_DString buffer;		/* Bytes not yet written. */
+    Tcl_DString values;		/* Scratch space for a node's values. */
+    int error;			/* Indicates a write failed. */
+    Blt_HashTable keyTable;	/* Interned strings -> id. */
+    Blt_HashTable labelTable;
+    Blt_HashTable tagTable;
+    Blt_HashTable keepTable;	/* Blt_TreeKey -> keep (-keys/-skipkeys). */
+    int nKeys, nLabels, nTags;
+    Tcl_ObjType *intTypePtr, *wideTypePtr, *doubleTypePtr;
+} BinaryWriter;
+
+typedef struct {
+    char *string;		/* NUL-terminated string. */
+    int keep;			/* Cached filter result, -1 if unknown. */
+    Blt_TreeKey key;		/* Key, for strings of the key table. */
+    int plain;			/* Key can be set without parsing. */
+} BinaryString;
+
+typedef struct {
+    BinaryString *strings;
+    int nStrings, nAlloc;
+} BinaryStringTable;
+
+typedef struct {
+    Tcl_Interp *interp;
+    Tcl_Channel channel;	/* Channel to read from.  If NULL, the 
+				 * whole dump is in memory. */
+    unsigned char *chunk;	/* Buffer for reads from the channel. */
+    unsigned char *pos, *end;	/* Unread bytes. */
+    Tcl_DString scratch;	/* Bytes spanning two chunks. */
+    Tcl_DString inlineStr;	/* Last string read that wasn't interned. */
+    BinaryStringTable keys, labels, tags;
+    int nRecords;
+} BinaryReader;
+
+/*
+ * Returns if a key passes the -keys and -skipkeys switches.
  */
-/*ARGSUSED*/
 static int
-DumpOp(
-    TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,			/* Not used. */
-    Tcl_Obj *CONST *objv)
+KeepKey(RestoreData *dataPtr, CONST char *key)
 {
-    Blt_TreeNode top;
-    Tcl_Channel channel = NULL;
-    Tcl_DString dString;
-    int result, isfile = 0, op, tags, doTbl = 0;
-    register Blt_TreeNode node;
-    RestoreData data;
-    
-    memset((char *)&data, 0, sizeof(data));
+    int i, keep;
 
-    if (GetNode(cmdPtr, objv[2], &top) != TCL_OK) {
-	return TCL_ERROR;
+    keep = 1;
+    if (dataPtr->keys != NULL) {
+	keep = 0;
+	for (i = 0; i < dataPtr->kobjc; i++) {
+	    if (Tcl_StringMatch(key, Tcl_GetString(dataPtr->kobjv[i])) == 1) {
+		keep = 1;
+		break;
+	    }
+	}
     }
-    if (objc > 3) {
-        /* Process switches  */
-        if (Blt_ProcessObjSwitches(interp, dumpSwitches, objc - 3, objv + 3, 
-            (char *)&data, BLT_SWITCH_EXACT) < 0) {
-            return TCL_ERROR;
-        }
+    if (keep && (dataPtr->notKeys != NULL)) {
+	for (i = 0; i < dataPtr->nobjc; i++) {
+	    if (Tcl_StringMatch(key, Tcl_GetString(dataPtr->nobjv[i])) == 1) {
+		keep = 0;
+		break;
+	    }
+	}
     }
-    tags = ((data.flags&RESTORE_NO_TAGS) == 0);
-    if (data.file != NULL && data.chan != NULL) {
-        Tcl_AppendResult(interp, "can not use both -file and -channel", 0);
-        return TCL_ERROR;
+    return keep;
+}
+
+/*
+ * Returns if a tag passes the -tag and -skiptag switches.
+ */
+static int
+KeepTag(RestoreData *dataPtr, CONST char *tagName)
+{
+    if ((dataPtr->tags != NULL) && 
+	(Tcl_StringMatch(tagName, dataPtr->tags) != 1)) {
+	return 0;
     }
-    if (data.file != NULL) {
-        if (Tcl_IsSafe(interp)) {
-            Tcl_AppendResult(interp, "can use -file in safe interp", 0);
-            return TCL_ERROR;
-        }
-        channel = Tcl_OpenFileChannel(interp, data.file, "w", 0644);
-        if (channel == NULL) {
-            return TCL_ERROR;
-        }
-        isfile = 1;
-    } else if (data.chan != NULL) {
-        op = 0;
-        channel = Tcl_GetChannel(interp, data.chan, &op);
-        if (channel == NULL) {
-            return TCL_ERROR;
-        }
-        if ((op & TCL_WRITABLE) == 0) {
-            Tcl_AppendResult(interp, "channel is not writable", 0);
-            return TCL_ERROR;
-        }
+    if ((dataPtr->notTags != NULL) && 
+	(Tcl_StringMatch(tagName, dataPtr->notTags) == 1)) {
+	return 0;
     }
-    if (data.keys != NULL && Tcl_ListObjGetElements(interp, data.keys, &data.kobjc,
-        &data.kobjv) != TCL_OK) {
-        return TCL_ERROR;
+    return 1;
+}
+
+static void
+BinPutByte(Tcl_DString *dsPtr, int byte)
+{
+    char c = (char)byte;
+
+    Tcl_DStringAppend(dsPtr, &c, 1);
+}
+
+static void
+BinPutVarint(Tcl_DString *dsPtr, Tcl_WideUInt value)
+{
+    unsigned char bytes[10];
+    int n;
+
+    n = 0;
+    while (value >= 0x80) {
+	bytes[n++] = (unsigned char)(value | 0x80);
+	value >>= 7;
     }
-    if (data.notKeys != NULL && Tcl_ListObjGetElements(interp, data.notKeys,
-        &data.nobjc, &data.nobjv) != TCL_OK) {
-        return TCL_ERROR;
+    bytes[n++] = (unsigned char)value;
+    Tcl_DStringAppend(dsPtr, (char *)bytes, n);
+}
+
+static void
+BinPutString(Tcl_DString *dsPtr, CONST char *string, int length)
+{
+    if (length < 0) {
+	length = strlen(string);
     }
-    /*if (data.keys != NULL && data.notKeys != NULL) {
-        Tcl_AppendResult(interp, "can not use both -keys and -notkeys", 0);
-        return TCL_ERROR;
-    }*/
+    BinPutVarint(dsPtr, length);
+    Tcl_DStringAppend(dsPtr, string, length);
+}
 
-    if (tags && top->nChildren>0) {
-        doTbl = 1;
-        MakeTagTable(cmdPtr->tree, &data.tagTable, data.tags, data.notTags);
+/*
+ * Writes a reference to an interned string, adding the string to the
+ * table if it's new and the table isn't full.
+ */
+static void
+BinPutStringRef(
+    Tcl_DString *dsPtr,
+    Blt_HashTable *tablePtr,
+    int *countPtr,
+    int limit,
+    CONST char *string)
+{
+    Blt_HashEntry *hPtr;
+    int isNew;
+
+    hPtr = Blt_FindHashEntry(tablePtr, string);
+    if (hPtr != NULL) {
+	BinPutVarint(dsPtr, (long)Blt_GetHashValue(hPtr) + 2);
+	return;
     }
-    result = TCL_OK;
-    Tcl_DStringInit(&dString);
-    if (channel != NULL) {
-        int cnt = 1;
-        for (node = top; node != NULL && cnt > 0; node = Blt_TreeNextNode(top, node)) {
-            PrintNode(cmdPtr, top, node, &dString, tags, &data);
-            if (Tcl_DStringLength(&dString) >= 4096) {
-                cnt = Tcl_Write(channel, Tcl_DStringValue(&dString), -1);
-                Tcl_DStringSetLength(&dString, 0);
-            }
-        }
-        if (cnt > 0 && Tcl_DStringLength(&dString) > 0) {
-            cnt = Tcl_Write(channel, Tcl_DStringValue(&dString), -1);
-        }
-        Tcl_DStringFree(&dString);
-        if (isfile) {
-            Tcl_Close(interp, channel);
-        }
-        if (cnt <= 0) {
-            result = TCL_ERROR;
-        }
+    if (*countPtr >= limit) {
+	BinPutVarint(dsPtr, 1);
     } else {
-        for (node = top; node != NULL; node = Blt_TreeNextNode(top, node)) {
-            PrintNode(cmdPtr, top, node, &dString, tags, &data);
-        }
-        Tcl_DStringResult(interp, &dString);
+	hPtr = Blt_CreateHashEntry(tablePtr, string, &isNew);
+	Blt_SetHashValue(hPtr, (ClientData)(long)*countPtr);
+	(*countPtr)++;
+	BinPutVarint(dsPtr, 0);
     }
-    if (doTbl) {
-        FreeTagTable(&data.tagTable);
+    BinPutString(dsPtr, string, -1);
+}
+
+/*
+ * Writes a typed value.  Integers and doubles are written in binary
+ * only if that doesn't lose their string representation.
+ */
+static void
+BinPutValue(BinaryWriter *writerPtr, Tcl_DString *dsPtr, Tcl_Obj *objPtr)
+{
+    if (((objPtr->typePtr == writerPtr->intTypePtr) || 
+	 (objPtr->typePtr == writerPtr->wideTypePtr)) &&
+	(objPtr->typePtr != NULL)) {
+	Tcl_WideInt value;
+	char string[TCL_INTEGER_SPACE * 2];
+
+	if (Tcl_GetWideIntFromObj((Tcl_Interp *)NULL, objPtr, &value) 
+	    == TCL_OK) {
+	    sprintf(string, "%" TCL_LL_MODIFIER "d", value);
+	    if ((objPtr->bytes == NULL) || (strcmp(objPtr->bytes, string) == 0)) {
+		BinPutByte(dsPtr, BINVAL_WIDE);
+		BinPutVarint(dsPtr, ((Tcl_WideUInt)value << 1) ^ 
+			(Tcl_WideUInt)(value >> 63));
+		return;
+	    }
+	}
+    } else if ((objPtr->typePtr == writerPtr->doubleTypePtr) &&
+	       (objPtr->typePtr != NULL) && (objPtr->bytes == NULL)) {
+	union {
+	    double d;
+	    Tcl_WideUInt u;
+	} bits;
+	unsigned char bytes[9];
+	int i;
+
+	bits.d = objPtr->internalRep.doubleValue;
+	bytes[0] = BINVAL_DOUBLE;
+	for (i = 1; i < 9; i++) {
+	    bytes[i] = (unsigned char)(bits.u & 0xFF);
+	    bits.u >>= 8;
+	}
+	Tcl_DStringAppend(dsPtr, (char *)bytes, 9);
+	return;
     }
-    return result;
+    {
+	char *string;
+	int length;
+
+	string = Tcl_GetStringFromObj(objPtr, &length);
+	BinPutByte(dsPtr, BINVAL_STRING);
+	BinPutString(dsPtr, string, length);
+    }
+}
+
+static void
+BinFlush(BinaryWriter *writerPtr)
+{
+    int length;
+
+    length = Tcl_DStringLength(&writerPtr->buffer);
+    if ((writerPtr->channel == NULL) || (length == 0)) {
+	return;
+    }
+    if (Tcl_Write(writerPtr->channel, Tcl_DStringValue(&writerPtr->buffer),
+	  length) != length) {
+	writerPtr->error = TRUE;
+    }
+    Tcl_DStringSetLength(&writerPtr->buffer, 0);
 }
 
 /*
- *----------------------------------------------------------------------
- *
- * ExistsOp --
- *
- *---------------------------------------------------------------------- 
+ * Builds a table of the tags of each node: node -> chain of tag
+ * names.
  */
-static int
-ExistsOp(
-    TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,
-    Tcl_Obj *CONST *objv)
+static void
+MakeBinaryTagTable(Blt_Tree tree, Blt_HashTable *tablePtr, 
+		   RestoreData *dataPtr)
 {
+    Blt_HashEntry *hPtr, *h2Ptr, *h3Ptr;
+    Blt_HashSearch cursor, tcursor;
+    Blt_TreeTagEntry *tPtr;
     Blt_TreeNode node;
-    int bool;
-    
-    bool = TRUE;
-    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
-	bool = FALSE;
-    } else if (objc == 4) { 
-	char *string;
-	
-	string = Tcl_GetString(objv[3]);
-	if (!Blt_TreeValueExists(cmdPtr->tree, node, 
-			     string)) {
-	    bool = FALSE;
+    Blt_Chain *chainPtr;
+    int isNew;
+
+    Blt_InitHashTable(tablePtr, BLT_ONE_WORD_KEYS);
+    for (hPtr = Blt_TreeFirstTag(tree, &cursor); hPtr != NULL; 
+	 hPtr = Blt_NextHashEntry(&cursor)) {
+	tPtr = Blt_GetHashValue(hPtr);
+	if (!KeepTag(dataPtr, tPtr->tagName)) {
+	    continue;
 	}
-    } 
-    Tcl_SetObjResult(interp, Tcl_NewBooleanObj(bool));
-    return TCL_OK;
+	for (h2Ptr = Blt_FirstHashEntry(&tPtr->nodeTable, &tcursor);
+	     h2Ptr != NULL; h2Ptr = Blt_NextHashEntry(&tcursor)) {
+	    node = Blt_GetHashValue(h2Ptr);
+	    if (node == NULL) {
+		continue;
+	    }
+	    h3Ptr = Blt_CreateHashEntry(tablePtr, (char *)node, &isNew);
+	    if (isNew) {
+		chainPtr = Blt_ChainCreate();
+		Blt_SetHashValue(h3Ptr, chainPtr);
+	    } else {
+		chainPtr = Blt_GetHashValue(h3Ptr);
+	    }
+	    Blt_ChainAppend(chainPtr, tPtr->tagName);
+	}
+    }
+}
+
+static void
+FreeBinaryTagTable(Blt_HashTable *tablePtr)
+{
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
+
+    for (hPtr = Blt_FirstHashEntry(tablePtr, &cursor); hPtr != NULL; 
+	 hPtr = Blt_NextHashEntry(&cursor)) {
+	Blt_ChainDestroy((Blt_Chain *)Blt_GetHashValue(hPtr));
+    }
+    Blt_DeleteHashTable(tablePtr);
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * FindOp --
+ * DumpBinary --
+ *
+ *	Writes the subtree at top in the binary dump format, either to
+ *	the channel (in chunks) or as a byte array in the interpreter
+ *	result.
  *
  *---------------------------------------------------------------------- 
  */
 static int
-FindOp(
+DumpBinary(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
-    int objc,
-    Tcl_Obj *CONST *objv)
+    Blt_TreeNode top,
+    Tcl_Channel channel,
+    RestoreData *dataPtr)
 {
-    Blt_TreeNode node, child;
-    FindData data;
-    int result;
-    Tcl_Obj **objArr;
+    BinaryWriter writer;
+    Blt_HashTable tagTable;
+    Blt_HashEntry *hPtr;
+    Blt_TreeKeySearch keyIter;
+    Blt_TreeNode node;
+    Blt_TreeKey key;
+    Tcl_Obj *valueObjPtr;
+    int tags, nValues, topDepth, keep, isNew;
+
+    memset(&writer, 0, sizeof(writer));
+    writer.channel = channel;
+    Tcl_DStringInit(&writer.buffer);
+    Tcl_DStringInit(&writer.values);
+    Blt_InitHashTable(&writer.keyTable, BLT_STRING_KEYS);
+    Blt_InitHashTable(&writer.labelTable, BLT_STRING_KEYS);
+    Blt_InitHashTable(&writer.tagTable, BLT_STRING_KEYS);
+    Blt_InitHashTable(&writer.keepTable, BLT_ONE_WORD_KEYS);
+    writer.intTypePtr = (Tcl_ObjType *)Tcl_GetObjType("int");
+    writer.wideTypePtr = (Tcl_ObjType *)Tcl_GetObjType("wideInt");
+    writer.doubleTypePtr = (Tcl_ObjType *)Tcl_GetObjType("double");
+
+    tags = ((dataPtr->flags & RESTORE_NO_TAGS) == 0);
+    if (tags) {
+	MakeBinaryTagTable(cmdPtr->tree, &tagTable, dataPtr);
+    }
+    Tcl_DStringAppend(&writer.buffer, BINDUMP_MAGIC, BINDUMP_MAGIC_LEN);
+    BinPutVarint(&writer.buffer, BINDUMP_VERSION);
+    BinPutVarint(&writer.buffer, (tags) ? BINDUMP_TAGS : 0);
+
+    topDepth = Blt_TreeNodeDepth(cmdPtr->tree, top);
+    for (node = top; (node != NULL) && (!writer.error); 
+	 node = Blt_TreeNextNode(top, node)) {
+	BinPutByte(&writer.buffer, 'N');
+	BinPutVarint(&writer.buffer, 
+		Blt_TreeNodeDepth(cmdPtr->tree, node) - topDepth);
+	BinPutVarint(&writer.buffer, Blt_TreeNodeId(node));
+	BinPutStringRef(&writer.buffer, &writer.labelTable, &writer.nLabels,
+		BINDUMP_MAX_LABELS, Blt_TreeNodeLabel(node));
+
+	/* Values are collected first, since some may fail to be read. */
+	nValues = 0;
+	Tcl_DStringSetLength(&writer.values, 0);
+	for (key = Blt_TreeFirstKey(cmdPtr->tree, node, &keyIter); 
+	     key != NULL; key = Blt_TreeNextKey(cmdPtr->tree, &keyIter)) {
+	    hPtr = Blt_CreateHashEntry(&writer.keepTable, key, &isNew);
+	    if (isNew) {
+		keep = KeepKey(dataPtr, key);
+		Blt_SetHashValue(hPtr, (ClientData)(long)keep);
+	    } else {
+		keep = (int)(long)Blt_GetHashValue(hPtr);
+	    }
+	    if (!keep) {
+		continue;
+	    }
+	    if (Blt_TreeGetValueByKey((Tcl_Interp *)NULL, cmdPtr->tree, node, 
+		key, &valueObjPtr) != TCL_OK) {
+		continue;
+	    }
+	    BinPutStringRef(&writer.values, &writer.keyTable, &writer.nKeys,
+		INT_MAX, key);
+	    BinPutValue(&writer, &writer.values, valueObjPtr);
+	    nValues++;
+	}
+	BinPutVarint(&writer.buffer, nValues);
+	Tcl_DStringAppend(&writer.buffer, Tcl_DStringValue(&writer.values),
+		Tcl_DStringLength(&writer.values));
 
-   /* if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
-	return TCL_ERROR;
-    }*/
-    memset(&data, 0, sizeof(data));
-    data.cmdPtr = cmdPtr;
-    data.startNode = node = Blt_TreeRootNode(cmdPtr->tree);
-    data.maxDepth = -1;
-    data.minDepth = -1;
-    data.depth = -1;
-    data.keyCount = -1;
-    data.flags = 0;
-    data.order = TREE_PREORDER;
-    objArr = NULL;
+	hPtr = NULL;
+	if (tags) {
+	    hPtr = Blt_FindHashEntry(&tagTable, (char *)node);
+	}
+	if (hPtr == NULL) {
+	    BinPutVarint(&writer.buffer, 0);
+	} else {
+	    Blt_Chain *chainPtr;
+	    Blt_ChainLink *linkPtr;
 
-    /* Process switches  */
-    if (Blt_ProcessObjSwitches(interp, findSwitches, objc - 2, objv + 2, 
-		     (char *)&data, BLT_SWITCH_EXACT) < 0) {
+	    chainPtr = Blt_GetHashValue(hPtr);
+	    BinPutVarint(&writer.buffer, Blt_ChainGetLength(chainPtr));
+	    for (linkPtr = Blt_ChainFirstLink(chainPtr); linkPtr != NULL;
+		 linkPtr = Blt_ChainNextLink(linkPtr)) {
+		BinPutStringRef(&writer.buffer, &writer.tagTable, 
+			&writer.nTags, INT_MAX, Blt_ChainGetValue(linkPtr));
+	    }
+	}
+	if (Tcl_DStringLength(&writer.buffer) >= BINDUMP_CHUNK) {
+	    BinFlush(&writer);
+	}
+    }
+    BinPutByte(&writer.buffer, 'E');
+    if (channel != NULL) {
+	BinFlush(&writer);
+    } else {
+	Tcl_SetObjResult(interp, Tcl_NewByteArrayObj(
+		(unsigned char *)Tcl_DStringValue(&writer.buffer),
+		Tcl_DStringLength(&writer.buffer)));
+    }
+    if (tags) {
+	FreeBinaryTagTable(&tagTable);
+    }
+    Tcl_DStringFree(&writer.buffer);
+    Tcl_DStringFree(&writer.values);
+    Blt_DeleteHashTable(&writer.keyTable);
+    Blt_DeleteHashTable(&writer.labelTable);
+    Blt_DeleteHashTable(&writer.tagTable);
+    Blt_DeleteHashTable(&writer.keepTable);
+    if (writer.error) {
+	Tcl_AppendResult(interp, "error writing dump: ", Tcl_PosixError(interp),
+		(char *)NULL);
 	return TCL_ERROR;
     }
-    if (data.nodesObj != NULL) {
-        if (data.flags & MATCH_NOTOP) {
-            Tcl_AppendResult(interp, "-nodes can not use -notop", 0);
-            return TCL_ERROR;
-        }
+    return TCL_OK;
+}
+
+static int
+BinCorrupt(BinaryReader *readerPtr, CONST char *mesg)
+{
+    Tcl_ResetResult(readerPtr->interp);
+    Tcl_AppendResult(readerPtr->interp, "bad binary dump: ", mesg, 
+	" in record #", Blt_Itoa(readerPtr->nRecords), (char *)NULL);
+    return TCL_ERROR;
+}
+
+/*
+ * Reads the next chunk from the channel, keeping the unread bytes.
+ * Returns the # of bytes now available.
+ */
+static int
+BinFill(BinaryReader *readerPtr)
+{
+    int nLeft, nRead;
+
+    nLeft = readerPtr->end - readerPtr->pos;
+    if (readerPtr->channel == NULL) {
+	return nLeft;
     }
-    if (data.execObj != NULL && data.command != NULL) {
-        Tcl_AppendResult(interp, "can not use both -command and -exec", 0);
-        return TCL_ERROR;
+    if (nLeft > 0) {
+	memmove(readerPtr->chunk, readerPtr->pos, nLeft);
     }
-    if (data.execObj != NULL) {
-        data.eval = Tcl_GetString(data.execObj);
-    } else if (data.execVar != NULL) {
-        Tcl_AppendResult(interp, "-var must be used with -exec", 0);
-        return TCL_ERROR;
+    readerPtr->pos = readerPtr->chunk;
+    readerPtr->end = readerPtr->chunk + nLeft;
+    nRead = Tcl_Read(readerPtr->channel, (char *)readerPtr->end, 
+	BINDUMP_CHUNK - nLeft);
+    if (nRead > 0) {
+	readerPtr->end += nRead;
     }
-    if (data.startNode != NULL) {
-        node = data.startNode;
-        if (data.nodesObj != NULL) {
-            Tcl_AppendResult(interp, "-nodes can not use -top", 0);
-            return TCL_ERROR;
-        }
-    }
-    if (data.keyList == NULL) {
-        if (data.flags & (MATCH_ARRAY)) {
-            Tcl_AppendResult(interp, "-array must be used with -key", 0);
-            result = TCL_ERROR;
-            goto done;
-        }
-    }
-    if (data.retKey != NULL) {
-
-        if (data.flags & MATCH_COUNT) {
-            Tcl_AppendResult(interp, "can not use -return and -count", 0);
-            result = TCL_ERROR;
-            goto done;
-        }
-        if (data.eval != NULL) {
-            Tcl_AppendResult(interp, "can not use -return and -exec", 0);
-            result = TCL_ERROR;
-            goto done;
-        }
-        if (data.command != NULL) {
-            Tcl_AppendResult(interp, "can not use -return and -command", 0);
-            result = TCL_ERROR;
-            goto done;
-        }
-        if (data.retKey[0] == '%') {
-         } else if (Blt_TreeKeyGet(NULL, cmdPtr->tree->treeObject, data.retKey) != NULL) {
-            data.iskey = 1;
-         } else {
-             Tcl_AppendResult(interp, "-return is not a key or a percent subst", 0);
-             result = TCL_ERROR;
-             goto done;
-         }
+    return readerPtr->end - readerPtr->pos;
+}
+
+static int
+BinGetByte(BinaryReader *readerPtr, int *bytePtr)
+{
+    if ((readerPtr->pos == readerPtr->end) && (BinFill(readerPtr) == 0)) {
+	return BinCorrupt(readerPtr, "unexpected end of data");
     }
+    *bytePtr = *readerPtr->pos++;
+    return TCL_OK;
+}
 
-    if (data.flags & MATCH_RELDEPTH) {
-        int dep;
-        dep = Blt_TreeNodeDepth(cmdPtr->tree, node);
-        if (data.maxDepth >= 0) {
-            data.maxDepth += dep;
-        }
-        if (data.minDepth >= 0) {
-            data.minDepth += dep;
-        }
-        if (data.depth >= 0) {
-            data.depth += dep;
-        }
-    }
-    /*if (data.maxDepth >= 0) {
-	data.maxDepth += Blt_TreeNodeDepth(cmdPtr->tree, node);
-    }*/
-    /*if (data.flags & MATCH_NOCASE) {
-	Blt_ListNode listNode;
+static int
+BinGetVarint(BinaryReader *readerPtr, Tcl_WideUInt *valuePtr)
+{
+    Tcl_WideUInt value;
+    int byte, shift;
 
-	for (listNode = Blt_ListFirstNode(data.patternList); listNode != NULL;
-	     listNode = Blt_ListNextNode(listNode)) {
-	    strtolower((char *)Blt_ListGetKey(listNode));
+    value = 0;
+    for (shift = 0; shift < 64; shift += 7) {
+	if (BinGetByte(readerPtr, &byte) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	value |= (Tcl_WideUInt)(byte & 0x7F) << shift;
+	if ((byte & 0x80) == 0) {
+	    *valuePtr = value;
+	    return TCL_OK;
 	}
-    }*/
-    if (data.name != NULL && (data.flags & (MATCH_ARRAY))) {
-        Tcl_AppendResult(interp, "-array must not be used with -name", 0);
-        result = TCL_ERROR;
-        goto done;
-    }
-    if (data.name == NULL && (data.flags & (PATTERN_REGEXP|PATTERN_GLOB|PATTERN_INLIST))) {
-        Tcl_AppendResult(interp, "must provide -name with -regexp -glob -inlist", 0);
-        result = TCL_ERROR;
-        goto done;
-    }
-    if ((data.flags & (MATCH_ISNULL))) {
-        if (data.subKey == NULL) {
-            Tcl_AppendResult(interp, "-isempty must be used with -column", 0);
-            result = TCL_ERROR;
-            goto done;
-        }
-        if (data.name != NULL) {
-            Tcl_AppendResult(interp, "-isempty can not be used with -name", 0);
-            result = TCL_ERROR;
-            goto done;
-        }
-        if ((data.flags & (MATCH_INVERT))) {
-            Tcl_AppendResult(interp, "-isempty can not be used with -invert", 0);
-            result = TCL_ERROR;
-            goto done;
-        }
-        if (data.retKey) {
-            Tcl_AppendResult(interp, "-isempty can not be used with -return", 0);
-            result = TCL_ERROR;
-            goto done;
-        }
-        if (data.command) {
-            Tcl_AppendResult(interp, "-isempty can not be used with -command", 0);
-            result = TCL_ERROR;
-            goto done;
-        }
-    }
-    if ((data.flags & PATTERN_MASK) == PATTERN_REGEXP) {
-        if (Tcl_RegExpMatch(interp, "", Tcl_GetString(data.name)) == -1) {
-            result = TCL_ERROR;
-            goto done;
-        }
     }
-    if ((data.flags & PATTERN_MASK) == PATTERN_INLIST) {
-        int cobjc;
-        Tcl_Obj **cobjv;
-        if (Tcl_ListObjGetElements(interp, data.name,
-            &cobjc, &cobjv) != TCL_OK) {
-            result = TCL_ERROR;
-            goto done;
-        }
+    return BinCorrupt(readerPtr, "integer too long");
+}
+
+static int
+BinGetInt(BinaryReader *readerPtr, int *valuePtr)
+{
+    Tcl_WideUInt value;
+
+    if (BinGetVarint(readerPtr, &value) != TCL_OK) {
+	return TCL_ERROR;
     }
-    if (data.addTag != NULL) {
-        if (AddTag(cmdPtr, NULL, data.addTag) != TCL_OK) {
-            return TCL_ERROR;
-        }
+    if (value > INT_MAX) {
+	return BinCorrupt(readerPtr, "integer out of range");
     }
-    if (data.command != NULL) {
-	int count, acnt;
-	char **p;
-	register int i;
+    *valuePtr = (int)value;
+    return TCL_OK;
+}
 
-	count = 0;
-	acnt = 0;
-	for (p = data.command; *p != NULL; p++) {
-	    count++;
-	}
-        for (p = data.cmdArgs; *p != NULL; p++) {
-            
-            acnt++;
-        }
-	/* Leave room for node Id argument to be appended */
-	objArr = Blt_Calloc(count + acnt + 2, sizeof(Tcl_Obj *));
-	for (i = 0; i < count; i++) {
-	    objArr[i] = Tcl_NewStringObj(data.command[i], -1);
-	    Tcl_IncrRefCount(objArr[i]);
+/*
+ * Returns a pointer to the next length bytes.  It's valid until the
+ * next read.
+ */
+static int
+BinGetBytes(BinaryReader *readerPtr, int length, char **bytesPtr)
+{
+    int nAvail;
+
+    if ((readerPtr->end - readerPtr->pos) >= length) {
+	*bytesPtr = (char *)readerPtr->pos;
+	readerPtr->pos += length;
+	return TCL_OK;
+    }
+    /* The bytes span chunks: copy them into the scratch buffer. */
+    Tcl_DStringSetLength(&readerPtr->scratch, 0);
+    while (length > 0) {
+	nAvail = readerPtr->end - readerPtr->pos;
+	if ((nAvail == 0) && ((nAvail = BinFill(readerPtr)) == 0)) {
+	    return BinCorrupt(readerPtr, "unexpected end of data");
 	}
-        objArr[i] = Tcl_NewStringObj("", -1);
-        Tcl_IncrRefCount(objArr[i]);
-        i++;
-        for (; i < (count+acnt+1); i++) {
-	    objArr[i] = Tcl_NewStringObj("", 0);
-	    Tcl_IncrRefCount(objArr[i]);
+	if (nAvail > length) {
+	    nAvail = length;
 	}
-	data.objv = objArr;
-	data.objc = count + 1;
-	data.argc = acnt;
-    } else if (data.cmdArgs != NULL) {
-        Tcl_AppendResult(interp, "-cmdargs must be used with -command", 0);
-        result = TCL_ERROR;
-        goto done;
+	Tcl_DStringAppend(&readerPtr->scratch, (char *)readerPtr->pos, nAvail);
+	readerPtr->pos += nAvail;
+	length -= nAvail;
     }
-    data.listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
-    data.cmdPtr = cmdPtr;
-    result = TCL_OK;
-    if (data.nodesObj != NULL) {
-        TagSearch tagIter = {0};
+    *bytesPtr = Tcl_DStringValue(&readerPtr->scratch);
+    return TCL_OK;
+}
 
-        if (FindTaggedNodes(interp, cmdPtr, data.nodesObj, &tagIter) != TCL_OK) {
-            result = TCL_ERROR;
-            goto done;
-        }
-        for (child = FirstTaggedNode(&tagIter);
-            child != NULL && result == TCL_OK;
-            child = NextTaggedNode(child, &tagIter)) {
-            result = MatchNodeProc(child, &data, -1);
-        }
-        DoneTaggedNodes(&tagIter);
-        
-    } else if (data.order == TREE_BREADTHFIRST) {
-	result = Blt_TreeApplyBFS(node, MatchNodeProc, &data);
-    } else {
-	result = Blt_TreeApplyDFS(node, MatchNodeProc, &data, data.order);
-    }
-    if (data.command != NULL) {
-	Tcl_Obj **objPtrPtr;
+/*
+ * Reads a string reference.  Returns the entry of the string in the
+ * table, or NULL (and the string in readerPtr->inlineStr) if the string
+ * isn't interned.
+ */
+static int
+BinGetStringRef(
+    BinaryReader *readerPtr,
+    BinaryStringTable *tablePtr,
+    BinaryString **stringPtrPtr)
+{
+    Tcl_WideUInt ref;
+    BinaryString *stringPtr;
+    char *bytes;
+    int length;
 
-	for (objPtrPtr = objArr; *objPtrPtr != NULL; objPtrPtr++) {
-	    Tcl_DecrRefCount(*objPtrPtr);
+    if (BinGetVarint(readerPtr, &ref) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (ref >= 2) {
+	if (ref - 2 >= (Tcl_WideUInt)tablePtr->nStrings) {
+	    return BinCorrupt(readerPtr, "unknown string reference");
 	}
-	Blt_Free(objArr);
+	*stringPtrPtr = tablePtr->strings + (ref - 2);
+	return TCL_OK;
     }
-done:
-    Blt_FreeSwitches(interp, findSwitches, (char *)&data, 0);
-    if (result == TCL_ERROR) {
+    if ((BinGetInt(readerPtr, &length) != TCL_OK) ||
+	(BinGetBytes(readerPtr, length, &bytes) != TCL_OK)) {
 	return TCL_ERROR;
     }
-    if (data.flags & MATCH_COUNT) {
-        Tcl_SetObjResult(interp, Tcl_NewIntObj(data.nMatches));
-    } else {
-        Tcl_SetObjResult(interp, data.listObjPtr);
+    if (ref == 1) {
+	Tcl_DStringSetLength(&readerPtr->inlineStr, 0);
+	Tcl_DStringAppend(&readerPtr->inlineStr, bytes, length);
+	*stringPtrPtr = NULL;
+	return TCL_OK;
     }
+    if (tablePtr->nStrings == tablePtr->nAlloc) {
+	tablePtr->nAlloc = (tablePtr->nAlloc == 0) ? 64 : tablePtr->nAlloc * 2;
+	tablePtr->strings = Blt_Realloc(tablePtr->strings, 
+		tablePtr->nAlloc * sizeof(BinaryString));
+	assert(tablePtr->strings);
+    }
+    stringPtr = tablePtr->strings + tablePtr->nStrings++;
+    stringPtr->string = Blt_Malloc(length + 1);
+    assert(stringPtr->string);
+    memcpy(stringPtr->string, bytes, length);
+    stringPtr->string[length] = '\0';
+    stringPtr->keep = -1;
+    stringPtr->key = NULL;
+    stringPtr->plain = FALSE;
+    *stringPtrPtr = stringPtr;
     return TCL_OK;
 }
 
-/*
- *----------------------------------------------------------------------
- *
- * FindChildOp --
- *
- *---------------------------------------------------------------------- 
- */
-/*ARGSUSED*/
+static void
+FreeBinaryStringTable(BinaryStringTable *tablePtr)
+{
+    int i;
+
+    for (i = 0; i < tablePtr->nStrings; i++) {
+	Blt_Free(tablePtr->strings[i].string);
+    }
+    if (tablePtr->strings != NULL) {
+	Blt_Free(tablePtr->strings);
+    }
+}
+
 static int
-FindChildOp(
-    TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,			/* Not used. */
-    Tcl_Obj *CONST *objv)
+BinGetValue(BinaryReader *readerPtr, Tcl_Obj **objPtrPtr)
 {
-    Blt_TreeNode node, child;
-    int inode;
+    Tcl_WideUInt value;
+    char *bytes;
+    int type, length, i;
 
-    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+    if (BinGetByte(readerPtr, &type) != TCL_OK) {
 	return TCL_ERROR;
     }
-    inode = -1;
-    child = Blt_TreeFindChild(node, Tcl_GetString(objv[3]));
-    if (child != NULL) {
-	inode = Blt_TreeNodeId(child);
+    switch (type) {
+    case BINVAL_STRING:
+	if ((BinGetInt(readerPtr, &length) != TCL_OK) ||
+	    (BinGetBytes(readerPtr, length, &bytes) != TCL_OK)) {
+	    return TCL_ERROR;
+	}
+	*objPtrPtr = Tcl_NewStringObj(bytes, length);
+	break;
+
+    case BINVAL_WIDE:
+	if (BinGetVarint(readerPtr, &value) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	*objPtrPtr = Tcl_NewWideIntObj((Tcl_WideInt)(value >> 1) ^ 
+		-(Tcl_WideInt)(value & 1));
+	break;
+
+    case BINVAL_DOUBLE:
+	{
+	    union {
+		double d;
+		Tcl_WideUInt u;
+	    } bits;
+	    
+	    if (BinGetBytes(readerPtr, 8, &bytes) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    bits.u = 0;
+	    for (i = 7; i >= 0; i--) {
+		bits.u = (bits.u << 8) | (unsigned char)bytes[i];
+	    }
+	    *objPtrPtr = Tcl_NewDoubleObj(bits.d);
+	}
+	break;
+
+    default:
+	return BinCorrupt(readerPtr, "unknown value type");
     }
-    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
     return TCL_OK;
 }
 
-
 /*
  *----------------------------------------------------------------------
  *
- * FirstChildOp --
+ * RestoreBinaryNode --
+ *
+ *	Reads a node record of a binary dump and creates the node,
+ *	its values and tags.  The stack holds the last node read at
+ *	each depth.
  *
  *---------------------------------------------------------------------- 
  */
-/*ARGSUSED*/
 static int
-FirstChildOp(
+RestoreBinaryNode(
     TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,			/* Not used. */
-    Tcl_Obj *CONST *objv)
+    BinaryReader *readerPtr,
+    RestoreData *dataPtr,
+    Blt_TreeNode **stackPtr,
+    int *nAllocPtr,
+    int *topPtr)
 {
-    Blt_TreeNode node;
-    int inode;
+    Tcl_Interp *interp = cmdPtr->interp;
+    BinaryString *stringPtr;
+    Blt_TreeNode node, parent;
+    Tcl_Obj *valueObjPtr;
+    char *label;
+    int depth, inode, nValues, nTags, result, i;
 
-    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+    if ((BinGetInt(readerPtr, &depth) != TCL_OK) ||
+	(BinGetInt(readerPtr, &inode) != TCL_OK) ||
+	(BinGetStringRef(readerPtr, &readerPtr->labels, &stringPtr) 
+	 != TCL_OK)) {
 	return TCL_ERROR;
     }
-    inode = -1;
-    node = Blt_TreeFirstChild(node);
-    if (node != NULL) {
-	inode = Blt_TreeNodeId(node);
+    label = (stringPtr != NULL) ? stringPtr->string : 
+	Tcl_DStringValue(&readerPtr->inlineStr);
+    if ((depth == 0) != (*topPtr < 0)) {
+	return BinCorrupt(readerPtr, "misplaced top node");
+    }
+    if (depth > *topPtr + 1) {
+	return BinCorrupt(readerPtr, "node depth skips a level");
+    }
+    if (depth == 0) {
+	node = dataPtr->root;
+	Blt_TreeRelabelNode(cmdPtr->tree, node, label);
+    } else {
+	parent = (*stackPtr)[depth - 1];
+	node = NULL;
+	if (dataPtr->flags & RESTORE_OVERWRITE) {
+	    node = Blt_TreeFindChild(parent, label);
+	}
+	if ((node == NULL) && (Blt_TreeGetNode(cmdPtr->tree, inode) == NULL)) {
+	    /* Keep the node's id if it's not in use. */
+	    node = Blt_TreeCreateNodeWithId(cmdPtr->tree, parent, label, 
+		inode, -1);
+	} else if (node == NULL) {
+	    node = Blt_TreeCreateNode(cmdPtr->tree, parent, label, -1);
+	}
+	if (node == NULL) {
+	    return TCL_ERROR;
+	}
+    }
+    if (depth >= *nAllocPtr) {
+	*nAllocPtr = (*nAllocPtr == 0) ? 64 : *nAllocPtr * 2;
+	*stackPtr = Blt_Realloc(*stackPtr, *nAllocPtr * sizeof(Blt_TreeNode));
+	assert(*stackPtr);
+    }
+    (*stackPtr)[depth] = node;
+    *topPtr = depth;
+
+    if (BinGetInt(readerPtr, &nValues) != TCL_OK) {
+	goto error;
+    }
+    for (i = 0; i < nValues; i++) {
+	if (BinGetStringRef(readerPtr, &readerPtr->keys, &stringPtr) 
+	    != TCL_OK) {
+	    goto error;
+	}
+	if (stringPtr == NULL) {
+	    BinCorrupt(readerPtr, "key not interned");
+	    goto error;
+	}
+	if (BinGetValue(readerPtr, &valueObjPtr) != TCL_OK) {
+	    goto error;
+	}
+	if (stringPtr->keep < 0) {
+	    stringPtr->keep = KeepKey(dataPtr, stringPtr->string);
+	    stringPtr->plain = (strchr(stringPtr->string, '(') == NULL);
+	    stringPtr->key = Blt_TreeKeyGet(NULL, cmdPtr->tree->treeObject,
+		stringPtr->string);
+	}
+	Tcl_IncrRefCount(valueObjPtr);
+	result = TCL_OK;
+	if (stringPtr->keep) {
+	    if ((stringPtr->plain) && 
+		((node->flags & TREE_NODE_FIXED_FIELDS) == 0)) {
+		result = Blt_TreeSetValueByKey(interp, cmdPtr->tree, node, 
+			stringPtr->key, valueObjPtr);
+	    } else {
+		result = Blt_TreeSetValue(interp, cmdPtr->tree, node, 
+			stringPtr->string, valueObjPtr);
+	    }
+	}
+	Tcl_DecrRefCount(valueObjPtr);
+	if (result != TCL_OK) {
+	    goto error;
+	}
+    }
+    if (BinGetInt(readerPtr, &nTags) != TCL_OK) {
+	goto error;
+    }
+    for (i = 0; i < nTags; i++) {
+	if (BinGetStringRef(readerPtr, &readerPtr->tags, &stringPtr) 
+	    != TCL_OK) {
+	    goto error;
+	}
+	if (stringPtr == NULL) {
+	    BinCorrupt(readerPtr, "tag not interned");
+	    goto error;
+	}
+	if (dataPtr->flags & RESTORE_NO_TAGS) {
+	    continue;
+	}
+	if (stringPtr->keep < 0) {
+	    stringPtr->keep = KeepTag(dataPtr, stringPtr->string);
+	}
+	if ((stringPtr->keep) && 
+	    (AddTag(cmdPtr, node, stringPtr->string) != TCL_OK)) {
+	    goto error;
+	}
+    }
+    for (i = 0; i < dataPtr->tobjc; i++) {
+        if (AddTag(cmdPtr, node, Tcl_GetString(dataPtr->tobjv[i])) != TCL_OK) {
+	    goto error;
+        }
+    }
+    if (Blt_TreeInsertPost(cmdPtr->tree, node) == NULL) {
+	goto error;
     }
-    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
     return TCL_OK;
+ error:
+    if (depth > 0) {
+	DeleteNode(cmdPtr, node);
+    }
+    return TCL_ERROR;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * GetOp --
+ * RestoreBinary --
+ *
+ *	Restores a binary dump into the subtree at root.  The dump is
+ *	read from the channel in chunks, or directly from the bytes
+ *	of the -data object.
  *
  *---------------------------------------------------------------------- 
  */
 static int
-GetOp(
-    TreeCmd *cmdPtr, 
-    Tcl_Interp *interp, 
-    int objc, 
-    Tcl_Obj *CONST *objv)
-{
-    Blt_TreeNode node;
-
-    if (objc>2) {
-        if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
-            return TCL_ERROR;
-        }
+RestoreBinary(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    Tcl_Channel channel,
+    RestoreData *dataPtr)
+{
+    BinaryReader reader;
+    Blt_TreeNode *stack;
+    Tcl_WideUInt version, flags;
+    char *bytes;
+    int result, type, nAlloc, top;
+
+    memset(&reader, 0, sizeof(reader));
+    reader.interp = interp;
+    reader.channel = channel;
+    Tcl_DStringInit(&reader.scratch);
+    Tcl_DStringInit(&reader.inlineStr);
+    if (channel != NULL) {
+	reader.chunk = Blt_Malloc(BINDUMP_CHUNK);
+	assert(reader.chunk);
+	reader.pos = reader.end = reader.chunk;
     } else {
-        node = Blt_TreeRootNode(cmdPtr->tree);
+	int length;
+
+	reader.pos = Tcl_GetByteArrayFromObj(dataPtr->data, &length);
+	reader.end = reader.pos + length;
     }
-    if (Blt_TreeNotifyGet(cmdPtr->tree, node) != TCL_OK) {
-        return TCL_ERROR;
+    stack = NULL;
+    nAlloc = 0;
+    top = -1;
+    result = TCL_ERROR;
+    if ((BinGetBytes(&reader, BINDUMP_MAGIC_LEN, &bytes) != TCL_OK) ||
+	(strncmp(bytes, BINDUMP_MAGIC, BINDUMP_MAGIC_LEN) != 0)) {
+	Tcl_ResetResult(interp);
+	Tcl_AppendResult(interp, "not a binary tree dump", (char *)NULL);
+	goto done;
     }
-    if (objc <= 3) {
-	Blt_TreeKey key;
-	Tcl_Obj *valueObjPtr, *listObjPtr;
-	Blt_TreeKeySearch cursor;
-
-	/* Add the key-value pairs to a new Tcl_Obj */
-	listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
-	for (key = Blt_TreeFirstKey(cmdPtr->tree, node, &cursor); key != NULL; 
-	     key = Blt_TreeNextKey(cmdPtr->tree, &cursor)) {
-	    if (Blt_TreeGetValue((Tcl_Interp *)NULL, cmdPtr->tree, node, key,
-				 &valueObjPtr) == TCL_OK) {
-		Tcl_Obj *objPtr;
-
-		objPtr = Tcl_NewStringObj(key, -1);
-		Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
-		Tcl_ListObjAppendElement(interp, listObjPtr, valueObjPtr);
-	    }
-	}	    
-	Tcl_SetObjResult(interp, listObjPtr);
-	return TCL_OK;
-    } else {
-	Tcl_Obj *valueObjPtr;
-	char *string;
-
-	string = Tcl_GetString(objv[3]); 
-	if (Blt_TreeGetValue((Tcl_Interp *)NULL, cmdPtr->tree, node, string,
-		     &valueObjPtr) != TCL_OK) {
-	    if (objc == 4) {
-		Tcl_DString dString;
-		char *path;
-
-		Tcl_DStringInit(&dString);
-		path = (cmdPtr->tree == NULL ? "" : GetNodePath(cmdPtr, Blt_TreeRootNode(cmdPtr->tree), node, FALSE, &dString));		
-		Tcl_AppendResult(interp, "can't find field \"", string, 
-			"\" in \"", path, "\"", (char *)NULL);
-		Tcl_DStringFree(&dString);
-		return TCL_ERROR;
-	    } 
-	    /* Default to given value */
-	    valueObjPtr = objv[4];
-	} 
-	Tcl_SetObjResult(interp, valueObjPtr);
+    if (BinGetVarint(&reader, &version) != TCL_OK) {
+	goto done;
     }
-    return TCL_OK;
+    if ((version == 0) || (version > BINDUMP_VERSION)) {
+	Tcl_AppendResult(interp, "unsupported binary dump version \"", 
+		Blt_Itoa((int)version), "\"", (char *)NULL);
+	goto done;
+    }
+    if (BinGetVarint(&reader, &flags) != TCL_OK) {
+	goto done;
+    }
+    for (;;) {
+	reader.nRecords++;
+	if (BinGetByte(&reader, &type) != TCL_OK) {
+	    break;
+	}
+	if (type == 'E') {
+	    result = TCL_OK;
+	    break;
+	}
+	if (type != 'N') {
+	    BinCorrupt(&reader, "unknown record type");
+	    break;
+	}
+	if (RestoreBinaryNode(cmdPtr, &reader, dataPtr, &stack, &nAlloc, 
+		&top) != TCL_OK) {
+	    break;
+	}
+    }
+ done:
+    if (stack != NULL) {
+	Blt_Free(stack);
+    }
+    if (reader.chunk != NULL) {
+	Blt_Free(reader.chunk);
+    }
+    FreeBinaryStringTable(&reader.keys);
+    FreeBinaryStringTable(&reader.labels);
+    FreeBinaryStringTable(&reader.tags);
+    Tcl_DStringFree(&reader.scratch);
+    Tcl_DStringFree(&reader.inlineStr);
+    return result;
 }
 
+/*
+ * Channel options changed by the binary format.  Setting
+ * -translation to binary also resets -encoding and -eofchar.
+ */
+#define NUM_BINARY_OPTIONS	3
+static CONST char *binaryChannelOptions[NUM_BINARY_OPTIONS] = {
+    "-translation", "-encoding", "-eofchar"
+};
+
 /*
  *----------------------------------------------------------------------
  *
- * IndexOp --
+ * SetBinaryChannel --
+ *
+ *	Puts a channel passed by the caller into binary mode for the
+ *	binary format, saving the options that are changed so that
+ *	RestoreChannel can put them back.  RestoreChannel must be
+ *	called even if an error is returned.
  *
  *---------------------------------------------------------------------- 
  */
-/*ARGSUSED*/
 static int
-IndexOp(
-    TreeCmd *cmdPtr,
+SetBinaryChannel(
     Tcl_Interp *interp,
-    int objc,			/* Not used. */
-    Tcl_Obj *CONST *objv)
+    Tcl_Channel channel,
+    Tcl_DString *savedArr)	/* Array of saved options, one per
+				 * binaryChannelOptions. */
 {
-    Blt_TreeNode node;
-    int inode;
-
-    inode = -1;
-    if (GetNode(cmdPtr, objv[2], &node) == TCL_OK) {
-	inode = Blt_TreeNodeId(node);
-    } else {
-	register int i;
-	int nObjs;
-	Tcl_Obj **objArr;
-	Blt_TreeNode parent;
-	char *string;
+    int i;
 
-	if (Tcl_ListObjGetElements(interp, objv[2], &nObjs, &objArr) 
-	    != TCL_OK) {
-	    goto done;		/* Can't split object. */
+    for (i = 0; i < NUM_BINARY_OPTIONS; i++) {
+	Tcl_DStringInit(savedArr + i);
+    }
+    for (i = 0; i < NUM_BINARY_OPTIONS; i++) {
+	if (Tcl_GetChannelOption(interp, channel, binaryChannelOptions[i], 
+		savedArr + i) != TCL_OK) {
+	    return TCL_ERROR;
 	}
-	parent = Blt_TreeRootNode(cmdPtr->tree);
-	for (i = 0; i < nObjs; i++) {
-	    string = Tcl_GetString(objArr[i]);
-	    if (string[0] == '\0') {
-		continue;
-	    }
-	    node = Blt_TreeFindChild(parent, string);
-	    if (node == NULL) {
-		goto done;	/* Can't find component */
-	    }
-	    parent = node;
+    }
+    return Tcl_SetChannelOption(interp, channel, "-translation", "binary");
+}
+
+static void
+RestoreChannel(Tcl_Channel channel, Tcl_DString *savedArr)
+{
+    int i;
+
+    for (i = 0; i < NUM_BINARY_OPTIONS; i++) {
+	/* An empty -eofchar is also what binary mode sets. */
+	if (Tcl_DStringLength(savedArr + i) > 0) {
+	    Tcl_SetChannelOption((Tcl_Interp *)NULL, channel, 
+		binaryChannelOptions[i], Tcl_DStringValue(savedArr + i));
 	}
-	inode = Blt_TreeNodeId(node);
+	Tcl_DStringFree(savedArr + i);
     }
- done:
-    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
-    return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * InsertOp --
+ * DumpOp --
  *
  *---------------------------------------------------------------------- 
  */
-
+/*ARGSUSED*/
 static int
-InsertOp(
+DumpOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
-    int objc,
+    int objc,			/* Not used. */
     Tcl_Obj *CONST *objv)
 {
-    Blt_TreeNode parent, child;
-    InsertData data;
-    int inode, dobjc, tobjc, pobjc, nobjc, vobjc, i;
-    Tcl_Obj **dobjv, **pobjv, **tobjv, **nobjv, **vobjv;
+    Blt_TreeNode top;
+    Tcl_Channel channel = NULL;
+    Tcl_DString dString;
+    int result, isfile = 0, op, tags, doTbl = 0;
+    register Blt_TreeNode node;
+    RestoreData data;
+    
+    memset((char *)&data, 0, sizeof(data));
 
-    child = NULL;
-    /*if (!strcmp(Tcl_GetString(objv[2]), "end")) {
-        parent = Blt_TreeRootNode(cmdPtr->tree);
-    } else*/
-    if (GetNode(cmdPtr, objv[2], &parent) != TCL_OK) {
+    if (GetNode(cmdPtr, objv[2], &top) != TCL_OK) {
 	return TCL_ERROR;
     }
-    /* Initialize switch flags */
-    memset(&data, 0, sizeof(data));
-    data.insertPos = -1;	/* Default to append node. */
-    data.parent = parent;
-    data.inode = -1;
-
-    if (Blt_ProcessObjSwitches(interp, insertSwitches, objc - 3, objv + 3, 
-	     (char *)&data, BLT_SWITCH_EXACT) < 0) {
-	goto error;
-    }
-    if (data.tags != NULL) {
-        if (Tcl_ListObjGetElements(interp, data.tags, &pobjc, &pobjv) 
-        != TCL_OK) {
-            goto error;		/* Can't split object. */
+    if (objc > 3) {
+        /* Process switches  */
+        if (Blt_ProcessObjSwitches(interp, dumpSwitches, objc - 3, objv + 3, 
+            (char *)&data, BLT_SWITCH_EXACT) < 0) {
+            return TCL_ERROR;
         }
     }
-    if (data.tags2 != NULL) {
-        if (Tcl_ListObjGetElements(interp, data.tags2, &tobjc, &tobjv) 
-        != TCL_OK) {
-            goto error;		/* Can't split object. */
-        }
-    }
-    if (data.dataPairs != NULL) {
-        if (Tcl_ListObjGetElements(interp, data.dataPairs, &dobjc, &dobjv) 
-            != TCL_OK) {
-            goto error;		/* Can't split object. */
-        }
-        if (dobjc%2) {
-            Tcl_AppendResult(interp, "-data must have an even number of values",0);
-            goto error;
-        }
-        if (data.names != NULL || data.values != NULL) {
-            Tcl_AppendResult(interp, "-data incompatible with -names/-values",0);
-            goto error;
-        }
-    }
-    if (data.names != NULL) {
-        if (Tcl_ListObjGetElements(interp, data.names, &nobjc, &nobjv) 
-        != TCL_OK) {
-            goto error;		/* Can't split object. */
-        }
-        if (data.dataPairs != NULL) {
-            Tcl_AppendResult(interp, "-data incompatible with -names/-values",0);
-            goto error;
-        }
-        if (data.values == NULL) {
-            Tcl_AppendResult(interp, "-names must be used with -values",0);
-            goto error;
-        }
+    tags = ((data.flags&RESTORE_NO_TAGS) == 0);
+    if (data.file != NULL && data.chan != NULL) {
+        Tcl_AppendResult(interp, "can not use both -file and -channel", 0);
+        return TCL_ERROR;
     }
-    if (data.values != NULL) {
-        if (Tcl_ListObjGetElements(interp, data.values, &vobjc, &vobjv) 
-        != TCL_OK) {
-            goto error;		/* Can't split object. */
+    if (data.file != NULL) {
+        if (Tcl_IsSafe(interp)) {
+            Tcl_AppendResult(interp, "can use -file in safe interp", 0);
+            return TCL_ERROR;
         }
-        if (data.dataPairs != NULL) {
-            Tcl_AppendResult(interp, "-data incompatible with -names/-values",0);
-            goto error;
+        channel = Tcl_OpenFileChannel(interp, data.file, "w", 0644);
+        if (channel == NULL) {
+            return TCL_ERROR;
         }
-        if (data.names == NULL) {
-            Tcl_AppendResult(interp, "-values must be used with -names",0);
-            goto error;
+        isfile = 1;
+    } else if (data.chan != NULL) {
+        op = 0;
+        channel = Tcl_GetChannel(interp, data.chan, &op);
+        if (channel == NULL) {
+            return TCL_ERROR;
         }
-        if (vobjc != nobjc) {
-            Tcl_AppendResult(interp, "-values and -names must be the same length",0);
-            goto error;
+        if ((op & TCL_WRITABLE) == 0) {
+            Tcl_AppendResult(interp, "channel is not writable", 0);
+            return TCL_ERROR;
         }
     }
-    if (data.inode > 0) {
-	Blt_TreeNode node;
-
-	node = Blt_TreeGetNode(cmdPtr->tree, data.inode);
-	if (node != NULL) {
-	    Tcl_AppendResult(interp, "can't reissue node id \"", 
-		Blt_Itoa(data.inode), "\": already exists.", (char *)NULL);
-	    goto error;
-	}
-	child = Blt_TreeCreateNodeWithId(cmdPtr->tree, parent, data.label, 
-		data.inode, data.insertPos);
-    } else {
-	child = Blt_TreeCreateNode(cmdPtr->tree, parent, data.label, 
-		data.insertPos);
+    if (data.keys != NULL && Tcl_ListObjGetElements(interp, data.keys, &data.kobjc,
+        &data.kobjv) != TCL_OK) {
+        return TCL_ERROR;
     }
-    if (child == NULL) {
-	Tcl_AppendResult(interp, "can't allocate new node", (char *)NULL);
-	goto error;
+    if (data.notKeys != NULL && Tcl_ListObjGetElements(interp, data.notKeys,
+        &data.nobjc, &data.nobjv) != TCL_OK) {
+        return TCL_ERROR;
     }
-    inode = child->inode;
-    if (data.label == NULL) {
-	char string[200];
+    /*if (data.keys != NULL && data.notKeys != NULL) {
+        Tcl_AppendResult(interp, "can not use both -keys and -notkeys", 0);
+        return TCL_ERROR;
+    }*/
 
-	sprintf(string, "%d", Blt_TreeNodeId(child));
-	Blt_TreeRelabelNode2(child, string);
-    } 
-    if (data.tags != NULL) {
+    if (data.flags & RESTORE_BINARY) {
+	Tcl_DString saved[NUM_BINARY_OPTIONS];
 
-         for (i=0; i<pobjc; i++) {
-	    if (AddTag(cmdPtr, child, Tcl_GetString(pobjv[i])) != TCL_OK) {
-		goto error;
-	    }
+	if (isfile) {
+	    result = Tcl_SetChannelOption(interp, channel, "-translation", 
+		"binary");
+	} else if (channel != NULL) {
+	    result = SetBinaryChannel(interp, channel, saved);
+	} else {
+	    result = TCL_OK;
+	}
+	if (result == TCL_OK) {
+	    result = DumpBinary(cmdPtr, interp, top, channel, &data);
+	}
+        if (isfile) {
+            Tcl_Close(interp, channel);
+        } else if (channel != NULL) {
+	    RestoreChannel(channel, saved);
 	}
+	return result;
     }
-    if (data.dataPairs != NULL) {
-	char *key;
-
-	for (i=0; i<dobjc; i += 2) {
-	    key = Tcl_GetString(dobjv[i]);
-            if (Blt_TreeSetValue(interp, cmdPtr->tree, child, key, dobjv[i+1]) 
-		!= TCL_OK) {
-		goto error;
-	    }
-         }
-    } else if (data.names != NULL) {
-        char *key;
-
-        for (i=0; i<nobjc; i++) {
-            key = Tcl_GetString(nobjv[i]);
-            if (Blt_TreeSetValue(interp, cmdPtr->tree, child, key, vobjv[i]) 
-            != TCL_OK) {
-                goto error;
-            }
-        }
+    if (tags && top->nChildren>0) {
+        doTbl = 1;
+        MakeTagTable(cmdPtr->tree, &data.tagTable, data.tags, data.notTags);
     }
-    if (data.tags2 != NULL) {
-         for (i=0; i<tobjc; i++) {
-	    if (AddTag(cmdPtr, child, Tcl_GetString(tobjv[i])) != TCL_OK) {
-                goto error;
+    result = TCL_OK;
+    Tcl_DStringInit(&dString);
+    if (channel != NULL) {
+        int cnt = 1;
+        for (node = top; node != NULL && cnt > 0; node = Blt_TreeNextNode(top, node)) {
+            PrintNode(cmdPtr, top, node, &dString, tags, &data);
+            if (Tcl_DStringLength(&dString) >= 4096) {
+                cnt = Tcl_Write(channel, Tcl_DStringValue(&dString), -1);
+                Tcl_DStringSetLength(&dString, 0);
             }
         }
+        if (cnt > 0 && Tcl_DStringLength(&dString) > 0) {
+            cnt = Tcl_Write(channel, Tcl_DStringValue(&dString), -1);
+        }
+        Tcl_DStringFree(&dString);
+        if (isfile) {
+            Tcl_Close(interp, channel);
+        }
+        if (cnt <= 0) {
+            result = TCL_ERROR;
+        }
+    } else {
+        for (node = top; node != NULL; node = Blt_TreeNextNode(top, node)) {
+            PrintNode(cmdPtr, top, node, &dString, tags, &data);
+        }
+        Tcl_DStringResult(interp, &dString);
     }
-    if (Blt_TreeInsertPost(cmdPtr->tree, child) == NULL) {
-        goto error;
+    if (doTbl) {
+        FreeTagTable(&data.tagTable);
     }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ExistsOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+ExistsOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode node;
+    int bool;
     
-    if (data.fixed || (cmdPtr->tree->treeObject->flags & TREE_FIXED_KEYS)) {
-        child->flags |= TREE_NODE_FIXED_FIELDS;
+    bool = TRUE;
+    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+	bool = FALSE;
+    } else if (objc == 4) { 
+	char *string;
+	
+	string = Tcl_GetString(objv[3]);
+	if (!Blt_TreeValueExists(cmdPtr->tree, node, 
+			     string)) {
+	    bool = FALSE;
+	}
+    } 
+    Tcl_SetObjResult(interp, Tcl_NewBooleanObj(bool));
+    return TCL_OK;
+}
+
+static int
+ComparePreorder(Blt_TreeNode *n1Ptr, Blt_TreeNode *n2Ptr)
+{
+    if (*n1Ptr == *n2Ptr) {
+	return 0;
     }
+    return (Blt_TreeIsBefore(*n1Ptr, *n2Ptr)) ? -1 : 1;
+}
 
-    Blt_FreeSwitches(interp, insertSwitches, (char *)&data, 0);
-    Tcl_SetIntObj(Tcl_GetObjResult(interp), Blt_TreeNodeId(child));
-    return TCL_OK;
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindIndexedNodes --
+ *
+ *	Uses the index of a key to look up the candidates of a find
+ *	matching the key's value exactly (-key or -column with -name,
+ *	-exact or -inlist).  The candidates are the nodes under the
+ *	start node whose value may match, in preorder.  They still
+ *	have to be checked with MatchNodeProc.
+ *
+ * Results:
+ *	Returns the number of candidates, or -1 if the search can't
+ *	use an index.  The ids of the candidates are left in inodesPtr
+ *	and must be freed with Blt_Free.  Ids rather than nodes are
+ *	returned, since a -command or -exec may delete nodes.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+FindIndexedNodes(
+    TreeCmd *cmdPtr,
+    FindData *dataPtr,
+    Blt_TreeNode top,
+    unsigned int **inodesPtr)
+{
+    Blt_TreeKey key;
+    Blt_TreeNode *nodes, *found;
+    Tcl_Obj **objv;
+    char *keyName;
+    unsigned int *inodes;
+    int objc, nNodes, nFound, i, j, type;
+
+    *inodesPtr = NULL;
+    type = (dataPtr->flags & PATTERN_MASK);
+    if ((dataPtr->name == NULL) || (dataPtr->nodesObj != NULL) ||
+	(dataPtr->order != TREE_PREORDER) || 
+	(dataPtr->flags & (MATCH_NOCASE|MATCH_INVERT|MATCH_ISNULL)) ||
+	((type != PATTERN_NONE) && (type != PATTERN_EXACT) && 
+	 (type != PATTERN_INLIST))) {
+	return -1;
+    }
+    if (dataPtr->subKey != NULL) {
+	keyName = dataPtr->subKey;
+	if (strchr(keyName, '(') != NULL) {
+	    return -1;		/* Array element */
+	}
+    } else if (dataPtr->keyList != NULL) {
+	Blt_ListNode listNode;
 
- error:
-    if (child != NULL) {
-        child = Blt_TreeGetNode(cmdPtr->tree, inode);
+	listNode = Blt_ListFirstNode(dataPtr->keyList);
+	if ((Blt_ListNextNode(listNode) != NULL) || 
+	    ((intptr_t)Blt_ListGetValue(listNode) != PATTERN_EXACT) ||
+	    (dataPtr->flags & MATCH_ARRAY)) {
+	    return -1;
+	}
+	keyName = (char *)Blt_ListGetKey(listNode);
+    } else {
+	return -1;
     }
-    if (child != NULL) {
-	DeleteNode(cmdPtr, child);
+    key = Blt_TreeKeyGet(NULL, cmdPtr->tree->treeObject, keyName);
+    if (type == PATTERN_INLIST) {
+	if (Tcl_ListObjGetElements(NULL, dataPtr->name, &objc, &objv) 
+	    != TCL_OK) {
+	    return -1;
+	}
+    } else {
+	objc = 1, objv = &dataPtr->name;
     }
-    Blt_FreeSwitches(interp, insertSwitches, (char *)&data, 0);
-    return TCL_ERROR;
+    nodes = NULL;
+    nNodes = 0;
+    for (i = 0; i < objc; i++) {
+	nFound = Blt_TreeKeyIndexFind(cmdPtr->tree, key, 
+		Tcl_GetString(objv[i]), &found);
+	if (nFound < 0) {
+	    return -1;		/* Key isn't indexed. */
+	}
+	if (nFound == 0) {
+	    continue;
+	}
+	nodes = Blt_Realloc(nodes, (nNodes + nFound) * sizeof(Blt_TreeNode));
+	assert(nodes);
+	for (j = 0; j < nFound; j++) {
+	    if ((found[j] == top) || (Blt_TreeIsAncestor(top, found[j]))) {
+		nodes[nNodes++] = found[j];
+	    }
+	}
+	Blt_Free(found);
+    }
+    if (nNodes > 1) {
+	qsort((char *)nodes, nNodes, sizeof(Blt_TreeNode), 
+	      (QSortCompareProc *)ComparePreorder);
+	/* Values in an -inlist can find the same node twice. */
+	for (i = j = 1; i < nNodes; i++) {
+	    if (nodes[i] != nodes[j - 1]) {
+		nodes[j++] = nodes[i];
+	    }
+	}
+	nNodes = j;
+    }
+    inodes = NULL;
+    if (nNodes > 0) {
+	inodes = Blt_Malloc(nNodes * sizeof(unsigned int));
+	assert(inodes);
+	for (i = 0; i < nNodes; i++) {
+	    inodes[i] = Blt_TreeNodeId(nodes[i]);
+	}
+    }
+    if (nodes != NULL) {
+	Blt_Free(nodes);
+    }
+    *inodesPtr = inodes;
+    return nNodes;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * CreateOp --
+ * FindOp --
  *
  *---------------------------------------------------------------------- 
  */
-
 static int
-CreateOp(
+FindOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *CONST *objv)
 {
-    Blt_TreeNode parent = NULL, child = NULL;
-    int cnt = 0, i, n, m, vobjc, tobjc, dobjc, pobjc, optInd, iPos = -1, incr = 0;
-    int hasoffs = 0, seqlabel = 0, seqVal = 0, hasstart = 0, start;
-    int fixed = 0, hcnt = 0;
-    char *prefix = NULL, *string;
-    Tcl_Obj **vobjv = NULL;
-    Tcl_Obj **tobjv = NULL;
-    Tcl_Obj **dobjv = NULL;
-    Tcl_Obj **pobjv = NULL;
+    Blt_TreeNode node, child;
+    FindData data;
+    unsigned int *indexed;
+    int result, nIndexed;
+    Tcl_Obj **objArr;
 
-    enum optInd {
-        OP_DATA, OP_FIXED, OP_SEQLABEL, OP_NODES, OP_NUM, OP_OFFSET,
-        OP_PARENT, OP_PATH, OP_POS, OP_PREFIX, OP_START, OP_TAGS
-    };
-    static char *optArr[] = {
-        "-data", "-fixed", "-labelstart", "-nodes", "-num", "-offset",
-        "-parent", "-path", "-pos", "-prefix", "-start", "-tags",
-        0
-    };
+   /* if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+	return TCL_ERROR;
+    }*/
+    memset(&data, 0, sizeof(data));
+    data.cmdPtr = cmdPtr;
+    data.startNode = node = Blt_TreeRootNode(cmdPtr->tree);
+    data.maxDepth = -1;
+    data.minDepth = -1;
+    data.depth = -1;
+    data.keyCount = -1;
+    data.flags = 0;
+    data.order = TREE_PREORDER;
+    objArr = NULL;
 
-    i = 1;
-    
-    string = Tcl_GetString(objv[2]);
-    while (objc>=3 && string[0] == '-') {
-        if (Tcl_GetIndexFromObj(interp, objv[2], optArr, "option",
-            0, &optInd) != TCL_OK) {
-                return TCL_ERROR;
-        }
-        switch (optInd) {
-        
-        case OP_POS:
-            if (objc<4) { goto missingArg; }
-            if (Tcl_GetIntFromObj(interp, objv[3], &iPos) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            objc -= 2;
-            objv += 2;
-            break;
-        case OP_DATA:
-            if (objc<4) { goto missingArg; }
-            if (Tcl_ListObjGetElements(interp, objv[3], &dobjc, &dobjv) 
-                != TCL_OK) {
-                return TCL_ERROR;		/* Can't split object. */
-            }
-            if (dobjc%2) {
-                Tcl_AppendResult(interp, "data must have even length", (char *)NULL);
-                return TCL_ERROR;
-            }
-            objc -= 2;
-            objv += 2;
-            break;
-        case OP_FIXED:
-            fixed = 1;
-            objc -= 1;
-            objv += 1;
-            break;
-        case OP_SEQLABEL:
-            if (objc<4) { goto missingArg; }
-            if (Tcl_GetIntFromObj(interp, objv[3], &seqVal) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            objc -= 2;
-            objv += 2;
-            seqlabel = 1;
-            break;
-        case OP_OFFSET:
-            if (objc<4) { goto missingArg; }
-            if (Tcl_GetIntFromObj(interp, objv[3], &incr) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            hasoffs = 1;
-            objc -= 2;
-            objv += 2;
-            break;
-        case OP_NUM:
-            if (objc<4) { goto missingArg; }
-            if (Tcl_GetIntFromObj(interp, objv[3], &cnt) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            hcnt++;
-            if (cnt<0 || cnt>10000000) {
-                Tcl_AppendResult(interp, "count must be >= 0 and <= 10M", (char *)NULL);
-                return TCL_ERROR;
-            }
-            objc -= 2;
-            objv += 2;
-            break;
-        case OP_NODES:
-            hcnt++;
-            if (objc<4) { goto missingArg; }
-            if (Tcl_ListObjGetElements(interp, objv[3], &vobjc, &vobjv) 
-                != TCL_OK) {
-                return TCL_ERROR;		/* Can't split object. */
-            }
-            for (i=0; i<vobjc; i++)  {
-                if (Tcl_GetIntFromObj(interp, vobjv[i], &n)) {
-                    return TCL_ERROR;
-                }
-            }
-            objc -= 2;
-            objv += 2;
-            break;
-        case OP_PARENT:
-            if (objc<4) { goto missingArg; }
-            if (GetNode(cmdPtr, objv[3], &parent) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            objc -= 2;
-            objv += 2;
-            break;
-        case OP_PREFIX:
-            if (objc<4) { goto missingArg; }
-            prefix = Tcl_GetString(objv[3]);
-            objc -= 2;
-            objv += 2;
-            break;
-        case OP_PATH:
-            if (objc<4) { goto missingArg; }
-            hcnt++;
-            if (Tcl_ListObjGetElements(interp, objv[3], &pobjc, &pobjv) 
-                != TCL_OK) {
-                return TCL_ERROR;		/* Can't split object. */
-            }
-            objc -= 2;
-            objv += 2;
-            break;
-        case OP_START:
-            if (objc<4) { goto missingArg; }
-            if (Tcl_GetIntFromObj(interp, objv[3], &start) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            if (start<=0) {
-                Tcl_AppendResult(interp, "start must be > 0", (char *)NULL);
-                return TCL_ERROR;
-            }
-            hasstart = 1;
-            objc -= 2;
-            objv += 2;
-            break;
-        case OP_TAGS:
-            if (objc<4) { goto missingArg; }
-            if (Tcl_ListObjGetElements(interp, objv[3], &tobjc, &tobjv) 
-                != TCL_OK) {
-                return TCL_ERROR;		/* Can't split object. */
-            }
-            objc -= 2;
-            objv += 2;
-            break;
-        default:
+    /* Process switches  */
+    if (Blt_ProcessObjSwitches(interp, findSwitches, objc - 2, objv + 2, 
+		     (char *)&data, BLT_SWITCH_EXACT) < 0) {
+	return TCL_ERROR;
+    }
+    if (data.nodesObj != NULL) {
+        if (data.flags & MATCH_NOTOP) {
+            Tcl_AppendResult(interp, "-nodes can not use -notop", 0);
             return TCL_ERROR;
         }
     }
-    if (hcnt != 1) {
-        Tcl_AppendResult(interp, "must use exactly one of -nodes, -num or -path", 0);
+    if (data.execObj != NULL && data.command != NULL) {
+        Tcl_AppendResult(interp, "can not use both -command and -exec", 0);
         return TCL_ERROR;
     }
-    if (vobjv != NULL) {
-        cnt = vobjc;
+    if (data.execObj != NULL) {
+        data.eval = Tcl_GetString(data.execObj);
+    } else if (data.execVar != NULL) {
+        Tcl_AppendResult(interp, "-var must be used with -exec", 0);
+        return TCL_ERROR;
     }
-    if (pobjv != NULL) {
-        cnt = pobjc;
-        if (prefix != NULL) {
-            Tcl_AppendResult(interp, "-prefix is incompatible with -path", 0);
-            return TCL_ERROR;
-        }
-        if (seqlabel) {
-            Tcl_AppendResult(interp, "-labelstart is incompatible with -path", 0);
-            return TCL_ERROR;
-        }
-        if (parent != NULL) {
-            Tcl_AppendResult(interp, "-parent is incompatible with -path", 0);
+    if (data.startNode != NULL) {
+        node = data.startNode;
+        if (data.nodesObj != NULL) {
+            Tcl_AppendResult(interp, "-nodes can not use -top", 0);
             return TCL_ERROR;
         }
     }
-    if (hasoffs && vobjv == NULL) {
-        Tcl_AppendResult(interp, "must use -nodes with -offset", 0);
-        return TCL_ERROR;
+    if (data.keyList == NULL) {
+        if (data.flags & (MATCH_ARRAY)) {
+            Tcl_AppendResult(interp, "-array must be used with -key", 0);
+            result = TCL_ERROR;
+            goto done;
+        }
     }
+    if (data.retKey != NULL) {
 
-    if (parent == NULL) {
-         parent = Blt_TreeRootNode(cmdPtr->tree);
-    }
-    if (prefix == NULL) {
-        prefix = "";
+        if (data.flags & MATCH_COUNT) {
+            Tcl_AppendResult(interp, "can not use -return and -count", 0);
+            result = TCL_ERROR;
+            goto done;
+        }
+        if (data.eval != NULL) {
+            Tcl_AppendResult(interp, "can not use -return and -exec", 0);
+            result = TCL_ERROR;
+            goto done;
+        }
+        if (data.command != NULL) {
+            Tcl_AppendResult(interp, "can not use -return and -command", 0);
+            result = TCL_ERROR;
+            goto done;
+        }
+        if (data.retKey[0] == '%') {
+         } else if (Blt_TreeKeyGet(NULL, cmdPtr->tree->treeObject, data.retKey) != NULL) {
+            data.iskey = 1;
+         } else {
+             Tcl_AppendResult(interp, "-return is not a key or a percent subst", 0);
+             result = TCL_ERROR;
+             goto done;
+         }
     }
 
-    for (n = 0, m = 0; n<cnt; n++, i++)  {
-        char label[200];
-        char *labStr;
-        labStr = NULL;
-        if (vobjv != NULL) {
-            if (Tcl_GetIntFromObj(interp, vobjv[n], &i)) {
-                return TCL_ERROR;
-            }
-            i += incr;
+    if (data.flags & MATCH_RELDEPTH) {
+        int dep;
+        dep = Blt_TreeNodeDepth(cmdPtr->tree, node);
+        if (data.maxDepth >= 0) {
+            data.maxDepth += dep;
         }
-        if (pobjv != NULL) {
-            labStr = Tcl_GetString(pobjv[n]);
-            child = Blt_TreeFindChild( parent, labStr);
-            if (child != NULL) {
-                parent = child;
-                continue;
-            }
+        if (data.minDepth >= 0) {
+            data.minDepth += dep;
         }
-        if (vobjv != NULL) {
-            child = Blt_TreeCreateNodeWithId(cmdPtr->tree, parent, labStr, i, iPos);
-        } else if (hasstart) {
-            child = Blt_TreeCreateNodeWithId(cmdPtr->tree, parent, labStr, n+start, iPos);
-        } else {
-            child = Blt_TreeCreateNode(cmdPtr->tree, parent, labStr, iPos);
+        if (data.depth >= 0) {
+            data.depth += dep;
         }
-        if (child == NULL) {
-            return TCL_ERROR;
+    }
+    /*if (data.maxDepth >= 0) {
+	data.maxDepth += Blt_TreeNodeDepth(cmdPtr->tree, node);
+    }*/
+    /*if (data.flags & MATCH_NOCASE) {
+	Blt_ListNode listNode;
+
+	for (listNode = Blt_ListFirstNode(data.patternList); listNode != NULL;
+	     listNode = Blt_ListNextNode(listNode)) {
+	    strtolower((char *)Blt_ListGetKey(listNode));
+	}
+    }*/
+    if (data.name != NULL && (data.flags & (MATCH_ARRAY))) {
+        Tcl_AppendResult(interp, "-array must not be used with -name", 0);
+        result = TCL_ERROR;
+        goto done;
+    }
+    if (data.name == NULL && (data.flags & (PATTERN_REGEXP|PATTERN_GLOB|PATTERN_INLIST))) {
+        Tcl_AppendResult(interp, "must provide -name with -regexp -glob -inlist", 0);
+        result = TCL_ERROR;
+        goto done;
+    }
+    if ((data.flags & (MATCH_ISNULL))) {
+        if (data.subKey == NULL) {
+            Tcl_AppendResult(interp, "-isempty must be used with -column", 0);
+            result = TCL_ERROR;
+            goto done;
         }
-        if (pobjv != NULL) {
-            parent = child;
+        if (data.name != NULL) {
+            Tcl_AppendResult(interp, "-isempty can not be used with -name", 0);
+            result = TCL_ERROR;
+            goto done;
         }
-        if (labStr == NULL) {
-            if (!seqlabel) {
-                i = Blt_TreeNodeId(child);
-            } else {
-                i = n + seqVal;
-            }
-            if (prefix[0]) {
-                sprintf(label, "%.100s%d", prefix, i);
-            } else {
-                sprintf(label, "%d", i);
-            }
-            Blt_TreeRelabelNode2(child, label);
+        if ((data.flags & (MATCH_INVERT))) {
+            Tcl_AppendResult(interp, "-isempty can not be used with -invert", 0);
+            result = TCL_ERROR;
+            goto done;
         }
-        if (dobjv != NULL) {
-            int j;
-            Blt_TreeKey key;
-            for (j = 0; j<dobjc; j += 2) {
-                key = Tcl_GetString(dobjv[j]);
-                if (Blt_TreeSetValue(interp, cmdPtr->tree, child, key, dobjv[j+1]) 
-                != TCL_OK) {
-                    return TCL_ERROR;
-                }
-            }
+        if (data.retKey) {
+            Tcl_AppendResult(interp, "-isempty can not be used with -return", 0);
+            result = TCL_ERROR;
+            goto done;
         }
-        if (tobjv != NULL) {
-            int j;
-            for (j = 0; j<tobjc; j++) {
-                if (AddTag(cmdPtr, child, Tcl_GetString(tobjv[j])) != TCL_OK) {
-                    return TCL_ERROR;
-                }
-            }
+        if (data.command) {
+            Tcl_AppendResult(interp, "-isempty can not be used with -command", 0);
+            result = TCL_ERROR;
+            goto done;
         }
-        if (Blt_TreeInsertPost(cmdPtr->tree, child) == NULL) {
-            DeleteNode(cmdPtr, child);
+    }
+    if ((data.flags & PATTERN_MASK) == PATTERN_REGEXP) {
+        if (Tcl_RegExpMatch(interp, "", Tcl_GetString(data.name)) == -1) {
+            result = TCL_ERROR;
+            goto done;
+        }
+    }
+    if ((data.flags & PATTERN_MASK) == PATTERN_INLIST) {
+        int cobjc;
+        Tcl_Obj **cobjv;
+        if (Tcl_ListObjGetElements(interp, data.name,
+            &cobjc, &cobjv) != TCL_OK) {
+            result = TCL_ERROR;
+            goto done;
+        }
+    }
+    if (data.addTag != NULL) {
+        if (AddTag(cmdPtr, NULL, data.addTag) != TCL_OK) {
             return TCL_ERROR;
         }
-        if (fixed || (cmdPtr->tree->treeObject->flags & TREE_FIXED_KEYS)) {
-            child->flags |= TREE_NODE_FIXED_FIELDS;
+    }
+    if (data.command != NULL) {
+	int count, acnt;
+	char **p;
+	register int i;
+
+	count = 0;
+	acnt = 0;
+	for (p = data.command; *p != NULL; p++) {
+	    count++;
+	}
+        for (p = data.cmdArgs; *p != NULL; p++) {
+            
+            acnt++;
         }
-        m++;
+	/* Leave room for node Id argument to be appended */
+	objArr = Blt_Calloc(count + acnt + 2, sizeof(Tcl_Obj *));
+	for (i = 0; i < count; i++) {
+	    objArr[i] = Tcl_NewStringObj(data.command[i], -1);
+	    Tcl_IncrRefCount(objArr[i]);
+	}
+        objArr[i] = Tcl_NewStringObj("", -1);
+        Tcl_IncrRefCount(objArr[i]);
+        i++;
+        for (; i < (count+acnt+1); i++) {
+	    objArr[i] = Tcl_NewStringObj("", 0);
+	    Tcl_IncrRefCount(objArr[i]);
+	}
+	data.objv = objArr;
+	data.objc = count + 1;
+	data.argc = acnt;
+    } else if (data.cmdArgs != NULL) {
+        Tcl_AppendResult(interp, "-cmdargs must be used with -command", 0);
+        result = TCL_ERROR;
+        goto done;
     }
-    if (child != NULL) {
-        Tcl_AppendResult(interp, Blt_Itoa(Blt_TreeNodeId(child)), 0);
+    if (data.tagExpr != NULL) {
+	data.tagQuery = Blt_TreeCreateTagQuery(interp, cmdPtr->tree, 
+		Tcl_GetString(data.tagExpr));
+	if (data.tagQuery == NULL) {
+	    result = TCL_ERROR;
+	    goto done;
+	}
     }
-    return TCL_OK;
+    data.listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+    data.cmdPtr = cmdPtr;
+    CompileFind(cmdPtr, &data);
+    result = TCL_OK;
+    if (data.nodesObj != NULL) {
+        TagSearch tagIter = {0};
 
-missingArg:
-    Tcl_AppendResult(interp, "missing argument for populate option \"",
-        Tcl_GetString(objv[3]), "\"", (char *)NULL);
-    return TCL_ERROR;
-}
+        if (FindTaggedNodes(interp, cmdPtr, data.nodesObj, &tagIter) != TCL_OK) {
+            result = TCL_ERROR;
+            goto done;
+        }
+        for (child = FirstTaggedNode(&tagIter);
+            child != NULL && result == TCL_OK;
+            child = NextTaggedNode(child, &tagIter)) {
+            result = MatchNodeProc(child, &data, -1);
+        }
+        DoneTaggedNodes(&tagIter);
+        
+    } else if ((nIndexed = FindIndexedNodes(cmdPtr, &data, node, 
+		&indexed)) >= 0) {
+	int i;
 
-/*
- *----------------------------------------------------------------------
- *
- * IsAncestorOp --
- *
- *---------------------------------------------------------------------- 
- */
-/*ARGSUSED*/
-static int
-IsAncestorOp(
-    TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,			/* Not used. */
-    Tcl_Obj *CONST *objv)
-{
-    Blt_TreeNode node1, node2;
-    int bool;
+	for (i = 0; (i < nIndexed) && (result == TCL_OK); i++) {
+	    child = Blt_TreeGetNode(cmdPtr->tree, indexed[i]);
+	    if (child != NULL) {
+		result = MatchNodeProc(child, &data, TREE_PREORDER);
+	    }
+	}
+	if (indexed != NULL) {
+	    Blt_Free(indexed);
+	}
+    } else if (data.order == TREE_BREADTHFIRST) {
+	result = Blt_TreeApplyBFS(node, MatchNodeProc, &data);
+    } else {
+	result = Blt_TreeApplyDFS(node, MatchNodeProc, &data, data.order);
+    }
+    if (data.command != NULL) {
+	Tcl_Obj **objPtrPtr;
 
-    if ((GetNode(cmdPtr, objv[3], &node1) != TCL_OK) ||
-	(GetNode(cmdPtr, objv[4], &node2) != TCL_OK)) {
+	for (objPtrPtr = objArr; *objPtrPtr != NULL; objPtrPtr++) {
+	    Tcl_DecrRefCount(*objPtrPtr);
+	}
+	Blt_Free(objArr);
+    }
+done:
+    FreeCompiledFind(&data);
+    Blt_FreeSwitches(interp, findSwitches, (char *)&data, 0);
+    if (result == TCL_ERROR) {
 	return TCL_ERROR;
     }
-    bool = Blt_TreeIsAncestor(node1, node2);
-    Tcl_SetIntObj(Tcl_GetObjResult(interp), bool);
+    if (data.flags & MATCH_COUNT) {
+        Tcl_SetObjResult(interp, Tcl_NewIntObj(data.nMatches));
+    } else {
+        Tcl_SetObjResult(interp, data.listObjPtr);
+    }
     return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * IsBeforeOp --
+ * FindChildOp --
  *
  *---------------------------------------------------------------------- 
  */
 /*ARGSUSED*/
 static int
-IsBeforeOp(
+FindChildOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,			/* Not used. */
     Tcl_Obj *CONST *objv)
 {
-    Blt_TreeNode node1, node2;
-    int bool;
+    Blt_TreeNode node, child;
+    int inode;
 
-    if ((GetNode(cmdPtr, objv[3], &node1) != TCL_OK) ||
-	(GetNode(cmdPtr, objv[4], &node2) != TCL_OK)) {
+    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
 	return TCL_ERROR;
     }
-    bool = Blt_TreeIsBefore(node1, node2);
-    Tcl_SetIntObj(Tcl_GetObjResult(interp), bool);
+    inode = -1;
+    child = Blt_TreeFindChild(node, Tcl_GetString(objv[3]));
+    if (child != NULL) {
+	inode = Blt_TreeNodeId(child);
+    }
+    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
     return TCL_OK;
 }
 
+
 /*
  *----------------------------------------------------------------------
  *
- * IsLeafOp --
+ * FirstChildOp --
  *
  *---------------------------------------------------------------------- 
  */
 /*ARGSUSED*/
 static int
-IsLeafOp(
+FirstChildOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,			/* Not used. */
     Tcl_Obj *CONST *objv)
 {
     Blt_TreeNode node;
+    int inode;
 
-    if (GetNode(cmdPtr, objv[3], &node) != TCL_OK) {
+    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
 	return TCL_ERROR;
     }
-    Tcl_SetIntObj(Tcl_GetObjResult(interp), Blt_TreeIsLeaf(node));
+    inode = -1;
+    node = Blt_TreeFirstChild(node);
+    if (node != NULL) {
+	inode = Blt_TreeNodeId(node);
+    }
+    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
     return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * IsRootOp --
+ * GetOp --
  *
  *---------------------------------------------------------------------- 
  */
-/*ARGSUSED*/
 static int
-IsRootOp(
-    TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,			/* Not used. */
-    Tcl_Obj *CONST *objv)
-{
+GetOp(
+    TreeCmd *cmdPtr, 
+    Tcl_Interp *interp, 
+    int objc, 
+    Tcl_Obj *CONST *objv)
+{
     Blt_TreeNode node;
-    int bool;
 
-    if (GetNode(cmdPtr, objv[3], &node) != TCL_OK) {
-	return TCL_ERROR;
+    if (objc>2) {
+        if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+            return TCL_ERROR;
+        }
+    } else {
+        node = Blt_TreeRootNode(cmdPtr->tree);
+    }
+    if (Blt_TreeNotifyGet(cmdPtr->tree, node) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (objc <= 3) {
+	Blt_TreeKey key;
+	Tcl_Obj *valueObjPtr, *listObjPtr;
+	Blt_TreeKeySearch cursor;
+
+	/* Add the key-value pairs to a new Tcl_Obj */
+	listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+	for (key = Blt_TreeFirstKey(cmdPtr->tree, node, &cursor); key != NULL; 
+	     key = Blt_TreeNextKey(cmdPtr->tree, &cursor)) {
+	    if (Blt_TreeGetValue((Tcl_Interp *)NULL, cmdPtr->tree, node, key,
+				 &valueObjPtr) == TCL_OK) {
+		Tcl_Obj *objPtr;
+
+		objPtr = Tcl_NewStringObj(key, -1);
+		Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
+		Tcl_ListObjAppendElement(interp, listObjPtr, valueObjPtr);
+	    }
+	}	    
+	Tcl_SetObjResult(interp, listObjPtr);
+	return TCL_OK;
+    } else {
+	Tcl_Obj *valueObjPtr;
+	char *string;
+
+	string = Tcl_GetString(objv[3]); 
+	if (Blt_TreeGetValue((Tcl_Interp *)NULL, cmdPtr->tree, node, string,
+		     &valueObjPtr) != TCL_OK) {
+	    if (objc == 4) {
+		Tcl_DString dString;
+		char *path;
+
+		Tcl_DStringInit(&dString);
+		path = (cmdPtr->tree == NULL ? "" : GetNodePath(cmdPtr, Blt_TreeRootNode(cmdPtr->tree), node, FALSE, &dString));		
+		Tcl_AppendResult(interp, "can't find field \"", string, 
+			"\" in \"", path, "\"", (char *)NULL);
+		Tcl_DStringFree(&dString);
+		return TCL_ERROR;
+	    } 
+	    /* Default to given value */
+	    valueObjPtr = objv[4];
+	} 
+	Tcl_SetObjResult(interp, valueObjPtr);
     }
-    bool = (node == Blt_TreeRootNode(cmdPtr->tree));
-    Tcl_SetIntObj(Tcl_GetObjResult(interp), bool);
     return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * IsOp --
+ * IndexNodeOp --
+ *
+ *	Returns the id of the node given by id, tag or path of labels.
  *
  *---------------------------------------------------------------------- 
  */
-static Blt_OpSpec isOps[] =
+/*ARGSUSED*/
+static int
+IndexNodeOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,			/* Not used. */
+    Tcl_Obj *CONST *objv)
 {
-    {"ancestor", 1, (Blt_Op)IsAncestorOp, 5, 5, "node1 node2",},
-    {"before", 1, (Blt_Op)IsBeforeOp, 5, 5, "node1 node2",},
-    {"leaf", 1, (Blt_Op)IsLeafOp, 4, 4, "node",},
-    {"root", 1, (Blt_Op)IsRootOp, 4, 4, "node",},
-};
+    Blt_TreeNode node;
+    int inode;
 
-static int nIsOps = sizeof(isOps) / sizeof(Blt_OpSpec);
+    inode = -1;
+    if (GetNode(cmdPtr, objv[2], &node) == TCL_OK) {
+	inode = Blt_TreeNodeId(node);
+    } else {
+	register int i;
+	int nObjs;
+	Tcl_Obj **objArr;
+	Blt_TreeNode parent;
+	char *string;
+
+	if (Tcl_ListObjGetElements(interp, objv[2], &nObjs, &objArr) 
+	    != TCL_OK) {
+	    goto done;		/* Can't split object. */
+	}
+	parent = Blt_TreeRootNode(cmdPtr->tree);
+	for (i = 0; i < nObjs; i++) {
+	    string = Tcl_GetString(objArr[i]);
+	    if (string[0] == '\0') {
+		continue;
+	    }
+	    node = Blt_TreeFindChild(parent, string);
+	    if (node == NULL) {
+		goto done;	/* Can't find component */
+	    }
+	    parent = node;
+	}
+	inode = Blt_TreeNodeId(node);
+    }
+ done:
+    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
+    return TCL_OK;
+}
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * IndexCreateOp --
+ *
+ *	Creates an index of the values of a key.
+ *
+ *	.t index create key ?-type string|integer|real? ?-ordered?
+ *
+ *---------------------------------------------------------------------- 
+ */
+/*ARGSUSED*/
 static int
-IsOp(
+IndexCreateOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *CONST *objv)
 {
-    Blt_Op proc;
-    int result;
+    IndexData data;
+    Blt_TreeKey key;
 
-    proc = Blt_GetOpFromObj(interp, nIsOps, isOps, BLT_OP_ARG2, objc, objv, 0);
-    if (proc == NULL) {
+    data.type = TREE_INDEX_STRING;
+    data.flags = 0;
+    if (Blt_ProcessObjSwitches(interp, indexSwitches, objc - 4, objv + 4, 
+	(char *)&data, BLT_SWITCH_EXACT) < 0) {
 	return TCL_ERROR;
     }
-    result = (*proc) (cmdPtr, interp, objc, objv);
-    return result;
+    key = Blt_TreeKeyGet(interp, cmdPtr->tree->treeObject, 
+	Tcl_GetString(objv[3]));
+    return Blt_TreeCreateKeyIndex(interp, cmdPtr->tree, key, data.type, 
+	data.flags);
 }
 
-
 /*
  *----------------------------------------------------------------------
  *
- * KeysOp --
+ * IndexDeleteOp --
  *
- *	Returns the key names of values for a node or array value.
+ *	.t index delete key ?key...?
  *
  *---------------------------------------------------------------------- 
  */
+/*ARGSUSED*/
 static int
-KeysOp(
+IndexDeleteOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *CONST *objv)
 {
-    Blt_HashTable keyTable;
-    Blt_TreeKey key;
-    Blt_TreeKeySearch keyIter;
-    Blt_TreeNode node;
-    Tcl_Obj *listObjPtr, *objPtr;
     register int i;
-    int isNew, len;
-    /*char *string;*/
-    TagSearch tagIter = {0};
+    char *string;
 
-    Blt_InitHashTableWithPool(&keyTable, BLT_ONE_WORD_KEYS);
-    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
-    for (i = 2; i < objc; i++) {
-        /*string =*/ Tcl_GetStringFromObj(objv[i],&len);
-        if (len == 0) continue;
-        if (FindTaggedNodes(interp, cmdPtr, objv[i], &tagIter) != TCL_OK) {
-            Blt_DeleteHashTable(&keyTable);
-            Tcl_DecrRefCount(listObjPtr);
-            return TCL_ERROR;
-	}
-	for ( node = FirstTaggedNode(&tagIter);
-	 node != NULL; node = NextTaggedNode(node, &tagIter)) {
-	    for (key = Blt_TreeFirstKey(cmdPtr->tree, node, &keyIter); 
-		 key != NULL; key = Blt_TreeNextKey(cmdPtr->tree, &keyIter)) {
-		Blt_CreateHashEntry(&keyTable, key, &isNew);
-                if (!isNew) continue;
-                objPtr = Tcl_NewStringObj(key, -1);
-                Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
-	    }
+    for (i = 3; i < objc; i++) {
+	string = Tcl_GetString(objv[i]);
+	if (Blt_TreeDeleteKeyIndex(cmdPtr->tree, Blt_TreeKeyGet(interp, 
+		cmdPtr->tree->treeObject, string)) != TCL_OK) {
+	    Tcl_AppendResult(interp, "no index for key \"", string, "\"", 
+		(char *)NULL);
+	    return TCL_ERROR;
 	}
-        DoneTaggedNodes(&tagIter);
     }
-    Tcl_SetObjResult(interp, listObjPtr);
-    Blt_DeleteHashTable(&keyTable);
     return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * LabelOp --
+ * IndexFindOp --
+ *
+ *	Returns the nodes whose value of the key is value, in preorder.
+ *	Typed indexes compare numbers by value.
+ *
+ *	.t index find key value
  *
  *---------------------------------------------------------------------- 
  */
+/*ARGSUSED*/
 static int
-LabelOp(
+IndexFindOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *CONST *objv)
 {
-    Blt_TreeNode node;
+    Blt_TreeNode *nodes;
+    Tcl_Obj *listObjPtr;
+    char *string;
+    int nNodes;
+    register int i;
 
-    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+    string = Tcl_GetString(objv[3]);
+    nNodes = Blt_TreeKeyIndexFind(cmdPtr->tree, Blt_TreeKeyGet(interp, 
+	cmdPtr->tree->treeObject, string), Tcl_GetString(objv[4]), &nodes);
+    if (nNodes < 0) {
+	Tcl_AppendResult(interp, "no index for key \"", string, "\"", 
+		(char *)NULL);
 	return TCL_ERROR;
     }
-    if (objc == 4) {
-	if (Blt_TreeRelabelNode(cmdPtr->tree, node, Tcl_GetString(objv[3])) != TCL_OK) {
-	    return TCL_ERROR;
-	}
+    if (nNodes > 1) {
+	qsort((char *)nodes, nNodes, sizeof(Blt_TreeNode), 
+	      (QSortCompareProc *)ComparePreorder);
     }
-    Tcl_SetStringObj(Tcl_GetObjResult(interp), Blt_TreeNodeLabel(node), -1);
+    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **)NULL);
+    for (i = 0; i < nNodes; i++) {
+	Tcl_ListObjAppendElement(interp, listObjPtr, 
+		Tcl_NewIntObj(Blt_TreeNodeId(nodes[i])));
+    }
+    if (nodes != NULL) {
+	Blt_Free(nodes);
+    }
+    Tcl_SetObjResult(interp, listObjPtr);
     return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * FixedOp --
+ * IndexNamesOp --
+ *
+ *	.t index names pattern
  *
  *---------------------------------------------------------------------- 
  */
+/*ARGSUSED*/
 static int
-FixedOp(
+IndexNamesOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *CONST *objv)
 {
-    Blt_TreeNode node;
-    int fixed;
-
-    if (strlen(Tcl_GetString(objv[2]))) {
-        if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
-            return TCL_ERROR;
-        }
-        if (objc != 4) {
-            fixed = ((node->flags & TREE_NODE_FIXED_FIELDS) != 0);
-        } else {
-            if (Tcl_GetIntFromObj(interp, objv[3], &fixed) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            if (fixed) {
-                node->flags |= TREE_NODE_FIXED_FIELDS;
-            } else {
-                node->flags &= ~TREE_NODE_FIXED_FIELDS;
-            }
-        }
-    } else {
-        if (objc != 3) {
-            fixed = ((cmdPtr->tree->treeObject->flags & TREE_FIXED_KEYS) != 0);
-        } else {
-            if (Tcl_GetIntFromObj(interp, objv[2], &fixed) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            if (fixed) {
-                cmdPtr->tree->treeObject->flags |= TREE_FIXED_KEYS;
-            } else {
-                cmdPtr->tree->treeObject->flags &= ~TREE_FIXED_KEYS;
-            }
-        }
-    }
+    Tcl_Obj *listObjPtr;
 
-    Tcl_SetObjResult(interp, Tcl_NewIntObj(fixed));
+    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **)NULL);
+    Blt_TreeKeyIndexNames(cmdPtr->tree, Tcl_GetString(objv[3]), listObjPtr);
+    Tcl_SetObjResult(interp, listObjPtr);
     return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * DictsetOp --
+ * IndexRangeOp --
+ *
+ *	Returns the nodes whose value of the key lies between low and
+ *	high, ordered by value.  An empty bound is no limit.
+ *
+ *	.t index range key low high
  *
  *---------------------------------------------------------------------- 
  */
+/*ARGSUSED*/
 static int
-DictsetOp(
+IndexRangeOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *CONST *objv)
 {
-    int dict;
-    
+    Blt_TreeNode *nodes;
+    Tcl_Obj *listObjPtr;
+    char *low, *high;
+    int nNodes;
+    register int i;
 
-    if (objc != 3) {
-        dict = ((cmdPtr->tree->treeObject->flags & TREE_DICT_KEYS) != 0);
-    } else {
-	if (Tcl_GetIntFromObj(interp, objv[2], &dict) != TCL_OK) {
-	    return TCL_ERROR;
-	}
-	if (dict) {
-             cmdPtr->tree->treeObject->flags |= TREE_DICT_KEYS;
-	} else {
-             cmdPtr->tree->treeObject->flags &= ~TREE_DICT_KEYS;
-	}
+    low = Tcl_GetString(objv[4]);
+    high = Tcl_GetString(objv[5]);
+    nNodes = Blt_TreeKeyIndexRange(interp, cmdPtr->tree, Blt_TreeKeyGet(interp, 
+	cmdPtr->tree->treeObject, Tcl_GetString(objv[3])), 
+	(low[0] == '\0') ? NULL : low, (high[0] == '\0') ? NULL : high, 
+	&nodes);
+    if (nNodes < 0) {
+	return TCL_ERROR;
     }
-    Tcl_SetObjResult(interp, Tcl_NewIntObj(dict));
+    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **)NULL);
+    for (i = 0; i < nNodes; i++) {
+	Tcl_ListObjAppendElement(interp, listObjPtr, 
+		Tcl_NewIntObj(Blt_TreeNodeId(nodes[i])));
+    }
+    if (nodes != NULL) {
+	Blt_Free(nodes);
+    }
+    Tcl_SetObjResult(interp, listObjPtr);
     return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * LastChildOp --
- *
- *---------------------------------------------------------------------- 
- */
-/*ARGSUSED*/
-static int
-LastChildOp(cmdPtr, interp, objc, objv)
-    TreeCmd *cmdPtr;
-    Tcl_Interp *interp;
-    int objc;			/* Not used. */
-    Tcl_Obj *CONST *objv;
-{
-    Blt_TreeNode node;
-    int inode;
-
-    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
-	return TCL_ERROR;
-    }
-    inode = -1;
-    node = Blt_TreeLastChild(node);
-    if (node != NULL) {
-	inode = Blt_TreeNodeId(node);
-    }
-    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
-    return TCL_OK;
-}
-
-/*
- *----------------------------------------------------------------------
+ * IndexTypeOp --
  *
- * MoveOp --
+ *	Returns the switches the index of the key was created with.
  *
- *	The big trick here is to not consider the node to be moved in
- *	determining it's new location.  Ideally, you would temporarily
- *	pull from the tree and replace it (back in its old location if
- *	something went wrong), but you could still pick the node by 
- *	its serial number.  So here we make lots of checks for the 
- *	node to be moved.
- * 
+ *	.t index type key
  *
  *---------------------------------------------------------------------- 
  */
+/*ARGSUSED*/
 static int
-MoveOp(
+IndexTypeOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *CONST *objv)
 {
-    Blt_TreeNode root, parent, node;
-    Blt_TreeNode before;
-    MoveData data;
+    static char *typeNames[] = { "string", "integer", "real" };
+    Tcl_Obj *listObjPtr;
+    char *string;
+    int type, flags;
 
-    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
-	return TCL_ERROR;
-    }
-    if (GetNode(cmdPtr, objv[3], &parent) != TCL_OK) {
-	return TCL_ERROR;
-    }
-    root = Blt_TreeRootNode(cmdPtr->tree);
-    if (node == root) {
-	Tcl_AppendResult(interp, "can't move root node", (char *)NULL);
-	return TCL_ERROR;
-    }
-    if (parent == node) {
-	Tcl_AppendResult(interp, "can't move node to self", (char *)NULL);
-	return TCL_ERROR;
-    }
-    data.node = NULL;
-    data.cmdPtr = cmdPtr;
-    data.movePos = -1;
-    /* Process switches  */
-    if (Blt_ProcessObjSwitches(interp, moveSwitches, objc - 4, objv + 4, 
-	     (char *)&data, BLT_SWITCH_EXACT) < 0) {
-	return TCL_ERROR;
-    }
-    /* Verify they aren't ancestors. */
-    if (Blt_TreeIsAncestor(node, parent)) {
-	Tcl_AppendResult(interp, "can't move node: \"", 
-		 Tcl_GetString(objv[2]), (char *)NULL);
-	Tcl_AppendResult(interp, "\" is an ancestor of \"", 
-		 Tcl_GetString(objv[3]), "\"", (char *)NULL);
+    string = Tcl_GetString(objv[3]);
+    if (Blt_TreeKeyIndexInfo(cmdPtr->tree, Blt_TreeKeyGet(interp, 
+	cmdPtr->tree->treeObject, string), &type, &flags) != TCL_OK) {
+	Tcl_AppendResult(interp, "no index for key \"", string, "\"", 
+		(char *)NULL);
 	return TCL_ERROR;
     }
-    before = NULL;		/* If before is NULL, this appends the
-				 * node to the parent's child list.  */
-
-    if (data.node != NULL) {	/* -before or -after */
-	if (Blt_TreeNodeParent(data.node) != parent) {
-	    Tcl_AppendResult(interp, Tcl_GetString(objv[2]), 
-		     " isn't the parent of ", Blt_TreeNodeLabel(data.node),
-		     (char *)NULL);
-	    return TCL_ERROR;
-	}
-	if (Blt_SwitchChanged(moveSwitches, interp, "-before", (char *)NULL)) {
-	    before = data.node;
-	    if (before == node) {
-		Tcl_AppendResult(interp, "can't move node before itself", 
-				 (char *)NULL);
-		return TCL_ERROR;
-	    }
-	} else {
-	    before = Blt_TreeNextSibling(data.node);
-	    if (before == node) {
-		Tcl_AppendResult(interp, "can't move node after itself", 
-				 (char *)NULL);
-		return TCL_ERROR;
-	    }
-	}
-    } else if (data.movePos >= 0) { /* -at */
-	int count;		/* Tracks the current list index. */
-	Blt_TreeNode child;
-
-	/* 
-	 * If the node is in the list, ignore it when determining the
-	 * "before" node using the -at index.  An index of -1 means to
-	 * append the node to the list.
-	 */
-	count = 0;
-	for(child = Blt_TreeFirstChild(parent); child != NULL; 
-	    child = Blt_TreeNextSibling(child)) {
-	    if (child == node) {
-		continue;	/* Ignore the node to be moved. */
-	    }
-	    if (count == data.movePos) {
-		before = child;
-		break;		
-	    }
-	    count++;	
-	}
-    }
-    if (Blt_TreeMoveNode(cmdPtr->tree, node, parent, before) != TCL_OK) {
-	Tcl_AppendResult(interp, "can't move node ", Tcl_GetString(objv[2]), 
-		 " to ", Tcl_GetString(objv[3]), (char *)NULL);
-	return TCL_ERROR;
+    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **)NULL);
+    Tcl_ListObjAppendElement(interp, listObjPtr, Tcl_NewStringObj("-type", -1));
+    Tcl_ListObjAppendElement(interp, listObjPtr, 
+	Tcl_NewStringObj(typeNames[type], -1));
+    if (flags & TREE_INDEX_ORDERED) {
+	Tcl_ListObjAppendElement(interp, listObjPtr, 
+		Tcl_NewStringObj("-ordered", -1));
     }
+    Tcl_SetObjResult(interp, listObjPtr);
     return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * NextOp --
+ * IndexOp --
+ *
+ *	With one argument, returns the id of a node.  Otherwise
+ *	manages the indexes of the values of keys.
  *
  *---------------------------------------------------------------------- 
  */
-/*ARGSUSED*/
-static int
-NextOp(
-    TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,			/* Not used. */
-    Tcl_Obj *CONST *objv)
-{
-    Blt_TreeNode node;
-    int inode;
+static Blt_OpSpec indexOps[] = {
+    {"create", 1, (Blt_Op)IndexCreateOp, 4, 0, 
+	"key ?-type string|integer|real? ?-ordered?",},
+    {"delete", 1, (Blt_Op)IndexDeleteOp, 4, 0, "key ?key...?",},
+    {"find", 1, (Blt_Op)IndexFindOp, 5, 5, "key value",},
+    {"names", 1, (Blt_Op)IndexNamesOp, 4, 4, "pattern",},
+    {"range", 1, (Blt_Op)IndexRangeOp, 6, 6, "key low high",},
+    {"type", 1, (Blt_Op)IndexTypeOp, 4, 4, "key",},
+};
 
-    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
-	return TCL_ERROR;
-    }
-    inode = -1;
-    node = Blt_TreeNextNode(Blt_TreeRootNode(cmdPtr->tree), node);
-    if (node != NULL) {
-	inode = Blt_TreeNodeId(node);
-    }
-    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
-    return TCL_OK;
-}
+static int nIndexOps = sizeof(indexOps) / sizeof(Blt_OpSpec);
 
-/*
- *----------------------------------------------------------------------
- *
- * NextSiblingOp --
- *
- *---------------------------------------------------------------------- 
- */
-/*ARGSUSED*/
 static int
-NextSiblingOp(
+IndexOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
-    int objc,			/* Not used. */
+    int objc,
     Tcl_Obj *CONST *objv)
 {
-    Blt_TreeNode node;
-    int inode;
+    Blt_Op proc;
 
-    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
-	return TCL_ERROR;
+    if (objc == 3) {
+	return IndexNodeOp(cmdPtr, interp, objc, objv);
     }
-    inode = -1;
-    node = Blt_TreeNextSibling(node);
-    if (node != NULL) {
-	inode = Blt_TreeNodeId(node);
+    proc = Blt_GetOpFromObj(interp, nIndexOps, indexOps, BLT_OP_ARG2, objc, 
+	objv, 0);
+    if (proc == NULL) {
+	return TCL_ERROR;
     }
-    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
-    return TCL_OK;
+    return (*proc) (cmdPtr, interp, objc, objv);
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * NotifyCreateOp --
+ * InsertOp --
  *
- *	tree0 notify create ?flags? command arg
  *---------------------------------------------------------------------- 
  */
+
 static int
-NotifyCreateOp(
+InsertOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *CONST *objv)
 {
-    NotifyInfo *notifyPtr;
-    NotifyData data;
-    char *string;
-    char idString[200];
-    int isNew, nArgs;
-    Blt_HashEntry *hPtr;
-    int count;
-    register int i;
+    Blt_TreeNode parent, child;
+    InsertData data;
+    int inode, dobjc, tobjc, pobjc, nobjc, vobjc, i;
+    Tcl_Obj **dobjv, **pobjv, **tobjv, **nobjv, **vobjv;
 
-    count = 0;
-    for (i = 3; i < objc; i++) {
-	string = Tcl_GetString(objv[i]);
-	if (string[0] != '-') {
-	    break;
-	}
-	count++;
+    child = NULL;
+    if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+	return TCL_ERROR;
     }
-    data.mask = 0;
-    /* Process switches  */
-    if (Blt_ProcessObjSwitches(interp, notifySwitches, count, objv + 3, 
-	     (char *)&data, BLT_SWITCH_EXACT) < 0) {
+    /*if (!strcmp(Tcl_GetString(objv[2]), "end")) {
+        parent = Blt_TreeRootNode(cmdPtr->tree);
+    } else*/
+    if (GetNode(cmdPtr, objv[2], &parent) != TCL_OK) {
 	return TCL_ERROR;
     }
-    notifyPtr = Blt_Calloc(1, sizeof(NotifyInfo));
-
-    nArgs = objc - i;
+    /* Initialize switch flags */
+    memset(&data, 0, sizeof(data));
+    data.insertPos = -1;	/* Default to append node. */
+    data.parent = parent;
+    data.inode = -1;
 
-    /* Stash away the command in structure and pass that to the notifier. */
-    notifyPtr->objv = Blt_Calloc((nArgs + 2), sizeof(Tcl_Obj *));
-    for (count = 0; i < objc; i++, count++) {
-	Tcl_IncrRefCount(objv[i]);
-	notifyPtr->objv[count] = objv[i];
+    if (Blt_ProcessObjSwitches(interp, insertSwitches, objc - 3, objv + 3, 
+	     (char *)&data, BLT_SWITCH_EXACT) < 0) {
+	goto error;
     }
-    notifyPtr->objc = nArgs + 2;
-    notifyPtr->cmdPtr = cmdPtr;
-    if (data.mask == 0) {
-	data.mask = TREE_NOTIFY_ALL;
+    if (data.tags != NULL) {
+        if (Tcl_ListObjGetElements(interp, data.tags, &pobjc, &pobjv) 
+        != TCL_OK) {
+            goto error;		/* Can't split object. */
+        }
     }
-    notifyPtr->mask = data.mask;
-
-    sprintf(idString, "notify%d", cmdPtr->notifyCounter++);
-    hPtr = Blt_CreateHashEntry(&(cmdPtr->notifyTable), idString, &isNew);
-    Blt_SetHashValue(hPtr, notifyPtr);
-
-    Tcl_SetStringObj(Tcl_GetObjResult(interp), idString, -1);
-    return TCL_OK;
-}
-
-/*
- *----------------------------------------------------------------------
- *
- * NotifyDeleteOp --
- *
- *---------------------------------------------------------------------- 
- */
-static int
-NotifyDeleteOp(
-    TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,
-    Tcl_Obj *CONST *objv)
-{
-    NotifyInfo *notifyPtr;
-    Blt_HashEntry *hPtr;
-    register int i, j;
-    char *string;
-
-    for (i = 3; i < objc; i++) {
-	string = Tcl_GetString(objv[i]);
-	hPtr = Blt_FindHashEntry(&(cmdPtr->notifyTable), string);
-	if (hPtr == NULL) {
-	    Tcl_AppendResult(interp, "unknown notify name \"", string, "\"", 
-			     (char *)NULL);
-	    return TCL_ERROR;
-	}
-	notifyPtr = Blt_GetHashValue(hPtr);
-	Blt_DeleteHashEntry(&(cmdPtr->notifyTable), hPtr);
-	for (j = 0; j < (notifyPtr->objc - 2); j++) {
-	    Tcl_DecrRefCount(notifyPtr->objv[j]);
-	}
-	Blt_Free(notifyPtr->objv);
-	Blt_Free(notifyPtr);
-    }
-    return TCL_OK;
-}
-
-/*
- *----------------------------------------------------------------------
- *
- * NotifyInfoOp --
- *
- *---------------------------------------------------------------------- 
- */
-/*ARGSUSED*/
-static int
-NotifyInfoOp(
-    TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,			/* Not used. */
-    Tcl_Obj *CONST *objv)
-{
-    NotifyInfo *notifyPtr;
-    Blt_HashEntry *hPtr;
-    Tcl_DString dString;
-    char *string;
-    int i;
-
-    string = Tcl_GetString(objv[3]);
-    hPtr = Blt_FindHashEntry(&(cmdPtr->notifyTable), string);
-    if (hPtr == NULL) {
-	Tcl_AppendResult(interp, "unknown notify name \"", string, "\"", 
-			 (char *)NULL);
-	return TCL_ERROR;
-    }
-    notifyPtr = Blt_GetHashValue(hPtr);
-
-    Tcl_DStringInit(&dString);
-    Tcl_DStringAppendElement(&dString, string);	/* Copy notify Id */
-    Tcl_DStringStartSublist(&dString);
-    if (notifyPtr->mask & TREE_NOTIFY_CREATE) {
-	Tcl_DStringAppendElement(&dString, "-create");
-    }
-    if (notifyPtr->mask & TREE_NOTIFY_GET) {
-        Tcl_DStringAppendElement(&dString, "-get");
-    }
-    if (notifyPtr->mask & TREE_NOTIFY_INSERT) {
-        Tcl_DStringAppendElement(&dString, "-insert");
+    if (data.tags2 != NULL) {
+        if (Tcl_ListObjGetElements(interp, data.tags2, &tobjc, &tobjv) 
+        != TCL_OK) {
+            goto error;		/* Can't split object. */
+        }
     }
-    if (notifyPtr->mask & TREE_NOTIFY_DELETE) {
-	Tcl_DStringAppendElement(&dString, "-delete");
+    if (data.dataPairs != NULL) {
+        if (Tcl_ListObjGetElements(interp, data.dataPairs, &dobjc, &dobjv) 
+            != TCL_OK) {
+            goto error;		/* Can't split object. */
+        }
+        if (dobjc%2) {
+            Tcl_AppendResult(interp, "-data must have an even number of values",0);
+            goto error;
+        }
+        if (data.names != NULL || data.values != NULL) {
+            Tcl_AppendResult(interp, "-data incompatible with -names/-values",0);
+            goto error;
+        }
     }
-    if (notifyPtr->mask & TREE_NOTIFY_MOVE) {
-	Tcl_DStringAppendElement(&dString, "-move");
+    if (data.names != NULL) {
+        if (Tcl_ListObjGetElements(interp, data.names, &nobjc, &nobjv) 
+        != TCL_OK) {
+            goto error;		/* Can't split object. */
+        }
+        if (data.dataPairs != NULL) {
+            Tcl_AppendResult(interp, "-data incompatible with -names/-values",0);
+            goto error;
+        }
+        if (data.values == NULL) {
+            Tcl_AppendResult(interp, "-names must be used with -values",0);
+            goto error;
+        }
     }
-    if (notifyPtr->mask & TREE_NOTIFY_MOVEPOST) {
-        Tcl_DStringAppendElement(&dString, "-movepost");
+    if (data.values != NULL) {
+        if (Tcl_ListObjGetElements(interp, data.values, &vobjc, &vobjv) 
+        != TCL_OK) {
+            goto error;		/* Can't split object. */
+        }
+        if (data.dataPairs != NULL) {
+            Tcl_AppendResult(interp, "-data incompatible with -names/-values",0);
+            goto error;
+        }
+        if (data.names == NULL) {
+            Tcl_AppendResult(interp, "-values must be used with -names",0);
+            goto error;
+        }
+        if (vobjc != nobjc) {
+            Tcl_AppendResult(interp, "-values and -names must be the same length",0);
+            goto error;
+        }
     }
-    if (notifyPtr->mask & TREE_NOTIFY_SORT) {
-	Tcl_DStringAppendElement(&dString, "-sort");
+    if (data.inode > 0) {
+	Blt_TreeNode node;
+
+	node = Blt_TreeGetNode(cmdPtr->tree, data.inode);
+	if (node != NULL) {
+	    Tcl_AppendResult(interp, "can't reissue node id \"", 
+		Blt_Itoa(data.inode), "\": already exists.", (char *)NULL);
+	    goto error;
+	}
+	child = Blt_TreeCreateNodeWithId(cmdPtr->tree, parent, data.label, 
+		data.inode, data.insertPos);
+    } else {
+	child = Blt_TreeCreateNode(cmdPtr->tree, parent, data.label, 
+		data.insertPos);
     }
-    if (notifyPtr->mask & TREE_NOTIFY_RELABEL) {
-	Tcl_DStringAppendElement(&dString, "-relabel");
+    if (child == NULL) {
+	Tcl_AppendResult(interp, "can't allocate new node", (char *)NULL);
+	goto error;
     }
-    if (notifyPtr->mask & TREE_NOTIFY_RELABELPOST) {
-        Tcl_DStringAppendElement(&dString, "-relabelpost");
+    inode = child->inode;
+    if (data.label == NULL) {
+	char string[200];
+
+	sprintf(string, "%d", Blt_TreeNodeId(child));
+	Blt_TreeRelabelNode2(child, string);
+    } 
+    if (data.tags != NULL) {
+
+         for (i=0; i<pobjc; i++) {
+	    if (AddTag(cmdPtr, child, Tcl_GetString(pobjv[i])) != TCL_OK) {
+		goto error;
+	    }
+	}
     }
-    if (notifyPtr->mask & TREE_NOTIFY_WHENIDLE) {
-        Tcl_DStringAppendElement(&dString, "-whenidle");
+    if (data.dataPairs != NULL) {
+	char *key;
+
+	for (i=0; i<dobjc; i += 2) {
+	    key = Tcl_GetString(dobjv[i]);
+            if (Blt_TreeSetValue(interp, cmdPtr->tree, child, key, dobjv[i+1]) 
+		!= TCL_OK) {
+		goto error;
+	    }
+         }
+    } else if (data.names != NULL) {
+        char *key;
+
+        for (i=0; i<nobjc; i++) {
+            key = Tcl_GetString(nobjv[i]);
+            if (Blt_TreeSetValue(interp, cmdPtr->tree, child, key, vobjv[i]) 
+            != TCL_OK) {
+                goto error;
+            }
+        }
     }
-    if (notifyPtr->mask & TREE_NOTIFY_TRACEACTIVE) {
-        Tcl_DStringAppendElement(&dString, "-disabletrace");
+    if (data.tags2 != NULL) {
+         for (i=0; i<tobjc; i++) {
+	    if (AddTag(cmdPtr, child, Tcl_GetString(tobjv[i])) != TCL_OK) {
+                goto error;
+            }
+        }
     }
-    if (notifyPtr->mask & TREE_NOTIFY_BGERROR) {
-        Tcl_DStringAppendElement(&dString, "-bgerror");
+    if (Blt_TreeInsertPost(cmdPtr->tree, child) == NULL) {
+        goto error;
     }
-    Tcl_DStringEndSublist(&dString);
-    Tcl_DStringStartSublist(&dString);
-    for (i = 0; i < (notifyPtr->objc - 2); i++) {
-	Tcl_DStringAppendElement(&dString, Tcl_GetString(notifyPtr->objv[i]));
+    
+    if (data.fixed || (cmdPtr->tree->treeObject->flags & TREE_FIXED_KEYS)) {
+        child->flags |= TREE_NODE_FIXED_FIELDS;
     }
-    Tcl_DStringEndSublist(&dString);
-    Tcl_DStringResult(interp, &dString);
-    return TCL_OK;
-}
 
-/*
- *----------------------------------------------------------------------
- *
- * NotifyNamesOp --
- *
- *---------------------------------------------------------------------- 
- */
-/*ARGSUSED*/
-static int
-NotifyNamesOp(
-    TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,			/* Not used. */
-    Tcl_Obj *CONST *objv)
-{
-    Blt_HashEntry *hPtr;
-    Blt_HashSearch cursor;
-    Tcl_Obj *objPtr, *listObjPtr;
-    char *notifyId;
+    Blt_FreeSwitches(interp, insertSwitches, (char *)&data, 0);
+    Tcl_SetIntObj(Tcl_GetObjResult(interp), Blt_TreeNodeId(child));
+    return TCL_OK;
 
-    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
-    for (hPtr = Blt_FirstHashEntry(&(cmdPtr->notifyTable), &cursor);
-	 hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
-	notifyId = Blt_GetHashKey(&(cmdPtr->notifyTable), hPtr);
-	objPtr = Tcl_NewStringObj(notifyId, -1);
-	Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
+ error:
+    if (child != NULL) {
+        child = Blt_TreeGetNode(cmdPtr->tree, inode);
     }
-    Tcl_SetObjResult(interp, listObjPtr);
-    return TCL_OK;
+    if (child != NULL) {
+	DeleteNode(cmdPtr, child);
+    }
+    Blt_FreeSwitches(interp, insertSwitches, (char *)&data, 0);
+    return TCL_ERROR;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * NotifyOp --
+ * CreateOp --
  *
  *---------------------------------------------------------------------- 
  */
-static Blt_OpSpec notifyOps[] =
-{
-    {"create", 1, (Blt_Op)NotifyCreateOp, 4, 0, "?flags? command",},
-    {"delete", 1, (Blt_Op)NotifyDeleteOp, 3, 0, "notifyId...",},
-    {"info", 1, (Blt_Op)NotifyInfoOp, 4, 4, "notifyId",},
-    {"names", 1, (Blt_Op)NotifyNamesOp, 3, 3, "",},
-};
-
-static int nNotifyOps = sizeof(notifyOps) / sizeof(Blt_OpSpec);
 
 static int
-NotifyOp(
+CreateOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *CONST *objv)
 {
-    Blt_Op proc;
-    int result;
-
-    proc = Blt_GetOpFromObj(interp, nNotifyOps, notifyOps, BLT_OP_ARG2, objc, 
-	objv, 0);
-    if (proc == NULL) {
+    Blt_TreeNode parent = NULL, child = NULL;
+    int cnt = 0, i, n, m, vobjc, tobjc, dobjc, pobjc, optInd, iPos = -1, incr = 0;
+    int hasoffs = 0, seqlabel = 0, seqVal = 0, hasstart = 0, start;
+    int fixed = 0, hcnt = 0;
+    char *prefix = NULL, *string;
+    Tcl_Obj **vobjv = NULL;
+    Tcl_Obj **tobjv = NULL;
+    Tcl_Obj **dobjv = NULL;
+    Tcl_Obj **pobjv = NULL;
+
+    enum optInd {
+        OP_DATA, OP_FIXED, OP_SEQLABEL, OP_NODES, OP_NUM, OP_OFFSET,
+        OP_PARENT, OP_PATH, OP_POS, OP_PREFIX, OP_START, OP_TAGS
+    };
+    static char *optArr[] = {
+        "-data", "-fixed", "-labelstart", "-nodes", "-num", "-offset",
+        "-parent", "-path", "-pos", "-prefix", "-start", "-tags",
+        0
+    };
+
+    i = 1;
+    
+    if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    string = Tcl_GetString(objv[2]);
+    while (objc>=3 && string[0] == '-') {
+        if (Tcl_GetIndexFromObj(interp, objv[2], optArr, "option",
+            0, &optInd) != TCL_OK) {
+                return TCL_ERROR;
+        }
+        switch (optInd) {
+        
+        case OP_POS:
+            if (objc<4) { goto missingArg; }
+            if (Tcl_GetIntFromObj(interp, objv[3], &iPos) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            objc -= 2;
+            objv += 2;
+            break;
+        case OP_DATA:
+            if (objc<4) { goto missingArg; }
+            if (Tcl_ListObjGetElements(interp, objv[3], &dobjc, &dobjv) 
+                != TCL_OK) {
+                return TCL_ERROR;		/* Can't split object. */
+            }
+            if (dobjc%2) {
+                Tcl_AppendResult(interp, "data must have even length", (char *)NULL);
+                return TCL_ERROR;
+            }
+            objc -= 2;
+            objv += 2;
+            break;
+        case OP_FIXED:
+            fixed = 1;
+            objc -= 1;
+            objv += 1;
+            break;
+        case OP_SEQLABEL:
+            if (objc<4) { goto missingArg; }
+            if (Tcl_GetIntFromObj(interp, objv[3], &seqVal) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            objc -= 2;
+            objv += 2;
+            seqlabel = 1;
+            break;
+        case OP_OFFSET:
+            if (objc<4) { goto missingArg; }
+            if (Tcl_GetIntFromObj(interp, objv[3], &incr) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            hasoffs = 1;
+            objc -= 2;
+            objv += 2;
+            break;
+        case OP_NUM:
+            if (objc<4) { goto missingArg; }
+            if (Tcl_GetIntFromObj(interp, objv[3], &cnt) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            hcnt++;
+            if (cnt<0 || cnt>10000000) {
+                Tcl_AppendResult(interp, "count must be >= 0 and <= 10M", (char *)NULL);
+                return TCL_ERROR;
+            }
+            objc -= 2;
+            objv += 2;
+            break;
+        case OP_NODES:
+            hcnt++;
+            if (objc<4) { goto missingArg; }
+            if (Tcl_ListObjGetElements(interp, objv[3], &vobjc, &vobjv) 
+                != TCL_OK) {
+                return TCL_ERROR;		/* Can't split object. */
+            }
+            for (i=0; i<vobjc; i++)  {
+                if (Tcl_GetIntFromObj(interp, vobjv[i], &n)) {
+                    return TCL_ERROR;
+                }
+            }
+            objc -= 2;
+            objv += 2;
+            break;
+        case OP_PARENT:
+            if (objc<4) { goto missingArg; }
+            if (GetNode(cmdPtr, objv[3], &parent) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            objc -= 2;
+            objv += 2;
+            break;
+        case OP_PREFIX:
+            if (objc<4) { goto missingArg; }
+            prefix = Tcl_GetString(objv[3]);
+            objc -= 2;
+            objv += 2;
+            break;
+        case OP_PATH:
+            if (objc<4) { goto missingArg; }
+            hcnt++;
+            if (Tcl_ListObjGetElements(interp, objv[3], &pobjc, &pobjv) 
+                != TCL_OK) {
+                return TCL_ERROR;		/* Can't split object. */
+            }
+            objc -= 2;
+            objv += 2;
+            break;
+        case OP_START:
+            if (objc<4) { goto missingArg; }
+            if (Tcl_GetIntFromObj(interp, objv[3], &start) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            if (start<=0) {
+                Tcl_AppendResult(interp, "start must be > 0", (char *)NULL);
+                return TCL_ERROR;
+            }
+            hasstart = 1;
+            objc -= 2;
+            objv += 2;
+            break;
+        case OP_TAGS:
+            if (objc<4) { goto missingArg; }
+            if (Tcl_ListObjGetElements(interp, objv[3], &tobjc, &tobjv) 
+                != TCL_OK) {
+                return TCL_ERROR;		/* Can't split object. */
+            }
+            objc -= 2;
+            objv += 2;
+            break;
+        default:
+            return TCL_ERROR;
+        }
+    }
+    if (hcnt != 1) {
+        Tcl_AppendResult(interp, "must use exactly one of -nodes, -num or -path", 0);
+        return TCL_ERROR;
+    }
+    if (vobjv != NULL) {
+        cnt = vobjc;
+    }
+    if (pobjv != NULL) {
+        cnt = pobjc;
+        if (prefix != NULL) {
+            Tcl_AppendResult(interp, "-prefix is incompatible with -path", 0);
+            return TCL_ERROR;
+        }
+        if (seqlabel) {
+            Tcl_AppendResult(interp, "-labelstart is incompatible with -path", 0);
+            return TCL_ERROR;
+        }
+        if (parent != NULL) {
+            Tcl_AppendResult(interp, "-parent is incompatible with -path", 0);
+            return TCL_ERROR;
+        }
+    }
+    if (hasoffs && vobjv == NULL) {
+        Tcl_AppendResult(interp, "must use -nodes with -offset", 0);
+        return TCL_ERROR;
+    }
+
+    if (parent == NULL) {
+         parent = Blt_TreeRootNode(cmdPtr->tree);
+    }
+    if (prefix == NULL) {
+        prefix = "";
+    }
+
+    for (n = 0, m = 0; n<cnt; n++, i++)  {
+        char label[200];
+        char *labStr;
+        labStr = NULL;
+        if (vobjv != NULL) {
+            if (Tcl_GetIntFromObj(interp, vobjv[n], &i)) {
+                return TCL_ERROR;
+            }
+            i += incr;
+        }
+        if (pobjv != NULL) {
+            labStr = Tcl_GetString(pobjv[n]);
+            child = Blt_TreeFindChild( parent, labStr);
+            if (child != NULL) {
+                parent = child;
+                continue;
+            }
+        }
+        if (vobjv != NULL) {
+            child = Blt_TreeCreateNodeWithId(cmdPtr->tree, parent, labStr, i, iPos);
+        } else if (hasstart) {
+            child = Blt_TreeCreateNodeWithId(cmdPtr->tree, parent, labStr, n+start, iPos);
+        } else {
+            child = Blt_TreeCreateNode(cmdPtr->tree, parent, labStr, iPos);
+        }
+        if (child == NULL) {
+            return TCL_ERROR;
+        }
+        if (pobjv != NULL) {
+            parent = child;
+        }
+        if (labStr == NULL) {
+            if (!seqlabel) {
+                i = Blt_TreeNodeId(child);
+            } else {
+                i = n + seqVal;
+            }
+            if (prefix[0]) {
+                sprintf(label, "%.100s%d", prefix, i);
+            } else {
+                sprintf(label, "%d", i);
+            }
+            Blt_TreeRelabelNode2(child, label);
+        }
+        if (dobjv != NULL) {
+            int j;
+            Blt_TreeKey key;
+            for (j = 0; j<dobjc; j += 2) {
+                key = Tcl_GetString(dobjv[j]);
+                if (Blt_TreeSetValue(interp, cmdPtr->tree, child, key, dobjv[j+1]) 
+                != TCL_OK) {
+                    return TCL_ERROR;
+                }
+            }
+        }
+        if (tobjv != NULL) {
+            int j;
+            for (j = 0; j<tobjc; j++) {
+                if (AddTag(cmdPtr, child, Tcl_GetString(tobjv[j])) != TCL_OK) {
+                    return TCL_ERROR;
+                }
+            }
+        }
+        if (Blt_TreeInsertPost(cmdPtr->tree, child) == NULL) {
+            DeleteNode(cmdPtr, child);
+            return TCL_ERROR;
+        }
+        if (fixed || (cmdPtr->tree->treeObject->flags & TREE_FIXED_KEYS)) {
+            child->flags |= TREE_NODE_FIXED_FIELDS;
+        }
+        m++;
+    }
+    if (child != NULL) {
+        Tcl_AppendResult(interp, Blt_Itoa(Blt_TreeNodeId(child)), 0);
+    }
+    return TCL_OK;
+
+missingArg:
+    Tcl_AppendResult(interp, "missing argument for populate option \"",
+        Tcl_GetString(objv[3]), "\"", (char *)NULL);
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IsAncestorOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+/*ARGSUSED*/
+static int
+IsAncestorOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,			/* Not used. */
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode node1, node2;
+    int bool;
+
+    if ((GetNode(cmdPtr, objv[3], &node1) != TCL_OK) ||
+	(GetNode(cmdPtr, objv[4], &node2) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    bool = Blt_TreeIsAncestor(node1, node2);
+    Tcl_SetIntObj(Tcl_GetObjResult(interp), bool);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IsBeforeOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+/*ARGSUSED*/
+static int
+IsBeforeOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,			/* Not used. */
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode node1, node2;
+    int bool;
+
+    if ((GetNode(cmdPtr, objv[3], &node1) != TCL_OK) ||
+	(GetNode(cmdPtr, objv[4], &node2) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    bool = Blt_TreeIsBefore(node1, node2);
+    Tcl_SetIntObj(Tcl_GetObjResult(interp), bool);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IsLeafOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+/*ARGSUSED*/
+static int
+IsLeafOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,			/* Not used. */
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode node;
+
+    if (GetNode(cmdPtr, objv[3], &node) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    Tcl_SetIntObj(Tcl_GetObjResult(interp), Blt_TreeIsLeaf(node));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IsRootOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+/*ARGSUSED*/
+static int
+IsRootOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,			/* Not used. */
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode node;
+    int bool;
+
+    if (GetNode(cmdPtr, objv[3], &node) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    bool = (node == Blt_TreeRootNode(cmdPtr->tree));
+    Tcl_SetIntObj(Tcl_GetObjResult(interp), bool);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IsOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+static Blt_OpSpec isOps[] =
+{
+    {"ancestor", 1, (Blt_Op)IsAncestorOp, 5, 5, "node1 node2",},
+    {"before", 1, (Blt_Op)IsBeforeOp, 5, 5, "node1 node2",},
+    {"leaf", 1, (Blt_Op)IsLeafOp, 4, 4, "node",},
+    {"root", 1, (Blt_Op)IsRootOp, 4, 4, "node",},
+};
+
+static int nIsOps = sizeof(isOps) / sizeof(Blt_OpSpec);
+
+static int
+IsOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_Op proc;
+    int result;
+
+    proc = Blt_GetOpFromObj(interp, nIsOps, isOps, BLT_OP_ARG2, objc, objv, 0);
+    if (proc == NULL) {
+	return TCL_ERROR;
+    }
+    result = (*proc) (cmdPtr, interp, objc, objv);
+    return result;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * KeysOp --
+ *
+ *	Returns the key names of values for a node or array value.
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+KeysOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_HashTable keyTable;
+    Blt_TreeKey key;
+    Blt_TreeKeySearch keyIter;
+    Blt_TreeNode node;
+    Tcl_Obj *listObjPtr, *objPtr;
+    register int i;
+    int isNew, len;
+    /*char *string;*/
+    TagSearch tagIter = {0};
+
+    Blt_InitHashTableWithPool(&keyTable, BLT_ONE_WORD_KEYS);
+    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+    for (i = 2; i < objc; i++) {
+        /*string =*/ Tcl_GetStringFromObj(objv[i],&len);
+        if (len == 0) continue;
+        if (FindTaggedNodes(interp, cmdPtr, objv[i], &tagIter) != TCL_OK) {
+            Blt_DeleteHashTable(&keyTable);
+            Tcl_DecrRefCount(listObjPtr);
+            return TCL_ERROR;
+	}
+	for ( node = FirstTaggedNode(&tagIter);
+	 node != NULL; node = NextTaggedNode(node, &tagIter)) {
+	    for (key = Blt_TreeFirstKey(cmdPtr->tree, node, &keyIter); 
+		 key != NULL; key = Blt_TreeNextKey(cmdPtr->tree, &keyIter)) {
+		Blt_CreateHashEntry(&keyTable, key, &isNew);
+                if (!isNew) continue;
+                objPtr = Tcl_NewStringObj(key, -1);
+                Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
+	    }
+	}
+        DoneTaggedNodes(&tagIter);
+    }
+    Tcl_SetObjResult(interp, listObjPtr);
+    Blt_DeleteHashTable(&keyTable);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LabelOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+LabelOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode node;
+
+    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (objc == 4) {
+	if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (Blt_TreeRelabelNode(cmdPtr->tree, node, Tcl_GetString(objv[3])) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+    Tcl_SetStringObj(Tcl_GetObjResult(interp), Blt_TreeNodeLabel(node), -1);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FixedOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+FixedOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode node;
+    int fixed;
+
+    if (strlen(Tcl_GetString(objv[2]))) {
+        if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if (objc != 4) {
+            fixed = ((node->flags & TREE_NODE_FIXED_FIELDS) != 0);
+        } else {
+            if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            if (Tcl_GetIntFromObj(interp, objv[3], &fixed) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            if (fixed) {
+                node->flags |= TREE_NODE_FIXED_FIELDS;
+            } else {
+                node->flags &= ~TREE_NODE_FIXED_FIELDS;
+            }
+        }
+    } else {
+        if (objc != 3) {
+            fixed = ((cmdPtr->tree->treeObject->flags & TREE_FIXED_KEYS) != 0);
+        } else {
+            if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            if (Tcl_GetIntFromObj(interp, objv[2], &fixed) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            if (fixed) {
+                cmdPtr->tree->treeObject->flags |= TREE_FIXED_KEYS;
+            } else {
+                cmdPtr->tree->treeObject->flags &= ~TREE_FIXED_KEYS;
+            }
+        }
+    }
+
+    Tcl_SetObjResult(interp, Tcl_NewIntObj(fixed));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DictsetOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+DictsetOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    int dict;
+    
+
+    if (objc != 3) {
+        dict = ((cmdPtr->tree->treeObject->flags & TREE_DICT_KEYS) != 0);
+    } else {
+	if (Tcl_GetIntFromObj(interp, objv[2], &dict) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (dict) {
+             cmdPtr->tree->treeObject->flags |= TREE_DICT_KEYS;
+	} else {
+             cmdPtr->tree->treeObject->flags &= ~TREE_DICT_KEYS;
+	}
+    }
+    Tcl_SetObjResult(interp, Tcl_NewIntObj(dict));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LastChildOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+/*ARGSUSED*/
+static int
+LastChildOp(cmdPtr, interp, objc, objv)
+    TreeCmd *cmdPtr;
+    Tcl_Interp *interp;
+    int objc;			/* Not used. */
+    Tcl_Obj *CONST *objv;
+{
+    Blt_TreeNode node;
+    int inode;
+
+    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    inode = -1;
+    node = Blt_TreeLastChild(node);
+    if (node != NULL) {
+	inode = Blt_TreeNodeId(node);
+    }
+    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MoveOp --
+ *
+ *	The big trick here is to not consider the node to be moved in
+ *	determining it's new location.  Ideally, you would temporarily
+ *	pull from the tree and replace it (back in its old location if
+ *	something went wrong), but you could still pick the node by 
+ *	its serial number.  So here we make lots of checks for the 
+ *	node to be moved.
+ * 
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+MoveOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode root, parent, node;
+    Blt_TreeNode before;
+    MoveData data;
+
+    if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (GetNode(cmdPtr, objv[3], &parent) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    root = Blt_TreeRootNode(cmdPtr->tree);
+    if (node == root) {
+	Tcl_AppendResult(interp, "can't move root node", (char *)NULL);
+	return TCL_ERROR;
+    }
+    if (parent == node) {
+	Tcl_AppendResult(interp, "can't move node to self", (char *)NULL);
+	return TCL_ERROR;
+    }
+    data.node = NULL;
+    data.cmdPtr = cmdPtr;
+    data.movePos = -1;
+    /* Process switches  */
+    if (Blt_ProcessObjSwitches(interp, moveSwitches, objc - 4, objv + 4, 
+	     (char *)&data, BLT_SWITCH_EXACT) < 0) {
+	return TCL_ERROR;
+    }
+    /* Verify they aren't ancestors. */
+    if (Blt_TreeIsAncestor(node, parent)) {
+	Tcl_AppendResult(interp, "can't move node: \"", 
+		 Tcl_GetString(objv[2]), (char *)NULL);
+	Tcl_AppendResult(interp, "\" is an ancestor of \"", 
+		 Tcl_GetString(objv[3]), "\"", (char *)NULL);
+	return TCL_ERROR;
+    }
+    before = NULL;		/* If before is NULL, this appends the
+				 * node to the parent's child list.  */
+
+    if (data.node != NULL) {	/* -before or -after */
+	if (Blt_TreeNodeParent(data.node) != parent) {
+	    Tcl_AppendResult(interp, Tcl_GetString(objv[2]), 
+		     " isn't the parent of ", Blt_TreeNodeLabel(data.node),
+		     (char *)NULL);
+	    return TCL_ERROR;
+	}
+	if (Blt_SwitchChanged(moveSwitches, interp, "-before", (char *)NULL)) {
+	    before = data.node;
+	    if (before == node) {
+		Tcl_AppendResult(interp, "can't move node before itself", 
+				 (char *)NULL);
+		return TCL_ERROR;
+	    }
+	} else {
+	    before = Blt_TreeNextSibling(data.node);
+	    if (before == node) {
+		Tcl_AppendResult(interp, "can't move node after itself", 
+				 (char *)NULL);
+		return TCL_ERROR;
+	    }
+	}
+    } else if (data.movePos >= 0) { /* -at */
+	int position;
+
+	/* 
+	 * If the node is in the list, ignore it when determining the
+	 * "before" node using the -at index.  An index of -1 means to
+	 * append the node to the list.
+	 */
+	position = data.movePos;
+	if ((Blt_TreeNodeParent(node) == parent) && 
+	    (Blt_TreeNodePosition(node) <= position)) {
+	    position++;		/* Skip over the node to be moved. */
+	}
+	before = Blt_TreeNthChild(parent, position);
+    }
+    if (Blt_TreeMoveNode(cmdPtr->tree, node, parent, before) != TCL_OK) {
+	Tcl_AppendResult(interp, "can't move node ", Tcl_GetString(objv[2]), 
+		 " to ", Tcl_GetString(objv[3]), (char *)NULL);
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NextOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+/*ARGSUSED*/
+static int
+NextOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,			/* Not used. */
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode node;
+    int inode;
+
+    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    inode = -1;
+    node = Blt_TreeNextNode(Blt_TreeRootNode(cmdPtr->tree), node);
+    if (node != NULL) {
+	inode = Blt_TreeNodeId(node);
+    }
+    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NextSiblingOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+/*ARGSUSED*/
+static int
+NextSiblingOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,			/* Not used. */
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode node;
+    int inode;
+
+    if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    inode = -1;
+    node = Blt_TreeNextSibling(node);
+    if (node != NULL) {
+	inode = Blt_TreeNodeId(node);
+    }
+    Tcl_SetIntObj(Tcl_GetObjResult(interp), inode);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NotifyCreateOp --
+ *
+ *	tree0 notify create ?flags? command arg
+ *---------------------------------------------------------------------- 
+ */
+static int
+NotifyCreateOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    NotifyInfo *notifyPtr;
+    NotifyData data;
+    char *string;
+    char idString[200];
+    int isNew, nArgs;
+    Blt_HashEntry *hPtr;
+    int count;
+    register int i;
+
+    count = 0;
+    for (i = 3; i < objc; i++) {
+	string = Tcl_GetString(objv[i]);
+	if (string[0] != '-') {
+	    break;
+	}
+	count++;
+    }
+    data.mask = 0;
+    /* Process switches  */
+    if (Blt_ProcessObjSwitches(interp, notifySwitches, count, objv + 3, 
+	     (char *)&data, BLT_SWITCH_EXACT) < 0) {
+	return TCL_ERROR;
+    }
+    notifyPtr = Blt_Calloc(1, sizeof(NotifyInfo));
+
+    nArgs = objc - i;
+
+    /* Stash away the command in structure and pass that to the notifier. */
+    notifyPtr->objv = Blt_Calloc((nArgs + 2), sizeof(Tcl_Obj *));
+    for (count = 0; i < objc; i++, count++) {
+	Tcl_IncrRefCount(objv[i]);
+	notifyPtr->objv[count] = objv[i];
+    }
+    notifyPtr->objc = nArgs + 2;
+    notifyPtr->cmdPtr = cmdPtr;
+    if (data.mask == 0) {
+	data.mask = TREE_NOTIFY_ALL;
+    }
+    notifyPtr->mask = data.mask;
+
+    sprintf(idString, "notify%d", cmdPtr->notifyCounter++);
+    hPtr = Blt_CreateHashEntry(&(cmdPtr->notifyTable), idString, &isNew);
+    Blt_SetHashValue(hPtr, notifyPtr);
+
+    Tcl_SetStringObj(Tcl_GetObjResult(interp), idString, -1);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NotifyDeleteOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+NotifyDeleteOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    NotifyInfo *notifyPtr;
+    Blt_HashEntry *hPtr;
+    register int i, j;
+    char *string;
+
+    for (i = 3; i < objc; i++) {
+	string = Tcl_GetString(objv[i]);
+	hPtr = Blt_FindHashEntry(&(cmdPtr->notifyTable), string);
+	if (hPtr == NULL) {
+	    Tcl_AppendResult(interp, "unknown notify name \"", string, "\"", 
+			     (char *)NULL);
+	    return TCL_ERROR;
+	}
+	notifyPtr = Blt_GetHashValue(hPtr);
+	Blt_DeleteHashEntry(&(cmdPtr->notifyTable), hPtr);
+	for (j = 0; j < (notifyPtr->objc - 2); j++) {
+	    Tcl_DecrRefCount(notifyPtr->objv[j]);
+	}
+	Blt_Free(notifyPtr->objv);
+	Blt_Free(notifyPtr);
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NotifyInfoOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+/*ARGSUSED*/
+static int
+NotifyInfoOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,			/* Not used. */
+    Tcl_Obj *CONST *objv)
+{
+    NotifyInfo *notifyPtr;
+    Blt_HashEntry *hPtr;
+    Tcl_DString dString;
+    char *string;
+    int i;
+
+    string = Tcl_GetString(objv[3]);
+    hPtr = Blt_FindHashEntry(&(cmdPtr->notifyTable), string);
+    if (hPtr == NULL) {
+	Tcl_AppendResult(interp, "unknown notify name \"", string, "\"", 
+			 (char *)NULL);
+	return TCL_ERROR;
+    }
+    notifyPtr = Blt_GetHashValue(hPtr);
+
+    Tcl_DStringInit(&dString);
+    Tcl_DStringAppendElement(&dString, string);	/* Copy notify Id */
+    Tcl_DStringStartSublist(&dString);
+    if (notifyPtr->mask & TREE_NOTIFY_CREATE) {
+	Tcl_DStringAppendElement(&dString, "-create");
+    }
+    if (notifyPtr->mask & TREE_NOTIFY_GET) {
+        Tcl_DStringAppendElement(&dString, "-get");
+    }
+    if (notifyPtr->mask & TREE_NOTIFY_INSERT) {
+        Tcl_DStringAppendElement(&dString, "-insert");
+    }
+    if (notifyPtr->mask & TREE_NOTIFY_DELETE) {
+	Tcl_DStringAppendElement(&dString, "-delete");
+    }
+    if (notifyPtr->mask & TREE_NOTIFY_MOVE) {
+	Tcl_DStringAppendElement(&dString, "-move");
+    }
+    if (notifyPtr->mask & TREE_NOTIFY_MOVEPOST) {
+        Tcl_DStringAppendElement(&dString, "-movepost");
+    }
+    if (notifyPtr->mask & TREE_NOTIFY_SORT) {
+	Tcl_DStringAppendElement(&dString, "-sort");
+    }
+    if (notifyPtr->mask & TREE_NOTIFY_RELABEL) {
+	Tcl_DStringAppendElement(&dString, "-relabel");
+    }
+    if (notifyPtr->mask & TREE_NOTIFY_RELABELPOST) {
+        Tcl_DStringAppendElement(&dString, "-relabelpost");
+    }
+    if (notifyPtr->mask & TREE_NOTIFY_WHENIDLE) {
+        Tcl_DStringAppendElement(&dString, "-whenidle");
+    }
+    if (notifyPtr->mask & TREE_NOTIFY_TRACEACTIVE) {
+        Tcl_DStringAppendElement(&dString, "-disabletrace");
+    }
+    if (notifyPtr->mask & TREE_NOTIFY_BGERROR) {
+        Tcl_DStringAppendElement(&dString, "-bgerror");
+    }
+    Tcl_DStringEndSublist(&dString);
+    Tcl_DStringStartSublist(&dString);
+    for (i = 0; i < (notifyPtr->objc - 2); i++) {
+	Tcl_DStringAppendElement(&dString, Tcl_GetString(notifyPtr->objv[i]));
+    }
+    Tcl_DStringEndSublist(&dString);
+    Tcl_DStringResult(interp, &dString);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NotifyNamesOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+/*ARGSUSED*/
+static int
+NotifyNamesOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,			/* Not used. */
+    Tcl_Obj *CONST *objv)
+{
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
+    Tcl_Obj *objPtr, *listObjPtr;
+    char *notifyId;
+
+    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+    for (hPtr = Blt_FirstHashEntry(&(cmdPtr->notifyTable), &cursor);
+	 hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	notifyId = Blt_GetHashKey(&(cmdPtr->notifyTable), hPtr);
+	objPtr = Tcl_NewStringObj(notifyId, -1);
+	Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
+    }
+    Tcl_SetObjResult(interp, listObjPtr);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NotifyOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+static Blt_OpSpec notifyOps[] =
+{
+    {"create", 1, (Blt_Op)NotifyCreateOp, 4, 0, "?flags? command",},
+    {"delete", 1, (Blt_Op)NotifyDeleteOp, 3, 0, "notifyId...",},
+    {"info", 1, (Blt_Op)NotifyInfoOp, 4, 4, "notifyId",},
+    {"names", 1, (Blt_Op)NotifyNamesOp, 3, 3, "",},
+};
+
+static int nNotifyOps = sizeof(notifyOps) / sizeof(Blt_OpSpec);
+
+static int
+NotifyOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_Op proc;
+    int result;
+
+    proc = Blt_GetOpFromObj(interp, nNotifyOps, notifyOps, BLT_OP_ARG2, objc, 
+	objv, 0);
+    if (proc == NULL) {
 	return TCL_ERROR;
     }
     result = (*proc) (cmdPtr, interp, objc, objv);
@@ -5877,6 +7711,9 @@ RestoreOp(
     Tcl_Channel channel = NULL;
     RestoreData data;
 
+    if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+	return TCL_ERROR;
+    }
     if (GetNode(cmdPtr, objv[2], &root) != TCL_OK) {
 	return TCL_ERROR;
     }
@@ -5922,7 +7759,7 @@ RestoreOp(
             return TCL_ERROR;
         }
     }
-    if (data.data != NULL) {
+    if ((data.data != NULL) && ((data.flags & RESTORE_BINARY) == 0)) {
         if (!Tcl_CommandComplete(Tcl_GetString(data.data))) {
             Tcl_AppendResult(interp, "data is not complete (missing brace?)", 0);
             return TCL_ERROR;
@@ -5947,9 +7784,28 @@ RestoreOp(
         return TCL_ERROR;
     }*/
 
-    Blt_InitHashTable(&data.idTable, BLT_ONE_WORD_KEYS);
     data.root = root;
     elemArr = NULL;
+    if (data.flags & RESTORE_BINARY) {
+	Tcl_DString saved[NUM_BINARY_OPTIONS];
+
+	if (isfile) {
+	    result = Tcl_SetChannelOption(interp, channel, "-translation", 
+		"binary");
+	} else if (channel != NULL) {
+	    result = SetBinaryChannel(interp, channel, saved);
+	} else {
+	    result = TCL_OK;
+	}
+	if (result == TCL_OK) {
+	    result = RestoreBinary(cmdPtr, interp, channel, &data);
+	}
+	if ((!isfile) && (channel != NULL)) {
+	    RestoreChannel(channel, saved);
+	}
+	goto done;
+    }
+    Blt_InitHashTable(&data.idTable, BLT_ONE_WORD_KEYS);
     nLines = 0;
     result = TCL_OK;
     if (channel != NULL) {
@@ -6251,6 +8107,10 @@ LappendOp(
             return TCL_ERROR;
     }
     if (objc<=4) return TCL_OK;
+    /* Check before the value is changed in place. */
+    if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+        return TCL_ERROR;
+    }
     if (valuePtr != NULL && Tcl_ListObjLength(interp, valuePtr, &len) != TCL_OK) {
         return TCL_ERROR;
     }
@@ -6316,6 +8176,9 @@ LappendiOp(
         return TCL_OK;
     }
     
+    if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+        return TCL_ERROR;
+    }
     if (FindTaggedNodes(interp, cmdPtr, objv[2], &cursor) != TCL_OK) {
         return TCL_ERROR;
     }
@@ -6402,6 +8265,10 @@ AppendOp(
             return TCL_ERROR;
     }
     if (objc<=4) return TCL_OK;
+    /* Check before the value is changed in place. */
+    if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+        return TCL_ERROR;
+    }
     if (!(node->flags & TREE_TRACE_ACTIVE)) {
         cmdPtr->updTyp = 1;
         if (valuePtr == NULL) {
@@ -6453,6 +8320,9 @@ AppendiOp(
         return TCL_OK;
     }
     
+    if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+        return TCL_ERROR;
+    }
     if (FindTaggedNodes(interp, cmdPtr, objv[2], &cursor) != TCL_OK) {
         return TCL_ERROR;
     }
@@ -6579,6 +8449,60 @@ UpdatesOp(
     return updateOp(cmdPtr, interp, objc, objv, 1);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * SchemaOp --
+ *
+ *	Returns the keys of the schema of the tree, after adding any
+ *	keys given.  Nodes keep the public values of schema keys in
+ *	slots shared across the tree, instead of a record per value.
+ *
+ *	  $tree schema ?keyList?
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+SchemaOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeKey *keys;
+    Tcl_Obj *listObjPtr;
+    int i, nKeys;
+
+    if (objc == 3) {
+	Tcl_Obj **elemArr;
+	int nElem;
+
+	if (Tcl_ListObjGetElements(interp, objv[2], &nElem, &elemArr) 
+	    != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	keys = Blt_Malloc((nElem + 1) * sizeof(Blt_TreeKey));
+	assert(keys);
+	for (i = 0; i < nElem; i++) {
+	    keys[i] = Blt_TreeKeyGet(NULL, cmdPtr->tree->treeObject, 
+		Tcl_GetString(elemArr[i]));
+	}
+	if (Blt_TreeSetSchema(interp, cmdPtr->tree, nElem, keys) != TCL_OK) {
+	    Blt_Free(keys);
+	    return TCL_ERROR;
+	}
+	Blt_Free(keys);
+    }
+    nKeys = Blt_TreeGetSchema(cmdPtr->tree, &keys);
+    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **)NULL);
+    for (i = 0; i < nKeys; i++) {
+	Tcl_ListObjAppendElement(interp, listObjPtr, 
+		Tcl_NewStringObj(keys[i], -1));
+    }
+    Tcl_SetObjResult(interp, listObjPtr);
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -6894,6 +8818,42 @@ SizeOp(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * SnapshotOp --
+ *
+ *	Creates a read-only copy of the tree, as a new tree command.
+ *	The copy shares its values with the tree, so it costs only
+ *	the nodes themselves.
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+SnapshotOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    CONST char *treeName;
+    Tcl_DString dString;
+    Blt_Tree token;
+
+    Tcl_DStringInit(&dString);
+    treeName = GetTreeCmdName(interp, (objc == 3) ? 
+	Tcl_GetString(objv[2]) : NULL, &dString);
+    if ((treeName == NULL) || 
+	(Blt_TreeSnapshot(interp, cmdPtr->tree, treeName, &token) != TCL_OK)) {
+	Tcl_DStringFree(&dString);
+	return TCL_ERROR;
+    }
+    NewTreeCmd(cmdPtr->dataPtr, interp, treeName, token);
+    Tcl_SetResult(interp, (char *)treeName, TCL_VOLATILE);
+    Tcl_DStringFree(&dString);
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -7198,6 +9158,49 @@ TagNodesOp(
     return TCL_ERROR;*/
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TagQueryOp --
+ *
+ *	Returns the nodes matching a tag expression such as 
+ *	"a && !(b || c)", in order of their ids.
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+TagQueryOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeTagQuery *queryPtr;
+    Blt_TreeNode *nodeArr;
+    Tcl_Obj **objArr;
+    int i, nNodes;
+
+    queryPtr = Blt_TreeCreateTagQuery(interp, cmdPtr->tree, 
+	Tcl_GetString(objv[3]));
+    if (queryPtr == NULL) {
+	return TCL_ERROR;
+    }
+    nNodes = Blt_TreeTagQueryNodes(queryPtr, &nodeArr);
+    Blt_TreeFreeTagQuery(queryPtr);
+    if (nNodes == 0) {
+	return TCL_OK;
+    }
+    objArr = Blt_Malloc(nNodes * sizeof(Tcl_Obj *));
+    assert(objArr);
+    for (i = 0; i < nNodes; i++) {
+	objArr[i] = Tcl_NewIntObj(Blt_TreeNodeId(nodeArr[i]));
+    }
+    Tcl_SetObjResult(interp, Tcl_NewListObj(nNodes, objArr));
+    Blt_Free(objArr);
+    Blt_Free(nodeArr);
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -7362,7 +9365,7 @@ TagDeleteOp(
                         }
                         continue;
                     }
-                    Blt_DeleteHashEntry(tablePtr, hPtr);
+                    Blt_TreeRemoveTag(cmdPtr->tree, node, string);
                     count++;
 	        }
 	   }
@@ -7455,6 +9458,7 @@ static Blt_OpSpec tagOps[] = {
     {"lookups", 2, (Blt_Op)TagLookupsOp, 3, 4, "?pattern?",},
     {"names", 2, (Blt_Op)TagNamesOp, 3, 0, "?-glob pat? ?-regexp pat? ?node...?",},
     {"nodes", 2, (Blt_Op)TagNodesOp, 4, 0, "tag ?tag...?",},
+    {"query", 1, (Blt_Op)TagQueryOp, 4, 4, "expr",},
 };
 
 static int nTagOps = sizeof(tagOps) / sizeof(Blt_OpSpec);
@@ -7813,52 +9817,102 @@ static Blt_SwitchSpec sortSwitches[] =
     {BLT_SWITCH_END, NULL, 0, 0}
 };
 
-static SortData sortData;
+static SortData sortData;
+
+/*
+ * The sort key of each node is extracted once, before sorting,
+ * rather than on every comparison.  Integer and real keys are
+ * converted up front too.
+ */
+typedef struct {
+    Blt_TreeNode node;
+    char *string;		/* Label, path, or value compared. */
+    Tcl_Obj *objPtr;		/* If non-NULL, the value holding the
+				 * string. A reference is kept in case
+				 * a -command script changes it. */
+    int isNumber;		/* Indicates if the string converted
+				 * to an integer or real. */
+    union {
+	int i;
+	double d;
+    } number;
+} SortKey;
+
+#define SORT_RUN	8	/* Length of runs insertion sorted
+				 * before merging. */
+
+static void
+InitSortKey(SortKey *keyPtr, Blt_TreeNode node)
+{
+    TreeCmd *cmdPtr = sortData.cmdPtr;
+
+    keyPtr->node = node;
+    keyPtr->string = "";
+    keyPtr->objPtr = NULL;
+    keyPtr->isNumber = FALSE;
+    if (sortData.key != NULL) {
+	Tcl_Obj *valueObjPtr;
+
+	if (Blt_TreeGetValue((Tcl_Interp *)NULL, cmdPtr->tree, node, 
+	     sortData.key, &valueObjPtr) == TCL_OK) {
+	    Tcl_IncrRefCount(valueObjPtr);
+	    keyPtr->objPtr = valueObjPtr;
+	    keyPtr->string = Tcl_GetString(valueObjPtr);
+	}
+    } else if (sortData.flags & SORT_PATHNAME)  {
+	Tcl_DString dString;
+
+	Tcl_DStringInit(&dString);
+	keyPtr->string = Blt_Strdup(GetNodePath(cmdPtr, 
+		Blt_TreeRootNode(cmdPtr->tree), node, FALSE, &dString));
+	Tcl_DStringFree(&dString);
+    } else {
+	keyPtr->string = Blt_TreeNodeLabel(node);
+    }
+    switch (sortData.type) {
+    case SORT_INTEGER:
+	keyPtr->isNumber = (Tcl_GetInt(NULL, keyPtr->string, 
+		&keyPtr->number.i) == TCL_OK);
+	break;
+
+    case SORT_REAL:
+	keyPtr->isNumber = (Tcl_GetDouble(NULL, keyPtr->string, 
+		&keyPtr->number.d) == TCL_OK);
+	break;
+    }
+}
+
+static void
+FreeSortKeys(SortKey *keyArr, int nKeys)
+{
+    int i;
+
+    for (i = 0; i < nKeys; i++) {
+	if (keyArr[i].objPtr != NULL) {
+	    Tcl_DecrRefCount(keyArr[i].objPtr);
+	} else if ((sortData.key == NULL) && 
+		   (sortData.flags & SORT_PATHNAME)) {
+	    Blt_Free(keyArr[i].string);
+	}
+    }
+    Blt_Free(keyArr);
+}
 
 static int
-CompareNodes(Blt_TreeNode *n1Ptr, Blt_TreeNode *n2Ptr)
+CompareSortKeys(SortKey *k1Ptr, SortKey *k2Ptr)
 {
     TreeCmd *cmdPtr = sortData.cmdPtr;
-    char *s1, *s2;
     int result;
-    Tcl_DString dString1, dString2;
 
-    s1 = s2 = "";
     result = 0;
-
-    if (sortData.flags & SORT_PATHNAME) {
-	Tcl_DStringInit(&dString1);
-	Tcl_DStringInit(&dString2);
-    }
-    if (sortData.key != NULL) {
-	Tcl_Obj *valueObjPtr;
-
-	if (Blt_TreeGetValue((Tcl_Interp *)NULL, cmdPtr->tree, *n1Ptr, 
-	     sortData.key, &valueObjPtr) == TCL_OK) {
-	    s1 = Tcl_GetString(valueObjPtr);
-	}
-	if (Blt_TreeGetValue((Tcl_Interp *)NULL, cmdPtr->tree, *n2Ptr, 
-	     sortData.key, &valueObjPtr) == TCL_OK) {
-	    s2 = Tcl_GetString(valueObjPtr);
-	}
-    } else if (sortData.flags & SORT_PATHNAME)  {
-	Blt_TreeNode root;
-	
-	root = Blt_TreeRootNode(cmdPtr->tree);
-	s1 = GetNodePath(cmdPtr, root, *n1Ptr, FALSE, &dString1);
-	s2 = GetNodePath(cmdPtr, root, *n2Ptr, FALSE, &dString2);
-    } else {
-	s1 = Blt_TreeNodeLabel(*n1Ptr);
-	s2 = Blt_TreeNodeLabel(*n2Ptr);
-    }
     switch (sortData.type) {
     case SORT_ASCII:
-	result = strcmp(s1, s2);
+	result = strcmp(k1Ptr->string, k2Ptr->string);
 	break;
 
     case SORT_COMMAND:
 	if (sortData.command == NULL) {
-	    result = Blt_DictionaryCompare(s1, s2);
+	    result = Blt_DictionaryCompare(k1Ptr->string, k2Ptr->string);
 	} else {
 	    Tcl_DString dsCmd, dsName;
 	    char *qualName;
@@ -7874,10 +9928,12 @@ CompareNodes(Blt_TreeNode *n1Ptr, Blt_TreeNode *n2Ptr)
 		Tcl_GetCommandName(cmdPtr->interp, cmdPtr->cmdToken), &dsName);
 	    Tcl_DStringAppendElement(&dsCmd, qualName);
 	    Tcl_DStringFree(&dsName);
-	    Tcl_DStringAppendElement(&dsCmd, Blt_Itoa(Blt_TreeNodeId(*n1Ptr)));
-	    Tcl_DStringAppendElement(&dsCmd, Blt_Itoa(Blt_TreeNodeId(*n2Ptr)));
-	    Tcl_DStringAppendElement(&dsCmd, s1);
-	    Tcl_DStringAppendElement(&dsCmd, s2);
+	    Tcl_DStringAppendElement(&dsCmd, 
+		Blt_Itoa(Blt_TreeNodeId(k1Ptr->node)));
+	    Tcl_DStringAppendElement(&dsCmd, 
+		Blt_Itoa(Blt_TreeNodeId(k2Ptr->node)));
+	    Tcl_DStringAppendElement(&dsCmd, k1Ptr->string);
+	    Tcl_DStringAppendElement(&dsCmd, k2Ptr->string);
 	    result = Tcl_GlobalEval(cmdPtr->interp, Tcl_DStringValue(&dsCmd));
 	    Tcl_DStringFree(&dsCmd);
 	    
@@ -7894,58 +9950,173 @@ CompareNodes(Blt_TreeNode *n1Ptr, Blt_TreeNode *n2Ptr)
 	break;
 
     case SORT_DICTIONARY:
-	result = Blt_DictionaryCompare(s1, s2);
+	result = Blt_DictionaryCompare(k1Ptr->string, k2Ptr->string);
 	break;
 
     case SORT_INTEGER:
-	{
-	    int i1, i2;
-
-	    if (Tcl_GetInt(NULL, s1, &i1) == TCL_OK) {
-		if (Tcl_GetInt(NULL, s2, &i2) == TCL_OK) {
-		    result = i1 - i2;
-		} else {
-		    result = -1;
-		} 
-	    } else if (Tcl_GetInt(NULL, s2, &i2) == TCL_OK) {
-		result = 1;
+	if (k1Ptr->isNumber) {
+	    if (k2Ptr->isNumber) {
+		result = (k1Ptr->number.i < k2Ptr->number.i) ? -1 : 
+		    (k1Ptr->number.i > k2Ptr->number.i) ? 1 : 0;
 	    } else {
-		result = Blt_DictionaryCompare(s1, s2);
+		result = -1;
 	    }
+	} else if (k2Ptr->isNumber) {
+	    result = 1;
+	} else {
+	    result = Blt_DictionaryCompare(k1Ptr->string, k2Ptr->string);
 	}
 	break;
 
     case SORT_REAL:
-	{
-	    double r1, r2;
-
-	    if (Tcl_GetDouble(NULL, s1, &r1) == TCL_OK) {
-		if (Tcl_GetDouble(NULL, s2, &r2) == TCL_OK) {
-		    result = (r1 < r2) ? -1 : (r1 > r2) ? 1 : 0;
-		} else {
-		    result = -1;
-		} 
-	    } else if (Tcl_GetDouble(NULL, s2, &r2) == TCL_OK) {
-		result = 1;
+	if (k1Ptr->isNumber) {
+	    if (k2Ptr->isNumber) {
+		result = (k1Ptr->number.d < k2Ptr->number.d) ? -1 : 
+		    (k1Ptr->number.d > k2Ptr->number.d) ? 1 : 0;
 	    } else {
-		result = Blt_DictionaryCompare(s1, s2);
+		result = -1;
 	    }
+	} else if (k2Ptr->isNumber) {
+	    result = 1;
+	} else {
+	    result = Blt_DictionaryCompare(k1Ptr->string, k2Ptr->string);
 	}
 	break;
     }
     if (result == 0) {
-	result = Blt_TreeNodeId(*n1Ptr) - Blt_TreeNodeId(*n2Ptr);
+	result = Blt_TreeNodeId(k1Ptr->node) - Blt_TreeNodeId(k2Ptr->node);
     }
     if (sortData.flags & SORT_DECREASING) {
 	result = -result;
     } 
-    if (sortData.flags & SORT_PATHNAME) {
-	Tcl_DStringFree(&dString1);
-	Tcl_DStringFree(&dString2);
-    }
     return result;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * SortKeys --
+ *
+ *	Sorts an array of keys.  Short runs are insertion sorted,
+ *	then merged bottom-up.  Runs that are already in order (as
+ *	when resorting a sorted node) are copied without merging.
+ *
+ * Results:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+SortKeys(SortKey *keyArr, int nKeys)
+{
+    SortKey *srcArr, *destArr, *tmpArr;
+    int i, j, width;
+
+    for (i = 0; i < nKeys; i += SORT_RUN) {
+	SortKey *runArr;
+	int nRun;
+
+	runArr = keyArr + i;
+	nRun = MIN(SORT_RUN, nKeys - i);
+	for (j = 1; j < nRun; j++) {
+	    SortKey key;
+	    int k;
+
+	    key = runArr[j];
+	    for (k = j; (k > 0) && (CompareSortKeys(runArr + k - 1, &key) > 0);
+		 k--) {
+		runArr[k] = runArr[k - 1];
+	    }
+	    runArr[k] = key;
+	}
+    }
+    if (nKeys <= SORT_RUN) {
+	return;
+    }
+    tmpArr = Blt_Malloc(nKeys * sizeof(SortKey));
+    assert(tmpArr);
+    srcArr = keyArr, destArr = tmpArr;
+    for (width = SORT_RUN; width < nKeys; width += width) {
+	for (i = 0; i < nKeys; i += width + width) {
+	    SortKey *p, *pEnd, *q, *qEnd, *dp;
+
+	    p = srcArr + i;
+	    pEnd = q = srcArr + MIN(i + width, nKeys);
+	    qEnd = srcArr + MIN(i + width + width, nKeys);
+	    dp = destArr + i;
+	    if ((q == qEnd) || (CompareSortKeys(pEnd - 1, q) <= 0)) {
+		memcpy(dp, p, (qEnd - p) * sizeof(SortKey));
+		continue;
+	    }
+	    while ((p < pEnd) && (q < qEnd)) {
+		if (CompareSortKeys(q, p) < 0) {
+		    *dp++ = *q++;
+		} else {
+		    *dp++ = *p++;
+		}
+	    }
+	    while (p < pEnd) {
+		*dp++ = *p++;
+	    }
+	    while (q < qEnd) {
+		*dp++ = *q++;
+	    }
+	}
+	tmpArr = srcArr, srcArr = destArr, destArr = tmpArr;
+    }
+    if (srcArr != keyArr) {
+	memcpy(keyArr, srcArr, nKeys * sizeof(SortKey));
+	destArr = srcArr;
+    }
+    Blt_Free(destArr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SortNodes --
+ *
+ *	Extracts the sort keys of the children of a node, or of all
+ *	the nodes of its subtree, and sorts them.
+ *
+ * Results:
+ *	Returns the number of keys.  The sorted array is returned
+ *	in keysPtr and must be freed with FreeSortKeys.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+SortNodes(Blt_TreeNode top, int recurse, SortKey **keysPtr)
+{
+    Blt_TreeNode node;
+    SortKey *keyArr, *keyPtr;
+    int nKeys;
+
+    if (recurse) {
+	nKeys = Blt_TreeSize(top);
+    } else {
+	nKeys = Blt_TreeNodeDegree(top);
+    }
+    keyArr = Blt_Malloc((nKeys + 1) * sizeof(SortKey));
+    assert(keyArr);
+    keyPtr = keyArr;
+    if (recurse) {
+	for(node = top; node != NULL; node = Blt_TreeNextNode(top, node)) {
+	    InitSortKey(keyPtr, node);
+	    keyPtr++;
+	}
+    } else {
+	for (node = Blt_TreeFirstChild(top); node != NULL;
+	     node = Blt_TreeNextSibling(node)) {
+	    InitSortKey(keyPtr, node);
+	    keyPtr++;
+	}
+    }
+    SortKeys(keyArr, nKeys);
+    *keysPtr = keyArr;
+    return nKeys;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -7954,7 +10125,7 @@ CompareNodes(Blt_TreeNode *n1Ptr, Blt_TreeNode *n2Ptr)
  *	Sorts the subnodes at a given node.
  *
  * Results:
- *	Always returns TCL_OK.
+ *	A standard Tcl result.
  *
  *----------------------------------------------------------------------
  */
@@ -7966,14 +10137,25 @@ SortApplyProc(
     int order)			/* Not used. */
 {
     TreeCmd *cmdPtr = clientData;
+    Blt_TreeNode *nodeArr;
+    SortKey *keyArr;
+    int i, nKeys, result;
 
-    if (!Blt_TreeIsLeaf(node)) {
-	Blt_TreeSortNode(cmdPtr->tree, node, CompareNodes);
+    if (Blt_TreeNodeDegree(node) < 2) {
+	return TCL_OK;
     }
-    return TCL_OK;
+    nKeys = SortNodes(node, FALSE, &keyArr);
+    nodeArr = Blt_Malloc(nKeys * sizeof(Blt_TreeNode));
+    assert(nodeArr);
+    for (i = 0; i < nKeys; i++) {
+	nodeArr[i] = keyArr[i].node;
+    }
+    FreeSortKeys(keyArr, nKeys);
+    result = Blt_TreeReorderNode(cmdPtr->tree, node, nodeArr);
+    Blt_Free(nodeArr);
+    return result;
 }
 
-
 /*
  *----------------------------------------------------------------------
  *
@@ -8008,39 +10190,22 @@ SortOp(
     data.cmdPtr = cmdPtr;
     sortData = data;
     if (data.mode == SORT_FLAT) {
-	Blt_TreeNode *p, *nodeArr, node;
-	int nNodes;
-	Tcl_Obj *objPtr, *listObjPtr;
-	int i;
+	SortKey *keyArr;
+	Tcl_Obj **objArr;
+	int i, nKeys;
 
-	if (data.flags & SORT_RECURSE) {
-	    nNodes = Blt_TreeSize(top);
-	} else {
-	    nNodes = Blt_TreeNodeDegree(top);
-	}
-	nodeArr = Blt_Calloc(nNodes, sizeof(Blt_TreeNode));
-	assert(nodeArr);
-	p = nodeArr;
-	if (data.flags & SORT_RECURSE) {
-	    for(node = top; node != NULL; node = Blt_TreeNextNode(top, node)) {
-		*p++ = node;
-	    }
-	} else {
-	    for (node = Blt_TreeFirstChild(top); node != NULL;
-		 node = Blt_TreeNextSibling(node)) {
-		*p++ = node;
-	    }
+	nKeys = SortNodes(top, data.flags & SORT_RECURSE, &keyArr);
+	objArr = Blt_Malloc((nKeys + 1) * sizeof(Tcl_Obj *));
+	assert(objArr);
+	for (i = 0; i < nKeys; i++) {
+	    objArr[i] = Tcl_NewIntObj(Blt_TreeNodeId(keyArr[i].node));
 	}
-	qsort((char *)nodeArr, nNodes, sizeof(Blt_TreeNode),
-	      (QSortCompareProc *)CompareNodes);
-	listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
-	for (p = nodeArr, i = 0; i < nNodes; i++, p++) {
-	    objPtr = Tcl_NewIntObj(Blt_TreeNodeId(*p));
-	    Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
-	}
-	Tcl_SetObjResult(interp, listObjPtr);
-	Blt_Free(nodeArr);
+	Tcl_SetObjResult(interp, Tcl_NewListObj(nKeys, objArr));
+	Blt_Free(objArr);
+	FreeSortKeys(keyArr, nKeys);
 	result = TCL_OK;
+    } else if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+	result = TCL_ERROR;
     } else {
 	if (data.flags & SORT_RECURSE) {
 	    result = Blt_TreeApply(top, SortApplyProc, cmdPtr);
@@ -8473,920 +10638,1624 @@ doit:
             break;
         }
     }
-    if (nobreak && result == TCL_BREAK) {
-        result = TCL_OK;
+    if (nobreak && result == TCL_BREAK) {
+        result = TCL_OK;
+    }
+
+    if (result == TCL_OK) {
+        Tcl_SetObjResult(interp, Tcl_NewIntObj(cnt));
+    }
+doneall:
+    if (listObjPtr != NULL) { Tcl_DecrRefCount(listObjPtr); }
+    if (aListObjPtr != NULL) { Tcl_DecrRefCount(aListObjPtr); }
+    if (nullObj != NULL) { Tcl_DecrRefCount(nullObj); }
+    if (nodeObj != NULL) { Tcl_DecrRefCount(nodeObj); }
+    if (starObj != NULL) { Tcl_DecrRefCount(starObj); }
+    DoneTaggedNodes(&cursor);
+    if (keyList != NULL) {
+        Tcl_DecrRefCount(keyList);
+    }
+    if (keySet != NULL) {
+        Blt_Free(keySet);
+    }
+    return result;
+    
+error:
+    result = TCL_ERROR;
+    goto doneall;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ForeachOp --
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+ForeachOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode node;
+    int len, result;
+    char *var/*, *string*/;
+    TagSearch cursor = {0};
+
+    var = Tcl_GetString(objv[2]);
+
+    if (objc != 5) {
+        Tcl_AppendResult(interp, "wrong number of args ", 0);
+        return TCL_ERROR;
+    }
+    /*string =*/ Tcl_GetStringFromObj(objv[3],&len);
+    if (len == 0) {
+        Tcl_SetObjResult(interp, Tcl_NewIntObj(0));
+        return TCL_OK;
+    }
+    
+    if (FindTaggedNodes(interp, cmdPtr, objv[3], &cursor) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    result = TCL_OK;
+    for (node = FirstTaggedNode(&cursor);
+        node != NULL; result = TCL_OK, node = NextTaggedNode(node, &cursor)) {
+
+        if (Tcl_SetVar2Ex(interp, var, 0, Tcl_NewIntObj(Blt_TreeNodeId(node)),
+            0) == NULL) {
+            goto error;
+        }
+        result = Tcl_EvalObjEx(interp, objv[4], 0);
+        if (cmdPtr->delete) {
+            goto error;
+        }
+        if (result == TCL_BREAK) { result = TCL_OK; break; }
+        if (result == TCL_CONTINUE ) continue;
+	if (result == TCL_ERROR) {
+            Tcl_AppendResult(interp,
+            "\n    (\"tree foreach\" body line ", Blt_Itoa(Tcl_GetErrorLine(interp)), ")\n", 0);
+             break;
+        }
+        if (result != TCL_OK) {
+            break;
+        }
+    }
+
+    DoneTaggedNodes(&cursor);
+    return result;
+    
+error:
+    DoneTaggedNodes(&cursor);
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NamesOp --
+ *
+ *	Returns the names of keys for a node or array value.
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+NamesOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_TreeNode node;
+    Tcl_Obj *listObjPtr;
+    
+    if (objc>2) {
+        if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+            return TCL_ERROR;
+        }
+    } else {
+        node = Blt_TreeRootNode(cmdPtr->tree);
+    }
+    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+    if (objc >= 4) { 
+	char *string;
+
+	string = Tcl_GetString(objv[3]);
+	if (Blt_TreeArrayNames(interp, cmdPtr->tree, node, string, listObjPtr,
+	       objc>4?Tcl_GetString(objv[4]):NULL)
+	    != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    } else {
+	Blt_TreeKey key;
+	Tcl_Obj *objPtr;
+	Blt_TreeKeySearch keyIter;
+
+	for (key = Blt_TreeFirstKey(cmdPtr->tree, node, &keyIter); key != NULL; 
+	     key = Blt_TreeNextKey(cmdPtr->tree, &keyIter)) {
+	    objPtr = Tcl_NewStringObj(key, -1);
+	    Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
+	}	    
+    }
+    Tcl_SetObjResult(interp, listObjPtr);
+    return TCL_OK;
+}
+
+/*
+*----------------------------------------------------------------------
+*
+* ValuesOp --
+*
+*	Returns the values of keys for a node or array value.
+*
+*---------------------------------------------------------------------- 
+*/
+static int
+ValuesOp(
+TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+    {
+    Blt_TreeNode node;
+    Tcl_Obj *listObjPtr;
+    int names = 0;
+    
+    if (objc>2) {
+        if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
+            return TCL_ERROR;
+        }
+    } else {
+        node = Blt_TreeRootNode(cmdPtr->tree);
+    }
+    if (objc>4 && Tcl_GetBooleanFromObj(interp, objv[4], &names) != TCL_OK) {
+        return TCL_ERROR;
     }
+    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+    if (objc >= 4) { 
+        char *string;
 
-    if (result == TCL_OK) {
-        Tcl_SetObjResult(interp, Tcl_NewIntObj(cnt));
-    }
-doneall:
-    if (listObjPtr != NULL) { Tcl_DecrRefCount(listObjPtr); }
-    if (aListObjPtr != NULL) { Tcl_DecrRefCount(aListObjPtr); }
-    if (nullObj != NULL) { Tcl_DecrRefCount(nullObj); }
-    if (nodeObj != NULL) { Tcl_DecrRefCount(nodeObj); }
-    if (starObj != NULL) { Tcl_DecrRefCount(starObj); }
-    DoneTaggedNodes(&cursor);
-    if (keyList != NULL) {
-        Tcl_DecrRefCount(keyList);
-    }
-    if (keySet != NULL) {
-        Blt_Free(keySet);
+        string = Tcl_GetString(objv[3]);
+        if (Blt_TreeArrayValues(interp, cmdPtr->tree, node, string, listObjPtr, names)
+        != TCL_OK) {
+            Tcl_DecrRefCount(listObjPtr);
+            return TCL_ERROR;
+        }
+    } else {
+        Blt_TreeKey key;
+        Tcl_Obj *objPtr;
+        Blt_TreeKeySearch keyIter;
+
+        for (key = Blt_TreeFirstKey(cmdPtr->tree, node, &keyIter); key != NULL; 
+        key = Blt_TreeNextKey(cmdPtr->tree, &keyIter)) {
+            if (Blt_TreeGetValueByKey(interp, cmdPtr->tree, node, key, &objPtr) != TCL_OK) {
+                Tcl_DecrRefCount(listObjPtr);
+                return TCL_ERROR;
+            }
+            Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
+        }	    
     }
-    return result;
-    
-error:
-    result = TCL_ERROR;
-    goto doneall;
+    Tcl_SetObjResult(interp, listObjPtr);
+    return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * ForeachOp --
+ * OldValueOp --
+ *
+ *	Returns the old value before last update
  *
  *---------------------------------------------------------------------- 
  */
 static int
-ForeachOp(
+OldValueOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *CONST *objv)
 {
+    Tcl_Obj *objPtr = NULL;
+    int len;
+    
+    if (objc>2) {
+        Blt_TreeOldValue(interp, cmdPtr->tree, &objPtr, objv[2]);
+        return TCL_OK;
+    }
+    Blt_TreeOldValue(interp, cmdPtr->tree, &objPtr, NULL);
+    if (objPtr == NULL) {
+        return TCL_OK;
+    }
+    /* If last update was append/lappend, return truncated value. */
+    if (cmdPtr->updTyp == 1) {
+        Tcl_GetStringFromObj(objPtr, &len);
+        if (len>cmdPtr->oldLen && cmdPtr->oldLen>=0) {
+            objPtr = Tcl_DuplicateObj(objPtr);
+            Tcl_SetObjLength(objPtr, cmdPtr->oldLen);
+        }
+    } else if (cmdPtr->updTyp == 2) {
+        if (Tcl_ListObjLength(interp, objPtr, &len) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if (len>cmdPtr->oldLen && cmdPtr->oldLen>=0) {
+            objPtr = Tcl_DuplicateObj(objPtr);
+            if (Tcl_ListObjReplace(interp, objPtr, cmdPtr->oldLen, len-cmdPtr->oldLen, 0, NULL) != TCL_OK) {
+                return TCL_ERROR;
+            }
+        }
+    } 
+    Tcl_SetObjResult(interp, objPtr);
+    return TCL_OK;
+}
+
+typedef struct SqlData {
+    TreeCmd *cmdPtr;
+    Blt_TreeNode parent;
+    int insertPos;
+    Tcl_Interp *interp;
+    int cnt;
+    int rc;
+    int max;
+    int llen;
+    char *labelcol;
+    char *tagcol;
+    char *key;
+    int rinc;
+    char *nullstr;
+    Tcl_Obj *tags;
+    int vobjc;
+    Tcl_Obj **vobjv;
+    Tcl_Obj *skipcols;
+    Tcl_Obj *treecols;
+    Tcl_Obj *pathcol ;
+    int fixed;
+} SqlData;
+
+#ifdef BLT_USE_OLD_SQLITE
+/*
+ * Callback for sqlload.
+ *
+ */
+static int SqlCallback(SqlData *sqlPtr, int argc, char **argv, char **azColName)
+{
+    int i, rid, lid, n, tcid;
+    Tcl_Interp *interp = sqlPtr->interp;
+    TreeCmd *cmdPtr = sqlPtr->cmdPtr;
     Blt_TreeNode node;
-    int len, result;
-    char *var/*, *string*/;
-    TagSearch cursor = {0};
+    char string[200];
+    Tcl_Obj *objPtr;
+    Tcl_DString dStr;
+    char *label = NULL;
+    
+    rid = -1;
+    n = -1;
+    lid = -1;
+    tcid = -1;
+    if (sqlPtr->rinc>0) {
+        for(i=0; i<argc; i++){
+            if (argv[i]==NULL) continue;
+            if (azColName[i][0] == 'r' && !strcmp(azColName[i], "rowid")) {
+                rid = atoi(argv[i])+sqlPtr->rinc;
+                n = i;
+                break;
+            }
+        }
+    }
+    if (sqlPtr->labelcol != NULL && sqlPtr->labelcol[0]) {
+        for(i=0; i<argc; i++){
+            if (argv[i]==NULL) continue;
+            if (azColName[i][0] == sqlPtr->labelcol[0]
+            && !strcmp(azColName[i], sqlPtr->labelcol)) {
+                lid = i;
+                label = argv[i];
+                break;
+            }
+        }
+    }
+    if (sqlPtr->tagcol != NULL && sqlPtr->tagcol[0]) {
+        for(i=0; i<argc; i++){
+            if (argv[i]==NULL) continue;
+            if (azColName[i][0] == sqlPtr->tagcol[0]
+            && !strcmp(azColName[i], sqlPtr->agcol)) {
+                tcid = i;
+                break;
+            }
+        }
+    }
+    if (sqlPtr->tagcol != NULL) {
+        if (AddTag(cmdPtr, node, Tcl_GetString(sqlPtr->vobjv[i])) != TCL_OK) {
+            return 1;
+        }
+    }     
 
-    var = Tcl_GetString(objv[2]);
 
-    if (objc != 5) {
-        Tcl_AppendResult(interp, "wrong number of args ", 0);
-        return TCL_ERROR;
+    if (rid>1) {
+        node = Blt_TreeCreateNodeWithId(cmdPtr->tree, sqlPtr->parent, label,
+            rid, sqlPtr->insertPos);
+        if (node == NULL) {
+            Tcl_AppendResult(interp, "node can not be created", 0);
+            sqlPtr->rc = TCL_ERROR;
+            return  1;
+        }
+    } else {
+        node = Blt_TreeCreateNode(cmdPtr->tree, sqlPtr->parent, label,
+            sqlPtr->insertPos);
+        if (node == NULL) {
+            Tcl_AppendResult(interp, "node can not be created", 0);
+            sqlPtr->rc = TCL_ERROR;
+            return 1;
+        }
+    }
+    if (label == NULL) {
+        sprintf(string, "%d", Blt_TreeNodeId(node));
+        Blt_TreeRelabelNode2(node, string);
+    }
+    
+
+    if (sqlPtr->key != NULL) {
+        Tcl_DStringInit(&dStr);
+        for(i=0; i<argc; i++){
+            if (argv[i] == NULL && sqlPtr->nullstr == NULL) continue;
+            if (n == i) continue;
+            Tcl_DStringAppendElement(&dStr, azColName[i]);
+            Tcl_DStringAppendElement(&dStr, argv[i]?argv[i]:sqlPtr->nullstr);
+        }
+        objPtr = Tcl_NewStringObj(Tcl_DStringValue(&dStr), -1);
+        if (Blt_TreeSetValue(interp, cmdPtr->tree, node, sqlPtr->key, objPtr) 
+            != TCL_OK) {
+            Tcl_DecrRefCount(objPtr);
+            sqlPtr->rc = TCL_ERROR;
+            return 1;
+        }
+    } else {
+        for(i=0; i<argc; i++){
+            if (argv[i] == NULL && sqlPtr->nullstr == NULL) continue;
+            if (n == i) continue; */
+            objPtr = Tcl_NewStringObj(argv[i]?argv[i]:sqlPtr->nullstr, -1);
+            if (Blt_TreeSetValue(interp, cmdPtr->tree, node, azColName[i], objPtr) 
+            != TCL_OK) {
+                Tcl_DecrRefCount(objPtr);
+                sqlPtr->rc = TCL_ERROR;
+                return 1;
+            }
+        }
+    }
+    if (sqlPtr->tags != NULL) {        
+        for (i=0; i<sqlPtr->vobjc; i++) {
+            if (AddTag(cmdPtr, node, Tcl_GetString(sqlPtr->vobjv[i])) != TCL_OK) {
+                return 1;
+            }
+        }
+    }
+    if (Blt_TreeInsertPost(cmdPtr->tree, node) == NULL) {
+        DeleteNode(cmdPtr, node);
+        return 1;
     }
-    /*string =*/ Tcl_GetStringFromObj(objv[3],&len);
-    if (len == 0) {
-        Tcl_SetObjResult(interp, Tcl_NewIntObj(0));
-        return TCL_OK;
+    if (sqlPtr->fixed) {
+        node->flags |= TREE_NODE_FIXED_FIELDS;
     }
     
-    if (FindTaggedNodes(interp, cmdPtr, objv[3], &cursor) != TCL_OK) {
-        return TCL_ERROR;
-    }
-    result = TCL_OK;
-    for (node = FirstTaggedNode(&cursor);
-        node != NULL; result = TCL_OK, node = NextTaggedNode(node, &cursor)) {
-
-        if (Tcl_SetVar2Ex(interp, var, 0, Tcl_NewIntObj(Blt_TreeNodeId(node)),
-            0) == NULL) {
-            goto error;
-        }
-        result = Tcl_EvalObjEx(interp, objv[4], 0);
-        if (cmdPtr->delete) {
-            goto error;
-        }
-        if (result == TCL_BREAK) { result = TCL_OK; break; }
-        if (result == TCL_CONTINUE ) continue;
-	if (result == TCL_ERROR) {
-            Tcl_AppendResult(interp,
-            "\n    (\"tree foreach\" body line ", Blt_Itoa(Tcl_GetErrorLine(interp)), ")\n", 0);
-             break;
-        }
-        if (result != TCL_OK) {
-            break;
-        }
+    sqlPtr->cnt++;
+    if (sqlPtr->max > 0 && sqlPtr->cnt >= sqlPtr->max) {
+        sqlPtr->rc = TCL_BREAK;
+        return 1;
     }
 
-    DoneTaggedNodes(&cursor);
-    return result;
-    
-error:
-    DoneTaggedNodes(&cursor);
-    return TCL_ERROR;
+    return 0;
 }
-
+#else
 /*
- *----------------------------------------------------------------------
- *
- * NamesOp --
- *
- *	Returns the names of keys for a node or array value.
+ * Obj Callback for sqlload.
  *
- *---------------------------------------------------------------------- 
  */
-static int
-NamesOp(
-    TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,
-    Tcl_Obj *CONST *objv)
+#if 0
+static int SqlCallbackObj(SqlData *sqlPtr, int argc, Tcl_Obj **objv, Tcl_Obj **azColName)
 {
+    int i, j, rid, lid, n, tcid, vobjc, tobjc;
+    Tcl_Interp *interp = sqlPtr->interp;
+    TreeCmd *cmdPtr = sqlPtr->cmdPtr;
     Blt_TreeNode node;
-    Tcl_Obj *listObjPtr;
+    char string[200];
+    Tcl_Obj *objPtr, **vobjv, **tobjv;
+    Tcl_DString dStr;
+    char *label = NULL, *cn, *ridStr = "";
+    int treeCols[100], pcol = -1;
     
-    if (objc>2) {
-        if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
-            return TCL_ERROR;
+    rid = -1;
+    n = -1;
+    lid = -1;
+    tcid = -1;
+    if (sqlPtr->rinc>0) {
+        for(i=0; i<argc; i++){
+            if (objv[i]==NULL) continue;
+            cn = Tcl_GetString(azColName[i]);
+            if (cn[0] == 'r' && !strcmp(cn, "rowid")) {
+                if (Tcl_GetIntFromObj(NULL, objv[i], &rid) == TCL_OK) {
+                    rid += sqlPtr->rinc;
+                    ridStr = Tcl_GetString(objv[i]);
+                    n = i;
+                    break;
+                }
+            }
+        }
+    }
+    if (sqlPtr->labelcol != NULL && sqlPtr->labelcol[0]) {
+        for(i=0; i<argc; i++){
+            if (objv[i]==NULL) continue;
+            cn = Tcl_GetString(azColName[i]);
+            if (cn[0] == sqlPtr->labelcol[0]
+            && !strcmp(cn, sqlPtr->labelcol)) {
+                lid = i;
+                label = (objv[i] ? Tcl_GetString(objv[i]) : sqlPtr->nullstr );
+                break;
+            }
+        }
+    }
+    if (sqlPtr->treecols) {
+            
+        if (Tcl_ListObjGetElements(interp, sqlPtr->treecols, &tobjc, &tobjv) 
+        != TCL_OK || tobjc>=100) {
+            sqlPtr->rc = TCL_ERROR;
+            return 1;
+        }
+        for (i=0; i<tobjc; i++) {
+            treeCols[i] = -1;
+        }
+    }
+    if (rid>=1) {
+        node = Blt_TreeCreateNodeWithId(cmdPtr->tree, sqlPtr->parent, label,
+            rid, sqlPtr->insertPos);
+        if (node == NULL) {
+            Tcl_AppendResult(interp, "node can not be created with id: ", ridStr, 0);
+            sqlPtr->rc = TCL_ERROR;
+            return  1;
         }
     } else {
-        node = Blt_TreeRootNode(cmdPtr->tree);
+        node = Blt_TreeCreateNode(cmdPtr->tree, sqlPtr->parent, label,
+            sqlPtr->insertPos);
+        if (node == NULL) {
+            Tcl_AppendResult(interp, "node can not be created", 0);
+            sqlPtr->rc = TCL_ERROR;
+            return 1;
+        }
     }
-    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
-    if (objc >= 4) { 
-	char *string;
+    if (label == NULL) {
+        sprintf(string, "%d", Blt_TreeNodeId(node));
+        Blt_TreeRelabelNode2(node, string);
+    }
+    
 
-	string = Tcl_GetString(objv[3]);
-	if (Blt_TreeArrayNames(interp, cmdPtr->tree, node, string, listObjPtr,
-	       objc>4?Tcl_GetString(objv[4]):NULL)
-	    != TCL_OK) {
-	    return TCL_ERROR;
-	}
-    } else {
-	Blt_TreeKey key;
-	Tcl_Obj *objPtr;
-	Blt_TreeKeySearch keyIter;
+    Tcl_DStringInit(&dStr);
+    for(i=0; i<argc; i++){
+        int clen;
+        if (objv[i] == NULL && sqlPtr->nullstr == NULL) continue;
+        cn = Tcl_GetStringFromObj(azColName[i], &clen);
+        if (sqlPtr->treecols) {
+            for (j=0; j<tobjc; j++) {
+                if (!strcmp(Tcl_GetString(azColName[i]), Tcl_GetString(tobjv[j]))) {
+                    treeCols[j] = i;
+                    break;
+                }
+            }
+        }
+        if (sqlPtr->pathcol) {
+            if (!strcmp(Tcl_GetString(azColName[i]), Tcl_GetString(sqlPtr->pathcol))) {
+                pcol = i;
+            }
+        }
+        if (sqlPtr->tagcol != NULL && sqlPtr->tagcol[0] &&
+            strcmp(cn, sqlPtr->tagcol) == 0) {
+            if (AddTag(cmdPtr, node, Tcl_GetString(objv[i])) != TCL_OK) {
+                goto error;
+            }
+            continue;
+        }
 
-	for (key = Blt_TreeFirstKey(cmdPtr->tree, node, &keyIter); key != NULL; 
-	     key = Blt_TreeNextKey(cmdPtr->tree, &keyIter)) {
-	    objPtr = Tcl_NewStringObj(key, -1);
-	    Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
-	}	    
+        if (sqlPtr->skipcols) {
+            char *sc;
+            int slen;
+            
+            if (Tcl_ListObjGetElements(interp, sqlPtr->skipcols, &vobjc, &vobjv) 
+            != TCL_OK) {
+                goto error;
+            }
+            for (j=0; j<vobjc; j++) {
+                sc = Tcl_GetStringFromObj(vobjv[j], &slen);
+                if (slen == clen && *sc == *cn && strcmp(cn, sc) == 0) {
+                    break;
+                }
+            }
+            if (j<vobjc) continue;
+        }
+        if (sqlPtr->key != NULL) {
+            Tcl_DStringAppendElement(&dStr, cn);
+            Tcl_DStringAppendElement(&dStr, objv[i]?Tcl_GetString(objv[i]):sqlPtr->nullstr);
+        } else {
+            if (objv[i] != NULL) {
+                objPtr = objv[i];
+            } else {
+                objPtr = Tcl_NewStringObj(sqlPtr->nullstr, -1);
+            }
+            if (Blt_TreeSetValue(interp, cmdPtr->tree, node, cn, objPtr) 
+                != TCL_OK) {
+                Tcl_DecrRefCount(objPtr);
+                sqlPtr->rc = TCL_ERROR;
+                goto error;;
+            }
+        }
+    }
+    if (sqlPtr->key != NULL) {
+        /* Set all values in a single key. */
+        objPtr = Tcl_NewStringObj(Tcl_DStringValue(&dStr), -1);
+        if (Blt_TreeSetValue(interp, cmdPtr->tree, node, sqlPtr->key, objPtr) 
+        != TCL_OK) {
+            Tcl_DecrRefCount(objPtr);
+            sqlPtr->rc = TCL_ERROR;
+            goto error;
+        }
     }
-    Tcl_SetObjResult(interp, listObjPtr);
-    return TCL_OK;
-}
 
-/*
-*----------------------------------------------------------------------
-*
-* ValuesOp --
-*
-*	Returns the values of keys for a node or array value.
-*
-*---------------------------------------------------------------------- 
-*/
-static int
-ValuesOp(
-TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,
-    Tcl_Obj *CONST *objv)
-    {
-    Blt_TreeNode node;
-    Tcl_Obj *listObjPtr;
-    int names = 0;
+    if (sqlPtr->tags != NULL) {        
+        for (i=0; i<sqlPtr->vobjc; i++) {
+            if (AddTag(cmdPtr, node, Tcl_GetString(sqlPtr->vobjv[i])) != TCL_OK) {
+                goto error;
+            }
+        }
+    }
     
-    if (objc>2) {
-        if (GetNode(cmdPtr, objv[2], &node) != TCL_OK) {
-            return TCL_ERROR;
+    if (sqlPtr->treecols) {
+        Blt_TreeNode snode, parent = sqlPtr->parent;
+        for (i=0; i<tobjc; i++) {
+            if (treeCols[i] == -1) {
+                Tcl_AppendResult(interp, "missing col in -treecols", 0);
+                goto error;
+            }
+        }
+        for (i=0; i<tobjc; i++) {
+            char *tcp;
+            tcp = Tcl_GetString(objv[treeCols[i]]);
+            snode = Blt_TreeFindChild(parent, tcp);
+            if (snode != NULL) {
+                parent = snode;
+                continue;
+            }
+            snode = Blt_TreeCreateNode(cmdPtr->tree, parent, tcp, -1);
+            if (snode == NULL) {
+                goto error;
+            }
+            parent = snode;
+        }
+        if (Blt_TreeMoveNode(cmdPtr->tree, node, parent, NULL) != TCL_OK) {
+            Tcl_AppendResult(interp, "relocate failed in -treecols", 0);
+            goto error;
         }
-    } else {
-        node = Blt_TreeRootNode(cmdPtr->tree);
-    }
-    if (objc>4 && Tcl_GetBooleanFromObj(interp, objv[4], &names) != TCL_OK) {
-        return TCL_ERROR;
     }
-    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
-    if (objc >= 4) { 
-        char *string;
-
-        string = Tcl_GetString(objv[3]);
-        if (Blt_TreeArrayValues(interp, cmdPtr->tree, node, string, listObjPtr, names)
-        != TCL_OK) {
-            Tcl_DecrRefCount(listObjPtr);
-            return TCL_ERROR;
+    if (sqlPtr->pathcol && pcol >= 0) {
+        Blt_TreeNode snode, parent = sqlPtr->parent;
+        if (Tcl_ListObjGetElements(interp, vobjv[pcol], &tobjc, &tobjv) 
+            != TCL_OK) {
+            goto error;
         }
-    } else {
-        Blt_TreeKey key;
-        Tcl_Obj *objPtr;
-        Blt_TreeKeySearch keyIter;
-
-        for (key = Blt_TreeFirstKey(cmdPtr->tree, node, &keyIter); key != NULL; 
-        key = Blt_TreeNextKey(cmdPtr->tree, &keyIter)) {
-            if (Blt_TreeGetValueByKey(interp, cmdPtr->tree, node, key, &objPtr) != TCL_OK) {
-                Tcl_DecrRefCount(listObjPtr);
-                return TCL_ERROR;
+        for (i=0; i<tobjc; i++) {
+            char *tcp;
+            tcp = Tcl_GetString(tobjv[i]);
+            snode = Blt_TreeFindChild(parent, tcp);
+            if (snode != NULL) {
+                parent = snode;
+                continue;
             }
-            Tcl_ListObjAppendElement(interp, listObjPtr, objPtr);
-        }	    
+            snode = Blt_TreeCreateNode(cmdPtr->tree, parent, tcp, -1);
+            if (snode == NULL) {
+                goto error;
+            }
+            parent = snode;
+        }
+        if (Blt_TreeMoveNode(cmdPtr->tree, node, parent, NULL) != TCL_OK) {
+            Tcl_AppendResult(interp, "relocate failed in -pathcol", 0);
+            goto error;
+        }
     }
-    Tcl_SetObjResult(interp, listObjPtr);
-    return TCL_OK;
+
+    if (Blt_TreeInsertPost(cmdPtr->tree, node) == NULL) {
+        goto error;
+    }
+    Tcl_DStringFree(&dStr);
+    if (sqlPtr->fixed || (cmdPtr->tree->treeObject->flags & TREE_FIXED_KEYS)) {
+        node->flags |= TREE_NODE_FIXED_FIELDS;
+    }
+    
+    sqlPtr->cnt++;
+    if (sqlPtr->max > 0 && sqlPtr->cnt >= sqlPtr->max) {
+        sqlPtr->rc = TCL_BREAK;
+        return 1;
+    }
+    return 0;
+    
+error:
+    DeleteNode(cmdPtr, node);
+    Tcl_DStringFree(&dStr);
+    return 1;
 }
+#endif
+#endif
+
+#ifndef OMIT_SQLITE3_LOAD
+/* #include <sqlite3.h> */
+
+extern void *sqlite3_tclhandle();
+extern int sqlite3_open();
+extern char *sqlite3_errmsg();
+extern void sqlite3_close(void *);
+extern int sqlite3_exec_tclobj();
+#endif
 
 /*
  *----------------------------------------------------------------------
  *
- * OldValueOp --
+ * SqlloadOp --
  *
- *	Returns the old value before last update
+ *	Load sql
+ * TODO: use sqlite header
  *
  *---------------------------------------------------------------------- 
  */
 static int
-OldValueOp(
+SqlloadOp(
     TreeCmd *cmdPtr,
     Tcl_Interp *interp,
     int objc,
     Tcl_Obj *CONST *objv)
 {
-    Tcl_Obj *objPtr = NULL;
-    int len;
+#ifdef OMIT_SQLITE3_LOAD
+    Tcl_AppendResult(interp, "sqlload unsupported", 0);
+    return TCL_ERROR;
+#else     
+    char *string, *cp;
+    int rc, result, optInd, isFile = 0, sclen, tclen;
+    void *db = NULL;
+    Tcl_Obj *zErrPtr = NULL;
+    /*const char *zErrMsg = 0; */
+    SqlData data;
+    Tcl_DString dStr;
+    Tcl_Obj *CONST *oobjv = objv;
     
-    if (objc>2) {
-        Blt_TreeOldValue(interp, cmdPtr->tree, &objPtr, objv[2]);
-        return TCL_OK;
+    enum optInd {
+        OP_TAGS, OP_FIXED, OP_KEY, OP_LABELCOL, OP_ROWID, OP_MAX,
+        OP_NULLSTR, OP_PARENT, OP_PATHCOL, OP_INSPOS, OP_SKIPCOL, OP_TAGCOL,
+        OP_TREECOLS        
+    };
+    static char *optArr[] = {
+        "-addtags", "-fixed", "-key", "-labelcol", "-maprowid", "-max",
+        "-nullvalue", "-parent", "-pathcol", "-pos", "-skipcols", "-tagcol",
+        "-treecols",
+        0
+    };
+
+    if (CheckWritable(interp, cmdPtr->tree) != TCL_OK) {
+	return TCL_ERROR;
     }
-    Blt_TreeOldValue(interp, cmdPtr->tree, &objPtr, NULL);
-    if (objPtr == NULL) {
-        return TCL_OK;
+    data.cmdPtr = cmdPtr;
+    data.insertPos = -1;
+    data.parent = Blt_TreeRootNode(cmdPtr->tree);
+    data.interp = interp;
+    data.max = 100000;
+    data.cnt = 0;
+    data.rc = TCL_OK;
+    data.rinc = 0;
+    data.fixed = 0;
+    data.key = NULL;
+    data.labelcol = NULL;
+    data.tagcol = NULL;
+    data.skipcols = NULL;
+    data.nullstr = NULL;
+    data.tags = NULL;
+    data.pathcol = NULL;
+    data.treecols = NULL;
+    
+    result = TCL_OK;
+    string = Tcl_GetString(objv[2]);
+    if (objc<4) {
+        Tcl_WrongNumArgs(interp, 2, objv, "?options? dbhfile selectstmt");
+        return TCL_ERROR;
     }
-    /* If last update was append/lappend, return truncated value. */
-    if (cmdPtr->updTyp == 1) {
-        Tcl_GetStringFromObj(objPtr, &len);
-        if (len>cmdPtr->oldLen && cmdPtr->oldLen>=0) {
-            objPtr = Tcl_DuplicateObj(objPtr);
-            Tcl_SetObjLength(objPtr, cmdPtr->oldLen);
-        }
-    } else if (cmdPtr->updTyp == 2) {
-        if (Tcl_ListObjLength(interp, objPtr, &len) != TCL_OK) {
-            return TCL_ERROR;
+    while (objc>4 && string[0] == '-') {
+        if (Tcl_GetIndexFromObj(interp, objv[2], optArr, "option",
+            0, &optInd) != TCL_OK) {
+                return TCL_ERROR;
         }
-        if (len>cmdPtr->oldLen && cmdPtr->oldLen>=0) {
-            objPtr = Tcl_DuplicateObj(objPtr);
-            if (Tcl_ListObjReplace(interp, objPtr, cmdPtr->oldLen, len-cmdPtr->oldLen, 0, NULL) != TCL_OK) {
+        switch (optInd) {
+        
+        case OP_FIXED:
+            data.fixed = 1;
+            objc -= 1;
+            objv += 1;
+            break;
+        
+        case OP_INSPOS:
+            if (objc<6) { goto missingArg; }
+            if (Tcl_GetIntFromObj(interp, objv[3], &data.insertPos)) {
                 return TCL_ERROR;
             }
-        }
-    } 
-    Tcl_SetObjResult(interp, objPtr);
-    return TCL_OK;
-}
+            objc -= 2;
+            objv += 2;
+            break;
 
-typedef struct SqlData {
-    TreeCmd *cmdPtr;
-    Blt_TreeNode parent;
-    int insertPos;
-    Tcl_Interp *interp;
-    int cnt;
-    int rc;
-    int max;
-    int llen;
-    char *labelcol;
-    char *tagcol;
-    char *key;
-    int rinc;
-    char *nullstr;
-    Tcl_Obj *tags;
-    int vobjc;
-    Tcl_Obj **vobjv;
-    Tcl_Obj *skipcols;
-    Tcl_Obj *treecols;
-    Tcl_Obj *pathcol ;
-    int fixed;
-} SqlData;
+        case OP_KEY:
+            if (objc<6) { goto missingArg; }
+            data.key = Tcl_GetString(objv[3]);
+            objc -= 2;
+            objv += 2;
+            break;
+        
+        case OP_LABELCOL:
+            if (objc<6) { goto missingArg; }
+            data.labelcol = Tcl_GetStringFromObj(objv[3], &data.llen);
+            objc -= 2;
+            objv += 2;
+            break;
+        
+        case OP_MAX:
+            if (objc<6) { goto missingArg; }
+            if (Tcl_GetIntFromObj(interp, objv[3], &data.max)) {
+                return TCL_ERROR;
+            }
+            objc -= 2;
+            objv += 2;
+            break;
+            
+        case OP_NULLSTR:
+            if (objc<6) { goto missingArg; }
+            data.nullstr = Tcl_GetStringFromObj(objv[3], &data.llen);
+            objc -= 2;
+            objv += 2;
+            break;
+            
+        case OP_ROWID:
+            if (objc<6) { goto missingArg; }
+            if (Tcl_GetIntFromObj(interp, objv[3], &data.rinc)) {
+                return TCL_ERROR;
+            }
+            if (data.rinc<=0) {
+                Tcl_AppendResult(interp, "-rowidmap must be > 0", 0);
+                return TCL_ERROR;
+            }
 
-#ifdef BLT_USE_OLD_SQLITE
-/*
- * Callback for sqlload.
- *
- */
-static int SqlCallback(SqlData *sqlPtr, int argc, char **argv, char **azColName)
-{
-    int i, rid, lid, n, tcid;
-    Tcl_Interp *interp = sqlPtr->interp;
-    TreeCmd *cmdPtr = sqlPtr->cmdPtr;
-    Blt_TreeNode node;
-    char string[200];
-    Tcl_Obj *objPtr;
-    Tcl_DString dStr;
-    char *label = NULL;
-    
-    rid = -1;
-    n = -1;
-    lid = -1;
-    tcid = -1;
-    if (sqlPtr->rinc>0) {
-        for(i=0; i<argc; i++){
-            if (argv[i]==NULL) continue;
-            if (azColName[i][0] == 'r' && !strcmp(azColName[i], "rowid")) {
-                rid = atoi(argv[i])+sqlPtr->rinc;
-                n = i;
-                break;
+            objc -= 2;
+            objv += 2;
+            break;
+            
+        case OP_PARENT:
+            if (objc<6) { goto missingArg; }
+            if (GetNode(cmdPtr, objv[3], &data.parent) != TCL_OK) {
+                return TCL_ERROR;
             }
-        }
-    }
-    if (sqlPtr->labelcol != NULL && sqlPtr->labelcol[0]) {
-        for(i=0; i<argc; i++){
-            if (argv[i]==NULL) continue;
-            if (azColName[i][0] == sqlPtr->labelcol[0]
-            && !strcmp(azColName[i], sqlPtr->labelcol)) {
-                lid = i;
-                label = argv[i];
-                break;
+            objc -= 2;
+            objv += 2;
+            break;
+            
+        case OP_SKIPCOL:
+            if (objc<6) { goto missingArg; }
+            if (Tcl_ListObjLength(interp, objv[3], &sclen) != TCL_OK) {
+                return TCL_ERROR;
             }
-        }
-    }
-    if (sqlPtr->tagcol != NULL && sqlPtr->tagcol[0]) {
-        for(i=0; i<argc; i++){
-            if (argv[i]==NULL) continue;
-            if (azColName[i][0] == sqlPtr->tagcol[0]
-            && !strcmp(azColName[i], sqlPtr->agcol)) {
-                tcid = i;
-                break;
+            data.skipcols = objv[3];
+            objc -= 2;
+            objv += 2;
+            break;
+            
+        case OP_TAGCOL:
+            if (objc<6) { goto missingArg; }
+            data.tagcol = Tcl_GetStringFromObj(objv[3], &data.llen);
+            objc -= 2;
+            objv += 2;
+            break;
+        
+        case OP_TAGS:
+            if (objc<6) { goto missingArg; }
+            data.tags = objv[3];
+            if (Tcl_ListObjGetElements(interp, data.tags, &data.vobjc, &data.vobjv)
+                != TCL_OK) {
+                return TCL_ERROR;
+            }
+            objc -= 2;
+            objv += 2;
+            break;
+        case OP_TREECOLS:
+            if (objc<6) { goto missingArg; }
+            if (Tcl_ListObjLength(interp, objv[3], &tclen) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            if (tclen>0) {
+                data.treecols = objv[3];
             }
+            objc -= 2;
+            objv += 2;
+            break;
+        case OP_PATHCOL:
+            if (objc<6) { goto missingArg; }
+            data.pathcol = objv[3];
+            objc -= 2;
+            objv += 2;
+            break;
         }
-    }
-    if (sqlPtr->tagcol != NULL) {
-        if (AddTag(cmdPtr, node, Tcl_GetString(sqlPtr->vobjv[i])) != TCL_OK) {
-            return 1;
+        if (objc>2) {
+            string = Tcl_GetString(objv[2]);
         }
-    }     
-
 
-    if (rid>1) {
-        node = Blt_TreeCreateNodeWithId(cmdPtr->tree, sqlPtr->parent, label,
-            rid, sqlPtr->insertPos);
-        if (node == NULL) {
-            Tcl_AppendResult(interp, "node can not be created", 0);
-            sqlPtr->rc = TCL_ERROR;
-            return  1;
-        }
-    } else {
-        node = Blt_TreeCreateNode(cmdPtr->tree, sqlPtr->parent, label,
-            sqlPtr->insertPos);
-        if (node == NULL) {
-            Tcl_AppendResult(interp, "node can not be created", 0);
-            sqlPtr->rc = TCL_ERROR;
-            return 1;
-        }
     }
-    if (label == NULL) {
-        sprintf(string, "%d", Blt_TreeNodeId(node));
-        Blt_TreeRelabelNode2(node, string);
+    if (objc!=4) {
+        Tcl_WrongNumArgs(interp, 2, oobjv, "?options? dbhfile selectstmt");
+        return TCL_ERROR;
     }
-    
-
-    if (sqlPtr->key != NULL) {
+    if (data.pathcol && data.treecols) {
+        Tcl_AppendResult(interp, "can not use -pathcol and -treecols", 0);
+        return TCL_ERROR;
+    }
+#ifndef OMIT_SQLITE3_HANDLE    
+    db = sqlite3_tclhandle(interp, string);
+#endif    
+    if (db == NULL) {
+        isFile = 1;
         Tcl_DStringInit(&dStr);
-        for(i=0; i<argc; i++){
-            if (argv[i] == NULL && sqlPtr->nullstr == NULL) continue;
-            if (n == i) continue;
-            Tcl_DStringAppendElement(&dStr, azColName[i]);
-            Tcl_DStringAppendElement(&dStr, argv[i]?argv[i]:sqlPtr->nullstr);
+        Tcl_DStringAppendElement(&dStr, "file");
+        Tcl_DStringAppendElement(&dStr, "exists");
+        Tcl_DStringAppendElement(&dStr, string);
+        if (Tcl_Eval( interp, Tcl_DStringValue(&dStr)) != TCL_OK) {
+            return TCL_ERROR;
         }
-        objPtr = Tcl_NewStringObj(Tcl_DStringValue(&dStr), -1);
-        if (Blt_TreeSetValue(interp, cmdPtr->tree, node, sqlPtr->key, objPtr) 
-            != TCL_OK) {
-            Tcl_DecrRefCount(objPtr);
-            sqlPtr->rc = TCL_ERROR;
-            return 1;
+        cp =  Tcl_GetStringResult(interp);
+        if (cp[0] != '1') {
+            Tcl_AppendResult(interp, "file must exists ", string, 0);
+            return TCL_ERROR;
         }
-    } else {
-        for(i=0; i<argc; i++){
-            if (argv[i] == NULL && sqlPtr->nullstr == NULL) continue;
-            if (n == i) continue; */
-            objPtr = Tcl_NewStringObj(argv[i]?argv[i]:sqlPtr->nullstr, -1);
-            if (Blt_TreeSetValue(interp, cmdPtr->tree, node, azColName[i], objPtr) 
-            != TCL_OK) {
-                Tcl_DecrRefCount(objPtr);
-                sqlPtr->rc = TCL_ERROR;
-                return 1;
-            }
+        Tcl_ResetResult(interp);
+        if (cmdPtr->delete) {
+            return TCL_ERROR;
         }
-    }
-    if (sqlPtr->tags != NULL) {        
-        for (i=0; i<sqlPtr->vobjc; i++) {
-            if (AddTag(cmdPtr, node, Tcl_GetString(sqlPtr->vobjv[i])) != TCL_OK) {
-                return 1;
-            }
+        rc = sqlite3_open(string, &db);
+        if (rc) {
+            Tcl_AppendResult(interp, "database open failed for ", string, sqlite3_errmsg(db), 0);
+            sqlite3_close(db);
+            return TCL_ERROR;
         }
     }
-    if (Blt_TreeInsertPost(cmdPtr->tree, node) == NULL) {
-        DeleteNode(cmdPtr, node);
-        return 1;
+    if (db == NULL) {
+        Tcl_AppendResult(interp, "database open failed for ", string, 0);
+        return TCL_ERROR;
     }
-    if (sqlPtr->fixed) {
-        node->flags |= TREE_NODE_FIXED_FIELDS;
+    string = Tcl_GetString(objv[3]);
+#ifdef BLT_USE_OLD_SQLITE
+    rc = sqlite3_exec(db, string, SqlCallback, &data, &zErrMsg);
+#else
+    rc = sqlite3_exec_tclobj(db, objv[3], SqlCallbackObj, &data, &zErrPtr);
+#endif
+    if (data.rc == TCL_OK && rc != 0 /* SQLITE_OK */ ){
+        Tcl_AppendResult(interp, "SQL error: ", (zErrPtr?Tcl_GetString(zErrPtr):0), 0);
+        result = TCL_ERROR;
+    } else if (data.rc != TCL_BREAK) {
+        result = data.rc;
+    }
+    if (isFile) {
+        sqlite3_close(db);
+    }
+    if (result == TCL_OK) {
+        Tcl_SetObjResult(interp, Tcl_NewIntObj(data.cnt));
+    }
+    if (zErrPtr != NULL) {
+        Tcl_DecrRefCount(zErrPtr);
     }
+    return result;
     
-    sqlPtr->cnt++;
-    if (sqlPtr->max > 0 && sqlPtr->cnt >= sqlPtr->max) {
-        sqlPtr->rc = TCL_BREAK;
-        return 1;
+missingArg:
+    if (zErrPtr != NULL) {
+        Tcl_DecrRefCount(zErrPtr);
+    }
+    Tcl_AppendResult(interp, "missing argument for find option \"",
+        Tcl_GetString(objv[3]), "\"", (char *)NULL);
+    return TCL_ERROR;
+#endif
+}
+
+/*
+ * Column of a CSV or TSV file read by the "load" operation.
+ */
+typedef struct {
+    char *name;
+    Tcl_Obj *nameObjPtr;	/* Name, for the list of -key. */
+    Blt_TreeKey key;		/* Interned name of the value. */
+    int plain;			/* Value can be set without parsing
+				 * the name for an array element. */
+    int store;			/* Indicates to store the field as
+				 * a value of the node. */
+} LoadColumn;
+
+typedef struct {
+    TreeCmd *cmdPtr;
+    LoadData *dataPtr;
+    Blt_TreeNode parent;	/* Parent of the new nodes. */
+    int insertPos;		/* Position of the next node under 
+				 * the parent, or -1 to append. */
+    int sep;			/* Field separator. */
+    int quoting;		/* Indicates if fields may be quoted. */
+    LoadColumn *columns;	/* NULL until the header is read. */
+    int nColumns;
+    int labelCol, tagCol, pathCol; /* Indices of columns, or -1. */
+    int *treeCols;
+    int nTreeCols;
+    char **fields;		/* Fields of the current row. */
+    int *lengths;
+    int *nulls;			/* Indicates if a field is empty and 
+				 * unquoted. */
+    int nAlloc;
+    Tcl_Obj **tagObjv;		/* Tags from -addtags. */
+    int nTags;
+    int nRows;			/* # of rows read, including the
+				 * header. */
+    int nLines;			/* # of lines before the current
+				 * record.  Quoted fields may span
+				 * lines. */
+    int count;			/* # of nodes loaded. */
+} Loader;
+
+#define LOAD_CHUNK	(1<<16)	/* # of characters read at a time. */
+
+/*
+ * Returns the end of the record starting at p, or NULL if the
+ * record isn't complete yet.  A quote only opens a quoted field at
+ * the start of the field.  The newline in a quoted field doesn't
+ * end the record.
+ */
+static char *
+FindRecordEnd(Loader *loaderPtr, char *p, char *end)
+{
+    char *start, *eol, *quote;
+
+    start = p;
+    for (;;) {
+	eol = memchr(p, '\n', end - p);
+	if (!loaderPtr->quoting) {
+	    return eol;
+	}
+	quote = memchr(p, '"', ((eol != NULL) ? eol : end) - p);
+	if (quote == NULL) {
+	    return eol;
+	}
+	p = quote + 1;
+	if ((quote != start) && (quote[-1] != loaderPtr->sep)) {
+	    continue;		/* Quote inside an unquoted field. */
+	}
+	/* Skip to the closing quote, past any doubled quotes. */
+	for (;;) {
+	    quote = memchr(p, '"', end - p);
+	    if ((quote == NULL) || (quote + 1 == end)) {
+		return NULL;
+	    }
+	    p = quote + 1;
+	    if (*p != '"') {
+		break;
+	    }
+	    p++;
+	}
     }
+}
 
-    return 0;
+/*
+ * Splits a complete record into fields, in place.  Quoted fields
+ * are unquoted.  Each field is NUL-terminated.  Returns the # of
+ * fields, or -1 if a quoted field has no closing quote.
+ */
+static int
+SplitRecord(Loader *loaderPtr, char *p, char *end)
+{
+    int n;
+
+    n = 0;
+    for (;;) {
+	char *field, *dest;
+	int isNull;
+
+	if (n == loaderPtr->nAlloc) {
+	    loaderPtr->nAlloc = (n == 0) ? 64 : n * 2;
+	    loaderPtr->fields = Blt_Realloc(loaderPtr->fields, 
+		loaderPtr->nAlloc * sizeof(char *));
+	    loaderPtr->lengths = Blt_Realloc(loaderPtr->lengths, 
+		loaderPtr->nAlloc * sizeof(int));
+	    loaderPtr->nulls = Blt_Realloc(loaderPtr->nulls, 
+		loaderPtr->nAlloc * sizeof(int));
+	    assert(loaderPtr->fields && loaderPtr->lengths && 
+		   loaderPtr->nulls);
+	}
+	field = p;
+	if ((loaderPtr->quoting) && (p < end) && (*p == '"')) {
+	    isNull = FALSE;
+	    dest = p++;
+	    for (;;) {
+		char *quote;
+
+		quote = memchr(p, '"', end - p);
+		if (quote == NULL) {
+		    return -1;		/* Unterminated. */
+		}
+		memmove(dest, p, quote - p);
+		dest += quote - p;
+		p = quote;
+		if (p == end) {
+		    break;
+		}
+		p++;
+		if ((p < end) && (*p == '"')) {
+		    *dest++ = '"';
+		    p++;
+		    continue;
+		}
+		break;
+	    }
+	    /* Characters after the closing quote are kept as is. */
+	    while ((p < end) && (*p != loaderPtr->sep)) {
+		*dest++ = *p++;
+	    }
+	} else {
+	    p = memchr(p, loaderPtr->sep, end - p);
+	    if (p == NULL) {
+		p = end;
+	    }
+	    dest = p;
+	    isNull = (dest == field);
+	}
+	loaderPtr->fields[n] = field;
+	loaderPtr->lengths[n] = dest - field;
+	loaderPtr->nulls[n] = isNull;
+	n++;
+	*dest = '\0';
+	if (p == end) {
+	    break;
+	}
+	p++;			/* Skip the separator. */
+    }
+    return n;
 }
-#else
+
+static int
+FindColumn(Loader *loaderPtr, CONST char *name)
+{
+    int i;
+
+    for (i = 0; i < loaderPtr->nColumns; i++) {
+	if (strcmp(loaderPtr->columns[i].name, name) == 0) {
+	    return i;
+	}
+    }
+    Tcl_AppendResult(loaderPtr->cmdPtr->interp, "column \"", name, 
+	"\" not found", (char *)NULL);
+    return -1;
+}
+
 /*
- * Obj Callback for sqlload.
- *
+ * Sets up the columns from their names, either the first row or
+ * the -keys list.  Resolves the columns named by the switches.
  */
-#if 0
-static int SqlCallbackObj(SqlData *sqlPtr, int argc, Tcl_Obj **objv, Tcl_Obj **azColName)
+static int
+InitLoadColumns(Loader *loaderPtr, int nNames, char **names)
 {
-    int i, j, rid, lid, n, tcid, vobjc, tobjc;
-    Tcl_Interp *interp = sqlPtr->interp;
-    TreeCmd *cmdPtr = sqlPtr->cmdPtr;
-    Blt_TreeNode node;
-    char string[200];
-    Tcl_Obj *objPtr, **vobjv, **tobjv;
-    Tcl_DString dStr;
-    char *label = NULL, *cn, *ridStr = "";
-    int treeCols[100], pcol = -1;
-    
-    rid = -1;
-    n = -1;
-    lid = -1;
-    tcid = -1;
-    if (sqlPtr->rinc>0) {
-        for(i=0; i<argc; i++){
-            if (objv[i]==NULL) continue;
-            cn = Tcl_GetString(azColName[i]);
-            if (cn[0] == 'r' && !strcmp(cn, "rowid")) {
-                if (Tcl_GetIntFromObj(NULL, objv[i], &rid) == TCL_OK) {
-                    rid += sqlPtr->rinc;
-                    ridStr = Tcl_GetString(objv[i]);
-                    n = i;
-                    break;
-                }
-            }
-        }
+    LoadData *dataPtr = loaderPtr->dataPtr;
+    Tcl_Interp *interp = loaderPtr->cmdPtr->interp;
+    Tcl_Obj **objv;
+    int objc, i, col;
+
+    loaderPtr->columns = Blt_Calloc(nNames, sizeof(LoadColumn));
+    assert(loaderPtr->columns);
+    loaderPtr->nColumns = nNames;
+    for (i = 0; i < nNames; i++) {
+	LoadColumn *colPtr = loaderPtr->columns + i;
+
+	colPtr->name = Blt_Strdup(names[i]);
+	colPtr->nameObjPtr = Tcl_NewStringObj(names[i], -1);
+	Tcl_IncrRefCount(colPtr->nameObjPtr);
+	colPtr->key = Blt_TreeKeyGet(NULL, loaderPtr->cmdPtr->tree->treeObject,
+		names[i]);
+	colPtr->plain = (strchr(names[i], '(') == NULL);
+	colPtr->store = TRUE;
+    }
+    if ((dataPtr->labelCol != NULL) && ((loaderPtr->labelCol = 
+	FindColumn(loaderPtr, dataPtr->labelCol)) < 0)) {
+	return TCL_ERROR;
     }
-    if (sqlPtr->labelcol != NULL && sqlPtr->labelcol[0]) {
-        for(i=0; i<argc; i++){
-            if (objv[i]==NULL) continue;
-            cn = Tcl_GetString(azColName[i]);
-            if (cn[0] == sqlPtr->labelcol[0]
-            && !strcmp(cn, sqlPtr->labelcol)) {
-                lid = i;
-                label = (objv[i] ? Tcl_GetString(objv[i]) : sqlPtr->nullstr );
-                break;
-            }
-        }
+    if ((dataPtr->pathCol != NULL) && ((loaderPtr->pathCol = 
+	FindColumn(loaderPtr, dataPtr->pathCol)) < 0)) {
+	return TCL_ERROR;
     }
-    if (sqlPtr->treecols) {
-            
-        if (Tcl_ListObjGetElements(interp, sqlPtr->treecols, &tobjc, &tobjv) 
-        != TCL_OK || tobjc>=100) {
-            sqlPtr->rc = TCL_ERROR;
-            return 1;
-        }
-        for (i=0; i<tobjc; i++) {
-            treeCols[i] = -1;
-        }
+    if (dataPtr->tagCol != NULL) {
+	if ((loaderPtr->tagCol = FindColumn(loaderPtr, dataPtr->tagCol)) < 0) {
+	    return TCL_ERROR;
+	}
+	loaderPtr->columns[loaderPtr->tagCol].store = FALSE;
     }
-    if (rid>=1) {
-        node = Blt_TreeCreateNodeWithId(cmdPtr->tree, sqlPtr->parent, label,
-            rid, sqlPtr->insertPos);
-        if (node == NULL) {
-            Tcl_AppendResult(interp, "node can not be created with id: ", ridStr, 0);
-            sqlPtr->rc = TCL_ERROR;
-            return  1;
-        }
-    } else {
-        node = Blt_TreeCreateNode(cmdPtr->tree, sqlPtr->parent, label,
-            sqlPtr->insertPos);
-        if (node == NULL) {
-            Tcl_AppendResult(interp, "node can not be created", 0);
-            sqlPtr->rc = TCL_ERROR;
-            return 1;
-        }
+    if (dataPtr->skipCols != NULL) {
+	if (Tcl_ListObjGetElements(interp, dataPtr->skipCols, &objc, &objv)
+	    != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	for (i = 0; i < objc; i++) {
+	    if ((col = FindColumn(loaderPtr, Tcl_GetString(objv[i]))) < 0) {
+		return TCL_ERROR;
+	    }
+	    loaderPtr->columns[col].store = FALSE;
+	}
     }
-    if (label == NULL) {
-        sprintf(string, "%d", Blt_TreeNodeId(node));
-        Blt_TreeRelabelNode2(node, string);
+    if (dataPtr->treeCols != NULL) {
+	if (Tcl_ListObjGetElements(interp, dataPtr->treeCols, &objc, &objv)
+	    != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	loaderPtr->treeCols = Blt_Malloc((objc + 1) * sizeof(int));
+	assert(loaderPtr->treeCols);
+	for (i = 0; i < objc; i++) {
+	    if ((col = FindColumn(loaderPtr, Tcl_GetString(objv[i]))) < 0) {
+		return TCL_ERROR;
+	    }
+	    loaderPtr->treeCols[i] = col;
+	}
+	loaderPtr->nTreeCols = objc;
     }
-    
-
-    Tcl_DStringInit(&dStr);
-    for(i=0; i<argc; i++){
-        int clen;
-        if (objv[i] == NULL && sqlPtr->nullstr == NULL) continue;
-        cn = Tcl_GetStringFromObj(azColName[i], &clen);
-        if (sqlPtr->treecols) {
-            for (j=0; j<tobjc; j++) {
-                if (!strcmp(Tcl_GetString(azColName[i]), Tcl_GetString(tobjv[j]))) {
-                    treeCols[j] = i;
-                    break;
-                }
-            }
-        }
-        if (sqlPtr->pathcol) {
-            if (!strcmp(Tcl_GetString(azColName[i]), Tcl_GetString(sqlPtr->pathcol))) {
-                pcol = i;
-            }
-        }
-        if (sqlPtr->tagcol != NULL && sqlPtr->tagcol[0] &&
-            strcmp(cn, sqlPtr->tagcol) == 0) {
-            if (AddTag(cmdPtr, node, Tcl_GetString(objv[i])) != TCL_OK) {
-                goto error;
-            }
-            continue;
-        }
+    return TCL_OK;
+}
 
-        if (sqlPtr->skipcols) {
-            char *sc;
-            int slen;
-            
-            if (Tcl_ListObjGetElements(interp, sqlPtr->skipcols, &vobjc, &vobjv) 
-            != TCL_OK) {
-                goto error;
-            }
-            for (j=0; j<vobjc; j++) {
-                sc = Tcl_GetStringFromObj(vobjv[j], &slen);
-                if (slen == clen && *sc == *cn && strcmp(cn, sc) == 0) {
-                    break;
-                }
-            }
-            if (j<vobjc) continue;
-        }
-        if (sqlPtr->key != NULL) {
-            Tcl_DStringAppendElement(&dStr, cn);
-            Tcl_DStringAppendElement(&dStr, objv[i]?Tcl_GetString(objv[i]):sqlPtr->nullstr);
-        } else {
-            if (objv[i] != NULL) {
-                objPtr = objv[i];
-            } else {
-                objPtr = Tcl_NewStringObj(sqlPtr->nullstr, -1);
-            }
-            if (Blt_TreeSetValue(interp, cmdPtr->tree, node, cn, objPtr) 
-                != TCL_OK) {
-                Tcl_DecrRefCount(objPtr);
-                sqlPtr->rc = TCL_ERROR;
-                goto error;;
-            }
-        }
+/*
+ * Returns the field of a column in the current row, or NULL if
+ * it's empty (or missing) and there's no -nullvalue.
+ */
+static char *
+GetLoadField(Loader *loaderPtr, int nFields, int col)
+{
+    if ((col >= nFields) || (loaderPtr->nulls[col])) {
+	return loaderPtr->dataPtr->nullStr;
     }
-    if (sqlPtr->key != NULL) {
-        /* Set all values in a single key. */
-        objPtr = Tcl_NewStringObj(Tcl_DStringValue(&dStr), -1);
-        if (Blt_TreeSetValue(interp, cmdPtr->tree, node, sqlPtr->key, objPtr) 
-        != TCL_OK) {
-            Tcl_DecrRefCount(objPtr);
-            sqlPtr->rc = TCL_ERROR;
-            goto error;
-        }
+    return loaderPtr->fields[col];
+}
+
+/*
+ * Finds or creates the child of parent with the given label.
+ */
+static Blt_TreeNode
+GetLoadParent(Loader *loaderPtr, Blt_TreeNode parent, CONST char *label)
+{
+    Blt_TreeNode node;
+
+    node = Blt_TreeFindChild(parent, label);
+    if (node == NULL) {
+	node = Blt_TreeCreateNode(loaderPtr->cmdPtr->tree, parent, label, -1);
+	if (node == NULL) {
+	    Tcl_AppendResult(loaderPtr->cmdPtr->interp, 
+		"can't create node \"", label, "\"", (char *)NULL);
+	}
     }
+    return node;
+}
 
-    if (sqlPtr->tags != NULL) {        
-        for (i=0; i<sqlPtr->vobjc; i++) {
-            if (AddTag(cmdPtr, node, Tcl_GetString(sqlPtr->vobjv[i])) != TCL_OK) {
-                goto error;
-            }
-        }
+/*
+ * Creates the node of a row, with its values and tags.
+ */
+static int
+LoadRow(Loader *loaderPtr, int nFields)
+{
+    TreeCmd *cmdPtr = loaderPtr->cmdPtr;
+    LoadData *dataPtr = loaderPtr->dataPtr;
+    Tcl_Interp *interp = cmdPtr->interp;
+    Blt_TreeNode node, parent;
+    Tcl_Obj *listObjPtr;
+    char *label, *string;
+    int i, pos, result;
+
+    if (nFields > loaderPtr->nColumns) {
+	Tcl_AppendResult(interp, "row ", Blt_Itoa(loaderPtr->nRows), 
+		" has more fields than columns", (char *)NULL);
+	return TCL_ERROR;
     }
-    
-    if (sqlPtr->treecols) {
-        Blt_TreeNode snode, parent = sqlPtr->parent;
-        for (i=0; i<tobjc; i++) {
-            if (treeCols[i] == -1) {
-                Tcl_AppendResult(interp, "missing col in -treecols", 0);
-                goto error;
-            }
-        }
-        for (i=0; i<tobjc; i++) {
-            char *tcp;
-            tcp = Tcl_GetString(objv[treeCols[i]]);
-            snode = Blt_TreeFindChild(parent, tcp);
-            if (snode != NULL) {
-                parent = snode;
-                continue;
-            }
-            snode = Blt_TreeCreateNode(cmdPtr->tree, parent, tcp, -1);
-            if (snode == NULL) {
-                goto error;
-            }
-            parent = snode;
-        }
-        if (Blt_TreeMoveNode(cmdPtr->tree, node, parent, NULL) != TCL_OK) {
-            Tcl_AppendResult(interp, "relocate failed in -treecols", 0);
-            goto error;
-        }
+    parent = loaderPtr->parent;
+    for (i = 0; i < loaderPtr->nTreeCols; i++) {
+	string = GetLoadField(loaderPtr, nFields, loaderPtr->treeCols[i]);
+	parent = GetLoadParent(loaderPtr, parent, 
+		(string != NULL) ? string : "");
+	if (parent == NULL) {
+	    return TCL_ERROR;
+	}
+    }
+    if ((loaderPtr->pathCol >= 0) && 
+	((string = GetLoadField(loaderPtr, nFields, loaderPtr->pathCol)) 
+	 != NULL)) {
+	char **elemArr;
+	int nElem;
+
+	if (Tcl_SplitList(interp, string, &nElem, &elemArr) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	for (i = 0; (i < nElem) && (parent != NULL); i++) {
+	    parent = GetLoadParent(loaderPtr, parent, elemArr[i]);
+	}
+	Tcl_Free((char *)elemArr);
+	if (parent == NULL) {
+	    return TCL_ERROR;
+	}
     }
-    if (sqlPtr->pathcol && pcol >= 0) {
-        Blt_TreeNode snode, parent = sqlPtr->parent;
-        if (Tcl_ListObjGetElements(interp, vobjv[pcol], &tobjc, &tobjv) 
-            != TCL_OK) {
-            goto error;
-        }
-        for (i=0; i<tobjc; i++) {
-            char *tcp;
-            tcp = Tcl_GetString(tobjv[i]);
-            snode = Blt_TreeFindChild(parent, tcp);
-            if (snode != NULL) {
-                parent = snode;
-                continue;
-            }
-            snode = Blt_TreeCreateNode(cmdPtr->tree, parent, tcp, -1);
-            if (snode == NULL) {
-                goto error;
-            }
-            parent = snode;
-        }
-        if (Blt_TreeMoveNode(cmdPtr->tree, node, parent, NULL) != TCL_OK) {
-            Tcl_AppendResult(interp, "relocate failed in -pathcol", 0);
-            goto error;
-        }
+    label = NULL;
+    if (loaderPtr->labelCol >= 0) {
+	label = GetLoadField(loaderPtr, nFields, loaderPtr->labelCol);
+    }
+    pos = (parent == loaderPtr->parent) ? loaderPtr->insertPos : -1;
+    node = Blt_TreeCreateNode(cmdPtr->tree, parent, label, pos);
+    if (node == NULL) {
+	Tcl_AppendResult(interp, "can't create node for row ", 
+		Blt_Itoa(loaderPtr->nRows), (char *)NULL);
+	return TCL_ERROR;
+    }
+    if (label == NULL) {
+	Blt_TreeRelabelNode2(node, Blt_Itoa(Blt_TreeNodeId(node)));
+    }
+    listObjPtr = NULL;
+    if (dataPtr->key != NULL) {
+	listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **)NULL);
     }
+    for (i = 0; i < loaderPtr->nColumns; i++) {
+	LoadColumn *colPtr = loaderPtr->columns + i;
+	Tcl_Obj *valueObjPtr;
 
+	if (!colPtr->store) {
+	    continue;
+	}
+	if ((i < nFields) && (!loaderPtr->nulls[i])) {
+	    valueObjPtr = Tcl_NewStringObj(loaderPtr->fields[i], 
+		loaderPtr->lengths[i]);
+	} else if (dataPtr->nullStr != NULL) {
+	    valueObjPtr = Tcl_NewStringObj(dataPtr->nullStr, -1);
+	} else {
+	    continue;
+	}
+	if (listObjPtr != NULL) {
+	    Tcl_ListObjAppendElement(interp, listObjPtr, colPtr->nameObjPtr);
+	    Tcl_ListObjAppendElement(interp, listObjPtr, valueObjPtr);
+	    continue;
+	}
+	Tcl_IncrRefCount(valueObjPtr);
+	if (colPtr->plain) {
+	    result = Blt_TreeSetValueByKey(interp, cmdPtr->tree, node, 
+		colPtr->key, valueObjPtr);
+	} else {
+	    result = Blt_TreeSetValue(interp, cmdPtr->tree, node, 
+		colPtr->name, valueObjPtr);
+	}
+	Tcl_DecrRefCount(valueObjPtr);
+	if (result != TCL_OK) {
+	    goto error;
+	}
+    }
+    if (listObjPtr != NULL) {
+	Tcl_IncrRefCount(listObjPtr);
+	result = Blt_TreeSetValue(interp, cmdPtr->tree, node, dataPtr->key, 
+		listObjPtr);
+	Tcl_DecrRefCount(listObjPtr);
+	if (result != TCL_OK) {
+	    goto error;
+	}
+    }
+    if ((loaderPtr->tagCol >= 0) && 
+	((string = GetLoadField(loaderPtr, nFields, loaderPtr->tagCol)) 
+	 != NULL) && (string[0] != '\0') && 
+	(AddTag(cmdPtr, node, string) != TCL_OK)) {
+	goto error;
+    }
+    for (i = 0; i < loaderPtr->nTags; i++) {
+	if (AddTag(cmdPtr, node, Tcl_GetString(loaderPtr->tagObjv[i])) 
+	    != TCL_OK) {
+	    goto error;
+	}
+    }
     if (Blt_TreeInsertPost(cmdPtr->tree, node) == NULL) {
-        goto error;
+	return TCL_ERROR;
     }
-    Tcl_DStringFree(&dStr);
-    if (sqlPtr->fixed || (cmdPtr->tree->treeObject->flags & TREE_FIXED_KEYS)) {
-        node->flags |= TREE_NODE_FIXED_FIELDS;
+    if ((dataPtr->flags & LOAD_FIXED) || 
+	(cmdPtr->tree->treeObject->flags & TREE_FIXED_KEYS)) {
+	node->flags |= TREE_NODE_FIXED_FIELDS;
     }
-    
-    sqlPtr->cnt++;
-    if (sqlPtr->max > 0 && sqlPtr->cnt >= sqlPtr->max) {
-        sqlPtr->rc = TCL_BREAK;
-        return 1;
+    if (pos >= 0) {
+	loaderPtr->insertPos++;
     }
-    return 0;
-    
-error:
+    loaderPtr->count++;
+    if ((dataPtr->max > 0) && (loaderPtr->count >= dataPtr->max)) {
+	return TCL_BREAK;
+    }
+    return TCL_OK;
+ error:
     DeleteNode(cmdPtr, node);
-    Tcl_DStringFree(&dStr);
-    return 1;
+    return TCL_ERROR;
 }
-#endif
-#endif
 
-#ifndef OMIT_SQLITE3_LOAD
-/* #include <sqlite3.h> */
+/*
+ * Reads a record: the column names if they're not known yet, or
+ * else a row.  Blank lines are skipped.
+ */
+static int
+LoadRecord(Loader *loaderPtr, char *start, char *end)
+{
+    int nFields;
 
-extern void *sqlite3_tclhandle();
-extern int sqlite3_open();
-extern char *sqlite3_errmsg();
-extern void sqlite3_close(void *);
-extern int sqlite3_exec_tclobj();
-#endif
+    if ((end > start) && (end[-1] == '\r')) {
+	end--;
+    }
+    if (end == start) {
+	return TCL_OK;
+    }
+    nFields = SplitRecord(loaderPtr, start, end);
+    if (nFields < 0) {
+	Tcl_AppendResult(loaderPtr->cmdPtr->interp, 
+		"unterminated quoted field in record starting at line ",
+		Blt_Itoa(loaderPtr->nLines + 1), (char *)NULL);
+	return TCL_ERROR;
+    }
+    loaderPtr->nRows++;
+    if (loaderPtr->columns == NULL) {
+	return InitLoadColumns(loaderPtr, nFields, loaderPtr->fields);
+    }
+    return LoadRow(loaderPtr, nFields);
+}
 
 /*
  *----------------------------------------------------------------------
  *
- * SqlloadOp --
+ * LoadRecords --
  *
- *	Load sql
- * TODO: use sqlite header
+ *	Reads the records of a CSV or TSV file from a channel, a
+ *	chunk at a time, or from the string of the -data switch.
+ *	A record split across two chunks is kept until the next
+ *	chunk is read.
  *
  *---------------------------------------------------------------------- 
  */
 static int
-SqlloadOp(
-    TreeCmd *cmdPtr,
-    Tcl_Interp *interp,
-    int objc,
-    Tcl_Obj *CONST *objv)
+LoadRecords(Loader *loaderPtr, Tcl_Channel channel, Tcl_Obj *dataObjPtr)
 {
-#ifdef OMIT_SQLITE3_LOAD
-    Tcl_AppendResult(interp, "sqlload unsupported", 0);
-    return TCL_ERROR;
-#else     
-    char *string, *cp;
-    int rc, result, optInd, isFile = 0, sclen, tclen;
-    void *db = NULL;
-    Tcl_Obj *zErrPtr = NULL;
-    /*const char *zErrMsg = 0; */
-    SqlData data;
-    Tcl_DString dStr;
-    Tcl_Obj *CONST *oobjv = objv;
-    
-    enum optInd {
-        OP_TAGS, OP_FIXED, OP_KEY, OP_LABELCOL, OP_ROWID, OP_MAX,
-        OP_NULLSTR, OP_PARENT, OP_PATHCOL, OP_INSPOS, OP_SKIPCOL, OP_TAGCOL,
-        OP_TREECOLS        
-    };
-    static char *optArr[] = {
-        "-addtags", "-fixed", "-key", "-labelcol", "-maprowid", "-max",
-        "-nullvalue", "-parent", "-pathcol", "-pos", "-skipcols", "-tagcol",
-        "-treecols",
-        0
-    };
+    Tcl_Interp *interp = loaderPtr->cmdPtr->interp;
+    Tcl_DString buffer;
+    Tcl_Obj *chunkObjPtr;
+    char *bytes, *start, *end, *eor;
+    int length, eof, result;
 
-    data.cmdPtr = cmdPtr;
-    data.insertPos = -1;
-    data.parent = Blt_TreeRootNode(cmdPtr->tree);
-    data.interp = interp;
-    data.max = 100000;
-    data.cnt = 0;
-    data.rc = TCL_OK;
-    data.rinc = 0;
-    data.fixed = 0;
-    data.key = NULL;
-    data.labelcol = NULL;
-    data.tagcol = NULL;
-    data.skipcols = NULL;
-    data.nullstr = NULL;
-    data.tags = NULL;
-    data.pathcol = NULL;
-    data.treecols = NULL;
-    
+    Tcl_DStringInit(&buffer);
+    chunkObjPtr = NULL;
+    if (channel != NULL) {
+	chunkObjPtr = Tcl_NewObj();
+	Tcl_IncrRefCount(chunkObjPtr);
+	eof = FALSE;
+    } else {
+	/* The fields are split in place, so work on a copy. */
+	bytes = Tcl_GetStringFromObj(dataObjPtr, &length);
+	Tcl_DStringAppend(&buffer, bytes, length);
+	eof = TRUE;
+    }
     result = TCL_OK;
-    string = Tcl_GetString(objv[2]);
-    if (objc<4) {
-        Tcl_WrongNumArgs(interp, 2, objv, "?options? dbhfile selectstmt");
-        return TCL_ERROR;
+    start = Tcl_DStringValue(&buffer);
+    for (;;) {
+	end = Tcl_DStringValue(&buffer) + Tcl_DStringLength(&buffer);
+	if ((loaderPtr->nRows == 0) && (end - start >= 3) && 
+	    (memcmp(start, "\xEF\xBB\xBF", 3) == 0)) {
+	    start += 3;		/* Skip the byte order mark. */
+	}
+	while (start < end) {
+	    char *p;
+	    int nLines;
+
+	    eor = FindRecordEnd(loaderPtr, start, end);
+	    if (eor == NULL) {
+		if (!eof) {
+		    break;	/* Wait for the rest of the record. */
+		}
+		eor = end;
+	    }
+	    /* Count the lines first: the record is split in place. */
+	    nLines = 1;
+	    for (p = start; (p = memchr(p, '\n', eor - p)) != NULL; p++) {
+		nLines++;
+	    }
+	    result = LoadRecord(loaderPtr, start, eor);
+	    if (result != TCL_OK) {
+		goto done;
+	    }
+	    loaderPtr->nLines += nLines;
+	    start = eor + 1;
+	}
+	if (eof) {
+	    break;
+	}
+	/* Move the partial record to the front and read more. */
+	length = (start < end) ? end - start : 0;
+	memmove(Tcl_DStringValue(&buffer), start, length);
+	Tcl_DStringSetLength(&buffer, length);
+	if (Tcl_ReadChars(channel, chunkObjPtr, LOAD_CHUNK, 0) < 0) {
+	    Tcl_AppendResult(interp, "error reading file: ", 
+		Tcl_PosixError(interp), (char *)NULL);
+	    result = TCL_ERROR;
+	    goto done;
+	}
+	bytes = Tcl_GetStringFromObj(chunkObjPtr, &length);
+	eof = (length == 0) || (Tcl_Eof(channel));
+	Tcl_DStringAppend(&buffer, bytes, length);
+	start = Tcl_DStringValue(&buffer);
     }
-    while (objc>4 && string[0] == '-') {
-        if (Tcl_GetIndexFromObj(interp, objv[2], optArr, "option",
-            0, &optInd) != TCL_OK) {
-                return TCL_ERROR;
-        }
-        switch (optInd) {
-        
-        case OP_FIXED:
-            data.fixed = 1;
-            objc -= 1;
-            objv += 1;
-            break;
-        
-        case OP_INSPOS:
-            if (objc<6) { goto missingArg; }
-            if (Tcl_GetIntFromObj(interp, objv[3], &data.insertPos)) {
-                return TCL_ERROR;
-            }
-            objc -= 2;
-            objv += 2;
-            break;
+ done:
+    if (chunkObjPtr != NULL) {
+	Tcl_DecrRefCount(chunkObjPtr);
+    }
+    Tcl_DStringFree(&buffer);
+    return result;
+}
 
-        case OP_KEY:
-            if (objc<6) { goto missingArg; }
-            data.key = Tcl_GetString(objv[3]);
-            objc -= 2;
-            objv += 2;
-            break;
-        
-        case OP_LABELCOL:
-            if (objc<6) { goto missingArg; }
-            data.labelcol = Tcl_GetStringFromObj(objv[3], &data.llen);
-            objc -= 2;
-            objv += 2;
-            break;
-        
-        case OP_MAX:
-            if (objc<6) { goto missingArg; }
-            if (Tcl_GetIntFromObj(interp, objv[3], &data.max)) {
-                return TCL_ERROR;
-            }
-            objc -= 2;
-            objv += 2;
-            break;
-            
-        case OP_NULLSTR:
-            if (objc<6) { goto missingArg; }
-            data.nullstr = Tcl_GetStringFromObj(objv[3], &data.llen);
-            objc -= 2;
-            objv += 2;
-            break;
-            
-        case OP_ROWID:
-            if (objc<6) { goto missingArg; }
-            if (Tcl_GetIntFromObj(interp, objv[3], &data.rinc)) {
-                return TCL_ERROR;
-            }
-            if (data.rinc<=0) {
-                Tcl_AppendResult(interp, "-rowidmap must be > 0", 0);
-                return TCL_ERROR;
-            }
+static void
+FreeLoader(Loader *loaderPtr)
+{
+    int i;
+
+    for (i = 0; i < loaderPtr->nColumns; i++) {
+	Blt_Free(loaderPtr->columns[i].name);
+	Tcl_DecrRefCount(loaderPtr->columns[i].nameObjPtr);
+    }
+    if (loaderPtr->columns != NULL) {
+	Blt_Free(loaderPtr->columns);
+    }
+    if (loaderPtr->treeCols != NULL) {
+	Blt_Free(loaderPtr->treeCols);
+    }
+    if (loaderPtr->fields != NULL) {
+	Blt_Free(loaderPtr->fields);
+	Blt_Free(loaderPtr->lengths);
+	Blt_Free(loaderPtr->nulls);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LoadOp --
+ *
+ *	Loads the rows of a CSV or TSV file as nodes.  The switches
+ *	are those of "sqlload".  Each row becomes a child of the 
+ *	parent node, and its fields become values keyed by the names
+ *	of the columns.  The notifications of the new nodes are
+ *	batched.
+ *
+ *	t0 load -format csv -file inventory.csv -labelcol sku
+ *
+ * Results:
+ *	A standard Tcl result.  The interpreter result is the # of
+ *	rows loaded.
+ *
+ *---------------------------------------------------------------------- 
+ */
+static int
+LoadOp(
+    TreeCmd *cmdPtr,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST *objv)
+{
+    Blt_Tree tree = cmdPtr->tree;
+    Tcl_Channel channel, fileChannel;
+    LoadData data;
+    Loader loader;
+    int result, nSources, mode;
 
-            objc -= 2;
-            objv += 2;
-            break;
-            
-        case OP_PARENT:
-            if (objc<6) { goto missingArg; }
-            if (GetNode(cmdPtr, objv[3], &data.parent) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            objc -= 2;
-            objv += 2;
-            break;
-            
-        case OP_SKIPCOL:
-            if (objc<6) { goto missingArg; }
-            if (Tcl_ListObjLength(interp, objv[3], &sclen) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            data.skipcols = objv[3];
-            objc -= 2;
-            objv += 2;
-            break;
-            
-        case OP_TAGCOL:
-            if (objc<6) { goto missingArg; }
-            data.tagcol = Tcl_GetStringFromObj(objv[3], &data.llen);
-            objc -= 2;
-            objv += 2;
-            break;
-        
-        case OP_TAGS:
-            if (objc<6) { goto missingArg; }
-            data.tags = objv[3];
-            if (Tcl_ListObjGetElements(interp, data.tags, &data.vobjc, &data.vobjv)
-                != TCL_OK) {
-                return TCL_ERROR;
-            }
-            objc -= 2;
-            objv += 2;
-            break;
-        case OP_TREECOLS:
-            if (objc<6) { goto missingArg; }
-            if (Tcl_ListObjLength(interp, objv[3], &tclen) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            if (tclen>0) {
-                data.treecols = objv[3];
-            }
-            objc -= 2;
-            objv += 2;
-            break;
-        case OP_PATHCOL:
-            if (objc<6) { goto missingArg; }
-            data.pathcol = objv[3];
-            objc -= 2;
-            objv += 2;
-            break;
-        }
-        if (objc>2) {
-            string = Tcl_GetString(objv[2]);
-        }
+    if (CheckWritable(interp, tree) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    memset(&data, 0, sizeof(data));
+    data.insertPos = -1;
+    if (Blt_ProcessObjSwitches(interp, loadSwitches, objc - 2, objv + 2, 
+	     (char *)&data, BLT_SWITCH_EXACT) < 0) {
+	return TCL_ERROR;
+    }
+    memset(&loader, 0, sizeof(loader));
+    loader.cmdPtr = cmdPtr;
+    loader.dataPtr = &data;
+    loader.insertPos = data.insertPos;
+    loader.sep = (data.format == LOAD_TSV) ? '\t' : ',';
+    loader.quoting = (data.format == LOAD_CSV);
+    loader.labelCol = loader.tagCol = loader.pathCol = -1;
+    loader.parent = Blt_TreeRootNode(tree);
+    channel = fileChannel = NULL;
+    result = TCL_ERROR;
 
+    nSources = (data.file != NULL) + (data.chan != NULL) + (data.data != NULL);
+    if (nSources != 1) {
+	Tcl_AppendResult(interp, "one of -file, -data, -channel is required", 
+		(char *)NULL);
+	goto done;
     }
-    if (objc!=4) {
-        Tcl_WrongNumArgs(interp, 2, oobjv, "?options? dbhfile selectstmt");
-        return TCL_ERROR;
+    if ((data.pathCol != NULL) && (data.treeCols != NULL)) {
+	Tcl_AppendResult(interp, "can not use -pathcol and -treecols", 
+		(char *)NULL);
+	goto done;
     }
-    if (data.pathcol && data.treecols) {
-        Tcl_AppendResult(interp, "can not use -pathcol and -treecols", 0);
-        return TCL_ERROR;
+    if ((data.parent != NULL) && 
+	(GetNode(cmdPtr, data.parent, &loader.parent) != TCL_OK)) {
+	goto done;
     }
-#ifndef OMIT_SQLITE3_HANDLE    
-    db = sqlite3_tclhandle(interp, string);
-#endif    
-    if (db == NULL) {
-        isFile = 1;
-        Tcl_DStringInit(&dStr);
-        Tcl_DStringAppendElement(&dStr, "file");
-        Tcl_DStringAppendElement(&dStr, "exists");
-        Tcl_DStringAppendElement(&dStr, string);
-        if (Tcl_Eval( interp, Tcl_DStringValue(&dStr)) != TCL_OK) {
-            return TCL_ERROR;
-        }
-        cp =  Tcl_GetStringResult(interp);
-        if (cp[0] != '1') {
-            Tcl_AppendResult(interp, "file must exists ", string, 0);
-            return TCL_ERROR;
-        }
-        Tcl_ResetResult(interp);
-        if (cmdPtr->delete) {
-            return TCL_ERROR;
-        }
-        rc = sqlite3_open(string, &db);
-        if (rc) {
-            Tcl_AppendResult(interp, "database open failed for ", string, sqlite3_errmsg(db), 0);
-            sqlite3_close(db);
-            return TCL_ERROR;
-        }
+    if ((data.addTags != NULL) && 
+	(Tcl_ListObjGetElements(interp, data.addTags, &loader.nTags, 
+		&loader.tagObjv) != TCL_OK)) {
+	goto done;
     }
-    if (db == NULL) {
-        Tcl_AppendResult(interp, "database open failed for ", string, 0);
-        return TCL_ERROR;
+    if (data.keys != NULL) {
+	Tcl_Obj **kobjv;
+	char **names;
+	int kobjc, i;
+
+	if (Tcl_ListObjGetElements(interp, data.keys, &kobjc, &kobjv) 
+	    != TCL_OK) {
+	    goto done;
+	}
+	names = Blt_Malloc((kobjc + 1) * sizeof(char *));
+	assert(names);
+	for (i = 0; i < kobjc; i++) {
+	    names[i] = Tcl_GetString(kobjv[i]);
+	}
+	if (InitLoadColumns(&loader, kobjc, names) != TCL_OK) {
+	    Blt_Free(names);
+	    goto done;
+	}
+	Blt_Free(names);
     }
-    string = Tcl_GetString(objv[3]);
-#ifdef BLT_USE_OLD_SQLITE
-    rc = sqlite3_exec(db, string, SqlCallback, &data, &zErrMsg);
-#else
-    rc = sqlite3_exec_tclobj(db, objv[3], SqlCallbackObj, &data, &zErrPtr);
-#endif
-    if (data.rc == TCL_OK && rc != 0 /* SQLITE_OK */ ){
-        Tcl_AppendResult(interp, "SQL error: ", (zErrPtr?Tcl_GetString(zErrPtr):0), 0);
-        result = TCL_ERROR;
-    } else if (data.rc != TCL_BREAK) {
-        result = data.rc;
+    if (data.file != NULL) {
+	if (Tcl_IsSafe(interp)) {
+	    Tcl_AppendResult(interp, "can't use -file in safe interp", 
+		(char *)NULL);
+	    goto done;
+	}
+	channel = fileChannel = Tcl_OpenFileChannel(interp, data.file, "r", 
+		0644);
+	if (channel == NULL) {
+	    goto done;
+	}
+    } else if (data.chan != NULL) {
+	channel = Tcl_GetChannel(interp, data.chan, &mode);
+	if (channel == NULL) {
+	    goto done;
+	}
+	if ((mode & TCL_READABLE) == 0) {
+	    Tcl_AppendResult(interp, "channel is not readable", (char *)NULL);
+	    goto done;
+	}
     }
-    if (isFile) {
-        sqlite3_close(db);
+    if (Blt_TreeBeginBatch(interp, tree) != TCL_OK) {
+	goto done;
+    }
+    result = LoadRecords(&loader, channel, data.data);
+    if ((cmdPtr->delete) || (cmdPtr->tree != tree)) {
+	goto done;		/* Batch was discarded with the tree. */
+    }
+    if (result == TCL_BREAK) {
+	result = TCL_OK;	/* Stopped at -max rows. */
+    }
+    if (result != TCL_OK) {
+	Tcl_Obj *errObjPtr;
+
+	/* Deliver the rows loaded, but report the error. */
+	errObjPtr = Tcl_GetObjResult(interp);
+	Tcl_IncrRefCount(errObjPtr);
+	Blt_TreeEndBatch(interp, tree);
+	Tcl_SetObjResult(interp, errObjPtr);
+	Tcl_DecrRefCount(errObjPtr);
+    } else {
+	result = Blt_TreeEndBatch(interp, tree);
     }
     if (result == TCL_OK) {
-        Tcl_SetObjResult(interp, Tcl_NewIntObj(data.cnt));
+	Tcl_SetObjResult(interp, Tcl_NewIntObj(loader.count));
     }
-    if (zErrPtr != NULL) {
-        Tcl_DecrRefCount(zErrPtr);
+ done:
+    if (fileChannel != NULL) {
+	Tcl_Close(interp, fileChannel);
     }
+    FreeLoader(&loader);
+    Blt_FreeSwitches(interp, loadSwitches, (char *)&data, 0);
     return result;
-    
-missingArg:
-    if (zErrPtr != NULL) {
-        Tcl_DecrRefCount(zErrPtr);
-    }
-    Tcl_AppendResult(interp, "missing argument for find option \"",
-        Tcl_GetString(objv[3]), "\"", (char *)NULL);
-    return TCL_ERROR;
-#endif
 }
 /*
  *----------------------------------------------------------------------
@@ -9569,6 +12438,7 @@ static Blt_OpSpec treeOps[] =
 #ifndef NO_ATTACHCMD
     {"attach", 4, (Blt_Op)AttachOp, 2, 4, "?-notags? ?tree?",},
 #endif
+    {"batch", 1, (Blt_Op)BatchOp, 3, 3, "script",},
     {"children", 2, (Blt_Op)ChildrenOp, 3, 6, "?-labels? node ?first? ?last?",},
     {"copy", 2, (Blt_Op)CopyOp, 4, 0, 
 	"srcNode ?destTree? destNode ?switches?",},
@@ -9587,7 +12457,7 @@ static Blt_OpSpec treeOps[] =
     {"get", 1, (Blt_Op)GetOp, 3, 5, "node ?key? ?defaultValue?",},
     {"incr", 4, (Blt_Op)IncrOp, 4, 5, "node key ?amount?",},
     {"incri", 5, (Blt_Op)IncriOp, 4, 5, "node key ?amount?",},
-    {"index", 3, (Blt_Op)IndexOp, 3, 3, "name",},
+    {"index", 3, (Blt_Op)IndexOp, 3, 0, "name|create|delete|find|names|range|type ?arg...?",},
     {"insert", 3, (Blt_Op)InsertOp, 3, 0, "parent ?switches?",},
     {"is", 2, (Blt_Op)IsOp, 2, 0, "oper args...",},
     {"ismodified", 3, (Blt_Op)IsModifiedOp, 2, 4, "?nodeOrTag? ?bool?",},
@@ -9597,6 +12467,7 @@ static Blt_OpSpec treeOps[] =
     {"lappend", 7, (Blt_Op)LappendOp, 4, 0, "node key value ?...?",},
     {"lappendi", 8, (Blt_Op)LappendiOp, 4, 0, "node key value ?...?",},
     {"lastchild", 3, (Blt_Op)LastChildOp, 3, 3, "node",},
+    {"load", 2, (Blt_Op)LoadOp, 2, 0, "?switches?",},
     {"modify", 2, (Blt_Op)ModifyOp, 3, 0, "node ?key value...?",},
     {"move", 2, (Blt_Op)MoveOp, 4, 0, "node newParent ?switches?",},
     {"names", 2, (Blt_Op)NamesOp, 3, 5, "node ?key? ?pattern?",},
@@ -9612,8 +12483,10 @@ static Blt_OpSpec treeOps[] =
     {"prevsibling", 5, (Blt_Op)PrevSiblingOp, 3, 3, "node",},
     {"restore", 3, (Blt_Op)RestoreOp, 5, 0, "node ?switches?",},
     {"root", 2, (Blt_Op)RootOp, 2, 3, "?node?",},
+    {"schema", 2, (Blt_Op)SchemaOp, 2, 3, "?keyList?",},
     {"set", 3, (Blt_Op)SetOp, 3, 0, "node ?key value...?",},
     {"size", 2, (Blt_Op)SizeOp, 3, 3, "node",},
+    {"snapshot", 2, (Blt_Op)SnapshotOp, 2, 3, "?name?",},
     {"sort", 2, (Blt_Op)SortOp, 3, 0, "node ?flags...?",},
     {"sqlload", 4, (Blt_Op)SqlloadOp, 4, 0, "db sql",},
     {"sum", 3, (Blt_Op)SumOp, 4, 0, "node key ?-runtotal key? ?-start num? ?-int?",},
@@ -9758,6 +12631,122 @@ GenerateName(
     return treeName;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetTreeCmdName --
+ *
+ *	Returns the fully qualified name of a new tree command.  If
+ *	no name is given, or it contains "#auto", an unused name is
+ *	generated.
+ *
+ * Results:
+ *	Returns the name, stored in the dynamic string, or NULL if
+ *	the name is already used by a command or tree.
+ *
+ *----------------------------------------------------------------------
+ */
+static CONST char *
+GetTreeCmdName(
+    Tcl_Interp *interp,
+    CONST char *treeName,
+    Tcl_DString *resultPtr)
+{
+    CONST char *name;
+    Tcl_CmdInfo cmdInfo;
+    Tcl_Namespace *nsPtr;
+    char *p;
+
+    if (treeName == NULL) {
+	return GenerateName(interp, "", "", resultPtr);
+    }
+    p = strstr(treeName, "#auto");
+    if (p != NULL) {
+	Tcl_DString dString;
+
+	/* Don't write into the caller's string. */
+	Tcl_DStringInit(&dString);
+	Tcl_DStringAppend(&dString, treeName, -1);
+	p = Tcl_DStringValue(&dString) + (p - treeName);
+	*p = '\0';
+	treeName = GenerateName(interp, Tcl_DStringValue(&dString), p + 5, 
+		resultPtr);
+	Tcl_DStringFree(&dString);
+	return treeName;
+    }
+    nsPtr = NULL;
+    /* 
+     * Parse the command and put back so that it's in a consistent
+     * format.  
+     *
+     *	t1         <current namespace>::t1
+     *	n1::t1     <current namespace>::n1::t1
+     *	::t1	   ::t1
+     *  ::n1::t1   ::n1::t1
+     */
+    if (Blt_ParseQualifiedName(interp, treeName, &nsPtr, &name) != TCL_OK) {
+	Tcl_AppendResult(interp, "can't find namespace in \"", treeName,
+		"\"", (char *)NULL);
+	return NULL;
+    }
+    if (nsPtr == NULL) {
+	nsPtr = Tcl_GetCurrentNamespace(interp);
+    }
+    treeName = Blt_GetQualifiedName(nsPtr, name, resultPtr);
+    /* 
+     * Check if the command already exists. 
+     */
+    if (Tcl_GetCommandInfo(interp, (char *)treeName, &cmdInfo)) {
+	Tcl_AppendResult(interp, "a command \"", treeName,
+		"\" already exists", (char *)NULL);
+	return NULL;
+    }
+    if (Blt_TreeExists(interp, treeName)) {
+	Tcl_AppendResult(interp, "a tree \"", treeName, 
+		"\" already exists", (char *)NULL);
+	return NULL;
+    }
+    return treeName;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewTreeCmd --
+ *
+ *	Creates the Tcl command for a tree token.  The command takes
+ *	ownership of the token.
+ *
+ *----------------------------------------------------------------------
+ */
+static TreeCmd *
+NewTreeCmd(
+    TreeCmdInterpData *dataPtr,
+    Tcl_Interp *interp,
+    CONST char *treeName,
+    Blt_Tree token)
+{
+    TreeCmd *cmdPtr;
+    int isNew;
+
+    cmdPtr = Blt_Calloc(1, sizeof(TreeCmd));
+    assert(cmdPtr);
+    cmdPtr->dataPtr = dataPtr;
+    cmdPtr->tree = token;
+    cmdPtr->interp = interp;
+    Blt_InitHashTable(&(cmdPtr->traceTable), BLT_STRING_KEYS);
+    Blt_InitHashTable(&(cmdPtr->notifyTable), BLT_STRING_KEYS);
+    cmdPtr->cmdToken = Tcl_CreateObjCommand(interp, (char *)treeName, 
+	(Tcl_ObjCmdProc *)TreeInstObjCmd, cmdPtr, TreeInstDeleteProc);
+    cmdPtr->tablePtr = &dataPtr->treeTable;
+    cmdPtr->hashPtr = Blt_CreateHashEntry(cmdPtr->tablePtr, (char *)cmdPtr,
+	&isNew);
+    Blt_SetHashValue(cmdPtr->hashPtr, cmdPtr);
+    Blt_TreeCreateEventHandler(cmdPtr->tree, TREE_NOTIFY_ALL, 
+	TreeEventProc, cmdPtr);
+    return cmdPtr;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -9812,94 +12801,23 @@ TreeCreateOp(
         Tcl_AppendResult(interp, "too many args", 0);
         return TCL_ERROR;
     }
-    treeName = NULL;
     Tcl_DStringInit(&dString);
-
-    if (objc == 3) {
-	treeName = Tcl_GetString(objv[2]);
-    }
-    if (treeName == NULL) {
-	treeName = GenerateName(interp, "", "", &dString);
-    } else {
-	char *p;
-
-	p = strstr(treeName, "#auto");
-	if (p != NULL) {
-	    *p = '\0';
-	    treeName = GenerateName(interp, treeName, p + 5, &dString);
-	    *p = '#';
-	} else {
-	    CONST char *name;
-	    Tcl_CmdInfo cmdInfo;
-	    Tcl_Namespace *nsPtr;
-
-	    nsPtr = NULL;
-	    /* 
-	     * Parse the command and put back so that it's in a consistent
-	     * format.  
-	     *
-	     *	t1         <current namespace>::t1
-	     *	n1::t1     <current namespace>::n1::t1
-	     *	::t1	   ::t1
-	     *  ::n1::t1   ::n1::t1
-	     */
-	    if (Blt_ParseQualifiedName(interp, treeName, &nsPtr, &name) 
-		!= TCL_OK) {
-		Tcl_AppendResult(interp, "can't find namespace in \"", treeName,
-			 "\"", (char *)NULL);
-                Tcl_DStringFree(&dString);
-		return TCL_ERROR;
-	    }
-	    if (nsPtr == NULL) {
-		nsPtr = Tcl_GetCurrentNamespace(interp);
-	    }
-	    treeName = Blt_GetQualifiedName(nsPtr, name, &dString);
-	    /* 
-	     * Check if the command already exists. 
-	     */
-	    if (Tcl_GetCommandInfo(interp, (char *)treeName, &cmdInfo)) {
-		Tcl_AppendResult(interp, "a command \"", treeName,
-				 "\" already exists", (char *)NULL);
-		goto error;
-	    }
-	    if (Blt_TreeExists(interp, treeName)) {
-		Tcl_AppendResult(interp, "a tree \"", treeName, 
-			"\" already exists", (char *)NULL);
-		goto error;
-	    }
-	} 
-    } 
+    treeName = GetTreeCmdName(interp, (objc == 3) ? 
+	Tcl_GetString(objv[2]) : NULL, &dString);
     if (treeName == NULL) {
 	goto error;
     }
     if (Blt_TreeCreate(interp, treeName, &token) == TCL_OK) {
-	int isNew;
-	TreeCmd *cmdPtr;
-
-	cmdPtr = Blt_Calloc(1, sizeof(TreeCmd));
-	assert(cmdPtr);
-	cmdPtr->dataPtr = dataPtr;
-	cmdPtr->tree = token;
-	cmdPtr->interp = interp;
-	cmdPtr->tree->treeObject->maxKeyList = keyhash;
+	token->treeObject->maxKeyList = keyhash;
 	if (fixed) {
-	   cmdPtr->tree->treeObject->flags |= TREE_FIXED_KEYS;
+	   token->treeObject->flags |= TREE_FIXED_KEYS;
 	}
         if (dict) {
-             cmdPtr->tree->treeObject->flags |= TREE_DICT_KEYS;
+             token->treeObject->flags |= TREE_DICT_KEYS;
         }
-        Blt_InitHashTable(&(cmdPtr->traceTable), BLT_STRING_KEYS);
-	Blt_InitHashTable(&(cmdPtr->notifyTable), BLT_STRING_KEYS);
-	cmdPtr->cmdToken = Tcl_CreateObjCommand(interp, (char *)treeName, 
-		(Tcl_ObjCmdProc *)TreeInstObjCmd, cmdPtr, TreeInstDeleteProc);
-	cmdPtr->tablePtr = &dataPtr->treeTable;
-	cmdPtr->hashPtr = Blt_CreateHashEntry(cmdPtr->tablePtr, (char *)cmdPtr,
-	      &isNew);
-	Blt_SetHashValue(cmdPtr->hashPtr, cmdPtr);
+	NewTreeCmd(dataPtr, interp, treeName, token);
 	Tcl_SetResult(interp, (char *)treeName, TCL_VOLATILE);
 	Tcl_DStringFree(&dString);
-	Blt_TreeCreateEventHandler(cmdPtr->tree, TREE_NOTIFY_ALL, 
-	     TreeEventProc, cmdPtr);
 	return TCL_OK;
     }
  error:
@@ -10165,7 +13083,6 @@ ExitCmd(
  *
  * ------------------------------------------------------------------------
  */
-extern int bltTreeUseLocalKeys;
 int
 Blt_TreeInit(Tcl_Interp *interp)
 {
@@ -54,7 +54,9 @@
 #define DEF_ICON_HEIGHT		8
 
 static Blt_TreeApplyProc DeleteApplyProc;
-static Blt_TreeApplyProc CreateApplyProc;
+
+static TreeViewEntry *NewEntry _ANSI_ARGS_((TreeView *tvPtr, 
+	Blt_TreeNode node, Blt_HashEntry *hPtr));
 
 static Blt_OptionParseProc ObjToTree;
 static Blt_OptionPrintProc TreeToObj;
@@ -185,6 +187,7 @@ Blt_CustomOption bltTreeViewLabelOption =
 #define DEF_TV_INSERTFIRST "1"
 #define DEF_TV_FOCUSHEIGHT "1"
 #define DEF_TV_LINESPACING	"0"
+#define DEF_TV_MAX_ENTRIES	"0"
 #define DEF_TV_LINEWIDTH	"1"
 #define DEF_TV_MINHEIGHT	"0"
 #define DEF_TV_MAKE_PATH	"no"
@@ -216,6 +219,7 @@ Blt_CustomOption bltTreeViewLabelOption =
 #define DEF_TV_TEXT_MONO	STD_NORMAL_FG_MONO
 #define DEF_TV_TEXT_DISABLED_COLOR	"DarkGray"
 #define DEF_TV_TRIMLEFT		""
+#define DEF_TV_VIRTUAL		"no"
 #define DEF_TV_WIDTH		"200"
 #define DEF_TV_SCROLL_TILE      "no"
 
@@ -498,6 +502,9 @@ Blt_ConfigSpec bltTreeViewSpecs[] =
     {BLT_CONFIG_DISTANCE, "-linewidth", "lineWidth", "LineWidth",
 	DEF_TV_LINEWIDTH, Blt_Offset(TreeView, lineWidth),
 	BLT_CONFIG_DONT_SET_DEFAULT},
+    {BLT_CONFIG_INT, "-maxentries", "maxEntries", "MaxEntries",
+	DEF_TV_MAX_ENTRIES, Blt_Offset(TreeView, maxEntries),
+	BLT_CONFIG_DONT_SET_DEFAULT},
     {BLT_CONFIG_DISTANCE, "-minheight", "minHeight", "MinHeight",
 	DEF_TV_MINHEIGHT, Blt_Offset(TreeView, reqMin), 
 	0},
@@ -580,6 +587,9 @@ Blt_ConfigSpec bltTreeViewSpecs[] =
     {BLT_CONFIG_STRING, "-trim", "trim", "Trim",
 	DEF_TV_TRIMLEFT, Blt_Offset(TreeView, trimLeft), 
 	BLT_CONFIG_NULL_OK},
+    {BLT_CONFIG_BOOLEAN, "-virtual", "virtual", "Virtual",
+	DEF_TV_VIRTUAL, Blt_Offset(TreeView, virtualView),
+	BLT_CONFIG_DONT_SET_DEFAULT},
     {BLT_CONFIG_DISTANCE, "-width", "width", "Width",
 	DEF_TV_WIDTH, Blt_Offset(TreeView, reqWidth),
 	BLT_CONFIG_DONT_SET_DEFAULT},
@@ -655,14 +665,46 @@ void Blt_TreeViewOptsInit(TreeView* tvPtr) {
  *	None.
  *
  * Side effects:
- *	Information gets redisplayed.  Right now we don't do selective
- *	redisplays:  the whole window will be redrawn.
+ *	Information gets redisplayed.  The whole window will be
+ *	redrawn.
  *
  *----------------------------------------------------------------------
  */
 void
 Blt_TreeViewEventuallyRedraw(TreeView *tvPtr)
 {
+    tvPtr->redrawAll = TRUE;
+    if ((tvPtr->tkwin != NULL) && ((tvPtr->flags & TV_REDRAW) == 0)) {
+	tvPtr->flags |= TV_REDRAW;
+	Tcl_DoWhenIdle(DisplayTreeView, tvPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeViewEventuallyRedrawEntry --
+ *
+ *	Queues a request to redraw the row of an entry at the next
+ *	idle point.  Only its appearance (selection, focus, active
+ *	state, or value) may have changed.  If entryPtr is NULL, just
+ *	the view offsets have changed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The row is redrawn.  Other rows are copied from the frame
+ *	retained by the last redisplay.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Blt_TreeViewEventuallyRedrawEntry(TreeView *tvPtr, TreeViewEntry *entryPtr)
+{
+    if (entryPtr != NULL) {
+	entryPtr->flags |= ENTRY_REDRAW;
+    }
     if ((tvPtr->tkwin != NULL) && ((tvPtr->flags & TV_REDRAW) == 0)) {
 	tvPtr->flags |= TV_REDRAW;
 	Tcl_DoWhenIdle(DisplayTreeView, tvPtr);
@@ -835,6 +877,8 @@ void FreeTreeDo (Tcl_Interp *interp, TreeView *tvPtr, Blt_Tree treePtr) {
     root = Blt_TreeRootNode(treePtr);
     Blt_TreeApply(root, DeleteApplyProc, tvPtr);
     UntraceColumns(tvPtr);
+    Blt_TreeViewFreeFilter(tvPtr);
+    Blt_TreeViewCancelInserts(tvPtr);
     /* TODO: release entries now if this was an external tree. */
     /* ReleaseEntries(tvPtr); */
     Blt_TreeViewClearSelection(tvPtr);
@@ -1717,8 +1761,8 @@ FreeIcons(
     return TCL_OK;
 }
 
-TreeViewEntry *
-Blt_NodeToEntry(TreeView *tvPtr, Blt_TreeNode node)
+static TreeViewEntry *
+FindEntry(TreeView *tvPtr, Blt_TreeNode node)
 {
     Blt_HashEntry *hPtr;
 
@@ -1729,6 +1773,44 @@ Blt_NodeToEntry(TreeView *tvPtr, Blt_TreeNode node)
     return Blt_GetHashValue(hPtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_NodeToEntry --
+ *
+ *	Returns the entry associated with the node.  Entries are
+ *	created on demand: the first time a node below the root of
+ *	the view is asked for (by opening its parent, "see",
+ *	selection, tags, etc.), its entry is made.  Attaching a
+ *	large tree therefore costs only what is actually viewed.
+ *
+ * Results:
+ *	Returns the entry or NULL if the node isn't part of the view.
+ *
+ *----------------------------------------------------------------------
+ */
+TreeViewEntry *
+Blt_NodeToEntry(TreeView *tvPtr, Blt_TreeNode node)
+{
+    Blt_HashEntry *hPtr;
+    int isNew;
+
+    hPtr = Blt_FindHashEntry(&tvPtr->entryTable, (char *)node);
+    if (hPtr != NULL) {
+	return Blt_GetHashValue(hPtr);
+    }
+    if ((node == NULL) || (tvPtr->tree == NULL) || 
+	(tvPtr->rootNode == NULL) || (tvPtr->flags & TV_DELETED)) {
+	return NULL;
+    }
+    if ((node != tvPtr->rootNode) && 
+	(!Blt_TreeIsAncestor(tvPtr->rootNode, node))) {
+	return NULL;		/* Node is outside of the view. */
+    }
+    hPtr = Blt_CreateHashEntry(&tvPtr->entryTable, (char *)node, &isNew);
+    return NewEntry(tvPtr, node, hPtr);
+}
+
 int
 Blt_TreeViewApply(
     TreeView *tvPtr,
@@ -1792,6 +1874,9 @@ Blt_TreeViewEntryIsHidden(TreeViewEntry *entryPtr)
     /*if (entryPtr->stylePtr && entryPtr->stylePtr->hidden) {
         return TRUE;
     }*/
+    if ((tvPtr->filterPtr != NULL) && (Blt_TreeViewEntryIsFiltered(entryPtr))) {
+	return TRUE;
+    }
     return (entryPtr->flags & ENTRY_HIDDEN) ? TRUE : FALSE;
 }
 
@@ -2073,6 +2158,9 @@ Blt_TreeViewConfigureEntry(
     if (isdel || (tvPtr->flags & TV_DELETED)) {
 	return TCL_ERROR;
     }
+    if (objc > 0) {
+	entryPtr->flags |= ENTRY_CONFIGURED;
+    }
     /* 
      * Check if there are values that need to be added 
      */
@@ -2124,9 +2212,121 @@ Blt_TreeViewConfigureEntry(
     return TCL_OK;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * CountValueWidth --
+ *
+ *	Moves a value to a new width in the histogram of the widths
+ *	of its column.  The column's maxWidth is the top of the
+ *	histogram, so adding, changing or removing a value doesn't
+ *	require looking at the other values of the column.  A width
+ *	of zero removes the value.
+ *
+ * Results:
+ *	None.
+ *
+ * ----------------------------------------------------------------------
+ */
+static void
+CountValueWidth(TreeView *tvPtr, TreeViewValue *valuePtr, int width)
+{
+    TreeViewColumn *columnPtr;
+    int *countPtr;
+
+    columnPtr = valuePtr->columnPtr;
+    if (columnPtr == &tvPtr->treeColumn) {
+	return;
+    }
+    if (valuePtr->countEpoch != tvPtr->widthEpoch) {
+	/* The histogram was reset since the value was counted. */
+	valuePtr->countEpoch = tvPtr->widthEpoch;
+	valuePtr->countedWidth = 0;
+    }
+    if (valuePtr->countedWidth == width) {
+	return;
+    }
+    if (valuePtr->countedWidth > 0) {
+	columnPtr->widthCounts[valuePtr->countedWidth]--;
+	if (valuePtr->countedWidth == columnPtr->maxWidth) {
+	    /* Find the next widest value. */
+	    countPtr = columnPtr->widthCounts + columnPtr->maxWidth;
+	    while ((columnPtr->maxWidth > 0) && (*countPtr == 0)) {
+		countPtr--, columnPtr->maxWidth--;
+	    }
+	}
+    }
+    if (width > 0) {
+	if (width >= columnPtr->nWidthCounts) {
+	    int nCounts;
+
+	    nCounts = MAX(width + 1, 2 * columnPtr->nWidthCounts);
+	    columnPtr->widthCounts = Blt_Realloc(columnPtr->widthCounts, 
+		nCounts * sizeof(int));
+	    assert(columnPtr->widthCounts);
+	    memset(columnPtr->widthCounts + columnPtr->nWidthCounts, 0, 
+		(nCounts - columnPtr->nWidthCounts) * sizeof(int));
+	    columnPtr->nWidthCounts = nCounts;
+	}
+	columnPtr->widthCounts[width]++;
+	if (columnPtr->maxWidth < width) {
+	    columnPtr->maxWidth = width;
+	}
+    }
+    valuePtr->countedWidth = width;
+}
+
+static void
+CountEntryWidths(TreeView *tvPtr, TreeViewEntry *entryPtr)
+{
+    TreeViewValue *valuePtr;
+
+    for (valuePtr = entryPtr->values; valuePtr != NULL; 
+	 valuePtr = valuePtr->nextPtr) {
+	CountValueWidth(tvPtr, valuePtr, valuePtr->width);
+    }
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * ResetColumnWidths --
+ *
+ *	Empties the width histograms of the columns.  The values of
+ *	the entries are counted again as the entries are laid out.
+ *	This is only needed when entries may have left the layout
+ *	without being deleted, or when styles or fonts changed.
+ *
+ * Results:
+ *	None.
+ *
+ * ----------------------------------------------------------------------
+ */
+static void
+ResetColumnWidths(TreeView *tvPtr)
+{
+    Blt_ChainLink *linkPtr;
+    TreeViewColumn *columnPtr;
+
+    for (linkPtr = Blt_ChainFirstLink(tvPtr->colChainPtr); linkPtr != NULL;
+	 linkPtr = Blt_ChainNextLink(linkPtr)) {
+	columnPtr = Blt_ChainGetValue(linkPtr);
+	if (columnPtr->widthCounts != NULL) {
+	    memset(columnPtr->widthCounts, 0, 
+		columnPtr->nWidthCounts * sizeof(int));
+	}
+	columnPtr->maxWidth = 0;
+    }
+    tvPtr->widthEpoch++;
+    tvPtr->recountWidths = FALSE;
+}
+
 void
 Blt_TreeViewDestroyValue(TreeView *tvPtr, TreeViewEntry *entryPtr, TreeViewValue *valuePtr)
 {
+    if (valuePtr->countEpoch == tvPtr->widthEpoch) {
+	CountValueWidth(tvPtr, valuePtr, 0);
+    }
     if (valuePtr->stylePtr != NULL) {
 	Blt_TreeViewFreeStyle(tvPtr, valuePtr->stylePtr);
     }
@@ -2242,17 +2442,26 @@ void
 Blt_TreeViewFreeEntry(TreeView *tvPtr, TreeViewEntry *entryPtr)
 {
     Blt_HashEntry *hPtr;
+    TreeViewEntry *parentPtr;
 
     if (entryPtr == NULL) return;
     entryPtr->flags |= ENTRY_DELETED;
+    /* 
+     * Don't create an entry for the parent: it may be in the middle
+     * of being deleted too.
+     */
+    parentPtr = NULL;
+    if ((entryPtr->node != NULL) && (entryPtr->node != tvPtr->rootNode)) {
+	parentPtr = FindEntry(tvPtr, Blt_TreeNodeParent(entryPtr->node));
+    }
     if (entryPtr == tvPtr->activePtr) {
-	tvPtr->activePtr = Blt_TreeViewParentEntry(entryPtr);
+	tvPtr->activePtr = parentPtr;
     }
     if (entryPtr == tvPtr->activeButtonPtr) {
 	tvPtr->activeButtonPtr = NULL;
     }
     if (entryPtr == tvPtr->focusPtr) {
-	tvPtr->focusPtr = Blt_TreeViewParentEntry(entryPtr);
+	tvPtr->focusPtr = parentPtr;
 	Blt_SetFocusItem(tvPtr->bindTable, tvPtr->focusPtr, ITEM_ENTRY);
     }
     if (entryPtr == tvPtr->selAnchorPtr) {
@@ -2306,6 +2515,7 @@ Blt_TreeViewSelectEntry(TreeView *tvPtr, TreeViewEntry *entryPtr,
     int isNew;
     Blt_HashEntry *hPtr;
 
+    entryPtr->flags |= ENTRY_REDRAW;
     hPtr = Blt_CreateHashEntry(&tvPtr->selectTable, (char *)entryPtr, &isNew);
     if (isNew) {
 	Blt_ChainLink *linkPtr;
@@ -2329,6 +2539,7 @@ Blt_TreeViewDeselectEntry(TreeView *tvPtr, TreeViewEntry *entryPtr,
     Blt_HashEntry *hPtr;
     Blt_ChainLink *linkPtr;
 
+    entryPtr->flags |= ENTRY_REDRAW;
     hPtr = Blt_FindHashEntry(&tvPtr->selectTable, (char *)entryPtr);
     if (columnPtr != NULL) {
         TreeViewValue *valuePtr;
@@ -2437,6 +2648,7 @@ Blt_TreeViewCloseEntry(TreeView *tvPtr, TreeViewEntry *entryPtr)
     }
 
     entryPtr->flags |= ENTRY_CLOSED;
+    tvPtr->recountWidths = TRUE;
 
     /*
      * Invoke the entry's "close" command, if there is one. Otherwise
@@ -2467,6 +2679,7 @@ int
 Blt_TreeViewOpenEntry(TreeView *tvPtr, TreeViewEntry *entryPtr)
 {
     char *cmd;
+    int deleted = FALSE;
 
     int disabled = (entryPtr->state == STATE_DISABLED);
 
@@ -2490,14 +2703,20 @@ Blt_TreeViewOpenEntry(TreeView *tvPtr, TreeViewEntry *entryPtr)
 	Blt_TreeViewPercentSubst(tvPtr, entryPtr, NULL, cmd, "", &dString);
 	Tcl_Preserve(entryPtr);
 	result = Tcl_GlobalEval(tvPtr->interp, Tcl_DStringValue(&dString));
+	deleted = (entryPtr->flags & ENTRY_DELETED);
 	Tcl_Release(entryPtr);
 	Tcl_DStringFree(&dString);
 	if (result != TCL_OK) {
-            tvPtr->flags |= TV_LAYOUT;
+            tvPtr->flags |= (TV_LAYOUT | TV_DIRTY);
 	    return TCL_ERROR;
 	}
     }
-    tvPtr->flags |= TV_LAYOUT;
+    if ((!deleted) && ((entryPtr->flags & ENTRY_CLOSED) == 0)) {
+	/* Closed branches are skipped when the tree is resorted. */
+	Blt_TreeViewSortOpenedEntry(tvPtr, entryPtr);
+    }
+    /* The children may not have been created or measured yet. */
+    tvPtr->flags |= (TV_LAYOUT | TV_DIRTY);
     return TCL_OK;
 }
 
@@ -2506,9 +2725,9 @@ Blt_TreeViewOpenEntry(TreeView *tvPtr, TreeViewEntry *entryPtr)
  *
  * Blt_TreeViewCreateEntry --
  *
- *	This procedure is called by the Tree object when a node is 
- *	created and inserted into the tree.  It adds a new treeview 
- *	entry field to the node.
+ *	Creates the treeview entry of a node, if it doesn't already
+ *	exist, and configures it.  Entries of nodes created by other
+ *	clients of the tree are made on demand by Blt_NodeToEntry.
  *
  * Results:
  *	Returns the entry.
@@ -2529,16 +2748,15 @@ Blt_TreeViewCreateEntry(
 
     hPtr = Blt_CreateHashEntry(&tvPtr->entryTable, (char *)node, &isNew);
     if (isNew) {
-	/* Create the entry structure */
-	entryPtr = Blt_PoolAllocItem(tvPtr->entryPool, sizeof(TreeViewEntry));
-	memset(entryPtr, 0, sizeof(TreeViewEntry));
-	entryPtr->flags = tvPtr->buttonFlags | ENTRY_CLOSED;
-	entryPtr->tvPtr = tvPtr;
-	entryPtr->labelUid = NULL;
-	entryPtr->node = node;
-	entryPtr->underline = -1;
-	Blt_SetHashValue(hPtr, entryPtr);
-
+	entryPtr = NewEntry(tvPtr, node, hPtr);
+	if (entryPtr == NULL) {
+	    return TCL_ERROR;
+	}
+	if (objc == 0) {
+	    tvPtr->flags |= (TV_LAYOUT | TV_DIRTY | TV_RESORT);
+	    Blt_TreeViewEventuallyRedraw(tvPtr);
+	    return TCL_OK;
+	}
     } else {
 	entryPtr = Blt_GetHashValue(hPtr);
     }
@@ -2553,16 +2771,173 @@ Blt_TreeViewCreateEntry(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewEntry --
+ *
+ *	Creates an entry with the default configuration for a node
+ *	and stores it in the given hash entry.  The layout of the
+ *	widget isn't marked dirty: an entry made on demand is either
+ *	already being laid out or isn't displayed.
+ *
+ * Results:
+ *	Returns the new entry or NULL if it couldn't be configured.
+ *
+ *----------------------------------------------------------------------
+ */
+static TreeViewEntry *
+NewEntry(TreeView *tvPtr, Blt_TreeNode node, Blt_HashEntry *hPtr)
+{
+    TreeViewEntry *entryPtr;
+    unsigned int layoutFlags;
+    int depth;
+
+    entryPtr = Blt_PoolAllocItem(tvPtr->entryPool, sizeof(TreeViewEntry));
+    memset(entryPtr, 0, sizeof(TreeViewEntry));
+    entryPtr->flags = tvPtr->buttonFlags | ENTRY_CLOSED;
+    entryPtr->tvPtr = tvPtr;
+    entryPtr->labelUid = NULL;
+    entryPtr->node = node;
+    entryPtr->underline = -1;
+    Blt_SetHashValue(hPtr, entryPtr);
+
+    layoutFlags = tvPtr->flags & (TV_LAYOUT | TV_DIRTY | TV_RESORT);
+    if (Blt_TreeViewConfigureEntry(tvPtr, entryPtr, 0, NULL, 0) != TCL_OK) {
+	Blt_DeleteHashEntry(&tvPtr->entryTable, hPtr);
+	Blt_TreeViewFreeEntry(tvPtr, entryPtr);
+	return NULL;
+    }
+    tvPtr->flags &= ~(TV_LAYOUT | TV_DIRTY | TV_RESORT);
+    tvPtr->flags |= layoutFlags;
+
+    depth = Blt_TreeNodeDepth(tvPtr->tree, node);
+    if (tvPtr->maxEntryDepth < depth) {
+	tvPtr->maxEntryDepth = depth;
+    }
+    if ((!tvPtr->flatView) && (tvPtr->levelInfo != NULL) && 
+	(tvPtr->depth < depth)) {
+	/* 
+	 * The entry is deeper than any laid out so far.  Grow the
+	 * level information so that it can be used before the next
+	 * layout.
+	 */
+	tvPtr->levelInfo = Blt_Realloc(tvPtr->levelInfo, 
+		(depth + 2) * sizeof(LevelInfo));
+	assert(tvPtr->levelInfo);
+	memset(tvPtr->levelInfo + tvPtr->depth + 2, 0, 
+	       (depth - tvPtr->depth) * sizeof(LevelInfo));
+	tvPtr->depth = depth;
+	tvPtr->flags |= (TV_LAYOUT | TV_DIRTY);
+	Blt_TreeViewEventuallyRedraw(tvPtr);
+    }
+    return entryPtr;
+}
 
-/*ARGSUSED*/
+/*
+ *----------------------------------------------------------------------
+ *
+ * IsReleasable --
+ *
+ *	Indicates if an entry holds nothing that can't be recreated
+ *	from its node and the widget defaults.  Such an entry can be
+ *	released while its subtree is collapsed.
+ *
+ *----------------------------------------------------------------------
+ */
 static int
-CreateApplyProc(
-    Blt_TreeNode node,		/* Node that has just been created. */
-    ClientData clientData,
-    int order)			/* Not used. */
+IsReleasable(TreeView *tvPtr, TreeViewEntry *entryPtr)
 {
-    TreeView *tvPtr = clientData; 
-    return Blt_TreeViewCreateEntry(tvPtr, node, 0, NULL, 0);
+    TreeViewValue *valuePtr;
+    Blt_TreeNode node;
+    TreeViewEntry *parentPtr;
+
+    if ((entryPtr->flags & (ENTRY_CONFIGURED | ENTRY_HIDDEN | ENTRY_WINDOW |
+	    ENTRY_DATA_WINDOW)) || ((entryPtr->flags & ENTRY_CLOSED) == 0)) {
+	return FALSE;
+    }
+    if ((entryPtr == tvPtr->rootPtr) || (entryPtr == tvPtr->focusPtr) ||
+	(entryPtr == tvPtr->activePtr) || 
+	(entryPtr == tvPtr->activeButtonPtr) ||
+	(entryPtr == tvPtr->selAnchorPtr) || 
+	(entryPtr == tvPtr->selMarkPtr) || (entryPtr == tvPtr->fromPtr)) {
+	return FALSE;
+    }
+    if (Blt_FindHashEntry(&tvPtr->selectTable, (char *)entryPtr) != NULL) {
+	return FALSE;
+    }
+    for (valuePtr = entryPtr->values; valuePtr != NULL; 
+	 valuePtr = valuePtr->nextPtr) {
+	if (valuePtr->stylePtr != NULL) {
+	    return FALSE;
+	}
+    }
+    /* The entry must be inside of a closed subtree. */
+    for (node = Blt_TreeNodeParent(entryPtr->node); node != NULL; 
+	 node = Blt_TreeNodeParent(node)) {
+	parentPtr = FindEntry(tvPtr, node);
+	if ((parentPtr == NULL) || (parentPtr->flags & ENTRY_CLOSED)) {
+	    return TRUE;
+	}
+	if (node == tvPtr->rootNode) {
+	    break;
+	}
+    }
+    return FALSE;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseCollapsedEntries --
+ *
+ *	Frees entries of collapsed subtrees once the number of entries
+ *	exceeds the -maxentries limit.  They are recreated on demand
+ *	if their subtrees are opened again.
+ *
+ * Side effects:
+ *	The layout isn't affected since none of the released entries
+ *	are displayed.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+ReleaseCollapsedEntries(TreeView *tvPtr)
+{
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
+    TreeViewEntry *entryPtr, **releaseArr;
+    int i, count;
+
+    if ((tvPtr->maxEntries <= 0) || 
+	(tvPtr->entryTable.numEntries <= tvPtr->maxEntries) ||
+	(tvPtr->entryTable.numEntries <= tvPtr->nRetained)) {
+	return;
+    }
+    releaseArr = Blt_Malloc(tvPtr->entryTable.numEntries * 
+	sizeof(TreeViewEntry *));
+    assert(releaseArr);
+    count = 0;
+    for (hPtr = Blt_FirstHashEntry(&tvPtr->entryTable, &cursor); 
+	 hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	entryPtr = Blt_GetHashValue(hPtr);
+	if (IsReleasable(tvPtr, entryPtr)) {
+	    releaseArr[count++] = entryPtr;
+	}
+    }
+    for (i = 0; i < count; i++) {
+	entryPtr = releaseArr[i];
+	hPtr = Blt_FindHashEntry(&tvPtr->entryTable, (char *)entryPtr->node);
+	if (hPtr != NULL) {
+	    Blt_DeleteHashEntry(&tvPtr->entryTable, hPtr);
+	}
+	Blt_DeleteBindings(tvPtr->bindTable, entryPtr);
+	entryPtr->flags |= ENTRY_DELETED;
+	entryPtr->node = NULL;
+	Tcl_EventuallyFree(entryPtr, DestroyEntry);
+    }
+    Blt_Free(releaseArr);
+    tvPtr->nRetained = tvPtr->entryTable.numEntries;
 }
 
 /*ARGSUSED*/
@@ -2594,29 +2969,70 @@ TreeEventProc(ClientData clientData, Blt_TreeNotifyEvent *eventPtr)
         tvPtr->flags |= TV_ATTACH;
         break; */
     case TREE_NOTIFY_CREATE:
-	return Blt_TreeViewCreateEntry(tvPtr, node, 0, NULL, 0);
+	/* The entry is created when the node is first viewed. */
+	if (node != NULL) {
+	    Blt_TreeViewFilterNode(tvPtr, node);
+	}
+	tvPtr->flags |= (TV_LAYOUT | TV_DIRTY | TV_RESORT);
+	Blt_TreeViewEventuallyRedraw(tvPtr);
+	break;
     case TREE_NOTIFY_DELETE:
 	/*  
 	 * Deleting the tree node triggers a call back to free the
 	 * treeview entry that is associated with it.
 	 */
 	if (node != NULL) {
-	    Blt_TreeViewFreeEntry(tvPtr, Blt_NodeToEntry(tvPtr, node));
+	    Blt_TreeViewFilterDeleteNode(tvPtr, node);
+	    Blt_TreeViewFreeEntry(tvPtr, FindEntry(tvPtr, node));
 	}
 	break;
     case TREE_NOTIFY_RELABEL:
 	if (node != NULL) {
 	    TreeViewEntry *entryPtr;
 
-	    entryPtr = Blt_NodeToEntry(tvPtr, node);
-	    entryPtr->flags |= ENTRY_DIRTY;
+	    entryPtr = FindEntry(tvPtr, node);
+	    if (entryPtr != NULL) {
+		entryPtr->flags |= ENTRY_DIRTY;
+	    }
+	    Blt_TreeViewFilterNode(tvPtr, node);
 	}
 	/*FALLTHRU*/
     case TREE_NOTIFY_MOVE:
+	if (eventPtr->type == TREE_NOTIFY_MOVE) {
+	    tvPtr->recountWidths = TRUE;
+	    if (tvPtr->filterPtr != NULL) {
+		/* The matches moved to other ancestors. */
+		tvPtr->filterPtr->dirty = TRUE;
+	    }
+	}
+	/*FALLTHRU*/
     case TREE_NOTIFY_SORT:
 	Blt_TreeViewEventuallyRedraw(tvPtr);
 	tvPtr->flags |= (TV_LAYOUT | TV_DIRTY);
 	break;
+    case TREE_NOTIFY_BATCH:
+	/* 
+	 * The children of the node were moved, relabeled or sorted
+	 * by a batch.  Remeasure them and lay out the widget once.
+	 */
+	if (node != NULL) {
+	    TreeViewEntry *entryPtr;
+	    Blt_TreeNode child;
+
+	    for (child = Blt_TreeFirstChild(node); child != NULL;
+		 child = Blt_TreeNextSibling(child)) {
+		entryPtr = FindEntry(tvPtr, child);
+		if (entryPtr != NULL) {
+		    entryPtr->flags |= ENTRY_DIRTY;
+		}
+	    }
+	}
+	if (tvPtr->filterPtr != NULL) {
+	    tvPtr->filterPtr->dirty = TRUE;
+	}
+	Blt_TreeViewEventuallyRedraw(tvPtr);
+	tvPtr->flags |= (TV_LAYOUT | TV_DIRTY | TV_RESORT);
+	break;
     default:
 	/* empty */
 	break;
@@ -2651,6 +3067,8 @@ Blt_TreeViewMakeValue(TreeView *tvPtr, TreeViewColumn *columnPtr, TreeViewEntry
     valuePtr->stylePtr = NULL;
     valuePtr->string = NULL;
     valuePtr->selected = 0;
+    valuePtr->countedWidth = 0;
+    valuePtr->countEpoch = 0;
     /*entryPtr->values = valuePtr; */
     return valuePtr;
 }
@@ -2675,6 +3093,8 @@ Blt_TreeViewAddValue(TreeViewEntry *entryPtr, TreeViewColumn *columnPtr)
                 valuePtr->stylePtr = NULL;
                 valuePtr->string = (objPtr ? Tcl_GetString(objPtr) : NULL);
                 valuePtr->selected = 0;
+                valuePtr->countedWidth = 0;
+                valuePtr->countEpoch = 0;
                 entryPtr->values = valuePtr;
         }
     }
@@ -2733,8 +3153,12 @@ TreeTraceProc(
 	    Blt_TreeViewAddValue(entryPtr, columnPtr);
 	}
 	entryPtr->flags |= ENTRY_DIRTY;
-	Blt_TreeViewEventuallyRedraw(tvPtr);
 	tvPtr->flags |= (TV_LAYOUT | TV_DIRTY | TV_RESORT);
+	/* 
+	 * Unless the layout changes, only the row of the entry is
+	 * redrawn.
+	 */
+	Blt_TreeViewEventuallyRedrawEntry(tvPtr, entryPtr);
 	break;
 
     case TREE_TRACE_UNSET:
@@ -3477,6 +3901,7 @@ CreateTreeView(
     tvPtr->button.closeRelief = tvPtr->button.openRelief = TK_RELIEF_SOLID;
     tvPtr->reqWidth = 200;
     tvPtr->reqHeight = 200;
+    tvPtr->widthEpoch = 1;
     tvPtr->xScrollUnits = tvPtr->yScrollUnits = 20;
     tvPtr->lineWidth = 1;
     tvPtr->button.borderWidth = 1;
@@ -3575,8 +4000,10 @@ DestroyTreeView(DestroyData dataPtr)	/* Pointer to the widget record. */
     if (tvPtr->treePath != NULL) {
         Blt_Free( tvPtr->treePath );
     }
+    tvPtr->widthEpoch++;		/* Values outlive the columns. */
     Blt_TreeViewDestroyColumns(tvPtr);
-    Blt_TreeDeleteEventHandler(tvPtr->tree, TREE_NOTIFY_ALL, TreeEventProc, 
+    Blt_TreeDeleteEventHandler(tvPtr->tree, 
+	TREE_NOTIFY_ALL | TREE_NOTIFY_BATCH, TreeEventProc, 
 	   tvPtr);
     for (hPtr = Blt_FirstHashEntry(&tvPtr->entryTable, &cursor); hPtr != NULL;
 	 hPtr = Blt_NextHashEntry(&cursor)) {
@@ -3612,6 +4039,33 @@ DestroyTreeView(DestroyData dataPtr)	/* Pointer to the widget record. */
 	Blt_Free(tvPtr->flatArr);
          tvPtr->flatArr = NULL;
     }
+    if (tvPtr->rowTree != NULL) {
+	Blt_Free(tvPtr->rowTree);
+	tvPtr->rowTree = NULL;
+    }
+    if (tvPtr->backing != None) {
+	Tk_FreePixmap(tvPtr->display, tvPtr->backing);
+	tvPtr->backing = None;
+    }
+    if (tvPtr->fillGroups != NULL) {
+	int i;
+
+	for (i = 0; i < tvPtr->nFillAlloc; i++) {
+	    if (tvPtr->fillGroups[i].rects != NULL) {
+		Blt_Free(tvPtr->fillGroups[i].rects);
+	    }
+	}
+	Blt_Free(tvPtr->fillGroups);
+	tvPtr->fillGroups = NULL;
+    }
+    if (tvPtr->drawnArr != NULL) {
+	Blt_Free(tvPtr->drawnArr);
+	tvPtr->drawnArr = NULL;
+    }
+    if (tvPtr->geomArr != NULL) {
+	Blt_Free(tvPtr->geomArr);
+	tvPtr->geomArr = NULL;
+    }
     if (tvPtr->levelInfo != NULL) {
 	Blt_Free(tvPtr->levelInfo);
 	tvPtr->levelInfo = NULL;
@@ -3633,6 +4087,11 @@ DestroyTreeView(DestroyData dataPtr)	/* Pointer to the widget record. */
     tvPtr->bindTable = NULL;
     Blt_ChainDestroy(tvPtr->selChainPtr);
     tvPtr->selChainPtr = NULL;
+    if (tvPtr->loaderChainPtr != NULL) {
+	Blt_TreeViewCancelInserts(tvPtr);
+	Blt_ChainDestroy(tvPtr->loaderChainPtr);
+	tvPtr->loaderChainPtr = NULL;
+    }
     Blt_DeleteHashTable(&tvPtr->entryTagTable);
     Blt_DeleteHashTable(&tvPtr->columnTagTable);
     Blt_DeleteHashTable(&tvPtr->buttonTagTable);
@@ -3752,6 +4211,7 @@ TreeViewEventProc(
 	if (tvPtr->flags & TV_SELECT_PENDING) {
 	    Tcl_CancelIdleCall(Blt_TreeViewSelectCmdProc, tvPtr);
 	}
+	Blt_TreeViewCancelInserts(tvPtr);
 	Tcl_EventuallyFree(tvPtr, DestroyTreeView);
     }
 }
@@ -3868,18 +4328,39 @@ WidgetInstCmdDeleteProc(ClientData clientData)
     }
 }
 
-void Blt_TreeViewMakeStyleDirty(tvPtr)
-TreeView *tvPtr;
+/*
+ * ----------------------------------------------------------------------
+ *
+ * Blt_TreeViewMarkEntriesDirty --
+ *
+ *	Marks every entry that has been created for remeasuring.
+ *	Entries not yet created don't need to be visited.
+ *
+ * ----------------------------------------------------------------------
+ */
+void
+Blt_TreeViewMarkEntriesDirty(TreeView *tvPtr)
 {
-    TreeViewColumn *columnPtr;
-    Blt_ChainLink *linkPtr;
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
     TreeViewEntry *entryPtr;
-    tvPtr->flags |= (TV_LAYOUT | TV_SCROLL |TV_DIRTY);
-    Blt_TreeViewUpdateStyles(tvPtr);
-    for (entryPtr = tvPtr->rootPtr; entryPtr != NULL; 
-    entryPtr = Blt_TreeViewNextEntry(entryPtr, 0)) {
-        entryPtr->flags |= ENTRY_DIRTY;
+
+    for (hPtr = Blt_FirstHashEntry(&tvPtr->entryTable, &cursor); 
+	 hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	entryPtr = Blt_GetHashValue(hPtr);
+	entryPtr->flags |= ENTRY_DIRTY;
     }
+}
+
+void Blt_TreeViewMakeStyleDirty(tvPtr)
+TreeView *tvPtr;
+{
+    TreeViewColumn *columnPtr;
+    Blt_ChainLink *linkPtr;
+    tvPtr->flags |= (TV_LAYOUT | TV_SCROLL |TV_DIRTY);
+    tvPtr->rowHeight = 0;	/* Re-estimate the heights of a virtual view. */
+    Blt_TreeViewUpdateStyles(tvPtr);
+    Blt_TreeViewMarkEntriesDirty(tvPtr);
 
     for (linkPtr = Blt_ChainFirstLink(tvPtr->colChainPtr); 
         linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
@@ -3901,7 +4382,8 @@ SetupTree(Tcl_Interp *interp,  TreeView *tvPtr)
         Blt_Free( tvPtr->treePath );
     }
     tvPtr->treePath = Blt_Strdup(Blt_TreeName(tvPtr->tree));
-    Blt_TreeCreateEventHandler(tvPtr->tree, TREE_NOTIFY_ALL, TreeEventProc, 
+    Blt_TreeCreateEventHandler(tvPtr->tree, 
+	TREE_NOTIFY_ALL | TREE_NOTIFY_BATCH, TreeEventProc, 
         tvPtr);
     TraceColumns(tvPtr);
     if (tvPtr->rootNodeNum == 0 ||
@@ -3910,8 +4392,13 @@ SetupTree(Tcl_Interp *interp,  TreeView *tvPtr)
     }
     tvPtr->rootNode = root;
 
-    /* Automatically add view-entry values to the new tree. */
-    Blt_TreeApply(root, CreateApplyProc, tvPtr);
+    /* 
+     * Only the root entry is made now. The entries of the other nodes
+     * are created on demand, as they're viewed.
+     */
+    if (Blt_TreeViewCreateEntry(tvPtr, root, 0, NULL, 0) != TCL_OK) {
+	return TCL_ERROR;
+    }
     tvPtr->focusPtr = tvPtr->rootPtr = Blt_NodeToEntry(tvPtr, root);
     tvPtr->selMarkPtr = tvPtr->selAnchorPtr = NULL;
     Blt_SetFocusItem(tvPtr->bindTable, tvPtr->rootPtr, ITEM_ENTRY);
@@ -4069,7 +4556,7 @@ Blt_TreeViewUpdateWidget(Tcl_Interp *interp, TreeView *tvPtr)
      */
     if (setupTree == FALSE && Blt_ObjConfigModified(bltTreeViewSpecs, interp,
         "-font", "-title*", "-pad*",
-	"-linespacing", "-*width", "-height", "-hide*", "-flat",
+	"-linespacing", "-*width", "-height", "-hide*", "-flat", "-virtual",
 	"-show*", "-icons", "-activeicons", "-leaficons", "-minheight",
 	"-*style", "-levelstyles", "-fillnull", "-levelpad", "-formatcmd",
 	(char *)NULL)) {
@@ -4081,19 +4568,24 @@ Blt_TreeViewUpdateWidget(Tcl_Interp *interp, TreeView *tvPtr)
      * and free the array representing the flattened view of the tree.
      */
     if (Blt_ObjConfigModified(bltTreeViewSpecs, interp, "-hide*", "-flat",
-        (char *)NULL)) {
-	TreeViewEntry *entryPtr;
-	
+        "-virtual", (char *)NULL)) {
 	tvPtr->flags |= (TV_DIRTY | TV_RESORT);
 	/* Mark all entries dirty. */
-	for (entryPtr = tvPtr->rootPtr; setupTree == FALSE && entryPtr != NULL; 
-	     entryPtr = Blt_TreeViewNextEntry(entryPtr, 0)) {
-	    entryPtr->flags |= ENTRY_DIRTY;
+	if (setupTree == FALSE) {
+	    Blt_TreeViewMarkEntriesDirty(tvPtr);
 	}
 	if ((!tvPtr->flatView) && (tvPtr->flatArr != NULL)) {
 	    Blt_Free(tvPtr->flatArr);
 	    tvPtr->flatArr = NULL;
 	}
+	if (tvPtr->rowTree != NULL) {
+	    Blt_Free(tvPtr->rowTree);
+	    tvPtr->rowTree = NULL;
+	}
+    }
+    if (Blt_ObjConfigModified(bltTreeViewSpecs, interp, "-maxentries", 
+	(char *)NULL)) {
+	tvPtr->nRetained = 0;
     }
     if ((tvPtr->reqHeight != Tk_ReqHeight(tvPtr->tkwin)) ||
 	(tvPtr->reqWidth != Tk_ReqWidth(tvPtr->tkwin))) {
@@ -4153,6 +4645,7 @@ ResetCoordinates(
 	(Blt_TreeViewEntryIsHidden(entryPtr))) {
 	return;     /* If the entry is hidden, then do nothing. */
     }
+    CountEntryWidths(tvPtr, entryPtr);
     entryPtr->worldY = *yPtr;
     entryPtr->vertLineLength = -(*yPtr);
     *yPtr += entryPtr->height;
@@ -4241,6 +4734,194 @@ AdjustColumns(TreeView *tvPtr)
     }
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * BuildRowTree --
+ *
+ *	Builds the Fenwick (binary indexed) tree of row heights used
+ *	by a virtual flat view.  Entries that haven't been measured
+ *	yet are given the estimated row height.  The tree is built in
+ *	linear time.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	The flat indices of all entries and the world height are set.
+ *
+ * ----------------------------------------------------------------------
+ */
+static int
+BuildRowTree(TreeView *tvPtr)
+{
+    TreeViewEntry *entryPtr;
+    int i, j, n, sum, height;
+
+    n = tvPtr->nEntries;
+    if ((tvPtr->rowHeight == 0) && (n > 0)) {
+	/* Measure the first entry to estimate the height of the rest. */
+	entryPtr = tvPtr->flatArr[0];
+	if (GetEntryExtents(tvPtr, entryPtr) != TCL_OK) { return TCL_ERROR; }
+	tvPtr->rowHeight = entryPtr->height;
+	tvPtr->minHeight = entryPtr->height;
+    }
+    if (tvPtr->rowHeight < 1) {
+	tvPtr->rowHeight = 1;
+    }
+    if (tvPtr->rowTree != NULL) {
+	Blt_Free(tvPtr->rowTree);
+    }
+    tvPtr->rowTree = Blt_Calloc(n + 1, sizeof(int));
+    assert(tvPtr->rowTree);
+    sum = 0;
+    for (i = 1; i <= n; i++) {
+	entryPtr = tvPtr->flatArr[i - 1];
+	entryPtr->flatIndex = i - 1;
+	height = entryPtr->height;
+	if ((height <= 0) || (entryPtr->flags & ENTRY_DIRTY)) {
+	    height = tvPtr->rowHeight;
+	}
+	sum += height;
+	tvPtr->rowTree[i] += height;
+	j = i + (i & -i);
+	if (j <= n) {
+	    tvPtr->rowTree[j] += tvPtr->rowTree[i];
+	}
+    }
+    tvPtr->worldHeight = sum;
+    return TCL_OK;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * RowOffset --
+ *
+ *	Returns the world y-coordinate of the given row of a virtual
+ *	flat view, i.e. the sum of the heights of all rows above it.
+ *
+ * ----------------------------------------------------------------------
+ */
+static int
+RowOffset(TreeView *tvPtr, int row)
+{
+    int sum;
+
+    sum = 0;
+    for (/*empty*/; row > 0; row -= (row & -row)) {
+	sum += tvPtr->rowTree[row];
+    }
+    return sum;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * AdjustRowHeight --
+ *
+ *	Changes the height of a row of a virtual flat view by the
+ *	given amount, shifting all the rows below it.
+ *
+ * ----------------------------------------------------------------------
+ */
+static void
+AdjustRowHeight(TreeView *tvPtr, int row, int delta)
+{
+    for (row++; row <= tvPtr->nEntries; row += (row & -row)) {
+	tvPtr->rowTree[row] += delta;
+    }
+    tvPtr->worldHeight += delta;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * FindRow --
+ *
+ *	Searches the Fenwick tree for the row of a virtual flat view
+ *	containing the given world y-coordinate.
+ *
+ * Results:
+ *	Returns the index of the row.  If the coordinate is beyond the
+ *	last row, the number of rows is returned.
+ *
+ * ----------------------------------------------------------------------
+ */
+static int
+FindRow(TreeView *tvPtr, int y)
+{
+    int row, step;
+
+    for (step = 1; (step << 1) <= tvPtr->nEntries; step <<= 1) {
+	/* empty */
+    }
+    row = 0;
+    for (/*empty*/; step > 0; step >>= 1) {
+	if (((row + step) <= tvPtr->nEntries) && 
+	    (tvPtr->rowTree[row + step] <= y)) {
+	    row += step;
+	    y -= tvPtr->rowTree[row];
+	}
+    }
+    return row;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * MeasureRow --
+ *
+ *	Computes the extents of a row of a virtual flat view that is
+ *	about to be displayed.  If the height differs from the one
+ *	recorded in the Fenwick tree, the rows below are shifted.  The
+ *	level widths only ever grow here.  The values stay counted in
+ *	the column widths after scrolling out of view.  Both are reset
+ *	when the view is re-estimated.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	The world y-coordinate of the entry is set.
+ *
+ * ----------------------------------------------------------------------
+ */
+static int
+MeasureRow(TreeView *tvPtr, TreeViewEntry *entryPtr)
+{
+    LevelInfo *infoPtr;
+    int row, y, oldHeight;
+
+    row = entryPtr->flatIndex;
+    y = RowOffset(tvPtr, row);
+    if (entryPtr->flags & ENTRY_DIRTY) {
+	oldHeight = RowOffset(tvPtr, row + 1) - y;
+	if (GetEntryExtents(tvPtr, entryPtr) != TCL_OK) { return TCL_ERROR; }
+	if (entryPtr->height != oldHeight) {
+	    AdjustRowHeight(tvPtr, row, entryPtr->height - oldHeight);
+	}
+    }
+    entryPtr->worldY = y;
+    entryPtr->vertLineLength = 0;
+    entryPtr->flags &= ~ENTRY_HAS_BUTTON;
+    if (tvPtr->minHeight > entryPtr->height) {
+	tvPtr->minHeight = entryPtr->height;
+    }
+    infoPtr = tvPtr->levelInfo;
+    if (infoPtr->labelWidth < entryPtr->labelWidth) {
+	infoPtr->labelWidth = entryPtr->labelWidth;
+    }
+    if (tvPtr->flags & TV_HIDE_ICONS) {
+	infoPtr->iconWidth = 5;
+    } else if (infoPtr->iconWidth < entryPtr->iconWidth) {
+	infoPtr->iconWidth = entryPtr->iconWidth;
+    }
+    infoPtr->iconWidth |= 0x01;
+    CountEntryWidths(tvPtr, entryPtr);
+    return TCL_OK;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -4268,7 +4949,12 @@ ComputeFlatLayout(TreeView *tvPtr)
     int count;
     int maxX;
     int y;
+    int isVirtual;
 
+    isVirtual = tvPtr->virtualView;
+    if ((isVirtual) && (tvPtr->flags & TV_UPDATE)) {
+	tvPtr->rowHeight = 0;
+    }
     /* 
      * Pass 1:	Reinitialize column sizes and loop through all nodes. 
      *
@@ -4289,7 +4975,6 @@ ComputeFlatLayout(TreeView *tvPtr)
 	for (linkPtr = Blt_ChainFirstLink(tvPtr->colChainPtr); 
 	     linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
 	    columnPtr = Blt_ChainGetValue(linkPtr);
-	    columnPtr->maxWidth = 0;
 	    columnPtr->max = SHRT_MAX;
 	    if (columnPtr->reqMax > 0) {
 		columnPtr->max = columnPtr->reqMax;
@@ -4303,6 +4988,12 @@ ComputeFlatLayout(TreeView *tvPtr)
 	    Blt_Free(tvPtr->flatArr);
 	    tvPtr->flatArr = NULL;
 	}
+	if ((tvPtr->flatArr == NULL) || (tvPtr->rowHeight == 0)) {
+	    if (tvPtr->rowTree != NULL) {
+		Blt_Free(tvPtr->rowTree);
+		tvPtr->rowTree = NULL;
+	    }
+	}
 
 	/* Recreate the flat view of all the open and not-hidden entries. */
 	if (tvPtr->flatArr == NULL) {
@@ -4336,22 +5027,46 @@ ComputeFlatLayout(TreeView *tvPtr)
 	    tvPtr->flags &= ~TV_SORTED;	/* Indicate the view isn't sorted. */
 	}
 
-	/* Collect the extents of the entries in the flat view. */
 	tvPtr->depth = 0;
-	tvPtr->minHeight = SHRT_MAX;
-	for (p = tvPtr->flatArr; p != NULL && *p != NULL; p++) {
-	    entryPtr = *p;
-	    if (GetEntryExtents(tvPtr, entryPtr) != TCL_OK) { return TCL_ERROR; }
-	    if (tvPtr->minHeight > entryPtr->height) {
-		tvPtr->minHeight = entryPtr->height;
+	if (isVirtual) {
+	    /* 
+	     * Entries of a virtual view are measured only as they
+	     * scroll into the viewport.  If the view is being
+	     * re-estimated, restart the high-water marks of the
+	     * level widths.
+	     */
+	    if (tvPtr->flags & TV_UPDATE) {
+		for (p = tvPtr->flatArr; *p != NULL; p++) {
+		    (*p)->flags |= ENTRY_LAYOUT_PENDING;
+		}
 	    }
-	    entryPtr->flags &= ~ENTRY_HAS_BUTTON;
-	}
-	if (tvPtr->levelInfo != NULL) {
-	    Blt_Free(tvPtr->levelInfo);
+	    if ((tvPtr->levelInfo == NULL) || (tvPtr->rowHeight == 0)) {
+		if (tvPtr->levelInfo != NULL) {
+		    Blt_Free(tvPtr->levelInfo);
+		}
+		tvPtr->levelInfo = Blt_Calloc(2, sizeof(LevelInfo));
+		assert(tvPtr->levelInfo);
+		tvPtr->minHeight = SHRT_MAX;
+	    }
+	} else {
+	    /* Collect the extents of the entries in the flat view. */
+	    tvPtr->minHeight = SHRT_MAX;
+	    for (p = tvPtr->flatArr; p != NULL && *p != NULL; p++) {
+		entryPtr = *p;
+		if (GetEntryExtents(tvPtr, entryPtr) != TCL_OK) { 
+		    return TCL_ERROR; 
+		}
+		if (tvPtr->minHeight > entryPtr->height) {
+		    tvPtr->minHeight = entryPtr->height;
+		}
+		entryPtr->flags &= ~ENTRY_HAS_BUTTON;
+	    }
+	    if (tvPtr->levelInfo != NULL) {
+		Blt_Free(tvPtr->levelInfo);
+	    }
+	    tvPtr->levelInfo = Blt_Calloc(tvPtr->depth + 2, sizeof(LevelInfo));
+	    assert(tvPtr->levelInfo);
 	}
-	tvPtr->levelInfo = Blt_Calloc(tvPtr->depth + 2, sizeof(LevelInfo));
-	assert(tvPtr->levelInfo);
 	tvPtr->flags &= ~(TV_DIRTY | TV_UPDATE | TV_RESORT);
 	if (tvPtr->flags & TV_SORT_AUTO) {
 	    /* If we're auto-sorting, schedule the view to be resorted. */
@@ -4361,6 +5076,28 @@ ComputeFlatLayout(TreeView *tvPtr)
 
     if (tvPtr->flags & TV_SORT_PENDING) {
 	Blt_TreeViewSortFlatView(tvPtr);
+	if (tvPtr->rowTree != NULL) {
+	    Blt_Free(tvPtr->rowTree);
+	    tvPtr->rowTree = NULL;
+	}
+    }
+    if (isVirtual) {
+	/* 
+	 * Only the row heights are needed to lay out a virtual view.
+	 * The world coordinates of each entry are set as it enters
+	 * the viewport.
+	 */
+	if (tvPtr->rowTree == NULL) {
+	    if (BuildRowTree(tvPtr) != TCL_OK) { return TCL_ERROR; }
+	}
+	if (tvPtr->worldHeight < 1) {
+	    tvPtr->worldHeight = 1;
+	}
+	tvPtr->treeWidth = tvPtr->levelInfo[0].iconWidth + 
+	    tvPtr->levelInfo[0].labelWidth;
+	tvPtr->treeColumn.maxWidth = tvPtr->treeWidth;
+	tvPtr->flags |= TV_VIEWPORT;
+	return TCL_OK;
     }
 
     tvPtr->levelInfo[0].labelWidth = tvPtr->levelInfo[0].x = 
@@ -4385,6 +5122,7 @@ ComputeFlatLayout(TreeView *tvPtr)
 	entryPtr->worldY = y;
 	entryPtr->vertLineLength = 0;
 	y += entryPtr->height;
+	CountEntryWidths(tvPtr, entryPtr);
 	if (tvPtr->levelInfo[0].labelWidth < entryPtr->labelWidth) {
 	    tvPtr->levelInfo[0].labelWidth = entryPtr->labelWidth;
 	}
@@ -4448,14 +5186,13 @@ ComputeTreeLayout(TreeView *tvPtr)
      *		4. Build an array to hold level information to be filled
      *		   in on pass 2.
      */
-    if (tvPtr->flags & TV_DIRTY) {
+    if (tvPtr->flags & (TV_DIRTY | TV_UPDATE)) {
 	int position;
 
 	position = 1;
 	for (linkPtr = Blt_ChainFirstLink(tvPtr->colChainPtr); 
 	     linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
 	    columnPtr = Blt_ChainGetValue(linkPtr);
-	    columnPtr->maxWidth = 0;
 	    columnPtr->max = SHRT_MAX;
 	    if (columnPtr->reqMax > 0) {
 		columnPtr->max = columnPtr->reqMax;
@@ -4465,8 +5202,13 @@ ComputeTreeLayout(TreeView *tvPtr)
 	}
 	tvPtr->minHeight = SHRT_MAX;
 	tvPtr->depth = 0;
+	/* 
+	 * Skip the descendants of closed entries.  They aren't displayed
+	 * and their entries may not have been created yet.  They're
+	 * measured once opened.
+	 */
 	for (entryPtr = tvPtr->rootPtr; entryPtr != NULL; 
-	     entryPtr = Blt_TreeViewNextEntry(entryPtr, 0)) {
+	     entryPtr = Blt_TreeViewNextEntry(entryPtr, ENTRY_CLOSED)) {
 	    if (GetEntryExtents(tvPtr, entryPtr) != TCL_OK) { return TCL_ERROR; }
 	    if (tvPtr->minHeight > entryPtr->height) {
 		tvPtr->minHeight = entryPtr->height;
@@ -4495,6 +5237,10 @@ ComputeTreeLayout(TreeView *tvPtr)
 		tvPtr->depth = DEPTH(tvPtr, entryPtr->node);
 	    }
 	}
+	if (tvPtr->depth < tvPtr->maxEntryDepth) {
+	    /* Cover entries created outside of the layout. */
+	    tvPtr->depth = tvPtr->maxEntryDepth;
+	}
 	if (tvPtr->flags & TV_SORT_PENDING) {
 	    Blt_TreeViewSortTreeView(tvPtr);
 	}
@@ -4503,7 +5249,7 @@ ComputeTreeLayout(TreeView *tvPtr)
 	}
 	tvPtr->levelInfo = Blt_Calloc(tvPtr->depth + 2, sizeof(LevelInfo));
 	assert(tvPtr->levelInfo);
-	tvPtr->flags &= ~(TV_DIRTY | TV_RESORT);
+	tvPtr->flags &= ~(TV_DIRTY | TV_UPDATE | TV_RESORT);
     }
     for (i = 0; i <= (tvPtr->depth + 1); i++) {
 	tvPtr->levelInfo[i].labelWidth = tvPtr->levelInfo[i].x = 
@@ -4655,25 +5401,25 @@ Blt_TreeViewComputeLayout(TreeView *tvPtr)
 {
     Blt_ChainLink *linkPtr;
     TreeViewColumn *columnPtr;
-    TreeViewEntry *entryPtr;
-    TreeViewValue *valuePtr;
 
+    /*
+     * The width of a column is that of its widest value.  The widths
+     * of the values displayed are kept in a histogram per column,
+     * updated as values are measured, laid out or destroyed.  They
+     * are counted from scratch only when styles or fonts changed,
+     * or when entries may have left the layout.
+     */
+    if ((tvPtr->flags & TV_UPDATE) || (tvPtr->recountWidths)) {
+	ResetColumnWidths(tvPtr);
+    }
     if (tvPtr->flatView) {
 	if (ComputeFlatLayout(tvPtr) != TCL_OK) { return TCL_ERROR; }
     } else {
         if (ComputeTreeLayout(tvPtr) != TCL_OK) { return TCL_ERROR; }
     }
-    /*
-     * Determine the width of each column based upon the entries
-     * that as open (not hidden).  The widest entry in a column
-     * determines the width of that column.
-     */
-
-    /* Initialize the columns. */
     for (linkPtr = Blt_ChainFirstLink(tvPtr->colChainPtr); 
 	 linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
 	columnPtr = Blt_ChainGetValue(linkPtr);
-	columnPtr->maxWidth = 0;
 	columnPtr->max = SHRT_MAX;
 	if (columnPtr->reqMax > 0) {
 	    columnPtr->max = columnPtr->reqMax;
@@ -4682,24 +5428,53 @@ Blt_TreeViewComputeLayout(TreeView *tvPtr)
     /* The treeview column width was computed earlier. */
     tvPtr->treeColumn.maxWidth = tvPtr->treeWidth;
 
-    /* 
-     * Look at all open entries and their values.  Determine the column
-     * widths by tracking the maximum width value in each column.
-     */
-    for (entryPtr = tvPtr->rootPtr; entryPtr != NULL; 
-	 entryPtr = Blt_TreeViewNextEntry(entryPtr, ENTRY_MASK)) {
-	for (valuePtr = entryPtr->values; valuePtr != NULL; 
-	     valuePtr = valuePtr->nextPtr) {
-	    if (valuePtr->columnPtr->maxWidth < valuePtr->width) {
-		valuePtr->columnPtr->maxWidth = valuePtr->width;
-	    }
-	}	    
-    }
     /* Now layout the columns with the proper sizes. */
     LayoutColumns(tvPtr);
     return TCL_OK;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * Blt_TreeViewLocateEntry --
+ *
+ *	Makes sure the world coordinates of an entry are valid, even
+ *	if it lies outside of the viewport.  In a virtual view, only
+ *	entries in the viewport are laid out, so the entry is measured
+ *	and its position computed from the row heights.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * ----------------------------------------------------------------------
+ */
+int
+Blt_TreeViewLocateEntry(TreeView *tvPtr, TreeViewEntry *entryPtr)
+{
+    int worldHeight;
+
+    if ((!tvPtr->flatView) || (!tvPtr->virtualView)) {
+	return TCL_OK;
+    }
+    if (tvPtr->flags & TV_LAYOUT) {
+	if (Blt_TreeViewComputeLayout(tvPtr) != TCL_OK) { return TCL_ERROR; }
+    }
+    if ((tvPtr->rowTree == NULL) || (entryPtr->flatIndex < 0) || 
+	(entryPtr->flatIndex >= tvPtr->nEntries) ||
+	(tvPtr->flatArr[entryPtr->flatIndex] != entryPtr)) {
+	return TCL_OK;		/* Entry isn't in the flat view. */
+    }
+    worldHeight = tvPtr->worldHeight;
+    if (MeasureRow(tvPtr, entryPtr) != TCL_OK) { return TCL_ERROR; }
+    entryPtr->worldX = LEVELX(0) + tvPtr->treeColumn.worldX;
+    if (tvPtr->worldHeight != worldHeight) {
+	/* The estimated height was off. Update the scrollbars. */
+	tvPtr->flags |= TV_SCROLL;
+	Blt_TreeViewEventuallyRedraw(tvPtr);
+    }
+    return TCL_OK;
+}
+
 static int
 ComputeFillLabel(TreeView *tvPtr, TreeViewEntry *entryPtr)
 {
@@ -4799,7 +5574,57 @@ ComputeVisibleEntries(TreeView *tvPtr)
 	return TCL_OK;		/* Root node is hidden. */
     }
     /* Find the node where the view port starts. */
-    if (tvPtr->flatView) {
+    if ((tvPtr->flatView) && (tvPtr->virtualView)) {
+	TreeViewEntry *entryPtr;
+	int i, yBottom;
+
+	if ((tvPtr->rowTree == NULL) || (tvPtr->nEntries == 0)) {
+	    return TCL_OK;	/* All entries are hidden. */
+	}
+	/* Binary search the row heights for the first visible entry. */
+	for (;;) {
+	    nAbove = FindRow(tvPtr, tvPtr->yOffset);
+	    if (nAbove < tvPtr->nEntries) {
+		break;
+	    }
+	    if (tvPtr->yOffset == 0) {
+		return TCL_OK;
+	    }
+	    tvPtr->yOffset = 0;
+	}
+	yBottom = height + tvPtr->yOffset;
+	for (i = nAbove; i < tvPtr->nEntries; i++) {
+	    entryPtr = tvPtr->flatArr[i];
+	    if (MeasureRow(tvPtr, entryPtr) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if (entryPtr->worldY >= yBottom) {
+		break;
+	    }
+	    if (ComputeFillLabel(tvPtr, entryPtr) != TCL_OK) {
+	        return TCL_ERROR;
+	    }
+	    entryPtr->stylePtr = entryPtr->realStylePtr;
+	    if (tvPtr->nVisible == nSlots) {
+		/* Rows shorter than any seen so far. Grow the array. */
+		nSlots += nSlots;
+		tvPtr->visibleArr = Blt_Realloc(tvPtr->visibleArr, 
+			(nSlots + 1) * sizeof(TreeViewEntry *));
+		assert(tvPtr->visibleArr);
+	    }
+	    tvPtr->visibleArr[tvPtr->nVisible] = entryPtr;
+	    tvPtr->nVisible++;
+	}
+	tvPtr->visibleArr[tvPtr->nVisible] = NULL;
+	tvPtr->treeWidth = tvPtr->levelInfo[0].iconWidth + 
+	    tvPtr->levelInfo[0].labelWidth;
+	tvPtr->treeColumn.maxWidth = tvPtr->treeWidth;
+	LayoutColumns(tvPtr);	/* Measured entries may widen columns. */
+	for (i = 0; i < tvPtr->nVisible; i++) {
+	    entryPtr = tvPtr->visibleArr[i];
+	    entryPtr->worldX = LEVELX(0) + tvPtr->treeColumn.worldX;
+	}
+    } else if (tvPtr->flatView) {
 	register TreeViewEntry **p, *entryPtr;
 
 	/* Find the starting entry visible in the viewport. It can't
@@ -4941,6 +5766,37 @@ ComputeVisibleEntries(TreeView *tvPtr)
 }
 
 
+/*
+ * ---------------------------------------------------------------------------
+ *
+ * ClipLineStart --
+ *
+ *	Moves the start of a vertical line down to the given bound.
+ *	The start is moved by whole dash periods, so that the dots
+ *	of a line stay in place whatever part of it is drawn.  Rows
+ *	redrawn or scrolled into view then match the rows copied from
+ *	the retained frame.
+ *
+ * Results:
+ *	Returns the new start of the line.
+ *
+ * ---------------------------------------------------------------------------
+ */
+static int
+ClipLineStart(
+    TreeView *tvPtr,
+    int y,			/* Start of the line. */
+    int bound)			/* Topmost coordinate to be drawn. */
+{
+    int period;
+
+    if (y >= bound) {
+	return y;
+    }
+    period = (tvPtr->dashes > 0) ? 2 * tvPtr->dashes : 1;
+    return y + ((bound - y + period - 1) / period) * period;
+}
+
 /*
  * ---------------------------------------------------------------------------
  *
@@ -4996,13 +5852,7 @@ DrawVerticals(
 	/*
 	 * Clip the line's Y-coordinates at the viewport borders.
 	 */
-	if (y1a <= tvPtr->insetY) {
-	    y1a = tvPtr->insetY+1;
-	}
-	if (y1a < 0) {
-	    y1a = (y1a & 0x1);	/* Make sure the dotted line starts on 
-				 * the same even/odd pixel. */
-	}
+	y1a = ClipLineStart(tvPtr, y1a, tvPtr->insetY + 1);
 	if (y2 > (Tk_Height(tvPtr->tkwin)-tvPtr->insetY)) {
              y2 = (Tk_Height(tvPtr->tkwin)-tvPtr->insetY);
 	}
@@ -5749,9 +6599,7 @@ DrawTreeEntry(
 	 * Entry is open, draw vertical line.
 	 */
 	y2 = y1a + entryPtr->vertLineLength;
-	if (y1a < tvPtr->insetY) {
-	    y1a = tvPtr->insetY;
-	}
+	y1a = ClipLineStart(tvPtr, y1a, tvPtr->insetY);
 	if (y2 > Tk_Height(tvPtr->tkwin)) {
 	    y2 = Tk_Height(tvPtr->tkwin); /* Clip line at window border. */
 	}
@@ -5797,33 +6645,22 @@ DrawTreeEntry(
 /*
  * ---------------------------------------------------------------------------
  *
- * Blt_TreeViewDrawValue --
- *
- * 	Draws a column value for the given entry.  
- *
- * Results:
- *	None.
+ * GetValueStyle --
  *
- * Side Effects:
- *	A button is drawn for the entry.
+ * 	Returns the style a column value is drawn with.
  *
  * ---------------------------------------------------------------------------
  */
-void
-Blt_TreeViewDrawValue(
-    TreeView *tvPtr,		/* Widget record. */
-    TreeViewEntry *entryPtr,	/* Node of entry to be drawn. */
+static TreeViewStyle *
+GetValueStyle(
+    TreeView *tvPtr,
+    TreeViewEntry *entryPtr,
     TreeViewValue *valuePtr,
-    Drawable drawable,		/* Pixmap or window to draw into. */
-    int x, 
-    int y,
-    int altRow,
-    int ishid)
+    int altRow)
 {
     TreeViewStyle *stylePtr, *csPtr;
     TreeViewColumn *columnPtr;
-    TreeViewIcon icon = NULL;
-    
+
     columnPtr = valuePtr->columnPtr;
     csPtr = CHOOSE(tvPtr->stylePtr, columnPtr->stylePtr);
 
@@ -5838,11 +6675,7 @@ Blt_TreeViewDrawValue(
     } else {
         stylePtr = CHOOSE(csPtr, valuePtr->stylePtr);
     }
-    if (stylePtr == NULL) {
-        /* fprintf(stderr, "FATAL: EMPTY STYLE VALUE\n"); */
-        return;
-    }
-    if (stylePtr != csPtr && columnPtr->stylePtr) {
+    if ((stylePtr != NULL) && (stylePtr != csPtr) && columnPtr->stylePtr) {
         /* If style !Window and type != col style type, reset to column style. */
         if (0 && stylePtr->classPtr->className[0] != 'W' &&
             strcmp(stylePtr->classPtr->className,
@@ -5850,6 +6683,45 @@ Blt_TreeViewDrawValue(
             stylePtr = columnPtr->stylePtr;
         }
     }
+    return stylePtr;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ *
+ * Blt_TreeViewDrawValue --
+ *
+ * 	Draws a column value for the given entry.  
+ *
+ * Results:
+ *	None.
+ *
+ * Side Effects:
+ *	A button is drawn for the entry.
+ *
+ * ---------------------------------------------------------------------------
+ */
+void
+Blt_TreeViewDrawValue(
+    TreeView *tvPtr,		/* Widget record. */
+    TreeViewEntry *entryPtr,	/* Node of entry to be drawn. */
+    TreeViewValue *valuePtr,
+    Drawable drawable,		/* Pixmap or window to draw into. */
+    int x, 
+    int y,
+    int altRow,
+    int ishid)
+{
+    TreeViewStyle *stylePtr;
+    TreeViewColumn *columnPtr;
+    TreeViewIcon icon = NULL;
+    
+    columnPtr = valuePtr->columnPtr;
+    stylePtr = GetValueStyle(tvPtr, entryPtr, valuePtr, altRow);
+    if (stylePtr == NULL) {
+        /* fprintf(stderr, "FATAL: EMPTY STYLE VALUE\n"); */
+        return;
+    }
     if (tvPtr->hideStyleIcons) {
         icon = NULL;
     } else if (ishid) {
@@ -5864,6 +6736,50 @@ Blt_TreeViewDrawValue(
 		stylePtr, icon, x, y + tvPtr->leader/2);
 }
 
+/*
+ * ---------------------------------------------------------------------------
+ *
+ * QueueValueBackground --
+ *
+ * 	Queues the fill of the background of a column value, the
+ *	way its style would fill it when drawn.
+ *
+ * Results:
+ *	Returns 1 if the value has a background, 0 otherwise.
+ *
+ * ---------------------------------------------------------------------------
+ */
+static int
+QueueValueBackground(
+    TreeView *tvPtr,		/* Widget record. */
+    TreeViewEntry *entryPtr,	/* Node of entry to be drawn. */
+    TreeViewValue *valuePtr,
+    Drawable drawable,		/* Pixmap or window to draw into. */
+    int x,			/* Left edge of the column. */
+    int y,
+    int altRow)
+{
+    TreeViewStyle *stylePtr;
+    TreeViewColumn *columnPtr;
+    Tk_3DBorder border;
+    Blt_Tile tile;
+
+    stylePtr = GetValueStyle(tvPtr, entryPtr, valuePtr, altRow);
+    if (stylePtr == NULL) {
+	return FALSE;
+    }
+    border = Blt_TreeViewGetValueBorder(tvPtr, entryPtr, valuePtr, stylePtr, 
+	&tile);
+    if (border == NULL) {
+	return FALSE;
+    }
+    columnPtr = valuePtr->columnPtr;
+    Blt_TreeViewBatchFill3DTile(tvPtr, drawable, border, x, y, 
+	columnPtr->width, entryPtr->height, 0, TK_RELIEF_FLAT, tile, 
+	tvPtr->scrollTile, 1);
+    return TRUE;
+}
+
 static void
 DrawTitle(
     TreeView *tvPtr,
@@ -6085,10 +7001,11 @@ GetEntryBorder(TreeView *tvPtr, TreeViewEntry *entryPtr, int n)
 
 
 static void
-DrawTreeView(tvPtr, drawable, x)
+DrawTreeView(tvPtr, drawable, x, rowArr)
     TreeView *tvPtr;
     Drawable drawable;
     int x;
+    TreeViewEntry **rowArr;	/* Entries to be drawn. */
 {
     register TreeViewEntry **p;
     Tk_3DBorder selBorder, altBorder;
@@ -6105,7 +7022,7 @@ DrawTreeView(tvPtr, drawable, x)
     if (tvPtr->altStylePtr) {
         altBorder = Blt_TreeViewGetStyleBorder(tvPtr, tvPtr->altStylePtr);
     }
-    for (p = tvPtr->visibleArr; p != NULL && *p != NULL; p++, n++) {
+    for (p = rowArr; p != NULL && *p != NULL; p++, n++) {
         int y;
         isAlt = (((*p)->flags & ENTRY_ALTROW) && (tvPtr->altStylePtr));
         ePtr = (*p)->stylePtr;
@@ -6129,11 +7046,21 @@ DrawTreeView(tvPtr, drawable, x)
          }
     }
     if ((tvPtr->lineWidth > 0) && (tvPtr->nVisible > 0)) { 
-	/* Draw all the vertical lines from topmost node. */
-	DrawVerticals(tvPtr, tvPtr->visibleArr[0], drawable);
+	if (rowArr == tvPtr->visibleArr) {
+	    /* Draw all the vertical lines from topmost node. */
+	    DrawVerticals(tvPtr, tvPtr->visibleArr[0], drawable);
+	} else {
+	    /* 
+	     * Only some rows are redrawn.  The lines of their
+	     * ancestors pass through each of them.
+	     */
+	    for (p = rowArr; *p != NULL; p++) {
+		DrawVerticals(tvPtr, *p, drawable);
+	    }
+	}
     }
 
-    for (p = tvPtr->visibleArr; p != NULL && *p != NULL; p++) {
+    for (p = rowArr; p != NULL && *p != NULL; p++) {
         DrawTreeEntry(tvPtr, *p, drawable);
         if (tvPtr->flags & TV_DELETED) break;
     }
@@ -6143,7 +7070,8 @@ static void
 DrawFlatView(
     TreeView *tvPtr,
     Drawable drawable,
-    int x)
+    int x,
+    TreeViewEntry **rowArr)	/* Entries to be drawn. */
 {
     register TreeViewEntry **p;
     Tk_3DBorder selBorder, altBorder;
@@ -6160,7 +7088,7 @@ DrawFlatView(
         altBorder = Blt_TreeViewGetStyleBorder(tvPtr, aPtr);
     }
 
-    for (p = tvPtr->visibleArr; p != NULL && *p != NULL; p++, n++) {
+    for (p = rowArr; p != NULL && *p != NULL; p++, n++) {
         isAlt = (((*p)->flags & ENTRY_ALTROW) && (tvPtr->altStylePtr));
         y = SCREENY(tvPtr, (*p)->worldY);
         ePtr = (*p)->stylePtr;
@@ -6183,7 +7111,7 @@ DrawFlatView(
                  0, TK_RELIEF_FLAT, ePtr->tile, 0, 0);
         }
     }
-    for (p = tvPtr->visibleArr; p != NULL && *p != NULL; p++) {
+    for (p = rowArr; p != NULL && *p != NULL; p++) {
 	DrawFlatEntry(tvPtr, *p, drawable);
         if (tvPtr->flags & TV_DELETED) break;
     }
@@ -6240,6 +7168,719 @@ extern void Blt_TreeViewFill3DTile (TreeView *tvPtr,
         }
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * Blt_TreeViewBatchFill3DTile --
+ *
+ *	Like Blt_TreeViewFill3DTile, but plain rectangles are only
+ *	queued by GC, to be filled by Blt_TreeViewFlushFills with one
+ *	request for each GC.  Tiled or raised rectangles are drawn
+ *	right away.  Queued rectangles must not overlap those drawn
+ *	before the flush.
+ *
+ * ----------------------------------------------------------------------
+ */
+void
+Blt_TreeViewBatchFill3DTile(TreeView *tvPtr, Drawable drawable, 
+    Tk_3DBorder border, int x, int y, int width, int height, int borderWidth,
+    int relief, Blt_Tile tile, int scrollTile, int flags)
+{
+    FillGroup *groupPtr, *endPtr;
+    XRectangle *rectPtr;
+    GC gc;
+
+    if ((tile != NULL) || 
+	((relief != TK_RELIEF_FLAT) && (borderWidth > 0))) {
+	Blt_TreeViewFill3DTile(tvPtr, drawable, border, x, y, width, height,
+		borderWidth, relief, tile, scrollTile, flags);
+	return;
+    }
+    if ((width <= 0) || (height <= 0)) {
+	return;
+    }
+    gc = Tk_3DBorderGC(tvPtr->tkwin, border, TK_3D_FLAT_GC);
+    endPtr = tvPtr->fillGroups + tvPtr->nFillGroups;
+    for (groupPtr = tvPtr->fillGroups; groupPtr < endPtr; groupPtr++) {
+	if (groupPtr->gc == gc) {
+	    break;
+	}
+    }
+    if (groupPtr == endPtr) {
+	if (tvPtr->nFillGroups == tvPtr->nFillAlloc) {
+	    tvPtr->nFillAlloc++;
+	    tvPtr->fillGroups = Blt_Realloc(tvPtr->fillGroups, 
+		tvPtr->nFillAlloc * sizeof(FillGroup));
+	    assert(tvPtr->fillGroups);
+	    groupPtr = tvPtr->fillGroups + tvPtr->nFillGroups;
+	    groupPtr->rects = NULL;
+	    groupPtr->nAlloc = 0;
+	}
+	groupPtr = tvPtr->fillGroups + tvPtr->nFillGroups;
+	tvPtr->nFillGroups++;
+	groupPtr->gc = gc;
+	groupPtr->nRects = 0;
+    }
+    if (groupPtr->nRects == groupPtr->nAlloc) {
+	groupPtr->nAlloc = (groupPtr->nAlloc == 0) ? 64 : groupPtr->nAlloc * 2;
+	groupPtr->rects = Blt_Realloc(groupPtr->rects, 
+		groupPtr->nAlloc * sizeof(XRectangle));
+	assert(groupPtr->rects);
+    }
+    rectPtr = groupPtr->rects + groupPtr->nRects;
+    rectPtr->x = x;
+    rectPtr->y = y;
+    rectPtr->width = width;
+    rectPtr->height = height;
+    groupPtr->nRects++;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * Blt_TreeViewFlushFills --
+ *
+ *	Fills the rectangles queued by Blt_TreeViewBatchFill3DTile.
+ *	The arrays of rectangles are kept for the next draw.
+ *
+ * ----------------------------------------------------------------------
+ */
+void
+Blt_TreeViewFlushFills(TreeView *tvPtr, Drawable drawable)
+{
+    FillGroup *groupPtr, *endPtr;
+
+    endPtr = tvPtr->fillGroups + tvPtr->nFillGroups;
+    for (groupPtr = tvPtr->fillGroups; groupPtr < endPtr; groupPtr++) {
+	if (groupPtr->nRects > 0) {
+	    XFillRectangles(tvPtr->display, drawable, groupPtr->gc, 
+		groupPtr->rects, groupPtr->nRects);
+	}
+    }
+    tvPtr->nFillGroups = 0;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * DrawBackground --
+ *
+ *	Fills the drawable with the background of the widget.
+ *
+ * Results:
+ *	None.
+ *
+ * ----------------------------------------------------------------------
+ */
+static void
+DrawBackground(TreeView *tvPtr, Drawable drawable)
+{
+    if (Blt_HasTile(tvPtr->tile)) {
+	if (tvPtr->scrollTile) {
+	    Blt_SetTSOrigin(tvPtr->tkwin, tvPtr->tile, -tvPtr->xOffset,
+		-tvPtr->yOffset);
+	} else {
+	    Blt_SetTileOrigin(tvPtr->tkwin, tvPtr->tile, 0, 0);
+	}
+        Blt_Fill3DRectangle(tvPtr->tkwin, drawable, tvPtr->border, 0, 0,
+            Tk_Width(tvPtr->tkwin), Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
+        Blt_TileRectangle(tvPtr->tkwin, drawable, tvPtr->tile, 0, 0,
+	    Tk_Width(tvPtr->tkwin), Tk_Height(tvPtr->tkwin));
+    } else {
+        Blt_Fill3DRectangle(tvPtr->tkwin, drawable, tvPtr->border, 0, 0,
+            Tk_Width(tvPtr->tkwin), Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
+    }
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * DrawEntries --
+ *
+ *	Draws the column backgrounds and the given entries.  Columns
+ *	starting left of stripX are drawn for all the visible entries
+ *	instead.  A full redisplay passes the visible entries.
+ *
+ * Results:
+ *	Returns TCL_ERROR if the widget or an entry was deleted while
+ *	drawing, TCL_OK otherwise.
+ *
+ * ----------------------------------------------------------------------
+ */
+static int
+DrawEntries(
+    TreeView *tvPtr,
+    Drawable drawable,
+    TreeViewEntry **rowArr,	/* NULL terminated array of the entries
+				 * to be drawn. */
+    int stripX)			/* Right edge of the horizontal strip
+				 * scrolled into view. */
+{
+    Blt_ChainLink *linkPtr;
+    TreeViewColumn *columnPtr;
+    register TreeViewEntry **p;
+    TreeViewEntry **rowPtrPtr;
+    TreeViewEntry *entryPtr;
+    Tk_3DBorder border, selBorder;
+    Blt_Tile tile;
+    int x, y;
+
+    selBorder = SELECT_BORDER(tvPtr);
+    for (linkPtr = Blt_ChainFirstLink(tvPtr->colChainPtr); 
+	 linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
+
+	columnPtr = Blt_ChainGetValue(linkPtr);
+	columnPtr->flags &= ~COLUMN_DIRTY;
+	if (columnPtr->hidden) {
+	    continue;
+	}
+	x = SCREENX(tvPtr, columnPtr->worldX);
+	if ((x + columnPtr->width) < 0) {
+	    continue;       /* Don't draw columns before the left edge. */
+	}
+	if (x > Tk_Width(tvPtr->tkwin)) {
+	    break;          /* Discontinue when a column starts beyond
+			     * the right edge. */
+	}
+	/* Clear the column background. */
+	 if (columnPtr->border && (columnPtr->hasbg || columnPtr->stylePtr == NULL)) {
+	    border = columnPtr->border;
+	} else {
+	    border = Blt_TreeViewGetStyleBorder(tvPtr, columnPtr->stylePtr);
+	}
+	tile = NULL;
+	if (Blt_HasTile(columnPtr->tile)) {
+	    tile = columnPtr->tile;
+	} else if (columnPtr->stylePtr && Blt_HasTile(columnPtr->stylePtr->tile)) {
+	    tile = columnPtr->stylePtr->tile;
+	}
+	if (tile) {
+	     Blt_TreeViewFill3DTile(tvPtr, drawable, border, x, 0,
+		columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT,
+		tile, columnPtr->scrollTile, 0);
+	     Blt_Draw3DRectangle(tvPtr->tkwin, drawable, border, x, 0,
+		columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
+	} else if (Blt_HasTile(tvPtr->tile)) {
+	     Blt_Fill3DRectangle(tvPtr->tkwin, drawable, border, x, 0,
+		columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
+	     Blt_TileRectangle(tvPtr->tkwin, drawable, tvPtr->tile,
+		x, 0, columnPtr->width, Tk_Height(tvPtr->tkwin));
+	     Blt_Draw3DRectangle(tvPtr->tkwin, drawable, border, x, 0,
+		columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
+	 } else if (columnPtr->hasbg && border) {
+	     Blt_Fill3DRectangle(tvPtr->tkwin, drawable, border, x, 0,
+	     columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
+	 } else if (border) {
+	     Blt_Draw3DRectangle(tvPtr->tkwin, drawable, border, x, 0,
+		columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
+	}
+	/* 
+	 * Text may run past the right edge of its column.  So
+	 * every column starting left of the strip is drawn for
+	 * all the visible entries.
+	 */
+	rowPtrPtr = (x < stripX) ? tvPtr->visibleArr : rowArr;
+	if (columnPtr == &tvPtr->treeColumn) {
+
+	     if (tvPtr->flatView) {
+		 DrawFlatView(tvPtr, drawable, x, rowPtrPtr);
+	     } else {
+		 DrawTreeView(tvPtr, drawable, x, rowPtrPtr);
+	     }
+	     if (tvPtr->flags & TV_DELETED) return TCL_ERROR;
+	} else {
+
+	    TreeViewValue *valuePtr;
+	    TreeViewStyle *csPtr;
+	    int  ishid;
+
+	    entryPtr = NULL;
+	    csPtr = CHOOSE(tvPtr->stylePtr, columnPtr->stylePtr);
+
+	    /* 
+	     * Fill the backgrounds of the column's cells first, so that
+	     * plain fills are issued as one request for each GC, rather
+	     * than one for each cell.  A value's own background covers
+	     * the row's.
+	     */
+	    for (p = rowPtrPtr; p != NULL && *p != NULL; p++) {
+		int isAlt;
+		entryPtr = *p;
+		isAlt = (entryPtr->flags & ENTRY_ALTROW);
+		y = SCREENY(tvPtr, entryPtr->worldY);
+
+		entryPtr->flags &= ~ENTRY_FILLED;
+		valuePtr = Blt_TreeViewFindValue(entryPtr, columnPtr);
+		if (valuePtr != NULL && valuePtr->stylePtr != NULL &&
+		    valuePtr->stylePtr->hidden) {
+		    valuePtr = NULL;
+		} else if (valuePtr == NULL && (tvPtr->flags & TV_FILL_NULL)) {
+		    valuePtr = columnPtr->defValue;
+		    if (valuePtr) {
+			valuePtr->stylePtr = tvPtr->emptyStylePtr;
+		    }
+		}
+		if ((valuePtr != NULL) && (QueueValueBackground(tvPtr, entryPtr,
+			valuePtr, drawable, x, y, isAlt))) {
+		    entryPtr->flags |= ENTRY_FILLED;
+		} else if (Blt_TreeViewEntryIsSelected(tvPtr, entryPtr, columnPtr)) {
+		      Blt_TreeViewBatchFill3DTile(tvPtr, drawable, selBorder, x, y,
+			  columnPtr->width, entryPtr->height,
+			  tvPtr->selBorderWidth, tvPtr->selRelief,
+			  tvPtr->selectTile, 1, 0);
+		  } else if (isAlt && tvPtr->altStylePtr
+		&& tvPtr->altStylePtr->border
+		&& tvPtr->altStylePtr->priority>=csPtr->priority ) {
+		     Blt_TreeViewBatchFill3DTile(tvPtr, drawable,
+			tvPtr->altStylePtr->border,
+			x, y, columnPtr->width, 
+			entryPtr->height,
+			0, TK_RELIEF_FLAT, NULL, 0, 0);
+		} else if (entryPtr->stylePtr && entryPtr->stylePtr->border) {
+		     Blt_TreeViewBatchFill3DTile(tvPtr, drawable,
+			entryPtr->stylePtr->border,
+			x, y, columnPtr->width, 
+			entryPtr->height,
+			0, TK_RELIEF_FLAT, NULL, 0, 0);
+		}
+	    }
+	    Blt_TreeViewFlushFills(tvPtr, drawable);
+
+	    for (p = rowPtrPtr; p != NULL && *p != NULL; p++) {
+		int isAlt;
+		entryPtr = *p;
+		isAlt = (entryPtr->flags & ENTRY_ALTROW);
+		y = SCREENY(tvPtr, entryPtr->worldY);
+
+		/* Check if there's a corresponding value in the entry. */
+		valuePtr = Blt_TreeViewFindValue(entryPtr, columnPtr);
+		ishid = 0;
+		if (valuePtr != NULL && valuePtr->stylePtr != NULL &&
+		    valuePtr->stylePtr->hidden) {
+		      valuePtr = NULL;
+		      ishid = 1;
+		}
+		if (valuePtr == NULL && columnPtr->fillCmd != NULL
+		    && strlen(Tcl_GetString(columnPtr->fillCmd))) {
+		    Tcl_Interp *interp = tvPtr->interp;
+		    int result, objc;
+		    char *string = Blt_TreeNodeLabel(entryPtr->node);
+		    Tcl_Obj **objv, *objPtr = Tcl_DuplicateObj(columnPtr->fillCmd);
+
+		    Tcl_ListObjAppendElement(interp, objPtr, Tcl_NewStringObj(string,-1));
+		    Tcl_IncrRefCount(objPtr);
+		    if (Tcl_ListObjGetElements(interp, objPtr, &objc, &objv) == TCL_OK) {
+			Tcl_Obj *listObjPtr;
+
+			Tcl_Preserve(entryPtr);
+			result = Tcl_EvalObjv(interp, objc, objv, TCL_EVAL_GLOBAL);
+			if ((entryPtr->flags & ENTRY_DELETED) ||
+			    (tvPtr->flags & TV_DELETED)) {
+			    Tcl_DecrRefCount(objPtr);
+			    Tcl_Release(entryPtr);
+			    return TCL_ERROR;
+			}
+			string = Tcl_GetStringResult(interp);
+			if (result != TCL_ERROR) {
+			    listObjPtr = Tcl_DuplicateObj(Tcl_GetObjResult(interp));
+			} else {
+			    listObjPtr = Tcl_NewStringObj("",-1);
+			}
+			Tcl_IncrRefCount(listObjPtr);
+			if (Blt_TreeSetValueByKey(tvPtr->interp, tvPtr->tree, entryPtr->node, columnPtr->key, listObjPtr) == TCL_OK) {
+			    Blt_TreeViewAddValue(entryPtr, columnPtr);
+			    Blt_TreeViewEventuallyRedraw(tvPtr);
+			}
+			Tcl_DecrRefCount(listObjPtr);
+			Tcl_Release(entryPtr);
+		    }
+		    Tcl_DecrRefCount(objPtr);
+		}
+		if (valuePtr == NULL && (tvPtr->flags & TV_FILL_NULL)) {
+		    valuePtr = columnPtr->defValue;
+		    if (valuePtr) {
+			valuePtr->stylePtr = tvPtr->emptyStylePtr;
+		    }
+		}
+		if (valuePtr != NULL) {
+		    tvPtr->valueFilled = (entryPtr->flags & ENTRY_FILLED);
+		    Blt_TreeViewDrawValue(tvPtr, entryPtr, valuePtr, 
+			    drawable, x + columnPtr->pad.side1, y,
+			    isAlt, ishid);
+		    tvPtr->valueFilled = FALSE;
+		    if (tvPtr->flags & TV_DELETED) return TCL_ERROR;
+		    if (tvPtr->ruleWidth) {
+			DrawEntryRule( tvPtr, entryPtr, columnPtr, drawable, x, y);
+		    }
+		}
+	    }
+	}
+	if (columnPtr->relief != TK_RELIEF_FLAT) {
+	     Blt_Draw3DRectangle(tvPtr->tkwin, drawable, border, x,
+		 tvPtr->padY, columnPtr->width,
+		 Tk_Height(tvPtr->tkwin)-(tvPtr->padY*2), 
+		 columnPtr->borderWidth, columnPtr->relief);
+	}
+
+    }
+    return TCL_OK;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * GetGeometry --
+ *
+ *	Collects the positions of the columns and tree levels.  Rows
+ *	can be copied from the retained frame only if these haven't
+ *	changed since it was drawn.
+ *
+ * Results:
+ *	Returns a malloc-ed array of the positions.  Its length is
+ *	returned via nPtr.
+ *
+ * ----------------------------------------------------------------------
+ */
+static int *
+GetGeometry(TreeView *tvPtr, int *nPtr)
+{
+    Blt_ChainLink *linkPtr;
+    TreeViewColumn *columnPtr;
+    int *geomArr, *ip;
+    int i, nLevels;
+
+    nLevels = 0;
+    if (tvPtr->levelInfo != NULL) {
+	nLevels = (tvPtr->flatView) ? 2 : tvPtr->depth + 2;
+    }
+    geomArr = Blt_Malloc((4 + 3 * Blt_ChainGetLength(tvPtr->colChainPtr) +
+	2 * nLevels) * sizeof(int));
+    assert(geomArr);
+    ip = geomArr;
+    *ip++ = tvPtr->flatView;
+    *ip++ = tvPtr->insetX;
+    *ip++ = tvPtr->insetY;
+    *ip++ = tvPtr->titleHeight;
+    for (linkPtr = Blt_ChainFirstLink(tvPtr->colChainPtr); linkPtr != NULL;
+	 linkPtr = Blt_ChainNextLink(linkPtr)) {
+	columnPtr = Blt_ChainGetValue(linkPtr);
+	*ip++ = columnPtr->hidden;
+	*ip++ = columnPtr->worldX;
+	*ip++ = columnPtr->width;
+    }
+    for (i = 0; i < nLevels; i++) {
+	*ip++ = tvPtr->levelInfo[i].x;
+	*ip++ = tvPtr->levelInfo[i].iconWidth;
+    }
+    *nPtr = ip - geomArr;
+    return geomArr;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * CanScrollFrame --
+ *
+ *	Indicates if the retained frame can be scrolled by copying
+ *	it.  Tiles fixed to the window, column reliefs, and embedded
+ *	windows don't move along with the entries.
+ *
+ * Results:
+ *	Returns TRUE if the frame can be copied, FALSE otherwise.
+ *
+ * ----------------------------------------------------------------------
+ */
+static int
+CanScrollFrame(TreeView *tvPtr)
+{
+    Blt_ChainLink *linkPtr;
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
+    TreeViewColumn *columnPtr;
+    TreeViewStyle *stylePtr;
+
+    if (tvPtr->winCellTable.numEntries > 0) {
+	return FALSE;
+    }
+    if ((Blt_HasTile(tvPtr->tile)) && (!tvPtr->scrollTile)) {
+	return FALSE;
+    }
+    for (linkPtr = Blt_ChainFirstLink(tvPtr->colChainPtr); linkPtr != NULL;
+	 linkPtr = Blt_ChainNextLink(linkPtr)) {
+	columnPtr = Blt_ChainGetValue(linkPtr);
+	if (columnPtr->hidden) {
+	    continue;
+	}
+	if ((columnPtr->relief != TK_RELIEF_FLAT) ||
+	    ((Blt_HasTile(columnPtr->tile)) && (!columnPtr->scrollTile))) {
+	    return FALSE;
+	}
+    }
+    for (hPtr = Blt_FirstHashEntry(&tvPtr->styleTable, &cursor); hPtr != NULL;
+	 hPtr = Blt_NextHashEntry(&cursor)) {
+	stylePtr = Blt_GetHashValue(hPtr);
+	if (Blt_HasTile(stylePtr->tile)) {
+	    return FALSE;
+	}
+    }
+    return TRUE;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * RedrawDamage --
+ *
+ *	Repairs the retained frame instead of redrawing the whole
+ *	widget.  If the view was scrolled, the part still in view is
+ *	copied to its new position and only the strips scrolled into
+ *	view are drawn.  Otherwise only the rows of entries marked
+ *	ENTRY_REDRAW are drawn.  Entries still in view must be at the
+ *	same world positions as in the retained frame.
+ *
+ * Results:
+ *	Returns TCL_OK if the window was repaired, TCL_CONTINUE if
+ *	the widget must be redrawn entirely, and TCL_ERROR if drawing
+ *	was interrupted.
+ *
+ * ----------------------------------------------------------------------
+ */
+static int
+RedrawDamage(TreeView *tvPtr)
+{
+    DrawnRow *rowPtr;
+    TreeViewEntry **rowArr, **p;
+    TreeViewEntry *entryPtr;
+    Pixmap drawable;
+    Window window;
+    int dx, dy, i, j, nRows;
+    int left, right, top, bottom;
+    int stripX, stripY, stripHeight;
+    int x, y, height;
+
+    if ((tvPtr->resizeColumnPtr != NULL) && 
+	(tvPtr->flags & (TV_RULE_ACTIVE | TV_RULE_NEEDED))) {
+	return TCL_CONTINUE;	/* The rule is drawn into the window. */
+    }
+    left = tvPtr->insetX;
+    right = Tk_Width(tvPtr->tkwin) - tvPtr->insetX;
+    top = tvPtr->insetY + tvPtr->titleHeight;
+    bottom = Tk_Height(tvPtr->tkwin) - tvPtr->insetY;
+    if ((left >= right) || (top >= bottom)) {
+	return TCL_CONTINUE;
+    }
+    dx = tvPtr->backXOffset - tvPtr->xOffset;
+    dy = tvPtr->backYOffset - tvPtr->yOffset;
+    if ((dx != 0) || (dy != 0)) {
+	if ((ABS(dx) >= (right - left)) || (ABS(dy) >= (bottom - top)) ||
+	    (!CanScrollFrame(tvPtr))) {
+	    return TCL_CONTINUE;
+	}
+    }
+
+    /* 
+     * Line up the rows of the retained frame with the visible
+     * entries.  Rows in both must not have moved or changed size.
+     * Entries that weren't in the frame are drawn.  Rows that went
+     * away must not be in view anymore.
+     */
+    i = j = 0;
+    if ((tvPtr->nDrawn > 0) && (tvPtr->nVisible > 0)) {
+	while ((j < tvPtr->nVisible) && 
+	       (tvPtr->visibleArr[j] != tvPtr->drawnArr[0].entryPtr)) {
+	    j++;
+	}
+	if (j == tvPtr->nVisible) {
+	    j = 0;
+	    while ((i < tvPtr->nDrawn) && 
+		   (tvPtr->drawnArr[i].entryPtr != tvPtr->visibleArr[0])) {
+		i++;
+	    }
+	}
+    }
+    height = bottom - top;
+    for (rowPtr = tvPtr->drawnArr; rowPtr < tvPtr->drawnArr + i; rowPtr++) {
+	if ((rowPtr->worldY < (tvPtr->yOffset + height)) &&
+	    ((rowPtr->worldY + rowPtr->height) > tvPtr->yOffset)) {
+	    return TCL_CONTINUE;
+	}
+    }
+    for (p = tvPtr->visibleArr; p < tvPtr->visibleArr + j; p++) {
+	(*p)->flags |= ENTRY_REDRAW;
+    }
+    for (/*empty*/; (i < tvPtr->nDrawn) && (j < tvPtr->nVisible); i++, j++) {
+	rowPtr = tvPtr->drawnArr + i;
+	entryPtr = tvPtr->visibleArr[j];
+	if ((rowPtr->entryPtr != entryPtr) || 
+	    (rowPtr->worldY != entryPtr->worldY) ||
+	    (rowPtr->height != entryPtr->height) ||
+	    (rowPtr->altRow != (entryPtr->flags & ENTRY_ALTROW))) {
+	    return TCL_CONTINUE;
+	}
+    }
+    for (rowPtr = tvPtr->drawnArr + i; rowPtr < tvPtr->drawnArr + tvPtr->nDrawn;
+	 rowPtr++) {
+	if ((rowPtr->worldY < (tvPtr->yOffset + height)) &&
+	    ((rowPtr->worldY + rowPtr->height) > tvPtr->yOffset)) {
+	    return TCL_CONTINUE;
+	}
+    }
+    for (/*empty*/; j < tvPtr->nVisible; j++) {
+	tvPtr->visibleArr[j]->flags |= ENTRY_REDRAW;
+    }
+
+    /* Mark the entries in the strip scrolled into view. */
+    stripY = stripHeight = 0;
+    if (dy > 0) {
+	stripY = top, stripHeight = dy;
+    } else if (dy < 0) {
+	stripY = bottom + dy, stripHeight = -dy;
+    }
+    if (stripHeight > 0) {
+	for (p = tvPtr->visibleArr; p < tvPtr->visibleArr + tvPtr->nVisible; 
+	     p++) {
+	    y = SCREENY(tvPtr, (*p)->worldY);
+	    if ((y < (stripY + stripHeight)) && ((y + (*p)->height) > stripY)) {
+		(*p)->flags |= ENTRY_REDRAW;
+	    }
+	}
+    }
+    stripX = INT_MIN;
+    if (dx > 0) {
+	stripX = left + dx;
+    } else if (dx < 0) {
+	stripX = right;
+    }
+
+    rowArr = Blt_Malloc((tvPtr->nVisible + 1) * sizeof(TreeViewEntry *));
+    assert(rowArr);
+    nRows = 0;
+    for (p = tvPtr->visibleArr; p < tvPtr->visibleArr + tvPtr->nVisible; p++) {
+	if ((*p)->flags & ENTRY_REDRAW) {
+	    rowArr[nRows++] = *p;
+	}
+    }
+    rowArr[nRows] = NULL;
+    if ((nRows > 0) && (nRows == tvPtr->nVisible)) {
+	Blt_Free(rowArr);
+	return TCL_CONTINUE;	/* Every row is damaged. */
+    }
+    if ((nRows == 0) && (dx == 0) && (dy == 0)) {
+	Blt_Free(rowArr);
+	return TCL_OK;		/* Nothing has changed. */
+    }
+
+    window = Tk_WindowId(tvPtr->tkwin);
+    if ((dx != 0) || (dy != 0)) {
+	/* Move the part still in view. */
+	x = left + MAX(0, -dx);
+	y = top + MAX(0, -dy);
+	XCopyArea(tvPtr->display, tvPtr->backing, tvPtr->backing, 
+	    tvPtr->lineGC, x, y, (right - left) - ABS(dx), 
+	    (bottom - top) - ABS(dy), x + dx, y + dy);
+    }
+
+    /* 
+     * Draw the damaged rows into a scratch pixmap.  Lines and text
+     * may run outside of them, so only the damaged areas are copied
+     * into the retained frame.
+     */
+    drawable = Tk_GetPixmap(tvPtr->display, window, Tk_Width(tvPtr->tkwin), 
+	Tk_Height(tvPtr->tkwin), Tk_Depth(tvPtr->tkwin));
+    tvPtr->flags |= TV_VIEWPORT;
+    DrawBackground(tvPtr, drawable);
+    if (DrawEntries(tvPtr, drawable, rowArr, stripX) != TCL_OK) {
+	tvPtr->flags &= ~TV_VIEWPORT;
+	Tk_FreePixmap(tvPtr->display, drawable);
+	Blt_Free(rowArr);
+	return TCL_ERROR;
+    }
+    if ((dx != 0) && (tvPtr->flags & TV_SHOW_COLUMN_TITLES)) {
+	Blt_TreeViewDrawHeadings(tvPtr, drawable);
+    }
+    tvPtr->flags &= ~TV_VIEWPORT;
+
+    if (stripHeight > 0) {
+	XCopyArea(tvPtr->display, drawable, tvPtr->backing, tvPtr->lineGC,
+	    left, stripY, right - left, stripHeight, left, stripY);
+    }
+    if (dx != 0) {
+	x = (dx > 0) ? left : right + dx;
+	XCopyArea(tvPtr->display, drawable, tvPtr->backing, tvPtr->lineGC,
+	    x, top, ABS(dx), bottom - top, x, top);
+	if (tvPtr->titleHeight > 0) {
+	    XCopyArea(tvPtr->display, drawable, tvPtr->backing, tvPtr->lineGC,
+		left, tvPtr->insetY, right - left, tvPtr->titleHeight, left, 
+		tvPtr->insetY);
+	}
+    }
+    for (p = rowArr; *p != NULL; p++) {
+	y = SCREENY(tvPtr, (*p)->worldY);
+	height = (*p)->height;
+	if (y < top) {
+	    height -= top - y;
+	    y = top;
+	}
+	if ((y + height) > bottom) {
+	    height = bottom - y;
+	}
+	if (height <= 0) {
+	    continue;
+	}
+	XCopyArea(tvPtr->display, drawable, tvPtr->backing, tvPtr->lineGC,
+	    left, y, right - left, height, left, y);
+	if ((dx == 0) && (dy == 0)) {
+	    XCopyArea(tvPtr->display, tvPtr->backing, window, tvPtr->lineGC,
+		left, y, right - left, height, left, y);
+	}
+    }
+    if ((dx != 0) || (dy != 0)) {
+	y = (dx != 0) ? tvPtr->insetY : top;
+	XCopyArea(tvPtr->display, tvPtr->backing, window, tvPtr->lineGC,
+	    left, y, right - left, bottom - y, left, y);
+    }
+    Tk_FreePixmap(tvPtr->display, drawable);
+    Blt_Free(rowArr);
+    return TCL_OK;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * SaveFrame --
+ *
+ *	Records the view offsets and the rows of the frame just
+ *	drawn, so that the next redisplay can reuse it.
+ *
+ * Results:
+ *	None.
+ *
+ * ----------------------------------------------------------------------
+ */
+static void
+SaveFrame(TreeView *tvPtr)
+{
+    DrawnRow *rowPtr;
+    TreeViewEntry *entryPtr;
+    int i;
+
+    tvPtr->backXOffset = tvPtr->xOffset;
+    tvPtr->backYOffset = tvPtr->yOffset;
+    tvPtr->drawnArr = Blt_Realloc(tvPtr->drawnArr, 
+	(tvPtr->nVisible + 1) * sizeof(DrawnRow));
+    assert(tvPtr->drawnArr);
+    rowPtr = tvPtr->drawnArr;
+    for (i = 0; i < tvPtr->nVisible; i++, rowPtr++) {
+	entryPtr = tvPtr->visibleArr[i];
+	entryPtr->flags &= ~ENTRY_REDRAW;
+	rowPtr->entryPtr = entryPtr;
+	rowPtr->worldY = entryPtr->worldY;
+	rowPtr->height = entryPtr->height;
+	rowPtr->altRow = (entryPtr->flags & ENTRY_ALTROW);
+    }
+    tvPtr->nDrawn = tvPtr->nVisible;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -6272,12 +7913,11 @@ extern void Blt_TreeViewFill3DTile (TreeView *tvPtr,
 static void
 DisplayTreeView(ClientData clientData)	/* Information about widget. */
 {
-    Blt_ChainLink *linkPtr;
     TreeView *tvPtr = clientData;
-    TreeViewColumn *columnPtr;
     Pixmap drawable; 
     int width, height;
-    int x;
+    int *geomArr;
+    int nGeom, redrawAll;
 
     Blt_TreeViewChanged(tvPtr);
     if (tvPtr->flags & TV_DELETED) return;
@@ -6286,7 +7926,10 @@ DisplayTreeView(ClientData clientData)	/* Information about widget. */
         /* Reset root to tree top. */
         tvPtr->rootNodeNum = 0;
         tvPtr->rootNode = Blt_TreeRootNode(tvPtr->tree);
-        Blt_TreeApply(tvPtr->rootNode, CreateApplyProc, tvPtr);
+        if (Blt_TreeViewCreateEntry(tvPtr, tvPtr->rootNode, 0, NULL, 0) 
+	    != TCL_OK) {
+            return;
+        }
         tvPtr->focusPtr = tvPtr->rootPtr = Blt_NodeToEntry(tvPtr, tvPtr->rootNode);
         tvPtr->flags |= TV_DIRTYALL;
         tvPtr->selMarkPtr = tvPtr->selAnchorPtr = NULL;
@@ -6299,18 +7942,14 @@ DisplayTreeView(ClientData clientData)	/* Information about widget. */
 	return;			/* Window has been destroyed. */
     }
     if (tvPtr->flags & TV_DIRTYALL) {
-        TreeViewEntry *entryPtr;
         tvPtr->flags &= ~TV_DIRTYALL;
+	tvPtr->redrawAll = TRUE;
         if (Blt_TreeViewUpdateWidget(tvPtr->interp, tvPtr) != TCL_OK) {
             return;
         }
         Blt_TreeViewUpdateStyles(tvPtr);
         Blt_TreeViewUpdateColumnGCs(tvPtr, &tvPtr->treeColumn);
         Blt_TreeViewConfigureColumns(tvPtr);
-        for (entryPtr = tvPtr->rootPtr; entryPtr != NULL; 
-        entryPtr = Blt_TreeViewNextEntry(entryPtr, 0)) {
-            entryPtr->flags |= ENTRY_DIRTY;
-        }
         Blt_TreeViewMakeStyleDirty(tvPtr);
     }
     if (tvPtr->flags & TV_LAYOUT) {
@@ -6346,6 +7985,7 @@ DisplayTreeView(ClientData clientData)	/* Information about widget. */
 	}
 	tvPtr->flags &= ~TV_SCROLL;
     }
+    ReleaseCollapsedEntries(tvPtr);
     if (tvPtr->reqWidth == 0) {
 
 	/* 
@@ -6359,227 +7999,86 @@ DisplayTreeView(ClientData clientData)	/* Information about widget. */
 	Tk_GeometryRequest(tvPtr->tkwin, tvPtr->reqWidth, tvPtr->reqHeight);
     }
     if (!Tk_IsMapped(tvPtr->tkwin)) {
+	tvPtr->redrawAll = TRUE;	/* Retained frame is out of date. */
 	return;
     }
-
-    drawable = Tk_GetPixmap(tvPtr->display, Tk_WindowId(tvPtr->tkwin), 
-	Tk_Width(tvPtr->tkwin), Tk_Height(tvPtr->tkwin), 
-	Tk_Depth(tvPtr->tkwin));
-    tvPtr->flags |= TV_VIEWPORT;
-    if (Blt_HasTile(tvPtr->tile)) {
-	if (tvPtr->scrollTile) {
-	    Blt_SetTSOrigin(tvPtr->tkwin, tvPtr->tile, -tvPtr->xOffset,
-		-tvPtr->yOffset);
-	} else {
-	    Blt_SetTileOrigin(tvPtr->tkwin, tvPtr->tile, 0, 0);
-	}
-        Blt_Fill3DRectangle(tvPtr->tkwin, drawable, tvPtr->border, 0, 0,
-            Tk_Width(tvPtr->tkwin), Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
-        Blt_TileRectangle(tvPtr->tkwin, drawable, tvPtr->tile, 0, 0,
-	    Tk_Width(tvPtr->tkwin), Tk_Height(tvPtr->tkwin));
-    } else {
-        Blt_Fill3DRectangle(tvPtr->tkwin, drawable, tvPtr->border, 0, 0,
-            Tk_Width(tvPtr->tkwin), Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
-    }
-
-    if ((tvPtr->flags & TV_RULE_ACTIVE) &&
-	(tvPtr->resizeColumnPtr != NULL)) {
-	Blt_TreeViewDrawRule(tvPtr, tvPtr->resizeColumnPtr, drawable);
-    }
-    Blt_TreeViewMarkWindows(tvPtr, TV_WINDOW_CLEAR);
     {
 	register TreeViewEntry **p;
-	TreeViewEntry *entryPtr;
-	Tk_3DBorder border, selBorder;
-	int y, altRow = 0;
-	Blt_Tile tile;
+	int altRow = 0;
 
-        entryPtr = NULL;
         for (p = tvPtr->visibleArr; p != NULL && *p != NULL; p++, altRow++) {
-            entryPtr = *p;
             if (tvPtr->altStylePtr && ((altRow+tvPtr->nAbove)%2)) {
-                entryPtr->flags |= ENTRY_ALTROW;
+                (*p)->flags |= ENTRY_ALTROW;
             } else {
-                entryPtr->flags &= ~ENTRY_ALTROW;
+                (*p)->flags &= ~ENTRY_ALTROW;
             }
         }
-        selBorder = SELECT_BORDER(tvPtr);
-	for (linkPtr = Blt_ChainFirstLink(tvPtr->colChainPtr); 
-	     linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
-            
-	    columnPtr = Blt_ChainGetValue(linkPtr);
-	    columnPtr->flags &= ~COLUMN_DIRTY;
-	    if (columnPtr->hidden) {
-		continue;
-	    }
-	    x = SCREENX(tvPtr, columnPtr->worldX);
-	    if ((x + columnPtr->width) < 0) {
-		continue;	/* Don't draw columns before the left edge. */
-	    }
-	    if (x > Tk_Width(tvPtr->tkwin)) {
-		break;		/* Discontinue when a column starts beyond
-				 * the right edge. */
-	    }
-	    /* Clear the column background. */
-             if (columnPtr->border && (columnPtr->hasbg || columnPtr->stylePtr == NULL)) {
-	        border = columnPtr->border;
-            } else {
-                border = Blt_TreeViewGetStyleBorder(tvPtr, columnPtr->stylePtr);
-            }
-            tile = NULL;
-            if (Blt_HasTile(columnPtr->tile)) {
-                tile = columnPtr->tile;
-            } else if (columnPtr->stylePtr && Blt_HasTile(columnPtr->stylePtr->tile)) {
-                tile = columnPtr->stylePtr->tile;
-            }
-            if (tile) {
-                 Blt_TreeViewFill3DTile(tvPtr, drawable, border, x, 0,
-                    columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT,
-                    tile, columnPtr->scrollTile, 0);
-                 Blt_Draw3DRectangle(tvPtr->tkwin, drawable, border, x, 0,
-                    columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
-            } else if (Blt_HasTile(tvPtr->tile)) {
-                 Blt_Fill3DRectangle(tvPtr->tkwin, drawable, border, x, 0,
-                    columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
-                 Blt_TileRectangle(tvPtr->tkwin, drawable, tvPtr->tile,
-                    x, 0, columnPtr->width, Tk_Height(tvPtr->tkwin));
-                 Blt_Draw3DRectangle(tvPtr->tkwin, drawable, border, x, 0,
-                    columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
-             } else if (columnPtr->hasbg && border) {
-                 Blt_Fill3DRectangle(tvPtr->tkwin, drawable, border, x, 0,
-                 columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
-             } else if (border) {
-                 Blt_Draw3DRectangle(tvPtr->tkwin, drawable, border, x, 0,
-                    columnPtr->width, Tk_Height(tvPtr->tkwin), 0, TK_RELIEF_FLAT);
-            }
-	    if (columnPtr == &tvPtr->treeColumn) {
-                
-                 if (tvPtr->flatView) {
-                     DrawFlatView(tvPtr, drawable, x);
-                 } else {
-                     DrawTreeView(tvPtr, drawable, x);
-                 }
-                 if (tvPtr->flags & TV_DELETED) return;
-            } else {
-	        
-                TreeViewValue *valuePtr;
-                TreeViewStyle *csPtr;
-		int  ishid;
-
-		entryPtr = NULL;
-		csPtr = CHOOSE(tvPtr->stylePtr, columnPtr->stylePtr);
-		for (p = tvPtr->visibleArr; p != NULL && *p != NULL; p++) {
-		    int isAlt;
-		    entryPtr = *p;
-		    isAlt = (entryPtr->flags & ENTRY_ALTROW);
-		    y = SCREENY(tvPtr, entryPtr->worldY);
-
-		    /* Draw the background of the value. */
-		    if (Blt_TreeViewEntryIsSelected(tvPtr, entryPtr, columnPtr)) {
-                          Blt_TreeViewFill3DTile(tvPtr, drawable, selBorder, x, y,
-                              columnPtr->width, entryPtr->height,
-                              tvPtr->selBorderWidth, tvPtr->selRelief,
-                              tvPtr->selectTile, 1, 0);
-                      } else if (isAlt && tvPtr->altStylePtr
-                    && tvPtr->altStylePtr->border
-                    && tvPtr->altStylePtr->priority>=csPtr->priority ) {
-                         Blt_Fill3DRectangle(tvPtr->tkwin, drawable,
-                            tvPtr->altStylePtr->border,
-                            x, y, columnPtr->width, 
-                            entryPtr->height,
-                            0, TK_RELIEF_FLAT);
-                    } else if (entryPtr->stylePtr && entryPtr->stylePtr->border) {
-                         Blt_Fill3DRectangle(tvPtr->tkwin, drawable,
-                            entryPtr->stylePtr->border,
-                            x, y, columnPtr->width, 
-                            entryPtr->height,
-                            0, TK_RELIEF_FLAT);
-                    }
-		    /* Check if there's a corresponding value in the entry. */
-		    valuePtr = Blt_TreeViewFindValue(entryPtr, columnPtr);
-		    ishid = 0;
-		    if (valuePtr != NULL && valuePtr->stylePtr != NULL &&
-		        valuePtr->stylePtr->hidden) {
-                          valuePtr = NULL;
-                          ishid = 1;
-                    }
-                    if (valuePtr == NULL && columnPtr->fillCmd != NULL
-                        && strlen(Tcl_GetString(columnPtr->fillCmd))) {
-                        Tcl_Interp *interp = tvPtr->interp;
-                        int result, objc;
-                        char *string = Blt_TreeNodeLabel(entryPtr->node);
-                        Tcl_Obj **objv, *objPtr = Tcl_DuplicateObj(columnPtr->fillCmd);
-            
-                        Tcl_ListObjAppendElement(interp, objPtr, Tcl_NewStringObj(string,-1));
-                        Tcl_IncrRefCount(objPtr);
-                        if (Tcl_ListObjGetElements(interp, objPtr, &objc, &objv) == TCL_OK) {
-                            Tcl_Obj *listObjPtr;
-                            
-                            Tcl_Preserve(entryPtr);
-                            result = Tcl_EvalObjv(interp, objc, objv, TCL_EVAL_GLOBAL);
-                            if ((entryPtr->flags & ENTRY_DELETED) ||
-                                (tvPtr->flags & TV_DELETED)) {
-                                Tcl_DecrRefCount(objPtr);
-                                Tcl_Release(entryPtr);
-                                return;
-                            }
-                            string = Tcl_GetStringResult(interp);
-                            if (result != TCL_ERROR) {
-                                listObjPtr = Tcl_DuplicateObj(Tcl_GetObjResult(interp));
-                            } else {
-                                listObjPtr = Tcl_NewStringObj("",-1);
-                            }
-                            Tcl_IncrRefCount(listObjPtr);
-                            if (Blt_TreeSetValueByKey(tvPtr->interp, tvPtr->tree, entryPtr->node, columnPtr->key, listObjPtr) == TCL_OK) {
-                                Blt_TreeViewAddValue(entryPtr, columnPtr);
-                                Blt_TreeViewEventuallyRedraw(tvPtr);
-                            }
-                            Tcl_DecrRefCount(listObjPtr);
-                            Tcl_Release(entryPtr);
-                        }
-                        Tcl_DecrRefCount(objPtr);
-                    }
-                    if (valuePtr == NULL && (tvPtr->flags & TV_FILL_NULL)) {
-                        valuePtr = columnPtr->defValue;
-                        if (valuePtr) {
-                            valuePtr->stylePtr = tvPtr->emptyStylePtr;
-                        }
-                    }
-                    if (valuePtr != NULL) {
-			Blt_TreeViewDrawValue(tvPtr, entryPtr, valuePtr, 
-				drawable, x + columnPtr->pad.side1, y,
-				isAlt, ishid);
-                        if (tvPtr->flags & TV_DELETED) return;
-                        if (tvPtr->ruleWidth) {
-                            DrawEntryRule( tvPtr, entryPtr, columnPtr, drawable, x, y);
-                        }
-		    }
-		}
-	    }
-	    if (columnPtr->relief != TK_RELIEF_FLAT) {
-                 Blt_Draw3DRectangle(tvPtr->tkwin, drawable, border, x,
-                     tvPtr->padY, columnPtr->width,
-                     Tk_Height(tvPtr->tkwin)-(tvPtr->padY*2), 
-		     columnPtr->borderWidth, columnPtr->relief);
-	    }
-
+    }
+    redrawAll = tvPtr->redrawAll;
+    tvPtr->redrawAll = FALSE;
+    width = Tk_Width(tvPtr->tkwin);
+    height = Tk_Height(tvPtr->tkwin);
+    if ((tvPtr->backing == None) || (tvPtr->backWidth != width) ||
+	(tvPtr->backHeight != height)) {
+	if (tvPtr->backing != None) {
+	    Tk_FreePixmap(tvPtr->display, tvPtr->backing);
 	}
+	tvPtr->backing = Tk_GetPixmap(tvPtr->display, 
+	    Tk_WindowId(tvPtr->tkwin), width, height, Tk_Depth(tvPtr->tkwin));
+	tvPtr->backWidth = width;
+	tvPtr->backHeight = height;
+	redrawAll = TRUE;
     }
-    Blt_TreeViewMarkWindows(tvPtr, TV_WINDOW_UNMAP);
-    if (tvPtr->flags & TV_SHOW_COLUMN_TITLES) {
-	Blt_TreeViewDrawHeadings(tvPtr, drawable);
+    geomArr = GetGeometry(tvPtr, &nGeom);
+    if ((nGeom != tvPtr->nGeom) || 
+	(memcmp(geomArr, tvPtr->geomArr, nGeom * sizeof(int)) != 0)) {
+	redrawAll = TRUE;
     }
-    Blt_TreeViewDrawOuterBorders(tvPtr, drawable);
-    if ((tvPtr->flags & TV_RULE_NEEDED) &&
-	(tvPtr->resizeColumnPtr != NULL)) {
-	Blt_TreeViewDrawRule(tvPtr, tvPtr->resizeColumnPtr, drawable);
+    if (tvPtr->geomArr != NULL) {
+	Blt_Free(tvPtr->geomArr);
     }
-    /* Now copy the new view to the window. */
-    XCopyArea(tvPtr->display, drawable, Tk_WindowId(tvPtr->tkwin), 
-	tvPtr->lineGC, 0, 0, Tk_Width(tvPtr->tkwin), 
-	Tk_Height(tvPtr->tkwin), 0, 0);
-    Tk_FreePixmap(tvPtr->display, drawable);
-    tvPtr->flags &= ~TV_VIEWPORT;
+    tvPtr->geomArr = geomArr;
+    tvPtr->nGeom = nGeom;
+
+    if (!redrawAll) {
+	int result;
+
+	result = RedrawDamage(tvPtr);
+	if (result == TCL_ERROR) {
+	    tvPtr->redrawAll = TRUE;
+	    return;
+	}
+	redrawAll = (result != TCL_OK);
+    }
+    if (redrawAll) {
+	drawable = tvPtr->backing;
+	tvPtr->flags |= TV_VIEWPORT;
+	DrawBackground(tvPtr, drawable);
+	if ((tvPtr->flags & TV_RULE_ACTIVE) &&
+	    (tvPtr->resizeColumnPtr != NULL)) {
+	    Blt_TreeViewDrawRule(tvPtr, tvPtr->resizeColumnPtr, drawable);
+	}
+	Blt_TreeViewMarkWindows(tvPtr, TV_WINDOW_CLEAR);
+	if (DrawEntries(tvPtr, drawable, tvPtr->visibleArr, INT_MIN) 
+	    != TCL_OK) {
+	    tvPtr->redrawAll = TRUE;
+	    return;
+	}
+	Blt_TreeViewMarkWindows(tvPtr, TV_WINDOW_UNMAP);
+	if (tvPtr->flags & TV_SHOW_COLUMN_TITLES) {
+	    Blt_TreeViewDrawHeadings(tvPtr, drawable);
+	}
+	Blt_TreeViewDrawOuterBorders(tvPtr, drawable);
+	if ((tvPtr->flags & TV_RULE_NEEDED) &&
+	    (tvPtr->resizeColumnPtr != NULL)) {
+	    Blt_TreeViewDrawRule(tvPtr, tvPtr->resizeColumnPtr, drawable);
+	}
+	/* Now copy the new view to the window. */
+	XCopyArea(tvPtr->display, drawable, Tk_WindowId(tvPtr->tkwin), 
+	    tvPtr->lineGC, 0, 0, width, height, 0, 0);
+	tvPtr->flags &= ~TV_VIEWPORT;
+    }
+    SaveFrame(tvPtr);
 }
 
 /*
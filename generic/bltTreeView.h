@@ -288,6 +288,10 @@ typedef char *UID;
 #define ENTRY_DATA_WINDOW		(1<<13)
 #define ENTRY_WINDOW		(1<<14)
 #define ENTRY_DELETED		(1<<15)
+#define ENTRY_CONFIGURED	(1<<16)	/* Entry has been configured with
+					 * options and can't be released. */
+#define ENTRY_FILLED		(1<<17)	/* The background of the value
+					 * being drawn is already filled. */
 
 #define COLUMN_RULE_PICKED	(1<<1)
 #define COLUMN_DIRTY		(1<<2)
@@ -460,6 +464,11 @@ struct TreeViewColumnStruct {
     int maxWidth;		/* Width of the widest entry in the
 				 * column. */
 
+    int *widthCounts;		/* Number of values of each width
+				 * displayed in the column, indexed by
+				 * width.  The widest is maxWidth. */
+    int nWidthCounts;
+
     int worldX;			/* Starting world x-coordinate of the
 				 * column. */
 
@@ -572,6 +581,10 @@ typedef struct TreeViewValueStruct {
     short iX, iY, iW, iH;  /* Needed by "nearest" to determine if over icon/label*/
     short tX, tY, tW, tH;
     short selected;
+    short int countedWidth;	/* Width of the value in the column's
+				 * widthCounts, if countEpoch is the
+				 * treeview's widthEpoch. */
+    int countEpoch;
 } TreeViewValue;
     
 typedef void (StyleConfigProc) _ANSI_ARGS_((TreeView *tvPtr, 
@@ -682,7 +695,8 @@ struct TreeViewEntryStruct {
 
     int flatIndex;
 
-    Tcl_Obj *dataObjPtr;	/* pre-fetched data for sorting */
+    int sortIndex;		/* Position + 1 of the entry in the last
+				 * sorted flat view, 0 if none. */
 
     XColor *color;		/* Color of label. Overrides default
 				 * text color specification. */
@@ -747,6 +761,76 @@ typedef struct {
     int labelWidth;
 } LevelInfo;
 
+/*
+ * DrawnRow --
+ *
+ *	Records where an entry was drawn in the retained frame, so
+ *	that the next redisplay can tell which rows are still valid.
+ */
+typedef struct {
+    TreeViewEntry *entryPtr;
+    int worldY;
+    int height;
+    int altRow;
+} DrawnRow;
+
+/*
+ * FillGroup --
+ *
+ *	Background rectangles of cells drawn with the same GC.  They
+ *	are filled with one request when the backgrounds of a column
+ *	have been collected.
+ */
+typedef struct {
+    GC gc;
+    XRectangle *rects;
+    int nRects, nAlloc;
+} FillGroup;
+
+/*
+ * FilterTerm --
+ *
+ *	One "column op value" term of the predicate of "filter set".
+ */
+typedef struct {
+    Blt_TreeKey key;		/* Key of the value compared, or NULL to
+				 * compare the label of the node. */
+    int op;			/* Comparison made. */
+    Tcl_Obj *objPtr;		/* Value compared against.  For
+				 * "regexp", a private copy holding the
+				 * compiled pattern. */
+    char *pattern;		/* Glob pattern, for "glob" and
+				 * "contains". */
+    Tcl_RegExp regExp;		/* Compiled pattern, for "regexp". */
+    int isNumber;		/* Indicates the value is a number, so
+				 * numeric values are compared as
+				 * numbers. */
+    double number;
+} FilterTerm;
+
+/*
+ * TreeViewFilter --
+ *
+ *	Compiled predicate of "filter set".  Nodes that match every
+ *	term, and their ancestors, are shown.  The number of matches
+ *	in the subtree of each node is kept, so that setting a value
+ *	only updates the ancestors of its node.
+ */
+typedef struct {
+    FilterTerm *terms;
+    int nTerms;
+    int nocase;			/* Compare strings without case. */
+    Tcl_Obj *predObjPtr;	/* Predicate as given. */
+    Blt_HashTable countTable;	/* Nodes with matches in their subtree.
+				 * The value is twice the number of
+				 * matches, plus 1 if the node itself
+				 * matches. */
+    Blt_TreeTrace *traces;	/* Traces of the keys compared. */
+    int nTraces;
+    int dirty;			/* Indicates the counts must be
+				 * computed anew. */
+} TreeViewFilter;
+
 /*
  * TreeView --
  *
@@ -1025,6 +1109,74 @@ struct TreeViewStruct {
 
     TreeViewEntry **flatArr;	/* Flattened array of entries. */
 
+    int virtualView;		/* If non-zero and the view is flat,
+				 * entries are measured only when they
+				 * scroll into the viewport. */
+
+    int *rowTree;		/* Fenwick tree of the heights of the
+				 * entries in flatArr. Used to map
+				 * between row indices and world
+				 * y-coordinates in a virtual view.
+				 * NULL if it needs to be rebuilt. */
+
+    int rowHeight;		/* Estimated height of entries not yet
+				 * measured. */
+
+    int maxEntries;		/* If non-zero, the number of entries
+				 * above which unused entries inside
+				 * closed subtrees are released. */
+
+    int nRetained;		/* Number of entries left after entries
+				 * were last released. */
+
+    int maxEntryDepth;		/* Depth of the deepest entry created.
+				 * Entries are created on demand, so
+				 * the level information must cover
+				 * entries outside of the layout. */
+
+    Pixmap backing;		/* Retained copy of the last frame
+				 * drawn.  Damaged rows and scrolled
+				 * areas are repaired from it. */
+
+    int backWidth, backHeight;	/* Size of the retained frame. */
+
+    int backXOffset, backYOffset; /* View offsets of the retained
+				 * frame. */
+
+    int redrawAll;		/* Indicates that the whole widget must
+				 * be repainted on the next redisplay,
+				 * not just the damaged rows. */
+
+    DrawnRow *drawnArr;		/* Rows drawn in the retained frame. */
+    int nDrawn;
+
+    int *geomArr;		/* Column and level positions of the
+				 * retained frame. */
+    int nGeom;
+
+    FillGroup *fillGroups;	/* Cell backgrounds waiting to be
+				 * filled, by GC. */
+    int nFillGroups, nFillAlloc;
+
+    int valueFilled;		/* Indicates that the background of the
+				 * value being drawn was already filled
+				 * with those of its column. */
+
+    int widthEpoch;		/* Incremented when the widths of the
+				 * values displayed are counted anew. */
+
+    int recountWidths;		/* Indicates that entries may have
+				 * left the layout (closed, moved), so
+				 * the widths must be counted anew. */
+
+    TreeViewFilter *filterPtr;	/* If non-NULL, only entries matching
+				 * the filter, and their ancestors, are
+				 * shown. */
+
+    Blt_Chain *loaderChainPtr;	/* Inserts in progress from
+				 * "insert -async". */
+    int nextLoaderId;
+
     char *sortField;		/* Field to be sorted. */
 
     int sortType;		/* Type of sorting to be performed. See
@@ -1037,6 +1189,9 @@ struct TreeViewStruct {
 
     int viewIsDecreasing;	/* Current sorting direction */
 
+    int nLastSorted;		/* # of entries in the last sorted flat
+				 * view. */
+
     TreeViewColumn *sortColumnPtr;/* Column to use for sorting criteria. */
 
 #ifdef notdef
@@ -1098,6 +1253,8 @@ extern UID Blt_TreeViewGetUid _ANSI_ARGS_((TreeView *tvPtr,
 extern void Blt_TreeViewFreeUid _ANSI_ARGS_((TreeView *tvPtr, UID uid));
 
 extern void Blt_TreeViewEventuallyRedraw _ANSI_ARGS_((TreeView *tvPtr));
+extern void Blt_TreeViewEventuallyRedrawEntry _ANSI_ARGS_((TreeView *tvPtr,
+	TreeViewEntry *entryPtr));
 extern Tcl_ObjCmdProc Blt_TreeViewWidgetInstCmd;
 extern TreeViewEntry *Blt_TreeViewNearestEntry _ANSI_ARGS_((TreeView *tvPtr,
 	int x, int y, int flags));
@@ -1107,6 +1264,9 @@ extern void Blt_TreeViewSelectCmdProc _ANSI_ARGS_((ClientData clientData));
 extern void Blt_TreeViewInsertText _ANSI_ARGS_((TreeView *tvPtr, 
 	TreeViewEntry *entryPtr, char *string, int extra, int insertPos));
 extern int Blt_TreeViewComputeLayout _ANSI_ARGS_((TreeView *tvPtr));
+extern void Blt_TreeViewMarkEntriesDirty _ANSI_ARGS_((TreeView *tvPtr));
+extern int Blt_TreeViewLocateEntry _ANSI_ARGS_((TreeView *tvPtr,
+	TreeViewEntry *entryPtr));
 extern void Blt_TreeViewPercentSubst _ANSI_ARGS_((TreeView *tvPtr, 
 	TreeViewEntry *entryPtr, TreeViewColumn *columnPtr,
 	char *command, char *value, Tcl_DString *resultPtr));
@@ -1175,6 +1335,14 @@ extern TreeViewEntry *Blt_TreeViewPrevEntry _ANSI_ARGS_((
 extern int Blt_TreeViewGetEntry _ANSI_ARGS_((TreeView *tvPtr, Tcl_Obj *objPtr, 
 	TreeViewEntry **entryPtrPtr));
 extern int Blt_TreeViewEntryIsHidden _ANSI_ARGS_((TreeViewEntry *entryPtr));
+extern int Blt_TreeViewEntryIsFiltered _ANSI_ARGS_((TreeViewEntry *entryPtr));
+extern void Blt_TreeViewFilterNode _ANSI_ARGS_((TreeView *tvPtr, 
+	Blt_TreeNode node));
+extern void Blt_TreeViewFilterDeleteNode _ANSI_ARGS_((TreeView *tvPtr, 
+	Blt_TreeNode node));
+extern void Blt_TreeViewFilterChanged _ANSI_ARGS_((TreeView *tvPtr));
+extern void Blt_TreeViewFreeFilter _ANSI_ARGS_((TreeView *tvPtr));
+extern void Blt_TreeViewCancelInserts _ANSI_ARGS_((TreeView *tvPtr));
 extern int Blt_TreeViewEntryIsMapped _ANSI_ARGS_((TreeViewEntry *entryPtr));
 extern TreeViewEntry *Blt_TreeViewNextSibling _ANSI_ARGS_((
 	TreeViewEntry *entryPtr, unsigned int mask));
@@ -1204,6 +1372,8 @@ extern int Blt_TreeViewGetColumnKey _ANSI_ARGS_((Tcl_Interp *interp,
 
 extern void Blt_TreeViewSortFlatView _ANSI_ARGS_((TreeView *tvPtr));
 extern void Blt_TreeViewSortTreeView _ANSI_ARGS_((TreeView *tvPtr));
+extern void Blt_TreeViewSortOpenedEntry _ANSI_ARGS_((TreeView *tvPtr, 
+	TreeViewEntry *entryPtr));
 
 extern int Blt_TreeViewEntryIsSelected _ANSI_ARGS_((TreeView *tvPtr, 
 	TreeViewEntry *entryPtr, TreeViewColumn *columnPtr));
@@ -1269,6 +1439,14 @@ void Blt_TreeViewRelayout(TreeView *tvPtr);
 extern void Blt_TreeViewFill3DTile _ANSI_ARGS_((TreeView *tvPtr,
     Drawable drawable, Tk_3DBorder border, int x, int y, int width, int height, 
     int borderWidth, int relief, Blt_Tile tile, int scrollTile, int flags));
+extern void Blt_TreeViewBatchFill3DTile _ANSI_ARGS_((TreeView *tvPtr,
+    Drawable drawable, Tk_3DBorder border, int x, int y, int width, int height, 
+    int borderWidth, int relief, Blt_Tile tile, int scrollTile, int flags));
+extern void Blt_TreeViewFlushFills _ANSI_ARGS_((TreeView *tvPtr, 
+	Drawable drawable));
+extern Tk_3DBorder Blt_TreeViewGetValueBorder _ANSI_ARGS_((TreeView *tvPtr,
+	TreeViewEntry *entryPtr, TreeViewValue *valuePtr, 
+	TreeViewStyle *stylePtr, Blt_Tile *tilePtr));
 extern int Blt_TreeViewIsLeaf(TreeViewEntry *entryPtr);
 extern void Blt_TreeViewFreeWindows( TreeView *tvPtr);
 extern void Blt_TreeViewMarkWindows( TreeView *tvPtr, int flag);
@@ -55,6 +55,8 @@ static Tk_LostSelProc LostSelection;
 static int SelectEntryApplyProc( TreeView *tvPtr, TreeViewEntry *entryPtr, TreeViewColumn *columnPtr);
 static int GetEntryFromObj2( TreeView *tvPtr, Tcl_Obj *objPtr, TreeViewEntry **entryPtrPtr);
 static int TagDefine( TreeView *tvPtr, Tcl_Interp *interp, char *tagName);
+static int InsertAsyncOp( TreeView *tvPtr, Tcl_Interp *interp, int objc, Tcl_Obj *CONST *objv);
+static int InsertCancelOp( TreeView *tvPtr, Tcl_Interp *interp, int objc, Tcl_Obj *CONST *objv);
 
 extern Blt_CustomOption bltTreeViewIconsOption;
 extern Blt_CustomOption bltTreeViewUidOption;
@@ -285,7 +287,7 @@ MapAncestors(tvPtr, entryPtr)
     while (entryPtr && entryPtr != tvPtr->rootPtr) {
 	entryPtr = Blt_TreeViewParentEntry(entryPtr);
 	if (entryPtr && entryPtr->flags & (ENTRY_CLOSED | ENTRY_HIDDEN)) {
-	    tvPtr->flags |= TV_LAYOUT;
+	    tvPtr->flags |= (TV_LAYOUT | TV_DIRTY);
 	    entryPtr->flags &= ~(ENTRY_CLOSED | ENTRY_HIDDEN);
 	} 
     }
@@ -1221,16 +1223,12 @@ GetNthNode(parent, position)
     int position;
 {
     Blt_TreeNode node;
-    int count;
 
-    count = 0;
-    for(node = Blt_TreeFirstChild(parent); node != NULL; 
-	node = Blt_TreeNextSibling(node)) {
-	if (count++ == position) {
-	    return node;
-	}
+    node = Blt_TreeNthChild(parent, position);
+    if (node == NULL) {
+	return Blt_TreeLastChild(parent);
     }
-    return Blt_TreeLastChild(parent);
+    return node;
 }
 
 static TreeViewEntry *
@@ -1242,6 +1240,16 @@ GetNthEntry(
     TreeViewEntry *entryPtr;
     int count;
 
+    if (mask == 0) {
+	Blt_TreeNode node;
+
+	/* Every child is counted, so go directly to the nth node. */
+	node = Blt_TreeNthChild(parentPtr->node, position);
+	if (node != NULL) {
+	    return Blt_NodeToEntry(parentPtr->tvPtr, node);
+	}
+	return Blt_TreeViewLastChild(parentPtr, mask);
+    }
     count = 0;
     for(entryPtr = Blt_TreeViewFirstChild(parentPtr, mask); entryPtr != NULL; 
 	entryPtr = Blt_TreeViewNextSibling(entryPtr, mask)) {
@@ -1527,13 +1535,13 @@ FocusOp(tvPtr, interp, objc, objv)
 	    /* Changing focus can only affect the visible entries.  The
 	     * entry layout stays the same. */
 	    if (tvPtr->focusPtr != NULL) {
-		tvPtr->focusPtr->flags |= ENTRY_REDRAW;
+		Blt_TreeViewEventuallyRedrawEntry(tvPtr, tvPtr->focusPtr);
 	    } 
-	    entryPtr->flags |= ENTRY_REDRAW;
+	    Blt_TreeViewEventuallyRedrawEntry(tvPtr, entryPtr);
 	    tvPtr->flags |= TV_SCROLL;
 	    tvPtr->focusPtr = entryPtr;
 	}
-	Blt_TreeViewEventuallyRedraw(tvPtr);
+	Blt_TreeViewEventuallyRedrawEntry(tvPtr, NULL);
     }
     Blt_SetFocusItem(tvPtr->bindTable, tvPtr->focusPtr, ITEM_ENTRY);
     if (tvPtr->focusPtr != NULL) {
@@ -2034,6 +2042,9 @@ BboxOp(tvPtr, interp, objc, objv)
 	if (entryPtr->flags & ENTRY_HIDDEN) {
 	    continue;
 	}
+	if (Blt_TreeViewLocateEntry(tvPtr, entryPtr) != TCL_OK) {
+	    return TCL_ERROR;
+	}
 	yBot = entryPtr->worldY + entryPtr->height;
 	height = VPORTHEIGHT(tvPtr);
 	if ((yBot <= tvPtr->yOffset) &&
@@ -2100,58 +2111,6 @@ BboxOp(tvPtr, interp, objc, objv)
     return TCL_OK;
 }
 
-static void
-DrawButton(tvPtr, entryPtr)
-    TreeView *tvPtr;
-    TreeViewEntry *entryPtr;
-{
-    Drawable drawable;
-    int sx, sy, dx, dy;
-    int width, height;
-    int left, right, top, bottom;
-
-    dx = SCREENX(tvPtr, entryPtr->worldX) + entryPtr->buttonX;
-    dy = SCREENY(tvPtr, entryPtr->worldY) + entryPtr->buttonY;
-    width = tvPtr->button.width;
-    height = tvPtr->button.height;
-
-    top = tvPtr->titleHeight + tvPtr->insetY;
-    bottom = Tk_Height(tvPtr->tkwin) - tvPtr->insetY;
-    left = tvPtr->insetX;
-    right = Tk_Width(tvPtr->tkwin) - tvPtr->insetX;
-
-    if (((dx + width) < left) || (dx > right) ||
-	((dy + height) < top) || (dy > bottom)) {
-	return;			/* Value is clipped. */
-    }
-    drawable = Tk_GetPixmap(tvPtr->display, Tk_WindowId(tvPtr->tkwin), 
-	width, height, Tk_Depth(tvPtr->tkwin));
-    /* Draw the background of the value. */
-    Blt_TreeViewDrawButton(tvPtr, entryPtr, drawable, 0, 0);
-
-    /* Clip the drawable if necessary */
-    sx = sy = 0;
-    if (dx < left) {
-	width -= left - dx;
-	sx += left - dx;
-	dx = left;
-    }
-    if ((dx + width) >= right) {
-	width -= (dx + width) - right;
-    }
-    if (dy < top) {
-	height -= top - dy;
-	sy += top - dy;
-	dy = top;
-    }
-    if ((dy + height) >= bottom) {
-	height -= (dy + height) - bottom;
-    }
-    XCopyArea(tvPtr->display, drawable, Tk_WindowId(tvPtr->tkwin), 
-      tvPtr->lineGC, sx, sy, width,  height, dx, dy);
-    Tk_FreePixmap(tvPtr->display, drawable);
-}
-
 /*
  *----------------------------------------------------------------------
  *
@@ -2189,12 +2148,12 @@ ButtonActivateOp(tvPtr, interp, objc, objv)
     }
     oldPtr = tvPtr->activeButtonPtr;
     tvPtr->activeButtonPtr = newPtr;
-    if (!(tvPtr->flags & TV_REDRAW) && (newPtr != oldPtr)) {
+    if (newPtr != oldPtr) {
 	if ((oldPtr != NULL) && (oldPtr != tvPtr->rootPtr)) {
-	    DrawButton(tvPtr, oldPtr);
+	    Blt_TreeViewEventuallyRedrawEntry(tvPtr, oldPtr);
 	}
 	if ((newPtr != NULL) && (newPtr != tvPtr->rootPtr)) {
-	    DrawButton(tvPtr, newPtr);
+	    Blt_TreeViewEventuallyRedrawEntry(tvPtr, newPtr);
 	}
     }
     return TCL_OK;
@@ -2760,40 +2719,13 @@ EntryActivateOp(tvPtr, interp, objc, objv)
     }
     oldPtr = tvPtr->activePtr;
     tvPtr->activePtr = newPtr;
-    if (!(tvPtr->flags & TV_REDRAW) && (newPtr != oldPtr)) {
-	Drawable drawable;
-	int x, y;
-	
-	drawable = Tk_WindowId(tvPtr->tkwin);
+    if (newPtr != oldPtr) {
+	/* Only the rows of the two entries need to be redrawn. */
 	if (oldPtr != NULL) {
-	    x = SCREENX(tvPtr, oldPtr->worldX);
-	    if (!tvPtr->flatView) {
-	        int hr, level;
-	        level = DEPTH(tvPtr, oldPtr->node);
-		x += ICONWIDTH(level);
-                hr = ((tvPtr->flags & TV_HIDE_ROOT) ? 1 : 0);
-                if (!(tvPtr->lineWidth>0 || tvPtr->button.reqSize>0 || level>hr)) {
-                    x = 2;
-                }
-              }
-	    y = SCREENY(tvPtr, oldPtr->worldY);
-	    oldPtr->flags |= ENTRY_ICON;
-	    Blt_TreeViewDrawIcon(tvPtr, oldPtr, drawable, x, y, 1);
+	    Blt_TreeViewEventuallyRedrawEntry(tvPtr, oldPtr);
 	}
 	if (newPtr != NULL) {
-	    x = SCREENX(tvPtr, newPtr->worldX);
-	    if (!tvPtr->flatView) {
-	        int hr, level;
-	        level = DEPTH(tvPtr, newPtr->node);
-                 x += ICONWIDTH(level);
-                hr = ((tvPtr->flags & TV_HIDE_ROOT) ? 1 : 0);
-                if (!(tvPtr->lineWidth>0 || tvPtr->button.reqSize>0 || level>hr)) {
-                    x = 2;
-                }
-	    }
-	    y = SCREENY(tvPtr, newPtr->worldY);
-	    newPtr->flags |= ENTRY_ICON;
-	    Blt_TreeViewDrawIcon(tvPtr, newPtr, drawable, x, y, 1);
+	    Blt_TreeViewEventuallyRedrawEntry(tvPtr, newPtr);
 	}
     }
     return TCL_OK;
@@ -3238,9 +3170,9 @@ EntrySelectOp(tvPtr, interp, objc, objv)
         /* Changing focus can only affect the visible entries.  The
         * entry layout stays the same. */
         if (tvPtr->focusPtr != NULL) {
-            tvPtr->focusPtr->flags |= ENTRY_REDRAW;
+            Blt_TreeViewEventuallyRedrawEntry(tvPtr, tvPtr->focusPtr);
         } 
-        entryPtr->flags |= ENTRY_REDRAW;
+        Blt_TreeViewEventuallyRedrawEntry(tvPtr, entryPtr);
         tvPtr->flags |= TV_SCROLL;
         tvPtr->focusPtr = entryPtr;
     }
@@ -5052,191 +4984,848 @@ ShowOp(tvPtr, interp, objc, objv)
     return TCL_OK;
 }
 
+/*
+ * Comparisons of the terms of "filter set".
+ */
+enum FilterOps {
+    FILTER_EQ, FILTER_NE, FILTER_LT, FILTER_LE, FILTER_GT, FILTER_GE,
+    FILTER_GLOB, FILTER_CONTAINS, FILTER_REGEXP
+};
+
+static char *filterOpNames[] = {
+    "==", "!=", "<", "<=", ">", ">=", "glob", "contains", "regexp", NULL
+};
+
+#define FILTER_COUNT(v)		((v) >> 1)
+#define FILTER_MATCH(v)		((v) & 1)
+
 /*
  *----------------------------------------------------------------------
  *
- * IndexOp --
+ * MatchTerm --
  *
- *	Converts one of more words representing indices of the entries
- *	in the treeview widget to their respective serial identifiers.
+ *	Compares the value of a node against a term of the filter.
+ *	Missing values compare as the empty string.  If the term's
+ *	value is a number, values that are numbers are compared
+ *	numerically.
  *
  * Results:
- *	A standard Tcl result.  Interp->result will contain the
- *	identifier of each inode found. If an inode could not be found,
- *	then the serial identifier will be the empty string.
+ *	Returns 1 if the node matches the term, 0 otherwise.
  *
  *----------------------------------------------------------------------
  */
-/*ARGSUSED*/
 static int
-IndexOp(tvPtr, interp, objc, objv)
-    TreeView *tvPtr;
-    Tcl_Interp *interp;
-    int objc;			/* Not used. */
-    Tcl_Obj *CONST *objv;
+MatchTerm(
+    TreeView *tvPtr,
+    TreeViewFilter *filterPtr,
+    FilterTerm *termPtr,
+    Blt_TreeNode node)
 {
-    TreeViewEntry *entryPtr;
+    Tcl_Obj *objPtr;
     char *string;
-    TreeViewEntry *fromPtr;
-    int usePath, quiet;
+    double number;
+    int result;
 
-    quiet = FALSE;
-    usePath = FALSE;
-    fromPtr = NULL;
-    string = Tcl_GetString(objv[2]);
-    while (string[0] == '-' && objc>3) {
-        if ((strcmp(string, "-path") == 0)) {
-    	   usePath = TRUE;
-    	   objv++, objc--;
-        } else if ((strcmp(string, "-quiet") == 0)) {
-    	   quiet = TRUE;
-    	   objv++, objc--;
-        } else if ((strcmp(string, "-at") == 0)) {
-    	   if (Blt_TreeViewGetEntry(tvPtr, objv[3], &fromPtr) != TCL_OK) {
-    	      return TCL_ERROR;
-    	   }
-    	   objv += 2, objc -= 2;
-        } else {
-            break;
-        }
-        string = Tcl_GetString(objv[2]);
+    objPtr = NULL;
+    if (termPtr->key == NULL) {
+	string = Blt_TreeNodeLabel(node);
+    } else if ((Blt_TreeGetValueByKey((Tcl_Interp *)NULL, tvPtr->tree, node,
+		termPtr->key, &objPtr) == TCL_OK) && (objPtr != NULL)) {
+	string = Tcl_GetString(objPtr);
+    } else {
+	objPtr = NULL;
+	string = "";
+    }
+    switch (termPtr->op) {
+    case FILTER_GLOB:
+    case FILTER_CONTAINS:
+	return (Tcl_StringCaseMatch(string, termPtr->pattern, 
+		filterPtr->nocase) == 1);
+
+    case FILTER_REGEXP:
+	return (Tcl_RegExpExec((Tcl_Interp *)NULL, termPtr->regExp, string, 
+		string) == 1);
+    }
+    if ((termPtr->isNumber) && 
+	(((objPtr != NULL) && 
+	  (Tcl_GetDoubleFromObj(NULL, objPtr, &number) == TCL_OK)) ||
+	 ((objPtr == NULL) && 
+	  (Tcl_GetDouble(NULL, string, &number) == TCL_OK)))) {
+	result = (number < termPtr->number) ? -1 : 
+	    (number > termPtr->number) ? 1 : 0;
+    } else if (filterPtr->nocase) {
+	result = strcasecmp(string, Tcl_GetString(termPtr->objPtr));
+    } else {
+	result = strcmp(string, Tcl_GetString(termPtr->objPtr));
+    }
+    switch (termPtr->op) {
+    case FILTER_EQ:
+	return (result == 0);
+    case FILTER_NE:
+	return (result != 0);
+    case FILTER_LT:
+	return (result < 0);
+    case FILTER_LE:
+	return (result <= 0);
+    case FILTER_GT:
+	return (result > 0);
+    case FILTER_GE:
+	return (result >= 0);
+    }
+    return FALSE;
+}
+
+static int
+MatchFilter(TreeView *tvPtr, TreeViewFilter *filterPtr, Blt_TreeNode node)
+{
+    FilterTerm *termPtr, *endPtr;
+
+    endPtr = filterPtr->terms + filterPtr->nTerms;
+    for (termPtr = filterPtr->terms; termPtr < endPtr; termPtr++) {
+	if (!MatchTerm(tvPtr, filterPtr, termPtr, node)) {
+	    return FALSE;
+	}
     }
-    if (objc != 3) {
-    	Tcl_AppendResult(interp, "wrong # args: should be \"", 
-    		Tcl_GetString(objv[0]), 
-    		" ?-at tagOrId? ?-path? ?-quiet? index\"", 
-    		(char *)NULL);
-    	return TCL_ERROR;
+    return TRUE;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CountMatches --
+ *
+ *	Matches every node of a subtree against the filter and
+ *	records the nodes that have matches in their subtree.
+ *
+ * Results:
+ *	Returns the number of matching nodes in the subtree.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+CountMatches(TreeView *tvPtr, TreeViewFilter *filterPtr, Blt_TreeNode node)
+{
+    Blt_HashEntry *hPtr;
+    Blt_TreeNode child;
+    int count, isMatch, isNew;
+
+    isMatch = MatchFilter(tvPtr, filterPtr, node);
+    count = isMatch;
+    for (child = Blt_TreeFirstChild(node); child != NULL; 
+	 child = Blt_TreeNextSibling(child)) {
+	count += CountMatches(tvPtr, filterPtr, child);
     }
-    tvPtr->fromPtr = fromPtr;
-    if (usePath) {
-	if (fromPtr == NULL) {
-	    fromPtr = tvPtr->rootPtr;
-	}
-	string = Tcl_GetString(objv[2]);
-	entryPtr = FindPath(tvPtr, fromPtr, string);
-	if (entryPtr != NULL) {
-	    Tcl_SetObjResult(interp, NodeToObj(entryPtr->node));
-	} else if (quiet) {
-             Tcl_ResetResult(interp);
-             return TCL_OK;
-         } else {
-	    return TCL_ERROR;
-	}
-    } else {
-        if (tvPtr->fromPtr == NULL) {
-            tvPtr->fromPtr = tvPtr->focusPtr;
-        }
-        if (tvPtr->fromPtr == NULL) {
-            tvPtr->fromPtr = tvPtr->rootPtr;
-        }
-        if ((GetEntryFromObj2(tvPtr, objv[2], &entryPtr) == TCL_OK)) {
-             if (entryPtr != NULL && entryPtr->node != NULL) {
-                 Tcl_SetObjResult(interp, NodeToObj(entryPtr->node));
-             }
-	} else if (quiet) {
-             Tcl_ResetResult(interp);
-             return TCL_OK;
+    if (count > 0) {
+	hPtr = Blt_CreateHashEntry(&filterPtr->countTable, (char *)node, 
+		&isNew);
+	Blt_SetHashValue(hPtr, (ClientData)(intptr_t)((count << 1) | isMatch));
+    }
+    return count;
+}
+
+static void
+ComputeFilter(TreeView *tvPtr)
+{
+    TreeViewFilter *filterPtr = tvPtr->filterPtr;
+
+    Blt_DeleteHashTable(&filterPtr->countTable);
+    Blt_InitHashTable(&filterPtr->countTable, BLT_ONE_WORD_KEYS);
+    CountMatches(tvPtr, filterPtr, Blt_TreeRootNode(tvPtr->tree));
+    filterPtr->dirty = FALSE;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddMatches --
+ *
+ *	Adds to the number of matches of a node and its ancestors.
+ *	Nodes left without matches are removed from the table.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+AddMatches(TreeViewFilter *filterPtr, Blt_TreeNode node, int delta)
+{
+    Blt_HashEntry *hPtr;
+    int isNew, value;
+
+    for (/*empty*/; node != NULL; node = Blt_TreeNodeParent(node)) {
+	hPtr = Blt_CreateHashEntry(&filterPtr->countTable, (char *)node, 
+		&isNew);
+	value = (isNew) ? 0 : (int)(intptr_t)Blt_GetHashValue(hPtr);
+	value += delta * 2;
+	if (value <= 0) {
+	    Blt_DeleteHashEntry(&filterPtr->countTable, hPtr);
 	} else {
-	    return TCL_ERROR;
+	    Blt_SetHashValue(hPtr, (ClientData)(intptr_t)value);
 	}
     }
-    return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * InsertOp --
+ * Blt_TreeViewFilterChanged --
  *
- *	Add new entries into a hierarchy.  If no node is specified,
- *	new entries will be added to the root of the hierarchy.
+ *	Indicates that the entries shown by the filter may have
+ *	changed.  The view is laid out again.
  *
  *----------------------------------------------------------------------
  */
-static int
-InsertOp(tvPtr, interp, objc, objv)
-    TreeView *tvPtr;
-    Tcl_Interp *interp;
-    int objc;
-    Tcl_Obj *CONST *objv;
+void
+Blt_TreeViewFilterChanged(TreeView *tvPtr)
 {
-    Blt_TreeNode node, parent;
-    int insertPos;
-    int depth, count;
-    char *path;
-    Tcl_Obj *CONST *options;
-    Tcl_Obj *listObjPtr;
-    char **compArr = NULL;
-    register char **p;
-    register int n;
-    TreeViewEntry *rootPtr;
-    char *string, *subPath;
-    int nLen, idx, useid, oLen;
-    int sobjc, tobjc;
-    Tcl_Obj **sobjv;
-    Tcl_Obj **tobjv;
-    TreeViewStyle *stylePtr;
-    TreeViewColumn *columnPtr;
-    TreeViewEntry *entryPtr;
-    Tcl_DString dStr;
-    int optSkips, i, m, start, nOptions/*, inode*/;
+    tvPtr->recountWidths = TRUE;
+    tvPtr->flags |= (TV_LAYOUT | TV_DIRTY | TV_RESORT | TV_SCROLL);
+    Blt_TreeViewEventuallyRedraw(tvPtr);
+}
 
-    useid = -1;
-    /*inode = -1;*/
-    optSkips = 0;
-    sobjc = 0;
-    tobjc = 0;
-    entryPtr = NULL;
-    rootPtr = tvPtr->rootPtr;
-    
-    if (objc == 2) {
-	Tcl_AppendResult(interp, "missing position argument", (char *)NULL);
-	return TCL_ERROR;
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeViewFilterNode --
+ *
+ *	Matches a node against the filter again, after one of its
+ *	values or its label changed, or it was created.  Only the
+ *	counts of its ancestors are updated.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Blt_TreeViewFilterNode(TreeView *tvPtr, Blt_TreeNode node)
+{
+    TreeViewFilter *filterPtr = tvPtr->filterPtr;
+    Blt_HashEntry *hPtr;
+    int isMatch, wasMatch;
+
+    if ((filterPtr == NULL) || (filterPtr->dirty)) {
+	return;
     }
-    if (Blt_GetPositionFromObj(interp, objv[2], &insertPos) != TCL_OK) {
-	return TCL_ERROR;
+    hPtr = Blt_FindHashEntry(&filterPtr->countTable, (char *)node);
+    wasMatch = (hPtr != NULL) && 
+	FILTER_MATCH((int)(intptr_t)Blt_GetHashValue(hPtr));
+    isMatch = MatchFilter(tvPtr, filterPtr, node);
+    if (isMatch == wasMatch) {
+	return;
     }
-    for (i = 4; i < objc; i++) {
-        char *cp = Tcl_GetString(objv[i]);
-        if (cp[0] == '-') break;
+    if (wasMatch) {
+	int value;
+
+	/* 
+	 * Clear the match first, so that the entry is removed if no
+	 * descendant matches either.
+	 */
+	value = (int)(intptr_t)Blt_GetHashValue(hPtr);
+	Blt_SetHashValue(hPtr, (ClientData)(intptr_t)(value & ~1));
     }
-    start = i;
-    nOptions = (objc<4?0:objc - i);
-    options = objv + start;
+    AddMatches(filterPtr, node, (isMatch) ? 1 : -1);
+    if (isMatch) {
+	int value;
 
-    if (nOptions%2) {
-        Tcl_AppendResult(interp, "odd number of options", 0);
-        return TCL_ERROR;
+	hPtr = Blt_FindHashEntry(&filterPtr->countTable, (char *)node);
+	value = (int)(intptr_t)Blt_GetHashValue(hPtr);
+	Blt_SetHashValue(hPtr, (ClientData)(intptr_t)(value | 1));
     }
-    for (count = start; count < objc; count += 2) {
-        string = Tcl_GetString(objv[count]);
-        if (string[0] != '-') {
-            Tcl_AppendResult(interp, "option must start with a dash: ", string, 0);
-            return TCL_ERROR;
-        }
-        if (!strcmp("-tags", string)) {
-            if (Tcl_ListObjGetElements(interp, objv[count+1], &tobjc, &tobjv) != TCL_OK) {
-                return TCL_ERROR;
-            }
-	        
-        } else if (!strcmp("-styles", string)) {
-            if (Tcl_ListObjGetElements(interp, objv[count+1], &sobjc, &sobjv) != TCL_OK) {
-                return TCL_ERROR;
-            }
-            if (sobjc%2) {
-                Tcl_AppendResult(interp, "odd arguments for \"-styles\" flag", 0);
-                return TCL_ERROR;
-            }
-            for (n=0; n<sobjc; n += 2) {
-                if (Blt_TreeViewGetColumn(interp, tvPtr, sobjv[n], &columnPtr) != TCL_OK) {
-                    return TCL_ERROR;
-                }
-                if (columnPtr == &tvPtr->treeColumn) {
-                    Tcl_AppendResult(interp, "tree column invalid in \"-styles\" flag", 0);
-                    return TCL_ERROR;
-                }
-                if (Blt_TreeViewGetStyleMake(interp, tvPtr,
+    Blt_TreeViewFilterChanged(tvPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeViewFilterDeleteNode --
+ *
+ *	Removes the matches of a node's subtree before the node is
+ *	deleted.  The tree notifies a node's deletion before those
+ *	of its descendants.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Blt_TreeViewFilterDeleteNode(TreeView *tvPtr, Blt_TreeNode node)
+{
+    TreeViewFilter *filterPtr = tvPtr->filterPtr;
+    Blt_HashEntry *hPtr;
+    Blt_TreeNode desc;
+    int count;
+
+    if ((filterPtr == NULL) || (filterPtr->dirty)) {
+	return;
+    }
+    hPtr = Blt_FindHashEntry(&filterPtr->countTable, (char *)node);
+    if (hPtr == NULL) {
+	return;			/* No matches below the node. */
+    }
+    count = FILTER_COUNT((int)(intptr_t)Blt_GetHashValue(hPtr));
+    AddMatches(filterPtr, Blt_TreeNodeParent(node), -count);
+    for (desc = node; desc != NULL; desc = Blt_TreeNextNode(node, desc)) {
+	hPtr = Blt_FindHashEntry(&filterPtr->countTable, (char *)desc);
+	if (hPtr != NULL) {
+	    Blt_DeleteHashEntry(&filterPtr->countTable, hPtr);
+	}
+    }
+    Blt_TreeViewFilterChanged(tvPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeViewEntryIsFiltered --
+ *
+ *	Indicates if the entry is hidden by the filter: neither it
+ *	nor any of its descendants match.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TreeViewEntryIsFiltered(TreeViewEntry *entryPtr)
+{
+    TreeView *tvPtr = entryPtr->tvPtr;
+
+    if ((tvPtr->filterPtr == NULL) || (entryPtr == tvPtr->rootPtr)) {
+	return FALSE;
+    }
+    if (tvPtr->filterPtr->dirty) {
+	ComputeFilter(tvPtr);
+    }
+    return (Blt_FindHashEntry(&tvPtr->filterPtr->countTable, 
+		(char *)entryPtr->node) == NULL);
+}
+
+/*ARGSUSED*/
+static int
+FilterTraceProc(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    Blt_TreeNode node,		/* Node that has just been updated. */
+    Blt_TreeKey key,		/* Key of value that's been updated. */
+    unsigned int flags)
+{
+    Blt_TreeViewFilterNode(clientData, node);
+    return TCL_OK;
+}
+
+void
+Blt_TreeViewFreeFilter(TreeView *tvPtr)
+{
+    TreeViewFilter *filterPtr = tvPtr->filterPtr;
+    int i;
+
+    if (filterPtr == NULL) {
+	return;
+    }
+    for (i = 0; i < filterPtr->nTraces; i++) {
+	Blt_TreeDeleteTrace(filterPtr->traces[i]);
+    }
+    for (i = 0; i < filterPtr->nTerms; i++) {
+	Tcl_DecrRefCount(filterPtr->terms[i].objPtr);
+	if (filterPtr->terms[i].pattern != NULL) {
+	    Blt_Free(filterPtr->terms[i].pattern);
+	}
+    }
+    if (filterPtr->traces != NULL) {
+	Blt_Free(filterPtr->traces);
+    }
+    Blt_Free(filterPtr->terms);
+    Tcl_DecrRefCount(filterPtr->predObjPtr);
+    Blt_DeleteHashTable(&filterPtr->countTable);
+    Blt_Free(filterPtr);
+    tvPtr->filterPtr = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompileFilter --
+ *
+ *	Parses the predicate of "filter set": a list of "column op
+ *	value" terms that must all match.  Columns are looked up,
+ *	values converted to numbers and patterns compiled once.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+CompileFilter(
+    Tcl_Interp *interp,
+    TreeView *tvPtr,
+    Tcl_Obj *predObjPtr,
+    int nocase,
+    TreeViewFilter **filterPtrPtr)
+{
+    TreeViewFilter *filterPtr;
+    TreeViewColumn *columnPtr;
+    FilterTerm *termPtr;
+    Tcl_Obj **objv;
+    int objc, i, j, op;
+
+    if (Tcl_ListObjGetElements(interp, predObjPtr, &objc, &objv) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if ((objc == 0) || ((objc % 3) != 0)) {
+	Tcl_AppendResult(interp, "predicate must be a list of ",
+		"\"column op value\" terms", (char *)NULL);
+	return TCL_ERROR;
+    }
+    filterPtr = Blt_Calloc(1, sizeof(TreeViewFilter));
+    assert(filterPtr);
+    filterPtr->terms = Blt_Calloc(objc / 3, sizeof(FilterTerm));
+    assert(filterPtr->terms);
+    filterPtr->traces = Blt_Calloc(objc / 3, sizeof(Blt_TreeTrace));
+    assert(filterPtr->traces);
+    filterPtr->nocase = nocase;
+    filterPtr->predObjPtr = predObjPtr;
+    Tcl_IncrRefCount(predObjPtr);
+    Blt_InitHashTable(&filterPtr->countTable, BLT_ONE_WORD_KEYS);
+    filterPtr->dirty = TRUE;
+
+    for (i = 0; i < objc; i += 3) {
+	if (Blt_TreeViewGetColumn(interp, tvPtr, objv[i], &columnPtr) 
+	    != TCL_OK) {
+	    goto error;
+	}
+	if (Tcl_GetIndexFromObj(interp, objv[i + 1], filterOpNames, 
+		"operator", TCL_EXACT, &op) != TCL_OK) {
+	    goto error;
+	}
+	termPtr = filterPtr->terms + filterPtr->nTerms;
+	termPtr->key = (columnPtr == &tvPtr->treeColumn) 
+	    ? NULL : columnPtr->key;
+	termPtr->op = op;
+	termPtr->objPtr = objv[i + 2];
+	if (op == FILTER_REGEXP) {
+	    /* 
+	     * The compiled pattern lives in the internal rep of the
+	     * object.  Use a private copy so that the caller's value,
+	     * handed back by "filter get", can't free it by being
+	     * used as another type.
+	     */
+	    termPtr->objPtr = Tcl_DuplicateObj(termPtr->objPtr);
+	}
+	Tcl_IncrRefCount(termPtr->objPtr);
+	filterPtr->nTerms++;
+	switch (op) {
+	case FILTER_GLOB:
+	    termPtr->pattern = Blt_Strdup(Tcl_GetString(termPtr->objPtr));
+	    break;
+
+	case FILTER_CONTAINS:
+	    {
+		char *p, *q, *string;
+
+		/* Make a glob pattern matching the value literally. */
+		string = Tcl_GetString(termPtr->objPtr);
+		termPtr->pattern = Blt_Malloc(2 * strlen(string) + 3);
+		assert(termPtr->pattern);
+		q = termPtr->pattern;
+		*q++ = '*';
+		for (p = string; *p != '\0'; p++) {
+		    if (strchr("*?[]\\", *p) != NULL) {
+			*q++ = '\\';
+		    }
+		    *q++ = *p;
+		}
+		*q++ = '*';
+		*q = '\0';
+	    }
+	    break;
+
+	case FILTER_REGEXP:
+	    termPtr->regExp = Tcl_GetRegExpFromObj(interp, termPtr->objPtr, 
+		TCL_REG_ADVANCED | ((nocase) ? TCL_REG_NOCASE : 0));
+	    if (termPtr->regExp == NULL) {
+		goto error;
+	    }
+	    break;
+
+	default:
+	    termPtr->isNumber = (Tcl_GetDoubleFromObj(NULL, termPtr->objPtr, 
+		&termPtr->number) == TCL_OK);
+	    break;
+	}
+	/* Values of the column are traced, labels by tree events. */
+	if (termPtr->key == NULL) {
+	    continue;
+	}
+	for (j = 0; j < filterPtr->nTerms - 1; j++) {
+	    if (filterPtr->terms[j].key == termPtr->key) {
+		break;
+	    }
+	}
+	if (j == filterPtr->nTerms - 1) {
+	    filterPtr->traces[filterPtr->nTraces++] = 
+		Blt_TreeCreateTrace(tvPtr->tree, NULL, termPtr->key, NULL,
+			TREE_TRACE_WRITE | TREE_TRACE_UNSET, FilterTraceProc, 
+			tvPtr);
+	}
+    }
+    *filterPtrPtr = filterPtr;
+    return TCL_OK;
+ error:
+    {
+	TreeViewFilter *oldPtr;
+
+	oldPtr = tvPtr->filterPtr;
+	tvPtr->filterPtr = filterPtr;
+	Blt_TreeViewFreeFilter(tvPtr);
+	tvPtr->filterPtr = oldPtr;
+    }
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FilterClearOp --
+ *
+ *	Removes the filter.  All entries are shown again.
+ *
+ *	.t filter clear
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static int
+FilterClearOp(tvPtr, interp, objc, objv)
+    TreeView *tvPtr;
+    Tcl_Interp *interp;
+    int objc;			/* Not used. */
+    Tcl_Obj *CONST *objv;	/* Not used. */
+{
+    if (tvPtr->filterPtr != NULL) {
+	Blt_TreeViewFreeFilter(tvPtr);
+	Blt_TreeViewFilterChanged(tvPtr);
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FilterGetOp --
+ *
+ *	Returns the predicate of the filter, or the empty string if
+ *	there is none.
+ *
+ *	.t filter get
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static int
+FilterGetOp(tvPtr, interp, objc, objv)
+    TreeView *tvPtr;
+    Tcl_Interp *interp;
+    int objc;			/* Not used. */
+    Tcl_Obj *CONST *objv;	/* Not used. */
+{
+    if (tvPtr->filterPtr != NULL) {
+	Tcl_SetObjResult(interp, tvPtr->filterPtr->predObjPtr);
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FilterSetOp --
+ *
+ *	Shows only the entries matching the predicate, and their
+ *	ancestors.  Selected entries that are hidden are deselected.
+ *	An empty predicate removes the filter.
+ *
+ *	.t filter set ?-nocase? {column op value ?column op value...?}
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+FilterSetOp(tvPtr, interp, objc, objv)
+    TreeView *tvPtr;
+    Tcl_Interp *interp;
+    int objc;
+    Tcl_Obj *CONST *objv;
+{
+    TreeViewFilter *filterPtr;
+    Blt_ChainLink *linkPtr, *nextPtr;
+    TreeViewEntry *entryPtr;
+    int nocase, length;
+
+    nocase = FALSE;
+    if (objc == 5) {
+	if (strcmp(Tcl_GetString(objv[3]), "-nocase") != 0) {
+	    Tcl_AppendResult(interp, "bad switch \"", Tcl_GetString(objv[3]),
+		"\": should be -nocase", (char *)NULL);
+	    return TCL_ERROR;
+	}
+	nocase = TRUE;
+    }
+    if (tvPtr->tree == NULL) {
+	Tcl_AppendResult(interp, "no tree attached", (char *)NULL);
+	return TCL_ERROR;
+    }
+    if (Tcl_ListObjLength(interp, objv[objc - 1], &length) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (length == 0) {
+	return FilterClearOp(tvPtr, interp, objc, objv);
+    }
+    if (CompileFilter(interp, tvPtr, objv[objc - 1], nocase, &filterPtr) 
+	!= TCL_OK) {
+	return TCL_ERROR;
+    }
+    Blt_TreeViewFreeFilter(tvPtr);
+    tvPtr->filterPtr = filterPtr;
+    ComputeFilter(tvPtr);
+
+    for (linkPtr = Blt_ChainFirstLink(tvPtr->selChainPtr); linkPtr != NULL;
+	 linkPtr = nextPtr) {
+	nextPtr = Blt_ChainNextLink(linkPtr);
+	entryPtr = Blt_ChainGetValue(linkPtr);
+	if (Blt_TreeViewEntryIsFiltered(entryPtr)) {
+	    Blt_TreeViewDeselectEntry(tvPtr, entryPtr, NULL);
+	}
+    }
+    entryPtr = tvPtr->focusPtr;
+    if ((entryPtr != NULL) && (Blt_TreeViewEntryIsFiltered(entryPtr))) {
+	while (Blt_TreeViewEntryIsFiltered(entryPtr)) {
+	    entryPtr = Blt_TreeViewParentEntry(entryPtr);
+	}
+	tvPtr->focusPtr = entryPtr;
+	Blt_SetFocusItem(tvPtr->bindTable, tvPtr->focusPtr, ITEM_ENTRY);
+    }
+    if ((tvPtr->selAnchorPtr != NULL) && 
+	(Blt_TreeViewEntryIsFiltered(tvPtr->selAnchorPtr))) {
+	tvPtr->selMarkPtr = tvPtr->selAnchorPtr = NULL;
+    }
+    if ((tvPtr->activePtr != NULL) && 
+	(Blt_TreeViewEntryIsFiltered(tvPtr->activePtr))) {
+	tvPtr->activePtr = NULL;
+    }
+    Blt_TreeViewFilterChanged(tvPtr);
+    return TCL_OK;
+}
+
+static Blt_OpSpec filterOps[] =
+{
+    {"clear", 1, (Blt_Op)FilterClearOp, 3, 3, "",},
+    {"get", 1, (Blt_Op)FilterGetOp, 3, 3, "",},
+    {"set", 1, (Blt_Op)FilterSetOp, 4, 5, "?-nocase? predicate",},
+};
+static int nFilterOps = sizeof(filterOps) / sizeof(Blt_OpSpec);
+
+static int
+FilterOp(tvPtr, interp, objc, objv)
+    TreeView *tvPtr;
+    Tcl_Interp *interp;
+    int objc;
+    Tcl_Obj *CONST *objv;
+{
+    Blt_Op proc;
+    int result;
+
+    proc = Blt_GetOpFromObj(interp, nFilterOps, filterOps, BLT_OP_ARG2, 
+	objc, objv, 0);
+    if (proc == NULL) {
+	return TCL_ERROR;
+    }
+    result = (*proc) (tvPtr, interp, objc, objv);
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IndexOp --
+ *
+ *	Converts one of more words representing indices of the entries
+ *	in the treeview widget to their respective serial identifiers.
+ *
+ * Results:
+ *	A standard Tcl result.  Interp->result will contain the
+ *	identifier of each inode found. If an inode could not be found,
+ *	then the serial identifier will be the empty string.
+ *
+ *----------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static int
+IndexOp(tvPtr, interp, objc, objv)
+    TreeView *tvPtr;
+    Tcl_Interp *interp;
+    int objc;			/* Not used. */
+    Tcl_Obj *CONST *objv;
+{
+    TreeViewEntry *entryPtr;
+    char *string;
+    TreeViewEntry *fromPtr;
+    int usePath, quiet;
+
+    quiet = FALSE;
+    usePath = FALSE;
+    fromPtr = NULL;
+    string = Tcl_GetString(objv[2]);
+    while (string[0] == '-' && objc>3) {
+        if ((strcmp(string, "-path") == 0)) {
+    	   usePath = TRUE;
+    	   objv++, objc--;
+        } else if ((strcmp(string, "-quiet") == 0)) {
+    	   quiet = TRUE;
+    	   objv++, objc--;
+        } else if ((strcmp(string, "-at") == 0)) {
+    	   if (Blt_TreeViewGetEntry(tvPtr, objv[3], &fromPtr) != TCL_OK) {
+    	      return TCL_ERROR;
+    	   }
+    	   objv += 2, objc -= 2;
+        } else {
+            break;
+        }
+        string = Tcl_GetString(objv[2]);
+    }
+    if (objc != 3) {
+    	Tcl_AppendResult(interp, "wrong # args: should be \"", 
+    		Tcl_GetString(objv[0]), 
+    		" ?-at tagOrId? ?-path? ?-quiet? index\"", 
+    		(char *)NULL);
+    	return TCL_ERROR;
+    }
+    tvPtr->fromPtr = fromPtr;
+    if (usePath) {
+	if (fromPtr == NULL) {
+	    fromPtr = tvPtr->rootPtr;
+	}
+	string = Tcl_GetString(objv[2]);
+	entryPtr = FindPath(tvPtr, fromPtr, string);
+	if (entryPtr != NULL) {
+	    Tcl_SetObjResult(interp, NodeToObj(entryPtr->node));
+	} else if (quiet) {
+             Tcl_ResetResult(interp);
+             return TCL_OK;
+         } else {
+	    return TCL_ERROR;
+	}
+    } else {
+        if (tvPtr->fromPtr == NULL) {
+            tvPtr->fromPtr = tvPtr->focusPtr;
+        }
+        if (tvPtr->fromPtr == NULL) {
+            tvPtr->fromPtr = tvPtr->rootPtr;
+        }
+        if ((GetEntryFromObj2(tvPtr, objv[2], &entryPtr) == TCL_OK)) {
+             if (entryPtr != NULL && entryPtr->node != NULL) {
+                 Tcl_SetObjResult(interp, NodeToObj(entryPtr->node));
+             }
+	} else if (quiet) {
+             Tcl_ResetResult(interp);
+             return TCL_OK;
+	} else {
+	    return TCL_ERROR;
+	}
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InsertOp --
+ *
+ *	Add new entries into a hierarchy.  If no node is specified,
+ *	new entries will be added to the root of the hierarchy.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+InsertOp(tvPtr, interp, objc, objv)
+    TreeView *tvPtr;
+    Tcl_Interp *interp;
+    int objc;
+    Tcl_Obj *CONST *objv;
+{
+    Blt_TreeNode node, parent;
+    int insertPos;
+    int depth, count;
+    char *path;
+    Tcl_Obj *CONST *options;
+    Tcl_Obj *listObjPtr;
+    char **compArr = NULL;
+    register char **p;
+    register int n;
+    TreeViewEntry *rootPtr;
+    char *string, *subPath;
+    int nLen, idx, useid, oLen;
+    int sobjc, tobjc;
+    Tcl_Obj **sobjv;
+    Tcl_Obj **tobjv;
+    TreeViewStyle *stylePtr;
+    TreeViewColumn *columnPtr;
+    TreeViewEntry *entryPtr;
+    Tcl_DString dStr;
+    int optSkips, i, m, start, nOptions/*, inode*/;
+
+    useid = -1;
+    /*inode = -1;*/
+    optSkips = 0;
+    sobjc = 0;
+    tobjc = 0;
+    entryPtr = NULL;
+    rootPtr = tvPtr->rootPtr;
+    
+    if (objc == 2) {
+	Tcl_AppendResult(interp, "missing position argument", (char *)NULL);
+	return TCL_ERROR;
+    }
+    string = Tcl_GetString(objv[2]);
+    if (strcmp(string, "-async") == 0) {
+	return InsertAsyncOp(tvPtr, interp, objc, objv);
+    }
+    if (strcmp(string, "-cancel") == 0) {
+	return InsertCancelOp(tvPtr, interp, objc, objv);
+    }
+    if (Blt_GetPositionFromObj(interp, objv[2], &insertPos) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    for (i = 4; i < objc; i++) {
+        char *cp = Tcl_GetString(objv[i]);
+        if (cp[0] == '-') break;
+    }
+    start = i;
+    nOptions = (objc<4?0:objc - i);
+    options = objv + start;
+
+    if (nOptions%2) {
+        Tcl_AppendResult(interp, "odd number of options", 0);
+        return TCL_ERROR;
+    }
+    for (count = start; count < objc; count += 2) {
+        string = Tcl_GetString(objv[count]);
+        if (string[0] != '-') {
+            Tcl_AppendResult(interp, "option must start with a dash: ", string, 0);
+            return TCL_ERROR;
+        }
+        if (!strcmp("-tags", string)) {
+            if (Tcl_ListObjGetElements(interp, objv[count+1], &tobjc, &tobjv) != TCL_OK) {
+                return TCL_ERROR;
+            }
+	        
+        } else if (!strcmp("-styles", string)) {
+            if (Tcl_ListObjGetElements(interp, objv[count+1], &sobjc, &sobjv) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            if (sobjc%2) {
+                Tcl_AppendResult(interp, "odd arguments for \"-styles\" flag", 0);
+                return TCL_ERROR;
+            }
+            for (n=0; n<sobjc; n += 2) {
+                if (Blt_TreeViewGetColumn(interp, tvPtr, sobjv[n], &columnPtr) != TCL_OK) {
+                    return TCL_ERROR;
+                }
+                if (columnPtr == &tvPtr->treeColumn) {
+                    Tcl_AppendResult(interp, "tree column invalid in \"-styles\" flag", 0);
+                    return TCL_ERROR;
+                }
+                if (Blt_TreeViewGetStyleMake(interp, tvPtr,
                     Tcl_GetString(sobjv[n+1]), &stylePtr, columnPtr, NULL,
                     NULL) != TCL_OK) {
                     return TCL_ERROR;
@@ -5512,6 +6101,432 @@ makeent:
     return TCL_ERROR;
 }
 
+/*
+ * TreeViewLoader --
+ *
+ *	Insert in progress from "insert -async".  The labels are
+ *	inserted in batches, each taking at most a slice of time, from
+ *	the event loop.
+ */
+typedef struct {
+    TreeView *tvPtr;
+    int id;			/* Name of the insert is "async<id>". */
+    Tcl_Obj *labelsObjPtr;	/* List of the labels to be inserted. */
+    int nLabels;		/* # of labels in the list. */
+    int nInserted;		/* # of labels inserted so far. */
+    Tcl_Obj **argv;		/* Arguments of InsertOp for a batch: the
+				 * widget, "insert", the position, the
+				 * labels of the batch and the options. */
+    int nOptions;
+    int slice;			/* Time in milliseconds spent by each
+				 * batch. */
+    Tcl_Obj *cmdObjPtr;		/* If non-NULL, command invoked after
+				 * each batch. */
+    Tcl_TimerToken timerToken;
+    Blt_ChainLink *linkPtr;	/* Link in tvPtr->loaderChainPtr. */
+} TreeViewLoader;
+
+#define LOADER_BATCH	64	/* Labels inserted between checks of the
+				 * time spent. */
+
+static void LoaderTimerProc _ANSI_ARGS_((ClientData clientData));
+
+static void
+LoaderIdleProc(ClientData clientData)
+{
+    TreeViewLoader *loaderPtr = clientData;
+
+    /* 
+     * Wait for a timer so that pending window events, and the redraw
+     * of the previous batch, are handled first.
+     */
+    loaderPtr->timerToken = Tcl_CreateTimerHandler(0, LoaderTimerProc, 
+	loaderPtr);
+}
+
+static void
+DestroyLoader(DestroyData data)
+{
+    TreeViewLoader *loaderPtr = (TreeViewLoader *)data;
+    int i;
+
+    for (i = 0; i < loaderPtr->nOptions; i++) {
+	Tcl_DecrRefCount(loaderPtr->argv[3 + LOADER_BATCH + i]);
+    }
+    for (i = 0; i < 3; i++) {
+	Tcl_DecrRefCount(loaderPtr->argv[i]);
+    }
+    if (loaderPtr->cmdObjPtr != NULL) {
+	Tcl_DecrRefCount(loaderPtr->cmdObjPtr);
+    }
+    Tcl_DecrRefCount(loaderPtr->labelsObjPtr);
+    Blt_Free(loaderPtr->argv);
+    Blt_Free(loaderPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CancelLoader --
+ *
+ *	Stops an asynchronous insert.  It may be cancelled from a
+ *	script invoked while it is inserting, so it is freed once no
+ *	longer in use.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+CancelLoader(TreeViewLoader *loaderPtr)
+{
+    if (loaderPtr->linkPtr == NULL) {
+	return;			/* Already cancelled. */
+    }
+    Tcl_CancelIdleCall(LoaderIdleProc, loaderPtr);
+    if (loaderPtr->timerToken != NULL) {
+	Tcl_DeleteTimerHandler(loaderPtr->timerToken);
+	loaderPtr->timerToken = NULL;
+    }
+    Blt_ChainDeleteLink(loaderPtr->tvPtr->loaderChainPtr, loaderPtr->linkPtr);
+    loaderPtr->linkPtr = NULL;
+    Tcl_EventuallyFree(loaderPtr, DestroyLoader);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InsertBatches --
+ *
+ *	Inserts the next labels of an asynchronous insert, until the
+ *	slice of time is spent.  The labels are handed to InsertOp in
+ *	batches, followed by the options of the insert.  Once all
+ *	labels are inserted, nothing is done.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+InsertBatches(TreeViewLoader *loaderPtr)
+{
+    TreeView *tvPtr = loaderPtr->tvPtr;
+    Tcl_Interp *interp = tvPtr->interp;
+    Tcl_Obj **labels, **argv;
+    Tcl_Time start, now;
+    long elapsed;
+    int nLabels, n, result;
+
+    if (Tcl_ListObjGetElements(interp, loaderPtr->labelsObjPtr, &nLabels, 
+	    &labels) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    Tcl_GetTime(&start);
+    while (loaderPtr->nInserted < nLabels) {
+	argv = loaderPtr->argv + 3;
+	for (n = 0; n < LOADER_BATCH; n++) {
+	    if (loaderPtr->nInserted + n >= nLabels) {
+		break;
+	    }
+	    /* 
+	     * InsertOp takes any label past the first that starts with
+	     * a dash for an option.  Put those first in a batch.
+	     */
+	    if ((n > 0) && 
+		(Tcl_GetString(labels[loaderPtr->nInserted + n])[0] == '-')) {
+		break;
+	    }
+	    argv[n] = labels[loaderPtr->nInserted + n];
+	}
+	if (n == 0) {
+	    break;		/* Without labels, InsertOp would take the
+				 * options for labels. */
+	}
+	/* Move the options after the labels of the batch. */
+	memmove(argv + n, argv + LOADER_BATCH, 
+		loaderPtr->nOptions * sizeof(Tcl_Obj *));
+	result = InsertOp(tvPtr, interp, 3 + n + loaderPtr->nOptions, 
+		loaderPtr->argv);
+	memmove(argv + LOADER_BATCH, argv + n, 
+		loaderPtr->nOptions * sizeof(Tcl_Obj *));
+	if (result != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (loaderPtr->linkPtr == NULL) {
+	    return TCL_OK;	/* Cancelled, or the widget destroyed. */
+	}
+	loaderPtr->nInserted += n;
+	Tcl_GetTime(&now);
+	elapsed = (now.sec - start.sec) * 1000 + 
+	    (now.usec - start.usec) / 1000;
+	if (elapsed >= loaderPtr->slice) {
+	    break;
+	}
+	/* Scripts run by the insert may change the list's type. */
+	if (Tcl_ListObjGetElements(interp, loaderPtr->labelsObjPtr, &nLabels, 
+		&labels) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+    Tcl_ResetResult(interp);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LoaderTimerProc --
+ *
+ *	Inserts the next batches of an asynchronous insert.  The
+ *	command of the insert is invoked with the number of labels
+ *	inserted and the total.  Once all labels are inserted, or an
+ *	error occurs, the insert is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+LoaderTimerProc(ClientData clientData)
+{
+    TreeViewLoader *loaderPtr = clientData;
+    TreeView *tvPtr = loaderPtr->tvPtr;
+    Tcl_Interp *interp = tvPtr->interp;
+    int result;
+
+    loaderPtr->timerToken = NULL;
+    Tcl_Preserve(tvPtr);
+    Tcl_Preserve(loaderPtr);
+    result = InsertBatches(loaderPtr);
+    if ((result == TCL_OK) && (loaderPtr->linkPtr != NULL) && 
+	(loaderPtr->cmdObjPtr != NULL)) {
+	Tcl_Obj *cmdObjPtr;
+
+	cmdObjPtr = Tcl_DuplicateObj(loaderPtr->cmdObjPtr);
+	Tcl_ListObjAppendElement(interp, cmdObjPtr, 
+		Tcl_NewIntObj(loaderPtr->nInserted));
+	Tcl_ListObjAppendElement(interp, cmdObjPtr, 
+		Tcl_NewIntObj(loaderPtr->nLabels));
+	Tcl_IncrRefCount(cmdObjPtr);
+	result = Tcl_EvalObjEx(interp, cmdObjPtr, TCL_EVAL_GLOBAL);
+	Tcl_DecrRefCount(cmdObjPtr);
+    }
+    if (result != TCL_OK) {
+	Tcl_AddErrorInfo(interp, "\n    (asynchronous insert)");
+	Tcl_BackgroundError(interp);
+	CancelLoader(loaderPtr);
+    } else if (loaderPtr->linkPtr == NULL) {
+	/* Cancelled. */
+    } else if (loaderPtr->nInserted < loaderPtr->nLabels) {
+	Tcl_DoWhenIdle(LoaderIdleProc, loaderPtr);
+    } else {
+	CancelLoader(loaderPtr);
+    }
+    Tcl_Release(loaderPtr);
+    Tcl_Release(tvPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeViewCancelInserts --
+ *
+ *	Stops all asynchronous inserts of the widget.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Blt_TreeViewCancelInserts(TreeView *tvPtr)
+{
+    Blt_ChainLink *linkPtr;
+
+    if (tvPtr->loaderChainPtr == NULL) {
+	return;
+    }
+    while ((linkPtr = Blt_ChainFirstLink(tvPtr->loaderChainPtr)) != NULL) {
+	CancelLoader(Blt_ChainGetValue(linkPtr));
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InsertAsyncOp --
+ *
+ *	Inserts a list of labels in batches from the event loop, so
+ *	that the widget stays responsive while a large number of
+ *	entries is added.  The first batch is inserted right away.
+ *	Returns the name of the insert, which can be given to
+ *	"insert -cancel".
+ *
+ *	.t insert -async ?-command cmd? ?-slice ms? position labels \
+ *		?option value...?
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+InsertAsyncOp(tvPtr, interp, objc, objv)
+    TreeView *tvPtr;
+    Tcl_Interp *interp;
+    int objc;
+    Tcl_Obj *CONST *objv;
+{
+    TreeViewLoader *loaderPtr;
+    Tcl_Obj *cmdObjPtr;
+    char *string;
+    char name[200];
+    int i, j, slice, nLabels, insertPos;
+
+    cmdObjPtr = NULL;
+    slice = 20;
+    for (i = 3; i < objc; i += 2) {
+	string = Tcl_GetString(objv[i]);
+	if (string[0] != '-') {
+	    break;
+	}
+	if (i + 1 >= objc) {
+	    Tcl_AppendResult(interp, "missing value for \"", string, "\"", 
+		(char *)NULL);
+	    return TCL_ERROR;
+	}
+	if (strcmp(string, "-command") == 0) {
+	    cmdObjPtr = objv[i + 1];
+	} else if (strcmp(string, "-slice") == 0) {
+	    if (Tcl_GetIntFromObj(interp, objv[i + 1], &slice) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if (slice < 1) {
+		slice = 1;
+	    }
+	} else {
+	    Tcl_AppendResult(interp, "bad switch \"", string, 
+		"\": should be -command or -slice", (char *)NULL);
+	    return TCL_ERROR;
+	}
+    }
+    if ((objc - i) < 2) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", 
+		Tcl_GetString(objv[0]), " insert -async ?-command cmd? ",
+		"?-slice ms? position labels ?option value...?\"", 
+		(char *)NULL);
+	return TCL_ERROR;
+    }
+    if (Blt_GetPositionFromObj(interp, objv[i], &insertPos) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (Tcl_ListObjLength(interp, objv[i + 1], &nLabels) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if ((objc - i - 2) % 2) {
+	Tcl_AppendResult(interp, "odd number of options", (char *)NULL);
+	return TCL_ERROR;
+    }
+    for (j = i + 2; j < objc; j += 2) {
+	if (strcmp(Tcl_GetString(objv[j]), "-node") == 0) {
+	    Tcl_AppendResult(interp, "can't use \"-node\" with \"-async\"", 
+		(char *)NULL);
+	    return TCL_ERROR;
+	}
+    }
+    loaderPtr = Blt_Calloc(1, sizeof(TreeViewLoader));
+    assert(loaderPtr);
+    loaderPtr->tvPtr = tvPtr;
+    loaderPtr->id = tvPtr->nextLoaderId++;
+    loaderPtr->slice = slice;
+    loaderPtr->nLabels = nLabels;
+    loaderPtr->labelsObjPtr = objv[i + 1];
+    Tcl_IncrRefCount(loaderPtr->labelsObjPtr);
+    if (cmdObjPtr != NULL) {
+	loaderPtr->cmdObjPtr = cmdObjPtr;
+	Tcl_IncrRefCount(cmdObjPtr);
+    }
+    loaderPtr->nOptions = objc - i - 2;
+    loaderPtr->argv = Blt_Malloc((3 + LOADER_BATCH + loaderPtr->nOptions) * 
+	sizeof(Tcl_Obj *));
+    assert(loaderPtr->argv);
+    loaderPtr->argv[0] = objv[0];
+    loaderPtr->argv[1] = objv[1];
+    loaderPtr->argv[2] = objv[i];
+    for (j = 0; j < 3; j++) {
+	Tcl_IncrRefCount(loaderPtr->argv[j]);
+    }
+    for (j = 0; j < loaderPtr->nOptions; j++) {
+	loaderPtr->argv[3 + LOADER_BATCH + j] = objv[i + 2 + j];
+	Tcl_IncrRefCount(objv[i + 2 + j]);
+    }
+    if (tvPtr->loaderChainPtr == NULL) {
+	tvPtr->loaderChainPtr = Blt_ChainCreate();
+    }
+    loaderPtr->linkPtr = Blt_ChainAppend(tvPtr->loaderChainPtr, loaderPtr);
+    sprintf(name, "async%d", loaderPtr->id);
+    if (nLabels > 0) {
+	int result;
+
+	/* Insert the first batch now, reporting bad options. */
+	Tcl_Preserve(loaderPtr);
+	result = InsertBatches(loaderPtr);
+	if (result != TCL_OK) {
+	    CancelLoader(loaderPtr);
+	}
+	if (loaderPtr->linkPtr == NULL) {
+	    Tcl_Release(loaderPtr);
+	    return result;
+	}
+	Tcl_Release(loaderPtr);
+    }
+    /* The command is invoked at least once, even if there is no label. */
+    Tcl_DoWhenIdle(LoaderIdleProc, loaderPtr);
+    Tcl_SetResult(interp, name, TCL_VOLATILE);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InsertCancelOp --
+ *
+ *	Stops asynchronous inserts.  The entries already inserted are
+ *	kept.  Without a name, all asynchronous inserts are stopped.
+ *
+ *	.t insert -cancel ?name?
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+InsertCancelOp(tvPtr, interp, objc, objv)
+    TreeView *tvPtr;
+    Tcl_Interp *interp;
+    int objc;
+    Tcl_Obj *CONST *objv;
+{
+    Blt_ChainLink *linkPtr;
+    TreeViewLoader *loaderPtr;
+    char *string;
+    int id;
+
+    if (objc == 3) {
+	Blt_TreeViewCancelInserts(tvPtr);
+	return TCL_OK;
+    }
+    if (objc != 4) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", 
+		Tcl_GetString(objv[0]), " insert -cancel ?name?\"", 
+		(char *)NULL);
+	return TCL_ERROR;
+    }
+    string = Tcl_GetString(objv[3]);
+    if ((strncmp(string, "async", 5) == 0) && 
+	(Tcl_GetInt(NULL, string + 5, &id) == TCL_OK) &&
+	(tvPtr->loaderChainPtr != NULL)) {
+	for (linkPtr = Blt_ChainFirstLink(tvPtr->loaderChainPtr); 
+	     linkPtr != NULL; linkPtr = Blt_ChainNextLink(linkPtr)) {
+	    loaderPtr = Blt_ChainGetValue(linkPtr);
+	    if (loaderPtr->id == id) {
+		CancelLoader(loaderPtr);
+		return TCL_OK;
+	    }
+	}
+    }
+    return TCL_OK;		/* Already done. */
+}
+
 #ifdef notdef
 /*
  *----------------------------------------------------------------------
@@ -6257,7 +7272,7 @@ ScanOp(tvPtr, interp, objc, objv)
 	tvPtr->xOffset = worldX;
 	tvPtr->yOffset = worldY;
 	tvPtr->flags |= TV_SCROLL;
-	Blt_TreeViewEventuallyRedraw(tvPtr);
+	Blt_TreeViewEventuallyRedrawEntry(tvPtr, NULL);
     }
     return TCL_OK;
 }
@@ -6312,6 +7327,9 @@ SeeOp(tvPtr, interp, objc, objv)
 	 */
 	Blt_TreeViewComputeLayout(tvPtr);
     }
+    if (Blt_TreeViewLocateEntry(tvPtr, entryPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
     width = VPORTWIDTH(tvPtr);
     height = VPORTHEIGHT(tvPtr);
 
@@ -6382,7 +7400,7 @@ SeeOp(tvPtr, interp, objc, objv)
 	tvPtr->yOffset = y;
 	tvPtr->flags |= TV_SCROLL;
     }
-    Blt_TreeViewEventuallyRedraw(tvPtr);
+    Blt_TreeViewEventuallyRedrawEntry(tvPtr, NULL);
     return TCL_OK;
 }
 
@@ -6390,13 +7408,14 @@ void
 Blt_TreeViewClearSelection(tvPtr)
     TreeView *tvPtr;
 {
+    Blt_ChainLink *linkPtr;
+
     if (tvPtr->selectMode & SELECT_MODE_CELLMASK) {
         Blt_HashEntry *hPtr;
         Blt_HashSearch cursor;
         TreeViewValue *valuePtr;
         TreeViewEntry *entryPtr;
         TreeViewColumn *columnPtr;
-        Blt_ChainLink *linkPtr;
 
         for (hPtr = Blt_FirstHashEntry(&tvPtr->selectTable, &cursor);
             hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
@@ -6411,10 +7430,14 @@ Blt_TreeViewClearSelection(tvPtr)
             }
         }
     }
+    /* Only the rows of the selected entries need to be redrawn. */
+    for (linkPtr = Blt_ChainFirstLink(tvPtr->selChainPtr); linkPtr != NULL;
+	 linkPtr = Blt_ChainNextLink(linkPtr)) {
+	Blt_TreeViewEventuallyRedrawEntry(tvPtr, Blt_ChainGetValue(linkPtr));
+    }
     Blt_DeleteHashTable(&tvPtr->selectTable);
     Blt_InitHashTable(&tvPtr->selectTable, BLT_ONE_WORD_KEYS);
     Blt_ChainReset(tvPtr->selChainPtr);
-    Blt_TreeViewEventuallyRedraw(tvPtr);
     if (tvPtr->selectCmd != NULL) {
 	EventuallyInvokeSelectCmd(tvPtr);
     }
@@ -6558,7 +7581,7 @@ SelectionAnchorOp(tvPtr, interp, objc, objv)
     if (entryPtr != NULL) {
 	Tcl_SetObjResult(interp, NodeToObj(entryPtr->node));
     }
-    Blt_TreeViewEventuallyRedraw(tvPtr);
+    Blt_TreeViewEventuallyRedrawEntry(tvPtr, NULL);
     return TCL_OK;
 }
 
@@ -6754,7 +7777,7 @@ SelectionMarkOp(tvPtr, interp, objc, objv)
 	Tcl_SetObjResult(interp, NodeToObj(entryPtr->node));
 	tvPtr->selMarkPtr = entryPtr;
 
-	Blt_TreeViewEventuallyRedraw(tvPtr);
+	Blt_TreeViewEventuallyRedrawEntry(tvPtr, NULL);
 	if (tvPtr->selectCmd != NULL) {
 	    EventuallyInvokeSelectCmd(tvPtr);
 	}
@@ -6872,7 +7895,7 @@ SelectionSetOp(tvPtr, interp, objc, objv)
     if (tvPtr->flags & TV_SELECT_EXPORT) {
 	Tk_OwnSelection(tvPtr->tkwin, XA_PRIMARY, LostSelection, tvPtr);
     }
-    Blt_TreeViewEventuallyRedraw(tvPtr);
+    Blt_TreeViewEventuallyRedrawEntry(tvPtr, NULL);
     if (tvPtr->selectCmd != NULL) {
 	EventuallyInvokeSelectCmd(tvPtr);
     }
@@ -7222,7 +8245,7 @@ TagDeleteOp(tvPtr, interp, objc, objv)
                          }
                          continue;
                      }
-                     Blt_DeleteHashEntry(tablePtr, hPtr);
+                     Blt_TreeRemoveTag(tvPtr->tree, entryPtr->node, tagName);
 	        }
 	   }
            Blt_TreeViewDoneTaggedEntries(&info);
@@ -7350,7 +8373,7 @@ XViewOp(tvPtr, interp, objc, objv)
 	return TCL_ERROR;
     }
     tvPtr->flags |= TV_XSCROLL;
-    Blt_TreeViewEventuallyRedraw(tvPtr);
+    Blt_TreeViewEventuallyRedrawEntry(tvPtr, NULL);
     return TCL_OK;
 }
 
@@ -7387,7 +8410,7 @@ YViewOp(tvPtr, interp, objc, objv)
 	return TCL_ERROR;
     }
     tvPtr->flags |= TV_SCROLL;
-    Blt_TreeViewEventuallyRedraw(tvPtr);
+    Blt_TreeViewEventuallyRedrawEntry(tvPtr, NULL);
     return TCL_OK;
 }
 
@@ -7420,6 +8443,7 @@ static Blt_OpSpec treeViewOps[] =
     {"delete", 1, (Blt_Op)DeleteOp, 2, 0, "tagOrId ?tagOrId...?",}, 
     {"edit", 2, (Blt_Op)EditOp, 3, 0, "?-root|-test|-noscroll|-scroll? ?x y?",},
     {"entry", 2, (Blt_Op)EntryOp, 2, 0, "oper args",},
+    {"filter", 3, (Blt_Op)FilterOp, 3, 0, "oper args",},
     {"find", 3, (Blt_Op)FindOp, 2, 0, "?switches? ?first last?",}, 
     {"focus", 2, (Blt_Op)FocusOp, 2, 3, "?tagOrId?",}, 
     {"get", 1, (Blt_Op)GetOp, 2, 0, "?-full? ?-labels? tagOrId ?tagOrId...?",}, 
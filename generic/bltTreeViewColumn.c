@@ -313,7 +313,6 @@ static Blt_ConfigSpec sortSpecs[] =
 	(char *)NULL, 0, 0}
 };
 
-static Blt_TreeCompareNodesProc CompareNodes;
 static Blt_TreeApplyProc SortApplyProc;
 
 /*
@@ -1096,6 +1095,10 @@ DestroyColumnNow(DestroyData data)
         Blt_TreeDeleteTrace(columnPtr->trace);
         columnPtr->trace = NULL;
     }
+    if (columnPtr->widthCounts != NULL) {
+        Blt_Free(columnPtr->widthCounts);
+        columnPtr->widthCounts = NULL;
+    }
     Blt_Free(columnPtr->name);
     if (columnPtr != &tvPtr->treeColumn) {
         Blt_Free(columnPtr);
@@ -1617,6 +1620,8 @@ ColumnDeleteOp(tvPtr, interp, objc, objv)
 {
     TreeViewColumn *columnPtr;
     TreeViewEntry *entryPtr;
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
     register int i;
 
     for(i = 3; i < objc; i++) {
@@ -1631,9 +1636,13 @@ ColumnDeleteOp(tvPtr, interp, objc, objv)
 	if (columnPtr == tvPtr->sortColumnPtr) {
 	    tvPtr->sortColumnPtr = NULL;
 	}
-	/* Traverse the tree deleting values associated with the column.  */
-	for(entryPtr = tvPtr->rootPtr; entryPtr != NULL;
-	    entryPtr = Blt_TreeViewNextEntry(entryPtr, 0)) {
+	/* 
+	 * Delete the values associated with the column from the
+	 * entries created so far.
+	 */
+	for (hPtr = Blt_FirstHashEntry(&tvPtr->entryTable, &cursor); 
+	     hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	    entryPtr = Blt_GetHashValue(hPtr);
 	    if (entryPtr != NULL) {
 		TreeViewValue *valuePtr, *lastPtr, *nextPtr;
 		
@@ -1852,6 +1861,8 @@ ColumnInsertOp(tvPtr, interp, objc, objv)
     Tcl_Obj *CONST *options;
     TreeViewColumn *columnPtr;
     TreeViewEntry *entryPtr;
+    Blt_HashEntry *hPtr;
+    Blt_HashSearch cursor;
     int insertPos;
     int nOptions;
     int start;
@@ -1920,10 +1931,12 @@ ColumnInsertOp(tvPtr, interp, objc, objv)
 	}
 	Tcl_AppendResult(interp, i>4?" ":"", columnPtr->key, 0);
 	/* 
-	 * Traverse the tree adding column entries where needed.
+	 * Add column values to the entries created so far.  Entries
+	 * created later get them when they're configured.
 	 */
-	for(entryPtr = tvPtr->rootPtr; entryPtr != NULL;
-	    entryPtr = Blt_TreeViewNextEntry(entryPtr, 0)) {
+	for (hPtr = Blt_FirstHashEntry(&tvPtr->entryTable, &cursor); 
+	     hPtr != NULL; hPtr = Blt_NextHashEntry(&cursor)) {
+	    entryPtr = Blt_GetHashValue(hPtr);
 	    Blt_TreeViewAddValue(entryPtr, columnPtr);
 	}
 	Blt_TreeViewTraceColumn(tvPtr, columnPtr);
@@ -2812,6 +2825,68 @@ Blt_TreeViewColumnOp(tvPtr, interp, objc, objv)
 }
 
 
+/*
+ * The sort key of each entry is extracted once, before sorting,
+ * rather than on every comparison.  A key holds the value of the
+ * sort column, followed by the values of its alternate columns
+ * (-sortaltcolumns).  Integer and real values are converted up
+ * front too.
+ */
+typedef struct {
+    TreeViewColumn *columnPtr;
+    int type;			/* Type of sort for the column. */
+    char *command;		/* Compare command, if SORT_TYPE_COMMAND. */
+} SortField;
+
+typedef struct {
+    char *string;		/* Value compared. */
+    Tcl_Obj *objPtr;		/* If non-NULL, holds the string. */
+    int isNumber;		/* Indicates if the string converted
+				 * to an integer or real. */
+    union {
+	int i;
+	double d;
+    } number;
+} SortValue;
+
+typedef struct {
+    TreeViewEntry *entryPtr;
+    SortValue *values;		/* One value per field. */
+} SortKey;
+
+/*
+ * Everything needed to compare keys is passed along in a SortInfo,
+ * so sorting doesn't depend on any global state.  The arrays are
+ * reused for each node of a tree view.
+ */
+typedef struct {
+    TreeView *tvPtr;
+    SortField *fields;		/* Sort column and alternate columns. */
+    int nFields;
+    int isFmt;			/* Compare the formatted text of the
+				 * sort column in a flat view. */
+    SortKey *keyArr;		/* Keys being sorted. */
+    SortValue *valueArr;	/* Values of all keys. */
+    Blt_TreeNode *nodeArr;	/* Children in their sorted order. */
+    int nAlloc;			/* # of keys allocated. */
+} SortInfo;
+
+#define SORT_RUN	8	/* Minimum length of runs merged. */
+
+static char *
+GetFullName(TreeView *tvPtr, TreeViewEntry *entryPtr)
+{
+    if (entryPtr->fullName == NULL) {
+	Tcl_DString dString;
+
+	Tcl_DStringInit(&dString);
+	Blt_TreeViewGetFullName(tvPtr, entryPtr, TRUE, &dString);
+	entryPtr->fullName = Blt_Strdup(Tcl_DStringValue(&dString));
+	Tcl_DStringFree(&dString);
+    }
+    return entryPtr->fullName;
+}
+
 static int
 InvokeCompare(tvPtr, e1Ptr, e2Ptr, command)
     TreeView *tvPtr;
@@ -2829,8 +2904,8 @@ InvokeCompare(tvPtr, e1Ptr, e2Ptr, command)
     objv[4] = Tcl_NewStringObj(tvPtr->sortColumnPtr->key, -1);
 	     
     if (tvPtr->flatView) {
-	objv[5] = Tcl_NewStringObj(e1Ptr->fullName, -1);
-	objv[6] = Tcl_NewStringObj(e2Ptr->fullName, -1);
+	objv[5] = Tcl_NewStringObj(GetFullName(tvPtr, e1Ptr), -1);
+	objv[6] = Tcl_NewStringObj(GetFullName(tvPtr, e2Ptr), -1);
     } else {
 	objv[5] = Tcl_NewStringObj(GETLABEL(e1Ptr), -1);
 	objv[6] = Tcl_NewStringObj(GETLABEL(e2Ptr), -1);
@@ -2852,200 +2927,424 @@ InvokeCompare(tvPtr, e1Ptr, e2Ptr, command)
     return result;
 }
 
-static TreeView *treeViewInstance;
-
-static int
-CompareEntry( CONST void *a, CONST void *b, Tcl_Obj *colName)
+/*
+ *----------------------------------------------------------------------
+ *
+ * InitSortInfo --
+ *
+ *	Collects the columns to be compared: the sort column and its
+ *	alternate columns.  The list of alternate columns is parsed
+ *	here once, not on each comparison.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+InitSortInfo(TreeView *tvPtr, SortInfo *infoPtr)
 {
-    TreeView *tvPtr;
     TreeViewColumn *columnPtr;
-    TreeViewEntry *e1Ptr, **e1PtrPtr = (TreeViewEntry **)a;
-    TreeViewEntry *e2Ptr, **e2PtrPtr = (TreeViewEntry **)b;
-    Tcl_Obj *obj1, *obj2;
-    char *s1, *s2;
-    int result, sType;
+    SortField *fieldPtr;
+    Tcl_Obj **objv;
+    int objc, i;
 
-    tvPtr = (*e1PtrPtr)->tvPtr;
+    memset(infoPtr, 0, sizeof(SortInfo));
+    infoPtr->tvPtr = tvPtr;
     columnPtr = tvPtr->sortColumnPtr;
-    sType = tvPtr->sortType;
-    
-    obj1 = (*e1PtrPtr)->dataObjPtr;
-    obj2 = (*e2PtrPtr)->dataObjPtr;
-    if (colName != NULL) {
-        if (Blt_TreeViewGetColumn(NULL, tvPtr, colName, &columnPtr)
-            != TCL_OK) {
-            return 1;
-        }
-        e1Ptr = *e1PtrPtr;
-        e2Ptr = *e2PtrPtr;
-        if (Blt_TreeGetValueByKey(tvPtr->interp, tvPtr->tree,
-            e1Ptr->node, columnPtr->key, &obj1) != TCL_OK) {
-            return 1;
-        }
-        if (Blt_TreeGetValueByKey(tvPtr->interp, tvPtr->tree,
-            e2Ptr->node, columnPtr->key, &obj2) != TCL_OK) {
-                return 1;
-        }
-        sType = columnPtr->sortType;
+    objc = 0;
+    if ((columnPtr->sortAltColumns != NULL) &&
+	(Tcl_ListObjGetElements(NULL, columnPtr->sortAltColumns, &objc, 
+		&objv) != TCL_OK)) {
+	objc = 0;
+    }
+    infoPtr->fields = Blt_Malloc((objc + 1) * sizeof(SortField));
+    assert(infoPtr->fields);
+    fieldPtr = infoPtr->fields;
+    fieldPtr->columnPtr = columnPtr;
+    fieldPtr->type = tvPtr->sortType;
+    fieldPtr->command = CHOOSE(tvPtr->sortCmd, columnPtr->sortCmd);
+    fieldPtr++;
+    for (i = 0; i < objc; i++) {
+	if (Blt_TreeViewGetColumn(NULL, tvPtr, objv[i], &columnPtr) 
+	    != TCL_OK) {
+	    continue;
+	}
+	fieldPtr->columnPtr = columnPtr;
+	fieldPtr->type = columnPtr->sortType;
+	fieldPtr->command = CHOOSE(tvPtr->sortCmd, columnPtr->sortCmd);
+	fieldPtr++;
     }
-    s1 = Tcl_GetString(obj1);
-    s2 = Tcl_GetString(obj2);
-    result = 0;
-    switch (sType) {
-    case SORT_TYPE_ASCII:
-	result = strcmp(s1, s2);
-	break;
+    infoPtr->nFields = fieldPtr - infoPtr->fields;
+    if (tvPtr->flatView) {
+	infoPtr->isFmt = Blt_TreeViewStyleIsFmt(tvPtr, 
+		tvPtr->sortColumnPtr->stylePtr);
+    }
+}
 
-    case SORT_TYPE_COMMAND:
-	{
-	    char *cmd;
+static void
+FreeSortKeys(SortInfo *infoPtr, int nKeys)
+{
+    SortKey *keyPtr;
+    int i;
 
-	    cmd = columnPtr->sortCmd;
-	    if (cmd == NULL) {
-		cmd = tvPtr->sortCmd;
+    for (keyPtr = infoPtr->keyArr; keyPtr < infoPtr->keyArr + nKeys; 
+	 keyPtr++) {
+	for (i = 0; i < infoPtr->nFields; i++) {
+	    if (keyPtr->values[i].objPtr != NULL) {
+		Tcl_DecrRefCount(keyPtr->values[i].objPtr);
 	    }
-	    if (cmd == NULL) {
-		result = Blt_DictionaryCompare(s1, s2);
-	    } else {
-		result = InvokeCompare(tvPtr, *e1PtrPtr, *e2PtrPtr, cmd);
+	}
+    }
+}
+
+static void
+FreeSortInfo(SortInfo *infoPtr)
+{
+    Blt_Free(infoPtr->fields);
+    if (infoPtr->keyArr != NULL) {
+	Blt_Free(infoPtr->keyArr);
+	Blt_Free(infoPtr->valueArr);
+	Blt_Free(infoPtr->nodeArr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InitSortKey --
+ *
+ *	Fetches the values of an entry to be compared.  For the sort
+ *	column of a flat view, that's the full path of the entry or
+ *	the formatted text of the value.  Missing values compare as
+ *	empty strings.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+InitSortKey(SortInfo *infoPtr, SortKey *keyPtr, TreeViewEntry *entryPtr)
+{
+    TreeView *tvPtr = infoPtr->tvPtr;
+    SortField *fieldPtr;
+    SortValue *valuePtr;
+    Tcl_Obj *objPtr;
+    int i;
+
+    keyPtr->entryPtr = entryPtr;
+    valuePtr = keyPtr->values;
+    for (i = 0; i < infoPtr->nFields; i++, valuePtr++) {
+	fieldPtr = infoPtr->fields + i;
+	valuePtr->string = "";
+	valuePtr->isNumber = FALSE;
+	objPtr = NULL;
+	if ((i == 0) && (!tvPtr->flatView) && 
+	    (fieldPtr->type == SORT_TYPE_COMMAND)) {
+	    objPtr = Tcl_NewIntObj(Blt_TreeNodeId(entryPtr->node));
+	} else if ((i == 0) && (fieldPtr->columnPtr == &tvPtr->treeColumn)) {
+	    valuePtr->string = GetFullName(tvPtr, entryPtr);
+	} else if ((i == 0) && (infoPtr->isFmt)) {
+	    TreeViewValue *colValuePtr;
+
+	    colValuePtr = Blt_TreeViewFindValue(entryPtr, fieldPtr->columnPtr);
+	    if ((colValuePtr != NULL) && (colValuePtr->textPtr != NULL)) {
+		Tcl_DString dString;
+
+		Tcl_DStringInit(&dString);
+		Blt_TextLayoutValue(colValuePtr->textPtr, &dString);
+		objPtr = Tcl_NewStringObj(Tcl_DStringValue(&dString), -1);
+		Tcl_DStringFree(&dString);
+	    } else if (Blt_TreeViewGetData(entryPtr, fieldPtr->columnPtr->key,
+		&objPtr) != TCL_OK) {
+		objPtr = NULL;
 	    }
+	} else if (Blt_TreeViewGetData(entryPtr, fieldPtr->columnPtr->key, 
+		&objPtr) != TCL_OK) {
+	    objPtr = NULL;
 	}
-	break;
+	valuePtr->objPtr = objPtr;
+	if (objPtr == NULL) {
+	    continue;
+	}
+	Tcl_IncrRefCount(objPtr);
+	valuePtr->string = Tcl_GetString(objPtr);
+	switch (fieldPtr->type) {
+	case SORT_TYPE_INTEGER:
+	    valuePtr->isNumber = (Tcl_GetIntFromObj(NULL, objPtr, 
+		&valuePtr->number.i) == TCL_OK);
+	    break;
 
-    case SORT_TYPE_DICTIONARY:
-	result = Blt_DictionaryCompare(s1, s2);
-	break;
+	case SORT_TYPE_REAL:
+	    valuePtr->isNumber = (Tcl_GetDoubleFromObj(NULL, objPtr, 
+		&valuePtr->number.d) == TCL_OK);
+	    break;
+	}
+    }
+}
+
+static int
+CompareSortKeys(SortInfo *infoPtr, SortKey *k1Ptr, SortKey *k2Ptr)
+{
+    SortField *fieldPtr;
+    SortValue *v1Ptr, *v2Ptr;
+    int i, result;
+
+    result = 0;
+    v1Ptr = k1Ptr->values, v2Ptr = k2Ptr->values;
+    fieldPtr = infoPtr->fields;
+    for (i = 0; (i < infoPtr->nFields) && (result == 0); 
+	 i++, v1Ptr++, v2Ptr++, fieldPtr++) {
+	switch (fieldPtr->type) {
+	case SORT_TYPE_ASCII:
+	    result = strcmp(v1Ptr->string, v2Ptr->string);
+	    break;
+
+	case SORT_TYPE_COMMAND:
+	    if (fieldPtr->command == NULL) {
+		result = Blt_DictionaryCompare(v1Ptr->string, v2Ptr->string);
+	    } else {
+		result = InvokeCompare(infoPtr->tvPtr, k1Ptr->entryPtr, 
+			k2Ptr->entryPtr, fieldPtr->command);
+	    }
+	    break;
 
-    case SORT_TYPE_INTEGER:
-	{
-	    int i1, i2;
+	case SORT_TYPE_DICTIONARY:
+	    result = Blt_DictionaryCompare(v1Ptr->string, v2Ptr->string);
+	    break;
 
-	    if (Tcl_GetIntFromObj(NULL, obj1, &i1)==TCL_OK) {
-		if (Tcl_GetIntFromObj(NULL, obj2, &i2) == TCL_OK) {
-		    result = i1 - i2;
+	case SORT_TYPE_INTEGER:
+	    if (v1Ptr->isNumber) {
+		if (v2Ptr->isNumber) {
+		    result = (v1Ptr->number.i < v2Ptr->number.i) ? -1 : 
+			(v1Ptr->number.i > v2Ptr->number.i) ? 1 : 0;
 		} else {
 		    result = -1;
-		} 
-	    } else if (Tcl_GetIntFromObj(NULL, obj2, &i2) == TCL_OK) {
+		}
+	    } else if (v2Ptr->isNumber) {
 		result = 1;
 	    } else {
-		result = Blt_DictionaryCompare(s1, s2);
+		result = Blt_DictionaryCompare(v1Ptr->string, v2Ptr->string);
 	    }
-	}
-	break;
-
-    case SORT_TYPE_REAL:
-	{
-	    double r1, r2;
+	    break;
 
-	    if (Tcl_GetDoubleFromObj(NULL, obj1, &r1) == TCL_OK) {
-		if (Tcl_GetDoubleFromObj(NULL, obj2, &r2) == TCL_OK) {
-		    result = (r1 < r2) ? -1 : (r1 > r2) ? 1 : 0;
+	case SORT_TYPE_REAL:
+	    if (v1Ptr->isNumber) {
+		if (v2Ptr->isNumber) {
+		    result = (v1Ptr->number.d < v2Ptr->number.d) ? -1 : 
+			(v1Ptr->number.d > v2Ptr->number.d) ? 1 : 0;
 		} else {
 		    result = -1;
-		} 
-	    } else if (Tcl_GetDoubleFromObj(NULL, obj2, &r2) == TCL_OK) {
+		}
+	    } else if (v2Ptr->isNumber) {
 		result = 1;
 	    } else {
-		result = Blt_DictionaryCompare(s1, s2);
+		result = Blt_DictionaryCompare(v1Ptr->string, v2Ptr->string);
 	    }
+	    break;
 	}
-	break;
     }
-    if (tvPtr->sortDecreasing) {
+    if (infoPtr->tvPtr->sortDecreasing) {
 	return -result;
     } 
     return result;
 }
 
-static int
-CompareEntries(a, b)
-    CONST void *a, *b;
-{
-    TreeView *tvPtr;
-    int result, i;
-    TreeViewEntry **e1PtrPtr = (TreeViewEntry **)a;
-    int objc;
-    Tcl_Obj **objv;
-    
-    result = CompareEntry(a, b, NULL);
-    
-    tvPtr = (*e1PtrPtr)->tvPtr;
-    if (result != 0) { return result; }
-    if (result != 0 || tvPtr->sortColumnPtr == NULL) return result;
-    if (tvPtr->sortColumnPtr->sortAltColumns == NULL) return result;
-		
-    if (Tcl_ListObjGetElements(NULL, tvPtr->sortColumnPtr->sortAltColumns,
-        &objc, &objv) != TCL_OK) {
-            return result;
-    }
-    for (i = 0; i < objc && result == 0; i++) {
-        result = CompareEntry(a, b, objv[i]);
-    }
-    
-    return result;
-}
-
 /*
  *----------------------------------------------------------------------
  *
- * CompareNodes --
+ * SortKeys --
  *
- *	Comparison routine (used by qsort) to sort a chain of subnodes.
+ *	Sorts an array of keys with a stable, natural merge sort.
+ *	The runs already in order are found first and then merged.
+ *	Resorting entries of which only a few have changed merges
+ *	only a few runs.  Runs shorter than SORT_RUN are extended by
+ *	insertion sorting.
  *
  * Results:
- *	1 is the first is greater, -1 is the second is greater, 0
- *	if equal.
+ *	None.
  *
  *----------------------------------------------------------------------
  */
-static int
-CompareNodes( Blt_TreeNode *n1Ptr, Blt_TreeNode *n2Ptr )
+static void
+SortKeys(SortInfo *infoPtr, SortKey *keyArr, int nKeys)
 {
-    TreeView *tvPtr = treeViewInstance;
-    TreeViewEntry *e1Ptr, *e2Ptr;
-    
-    e1Ptr = Blt_NodeToEntry(tvPtr, *n1Ptr);
-    e2Ptr = Blt_NodeToEntry(tvPtr, *n2Ptr);
+    SortKey *srcArr, *destArr, *tmpArr;
+    int *runArr;
+    int i, j, k, nRuns;
 
-    TreeViewColumn *columnPtr = tvPtr->sortColumnPtr;
+    if (nKeys < 2) {
+	return;
+    }
+    /* Every run but the last is at least SORT_RUN keys long. */
+    runArr = Blt_Malloc((nKeys / SORT_RUN + 2) * sizeof(int));
+    assert(runArr);
+    nRuns = 0;
+    for (i = 0; i < nKeys; i = j) {
+	j = i + 1;
+	if ((j < nKeys) && 
+	    (CompareSortKeys(infoPtr, keyArr + i, keyArr + j) > 0)) {
+	    SortKey *p, *q, hold;
+
+	    /* Reverse a strictly descending run. */
+	    while (((j + 1) < nKeys) && 
+		   (CompareSortKeys(infoPtr, keyArr + j, keyArr + j + 1) > 0)) {
+		j++;
+	    }
+	    j++;
+	    for (p = keyArr + i, q = keyArr + j - 1; p < q; p++, q--) {
+		hold = *p, *p = *q, *q = hold;
+	    }
+	} else {
+	    while ((j < nKeys) && 
+		   (CompareSortKeys(infoPtr, keyArr + j - 1, keyArr + j) <= 0)) {
+		j++;
+	    }
+	}
+	if ((j - i) < SORT_RUN) {
+	    int end;
 
-    /* Fetch the data for sorting. */
-    if (tvPtr->sortType == SORT_TYPE_COMMAND) {
-	e1Ptr->dataObjPtr = Tcl_NewIntObj(Blt_TreeNodeId(*n1Ptr));
-	e2Ptr->dataObjPtr = Tcl_NewIntObj(Blt_TreeNodeId(*n2Ptr));
-    } else if (columnPtr == &tvPtr->treeColumn) {
-	Tcl_DString dString;
+	    end = MIN(i + SORT_RUN, nKeys);
+	    for (/*empty*/; j < end; j++) {
+		SortKey key;
 
-	Tcl_DStringInit(&dString);
-	if (e1Ptr->fullName == NULL) {
-	    Blt_TreeViewGetFullName(tvPtr, e1Ptr, TRUE, &dString);
-	    e1Ptr->fullName = Blt_Strdup(Tcl_DStringValue(&dString));
+		key = keyArr[j];
+		for (k = j; (k > i) && 
+		     (CompareSortKeys(infoPtr, keyArr + k - 1, &key) > 0); k--) {
+		    keyArr[k] = keyArr[k - 1];
+		}
+		keyArr[k] = key;
+	    }
 	}
-	e1Ptr->dataObjPtr = Tcl_NewStringObj(e1Ptr->fullName, -1);
-	if (e2Ptr->fullName == NULL) {
-	    Blt_TreeViewGetFullName(tvPtr, e2Ptr, TRUE, &dString);
-	    e2Ptr->fullName = Blt_Strdup(Tcl_DStringValue(&dString));
+	runArr[nRuns++] = i;
+    }
+    runArr[nRuns] = nKeys;
+    if (nRuns == 1) {
+	Blt_Free(runArr);
+	return;
+    }
+    tmpArr = Blt_Malloc(nKeys * sizeof(SortKey));
+    assert(tmpArr);
+    srcArr = keyArr, destArr = tmpArr;
+    while (nRuns > 1) {
+	int n;
+
+	n = 0;
+	for (i = 0; i < nRuns; i += 2) {
+	    SortKey *p, *pEnd, *q, *qEnd, *dp;
+
+	    p = srcArr + runArr[i];
+	    pEnd = q = srcArr + runArr[i + 1];
+	    qEnd = ((i + 1) < nRuns) ? srcArr + runArr[i + 2] : q;
+	    dp = destArr + runArr[i];
+	    runArr[n++] = runArr[i];
+	    if ((q == qEnd) || 
+		(CompareSortKeys(infoPtr, pEnd - 1, q) <= 0)) {
+		memcpy(dp, p, (qEnd - p) * sizeof(SortKey));
+		continue;
+	    }
+	    while ((p < pEnd) && (q < qEnd)) {
+		if (CompareSortKeys(infoPtr, q, p) < 0) {
+		    *dp++ = *q++;
+		} else {
+		    *dp++ = *p++;
+		}
+	    }
+	    while (p < pEnd) {
+		*dp++ = *p++;
+	    }
+	    while (q < qEnd) {
+		*dp++ = *q++;
+	    }
 	}
-	e2Ptr->dataObjPtr = Tcl_NewStringObj(e2Ptr->fullName, -1);
-	Tcl_DStringFree(&dString);
-    } else {
-	Blt_TreeKey key;
-	Tcl_Obj *objPtr;
+	runArr[n] = nKeys;
+	nRuns = n;
+	tmpArr = srcArr, srcArr = destArr, destArr = tmpArr;
+    }
+    if (srcArr != keyArr) {
+	memcpy(keyArr, srcArr, nKeys * sizeof(SortKey));
+	destArr = srcArr;
+    }
+    Blt_Free(destArr);
+    Blt_Free(runArr);
+}
 
-	key = columnPtr->key;
-	if (Blt_TreeViewGetData(e1Ptr, key, &objPtr) != TCL_OK) {
-	    e1Ptr->dataObjPtr = Tcl_NewStringObj("",-1);
-	} else {
-	    e1Ptr->dataObjPtr = objPtr;
+/*
+ *----------------------------------------------------------------------
+ *
+ * AllocSortKeys --
+ *
+ *	Makes room for the given number of keys, reusing the arrays
+ *	of the last node sorted when they're big enough.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+AllocSortKeys(SortInfo *infoPtr, int nKeys)
+{
+    int i;
+
+    if (nKeys <= infoPtr->nAlloc) {
+	return;
+    }
+    if (infoPtr->keyArr != NULL) {
+	Blt_Free(infoPtr->keyArr);
+	Blt_Free(infoPtr->valueArr);
+	Blt_Free(infoPtr->nodeArr);
+    }
+    infoPtr->nAlloc = nKeys;
+    infoPtr->keyArr = Blt_Malloc(nKeys * sizeof(SortKey));
+    assert(infoPtr->keyArr);
+    infoPtr->valueArr = Blt_Malloc(nKeys * infoPtr->nFields * 
+	sizeof(SortValue));
+    assert(infoPtr->valueArr);
+    infoPtr->nodeArr = Blt_Malloc(nKeys * sizeof(Blt_TreeNode));
+    assert(infoPtr->nodeArr);
+    for (i = 0; i < nKeys; i++) {
+	infoPtr->keyArr[i].values = infoPtr->valueArr + (i * infoPtr->nFields);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RestoreLastOrder --
+ *
+ *	Rearranges the flat view, rebuilt in tree order, into the
+ *	order of the last sort.  Each entry remembers its position
+ *	from the last sort.  Entries that weren't sorted then follow
+ *	in tree order.  This is only a hint to SortKeys: positions
+ *	that are stale just make the array less sorted.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+RestoreLastOrder(TreeView *tvPtr)
+{
+    TreeViewEntry **slotArr, **p, **q;
+    int index;
+
+    slotArr = Blt_Calloc(tvPtr->nLastSorted, sizeof(TreeViewEntry *));
+    assert(slotArr);
+    for (p = tvPtr->flatArr; *p != NULL; p++) {
+	index = (*p)->sortIndex - 1;
+	if ((index >= 0) && (index < tvPtr->nLastSorted) && 
+	    (slotArr[index] == NULL)) {
+	    slotArr[index] = *p;
 	}
-	if (Blt_TreeViewGetData(e2Ptr, key, &objPtr) != TCL_OK) {
-            e2Ptr->dataObjPtr = Tcl_NewStringObj("",-1);
-	} else {
-	    e2Ptr->dataObjPtr = objPtr;
+    }
+    /* Unplaced entries are moved to the back, keeping their order. */
+    q = tvPtr->flatArr + tvPtr->nEntries;
+    for (p = q - 1; p >= tvPtr->flatArr; p--) {
+	index = (*p)->sortIndex - 1;
+	if ((index < 0) || (index >= tvPtr->nLastSorted) || 
+	    (slotArr[index] != *p)) {
+	    *--q = *p;
 	}
     }
-    return CompareEntries(&e1Ptr, &e2Ptr);
+    p = tvPtr->flatArr;
+    for (index = 0; index < tvPtr->nLastSorted; index++) {
+	if (slotArr[index] != NULL) {
+	    *p++ = slotArr[index];
+	}
+    }
+    assert(p == q);
+    Blt_Free(slotArr);
 }
 
 static int
@@ -3188,14 +3487,18 @@ SortOnceOp(tvPtr, interp, objc, objv)
         return TCL_ERROR;
     }
     for (i = 3; i < objc; i++) {
+	SortInfo info;
+
 	if (Blt_TreeViewGetEntry(tvPtr, objv[i], &entryPtr) != TCL_OK) {
 	    return TCL_ERROR;
 	}
+	InitSortInfo(tvPtr, &info);
 	if (recurse) {
-	    result = Blt_TreeApply(entryPtr->node, SortApplyProc, tvPtr);
+	    result = Blt_TreeApply(entryPtr->node, SortApplyProc, &info);
 	} else {
-	    result = SortApplyProc(entryPtr->node, tvPtr, TREE_PREORDER);
+	    result = SortApplyProc(entryPtr->node, &info, TREE_PREORDER);
 	}
+	FreeSortInfo(&info);
 	if (result != TCL_OK) {
 	    return TCL_ERROR;
 	}
@@ -3270,21 +3573,79 @@ SortApplyProc(node, clientData, order)
     ClientData clientData;
     int order;			/* Not used. */
 {
-    TreeView *tvPtr = clientData;
+    SortInfo *infoPtr = clientData;
+    TreeView *tvPtr = infoPtr->tvPtr;
+    Blt_TreeNode child;
+    TreeViewEntry *entryPtr;
+    int i, nKeys;
 
-    if (!Blt_TreeIsLeaf(node)) {
-        treeViewInstance = tvPtr;
-        Blt_TreeSortNode(tvPtr->tree, node, CompareNodes);
+    nKeys = Blt_TreeNodeDegree(node);
+    if (nKeys < 2) {
+	return TCL_OK;
     }
+    AllocSortKeys(infoPtr, nKeys);
+    i = 0;
+    for (child = Blt_TreeFirstChild(node); child != NULL; 
+	 child = Blt_TreeNextSibling(child)) {
+	entryPtr = Blt_NodeToEntry(tvPtr, child);
+	if (entryPtr == NULL) {
+	    FreeSortKeys(infoPtr, i);
+	    return TCL_OK;
+	}
+	InitSortKey(infoPtr, infoPtr->keyArr + i, entryPtr);
+	i++;
+    }
+    SortKeys(infoPtr, infoPtr->keyArr, nKeys);
+    for (i = 0; i < nKeys; i++) {
+	infoPtr->nodeArr[i] = infoPtr->keyArr[i].entryPtr->node;
+    }
+    FreeSortKeys(infoPtr, nKeys);
+    Blt_TreeReorderNode(tvPtr->tree, node, infoPtr->nodeArr);
     return TCL_OK;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SortOpenEntries --
+ *
+ *	Sorts the children of the entry and, recursively, of its open
+ *	descendants.  Closed branches are skipped so that their
+ *	entries aren't created just to be sorted.  They're sorted
+ *	when opened.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+SortOpenEntries(SortInfo *infoPtr, TreeViewEntry *entryPtr)
+{
+    TreeView *tvPtr = infoPtr->tvPtr;
+    Blt_TreeNode child;
+    TreeViewEntry *childPtr;
+
+    if (entryPtr->flags & ENTRY_CLOSED) {
+	return;
+    }
+    SortApplyProc(entryPtr->node, infoPtr, TREE_PREORDER);
+    for (child = Blt_TreeFirstChild(entryPtr->node); child != NULL; 
+	 child = Blt_TreeNextSibling(child)) {
+	childPtr = Blt_NodeToEntry(tvPtr, child);
+	if (childPtr != NULL) {
+	    SortOpenEntries(infoPtr, childPtr);
+	}
+    }
+}
  
 /*
  *----------------------------------------------------------------------
  *
  * Blt_TreeViewSortFlatView --
  *
- *	Sorts the flatten array of entries.
+ *	Sorts the flatten array of entries.  The array is rebuilt in
+ *	tree order when entries are added, removed or changed.  Its
+ *	entries are first put back in the order of the last sort, so
+ *	that resorting after a few changes only has to merge a few
+ *	runs.
  *
  *----------------------------------------------------------------------
  */
@@ -3292,7 +3653,9 @@ void
 Blt_TreeViewSortFlatView(tvPtr)
     TreeView *tvPtr;
 {
-    TreeViewEntry *entryPtr, **p;
+    SortInfo info;
+    TreeViewEntry **p;
+    int i;
 
     tvPtr->flags &= ~TV_SORT_PENDING;
     if ((tvPtr->sortType == SORT_TYPE_NONE) || (tvPtr->sortColumnPtr == NULL) ||
@@ -3317,65 +3680,29 @@ Blt_TreeViewSortFlatView(tvPtr)
 	    tvPtr->flatArr[first] = tvPtr->flatArr[last];
 	    tvPtr->flatArr[last] = hold;
 	}
+	for (i = 0; i < tvPtr->nEntries; i++) {
+	    tvPtr->flatArr[i]->sortIndex = i + 1;
+	}
 	tvPtr->viewIsDecreasing = tvPtr->sortDecreasing;
 	tvPtr->flags |= TV_SORTED | TV_LAYOUT;
 	return;
     }
-    /* Fetch each entry's data as Tcl_Objs for sorting. */
-    if (tvPtr->sortColumnPtr == &tvPtr->treeColumn) {
-	for(p = tvPtr->flatArr; *p != NULL; p++) {
-	    entryPtr = *p;
-	    if (entryPtr->fullName == NULL) {
-		Tcl_DString dString;
-
-		Tcl_DStringInit(&dString);
-		Blt_TreeViewGetFullName(tvPtr, entryPtr, TRUE, &dString);
-		entryPtr->fullName = Blt_Strdup(Tcl_DStringValue(&dString));
-		Tcl_DStringFree(&dString);
-	    }
-	    entryPtr->dataObjPtr = Tcl_NewStringObj(entryPtr->fullName, -1);
-	    Tcl_IncrRefCount(entryPtr->dataObjPtr);
-	}
-    } else {
-	/*Blt_TreeKey key;*/
-	Tcl_Obj *objPtr;
-	int isFmt;
-
-	/*key = tvPtr->sortColumnPtr->key;*/
-	isFmt = Blt_TreeViewStyleIsFmt(tvPtr, tvPtr->sortColumnPtr->stylePtr);
-        for(p = tvPtr->flatArr; *p != NULL; p++) {
-            TreeViewValue *valuePtr;
-            TreeViewColumn *columnPtr = tvPtr->sortColumnPtr;
-             
-	    entryPtr = *p;
-	   /* if (Blt_TreeViewGetData(entryPtr, key, &objPtr) != TCL_OK) {
-                objPtr =  Tcl_NewStringObj("",-1);
-	    }*/
-             if (isFmt &&
-                ((valuePtr = Blt_TreeViewFindValue(entryPtr, columnPtr))) &&
-                valuePtr->textPtr) {
-                 Tcl_DString dStr;
-                 Tcl_DStringInit(&dStr);
-                 Blt_TextLayoutValue( valuePtr->textPtr, &dStr);
-                 objPtr = Tcl_NewStringObj( Tcl_DStringValue(&dStr), -1);
-                 Tcl_DStringFree(&dStr);
-             } else if (Blt_TreeGetValueByKey(tvPtr->interp, tvPtr->tree,
-                entryPtr->node, columnPtr->key, &objPtr) != TCL_OK) {
-                     objPtr = Tcl_NewStringObj("",0);
-             }
-
-	    entryPtr->dataObjPtr = objPtr;
-	    Tcl_IncrRefCount(entryPtr->dataObjPtr);
-	}
+    if (tvPtr->nLastSorted > 0) {
+	RestoreLastOrder(tvPtr);
     }
-    qsort((char *)tvPtr->flatArr, tvPtr->nEntries, sizeof(TreeViewEntry *),
-	  (QSortCompareProc *)CompareEntries);
-
-    /* Free all the Tcl_Objs used for comparison data. */
-    for(p = tvPtr->flatArr; *p != NULL; p++) {
-	Tcl_DecrRefCount((*p)->dataObjPtr);
-         (*p)->dataObjPtr = NULL;
+    InitSortInfo(tvPtr, &info);
+    AllocSortKeys(&info, tvPtr->nEntries);
+    for (i = 0, p = tvPtr->flatArr; *p != NULL; p++, i++) {
+	InitSortKey(&info, info.keyArr + i, *p);
     }
+    SortKeys(&info, info.keyArr, tvPtr->nEntries);
+    for (i = 0; i < tvPtr->nEntries; i++) {
+	tvPtr->flatArr[i] = info.keyArr[i].entryPtr;
+	tvPtr->flatArr[i]->sortIndex = i + 1;
+    }
+    FreeSortKeys(&info, tvPtr->nEntries);
+    FreeSortInfo(&info);
+    tvPtr->nLastSorted = tvPtr->nEntries;
     tvPtr->viewIsDecreasing = tvPtr->sortDecreasing;
     tvPtr->flags |= TV_SORTED;
 }
@@ -3395,11 +3722,40 @@ Blt_TreeViewSortTreeView(tvPtr)
 {
     tvPtr->flags &= ~TV_SORT_PENDING;
     if ((tvPtr->sortType != SORT_TYPE_NONE) && (tvPtr->sortColumnPtr != NULL)) {
-	treeViewInstance = tvPtr;
-	Blt_TreeApply(tvPtr->rootPtr->node, SortApplyProc, tvPtr);
+	SortInfo info;
+
+	InitSortInfo(tvPtr, &info);
+	SortOpenEntries(&info, tvPtr->rootPtr);
+	FreeSortInfo(&info);
     }
     tvPtr->viewIsDecreasing = tvPtr->sortDecreasing;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeViewSortOpenedEntry --
+ *
+ *	Sorts the children of an entry that has just been opened, if
+ *	the tree view is auto-sorted.  Closed branches are skipped by
+ *	Blt_TreeViewSortTreeView, so they may be out of order.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Blt_TreeViewSortOpenedEntry(tvPtr, entryPtr)
+    TreeView *tvPtr;
+    TreeViewEntry *entryPtr;
+{
+    SortInfo info;
+
+    if ((tvPtr->flatView) || ((tvPtr->flags & TV_SORT_AUTO) == 0) ||
+	(tvPtr->sortType == SORT_TYPE_NONE) || (tvPtr->sortColumnPtr == NULL)) {
+	return;
+    }
+    InitSortInfo(tvPtr, &info);
+    SortOpenEntries(&info, entryPtr);
+    FreeSortInfo(&info);
+}
 
 #endif /* NO_TREEVIEW */
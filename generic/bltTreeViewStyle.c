@@ -1039,19 +1039,21 @@ Blt_GetPriorityStyle(
 
 #define IFSET(var,val) var = (val?val:var)
 
-/* Fill background. */
+/*
+ * Compute the attributes of a value and the border filling its
+ * background, if any.  The tile of the background is returned in
+ * tilePtr.
+ */
 /* TODO: return GC for element/style that sets the font!!!! */
 /* TODO: lookup font from style for Measure routines. */
-void
-drawTextBox(tvPtr, drawable, entryPtr, valuePtr, stylePtr, icon, x, y, sRec)
+static Tk_3DBorder
+GetBackground(tvPtr, entryPtr, valuePtr, stylePtr, sRec, tilePtr)
     TreeView *tvPtr;
-    Drawable drawable;
     TreeViewEntry *entryPtr;
     TreeViewValue *valuePtr;
     TreeViewStyle *stylePtr;
-    TreeViewIcon icon;
-    int x, y;
     TreeViewStyle *sRec;
+    Blt_Tile *tilePtr;
 {
     TreeViewColumn *columnPtr;
     int altRow = (entryPtr->flags&ENTRY_ALTROW);
@@ -1079,21 +1081,72 @@ drawTextBox(tvPtr, drawable, entryPtr, valuePtr, stylePtr, icon, x, y, sRec)
      } else if (altRow && tvPtr->altStylePtr &&  Blt_HasTile(tvPtr->altStylePtr->tile)) {
          stylePtr = tvPtr->altStylePtr;
     }
-    if (!Blt_TreeViewEntryIsSelected(tvPtr, entryPtr, columnPtr)) {
-        /*
-        * Draw the active or normal background color over the entire
-        * label area.  This includes both the tab's text and image.
-        * The rectangle should be 2 pixels wider/taller than this
-        * area. So if the label consists of just an image, we get an
-        * halo around the image when the tab is active.
-        */
-        if (sRec->border != NULL && (altRow==0 ||
-        (altRow && stylePtr->tile && stylePtr == tvPtr->altStylePtr))) {
-             Blt_TreeViewFill3DTile(tvPtr, drawable, sRec->border,
-               x - columnPtr->pad.side1, y - tvPtr->leader/2, 
+    *tilePtr = (entryPtr->gc) ? NULL : stylePtr->tile;
+    if (Blt_TreeViewEntryIsSelected(tvPtr, entryPtr, columnPtr)) {
+	return NULL;
+    }
+    /*
+     * Draw the active or normal background color over the entire
+     * label area.  This includes both the tab's text and image.
+     * The rectangle should be 2 pixels wider/taller than this
+     * area. So if the label consists of just an image, we get an
+     * halo around the image when the tab is active.
+     */
+    if (sRec->border != NULL && (altRow==0 ||
+	(altRow && stylePtr->tile && stylePtr == tvPtr->altStylePtr))) {
+	return sRec->border;
+    }
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TreeViewGetValueBorder --
+ *
+ *	Returns the border filling the background of a value drawn
+ *	with the given style, or NULL if it has none.  The tile of
+ *	the background is returned in tilePtr.
+ *
+ *----------------------------------------------------------------------
+ */
+Tk_3DBorder
+Blt_TreeViewGetValueBorder(tvPtr, entryPtr, valuePtr, stylePtr, tilePtr)
+    TreeView *tvPtr;
+    TreeViewEntry *entryPtr;
+    TreeViewValue *valuePtr;
+    TreeViewStyle *stylePtr;
+    Blt_Tile *tilePtr;
+{
+    TreeViewStyle sRec;
+
+    sRec = *stylePtr;
+    return GetBackground(tvPtr, entryPtr, valuePtr, stylePtr, &sRec, tilePtr);
+}
+
+/* Fill background. */
+void
+drawTextBox(tvPtr, drawable, entryPtr, valuePtr, stylePtr, icon, x, y, sRec)
+    TreeView *tvPtr;
+    Drawable drawable;
+    TreeViewEntry *entryPtr;
+    TreeViewValue *valuePtr;
+    TreeViewStyle *stylePtr;
+    TreeViewIcon icon;
+    int x, y;
+    TreeViewStyle *sRec;
+{
+    TreeViewColumn *columnPtr;
+    Tk_3DBorder border;
+    Blt_Tile tile;
+
+    columnPtr = valuePtr->columnPtr;
+    border = GetBackground(tvPtr, entryPtr, valuePtr, stylePtr, sRec, &tile);
+    if ((border != NULL) && (!tvPtr->valueFilled)) {
+	Blt_TreeViewFill3DTile(tvPtr, drawable, border,
+	       x - columnPtr->pad.side1, y - tvPtr->leader/2, 
 	       columnPtr->width, entryPtr->height,
-	       0, TK_RELIEF_FLAT,  entryPtr->gc?NULL:stylePtr->tile, tvPtr->scrollTile, 1);
-	}
+	       0, TK_RELIEF_FLAT, tile, tvPtr->scrollTile, 1);
     }
 }
 
@@ -3833,21 +3886,14 @@ Blt_TreeViewGetStyleFg(tvPtr, columnPtr, stylePtr)
 }
 
 static void
-DrawValue(tvPtr, entryPtr, valuePtr)
+RedrawValue(tvPtr, entryPtr, valuePtr)
     TreeView *tvPtr;
     TreeViewEntry *entryPtr;
     TreeViewValue *valuePtr;
 {
-    Drawable drawable;
-    int sx, sy, dx, dy;
-    int width, height, ishid;
-    int left, right, top, bottom;
-    TreeViewColumn *columnPtr;
     TreeViewStyle *stylePtr;
-    Tk_3DBorder selBorder;
 
     stylePtr = valuePtr->stylePtr;
-    ishid = (stylePtr?stylePtr->hidden:0);
     if (stylePtr == NULL) {
 	stylePtr = CHOOSE(tvPtr->stylePtr, valuePtr->columnPtr->stylePtr);
     }
@@ -3862,65 +3908,11 @@ DrawValue(tvPtr, entryPtr, valuePtr)
 	    }
 	}
     }
-    columnPtr = valuePtr->columnPtr;
-    dx = SCREENX(tvPtr, columnPtr->worldX) + columnPtr->pad.side1-1;
-    dy = SCREENY(tvPtr, entryPtr->worldY);
-    height = entryPtr->height - 1;
-    width = valuePtr->columnPtr->width - PADDING(columnPtr->pad);
-
-    top = tvPtr->titleHeight + tvPtr->insetY;
-    bottom = Tk_Height(tvPtr->tkwin) - tvPtr->insetY;
-    left = tvPtr->insetX;
-    right = Tk_Width(tvPtr->tkwin) - tvPtr->insetX;
-
-    if (((dx + width) < left) || (dx > right) ||
-	((dy + height) < top) || (dy > bottom)) {
-	return;			/* Value is clipped. */
+    if (valuePtr->entryPtr != NULL) {
+	entryPtr = valuePtr->entryPtr;
     }
-
-    drawable = Tk_GetPixmap(tvPtr->display, Tk_WindowId(tvPtr->tkwin), 
-	width, height, Tk_Depth(tvPtr->tkwin));
-    /* Draw the background of the value. */
-
-    if (Blt_TreeViewEntryIsSelected(tvPtr, entryPtr, columnPtr)) {
-        selBorder = SELECT_BORDER(tvPtr);
-        Blt_Fill3DRectangle(tvPtr->tkwin, drawable, selBorder, 0, 0, width, height,
-            0, TK_RELIEF_FLAT);
-    } else if ((valuePtr == tvPtr->activeValuePtr) ||
-	(!Blt_TreeViewEntryIsSelected(tvPtr, entryPtr, columnPtr))) {
-	Tk_3DBorder border;
-
-	border = Blt_TreeViewGetStyleBorder(tvPtr, tvPtr->stylePtr);
-	Blt_Fill3DRectangle(tvPtr->tkwin, drawable, border, 0, 0, width, height,
-		0, TK_RELIEF_FLAT);
-    } else if (Blt_HasTile(tvPtr->tile) == 0 && Blt_HasTile(columnPtr->tile) == 0) {
-
-	Blt_Draw3DRectangle(tvPtr->tkwin, drawable, SELECT_BORDER(tvPtr), 0, 0, 
-		width, height, tvPtr->selBorderWidth, tvPtr->selRelief);
-    }
-    Blt_TreeViewDrawValue(tvPtr, entryPtr, valuePtr, drawable, 0, 0, entryPtr->flags & ENTRY_ALTROW, ishid);
-    
-    /* Clip the drawable if necessary */
-    sx = sy = 0;
-    if (dx < left) {
-	width -= left - dx;
-	sx += left - dx;
-	dx = left;
-    }
-    if ((dx + width) >= right) {
-	width -= (dx + width) - right;
-    }
-    if (dy < top) {
-	height -= top - dy;
-	sy += top - dy;
-	dy = top;
-    }
-    if ((dy + height) >= bottom) {
-	height -= (dy + height) - bottom;
-    }
-    XCopyArea(tvPtr->display, drawable, Tk_WindowId(tvPtr->tkwin), 
-      tvPtr->lineGC, sx, sy, width,  height, dx, dy);
-    Tk_FreePixmap(tvPtr->display, drawable);
+    /* Only the row of the value needs to be redrawn. */
+    Blt_TreeViewEventuallyRedrawEntry(tvPtr, entryPtr);
 }
 
 /*
@@ -3969,7 +3961,7 @@ StyleActivateOp(tvPtr, interp, objc, objv)
     } else if (objc == 4) {
 	tvPtr->activeValuePtr = NULL;
 	if ((oldPtr != NULL)  && (tvPtr->activePtr != NULL)) {
-	    DrawValue(tvPtr, tvPtr->activePtr, oldPtr);
+	    RedrawValue(tvPtr, tvPtr->activePtr, oldPtr);
 	}
     } else {
 	TreeViewColumn *columnPtr;
@@ -3992,10 +3984,10 @@ StyleActivateOp(tvPtr, interp, objc, objv)
 	tvPtr->activeValuePtr = valuePtr;
 	if (valuePtr != oldPtr) {
 	    if (oldPtr != NULL) {
-		DrawValue(tvPtr, entryPtr, oldPtr);
+		RedrawValue(tvPtr, entryPtr, oldPtr);
 	    }
 	    if (valuePtr != NULL) {
-		DrawValue(tvPtr, entryPtr, valuePtr);
+		RedrawValue(tvPtr, entryPtr, valuePtr);
 	    }
 	}
     }
@@ -2,30 +2,19 @@
 #include <bltTuple.h>
 
 /*
- *  array or row pointers
- *   _
- *  |_---> [row index
- *  |_     [#columns             array of Tcl_Objs
- *  |_     [tuple pointer ---> [ . . . . . ]
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
+ *  array of row pointers        columns (one array per column)
+ *   _                             
+ *  |_---> [row index            double  [ . . . . . . ]  + bitmap
+ *  |_     [slot ------------>   integer [ . . . . . . ]  + bitmap
+ *  |_                           string  [ . . . . . . ]  + bitmap
+ *  |_                                      |
+ *  |_                                      +--> dictionary of strings
+ *  |_                           Tcl_Obj [ . . . . . . ]  + bitmap
  *  |_
  *
+ *  Values are stored by column.  A row only records its slot: the
+ *  position of its values in every column array.  Slots don't change
+ *  when rows are inserted, deleted, or sorted.
  */
 
 enum TagTypes { TAG_TYPE_NONE, TAG_TYPE_ALL, TAG_TYPE_TAG };
@@ -37,9 +26,22 @@ enum TagTypes { TAG_TYPE_NONE, TAG_TYPE_ALL, TAG_TYPE_TAG };
 #define TRACE_IGNORE		(0)
 #define TRACE_OK		(1)
 
-#define VALUE(r,c)	\
-	((((c)->index < (r)->nColumns) && ((r)->data != NULL)) \
-		? (r)->data[(c)->index] : NULL)
+#define NO_CODE			((unsigned int)-1)
+
+/* 
+ * Bitmap of the slots in a column holding a value. 
+ */
+#define ISDEFINED(c,s)	\
+	(((s) < (c)->nSlots) && ((c)->defined[(s) >> 3] & (1 << ((s) & 0x07))))
+#define SETDEFINED(c,s)	((c)->defined[(s) >> 3] |= (1 << ((s) & 0x07)))
+#define CLRDEFINED(c,s)	((c)->defined[(s) >> 3] &= ~(1 << ((s) & 0x07)))
+
+#define OBJS(c)		((Tcl_Obj **)(c)->data)
+#define DOUBLES(c)	((double *)(c)->data)
+#define INTS(c)		((Tcl_WideInt *)(c)->data)
+#define CODES(c)	((unsigned int *)(c)->data)
+#define CODESTRING(c,i)	\
+	(Blt_GetHashKey((c)->dictTablePtr, (c)->dict[(i)].hashPtr))
 
 typedef struct Blt_TupleColumnStruct Column;
 typedef struct Blt_TupleRowStruct Row;
@@ -49,23 +51,34 @@ typedef struct Blt_TupleClientStruct TupleClient;
 typedef struct Blt_TupleNotifierStruct Notifier;
 
 struct Blt_TupleRowStruct {
-    Tcl_Obj **data;		/* Array of Tcl_Objs represents the tuple's
-				 * data. */
-    unsigned short nColumns;	/* # columns allocated for this tuple. */
+    unsigned int slot;		/* Location of the tuple's values in
+				 * the column arrays. */
     unsigned short flags;	/* Special flags for this tuple. */
     unsigned int index;		/* Index of the tuple in the array. */
 };
 
+/*
+ * DictString --
+ *
+ *	Entry in the dictionary of a string column.  Cells of the
+ *	column hold the code (index) of the entry instead of the
+ *	string itself.  Unused codes are kept on a free list.
+ */
+typedef struct {
+    Blt_HashEntry *hashPtr;	/* String in the dictionary.  NULL if 
+				 * the code is free. */
+    unsigned int refCount;	/* # of cells holding the string. */
+    unsigned int nextFree;	/* Next free code, if this one is
+				 * free. */
+} DictString;
+
 struct Blt_TupleColumnStruct {
     char *key;			/* Name of column. */
-    int type;			/* Type of column:
-				 * TYPE_INTEGER
-				 * TYPE_NUMBER
-				 * TYPE_FLOAT
-				 * TYPE_STRING
-				 * TYPE_BOOLEAN
-				 * TYPE_LIST
-				 * TYPE_ARRAY
+    int type;			/* Type of values stored in the column:
+				 * TUPLE_COLUMN_TYPE_OBJ
+				 * TUPLE_COLUMN_TYPE_DOUBLE
+				 * TUPLE_COLUMN_TYPE_INTEGER
+				 * TUPLE_COLUMN_TYPE_STRING
 				 */
     int nz;			/* Number of (non-NULL) defined values
 				 * in the column. */
@@ -73,7 +86,28 @@ struct Blt_TupleColumnStruct {
     unsigned int flags;		/* Special flags for this column. */
     Blt_HashEntry *hashPtr;
 
-    /* Vector linkage */
+    unsigned int nSlots;	/* # of slots allocated in the value
+				 * array and bitmap. */
+    unsigned char *defined;	/* Bitmap of slots holding a value. */
+    char *data;			/* Array of values, indexed by row
+				 * slot.  The element type depends
+				 * upon the column type: Tcl_Obj *,
+				 * double, Tcl_WideInt, or a code in
+				 * the string dictionary. */
+    Blt_HashTable *dictTablePtr;/* Distinct strings of a string 
+				 * column, mapped to their codes. */
+    DictString *dict;		/* Array of dictionary entries, indexed
+				 * by code. */
+    unsigned int nCodes;	/* # of codes used in the array. */
+    unsigned int codesAllocated;
+    unsigned int freeCode;	/* First free code or NO_CODE. */
+};
+
+static size_t cellSizes[] = {
+    sizeof(Tcl_Obj *),		/* TUPLE_COLUMN_TYPE_OBJ */
+    sizeof(double),		/* TUPLE_COLUMN_TYPE_DOUBLE */
+    sizeof(Tcl_WideInt),	/* TUPLE_COLUMN_TYPE_INTEGER */
+    sizeof(unsigned int),	/* TUPLE_COLUMN_TYPE_STRING */
 };
 
 struct Blt_TupleTagTableStruct {
@@ -121,11 +155,12 @@ Blt_TupleMoveTuple(table, tuple, newPosition);
  *	same interpreter can have similar names but must reside in
  *	different namespaces.
  *
- *	The tuple object is an array of tuples. A tuple itself is an
- *	array of Tcl_Objs representing data for each column (or key).
- *	Value are identified by their column name.  A tuple does not
- *	need to contain values for all columns.  Undefined values
- *	(Tcl_Objs) are NULL.
+ *	The tuple object is an array of tuples.  The values of the
+ *	tuples are stored by column, each column holding an array of
+ *	values of its type.  Value are identified by their column
+ *	name.  A tuple does not need to contain values for all
+ *	columns.  Undefined values are tracked by a bitmap in each
+ *	column.
  *
  *	A tuple object can be shared by several clients.  When a
  *	client wants to use a tuple object, it is given a token that
@@ -160,6 +195,12 @@ typedef struct {
     
     Blt_Pool rowPool;		/* Pool that allocates row containers. */
 
+    unsigned int nSlots;	/* # of row slots ever used.  */
+    unsigned int *freeSlots;	/* Stack of slots released by deleted
+				 * rows, reused by new rows. */
+    unsigned int nFreeSlots;
+    unsigned int freeSlotsAllocated;
+
     char *sortCmd;		/* Tcl command to invoke to sort
 				 * entries. */
     
@@ -207,14 +248,339 @@ struct Blt_TupleClientStruct {
 
 static Tcl_InterpDeleteProc TupleInterpDeleteProc;
 
+/*
+ * --------------------------------------------------------------
+ *
+ * GrowColumn --
+ *
+ *	Makes sure the value array and bitmap of the column have
+ *	room for the given slot.  The arrays grow by doubling.  New
+ *	slots are undefined.
+ *
+ * Results:
+ *	Returns TCL_OK if the column could be resized and TCL_ERROR
+ *	if not enough memory was available.
+ *
+ * -------------------------------------------------------------- 
+ */
+static int
+GrowColumn(Column *columnPtr, unsigned int slot)
+{
+    unsigned int nSlots, oldBytes, newBytes;
+    size_t size;
+    char *data;
+    unsigned char *defined;
+
+    if (slot < columnPtr->nSlots) {
+	return TCL_OK;
+    }
+    nSlots = (columnPtr->nSlots == 0) ? 32 : columnPtr->nSlots;
+    while (nSlots <= slot) {
+	nSlots += nSlots;
+    }
+    size = cellSizes[columnPtr->type];
+    data = Blt_Realloc(columnPtr->data, nSlots * size);
+    if (data == NULL) {
+	return TCL_ERROR;
+    }
+    memset(data + columnPtr->nSlots * size, 0, 
+	(nSlots - columnPtr->nSlots) * size);
+    columnPtr->data = data;
+
+    oldBytes = (columnPtr->nSlots + 7) / 8;
+    newBytes = (nSlots + 7) / 8;
+    defined = Blt_Realloc(columnPtr->defined, newBytes);
+    if (defined == NULL) {
+	return TCL_ERROR;
+    }
+    memset(defined + oldBytes, 0, newBytes - oldBytes);
+    columnPtr->defined = defined;
+    columnPtr->nSlots = nSlots;
+    return TCL_OK;
+}
+
+/*
+ * --------------------------------------------------------------
+ *
+ * GetCode --
+ *
+ *	Returns the code of the string in the dictionary of the
+ *	column, adding the string if it's not already there.  The
+ *	reference count of the string is incremented.
+ *
+ * -------------------------------------------------------------- 
+ */
+static unsigned int
+GetCode(Column *columnPtr, CONST char *string)
+{
+    Blt_HashEntry *hPtr;
+    unsigned int code;
+    int isNew;
+
+    hPtr = Blt_CreateHashEntry(columnPtr->dictTablePtr, string, &isNew);
+    if (!isNew) {
+	code = (unsigned int)(size_t)Blt_GetHashValue(hPtr);
+	columnPtr->dict[code].refCount++;
+	return code;
+    }
+    if (columnPtr->freeCode != NO_CODE) {
+	code = columnPtr->freeCode;
+	columnPtr->freeCode = columnPtr->dict[code].nextFree;
+    } else {
+	if (columnPtr->nCodes >= columnPtr->codesAllocated) {
+	    columnPtr->codesAllocated = (columnPtr->codesAllocated == 0) 
+		? 32 : columnPtr->codesAllocated * 2;
+	    columnPtr->dict = Blt_Realloc(columnPtr->dict, 
+		columnPtr->codesAllocated * sizeof(DictString));
+	    assert(columnPtr->dict);
+	}
+	code = columnPtr->nCodes++;
+    }
+    columnPtr->dict[code].hashPtr = hPtr;
+    columnPtr->dict[code].refCount = 1;
+    columnPtr->dict[code].nextFree = NO_CODE;
+    Blt_SetHashValue(hPtr, (ClientData)(size_t)code);
+    return code;
+}
+
+static void
+ReleaseCode(Column *columnPtr, unsigned int code)
+{
+    DictString *stringPtr = columnPtr->dict + code;
+
+    stringPtr->refCount--;
+    if (stringPtr->refCount == 0) {
+	Blt_DeleteHashEntry(columnPtr->dictTablePtr, stringPtr->hashPtr);
+	stringPtr->hashPtr = NULL;
+	stringPtr->nextFree = columnPtr->freeCode;
+	columnPtr->freeCode = code;
+    }
+}
+
+/*
+ * --------------------------------------------------------------
+ *
+ * ClearCell --
+ *
+ *	Removes the value, if any, of the column at the given slot.
+ *
+ * -------------------------------------------------------------- 
+ */
+static void
+ClearCell(Column *columnPtr, unsigned int slot)
+{
+    if (!ISDEFINED(columnPtr, slot)) {
+	return;
+    }
+    switch (columnPtr->type) {
+    case TUPLE_COLUMN_TYPE_OBJ:
+	Tcl_DecrRefCount(OBJS(columnPtr)[slot]);
+	OBJS(columnPtr)[slot] = NULL;
+	break;
+    case TUPLE_COLUMN_TYPE_STRING:
+	ReleaseCode(columnPtr, CODES(columnPtr)[slot]);
+	break;
+    }
+    CLRDEFINED(columnPtr, slot);
+    columnPtr->nz--;
+}
+
+/*
+ * --------------------------------------------------------------
+ *
+ * ObjToCell --
+ *
+ *	Stores the Tcl_Obj as the value of the column at the given
+ *	slot.  The value is converted to the type of the column.
+ *	Only generic columns keep a reference to the Tcl_Obj.
+ *
+ * Results:
+ *	A standard Tcl result.  If the value can't be converted to
+ *	the column's type, TCL_ERROR is returned, an error message is
+ *	left in the interpreter, and the old value is left in place.
+ *
+ * -------------------------------------------------------------- 
+ */
+static int
+ObjToCell(
+    Tcl_Interp *interp,
+    Column *columnPtr, 
+    unsigned int slot, 
+    Tcl_Obj *objPtr)
+{
+    double dValue;
+    Tcl_WideInt iValue;
+    unsigned int code;
+
+    dValue = 0.0, iValue = 0, code = NO_CODE;
+    switch (columnPtr->type) {
+    case TUPLE_COLUMN_TYPE_DOUBLE:
+	if (Tcl_GetDoubleFromObj(interp, objPtr, &dValue) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	break;
+    case TUPLE_COLUMN_TYPE_INTEGER:
+	if (Tcl_GetWideIntFromObj(interp, objPtr, &iValue) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	break;
+    }
+    if (GrowColumn(columnPtr, slot) != TCL_OK) {
+	if (interp != NULL) {
+	    Tcl_AppendResult(interp, "can't allocate storage for column \"", 
+		columnPtr->key, "\"", (char *)NULL);
+	}
+	return TCL_ERROR;
+    }
+    /* 
+     * Take the new reference before releasing the old value, in case
+     * both are the same object or string.
+     */
+    switch (columnPtr->type) {
+    case TUPLE_COLUMN_TYPE_OBJ:
+	Tcl_IncrRefCount(objPtr);
+	break;
+    case TUPLE_COLUMN_TYPE_STRING:
+	code = GetCode(columnPtr, Tcl_GetString(objPtr));
+	break;
+    }
+    ClearCell(columnPtr, slot);
+    switch (columnPtr->type) {
+    case TUPLE_COLUMN_TYPE_OBJ:
+	OBJS(columnPtr)[slot] = objPtr;
+	break;
+    case TUPLE_COLUMN_TYPE_DOUBLE:
+	DOUBLES(columnPtr)[slot] = dValue;
+	break;
+    case TUPLE_COLUMN_TYPE_INTEGER:
+	INTS(columnPtr)[slot] = iValue;
+	break;
+    case TUPLE_COLUMN_TYPE_STRING:
+	CODES(columnPtr)[slot] = code;
+	break;
+    }
+    SETDEFINED(columnPtr, slot);
+    columnPtr->nz++;
+    return TCL_OK;
+}
+
+/*
+ * --------------------------------------------------------------
+ *
+ * CellToObj --
+ *
+ *	Returns the value of the column at the given slot as a
+ *	Tcl_Obj.  Values of generic columns are returned as is.
+ *	Typed values are converted into a new Tcl_Obj whose reference
+ *	count is zero.
+ *
+ * Results:
+ *	Returns the value, or NULL if the slot holds no value.
+ *
+ * -------------------------------------------------------------- 
+ */
+static Tcl_Obj *
+CellToObj(Column *columnPtr, unsigned int slot)
+{
+    if (!ISDEFINED(columnPtr, slot)) {
+	return NULL;
+    }
+    switch (columnPtr->type) {
+    case TUPLE_COLUMN_TYPE_DOUBLE:
+	return Tcl_NewDoubleObj(DOUBLES(columnPtr)[slot]);
+    case TUPLE_COLUMN_TYPE_INTEGER:
+	return Tcl_NewWideIntObj(INTS(columnPtr)[slot]);
+    case TUPLE_COLUMN_TYPE_STRING:
+	return Tcl_NewStringObj(CODESTRING(columnPtr, 
+		CODES(columnPtr)[slot]), -1);
+    }
+    return OBJS(columnPtr)[slot];
+}
+
+static void
+InitColumnStorage(Column *columnPtr, int type)
+{
+    columnPtr->type = type;
+    columnPtr->nz = 0;
+    columnPtr->nSlots = 0;
+    columnPtr->defined = NULL;
+    columnPtr->data = NULL;
+    columnPtr->dict = NULL;
+    columnPtr->nCodes = columnPtr->codesAllocated = 0;
+    columnPtr->freeCode = NO_CODE;
+    columnPtr->dictTablePtr = NULL;
+    if (type == TUPLE_COLUMN_TYPE_STRING) {
+	columnPtr->dictTablePtr = Blt_Malloc(sizeof(Blt_HashTable));
+	assert(columnPtr->dictTablePtr);
+	Blt_InitHashTable(columnPtr->dictTablePtr, BLT_STRING_KEYS);
+    }
+}
+
+static void
+FreeColumnStorage(Column *columnPtr)
+{
+    if (columnPtr->type == TUPLE_COLUMN_TYPE_OBJ) {
+	unsigned int i;
+
+	for (i = 0; i < columnPtr->nSlots; i++) {
+	    if (ISDEFINED(columnPtr, i)) {
+		Tcl_DecrRefCount(OBJS(columnPtr)[i]);
+	    }
+	}
+    } else if (columnPtr->type == TUPLE_COLUMN_TYPE_STRING) {
+	Blt_DeleteHashTable(columnPtr->dictTablePtr);
+	Blt_Free(columnPtr->dictTablePtr);
+	columnPtr->dictTablePtr = NULL;
+	if (columnPtr->dict != NULL) {
+	    Blt_Free(columnPtr->dict);
+	}
+    }
+    if (columnPtr->data != NULL) {
+	Blt_Free(columnPtr->data);
+    }
+    if (columnPtr->defined != NULL) {
+	Blt_Free(columnPtr->defined);
+    }
+    columnPtr->data = NULL;
+    columnPtr->defined = NULL;
+    columnPtr->nSlots = 0;
+}
+
+static Column *
+NewColumn(TupleObject *tupleObjPtr, Blt_HashEntry *hPtr)
+{
+    Column *columnPtr;
+
+    columnPtr = Blt_Calloc(1, sizeof(Column));
+    assert(columnPtr);
+    columnPtr->key = Blt_GetHashKey(&tupleObjPtr->columnTable, hPtr);
+    columnPtr->hashPtr = hPtr;
+    columnPtr->index = tupleObjPtr->nColumns;
+    InitColumnStorage(columnPtr, TUPLE_COLUMN_TYPE_OBJ);
+    Blt_SetHashValue(hPtr, columnPtr);
+    return columnPtr;
+}
+
+static void
+DestroyColumn(Column *columnPtr)
+{
+    FreeColumnStorage(columnPtr);
+    Blt_Free(columnPtr);
+}
+
 static Row *
 NewRow(TupleObject *tupleObjPtr, unsigned int rowIndex)
 {
     Row *rowPtr;
 
     rowPtr = Blt_PoolAllocItem(tupleObjPtr->rowPool, sizeof(Row));
-    rowPtr->data = NULL;
-    rowPtr->nColumns = 0;
+    if (tupleObjPtr->nFreeSlots > 0) {
+	tupleObjPtr->nFreeSlots--;
+	rowPtr->slot = tupleObjPtr->freeSlots[tupleObjPtr->nFreeSlots];
+    } else {
+	rowPtr->slot = tupleObjPtr->nSlots++;
+    }
+    rowPtr->flags = 0;
     rowPtr->index = rowIndex;
     return rowPtr;
 }
@@ -222,18 +588,20 @@ NewRow(TupleObject *tupleObjPtr, unsigned int rowIndex)
 static void
 DeleteRow(TupleObject *tupleObjPtr, Row *rowPtr)
 {
-    if (rowPtr->data != NULL) {
-	int i;
-	Tcl_Obj *objPtr;
+    unsigned int i;
 
-	for(i = 0; i < rowPtr->nColumns; i++) {
-	    objPtr = rowPtr->data[i];
-	    if (objPtr != NULL) {
-		Tcl_DecrRefCount(objPtr);
-	    }
-	}
-	Blt_Free(rowPtr->data);
+    /* Clear the row's values and put its slot up for reuse. */
+    for (i = 0; i < tupleObjPtr->nColumns; i++) {
+	ClearCell(tupleObjPtr->columns[i], rowPtr->slot);
+    }
+    if (tupleObjPtr->nFreeSlots >= tupleObjPtr->freeSlotsAllocated) {
+	tupleObjPtr->freeSlotsAllocated = (tupleObjPtr->freeSlotsAllocated == 0)
+	    ? 32 : tupleObjPtr->freeSlotsAllocated * 2;
+	tupleObjPtr->freeSlots = Blt_Realloc(tupleObjPtr->freeSlots, 
+		tupleObjPtr->freeSlotsAllocated * sizeof(unsigned int));
+	assert(tupleObjPtr->freeSlots);
     }
+    tupleObjPtr->freeSlots[tupleObjPtr->nFreeSlots++] = rowPtr->slot;
     Blt_PoolFreeItem(tupleObjPtr->rowPool, (char *)rowPtr);
 }
 
@@ -273,6 +641,7 @@ NewTupleObject(
     tupleObjPtr->notifyFlags = 0;
     Blt_InitHashTableWithPool(&tupleObjPtr->busyTable, BLT_ONE_WORD_KEYS);
     Blt_InitHashTable(&tupleObjPtr->columnTable, BLT_STRING_KEYS);
+    tupleObjPtr->rowPool = Blt_PoolCreate(BLT_FIXED_SIZE_ITEMS);
 
     tupleObjPtr->tablePtr = &dataPtr->instTable;
     hPtr = Blt_CreateHashEntry(tupleObjPtr->tablePtr, name, &isNew);
@@ -323,16 +692,23 @@ DestroyTupleObject(TupleObject *tupleObjPtr)
     Blt_ChainDestroy(tupleObjPtr->notifiers);
     Blt_ChainDestroy(tupleObjPtr->clients);
 
-    if (tupleObjPtr->rows != NULL) {
+    if (tupleObjPtr->columns != NULL) {
 	int i;
 
-	for (i = 0; i < tupleObjPtr->nRows; i++) {
-	    DeleteRow(tupleObjPtr, tupleObjPtr->rows[i]);
+	for (i = 0; i < tupleObjPtr->nColumns; i++) {
+	    DestroyColumn(tupleObjPtr->columns[i]);
 	}
+	Blt_Free(tupleObjPtr->columns);
+    }
+    tupleObjPtr->nColumns = 0;
+    if (tupleObjPtr->rows != NULL) {
 	Blt_Free(tupleObjPtr->rows);
     }
     tupleObjPtr->nRows = 0;
-
+    if (tupleObjPtr->freeSlots != NULL) {
+	Blt_Free(tupleObjPtr->freeSlots);
+    }
+    /* The pool frees all the row containers at once. */
     Blt_PoolDestroy(tupleObjPtr->rowPool);
     Blt_DeleteHashTable(&tupleObjPtr->columnTable);
     Blt_DeleteHashTable(&tupleObjPtr->busyTable);
@@ -627,7 +1003,8 @@ CallTraces(
  * GetValue --
  *
  *	Gets a scalar Tcl_Obj value from the table at the designated
- *	row and column.  Create and read traces may be fired.
+ *	row and column.  Create and read traces may be fired.  Values
+ *	of typed columns are returned in a new Tcl_Obj (see CellToObj).
  *
  * Results:
  *	Always returns TCL_OK.  
@@ -656,7 +1033,7 @@ GetValue(
     Blt_DeleteHashEntry(&tupleObjPtr->busyTable, hPtr);
 
     /* Access the data value after traces have been called. */
-    *objPtrPtr = VALUE(rowPtr, columnPtr);
+    *objPtrPtr = CellToObj(columnPtr, rowPtr->slot);
     return TCL_OK;
 }
 
@@ -669,7 +1046,8 @@ GetValue(
  *	and column.  Write traces may be fired.
  *
  * Results:
- *	Always returns TCL_OK.  
+ *	A standard Tcl result.  TCL_ERROR is returned if the value
+ *	can't be converted to the type of the column.
  *
  * -------------------------------------------------------------- 
  */
@@ -681,30 +1059,21 @@ SetValue(
     Column *columnPtr,
     Tcl_Obj *objPtr)
 {
-    Tcl_Obj *oldObjPtr;
     unsigned int flags;
     Blt_HashEntry *hPtr;
     int isNew;
     BusyKey busy;
     TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
 
-    if ((rowPtr->nColumns < columnPtr->index) && (rowPtr->data != NULL)) {
-	oldObjPtr = rowPtr->data[columnPtr->index];
-    } else {
-	AllocateRows(tupleObjPtr, rowPtr);
-	objObjPtr = NULL;
-    }
-    if (objPtr != NULL) {
-	Tcl_IncrRefCount(objPtr);
-    }
-    if (oldObjPtr != NULL) {
-	Tcl_DecrRefCount(oldObjPtr);
-    }
-    rowPtr->data[columnPtr->index] = objPtr;
     flags = TUPLE_TRACE_WRITE;
-    if (oldObjPtr == NULL) {
+    if (!ISDEFINED(columnPtr, rowPtr->slot)) {
 	flags |= TUPLE_TRACE_CREATE;
     }
+    if (objPtr == NULL) {
+	ClearCell(columnPtr, rowPtr->slot);
+    } else if (ObjToCell(interp, columnPtr, rowPtr->slot, objPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
     busy.rowPtr = rowPtr;
     busy.columnPtr = columnPtr;
     hPtr = Blt_CreateHashEntry(&tupleObjPtr->busyTable, &busy, &isNew);
@@ -735,17 +1104,13 @@ UnsetValue(
     Row *rowPtr,
     Column *columnPtr)
 {
-    Tcl_Obj *objPtr;
-
-    objPtr = VALUE(rowPtr, columnPtr);
-    if (objPtr != NULL) {
+    if (ISDEFINED(columnPtr, rowPtr->slot)) {
 	TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
 	Blt_HashEntry *hPtr;
 	BusyKey busy;
 	int isNew;
 
-        Tcl_DecrRefCount(objPtr);
-        rowPtr->data[columnPtr->index] = NULL;
+	ClearCell(columnPtr, rowPtr->slot);
 	busy.rowPtr = rowPtr;
 	busy.columnPtr = columnPtr;
 	hPtr = Blt_CreateHashEntry(&tupleObjPtr->busyTable, &busy, &isNew);
@@ -757,6 +1122,29 @@ UnsetValue(
     return TCL_OK;
 }
 
+/*
+ * --------------------------------------------------------------
+ *
+ * IsArrayColumn --
+ *
+ *	Indicates if the column can hold array values.  Only generic
+ *	columns do, since typed columns don't keep Tcl_Objs.
+ *
+ * -------------------------------------------------------------- 
+ */
+static int
+IsArrayColumn(Tcl_Interp *interp, Column *columnPtr)
+{
+    if (columnPtr->type != TUPLE_COLUMN_TYPE_OBJ) {
+	if (interp != NULL) {
+	    Tcl_AppendResult(interp, "column \"", columnPtr->key, 
+		"\" is typed and can't hold arrays", (char *)NULL);
+	}
+	return FALSE;
+    }
+    return TRUE;
+}
+
 static int
 GetArrayValue(
     Tcl_Interp *interp,
@@ -772,6 +1160,9 @@ GetArrayValue(
     Blt_HashTable *tablePtr;
     Blt_HashEntry *hPtr;
 
+    if (!IsArrayColumn(interp, columnPtr)) {
+	return TCL_ERROR;
+    }
     if (doTrace) {
 	BusyKey busy;
 	int isNew;
@@ -786,13 +1177,13 @@ GetArrayValue(
     }
 
     /* Access the data value after traces have been called. */
-    objPtr = VALUE(rowPtr, columnPtr);
+    objPtr = CellToObj(columnPtr, rowPtr->slot);
     if (objPtr != NULL) {
 	if (Tcl_IsShared(objPtr)) {
 	    Tcl_DecrRefCount(objPtr);
 	    objPtr = Tcl_DuplicateObj(objPtr);
 	    Tcl_IncrRefCount(objPtr);
-	    rowPtr->data[columnPtr->index] = objPtr;
+	    OBJS(columnPtr)[rowPtr->slot] = objPtr;
 	}
 	if (Blt_GetArrayFromObj(interp, objPtr, &tablePtr) != TCL_OK) {
 	    return TCL_ERROR;
@@ -828,19 +1219,25 @@ SetArrayValue(
     BusyKey busy;
     TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
 
+    if (!IsArrayColumn(interp, columnPtr)) {
+	return TCL_ERROR;
+    }
     flags = TUPLE_TRACE_WRITE;
-    arrayObjPtr = VALUE(rowPtr, columnPtr);
+    arrayObjPtr = CellToObj(columnPtr, rowPtr->slot);
     if (arrayObjPtr == NULL) {
 	arrayObjPtr = Blt_NewArrayObj(0, (Tcl_Obj **)NULL);
-	Tcl_IncrRefCount(arrayObjPtr);
+	if (ObjToCell(interp, columnPtr, rowPtr->slot, arrayObjPtr) 
+	    != TCL_OK) {
+	    Tcl_DecrRefCount(arrayObjPtr);
+	    return TCL_ERROR;
+	}
 	flags |= TUPLE_TRACE_CREATE;
-	AllocateRows(tupleObjPtr, rowPtr);
     } else if (Tcl_IsShared(arrayObjPtr)) {
 	Tcl_DecrRefCount(arrayObjPtr);
 	arrayObjPtr = Tcl_DuplicateObj(arrayObjPtr);
 	Tcl_IncrRefCount(arrayObjPtr);
+	OBJS(columnPtr)[rowPtr->slot] = arrayObjPtr;
     }
-    rowPtr->data[columnPtr->index] = arrayObjPtr;
     if (Blt_GetArrayFromObj(interp, arrayObjPtr, &tablePtr) != TCL_OK) {
 	return TCL_ERROR;
     }
@@ -891,7 +1288,10 @@ UnsetArrayValue(
     TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
     int isNew;
 
-    arrayObjPtr = VALUE(rowPtr, columnPtr);
+    if (!IsArrayColumn(interp, columnPtr)) {
+	return TCL_ERROR;
+    }
+    arrayObjPtr = CellToObj(columnPtr, rowPtr->slot);
     if (arrayObjPtr == NULL) {
 	return TCL_OK;
     }
@@ -899,6 +1299,7 @@ UnsetArrayValue(
 	Tcl_DecrRefCount(arrayObjPtr);
 	arrayObjPtr = Tcl_DuplicateObj(arrayObjPtr);
 	Tcl_IncrRefCount(arrayObjPtr);
+	OBJS(columnPtr)[rowPtr->slot] = arrayObjPtr;
     }
     if (Blt_GetArrayFromObj(interp, arrayObjPtr, &tablePtr) != TCL_OK) {
 	return TCL_ERROR;
@@ -910,7 +1311,7 @@ UnsetArrayValue(
     valueObjPtr = Blt_GetHashValue(hPtr);
     Tcl_DecrRefCount(valueObjPtr);
     Blt_DeleteHashEntry(tablePtr, hPtr);
-    rowPtr->data[columnPtr->index] = NULL;
+    Tcl_InvalidateStringRep(arrayObjPtr);
 
     /*
      * Un-setting any element in the array can cause the trace on the value
@@ -927,53 +1328,78 @@ UnsetArrayValue(
 }
 
 
+/*
+ * --------------------------------------------------------------
+ *
+ * ExtendRows --
+ *
+ *	Makes room in the array of row pointers for the given number
+ *	of extra rows.  The array grows by doubling.  The rows
+ *	themselves are created by the caller.
+ *
+ * -------------------------------------------------------------- 
+ */
 static int
-ExtendRows(TupleObject *tupleObjPtr, int extra)
+ExtendRows(TupleObject *tupleObjPtr, unsigned int extra)
 {
-    int nRows;
-    int i;
+    unsigned int nRows;
 
     nRows = tupleObjPtr->nRows + extra;
     if (tupleObjPtr->rowsAllocated < nRows) {
 	Row **rows;
-	    
-	if (tupleObjPtr->rowsAllocated == 0) {
-	    tupleObjPtr->rowsAllocated = 32;
+	unsigned int rowsAllocated;
+
+	rowsAllocated = tupleObjPtr->rowsAllocated;
+	if (rowsAllocated == 0) {
+	    rowsAllocated = 32;
 	}
-	while (tupleObjPtr->rowsAllocated < nRows) {
-	    tupleObjPtr->rowsAllocated += tupleObjPtr->rowsAllocated;
+	while (rowsAllocated < nRows) {
+	    rowsAllocated += rowsAllocated;
 	}
-	rows = Blt_Realloc(tupleObjPtr->rows, 
-			   tupleObjPtr->rowsAllocated * sizeof(Row *));
+	rows = Blt_Realloc(tupleObjPtr->rows, rowsAllocated * sizeof(Row *));
 	if (rows == NULL) {
-	    return -1;
+	    return TCL_ERROR;
 	}
 	tupleObjPtr->rows = rows;
+	tupleObjPtr->rowsAllocated = rowsAllocated;
     }
-    for (i = tupleObjPtr->nRows; i < nRows; i++) {
-	tupleObjPtr->rows[i] = NewRow(tupleObjPtr, i);
-    }
-    tupleObjPtr->nRows = nRows;
-    return 0;
+    return TCL_OK;
 }
 
+/*
+ * --------------------------------------------------------------
+ *
+ * ExtendColumns --
+ *
+ *	Makes room in the array of column pointers for the given
+ *	number of extra columns.  The array grows by doubling.
+ *
+ * -------------------------------------------------------------- 
+ */
 static int
-ExtendColumns(TupleObject *tupleObjPtr, Row *rowPtr)
+ExtendColumns(TupleObject *tupleObjPtr, unsigned int extra)
 {
-    if (tupleObjPtr->columnsAllocated < rowPtr->nColumns) {
-	Tcl_Obj **data;
-	int i;
+    unsigned int nColumns;
 
-	data = Blt_Realloc(rowPtr->data, 
-		      tupleObjPtr->columnsAllocated * sizeof(Tcl_Obj *));
-	if (data == NULL) {
-	    return TCL_ERROR;
+    nColumns = tupleObjPtr->nColumns + extra;
+    if (tupleObjPtr->columnsAllocated < nColumns) {
+	Column **columns;
+	unsigned int columnsAllocated;
+
+	columnsAllocated = tupleObjPtr->columnsAllocated;
+	if (columnsAllocated == 0) {
+	    columnsAllocated = 8;
+	}
+	while (columnsAllocated < nColumns) {
+	    columnsAllocated += columnsAllocated;
 	}
-	for(i = rowPtr->nColumns; i < tupleObjPtr->columnsAllocated; i++) {
-	    data[i] = NULL;
+	columns = Blt_Realloc(tupleObjPtr->columns, 
+		columnsAllocated * sizeof(Column *));
+	if (columns == NULL) {
+	    return TCL_ERROR;
 	}
-	rowPtr->data = data;
-	rowPtr->nColumns = tupleObjPtr->columnsAllocated;
+	tupleObjPtr->columns = columns;
+	tupleObjPtr->columnsAllocated = columnsAllocated;
     }
     return TCL_OK;
 }
@@ -1600,11 +2026,11 @@ Blt_TupleAddColumn(
     if (!*isNewPtr) {
 	columnPtr = Blt_GetHashValue(hPtr);
     } else {
-	columnPtr = Blt_Calloc(1, sizeof(Column));
-	columnPtr->key = Blt_GetHashKey(&tupleObjPtr->columnTable, hPtr);
-	columnPtr->type = 0;
-	columnPtr->hashPtr = hPtr;
-	columnPtr->index = tupleObjPtr->nColumns;
+	int result;
+
+	result = ExtendColumns(tupleObjPtr, 1);
+	assert(result == TCL_OK);
+	columnPtr = NewColumn(tupleObjPtr, hPtr);
 	tupleObjPtr->columns[columnPtr->index] = columnPtr;
 	tupleObjPtr->nColumns++;
 	NotifyClients(clientPtr, tupleObjPtr, TUPLE_NOTIFY_CREATE_COLUMN);
@@ -1639,8 +2065,7 @@ Blt_TupleAddColumns(
     char **keys)
 {
     TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
-    int i;
-    int nColumns, extra;
+    int extra;
     char **p;
     Blt_HashEntry *hPtr;
     int isNew;
@@ -1656,39 +2081,19 @@ Blt_TupleAddColumns(
 	}
 	extra++;		/* Count the number of new columns. */
     }
-    nColumns = tupleObjPtr->nColumns + extra;
-    if (nColumns >= tupleObjPtr->columnsAllocated) {
-	Column **columns;
-	int columnsAllocated;
-
-	columnsAllocated = tupleObjPtr->columnsAllocated;
-	while (nColumns >= columnsAllocated) {
-	    columnsAllocated += columnsAllocated;
-	}
-	columns = Blt_Realloc(tupleObjPtr->columns, 
-		sizeof(Column *) * columnsAllocated);
-	if (columns == NULL) {
-	    return TCL_ERROR;
-	}
-	tupleObjPtr->columns = columns;
-	tupleObjPtr->columnsAllocated = columnsAllocated;
+    if (ExtendColumns(tupleObjPtr, extra) != TCL_OK) {
+	Tcl_AppendResult(interp, "can't allocate ", Blt_Itoa(extra), 
+		" new columns in \"", tupleObjPtr->name, "\"", (char *)NULL);
+	return TCL_ERROR;
     }
     for (p = keys; *p != NULL; p++) {
 	Column *columnPtr;
 
 	hPtr = Blt_CreateHashEntry(&tupleObjPtr->columnTable, *p, &isNew);
-	columnPtr = Blt_Calloc(1, sizeof(Column));
-	columnPtr->key = Blt_GetHashKey(&tupleObjPtr->columnTable, hPtr);
-	columnPtr->index = 0;
-	columnPtr->type = 0;
-	columnPtr->hashPtr = hPtr;
-	columnPtr->index = tupleObjPtr->nColumns;
+	columnPtr = NewColumn(tupleObjPtr, hPtr);
 	tupleObjPtr->columns[columnPtr->index] = columnPtr;
 	tupleObjPtr->nColumns++;
     }	
-    for(i = tupleObjPtr->nColumns; i < tupleObjPtr->columnsAllocated; i++) {
-	tupleObjPtr->columns[i] = NULL;
-    }
     NotifyClients(clientPtr, tupleObjPtr, TUPLE_NOTIFY_CREATE_COLUMN);
     return TCL_OK;
 }
@@ -1703,40 +2108,27 @@ Blt_TupleDeleteColumnByIndex(
     TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
     Column *columnPtr;
 
+    if (column >= tupleObjPtr->nColumns) {
+	return TCL_OK;
+    }
     columnPtr = tupleObjPtr->columns[column];
     if (columnPtr != NULL) {
-	Row *rowPtr;
-	int i;
-	int j, k;
+	unsigned int i;
 
 	if (columnPtr->hashPtr != NULL) {
 	    Blt_DeleteHashEntry(&tupleObjPtr->columnTable, columnPtr->hashPtr);
 	}
-	for (i = 0; i < tupleObjPtr->nRows; i++) {
-	    rowPtr = tupleObjPtr->rows[i];
-	    if ((column < rowPtr->nColumns) && (rowPtr->data != NULL)) {
-		Tcl_Obj *objPtr;
-
-		/* Release the Tcl_Obj associated with this column and
-		 * compress the tuple. */
-		objPtr = rowPtr->data[column];
-		if (objPtr != NULL) {
-		    Tcl_DecrRefCount(objPtr);
-		    rowPtr->data[column] = NULL;
-		}
-		for (j = column, k = column + 1; j < rowPtr->nColumns; 
-		     j++, k++) {
-		    rowPtr->data[k] = rowPtr->data[j];
-		}
-		rowPtr->nColumns--;
-	    }
-	}
-	for (j = column, k = column + 1; j < tupleObjPtr->nColumns; j++, k++) {
-	    tupleObjPtr->columns[k] = tupleObjPtr->columns[j];
+	/* 
+	 * The column owns all its values, so the rows don't need to be
+	 * touched.  Compress the array of columns.
+	 */
+	DestroyColumn(columnPtr);
+	for (i = column + 1; i < tupleObjPtr->nColumns; i++) {
+	    tupleObjPtr->columns[i - 1] = tupleObjPtr->columns[i];
+	    tupleObjPtr->columns[i - 1]->index = i - 1;
 	}
-	tupleObjPtr->columns[k] = NULL;
 	tupleObjPtr->nColumns--;
-	Blt_Free(columnPtr);
+	tupleObjPtr->columns[tupleObjPtr->nColumns] = NULL;
 	NotifyClients(clientPtr, tupleObjPtr, TUPLE_NOTIFY_DELETE_COLUMN);
     }
     return TCL_OK;
@@ -1757,6 +2149,198 @@ Blt_TupleDeleteColumn(
     return Blt_TupleDeleteColumnByIndex(interp, clientPtr, column);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TupleGetColumnType --
+ *
+ *	Returns the type of the values stored in the column.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TupleGetColumnType(TupleClient *clientPtr, unsigned int column)
+{
+    TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
+
+    assert(column < tupleObjPtr->nColumns);
+    return tupleObjPtr->columns[column]->type;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TupleSetColumnType --
+ *
+ *	Changes how the values of the column are stored.  Generic
+ *	columns hold a Tcl_Obj per value.  Double and integer columns
+ *	hold an array of native numbers, and string columns hold
+ *	codes into a dictionary of the distinct strings of the
+ *	column.  The existing values are converted to the new type.
+ *
+ * Results:
+ *	A standard Tcl result.  If any value can't be converted, the
+ *	column is left unchanged, TCL_ERROR is returned, and an error
+ *	message is left in the interpreter.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Blt_TupleSetColumnType(
+    Tcl_Interp *interp, 
+    TupleClient *clientPtr, 
+    unsigned int column,
+    int type)
+{
+    TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
+    Column *columnPtr, newColumn;
+    Tcl_Obj *objPtr;
+    unsigned int i;
+
+    assert(column < tupleObjPtr->nColumns);
+    assert((type >= TUPLE_COLUMN_TYPE_OBJ) && 
+	   (type <= TUPLE_COLUMN_TYPE_STRING));
+    columnPtr = tupleObjPtr->columns[column];
+    if (columnPtr->type == type) {
+	return TCL_OK;
+    }
+    /* Convert the values into a scratch column first. */
+    newColumn = *columnPtr;
+    InitColumnStorage(&newColumn, type);
+    for (i = 0; i < columnPtr->nSlots; i++) {
+	int result;
+
+	objPtr = CellToObj(columnPtr, i);
+	if (objPtr == NULL) {
+	    continue;
+	}
+	Tcl_IncrRefCount(objPtr);
+	result = ObjToCell(interp, &newColumn, i, objPtr);
+	Tcl_DecrRefCount(objPtr);
+	if (result != TCL_OK) {
+	    if (interp != NULL) {
+		Tcl_AppendResult(interp, ": can't convert column \"", 
+			columnPtr->key, "\" in \"", tupleObjPtr->name, "\"", 
+			(char *)NULL);
+	    }
+	    FreeColumnStorage(&newColumn);
+	    return TCL_ERROR;
+	}
+    }
+    /* The storage, including the dictionary, is held by pointers. */
+    FreeColumnStorage(columnPtr);
+    *columnPtr = newColumn;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompareRows --
+ *
+ *	Compares the values of two rows in the column being sorted.
+ *	Typed columns are compared on their native values.  Rows
+ *	without a value are sorted last.
+ *
+ *----------------------------------------------------------------------
+ */
+static Column *sortColumnPtr;
+static int sortDecreasing;
+
+static int
+CompareRows(CONST void *a, CONST void *b)
+{
+    Column *columnPtr = sortColumnPtr;
+    Row *r1Ptr = *(Row **)a;
+    Row *r2Ptr = *(Row **)b;
+    int defined1, defined2;
+    int result;
+
+    defined1 = ISDEFINED(columnPtr, r1Ptr->slot);
+    defined2 = ISDEFINED(columnPtr, r2Ptr->slot);
+    if ((!defined1) || (!defined2)) {
+	if (defined1) {
+	    return -1;
+	} 
+	if (defined2) {
+	    return 1;
+	}
+	result = 0;
+    } else {
+	unsigned int s1 = r1Ptr->slot, s2 = r2Ptr->slot;
+
+	switch (columnPtr->type) {
+	case TUPLE_COLUMN_TYPE_DOUBLE:
+	    result = (DOUBLES(columnPtr)[s1] < DOUBLES(columnPtr)[s2]) ? -1 :
+		(DOUBLES(columnPtr)[s1] > DOUBLES(columnPtr)[s2]) ? 1 : 0;
+	    break;
+	case TUPLE_COLUMN_TYPE_INTEGER:
+	    result = (INTS(columnPtr)[s1] < INTS(columnPtr)[s2]) ? -1 :
+		(INTS(columnPtr)[s1] > INTS(columnPtr)[s2]) ? 1 : 0;
+	    break;
+	case TUPLE_COLUMN_TYPE_STRING:
+	    if (CODES(columnPtr)[s1] == CODES(columnPtr)[s2]) {
+		result = 0;
+	    } else {
+		result = strcmp(CODESTRING(columnPtr, CODES(columnPtr)[s1]),
+			CODESTRING(columnPtr, CODES(columnPtr)[s2]));
+	    }
+	    break;
+	default:
+	    result = strcmp(Tcl_GetString(OBJS(columnPtr)[s1]), 
+		Tcl_GetString(OBJS(columnPtr)[s2]));
+	    break;
+	}
+	if (sortDecreasing) {
+	    result = -result;
+	}
+    }
+    if (result == 0) {
+	/* Keep the sort stable. */
+	result = (r1Ptr->index < r2Ptr->index) ? -1 : 1;
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Blt_TupleSortRows --
+ *
+ *	Sorts the rows of the table by the values of the given
+ *	column.  Only the row pointers are reordered.
+ *
+ * Results:
+ *	None.
+ *
+ * Side Effects:
+ *	Clients are notified that the table was sorted.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Blt_TupleSortRows(
+    TupleClient *clientPtr, 
+    unsigned int column, 
+    int decreasing)
+{
+    TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
+    unsigned int i;
+
+    assert(column < tupleObjPtr->nColumns);
+    if (tupleObjPtr->nRows < 2) {
+	return;
+    }
+    sortColumnPtr = tupleObjPtr->columns[column];
+    sortDecreasing = decreasing;
+    qsort((char *)tupleObjPtr->rows, tupleObjPtr->nRows, sizeof(Row *), 
+	  (QSortCompareProc *)CompareRows);
+    for (i = 0; i < tupleObjPtr->nRows; i++) {
+	tupleObjPtr->rows[i]->index = i;
+    }
+    NotifyClients(clientPtr, tupleObjPtr, TUPLE_NOTIFY_SORT);
+}
+
 
 /*
  *----------------------------------------------------------------------
@@ -1782,7 +2366,7 @@ Blt_TupleValueExists(
     char *left, *right;
     int result;
 
-    if (rowPtr->index < tupleObjPtr->nRows) {
+    if (rowPtr->index >= tupleObjPtr->nRows) {
 	return FALSE;
     }
     if (ParseParentheses((Tcl_Interp *)NULL, key, &left, &right) != TCL_OK) {
@@ -1806,12 +2390,10 @@ Blt_TupleValueExists(
     } else {
 	hPtr = Blt_FindHashEntry(&tupleObjPtr->columnTable, key);
 	if (hPtr != NULL) {
-	    Tcl_Obj *objPtr;
 	    Column *columnPtr;
 
 	    columnPtr = Blt_GetHashValue(hPtr);
-	    objPtr = VALUE(rowPtr, columnPtr);
-	    result = (objPtr != NULL);
+	    result = (ISDEFINED(columnPtr, rowPtr->slot) != 0);
 	}
     }
     return result;
@@ -2167,33 +2749,28 @@ Blt_TupleInsertRows(
     unsigned int nRows)		/* Number of rows tuples to insert. */
 {
     TupleObject *tupleObjPtr;
-    int oldRows;
+    unsigned int i;
 
     tupleObjPtr = clientPtr->tupleObjPtr;
 
     if (insertRow >= tupleObjPtr->nRows) {
 	insertRow = tupleObjPtr->nRows;
     }
-    oldRows = tupleObjPtr->nRows;
-    if (!ExtendRows(tupleObjPtr, nRows)) {
+    if (ExtendRows(tupleObjPtr, nRows) != TCL_OK) {
 	return TCL_ERROR;
     }
-    if (insertRow < oldRows) {
-	int i, j;
-
-	/* Slide the rows down, creating new tuples in its place. */
-	for (i = insertRow, j = insertRow + nRows; i < oldRows; i++, j++) {
-	    tupleObjPtr->rows[j] = tupleObjPtr->rows[i];
-	    tupleObjPtr->rows[j]->index = j;
-	    tupleObjPtr->rows[i] = NewRow(tupleObjPtr, i);
-	}
-    } else {
-	int i;
-
-	for (i = oldRows; i < tupleObjPtr->nRows; i++) {
-	    tupleObjPtr->rows[i] = NewRow(tupleObjPtr, i);
-	}
-    }	
+    /* 
+     * Slide the rows down, creating new tuples in their place.  Only
+     * the row pointers move, the values stay in their slots.
+     */
+    for (i = tupleObjPtr->nRows; i > insertRow; i--) {
+	tupleObjPtr->rows[i - 1 + nRows] = tupleObjPtr->rows[i - 1];
+	tupleObjPtr->rows[i - 1 + nRows]->index = i - 1 + nRows;
+    }
+    for (i = insertRow; i < (insertRow + nRows); i++) {
+	tupleObjPtr->rows[i] = NewRow(tupleObjPtr, i);
+    }
+    tupleObjPtr->nRows += nRows;
     /* 
      * Issue callbacks to each client indicating that a new node has
      * been created.
@@ -2257,7 +2834,7 @@ Blt_TupleDeleteTuple(
     Row *rowPtr)
 {
     TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
-    int i, j;
+    unsigned int i;
 
     if (!tupleObjPtr->notifyHold) {
 	/* 
@@ -2265,12 +2842,15 @@ Blt_TupleDeleteTuple(
 	 * removed.
 	 */
 	NotifyClients(clientPtr, tupleObjPtr, TUPLE_NOTIFY_DELETE_ROW);
-	for (j = tupleObjPtr->nRows - 1, i = j - 1; i >= rowPtr->index; 
-	     i--, j--) {
-	    tupleObjPtr->rows[i] = tupleObjPtr->rows[j];
+	/* Slide the rows after it down one. */
+	for (i = rowPtr->index; (i + 1) < tupleObjPtr->nRows; i++) {
+	    tupleObjPtr->rows[i] = tupleObjPtr->rows[i + 1];
 	    tupleObjPtr->rows[i]->index = i;
 	}
 	tupleObjPtr->nRows--;
+    } else {
+	/* The array is compressed by Blt_TupleEndDeleteRows. */
+	tupleObjPtr->rows[rowPtr->index] = NULL;
     }
     if (Blt_ChainGetLength(tupleObjPtr->clients) < 2) {
 	Blt_TupleClearTags(clientPtr, rowPtr);
@@ -2318,7 +2898,6 @@ void
 Blt_TupleEndDeleteRows(TupleClient *clientPtr)
 {
     TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
-    int first;
     int count;
     int i;
 
@@ -2330,9 +2909,6 @@ Blt_TupleEndDeleteRows(TupleClient *clientPtr)
     count = 0;
     for (i = 0; i < tupleObjPtr->nRows; i++) {
 	if (tupleObjPtr->rows[i] == NULL) {
-	    if (first == -1) {
-		first = i;
-	    }
 	    continue;
 	}
 	if (count < i) {
@@ -2460,17 +3036,16 @@ Blt_TupleDeleteTrace(Trace *tracePtr)
  *----------------------------------------------------------------------
  */
 int
-Blt_TupleExtendRows(TupleClient *clientPtr, unsigned int nRows)
+Blt_TupleExtendRows(TupleClient *clientPtr, unsigned int extra)
 {
     TupleObject *tupleObjPtr = clientPtr->tupleObjPtr;
-    int oldSize;
-    int i;
+    unsigned int i, nRows;
     
-    oldSize = tupleObjPtr->nRows;
-    if (!ExtendRows(tupleObjPtr, nRows)) {
+    if (ExtendRows(tupleObjPtr, extra) != TCL_OK) {
 	return TCL_ERROR;
     }
-    for (i = oldSize; i < tupleObjPtr->nRows; i++) {
+    nRows = tupleObjPtr->nRows + extra;
+    for (i = tupleObjPtr->nRows; i < nRows; i++) {
 	tupleObjPtr->rows[i] = NewRow(tupleObjPtr, i);
     }
     tupleObjPtr->nRows = nRows;
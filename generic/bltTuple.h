@@ -33,30 +33,18 @@
 #include <bltPool.h>
 
 /*
- *  array or row pointers
- *   _
- *  |_---> [row index
- *  |_     [#columns             array of Tcl_Objs
- *  |_     [tuple pointer ---> [ . . . . . ]
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
- *  |_
+ *  array of row pointers         columns
+ *   _                          
+ *  |_---> [row index         defined bits  [1 0 1 1 ...]
+ *  |_     [slot ---------->  typed values  [ . . . . ...]
+ *  |_                        
+ *  |_---> [row index         defined bits  [0 1 1 0 ...]
+ *  |_     [slot ---------->  string codes  [ . . . . ...] --> dictionary
  *
+ *  Each row owns a slot that indexes the value arrays of every
+ *  column.  Slots never move, so rows can be reordered without
+ *  touching the values.  Columns hold either Tcl_Objs or native
+ *  doubles, integers, or codes of dictionary strings.
  */
 typedef struct Blt_TupleRowStruct *Blt_Tuple;
 typedef struct Blt_TupleTraceStruct *Blt_TupleTrace;
@@ -83,6 +71,11 @@ typedef struct Blt_TupleTagTableStruct Blt_TupleTagTable;
 	  TUPLE_NOTIFY_SORT   | TUPLE_NOTIFY_RELABEL)
 #define TUPLE_NOTIFY_MASK		(TUPLE_NOTIFY_ALL)
 
+#define TUPLE_COLUMN_TYPE_OBJ		0
+#define TUPLE_COLUMN_TYPE_DOUBLE	1
+#define TUPLE_COLUMN_TYPE_INTEGER	2
+#define TUPLE_COLUMN_TYPE_STRING	3
+
 #define TUPLE_NOTIFY_WHENIDLE	 (1<<8)
 #define TUPLE_NOTIFY_FOREIGN_ONLY (1<<9)
 #define TUPLE_NOTIFY_ACTIVE	 (1<<10)
@@ -206,6 +199,11 @@ EXTERN int Blt_TupleUnsetArrayValue(Tcl_Interp *interp, Blt_TupleTable table,
 
 EXTERN unsigned int Blt_TupleAddColumn(Blt_TupleTable table, CONST char *key, 
 	int *isNewPtr);
+EXTERN int Blt_TupleGetColumnType(Blt_TupleTable table, unsigned int column);
+EXTERN int Blt_TupleSetColumnType(Tcl_Interp *interp, Blt_TupleTable table, 
+	unsigned int column, int type);
+EXTERN void Blt_TupleSortRows(Blt_TupleTable table, unsigned int column, 
+	int decreasing);
 EXTERN unsigned int Blt_TupleRowIndex(Blt_Tuple tuple);
 EXTERN CONST char *Blt_TupleGetColumnKey(Blt_TupleTable table, int column);
 EXTERN Blt_HashEntry *Blt_TupleFirstTag(Blt_TupleTable table, 
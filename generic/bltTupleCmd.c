@@ -832,8 +832,11 @@ PrintTuple(
 			key, &valueObjPtr) == TCL_OK) {
 		Tcl_DStringAppendElement(resultPtr, key);
 		if (valueObjPtr != NULL) {
+		    /* Typed columns hand back a fresh object. */
+		    Tcl_IncrRefCount(valueObjPtr);
 		    Tcl_DStringAppendElement(resultPtr, 
 			Tcl_GetString(valueObjPtr));
+		    Tcl_DecrRefCount(valueObjPtr);
 		} else {
 		    Tcl_DStringAppendElement(resultPtr, "NA");
 		}
@@ -1318,9 +1321,13 @@ ExistsOp(
 	key = Tcl_GetString(objv[3]);
 	if (Blt_TupleGetValue((Tcl_Interp *)NULL, cmdPtr->table, tuple, 
 			     key, &valueObjPtr) != TCL_OK) {
-	    bool = FALSE;
+	    valueObjPtr = NULL;
 	}
 	bool = (valueObjPtr != NULL);
+	if (bool) {
+	    Tcl_IncrRefCount(valueObjPtr);
+	    Tcl_DecrRefCount(valueObjPtr);
+	}
     } 
     Tcl_SetObjResult(interp, Tcl_NewBooleanObj(bool));
     return TCL_OK;